@@ -0,0 +1,356 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "bench-report.h"
+
+/* Increase whenever the layout of the JSON output changes */
+#define BRASERO_BENCH_REPORT_VERSION	1
+
+struct _BraseroBenchResult {
+	gchar *name;
+	gchar *skipped;
+
+	/* number of items (files, bytes, ...) processed by each run */
+	guint64 items;
+
+	GArray *runs;
+};
+
+struct _BraseroBenchReport {
+	GSList *params;
+	GSList *results;
+};
+
+typedef struct _BraseroBenchParam BraseroBenchParam;
+struct _BraseroBenchParam {
+	gchar *name;
+	gchar *value;
+};
+
+BraseroBenchReport *
+brasero_bench_report_new (void)
+{
+	return g_new0 (BraseroBenchReport, 1);
+}
+
+static void
+brasero_bench_result_free (BraseroBenchResult *result)
+{
+	g_array_free (result->runs, TRUE);
+	g_free (result->skipped);
+	g_free (result->name);
+	g_free (result);
+}
+
+static void
+brasero_bench_param_free (BraseroBenchParam *param)
+{
+	g_free (param->name);
+	g_free (param->value);
+	g_free (param);
+}
+
+void
+brasero_bench_report_free (BraseroBenchReport *report)
+{
+	g_slist_foreach (report->params, (GFunc) brasero_bench_param_free, NULL);
+	g_slist_free (report->params);
+
+	g_slist_foreach (report->results, (GFunc) brasero_bench_result_free, NULL);
+	g_slist_free (report->results);
+
+	g_free (report);
+}
+
+void
+brasero_bench_report_set_param (BraseroBenchReport *report,
+				const gchar *name,
+				const gchar *format,
+				...)
+{
+	BraseroBenchParam *param;
+	va_list args;
+
+	param = g_new0 (BraseroBenchParam, 1);
+	param->name = g_strdup (name);
+
+	va_start (args, format);
+	param->value = g_strdup_vprintf (format, args);
+	va_end (args);
+
+	report->params = g_slist_append (report->params, param);
+}
+
+BraseroBenchResult *
+brasero_bench_report_add_result (BraseroBenchReport *report,
+				 const gchar *name,
+				 guint64 items)
+{
+	BraseroBenchResult *result;
+
+	result = g_new0 (BraseroBenchResult, 1);
+	result->name = g_strdup (name);
+	result->items = items;
+	result->runs = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+	report->results = g_slist_append (report->results, result);
+	return result;
+}
+
+void
+brasero_bench_result_add_run (BraseroBenchResult *result,
+			      gint64 usecs)
+{
+	g_array_append_val (result->runs, usecs);
+}
+
+void
+brasero_bench_result_skip (BraseroBenchResult *result,
+			   const gchar *reason)
+{
+	g_free (result->skipped);
+	result->skipped = g_strdup (reason);
+}
+
+static gint
+brasero_bench_compare_runs (gconstpointer a,
+			    gconstpointer b)
+{
+	gint64 first = *(const gint64 *) a;
+	gint64 second = *(const gint64 *) b;
+
+	return first < second ? -1 : first > second;
+}
+
+typedef struct _BraseroBenchStats BraseroBenchStats;
+struct _BraseroBenchStats {
+	gdouble median;
+	gdouble mean;
+	gdouble stddev;
+	gint64 min;
+	gint64 max;
+};
+
+static void
+brasero_bench_result_get_stats (BraseroBenchResult *result,
+				BraseroBenchStats *stats)
+{
+	gint64 *runs;
+	guint num;
+	guint i;
+
+	memset (stats, 0, sizeof (BraseroBenchStats));
+
+	num = result->runs->len;
+	if (!num)
+		return;
+
+	runs = g_memdup (result->runs->data, num * sizeof (gint64));
+	qsort (runs, num, sizeof (gint64), brasero_bench_compare_runs);
+
+	stats->min = runs [0];
+	stats->max = runs [num - 1];
+
+	/* The median is what should be compared between two reports as it is
+	 * not affected by the odd run disturbed by another process */
+	if (num % 2)
+		stats->median = runs [num / 2];
+	else
+		stats->median = (runs [num / 2 - 1] + runs [num / 2]) / 2.0;
+
+	for (i = 0; i < num; i ++)
+		stats->mean += runs [i];
+	stats->mean /= num;
+
+	for (i = 0; i < num; i ++)
+		stats->stddev += (runs [i] - stats->mean) * (runs [i] - stats->mean);
+	stats->stddev = sqrt (stats->stddev / num);
+
+	g_free (runs);
+}
+
+void
+brasero_bench_report_print (BraseroBenchReport *report)
+{
+	GSList *iter;
+
+	for (iter = report->results; iter; iter = iter->next) {
+		BraseroBenchResult *result;
+		BraseroBenchStats stats;
+
+		result = iter->data;
+		if (result->skipped) {
+			g_print ("%-24s skipped (%s)\n", result->name, result->skipped);
+			continue;
+		}
+
+		brasero_bench_result_get_stats (result, &stats);
+		g_print ("%-24s median %10.3f ms  min %10.3f ms  max %10.3f ms  stddev %5.1f%%\n",
+			 result->name,
+			 stats.median / 1000.0,
+			 stats.min / 1000.0,
+			 stats.max / 1000.0,
+			 stats.mean ? stats.stddev * 100.0 / stats.mean : 0.0);
+	}
+}
+
+static void
+brasero_bench_json_string (GString *json,
+			   const gchar *string)
+{
+	const gchar *iter;
+
+	g_string_append_c (json, '"');
+	for (iter = string; *iter; iter ++) {
+		switch (*iter) {
+		case '"':
+			g_string_append (json, "\\\"");
+			break;
+		case '\\':
+			g_string_append (json, "\\\\");
+			break;
+		case '\n':
+			g_string_append (json, "\\n");
+			break;
+		default:
+			if ((guchar) *iter < 0x20)
+				g_string_append_printf (json, "\\u%04x", (guchar) *iter);
+			else
+				g_string_append_c (json, *iter);
+			break;
+		}
+	}
+	g_string_append_c (json, '"');
+}
+
+static gchar *
+brasero_bench_report_to_json (BraseroBenchReport *report)
+{
+	gchar number [G_ASCII_DTOSTR_BUF_SIZE];
+	GString *json;
+	GSList *iter;
+
+	json = g_string_new ("{\n");
+	g_string_append_printf (json, "  \"version\": %i,\n", BRASERO_BENCH_REPORT_VERSION);
+
+	g_string_append (json, "  \"parameters\": {");
+	for (iter = report->params; iter; iter = iter->next) {
+		BraseroBenchParam *param;
+
+		param = iter->data;
+		g_string_append (json, "\n    ");
+		brasero_bench_json_string (json, param->name);
+		g_string_append (json, ": ");
+		brasero_bench_json_string (json, param->value);
+		if (iter->next)
+			g_string_append_c (json, ',');
+	}
+	g_string_append (json, "\n  },\n");
+
+	g_string_append (json, "  \"results\": [");
+	for (iter = report->results; iter; iter = iter->next) {
+		BraseroBenchResult *result;
+		BraseroBenchStats stats;
+		guint i;
+
+		result = iter->data;
+		g_string_append (json, "\n    {\n      \"name\": ");
+		brasero_bench_json_string (json, result->name);
+		g_string_append (json, ",\n");
+
+		if (result->skipped) {
+			g_string_append (json, "      \"skipped\": ");
+			brasero_bench_json_string (json, result->skipped);
+			g_string_append (json, "\n    }");
+		}
+		else {
+			brasero_bench_result_get_stats (result, &stats);
+
+			/* All times are in microseconds */
+			g_string_append (json, "      \"unit\": \"us\",\n");
+			g_string_append_printf (json, "      \"items\": %" G_GUINT64_FORMAT ",\n", result->items);
+
+			g_string_append (json, "      \"runs\": [");
+			for (i = 0; i < result->runs->len; i ++)
+				g_string_append_printf (json, "%s%" G_GINT64_FORMAT,
+							i ? ", " : "",
+							g_array_index (result->runs, gint64, i));
+			g_string_append (json, "],\n");
+
+			/* Use g_ascii_dtostr () so the output does not depend
+			 * on the locale */
+			g_string_append_printf (json, "      \"median\": %s,\n",
+						g_ascii_dtostr (number, sizeof (number), stats.median));
+			g_string_append_printf (json, "      \"mean\": %s,\n",
+						g_ascii_dtostr (number, sizeof (number), stats.mean));
+			g_string_append_printf (json, "      \"stddev\": %s,\n",
+						g_ascii_dtostr (number, sizeof (number), stats.stddev));
+			g_string_append_printf (json, "      \"min\": %" G_GINT64_FORMAT ",\n", stats.min);
+			g_string_append_printf (json, "      \"max\": %" G_GINT64_FORMAT "\n    }", stats.max);
+		}
+
+		if (iter->next)
+			g_string_append_c (json, ',');
+	}
+	g_string_append (json, "\n  ]\n}\n");
+
+	return g_string_free (json, FALSE);
+}
+
+gboolean
+brasero_bench_report_save (BraseroBenchReport *report,
+			   const gchar *path,
+			   GError **error)
+{
+	gboolean result;
+	gchar *json;
+
+	json = brasero_bench_report_to_json (report);
+	if (!path || !strcmp (path, "-")) {
+		g_print ("%s", json);
+		g_free (json);
+		return TRUE;
+	}
+
+	result = g_file_set_contents (path, json, -1, error);
+	g_free (json);
+	return result;
+}
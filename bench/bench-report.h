@@ -0,0 +1,81 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#ifndef _BENCH_REPORT_H
+#define _BENCH_REPORT_H
+
+G_BEGIN_DECLS
+
+typedef struct _BraseroBenchReport BraseroBenchReport;
+
+typedef struct _BraseroBenchResult BraseroBenchResult;
+
+BraseroBenchReport *
+brasero_bench_report_new (void);
+
+void
+brasero_bench_report_free (BraseroBenchReport *report);
+
+void
+brasero_bench_report_set_param (BraseroBenchReport *report,
+				const gchar *name,
+				const gchar *format,
+				...) G_GNUC_PRINTF (3, 4);
+
+BraseroBenchResult *
+brasero_bench_report_add_result (BraseroBenchReport *report,
+				 const gchar *name,
+				 guint64 items);
+
+void
+brasero_bench_result_add_run (BraseroBenchResult *result,
+			      gint64 usecs);
+
+void
+brasero_bench_result_skip (BraseroBenchResult *result,
+			   const gchar *reason);
+
+void
+brasero_bench_report_print (BraseroBenchReport *report);
+
+gboolean
+brasero_bench_report_save (BraseroBenchReport *report,
+			   const gchar *path,
+			   GError **error);
+
+G_END_DECLS
+
+#endif /* _BENCH_REPORT_H */
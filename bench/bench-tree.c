@@ -0,0 +1,300 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "bench-tree.h"
+
+/* Characters are kept to the portable set so that trees are identical
+ * whatever the filesystem they are generated on */
+static const gchar name_chars [] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-";
+
+/* Not allowed in Joliet identifiers */
+static const gchar joliet_unsafe_chars [] = "*:;?";
+
+/* Longest name Joliet allows (in UCS-2 characters) */
+#define BENCH_TREE_JOLIET_MAX		64
+
+static gchar *
+brasero_bench_tree_name (GRand *rand,
+			 guint length,
+			 gboolean unsafe,
+			 guint num)
+{
+	GString *name;
+	guint i;
+
+	/* Spread lengths 25% around the requested one */
+	length = MAX (1, g_rand_int_range (rand, length - length / 4, length + length / 4 + 1));
+
+	if (unsafe) {
+		/* Half of these are too long, the others use forbidden
+		 * characters */
+		if (g_rand_boolean (rand))
+			length = MAX (length, BENCH_TREE_JOLIET_MAX + 8);
+	}
+
+	name = g_string_sized_new (length + 16);
+
+	/* make sure names are unique in a directory */
+	g_string_append_printf (name, "%u-", num);
+
+	for (i = 0; i < length; i ++)
+		g_string_append_c (name, name_chars [g_rand_int_range (rand, 0, sizeof (name_chars) - 1)]);
+
+	if (unsafe && name->len <= BENCH_TREE_JOLIET_MAX)
+		name->str [g_rand_int_range (rand, 0, name->len)] = joliet_unsafe_chars [g_rand_int_range (rand, 0, sizeof (joliet_unsafe_chars) - 1)];
+
+	return g_string_free (name, FALSE);
+}
+
+static gboolean
+brasero_bench_tree_write_file (GRand *rand,
+			       const gchar *path,
+			       goffset size,
+			       GError **error)
+{
+	guint32 buffer [4096];
+	FILE *file;
+
+	file = fopen (path, "w");
+	if (!file) {
+		int errsv = errno;
+
+		g_set_error (error,
+			     G_FILE_ERROR,
+			     g_file_error_from_errno (errsv),
+			     "%s: %s",
+			     path,
+			     g_strerror (errsv));
+		return FALSE;
+	}
+
+	while (size > 0) {
+		gsize bytes;
+		guint i;
+
+		bytes = MIN (size, sizeof (buffer));
+		for (i = 0; i < (bytes + 3) / 4; i ++)
+			buffer [i] = g_rand_int (rand);
+
+		if (fwrite (buffer, 1, bytes, file) != bytes) {
+			int errsv = errno;
+
+			g_set_error (error,
+				     G_FILE_ERROR,
+				     g_file_error_from_errno (errsv),
+				     "%s: %s",
+				     path,
+				     g_strerror (errsv));
+			fclose (file);
+			return FALSE;
+		}
+
+		size -= bytes;
+	}
+
+	fclose (file);
+	return TRUE;
+}
+
+/**
+ * brasero_bench_tree_generate:
+ * @params: a #BraseroBenchTreeParams
+ * @error: a #GError
+ *
+ * Creates a directory tree in the temporary directory. The same parameters
+ * (including the seed) always produce the same tree.
+ *
+ * Return value: a #BraseroBenchTree or NULL on error.
+ **/
+
+BraseroBenchTree *
+brasero_bench_tree_generate (BraseroBenchTreeParams *params,
+			     GError **error)
+{
+	BraseroBenchTree *tree;
+	GPtrArray *dirs;
+	GRand *rand;
+	guint i;
+
+	tree = g_new0 (BraseroBenchTree, 1);
+	tree->paths = g_ptr_array_new_with_free_func (g_free);
+	tree->root = g_build_filename (g_get_tmp_dir (), "brasero-bench-XXXXXX", NULL);
+	if (!g_mkdtemp (tree->root)) {
+		int errsv = errno;
+
+		g_set_error (error,
+			     G_FILE_ERROR,
+			     g_file_error_from_errno (errsv),
+			     "%s: %s",
+			     tree->root,
+			     g_strerror (errsv));
+		brasero_bench_tree_free (tree, FALSE);
+		return NULL;
+	}
+
+	rand = g_rand_new_with_seed (params->seed);
+
+	/* Create the directories level by level; each directory has up to
+	 * fanout children and the tree is params->depth levels deep */
+	dirs = g_ptr_array_new ();
+	g_ptr_array_add (dirs, g_strdup (tree->root));
+	for (i = 0; i < dirs->len; i ++) {
+		gchar *parent;
+		guint level;
+		guint j;
+
+		parent = g_ptr_array_index (dirs, i);
+		level = 0;
+		for (j = strlen (tree->root); parent [j]; j ++) {
+			if (parent [j] == G_DIR_SEPARATOR)
+				level ++;
+		}
+
+		if (level >= params->depth)
+			break;
+
+		for (j = 0; j < params->fanout; j ++) {
+			gboolean unsafe;
+			gchar *name;
+			gchar *path;
+
+			unsafe = (g_rand_double (rand) < params->joliet_unsafe);
+			name = brasero_bench_tree_name (rand, params->name_length, unsafe, j);
+			path = g_build_filename (parent, name, NULL);
+			g_free (name);
+
+			if (g_mkdir (path, 0755)) {
+				int errsv = errno;
+
+				g_set_error (error,
+					     G_FILE_ERROR,
+					     g_file_error_from_errno (errsv),
+					     "%s: %s",
+					     path,
+					     g_strerror (errsv));
+				g_free (path);
+				goto error;
+			}
+
+			tree->joliet_unsafe += unsafe;
+			tree->directories ++;
+			g_ptr_array_add (dirs, path);
+		}
+	}
+
+	/* Spread the files randomly among all the directories */
+	for (i = 0; i < params->files; i ++) {
+		gboolean unsafe;
+		goffset size;
+		gchar *name;
+		gchar *path;
+
+		unsafe = (g_rand_double (rand) < params->joliet_unsafe);
+		name = brasero_bench_tree_name (rand, params->name_length, unsafe, i);
+		path = g_build_filename (g_ptr_array_index (dirs, g_rand_int_range (rand, 0, dirs->len)),
+					 name,
+					 NULL);
+		g_free (name);
+
+		size = params->file_size ? (goffset) (g_rand_double (rand) * params->file_size * 2) : 0;
+		if (!brasero_bench_tree_write_file (rand, path, size, error)) {
+			g_free (path);
+			goto error;
+		}
+
+		tree->joliet_unsafe += unsafe;
+		tree->bytes += size;
+		tree->files ++;
+		g_ptr_array_add (tree->paths, path);
+	}
+
+	g_ptr_array_foreach (dirs, (GFunc) g_free, NULL);
+	g_ptr_array_free (dirs, TRUE);
+	g_rand_free (rand);
+	return tree;
+
+error:
+
+	g_ptr_array_foreach (dirs, (GFunc) g_free, NULL);
+	g_ptr_array_free (dirs, TRUE);
+	g_rand_free (rand);
+	brasero_bench_tree_free (tree, TRUE);
+	return NULL;
+}
+
+static void
+brasero_bench_tree_remove_dir (const gchar *path)
+{
+	const gchar *name;
+	GDir *dir;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (!dir)
+		return;
+
+	while ((name = g_dir_read_name (dir))) {
+		gchar *child;
+
+		child = g_build_filename (path, name, NULL);
+		if (g_file_test (child, G_FILE_TEST_IS_DIR)
+		&& !g_file_test (child, G_FILE_TEST_IS_SYMLINK))
+			brasero_bench_tree_remove_dir (child);
+		else
+			g_remove (child);
+
+		g_free (child);
+	}
+	g_dir_close (dir);
+
+	g_rmdir (path);
+}
+
+void
+brasero_bench_tree_free (BraseroBenchTree *tree,
+			 gboolean remove)
+{
+	if (remove && tree->root)
+		brasero_bench_tree_remove_dir (tree->root);
+
+	g_ptr_array_free (tree->paths, TRUE);
+	g_free (tree->root);
+	g_free (tree);
+}
@@ -0,0 +1,82 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#ifndef _BENCH_TREE_H
+#define _BENCH_TREE_H
+
+G_BEGIN_DECLS
+
+typedef struct _BraseroBenchTreeParams BraseroBenchTreeParams;
+struct _BraseroBenchTreeParams {
+	guint files;
+	guint depth;
+	guint fanout;
+	guint name_length;
+
+	/* ratio (0.0 - 1.0) of names that are not valid Joliet names */
+	gdouble joliet_unsafe;
+
+	/* average file size in bytes; sizes are spread between 0 and twice
+	 * this value */
+	goffset file_size;
+
+	guint32 seed;
+};
+
+typedef struct _BraseroBenchTree BraseroBenchTree;
+struct _BraseroBenchTree {
+	gchar *root;
+
+	guint files;
+	guint directories;
+	guint joliet_unsafe;
+	goffset bytes;
+
+	/* absolute paths of all regular files */
+	GPtrArray *paths;
+};
+
+BraseroBenchTree *
+brasero_bench_tree_generate (BraseroBenchTreeParams *params,
+			     GError **error);
+
+void
+brasero_bench_tree_free (BraseroBenchTree *tree,
+			 gboolean remove);
+
+G_END_DECLS
+
+#endif /* _BENCH_TREE_H */
@@ -0,0 +1,999 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "brasero-burn-lib.h"
+#include "brasero-error.h"
+#include "brasero-medium-monitor.h"
+#include "brasero-drive.h"
+
+#include "brasero-session.h"
+#include "brasero-burn.h"
+#include "brasero-status.h"
+#include "brasero-track-data.h"
+#include "brasero-track-data-cfg.h"
+#include "brasero-data-project.h"
+#include "brasero-data-vfs.h"
+#include "brasero-data-tree-model.h"
+
+#include "burn-checksum-tree.h"
+#include "burn-iso-layout.h"
+
+#include "bench-tree.h"
+#include "bench-report.h"
+
+/* Number of calls timed together by the suites that are too fast to be
+ * measured reliably with one call */
+#define BRASERO_BENCH_CAPS_LOOPS	100
+
+typedef struct _BraseroBenchContext BraseroBenchContext;
+struct _BraseroBenchContext {
+	BraseroBenchTree *tree;
+	gchar *uri;
+
+	/* Loaded once; used by all the suites that need a complete project */
+	BraseroDataProject *project;
+	BraseroTrackDataCfg *track;
+
+	BraseroDrive *file_drive;
+};
+
+typedef gint64 (*BraseroBenchFunc) (BraseroBenchContext *ctx,
+				    GError **error);
+
+typedef guint64 (*BraseroBenchItemsFunc) (BraseroBenchContext *ctx);
+
+typedef struct _BraseroBenchSuite BraseroBenchSuite;
+struct _BraseroBenchSuite {
+	const gchar *name;
+	BraseroBenchFunc func;
+	BraseroBenchItemsFunc items;
+
+	/* suites that write an image are only run when asked */
+	gboolean needs_image_file;
+};
+
+static gint files = 10000;
+static gint depth = 4;
+static gint fanout = 6;
+static gint name_length = 24;
+static gdouble joliet_unsafe = 0.1;
+static gint file_size = 4096;
+static gint seed = 1;
+static gint runs = 5;
+static gchar *output = NULL;
+static gchar *suites = NULL;
+static gboolean image_file = FALSE;
+static gboolean check_iso = FALSE;
+static gboolean keep = FALSE;
+
+static const GOptionEntry options [] = {
+	{ "files", 'n', 0, G_OPTION_ARG_INT, &files,
+	  "Number of files in the generated tree (default 10000)", "NUM" },
+	{ "depth", 'd', 0, G_OPTION_ARG_INT, &depth,
+	  "Depth of the generated tree (default 4)", "NUM" },
+	{ "fanout", 'f', 0, G_OPTION_ARG_INT, &fanout,
+	  "Number of subdirectories per directory (default 6)", "NUM" },
+	{ "name-length", 'l', 0, G_OPTION_ARG_INT, &name_length,
+	  "Average length of names (default 24)", "NUM" },
+	{ "joliet-unsafe", 'j', 0, G_OPTION_ARG_DOUBLE, &joliet_unsafe,
+	  "Ratio of names that are not valid Joliet names (default 0.1)", "RATIO" },
+	{ "file-size", 's', 0, G_OPTION_ARG_INT, &file_size,
+	  "Average size of files in bytes (default 4096)", "BYTES" },
+	{ "seed", 0, 0, G_OPTION_ARG_INT, &seed,
+	  "Seed of the tree generator (default 1)", "NUM" },
+	{ "runs", 'r', 0, G_OPTION_ARG_INT, &runs,
+	  "Number of timed runs per suite (default 5)", "NUM" },
+	{ "suite", 0, 0, G_OPTION_ARG_STRING, &suites,
+	  "Comma separated list of the suites to run (default all)", "NAMES" },
+	{ "output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+	  "Write JSON results to PATH (\"-\" for stdout)", "PATH" },
+	{ "image-file", 0, 0, G_OPTION_ARG_NONE, &image_file,
+	  "Also run the suites burning to the file drive", NULL },
+	{ "check-iso", 0, 0, G_OPTION_ARG_NONE, &check_iso,
+	  "Check that an image created by the ISO writer reads back with isoinfo", NULL },
+	{ "keep", 'k', 0, G_OPTION_ARG_NONE, &keep,
+	  "Do not remove the generated tree", NULL },
+	{ NULL }
+};
+
+static void
+brasero_bench_wait_for_project (BraseroDataProject *project)
+{
+	/* Loading is done in BraseroIO threads and results are delivered
+	 * through the main loop */
+	while (brasero_data_vfs_is_active (BRASERO_DATA_VFS (project)))
+		g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+brasero_bench_wait_for_track (BraseroTrackDataCfg *track)
+{
+	BraseroStatus *status;
+
+	status = brasero_status_new ();
+	while (brasero_track_get_status (BRASERO_TRACK (track), status) == BRASERO_BURN_NOT_READY)
+		g_main_context_iteration (NULL, TRUE);
+
+	g_object_unref (status);
+}
+
+static BraseroDataProject *
+brasero_bench_load_project (BraseroBenchContext *ctx)
+{
+	BraseroDataProject *project;
+
+	project = BRASERO_DATA_PROJECT (brasero_data_tree_model_new ());
+	brasero_data_project_add_loading_node (project, ctx->uri, NULL);
+	brasero_bench_wait_for_project (project);
+	return project;
+}
+
+static guint64
+brasero_bench_items_files (BraseroBenchContext *ctx)
+{
+	return ctx->tree->files + ctx->tree->directories;
+}
+
+static guint64
+brasero_bench_items_bytes (BraseroBenchContext *ctx)
+{
+	return ctx->tree->bytes;
+}
+
+static gint64
+brasero_bench_data_project (BraseroBenchContext *ctx,
+			    GError **error)
+{
+	BraseroDataProject *project;
+	gint64 start, end;
+
+	start = g_get_monotonic_time ();
+	project = brasero_bench_load_project (ctx);
+	end = g_get_monotonic_time ();
+
+	g_object_unref (project);
+	return end - start;
+}
+
+static gint64
+brasero_bench_grafts (BraseroBenchContext *ctx,
+		      GError **error)
+{
+	GSList *unreadable = NULL;
+	GSList *grafts = NULL;
+	gint64 start, end;
+
+	start = g_get_monotonic_time ();
+	brasero_data_project_get_contents (ctx->project,
+					   &grafts,
+					   &unreadable,
+					   TRUE,
+					   TRUE,
+					   TRUE);
+	end = g_get_monotonic_time ();
+
+	g_slist_foreach (grafts, (GFunc) brasero_graft_point_free, NULL);
+	g_slist_free (grafts);
+	g_slist_foreach (unreadable, (GFunc) g_free, NULL);
+	g_slist_free (unreadable);
+
+	return end - start;
+}
+
+static gint64
+brasero_bench_span (BraseroBenchContext *ctx,
+		    GError **error)
+{
+	BraseroBurnResult result;
+	gint64 start, end;
+	goffset sectors;
+
+	/* Split the project over four "discs" */
+	sectors = brasero_data_project_get_sectors (ctx->project);
+	sectors = MAX (sectors / 4, 1);
+
+	start = g_get_monotonic_time ();
+	do {
+		BraseroTrackData *track;
+
+		track = brasero_track_data_new ();
+		result = brasero_data_project_span (ctx->project,
+						    sectors,
+						    TRUE,
+						    TRUE,
+						    track);
+		g_object_unref (track);
+	} while (result == BRASERO_BURN_RETRY);
+	end = g_get_monotonic_time ();
+
+	brasero_data_project_span_stop (ctx->project);
+
+	if (result != BRASERO_BURN_OK) {
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     "spanning failed");
+		return -1;
+	}
+
+	return end - start;
+}
+
+static gint64
+brasero_bench_caps (BraseroBenchContext *ctx,
+		    GError **error)
+{
+	BraseroBurnSession *session;
+	gint64 start, end;
+	guint i;
+
+	session = brasero_burn_session_new ();
+	brasero_burn_session_add_track (session, BRASERO_TRACK (ctx->track), NULL);
+	brasero_burn_session_set_burner (session, ctx->file_drive);
+
+	start = g_get_monotonic_time ();
+	for (i = 0; i < BRASERO_BENCH_CAPS_LOOPS; i ++) {
+		BraseroImageFormat formats;
+
+		brasero_burn_session_get_possible_output_formats (session, &formats);
+		brasero_burn_session_can_burn (session, TRUE);
+	}
+	end = g_get_monotonic_time ();
+
+	g_object_unref (session);
+	return end - start;
+}
+
+static gint64
+brasero_bench_checksum_files (BraseroBenchContext *ctx,
+			      GChecksum *checksum,
+			      BraseroChecksumTree *tree,
+			      GError **error)
+{
+	guchar buffer [65536];
+	gint64 elapsed = 0;
+	guint i;
+
+	/* Only time hashing; reading is in the page cache after the warm up
+	 * run and is not what this is meant to measure */
+	for (i = 0; i < ctx->tree->paths->len; i ++) {
+		FILE *file;
+		gsize bytes;
+
+		file = fopen (g_ptr_array_index (ctx->tree->paths, i), "r");
+		if (!file) {
+			g_set_error (error,
+				     G_FILE_ERROR,
+				     G_FILE_ERROR_FAILED,
+				     "%s cannot be read",
+				     (gchar *) g_ptr_array_index (ctx->tree->paths, i));
+			return -1;
+		}
+
+		while ((bytes = fread (buffer, 1, sizeof (buffer), file)) > 0) {
+			gint64 start;
+
+			start = g_get_monotonic_time ();
+			if (checksum)
+				g_checksum_update (checksum, buffer, bytes);
+			else
+				brasero_checksum_tree_update (tree, buffer, bytes);
+			elapsed += g_get_monotonic_time () - start;
+		}
+
+		fclose (file);
+	}
+
+	return elapsed;
+}
+
+static gint64
+brasero_bench_checksum_sha256 (BraseroBenchContext *ctx,
+			       GError **error)
+{
+	GChecksum *checksum;
+	gint64 elapsed;
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA256);
+	elapsed = brasero_bench_checksum_files (ctx, checksum, NULL, error);
+	g_checksum_free (checksum);
+
+	return elapsed;
+}
+
+static gint64
+brasero_bench_checksum_tree (BraseroBenchContext *ctx,
+			     GError **error)
+{
+	BraseroChecksumTree *tree;
+	gint64 elapsed;
+
+	tree = brasero_checksum_tree_new (NULL);
+	elapsed = brasero_bench_checksum_files (ctx, NULL, tree, error);
+	if (elapsed >= 0) {
+		gint64 start;
+
+		start = g_get_monotonic_time ();
+		brasero_checksum_tree_finish (tree);
+		elapsed += g_get_monotonic_time () - start;
+	}
+	brasero_checksum_tree_free (tree);
+
+	return elapsed;
+}
+
+static gboolean
+brasero_bench_iso_write_cb (const guchar *buffer,
+			    gsize size,
+			    gpointer user_data)
+{
+	return TRUE;
+}
+
+static gint64
+brasero_bench_iso_layout (BraseroBenchContext *ctx,
+			  GError **error)
+{
+	BraseroIsoTree *tree;
+	gint64 start, end;
+	gboolean result;
+
+	start = g_get_monotonic_time ();
+	tree = brasero_iso_tree_new ("BENCH", "Brasero", "Brasero", TRUE);
+	result = brasero_iso_tree_add_graft (tree, "/bench", ctx->tree->root, error);
+	if (result) {
+		brasero_iso_tree_layout (tree);
+		brasero_iso_tree_write_metadata (tree, brasero_bench_iso_write_cb, NULL);
+	}
+	end = g_get_monotonic_time ();
+
+	brasero_iso_tree_free (tree);
+	return result ? end - start : -1;
+}
+
+static gint64
+brasero_bench_burn_iso (BraseroBenchContext *ctx,
+			GError **error)
+{
+	BraseroBurnSession *session;
+	BraseroBurnResult result;
+	BraseroBurn *burn;
+	gint64 start, end;
+	gchar *path;
+	int fd;
+
+	fd = g_file_open_tmp ("brasero-bench-XXXXXX.iso", &path, error);
+	if (fd < 0)
+		return -1;
+	close (fd);
+
+	session = brasero_burn_session_new ();
+	brasero_burn_session_add_track (session, BRASERO_TRACK (ctx->track), NULL);
+	brasero_burn_session_set_burner (session, ctx->file_drive);
+	brasero_burn_session_set_image_output_full (session,
+						    BRASERO_IMAGE_FORMAT_BIN,
+						    path,
+						    NULL);
+
+	burn = brasero_burn_new ();
+
+	start = g_get_monotonic_time ();
+	result = brasero_burn_record (burn, session, error);
+	end = g_get_monotonic_time ();
+
+	g_object_unref (burn);
+	g_object_unref (session);
+
+	g_remove (path);
+	g_free (path);
+
+	return result == BRASERO_BURN_OK ? end - start : -1;
+}
+
+/**
+ * ISO writer round trip: the generated tree is written with the layout of
+ * the isowriter plugin then read back with isoinfo, which is independent of
+ * our code. Names (Rock Ridge), sizes and the volume descriptor must match.
+ */
+
+static gboolean
+brasero_bench_iso_write_fd (int fd,
+			    const guchar *buffer,
+			    gsize size)
+{
+	while (size > 0) {
+		ssize_t written;
+
+		written = write (fd, buffer, size);
+		if (written < 0)
+			return FALSE;
+
+		buffer += written;
+		size -= written;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+brasero_bench_iso_write_image_cb (const guchar *buffer,
+				  gsize size,
+				  gpointer user_data)
+{
+	return brasero_bench_iso_write_fd (GPOINTER_TO_INT (user_data), buffer, size);
+}
+
+static gboolean
+brasero_bench_iso_write_image (BraseroIsoTree *tree,
+			       int fd,
+			       GError **error)
+{
+	guchar buffer [65536];
+	guint i;
+
+	if (!brasero_iso_tree_write_metadata (tree,
+					      brasero_bench_iso_write_image_cb,
+					      GINT_TO_POINTER (fd)))
+		goto error;
+
+	for (i = 0; i < tree->files->len; i ++) {
+		BraseroIsoNode *node;
+		gsize bytes;
+		FILE *file;
+
+		node = g_ptr_array_index (tree->files, i);
+		if (!node->size)
+			continue;
+
+		if (lseek (fd, (off_t) node->extent * BRASERO_ISO_BLOCK_SIZE, SEEK_SET) < 0)
+			goto error;
+
+		file = fopen (node->path, "r");
+		if (!file) {
+			g_set_error (error,
+				     G_FILE_ERROR,
+				     G_FILE_ERROR_FAILED,
+				     "%s cannot be read",
+				     node->path);
+			return FALSE;
+		}
+
+		while ((bytes = fread (buffer, 1, sizeof (buffer), file)) > 0) {
+			if (!brasero_bench_iso_write_fd (fd, buffer, bytes)) {
+				fclose (file);
+				goto error;
+			}
+		}
+		fclose (file);
+	}
+
+	if (ftruncate (fd, (off_t) tree->sectors * BRASERO_ISO_BLOCK_SIZE) < 0)
+		goto error;
+
+	return TRUE;
+
+error:
+
+	g_set_error (error,
+		     G_FILE_ERROR,
+		     G_FILE_ERROR_FAILED,
+		     "the image could not be written (%s)",
+		     g_strerror (errno));
+	return FALSE;
+}
+
+static void
+brasero_bench_iso_expected (GHashTable *expected,
+			    const gchar *path,
+			    const gchar *disc_path)
+{
+	const gchar *name;
+	GDir *dir;
+
+	/* Directories are recorded with a size of -1 */
+	g_hash_table_insert (expected, g_strdup (disc_path), g_strdup ("-1"));
+
+	dir = g_dir_open (path, 0, NULL);
+	if (!dir)
+		return;
+
+	while ((name = g_dir_read_name (dir))) {
+		gchar *child_disc_path;
+		gchar *child_path;
+		struct stat info;
+
+		child_path = g_build_filename (path, name, NULL);
+		child_disc_path = g_build_path (G_DIR_SEPARATOR_S, disc_path, name, NULL);
+
+		if (!g_lstat (child_path, &info)) {
+			if (S_ISDIR (info.st_mode))
+				brasero_bench_iso_expected (expected, child_path, child_disc_path);
+			else
+				g_hash_table_insert (expected,
+						     g_strdup (child_disc_path),
+						     g_strdup_printf ("%" G_GINT64_FORMAT, (gint64) info.st_size));
+		}
+
+		g_free (child_disc_path);
+		g_free (child_path);
+	}
+	g_dir_close (dir);
+}
+
+static gchar *
+brasero_bench_iso_run_isoinfo (const gchar *option,
+			       const gchar *image,
+			       GError **error)
+{
+	gchar *argv [] = { "isoinfo", NULL, "-i", NULL, NULL, NULL };
+	gchar *output = NULL;
+	gint status = 0;
+
+	argv [1] = (gchar *) option;
+	argv [3] = (gchar *) image;
+
+	/* Rock Ridge names are needed for the listing */
+	if (!strcmp (option, "-l"))
+		argv [4] = "-R";
+
+	if (!g_spawn_sync (NULL,
+			   argv,
+			   NULL,
+			   G_SPAWN_SEARCH_PATH|G_SPAWN_STDERR_TO_DEV_NULL,
+			   NULL,
+			   NULL,
+			   &output,
+			   NULL,
+			   &status,
+			   error))
+		return NULL;
+
+	if (status) {
+		g_set_error (error,
+			     G_SPAWN_ERROR,
+			     G_SPAWN_ERROR_FAILED,
+			     "isoinfo %s failed to read the image",
+			     option);
+		g_free (output);
+		return NULL;
+	}
+
+	return output;
+}
+
+static gboolean
+brasero_bench_iso_check_descriptor (BraseroIsoTree *tree,
+				    const gchar *image,
+				    GError **error)
+{
+	gboolean volume_id = FALSE;
+	gboolean volume_size = FALSE;
+	gchar *output;
+	gchar **lines;
+	guint i;
+
+	output = brasero_bench_iso_run_isoinfo ("-d", image, error);
+	if (!output)
+		return FALSE;
+
+	lines = g_strsplit (output, "\n", -1);
+	g_free (output);
+
+	for (i = 0; lines [i]; i ++) {
+		if (g_str_has_prefix (lines [i], "Volume id: "))
+			volume_id = !strcmp (g_strstrip (lines [i] + strlen ("Volume id: ")), tree->volume_id);
+		else if (g_str_has_prefix (lines [i], "Volume size is: "))
+			volume_size = (g_ascii_strtoull (lines [i] + strlen ("Volume size is: "), NULL, 10) == tree->sectors);
+	}
+	g_strfreev (lines);
+
+	if (!volume_id || !volume_size) {
+		g_set_error (error,
+			     G_FILE_ERROR,
+			     G_FILE_ERROR_FAILED,
+			     "the primary volume descriptor does not match (%s)",
+			     volume_id ? "volume size" : "volume id");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gchar *
+brasero_bench_iso_listing_size (const gchar *line)
+{
+	gchar **fields;
+	gchar *size = NULL;
+	guint field = 0;
+	guint i;
+
+	/* The size is the fifth field after mode, links, uid and gid */
+	fields = g_strsplit (line, " ", -1);
+	for (i = 0; fields [i]; i ++) {
+		if (!fields [i][0])
+			continue;
+
+		if (++ field == 5) {
+			size = g_strdup (fields [i]);
+			break;
+		}
+	}
+	g_strfreev (fields);
+
+	return size;
+}
+
+static gboolean
+brasero_bench_iso_check_listing (GHashTable *expected,
+				 const gchar *image,
+				 GError **error)
+{
+	gchar *directory = NULL;
+	gchar *output;
+	gchar **lines;
+	guint i;
+
+	output = brasero_bench_iso_run_isoinfo ("-l", image, error);
+	if (!output)
+		return FALSE;
+
+	lines = g_strsplit (output, "\n", -1);
+	g_free (output);
+
+	for (i = 0; lines [i]; i ++) {
+		const gchar *name;
+		gchar *disc_path;
+		gchar *size;
+		gchar *found;
+
+		if (g_str_has_prefix (lines [i], "Directory listing of ")) {
+			g_free (directory);
+			directory = g_strdup (lines [i] + strlen ("Directory listing of "));
+			continue;
+		}
+
+		/* Entries look like:
+		 * -r--r--r--   1    0    0       4096 Jan  1 2010 [    30 00]  name */
+		name = strstr (lines [i], "]  ");
+		if (!name || !directory)
+			continue;
+
+		name += 3;
+		if (!strcmp (name, ".") || !strcmp (name, ".."))
+			continue;
+
+		if (lines [i][0] == 'd')
+			size = g_strdup ("-1");
+		else
+			size = brasero_bench_iso_listing_size (lines [i]);
+
+		disc_path = g_strconcat (directory, name, NULL);
+		found = g_hash_table_lookup (expected, disc_path);
+		if (!found || !size || strcmp (found, size)) {
+			g_set_error (error,
+				     G_FILE_ERROR,
+				     G_FILE_ERROR_FAILED,
+				     found ? "%s has the wrong size or type":"%s is not in the tree",
+				     disc_path);
+			g_free (disc_path);
+			g_free (size);
+			g_free (directory);
+			g_strfreev (lines);
+			return FALSE;
+		}
+
+		g_hash_table_remove (expected, disc_path);
+		g_free (disc_path);
+		g_free (size);
+	}
+
+	g_free (directory);
+	g_strfreev (lines);
+
+	if (g_hash_table_size (expected)) {
+		g_set_error (error,
+			     G_FILE_ERROR,
+			     G_FILE_ERROR_FAILED,
+			     "%u files are missing from the image",
+			     g_hash_table_size (expected));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+brasero_bench_check_iso (BraseroBenchContext *ctx,
+			 GError **error)
+{
+	BraseroIsoTree *tree;
+	GHashTable *expected;
+	gboolean result;
+	gchar *path;
+	int fd;
+
+	path = g_find_program_in_path ("isoinfo");
+	if (!path) {
+		g_set_error (error,
+			     G_SPAWN_ERROR,
+			     G_SPAWN_ERROR_NOENT,
+			     "isoinfo is needed to read the image back");
+		return FALSE;
+	}
+	g_free (path);
+
+	fd = g_file_open_tmp ("brasero-bench-XXXXXX.iso", &path, error);
+	if (fd < 0)
+		return FALSE;
+
+	tree = brasero_iso_tree_new ("BENCH", "Brasero", "Brasero", TRUE);
+	result = brasero_iso_tree_add_graft (tree, "/bench", ctx->tree->root, error);
+	if (result) {
+		brasero_iso_tree_layout (tree);
+		result = brasero_bench_iso_write_image (tree, fd, error);
+	}
+	close (fd);
+
+	if (result)
+		result = brasero_bench_iso_check_descriptor (tree, path, error);
+
+	if (result) {
+		expected = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+		brasero_bench_iso_expected (expected, ctx->tree->root, "/bench");
+		result = brasero_bench_iso_check_listing (expected, path, error);
+		g_hash_table_destroy (expected);
+	}
+
+	brasero_iso_tree_free (tree);
+	g_remove (path);
+	g_free (path);
+
+	return result;
+}
+
+static const BraseroBenchSuite bench_suites [] = {
+	{ "data-project",	brasero_bench_data_project,	brasero_bench_items_files,	FALSE },
+	{ "grafts",		brasero_bench_grafts,		brasero_bench_items_files,	FALSE },
+	{ "span",		brasero_bench_span,		brasero_bench_items_files,	FALSE },
+	{ "caps",		brasero_bench_caps,		NULL,				FALSE },
+	{ "checksum-sha256",	brasero_bench_checksum_sha256,	brasero_bench_items_bytes,	FALSE },
+	{ "checksum-tree",	brasero_bench_checksum_tree,	brasero_bench_items_bytes,	FALSE },
+	{ "iso-layout",		brasero_bench_iso_layout,	brasero_bench_items_files,	FALSE },
+	{ "burn-iso",		brasero_bench_burn_iso,		brasero_bench_items_bytes,	TRUE },
+	{ NULL }
+};
+
+static void
+brasero_bench_run_suite (BraseroBenchContext *ctx,
+			 BraseroBenchReport *report,
+			 const BraseroBenchSuite *suite)
+{
+	BraseroBenchResult *result;
+	GError *error = NULL;
+	gint i;
+
+	result = brasero_bench_report_add_result (report,
+						  suite->name,
+						  suite->items ? suite->items (ctx) : BRASERO_BENCH_CAPS_LOOPS);
+
+	if (suite->needs_image_file && !image_file) {
+		brasero_bench_result_skip (result, "needs --image-file");
+		return;
+	}
+
+	if (!ctx->file_drive && (suite->needs_image_file || suite->func == brasero_bench_caps)) {
+		brasero_bench_result_skip (result, "no file drive");
+		return;
+	}
+
+	/* The first run warms up caches and is not recorded */
+	for (i = -1; i < runs; i ++) {
+		gint64 elapsed;
+
+		elapsed = suite->func (ctx, &error);
+		if (elapsed < 0) {
+			brasero_bench_result_skip (result, error ? error->message : "failed");
+			g_clear_error (&error);
+			return;
+		}
+
+		if (i >= 0)
+			brasero_bench_result_add_run (result, elapsed);
+	}
+}
+
+static gboolean
+brasero_bench_suite_selected (const gchar *name)
+{
+	gchar **names;
+	gboolean found;
+	guint i;
+
+	if (!suites)
+		return TRUE;
+
+	found = FALSE;
+	names = g_strsplit (suites, ",", -1);
+	for (i = 0; names [i]; i ++) {
+		if (!strcmp (g_strstrip (names [i]), name)) {
+			found = TRUE;
+			break;
+		}
+	}
+	g_strfreev (names);
+
+	return found;
+}
+
+static BraseroDrive *
+brasero_bench_get_file_drive (void)
+{
+	BraseroMediumMonitor *monitor;
+	BraseroDrive *drive = NULL;
+	GSList *list;
+
+	/* Wait for the libbrasero-media to be ready */
+	monitor = brasero_medium_monitor_get_default ();
+	while (brasero_medium_monitor_is_probing (monitor))
+		sleep (1);
+
+	list = brasero_medium_monitor_get_drives (monitor, BRASERO_DRIVE_TYPE_FILE);
+	if (list) {
+		drive = list->data;
+		g_slist_foreach (list->next, (GFunc) g_object_unref, NULL);
+		g_slist_free (list);
+	}
+
+	g_object_unref (monitor);
+	return drive;
+}
+
+int
+main (int argc, char **argv)
+{
+	BraseroDataProjectMemoryStats memory;
+	BraseroBenchTreeParams params = { 0, };
+	BraseroBenchContext ctx = { NULL, };
+	BraseroBenchReport *report;
+	GOptionContext *context;
+	GError *error = NULL;
+	gint status = 0;
+	guint i;
+
+	context = g_option_context_new ("- benchmark libbrasero-burn");
+	g_option_context_add_main_entries (context, options, NULL);
+	if (!g_option_context_parse (context, &argc, &argv, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		g_option_context_free (context);
+		return 1;
+	}
+	g_option_context_free (context);
+
+	if (!brasero_burn_library_start (&argc, &argv)) {
+		g_printerr ("libbrasero-burn could not be initialized\n");
+		return 1;
+	}
+
+	params.files = MAX (files, 0);
+	params.depth = MAX (depth, 0);
+	params.fanout = MAX (fanout, 0);
+	params.name_length = MAX (name_length, 1);
+	params.joliet_unsafe = CLAMP (joliet_unsafe, 0.0, 1.0);
+	params.file_size = MAX (file_size, 0);
+	params.seed = seed;
+	runs = MAX (runs, 1);
+
+	ctx.tree = brasero_bench_tree_generate (&params, &error);
+	if (!ctx.tree) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+		brasero_burn_library_stop ();
+		return 1;
+	}
+	ctx.uri = g_filename_to_uri (ctx.tree->root, NULL, NULL);
+
+	report = brasero_bench_report_new ();
+	brasero_bench_report_set_param (report, "files", "%u", ctx.tree->files);
+	brasero_bench_report_set_param (report, "directories", "%u", ctx.tree->directories);
+	brasero_bench_report_set_param (report, "bytes", "%" G_GINT64_FORMAT, ctx.tree->bytes);
+	brasero_bench_report_set_param (report, "joliet-unsafe", "%u", ctx.tree->joliet_unsafe);
+	brasero_bench_report_set_param (report, "depth", "%u", params.depth);
+	brasero_bench_report_set_param (report, "fanout", "%u", params.fanout);
+	brasero_bench_report_set_param (report, "name-length", "%u", params.name_length);
+	brasero_bench_report_set_param (report, "seed", "%u", params.seed);
+	brasero_bench_report_set_param (report, "runs", "%i", runs);
+	brasero_bench_report_set_param (report, "cpus", "%li", sysconf (_SC_NPROCESSORS_ONLN));
+
+	if (check_iso) {
+		if (brasero_bench_check_iso (&ctx, &error))
+			g_print ("%-24s passed\n", "iso-round-trip");
+		else {
+			g_print ("%-24s FAILED (%s)\n", "iso-round-trip", error->message);
+			g_clear_error (&error);
+			status = 1;
+		}
+	}
+
+	ctx.file_drive = brasero_bench_get_file_drive ();
+
+	ctx.project = brasero_bench_load_project (&ctx);
+	brasero_data_project_get_memory_stats (ctx.project, &memory);
+	brasero_bench_report_set_param (report, "nodes", "%u", memory.nodes);
+	brasero_bench_report_set_param (report, "node-bytes", "%" G_GSIZE_FORMAT, memory.node_bytes);
+	brasero_bench_report_set_param (report, "graft-bytes", "%" G_GSIZE_FORMAT, memory.graft_bytes);
+
+	ctx.track = brasero_track_data_cfg_new ();
+	brasero_track_data_cfg_add (ctx.track, ctx.uri, NULL);
+	brasero_bench_wait_for_track (ctx.track);
+
+	for (i = 0; bench_suites [i].name; i ++) {
+		if (!brasero_bench_suite_selected (bench_suites [i].name))
+			continue;
+
+		brasero_bench_run_suite (&ctx, report, bench_suites + i);
+	}
+
+	brasero_bench_report_print (report);
+	if (output && !brasero_bench_report_save (report, output, &error)) {
+		g_printerr ("%s\n", error->message);
+		g_error_free (error);
+	}
+
+	brasero_bench_report_free (report);
+
+	g_object_unref (ctx.track);
+	g_object_unref (ctx.project);
+	if (ctx.file_drive)
+		g_object_unref (ctx.file_drive);
+
+	if (keep)
+		g_print ("Tree kept in %s\n", ctx.tree->root);
+
+	brasero_bench_tree_free (ctx.tree, !keep);
+	g_free (ctx.uri);
+
+	brasero_burn_library_stop ();
+	return status;
+}
@@ -53,6 +53,7 @@
 #include "burn-dbus.h"
 #include "burn-task-ctx.h"
 #include "burn-task.h"
+#include "burn-buffer-history.h"
 #include "brasero-caps-burn.h"
 
 #include "brasero-drive-priv.h"
@@ -1219,6 +1220,66 @@ brasero_burn_status (BraseroBurn *burn,
 	return BRASERO_BURN_OK;
 }
 
+/**
+ * brasero_burn_buffer_status:
+ * @burn: a #BraseroBurn
+ * @fifo: a #gint or NULL
+ * @buffer: a #gint or NULL
+ * @underrun_risk: a #gboolean or NULL
+ *
+ * Returns the filling (in percent) of the FIFO of the recording
+ * backend in @fifo and of the buffer of the drive in @buffer, or -1
+ * when the backend does not report them.
+ * @underrun_risk is set to TRUE when the buffers were close to running
+ * empty while writing, either during this burn or during the previous
+ * ones with the same drive.
+ *
+ * Return value: a #BraseroBurnResult. BRASERO_BURN_OK if the levels are
+ * known; BRASERO_BURN_NOT_READY otherwise.
+ **/
+
+BraseroBurnResult
+brasero_burn_buffer_status (BraseroBurn *burn,
+			    gint *fifo,
+			    gint *buffer,
+			    gboolean *underrun_risk)
+{
+	BraseroBurnPrivate *priv;
+	BraseroBurnResult result;
+	gint fifo_local = -1;
+	gint buffer_local = -1;
+	gint fifo_low = -1;
+	gint buffer_low = -1;
+
+	g_return_val_if_fail (BRASERO_BURN (burn), BRASERO_BURN_ERR);
+
+	priv = BRASERO_BURN_PRIVATE (burn);
+
+	result = BRASERO_BURN_NOT_READY;
+	if (priv->task && brasero_task_is_running (priv->task)
+	&&  brasero_task_ctx_get_buffer_levels (BRASERO_TASK_CTX (priv->task),
+						&fifo_local,
+						&buffer_local,
+						&fifo_low,
+						&buffer_low) == BRASERO_BURN_OK)
+		result = BRASERO_BURN_OK;
+
+	if (fifo)
+		*fifo = fifo_local;
+	if (buffer)
+		*buffer = buffer_local;
+
+	if (underrun_risk) {
+		*underrun_risk = (fifo_low >= 0 && fifo_low < BRASERO_BUFFER_HISTORY_LOW_LEVEL)
+			      || (buffer_low >= 0 && buffer_low < BRASERO_BUFFER_HISTORY_LOW_LEVEL);
+
+		if (!(*underrun_risk) && priv->session)
+			*underrun_risk = brasero_buffer_history_get_underrun_risk (brasero_burn_session_get_burner (priv->session));
+	}
+
+	return result;
+}
+
 static BraseroBurnResult
 brasero_burn_ask_for_joliet (BraseroBurn *burn)
 {
@@ -2368,6 +2429,7 @@ brasero_burn_record_session (BraseroBurn *burn,
 {
 	gboolean dummy_session = FALSE;
 	const gchar *checksum = NULL;
+	const gchar *tree = NULL;
 	BraseroTrack *track = NULL;
 	BraseroChecksumType type;
 	BraseroBurnPrivate *priv;
@@ -2447,9 +2509,13 @@ brasero_burn_record_session (BraseroBurn *burn,
 
 	track = tracks->data;
 	type = brasero_track_get_checksum_type (track);
+	if (type == BRASERO_CHECKSUM_SHA256_TREE)
+		tree = brasero_track_tag_lookup_string (track, BRASERO_TRACK_CHECKSUM_TREE_TAG);
+
 	if (type == BRASERO_CHECKSUM_MD5
 	||  type == BRASERO_CHECKSUM_SHA1
-	||  type == BRASERO_CHECKSUM_SHA256)
+	||  type == BRASERO_CHECKSUM_SHA256
+	||  type == BRASERO_CHECKSUM_SHA256_TREE)
 		checksum = brasero_track_get_checksum (track);
 	else if (type == BRASERO_CHECKSUM_MD5_FILE)
 		checksum = BRASERO_MD5_FILE;
@@ -2473,6 +2539,10 @@ brasero_burn_record_session (BraseroBurn *burn,
 	                            type,
 	                            checksum);
 
+	/* The block checksums may no longer be in the cache */
+	if (tree)
+		brasero_track_tag_add_string (track, BRASERO_TRACK_CHECKSUM_TREE_TAG, tree);
+
 	brasero_track_disc_set_drive (BRASERO_TRACK_DISC (track), brasero_burn_session_get_burner (priv->session));
 	brasero_burn_session_add_track (priv->session, track, NULL);
 
@@ -2499,7 +2569,8 @@ brasero_burn_record_session (BraseroBurn *burn,
 	 */
 	if (type == BRASERO_CHECKSUM_MD5
 	||  type == BRASERO_CHECKSUM_SHA1
-	||  type == BRASERO_CHECKSUM_SHA256) {
+	||  type == BRASERO_CHECKSUM_SHA256
+	||  type == BRASERO_CHECKSUM_SHA256_TREE) {
 		GValue *value;
 
 		/* get the last written track address */
@@ -2544,6 +2615,10 @@ brasero_burn_record_session (BraseroBurn *burn,
  * set in @session. The medium must be inserted in the #BraseroDrive
  * set as the source of a #BraseroTrackDisc track inserted in @session.
  *
+ * If the checksum type of the track is %BRASERO_CHECKSUM_SHA256_TREE_SAMPLED
+ * only some ranges of the medium are read (see the
+ * BRASERO_TRACK_MEDIUM_CHECKSUM_*_TAG tags).
+ *
  * Return value: a #BraseroBurnResult. The result of the operation. 
  * BRASERO_BURN_OK if it was successful.
  **/
@@ -2812,6 +2887,9 @@ brasero_burn_record (BraseroBurn *burn,
 
 		if (result != BRASERO_BURN_OK)
 			goto end;
+
+		if (brasero_buffer_history_get_underrun_risk (brasero_burn_session_get_burner (session)))
+			BRASERO_BURN_LOG ("Buffers almost ran empty during the last burn with this drive");
 	}
 
 	type = brasero_track_type_new ();
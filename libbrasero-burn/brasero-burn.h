@@ -121,6 +121,12 @@ brasero_burn_status (BraseroBurn *burn,
 		     goffset *written,
 		     guint64 *rate);
 
+BraseroBurnResult
+brasero_burn_buffer_status (BraseroBurn *burn,
+			    gint *fifo,
+			    gint *buffer,
+			    gboolean *underrun_risk);
+
 void
 brasero_burn_get_action_string (BraseroBurn *burn,
 				BraseroBurnAction action,
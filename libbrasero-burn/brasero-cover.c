@@ -212,25 +212,21 @@ brasero_jacket_edit_set_audio_tracks_front (BraseroJacketView *front,
 	}
 }
 
-GtkWidget *
-brasero_session_edit_cover (BraseroBurnSession *session,
-			    GtkWidget *toplevel)
+static void
+brasero_session_fill_cover (BraseroBurnSession *session,
+			    BraseroJacketEdit *contents)
 {
-	BraseroJacketEdit *contents;
 	BraseroTrackType *type;
 	GValue *cover_value;
 	const gchar *title;
-	GtkWidget *edit;
 	GSList *tracks;
 
-	edit = brasero_jacket_edit_dialog_new (GTK_WIDGET (toplevel), &contents);
-
 	/* Don't go any further if it's not video */
 	type = brasero_track_type_new ();
 	brasero_burn_session_get_input_type (session, type);
 	if (!brasero_track_type_get_has_stream (type)) {
 		brasero_track_type_free (type);
-		return edit;
+		return;
 	}
 
 	brasero_track_type_free (type);
@@ -249,6 +245,58 @@ brasero_session_edit_cover (BraseroBurnSession *session,
 						    title);
 	brasero_jacket_edit_set_audio_tracks_back (brasero_jacket_edit_get_back (contents), title, tracks);
 	brasero_jacket_edit_thaw (contents);
+}
+
+GtkWidget *
+brasero_session_edit_cover (BraseroBurnSession *session,
+			    GtkWidget *toplevel)
+{
+	BraseroJacketEdit *contents;
+	GtkWidget *edit;
 
+	edit = brasero_jacket_edit_dialog_new (GTK_WIDGET (toplevel), &contents);
+	brasero_session_fill_cover (session, contents);
 	return edit;
 }
+
+/**
+ * brasero_session_render_covers:
+ * @sessions: a #GSList of #BraseroBurnSession
+ * @path: the PDF or PNG file to write to
+ * @error: a #GError
+ *
+ * Renders the default cover of each session in @sessions without showing
+ * any editor; see brasero_jacket_edit_render_to_file () for the output.
+ *
+ * Return value: a #gboolean. TRUE on success.
+ **/
+gboolean
+brasero_session_render_covers (GSList *sessions,
+			       const gchar *path,
+			       GError **error)
+{
+	GSList *windows = NULL;
+	GSList *jackets = NULL;
+	gboolean result;
+	GSList *iter;
+
+	for (iter = sessions; iter; iter = iter->next) {
+		BraseroJacketEdit *contents;
+		GtkWidget *window;
+
+		window = brasero_jacket_edit_offscreen_new (&contents);
+		brasero_session_fill_cover (iter->data, contents);
+
+		windows = g_slist_prepend (windows, window);
+		jackets = g_slist_prepend (jackets, contents);
+	}
+
+	jackets = g_slist_reverse (jackets);
+	result = brasero_jacket_edit_render_to_file (jackets, path, error);
+	g_slist_free (jackets);
+
+	g_slist_foreach (windows, (GFunc) gtk_widget_destroy, NULL);
+	g_slist_free (windows);
+
+	return result;
+}
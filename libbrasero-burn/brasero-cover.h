@@ -40,6 +40,11 @@ GtkWidget *
 brasero_session_edit_cover (BraseroBurnSession *session,
 			    GtkWidget *toplevel);
 
+gboolean
+brasero_session_render_covers (GSList *sessions,
+			       const gchar *path,
+			       GError **error);
+
 G_END_DECLS
 
 #endif
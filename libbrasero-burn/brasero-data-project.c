@@ -85,7 +85,12 @@ struct _BraseroDataProjectPrivate
 	/* This is a counter for the number of files to be loaded */
 	guint loading;
 
+	/* Used to emit size_changed only once for changes reported together
+	 * by the file monitor */
+	guint changes;
+
 	guint is_loading_contents:1;
+	guint size_changed:1;
 };
 
 #define BRASERO_DATA_PROJECT_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_DATA_PROJECT, BraseroDataProjectPrivate))
@@ -121,6 +126,22 @@ static guint brasero_data_project_signals [LAST_SIGNAL] = {0};
  */
 static const gchar NEW_FOLDER [] = "NewFolder";
 
+static void
+brasero_data_project_size_changed (BraseroDataProject *self)
+{
+	BraseroDataProjectPrivate *priv;
+
+	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
+	if (priv->changes) {
+		priv->size_changed = TRUE;
+		return;
+	}
+
+	g_signal_emit (self,
+		       brasero_data_project_signals [SIZE_CHANGED_SIGNAL],
+		       0);
+}
+
 
 typedef gboolean	(*BraseroDataNodeAddedFunc)	(BraseroDataProject *project,
 							 BraseroFileNode *node,
@@ -401,6 +422,7 @@ brasero_data_project_joliet_add_node (BraseroDataProject *self,
 				      BraseroFileNode *node)
 {
 	BraseroDataProjectPrivate *priv;
+	BraseroFileTreeStats *stats;
 	BraseroJolietKey key;
 	GSList *list;
 
@@ -409,6 +431,9 @@ brasero_data_project_joliet_add_node (BraseroDataProject *self,
 
 	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
 
+	stats = brasero_file_node_get_tree_stats (priv->root, NULL);
+	stats->num_joliet ++;
+
 	if (!priv->joliet)
 		priv->joliet = g_hash_table_new (brasero_data_project_joliet_hash,
 						 brasero_data_project_joliet_equal);
@@ -443,6 +468,7 @@ brasero_data_project_joliet_remove_node (BraseroDataProject *self,
 					 BraseroFileNode *node)
 {
 	BraseroDataProjectPrivate *priv;
+	BraseroFileTreeStats *stats;
 	BraseroJolietKey key;
 	gpointer hash_key;
 	gboolean success;
@@ -453,6 +479,11 @@ brasero_data_project_joliet_remove_node (BraseroDataProject *self,
 
 	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
 
+	/* Nothing to look for */
+	stats = brasero_file_node_get_tree_stats (priv->root, NULL);
+	if (!stats->num_joliet)
+		return FALSE;
+
 	brasero_data_project_joliet_set_key (&key, node);
 	success = g_hash_table_lookup_extended (priv->joliet,
 						&key,
@@ -463,6 +494,11 @@ brasero_data_project_joliet_remove_node (BraseroDataProject *self,
 	if (!success)
 		return FALSE;
 
+	/* The node may not be in the list even if its key is */
+	if (!g_slist_find (list, node))
+		return FALSE;
+
+	stats->num_joliet --;
 	list = g_slist_remove (list, node);
 	if (!list) {
 		/* NOTE: we don't free the hash table now if it's empty,
@@ -480,17 +516,25 @@ brasero_data_project_joliet_remove_node (BraseroDataProject *self,
 	return TRUE;
 }
 
+struct _BraseroJolietRemoveData {
+	BraseroFileNode *parent;
+	BraseroFileTreeStats *stats;
+};
+typedef struct _BraseroJolietRemoveData BraseroJolietRemoveData;
+
 static gboolean
 brasero_data_project_joliet_remove_children_node_cb (gpointer data_key,
 						     gpointer data,
 						     gpointer callback_data)
 {
-	BraseroFileNode *parent = callback_data;
+	BraseroJolietRemoveData *remove_data = callback_data;
 	BraseroJolietKey *key = data_key;
 	GSList *nodes = data;
 
-	if (brasero_file_node_is_ancestor (parent, key->parent) || parent == key->parent) {
+	if (brasero_file_node_is_ancestor (remove_data->parent, key->parent) || remove_data->parent == key->parent) {
+		remove_data->stats->num_joliet -= g_slist_length (nodes);
 		g_slist_free (nodes);
+		g_free (key);
 		return TRUE;
 	}
 
@@ -502,15 +546,36 @@ brasero_data_project_joliet_remove_children_node (BraseroDataProject *self,
 						  BraseroFileNode *parent)
 {
 	BraseroDataProjectPrivate *priv;
+	BraseroJolietRemoveData callback_data;
 
 	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
 
+	/* Avoid a walk through the whole table when there is nothing in it */
+	callback_data.stats = brasero_file_node_get_tree_stats (priv->root, NULL);
+	if (!callback_data.stats->num_joliet)
+		return;
+
 	if (!parent)
 		parent = priv->root;
 
+	callback_data.parent = parent;
 	g_hash_table_foreach_remove (priv->joliet,
 				     brasero_data_project_joliet_remove_children_node_cb,
-				     parent);
+				     &callback_data);
+}
+
+static BraseroFileNode *
+brasero_data_project_get_top_node (BraseroDataProject *self,
+				   BraseroFileNode *node)
+{
+	BraseroDataProjectPrivate *priv;
+
+	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
+
+	while (node && node->parent && node->parent != priv->root)
+		node = node->parent;
+
+	return node;
 }
 
 /**
@@ -949,7 +1014,7 @@ brasero_data_project_uri_remove_graft (BraseroDataProject *self,
 	if (graft) {
 		/* NOTE: no need to free graft->uri since that's the key */
 		g_slist_free (graft->nodes);
-		g_free (graft);
+		g_slice_free (BraseroURINode, graft);
 	}
 }
 
@@ -982,7 +1047,7 @@ brasero_data_project_uri_add_graft (BraseroDataProject *self,
 
 	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
 
-	graft = g_new0 (BraseroURINode, 1);
+	graft = g_slice_new0 (BraseroURINode);
 	if (uri != NEW_FOLDER)
 		graft->uri = brasero_utils_register_string (uri);
 	else
@@ -1236,9 +1301,7 @@ brasero_data_project_remove_real (BraseroDataProject *self,
 						 former_parent,
 						 priv->sort_func);
 
-	g_signal_emit (self,
-		       brasero_data_project_signals [SIZE_CHANGED_SIGNAL],
-		       0);
+	brasero_data_project_size_changed (self);
 }
 
 static void
@@ -1336,9 +1399,7 @@ brasero_data_project_destroy_node (BraseroDataProject *self,
 	stats = brasero_file_node_get_tree_stats (priv->root, NULL);
 	brasero_file_node_destroy (node, stats);
 
-	g_signal_emit (self,
-		       brasero_data_project_signals [SIZE_CHANGED_SIGNAL],
-		       0);
+	brasero_data_project_size_changed (self);
 
 	/* NOTE: no need to check for imported_sibling here since this function
 	 * actually destroys all nodes including imported ones and is mainly 
@@ -1652,6 +1713,69 @@ brasero_data_project_rename_node (BraseroDataProject *self,
 	return TRUE;
 }
 
+/**
+ * Returns TRUE if @node was not put under its rightful parent from the
+ * original file system (whose URI is @parent_uri) and therefore needs a graft.
+ */
+static gboolean
+brasero_data_project_node_is_misplaced (BraseroFileNode *node,
+					const gchar *parent_uri,
+					const gchar *uri)
+{
+	gboolean misplaced;
+	gchar *name_uri;
+	guint parent_len;
+
+	/* its father is probably an fake empty directory */
+	if (!parent_uri)
+		return TRUE;
+
+	name_uri = g_path_get_basename (uri);
+
+	parent_len = strlen (parent_uri);
+	misplaced = (strncmp (parent_uri, uri, parent_len)
+		 ||  uri [parent_len] != G_DIR_SEPARATOR
+		 || !name_uri
+		 || !BRASERO_FILE_NODE_NAME (node)
+		 ||  strcmp (name_uri, BRASERO_FILE_NODE_NAME (node)));
+
+	/* NOTE: we don't need to check if the nodes's name
+	 * is the same as the one of the URI. This function is
+	 * used by two other functions that pass the URI name
+	 * as name to the info so that should always be fine. */
+
+	/* NOTE: for ungrafted nodes the parent graft size is
+	 * updated when setting info on node. */
+	g_free (name_uri);
+	return misplaced;
+}
+
+static gboolean
+brasero_data_project_add_node_notify (BraseroDataProject *self,
+				      BraseroFileNode *node,
+				      const gchar *uri)
+{
+	BraseroDataProjectPrivate *priv;
+
+	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
+
+	if (!priv->is_loading_contents) {
+		BraseroDataProjectClass *klass;
+
+		/* Signal that something has changed in the tree */
+		klass = BRASERO_DATA_PROJECT_GET_CLASS (self);
+		if (klass->node_added
+		&& !klass->node_added (self, node, uri != NEW_FOLDER? uri:NULL))
+			return FALSE;
+	}
+
+	/* check joliet compatibility; do it after node was created. */
+	if (strlen (BRASERO_FILE_NODE_NAME (node)) > 64)
+		brasero_data_project_joliet_add_node (self, node);
+
+	return TRUE;
+}
+
 static gboolean
 brasero_data_project_add_node_real (BraseroDataProject *self,
 				    BraseroFileNode *node,
@@ -1683,62 +1807,20 @@ brasero_data_project_add_node_real (BraseroDataProject *self,
 	}
 	else {
 		gchar *parent_uri;
-		gchar *name_uri;
-
-		parent_uri = brasero_data_project_node_to_uri (self, node->parent);
-		name_uri = g_path_get_basename (uri);
 
 		/* NOTE: in here use a special function here since that node 
 		 * could already be in the tree but under its rightful parent
 		 * and then it won't have any graft yet. That's why these nodes
 		 * need to be grafted as well. */ 
-		if (parent_uri) {
-			guint parent_len;
-
-			parent_len = strlen (parent_uri);
-			if (strncmp (parent_uri, uri, parent_len)
-			||  uri [parent_len] != G_DIR_SEPARATOR
-			|| !name_uri
-			|| !BRASERO_FILE_NODE_NAME (node)
-			||  strcmp (name_uri, BRASERO_FILE_NODE_NAME (node))) {
-				/* The node hasn't been put under its rightful
-				 * parent from the original file system. That
-				 * means we must add a graft */
-				graft = brasero_data_project_uri_graft_nodes (self, uri);
-				brasero_file_node_graft (node, graft);
-			}
-			/* NOTE: we don't need to check if the nodes's name
-			 * is the same as the one of the URI. This function is
-			 * used by two other functions that pass the URI name
-			 * as name to the info so that should always be fine. */
-
-			 /* NOTE: for ungrafted nodes the parent graft size is
-			 * updated when setting info on node. */
-			g_free (parent_uri);
-		}
-		else {
-			/* its father is probably an fake empty directory */
+		parent_uri = brasero_data_project_node_to_uri (self, node->parent);
+		if (brasero_data_project_node_is_misplaced (node, parent_uri, uri)) {
 			graft = brasero_data_project_uri_graft_nodes (self, uri);
 			brasero_file_node_graft (node, graft);
 		}
-		g_free (name_uri);
-	}
-
-	if (!priv->is_loading_contents) {
-		BraseroDataProjectClass *klass;
-
-		/* Signal that something has changed in the tree */
-		klass = BRASERO_DATA_PROJECT_GET_CLASS (self);
-		if (klass->node_added
-		&& !klass->node_added (self, node, uri != NEW_FOLDER? uri:NULL))
-			return FALSE;
+		g_free (parent_uri);
 	}
 
-	/* check joliet compatibility; do it after node was created. */
-	if (strlen (BRASERO_FILE_NODE_NAME (node)) > 64)
-		brasero_data_project_joliet_add_node (self, node);
-
-	return TRUE;
+	return brasero_data_project_add_node_notify (self, node, uri);
 }
 
 void
@@ -1803,6 +1885,19 @@ brasero_data_project_exclude_uri (BraseroDataProject *self,
 	}
 }
 
+gboolean
+brasero_data_project_uri_has_graft (BraseroDataProject *self,
+				    const gchar *uri)
+{
+	BraseroDataProjectPrivate *priv;
+
+	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
+
+	/* This is TRUE for URIs that are either grafted somewhere in the tree
+	 * or excluded. Either way a directory exploration must not add them. */
+	return (g_hash_table_lookup (priv->grafts, uri) != NULL);
+}
+
 BraseroFileNode *
 brasero_data_project_add_imported_session_file (BraseroDataProject *self,
 						GFileInfo *info,
@@ -2109,9 +2204,7 @@ brasero_data_project_node_loaded (BraseroDataProject *self,
 	/* signal the changes */
 	brasero_data_project_node_changed (self, node);
 	if (size_changed)
-		g_signal_emit (self,
-			       brasero_data_project_signals [SIZE_CHANGED_SIGNAL],
-			       0);
+		brasero_data_project_size_changed (self);
 
 	return TRUE;
 }
@@ -2148,7 +2241,7 @@ brasero_data_project_node_reloaded (BraseroDataProject *self,
 		}
 	}
 
-	size_changed = (BRASERO_BYTES_TO_SECTORS (size, 2048) == BRASERO_FILE_NODE_SECTORS (node));
+	size_changed = (BRASERO_BYTES_TO_SECTORS (size, 2048) != BRASERO_FILE_NODE_SECTORS (node));
 	if (BRASERO_FILE_NODE_MIME (node) && !size_changed)
 		return;
 
@@ -2163,9 +2256,7 @@ brasero_data_project_node_reloaded (BraseroDataProject *self,
 
 	brasero_data_project_node_changed (self, node);
 	if (size_changed)
-		g_signal_emit (self,
-			       brasero_data_project_signals [SIZE_CHANGED_SIGNAL],
-			       0);
+		brasero_data_project_size_changed (self);
 }
 
 static BraseroFileNode *
@@ -2296,6 +2387,34 @@ brasero_data_project_directory_node_loaded (BraseroDataProject *self,
  * anything it can only be with a grafed node.
  */
 
+static void
+brasero_data_project_monitor_node (BraseroDataProject *self,
+				   BraseroFileNode *node,
+				   const gchar *uri)
+{
+	/* at this point we know all we need to know about our node and in 
+	 * particular if it's a file or a directory, if it's grafted or not
+	 * That's why we can start monitoring it. */
+	if (!node->is_monitored) {
+
+#ifdef BUILD_INOTIFY
+
+		if (node->is_grafted)
+			brasero_file_monitor_single_file (BRASERO_FILE_MONITOR (self),
+							  uri,
+							  node);
+
+		if (!node->is_file)
+			brasero_file_monitor_directory_contents (BRASERO_FILE_MONITOR (self),
+								 uri,
+								 node);
+		node->is_monitored = TRUE;
+
+#endif
+
+	}
+}
+
 BraseroFileNode *
 brasero_data_project_add_node_from_info (BraseroDataProject *self,
 					 const gchar *uri,
@@ -2432,33 +2551,145 @@ brasero_data_project_add_node_from_info (BraseroDataProject *self,
 	}
 
 	if (type != G_FILE_TYPE_DIRECTORY)
-		g_signal_emit (self,
-			       brasero_data_project_signals [SIZE_CHANGED_SIGNAL],
-			       0);
+		brasero_data_project_size_changed (self);
 
-	/* at this point we know all we need to know about our node and in 
-	 * particular if it's a file or a directory, if it's grafted or not
-	 * That's why we can start monitoring it. */
-	if (!node->is_monitored) {
+	brasero_data_project_monitor_node (self, node, uri);
+	return node;
+}
 
-#ifdef BUILD_INOTIFY
+/**
+ * Same as brasero_data_project_add_node_from_info () for several children of
+ * @parent at once; @uris and @infos have the same length. The new nodes are
+ * sorted and linked in one pass, tree statistics and sizes are updated once
+ * and "size-changed" is emitted only once. Children that need special care
+ * (grafts, collisions, followed symlinks, signals) are added one by one.
+ * Returns the number of nodes added.
+ */
 
-		if (node->is_grafted)
-			brasero_file_monitor_single_file (BRASERO_FILE_MONITOR (self),
-							  uri,
-							  node);
+guint
+brasero_data_project_add_nodes_from_infos (BraseroDataProject *self,
+					   BraseroFileNode *parent,
+					   GPtrArray *uris,
+					   GPtrArray *infos)
+{
+	BraseroDataProjectPrivate *priv;
+	BraseroFileTreeStats *stats;
+	BraseroFileNode *children;
+	BraseroFileNode *last;
+	BraseroFileNode *next;
+	GHashTable *names;
+	GHashTable *nodes;
+	gboolean size_changed;
+	gchar *parent_uri;
+	guint depth;
+	guint added;
+	guint i;
 
-		if (!node->is_file)
-			brasero_file_monitor_directory_contents (BRASERO_FILE_MONITOR (self),
-								 uri,
-								 node);
-		node->is_monitored = TRUE;
+	g_return_val_if_fail (BRASERO_IS_DATA_PROJECT (self), 0);
+	g_return_val_if_fail (uris->len == infos->len, 0);
 
-#endif
+	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
+
+	if (!parent)
+		parent = priv->root;
 
+	/* Children of the root are all grafted */
+	if (parent->is_root) {
+		added = 0;
+		for (i = 0; i < infos->len; i ++) {
+			if (brasero_data_project_add_node_from_info (self,
+								     g_ptr_array_index (uris, i),
+								     g_ptr_array_index (infos, i),
+								     parent))
+				added ++;
+		}
+		return added;
 	}
 
-	return node;
+	/* Look up the names in use once instead of walking the list of
+	 * children for every new node */
+	names = g_hash_table_new (g_str_hash, g_str_equal);
+	for (children = BRASERO_FILE_NODE_CHILDREN (parent); children; children = children->next)
+		g_hash_table_insert (names, BRASERO_FILE_NODE_NAME (children), children);
+
+	stats = brasero_file_node_get_tree_stats (priv->root, NULL);
+	depth = brasero_file_node_get_depth (parent);
+
+	nodes = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	added = 0;
+	last = NULL;
+	children = NULL;
+	size_changed = FALSE;
+	for (i = 0; i < infos->len; i ++) {
+		BraseroFileNode *node;
+		const gchar *name;
+		GFileInfo *info;
+		GFileType type;
+		gchar *uri;
+
+		uri = g_ptr_array_index (uris, i);
+		info = g_ptr_array_index (infos, i);
+		name = g_file_info_get_name (info);
+		type = g_file_info_get_file_type (info);
+
+		if (g_hash_table_lookup (priv->grafts, uri)
+		||  g_hash_table_lookup (names, name)
+		|| (g_file_info_get_is_symlink (info) && type != G_FILE_TYPE_SYMBOLIC_LINK)
+		|| (type == G_FILE_TYPE_DIRECTORY && depth == 5)
+		|| (type != G_FILE_TYPE_DIRECTORY && BRASERO_BYTES_TO_SECTORS (g_file_info_get_size (info), 2048) > BRASERO_FILE_2G_LIMIT)) {
+			if (brasero_data_project_add_node_from_info (self, uri, info, parent))
+				added ++;
+			continue;
+		}
+
+		node = brasero_file_node_new (name);
+		brasero_file_node_set_from_info (node, stats, info);
+
+		/* Keep the order of arrival for nodes sorted the same */
+		if (last)
+			last->next = node;
+		else
+			children = node;
+		last = node;
+
+		g_hash_table_insert (nodes, node, uri);
+
+		if (type != G_FILE_TYPE_DIRECTORY)
+			size_changed = TRUE;
+	}
+	g_hash_table_destroy (names);
+
+	brasero_file_node_add_children (parent, children, priv->sort_func);
+
+	/* Signal the new nodes in the order they appear */
+	parent_uri = brasero_data_project_node_to_uri (self, parent);
+	for (children = BRASERO_FILE_NODE_CHILDREN (parent); children; children = next) {
+		gchar *uri;
+
+		/* The node could be removed during the process */
+		next = children->next;
+
+		uri = g_hash_table_lookup (nodes, children);
+		if (!uri)
+			continue;
+
+		if (brasero_data_project_node_is_misplaced (children, parent_uri, uri))
+			brasero_file_node_graft (children, brasero_data_project_uri_graft_nodes (self, uri));
+
+		if (!brasero_data_project_add_node_notify (self, children, uri))
+			continue;
+
+		brasero_data_project_monitor_node (self, children, uri);
+		added ++;
+	}
+	g_free (parent_uri);
+	g_hash_table_destroy (nodes);
+
+	if (size_changed)
+		brasero_data_project_size_changed (self);
+
+	return added;
 }
 
 /**
@@ -2471,55 +2702,118 @@ struct _MakeTrackData {
 	GSList *grafts;
 	GSList *excluded;
 
+	/* Last parent whose path was computed */
+	BraseroFileNode *parent;
+	gchar *parent_path;
+
 	BraseroDataProject *project;
 };
 typedef struct _MakeTrackData MakeTrackData;
 
-gchar *
-brasero_data_project_node_to_path (BraseroDataProject *self,
-				   BraseroFileNode *node)
+/**
+ * Builds the path of @node on the disc in a single allocation filled from
+ * the end. If @parent_path (the path of the parent of @node) is known it
+ * is used as a prefix instead of walking up the tree.
+ */
+static gchar *
+brasero_data_project_node_to_disc_path (BraseroFileNode *node,
+					const gchar *parent_path,
+					gboolean append_slash)
 {
-	guint len;
-	GSList *list;
-	GSList *iter;
-	gchar path [MAXPATHLEN] = {0, };
+	BraseroFileNode *iter;
+	gsize prefix_len;
+	gchar *retval;
+	gsize len;
+	gchar *ptr;
 
 	if (!node || G_NODE_IS_ROOT (node))
-		return g_strdup (G_DIR_SEPARATOR_S);
-
-	/* walk the nodes up to the parent and add them to a list */
-	list = NULL;
-	while (node->parent) {
-		list = g_slist_prepend (list, node);
-		node = node->parent;
-	}
-
-	len = 0;
-	for (iter = list; iter; iter = iter->next) {
-		gchar *name;
-		guint name_len;
+		return g_strdup (append_slash ? G_DIR_SEPARATOR_S G_DIR_SEPARATOR_S:G_DIR_SEPARATOR_S);
 
-		node = iter->data;
+	/* Parent path "/" is treated like the root (no prefix) */
+	prefix_len = 0;
+	if (parent_path && parent_path [1] != '\0')
+		prefix_len = strlen (parent_path);
 
-		*(path + len) = G_DIR_SEPARATOR;
-		len ++;
+	len = prefix_len;
+	for (iter = node; iter->parent; iter = iter->parent) {
+		/* the + 1 is for the separator */
+		len += strlen (BRASERO_FILE_NODE_NAME (iter)) + 1;
 
+		/* Make sure path length didn't go over MAXPATHLEN. */
 		if (len > MAXPATHLEN)
 			return NULL;
 
-		/* Make sure path length didn't go over MAXPATHLEN. */
-		name = BRASERO_FILE_NODE_NAME (node);
+		if (parent_path)
+			break;
+	}
+
+	retval = g_new (gchar, len + (append_slash ? 1:0) + 1);
+	ptr = retval + len;
+
+	if (append_slash)
+		*(ptr ++) = G_DIR_SEPARATOR;
+	*ptr = '\0';
 
+	ptr = retval + len;
+	for (iter = node; iter->parent; iter = iter->parent) {
+		const gchar *name;
+		gsize name_len;
+
+		name = BRASERO_FILE_NODE_NAME (iter);
 		name_len = strlen (name);
-		if (len + name_len > MAXPATHLEN)
-			return NULL;
 
-		memcpy (path + len, name, name_len);
-		len += name_len;
+		ptr -= name_len;
+		memcpy (ptr, name, name_len);
+
+		ptr --;
+		*ptr = G_DIR_SEPARATOR;
+
+		if (parent_path)
+			break;
 	}
-	g_slist_free (list);
 
-	return g_strdup (path);
+	if (prefix_len)
+		memcpy (retval, parent_path, prefix_len);
+
+	return retval;
+}
+
+gchar *
+brasero_data_project_node_to_path (BraseroDataProject *self,
+				   BraseroFileNode *node)
+{
+	return brasero_data_project_node_to_disc_path (node, NULL, FALSE);
+}
+
+/**
+ * Siblings are often exported one after the other so the path of their
+ * parent is kept and shared as a prefix.
+ */
+static gchar *
+_make_list_node_path (MakeTrackData *data,
+		      BraseroFileNode *node)
+{
+	gboolean append_slash;
+
+	/* we need to know if that's a directory or not since if it is
+	 * then mkisofs (but not genisoimage) requires the disc path to end
+	 * with '/'; if there isn't '/' at the end then only the directory
+	 * contents are added. */
+	append_slash = (!node->is_file && data->append_slash);
+
+	if (!node->parent)
+		return brasero_data_project_node_to_disc_path (node, NULL, append_slash);
+
+	if (data->parent != node->parent) {
+		g_free (data->parent_path);
+		data->parent = node->parent;
+		data->parent_path = brasero_data_project_node_to_disc_path (node->parent, NULL, FALSE);
+	}
+
+	if (!data->parent_path)
+		return NULL;
+
+	return brasero_data_project_node_to_disc_path (node, data->parent_path, append_slash);
 }
 
 static void
@@ -2546,18 +2840,7 @@ _foreach_grafts_make_list_cb (const gchar *uri,
 		if (uri && uri != NEW_FOLDER)
 			graft->uri = g_strdup (uri);
 
-		graft->path = brasero_data_project_node_to_path (data->project, node);
-		if (!node->is_file && data->append_slash) {
-			gchar *tmp;
-
-			/* we need to know if that's a directory or not since if
-			 * it is then mkisofs (but not genisoimage) requires the
-			 * disc path to end with '/'; if there isn't '/' at the 
-			 * end then only the directory contents are added. */
-			tmp = graft->path;
-			graft->path = g_strconcat (graft->path, "/", NULL);
-			g_free (tmp);
-		}
+		graft->path = _make_list_node_path (data, node);
 
 		data->grafts = g_slist_prepend (data->grafts, graft);
 	}
@@ -2594,18 +2877,7 @@ _foreach_joliet_incompatible_make_list_cb (BraseroJolietKey *key,
 			continue;
 
 		graft = g_new0 (BraseroGraftPt, 1);
-		graft->path = brasero_data_project_node_to_path (data->project, node);
-		if (!node->is_file && data->append_slash) {
-			gchar *tmp;
-
-			/* we need to know if that's a directory or not since if
-			 * it is then mkisofs (but not genisoimage) requires the
-			 * disc path to end with '/'; if there isn't '/' at the 
-			 * end then only the directory contents are added. */
-			tmp = graft->path;
-			graft->path = g_strconcat (graft->path, "/", NULL);
-			g_free (tmp);
-		}
+		graft->path = _make_list_node_path (data, node);
 
 		/* NOTE: here it's not possible to get a created folder here 
 		 * since it would be grafted */
@@ -2637,6 +2909,8 @@ brasero_data_project_get_contents (BraseroDataProject *self,
 	callback_data.excluded = NULL;
 	callback_data.hidden_nodes = hidden_nodes;
 	callback_data.append_slash = append_slash;
+	callback_data.parent = NULL;
+	callback_data.parent_path = NULL;
 
 	g_hash_table_foreach (priv->grafts,
 			      (GHFunc) _foreach_grafts_make_list_cb,
@@ -2647,6 +2921,7 @@ brasero_data_project_get_contents (BraseroDataProject *self,
 	if (!callback_data.grafts) {
 		g_slist_foreach (callback_data.excluded, (GFunc) g_free, NULL);
 		g_slist_free (callback_data.excluded);
+		g_free (callback_data.parent_path);
 		return FALSE;
 	}
 
@@ -2658,6 +2933,8 @@ brasero_data_project_get_contents (BraseroDataProject *self,
 				      &callback_data);
 	}
 
+	g_free (callback_data.parent_path);
+
 	if (!grafts) {
 		g_slist_foreach (callback_data.grafts, (GFunc) brasero_graft_point_free, NULL);
 		g_slist_free (callback_data.grafts);
@@ -2754,18 +3031,7 @@ brasero_data_project_span_generate (BraseroDataProject *self,
 		 * The real joliet compliant path names will be generated later
 		 * either by the backends (like libisofs) or by the library (see
 		 * burn-mkisofs-base.c). So no need to care about that. */
-		graft->path = brasero_data_project_node_to_path (self, node);
-		if (!node->is_file && append_slash) {
-			gchar *tmp;
-
-			/* we need to know if that's a directory or not since if
-			 * it is then mkisofs (but not genisoimage) requires the
-			 * disc path to end with '/'; if there isn't '/' at the 
-			 * end then only the directory contents are added. */
-			tmp = graft->path;
-			graft->path = g_strconcat (graft->path, "/", NULL);
-			g_free (tmp);
-		}
+		graft->path = brasero_data_project_node_to_disc_path (node, NULL, !node->is_file && append_slash);
 		graft->uri = brasero_data_project_node_to_uri (self, node);
 		grafts = g_slist_prepend (grafts, graft);
 	}
@@ -2795,18 +3061,7 @@ brasero_data_project_span_generate (BraseroDataProject *self,
 			 * The real joliet compliant path names will be generated later
 			 * either by the backends (like libisofs) or by the library (see
 			 * burn-mkisofs-base.c). So no need to care about that. */
-			graft->path = brasero_data_project_node_to_path (self, node);
-			if (!node->is_file && append_slash) {
-				gchar *tmp;
-
-				/* we need to know if that's a directory or not since if
-				 * it is then mkisofs (but not genisoimage) requires the
-				 * disc path to end with '/'; if there isn't '/' at the 
-				 * end then only the directory contents are added. */
-				tmp = graft->path;
-				graft->path = g_strconcat (graft->path, "/", NULL);
-				g_free (tmp);
-			}
+			graft->path = brasero_data_project_node_to_disc_path (node, NULL, !node->is_file && append_slash);
 
 			grafts = g_slist_prepend (grafts, graft);
 
@@ -2899,7 +3154,9 @@ brasero_data_project_span (BraseroDataProject *self,
 {
 	MakeTrackDataSpan callback_data;
 	BraseroDataProjectPrivate *priv;
+	BraseroFileTreeStats *stats;
 	BraseroFileNode *children;
+	GHashTable *joliet_top = NULL;
 	goffset total_sectors = 0;
 
 	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
@@ -2916,6 +3173,52 @@ brasero_data_project_span (BraseroDataProject *self,
 	if (joliet)
 		callback_data.fs_type |= BRASERO_IMAGE_FS_JOLIET;
 
+	/* Sort the joliet non compliant nodes by top directory once and for
+	 * all instead of going through the whole table for each of them. */
+	stats = brasero_file_node_get_tree_stats (priv->root, NULL);
+	if (joliet && stats->num_joliet) {
+		GHashTableIter iter;
+		gpointer value_data;
+		gpointer key_data;
+
+		joliet_top = g_hash_table_new_full (g_direct_hash,
+						    g_direct_equal,
+						    NULL,
+						    (GDestroyNotify) g_slist_free);
+
+		g_hash_table_iter_init (&iter, priv->joliet);
+		while (g_hash_table_iter_next (&iter, &key_data, &value_data)) {
+			BraseroFileNode *top;
+			BraseroJolietKey *key;
+			GSList *nodes;
+			GSList *list;
+
+			key = key_data;
+			top = brasero_data_project_get_top_node (self, key->parent);
+
+			/* Nodes directly at the root are top nodes themselves */
+			if (top == priv->root)
+				continue;
+
+			list = g_hash_table_lookup (joliet_top, top);
+			if (list)
+				g_hash_table_steal (joliet_top, top);
+
+			/* skip grafted nodes (they are already or will be
+			 * processed) */
+			for (nodes = value_data; nodes; nodes = nodes->next) {
+				BraseroFileNode *node;
+
+				node = nodes->data;
+				if (!node->is_grafted)
+					list = g_slist_prepend (list, node);
+			}
+
+			if (list)
+				g_hash_table_insert (joliet_top, top, list);
+		}
+	}
+
 	children = BRASERO_FILE_NODE_CHILDREN (priv->root);
 	while (children) {
 		goffset child_sectors;
@@ -2942,39 +3245,12 @@ brasero_data_project_span (BraseroDataProject *self,
 		total_sectors += child_sectors;
 
 		/* Take care of joliet non compliant nodes */
-		if (callback_data.fs_type & BRASERO_IMAGE_FS_JOLIET) {
-			GHashTableIter iter;
-			gpointer value_data;
-			gpointer key_data;
-
-			/* Problem is we don't know whether there are symlinks */
-			g_hash_table_iter_init (&iter, priv->joliet);
-			while (g_hash_table_iter_next (&iter, &key_data, &value_data)) {
-				GSList *nodes;
-				BraseroJolietKey *key;
-
-				/* Is the node a graft a child of a graft */
-				key = key_data;
-				if (key->parent == children || brasero_file_node_is_ancestor (children, key->parent)) {
-					/* Add all the children to the list of
-					 * grafts provided they are not already
-					 * grafted. */
-					for (nodes = value_data; nodes; nodes = nodes->next) {
-						BraseroFileNode *node;
-
-						/* skip grafted nodes (they are
-						 * already or will be processed)
-						 */
-						node = nodes->data;
-						if (node->is_grafted)
-							continue;
-						
-						callback_data.joliet_grafts = g_slist_prepend (callback_data.joliet_grafts, node);
-					}
-
-					break;
-				}
-			}
+		if (joliet_top) {
+			GSList *nodes;
+
+			nodes = g_hash_table_lookup (joliet_top, children);
+			for (; nodes; nodes = nodes->next)
+				callback_data.joliet_grafts = g_slist_prepend (callback_data.joliet_grafts, nodes->data);
 		}
 
 		callback_data.grafts = g_slist_prepend (callback_data.grafts, children);
@@ -2991,6 +3267,9 @@ brasero_data_project_span (BraseroDataProject *self,
 		children = children->next;
 	}
 
+	if (joliet_top)
+		g_hash_table_destroy (joliet_top);
+
 	/* This means it's finished */
 	if (!callback_data.grafts) {
 		BRASERO_BURN_LOG ("No graft found for spanning");
@@ -3121,7 +3400,7 @@ brasero_data_project_is_joliet_compliant (BraseroDataProject *self)
 	if (stats->num_sym)
 		return FALSE;
 
-	if (!priv->joliet || !g_hash_table_size (priv->joliet))
+	if (!stats->num_joliet)
 		return TRUE;
 
 	return FALSE;
@@ -3711,6 +3990,71 @@ brasero_data_project_get_sectors (BraseroDataProject *self)
 	return retval;
 }
 
+static void
+brasero_data_project_node_memory_stats (BraseroFileNode *node,
+					BraseroDataProjectMemoryStats *stats)
+{
+	BraseroFileNode *child;
+	BraseroImport *import;
+
+	stats->nodes ++;
+	stats->node_bytes += brasero_file_node_get_memory_size (node);
+
+	for (child = BRASERO_FILE_NODE_CHILDREN (node); child; child = child->next)
+		brasero_data_project_node_memory_stats (child, stats);
+
+	/* Also count the imported nodes that were replaced */
+	import = BRASERO_FILE_NODE_IMPORT (node);
+	if (!import)
+		return;
+
+	for (child = import->replaced; child; child = child->next)
+		brasero_data_project_node_memory_stats (child, stats);
+}
+
+static void
+brasero_data_project_graft_memory_stats_cb (gpointer key,
+					    BraseroURINode *graft,
+					    BraseroDataProjectMemoryStats *stats)
+{
+	stats->grafts ++;
+	stats->graft_bytes += sizeof (BraseroURINode);
+	stats->graft_bytes += g_slist_length (graft->nodes) * sizeof (GSList);
+
+	/* URIs are shared strings registered once per graft */
+	if (graft->uri != NEW_FOLDER)
+		stats->graft_bytes += strlen (graft->uri) + 1;
+}
+
+/**
+ * brasero_data_project_get_memory_stats:
+ * @project: a #BraseroDataProject
+ * @stats: a #BraseroDataProjectMemoryStats
+ *
+ * Fills @stats with the number of nodes and grafts in @project and an
+ * estimate of the memory they use (allocator overhead excluded).
+ **/
+
+void
+brasero_data_project_get_memory_stats (BraseroDataProject *self,
+				       BraseroDataProjectMemoryStats *stats)
+{
+	BraseroDataProjectPrivate *priv;
+
+	g_return_if_fail (BRASERO_IS_DATA_PROJECT (self));
+	g_return_if_fail (stats != NULL);
+
+	priv = BRASERO_DATA_PROJECT_PRIVATE (self);
+
+	memset (stats, 0, sizeof (BraseroDataProjectMemoryStats));
+	if (priv->root)
+		brasero_data_project_node_memory_stats (priv->root, stats);
+
+	g_hash_table_foreach (priv->grafts,
+			      (GHFunc) brasero_data_project_graft_memory_stats_cb,
+			      stats);
+}
+
 struct _BraseroFileSize {
 	goffset sum;
 	BraseroFileNode *node;
@@ -3851,7 +4195,7 @@ brasero_data_project_clear_grafts_cb (gchar *key,
 	if (graft->uri != NEW_FOLDER)
 		brasero_utils_unregister_string (graft->uri);
 
-	g_free (graft);
+	g_slice_free (BraseroURINode, graft);
 	return TRUE;
 }
 
@@ -3954,6 +4298,31 @@ brasero_data_project_finalize (GObject *object)
 
 #ifdef BUILD_INOTIFY
 
+static void
+brasero_data_project_changes_started (BraseroFileMonitor *monitor)
+{
+	BraseroDataProjectPrivate *priv;
+
+	priv = BRASERO_DATA_PROJECT_PRIVATE (monitor);
+	priv->changes ++;
+}
+
+static void
+brasero_data_project_changes_finished (BraseroFileMonitor *monitor)
+{
+	BraseroDataProjectPrivate *priv;
+
+	priv = BRASERO_DATA_PROJECT_PRIVATE (monitor);
+	if (priv->changes)
+		priv->changes --;
+
+	if (priv->changes || !priv->size_changed)
+		return;
+
+	priv->size_changed = FALSE;
+	brasero_data_project_size_changed (BRASERO_DATA_PROJECT (monitor));
+}
+
 static void
 brasero_data_project_file_added (BraseroFileMonitor *monitor,
 				 gpointer callback_data,
@@ -4342,7 +4711,7 @@ brasero_data_project_file_removed (BraseroFileMonitor *monitor,
 
 	g_hash_table_remove (priv->grafts, uri_node->uri);
 	brasero_utils_unregister_string (uri_node->uri);
-	g_free (uri_node);
+	g_slice_free (BraseroURINode, uri_node);
 }
 
 static void
@@ -4468,6 +4837,8 @@ brasero_data_project_class_init (BraseroDataProjectClass *klass)
 	monitor_class->file_removed = brasero_data_project_file_removed;
 	monitor_class->file_renamed = brasero_data_project_file_renamed;
 	monitor_class->file_modified = brasero_data_project_file_modified;
+	monitor_class->changes_started = brasero_data_project_changes_started;
+	monitor_class->changes_finished = brasero_data_project_changes_finished;
 
 #endif
 }
@@ -125,6 +125,22 @@ brasero_data_project_reset (BraseroDataProject *project);
 goffset
 brasero_data_project_get_sectors (BraseroDataProject *project);
 
+typedef struct _BraseroDataProjectMemoryStats BraseroDataProjectMemoryStats;
+struct _BraseroDataProjectMemoryStats {
+	guint nodes;
+	guint grafts;
+
+	/* nodes with their names, grafts and imports */
+	gsize node_bytes;
+
+	/* BraseroURINode structures with their URIs */
+	gsize graft_bytes;
+};
+
+void
+brasero_data_project_get_memory_stats (BraseroDataProject *project,
+				       BraseroDataProjectMemoryStats *stats);
+
 goffset
 brasero_data_project_improve_image_size_accuracy (goffset blocks,
 						  guint64 dir_num,
@@ -173,6 +189,11 @@ brasero_data_project_add_node_from_info (BraseroDataProject *project,
 					 const gchar *uri,
 					 GFileInfo *info,
 					 BraseroFileNode *parent);
+guint
+brasero_data_project_add_nodes_from_infos (BraseroDataProject *project,
+					   BraseroFileNode *parent,
+					   GPtrArray *uris,
+					   GPtrArray *infos);
 BraseroFileNode *
 brasero_data_project_add_empty_directory (BraseroDataProject *project,
 					  const gchar *name,
@@ -219,6 +240,9 @@ brasero_data_project_restore_uri (BraseroDataProject *project,
 void
 brasero_data_project_exclude_uri (BraseroDataProject *project,
 				  const gchar *uri);
+gboolean
+brasero_data_project_uri_has_graft (BraseroDataProject *project,
+				    const gchar *uri);
 
 guint
 brasero_data_project_reference_new (BraseroDataProject *project,
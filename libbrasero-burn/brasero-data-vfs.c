@@ -38,6 +38,7 @@
 #include <glib/gi18n-lib.h>
 
 #include "brasero-misc.h"
+#include "brasero-units.h"
 
 #include "brasero-data-vfs.h"
 #include "brasero-data-project.h"
@@ -64,6 +65,31 @@ struct _BraseroDataVFSPrivate
 	BraseroIOJobBase *load_uri;
 	BraseroIOJobBase *load_contents;
 
+	/* Directory contents received and not added to the tree yet */
+	GHashTable *pending;
+
+	/* Modification times of the directories explored so far. They are
+	 * recorded in snapshots to tell which directories changed since. */
+	GHashTable *mtimes;
+
+	/* When a project is reopened, the tree recorded when it was saved
+	 * is replayed from these instead of querying every file again. Then
+	 * the replayed entries are checked again in the background. */
+	GHashTable *snapshot;
+	GQueue *replay;
+	guint replay_id;
+
+	GSList *revalidate;
+	BraseroIOJobBase *check_uri;
+	BraseroIOJobBase *check_mtime;
+	BraseroIOJobBase *check_contents;
+	guint checking;
+	guint changed;
+
+	/* Used to list again the monitored directories when events about
+	 * them were lost */
+	BraseroIOJobBase *resync;
+
 	GSettings *settings;
 
 	guint replace_sym:1;
@@ -71,6 +97,63 @@ struct _BraseroDataVFSPrivate
 	guint filter_broken_sym:1;
 };
 
+typedef struct _BraseroDataVFSEntry BraseroDataVFSEntry;
+struct _BraseroDataVFSEntry {
+	gchar *uri;
+	GFileInfo *info;
+
+	/* Recorded contents of directories */
+	GSList *children;
+
+	/* The node the entry was replayed for */
+	guint reference;
+
+	/* For directories; 0 if unknown */
+	guint64 mtime;
+
+	guint is_graft:1;
+	guint is_listed:1;
+	guint is_loaded:1;
+	guint is_explored:1;
+	guint is_seen:1;
+};
+
+typedef struct _BraseroDataVFSPending BraseroDataVFSPending;
+struct _BraseroDataVFSPending {
+	GPtrArray *uris;
+	GPtrArray *infos;
+};
+
+typedef struct _BraseroDataVFSResync BraseroDataVFSResync;
+struct _BraseroDataVFSResync {
+	gchar *uri;
+	guint reference;
+
+	/* Names of the children listed */
+	GHashTable *seen;
+
+	guint is_gone:1;
+};
+
+typedef struct _BraseroDataVFSReplay BraseroDataVFSReplay;
+struct _BraseroDataVFSReplay {
+	BraseroDataVFSEntry *entry;
+	gchar *registered;
+	gboolean directory;
+};
+
+/* Maximum number of entries replayed in one go not to block the UI */
+#define BRASERO_DATA_VFS_REPLAY_BATCH		256
+
+/* Maximum number of children of a directory added to the tree in one go */
+#define BRASERO_DATA_VFS_INSERT_BATCH		1024
+
+#define BRASERO_DATA_VFS_SNAPSHOT_MAGIC		"BRSNAP02"
+
+#define BRASERO_DATA_VFS_SNAPSHOT_FILE		1
+#define BRASERO_DATA_VFS_SNAPSHOT_LISTED	2
+
+
 #define BRASERO_DATA_VFS_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_DATA_VFS, BraseroDataVFSPrivate))
 
 enum {
@@ -79,6 +162,7 @@ enum {
 	IMAGE_SIGNAL,
 	ACTIVITY_SIGNAL,
 	UNKNOWN_SIGNAL,
+	REVALIDATED_SIGNAL,
 	LAST_SIGNAL
 };
 
@@ -249,6 +333,10 @@ brasero_data_vfs_remove_from_hash (BraseroDataVFS *self,
 	g_hash_table_remove (h_table, uri);
 }
 
+static void
+brasero_data_vfs_directory_flush (BraseroDataVFS *self,
+				  const gchar *parent_uri);
+
 /**
  * Explore and add the contents of a directory already loaded
  */
@@ -264,6 +352,11 @@ brasero_data_vfs_directory_load_end (GObject *object,
 
 	priv = BRASERO_DATA_VFS_PRIVATE (self);
 
+	if (!cancelled)
+		brasero_data_vfs_directory_flush (self, uri);
+	else
+		g_hash_table_remove (priv->pending, uri);
+
 	nodes = g_hash_table_lookup (priv->directories, uri);
 	for (; nodes; nodes = nodes->next) {
 		BraseroFileNode *parent;
@@ -383,27 +476,34 @@ brasero_data_vfs_directory_check_symlink_loop (BraseroDataVFS *self,
 }
 
 static void
-brasero_data_vfs_directory_load_result (GObject *owner,
-					GError *error,
-					const gchar *uri,
-					GFileInfo *info,
-					gpointer data)
+brasero_data_vfs_record_mtime (BraseroDataVFS *self,
+			       const gchar *uri,
+			       GFileInfo *info)
 {
-	BraseroDataVFS *self = BRASERO_DATA_VFS (owner);
 	BraseroDataVFSPrivate *priv;
-	gchar *parent_uri = data;
-	const gchar *name;
-	GSList *nodes;
-	GSList *iter;
+	guint64 *mtime;
 
 	priv = BRASERO_DATA_VFS_PRIVATE (self);
 
-	/* check the status of the operation.
-	 * NOTE: no need to remove the nodes. */
-	if (!brasero_data_vfs_check_uri_result (self, uri, error, info))
+	if (g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY
+	|| !g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED))
 		return;
 
-	/* Filtering part */
+	mtime = g_new (guint64, 1);
+	*mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	g_hash_table_insert (priv->mtimes, g_strdup (uri), mtime);
+}
+
+static gboolean
+brasero_data_vfs_directory_filter (BraseroDataVFS *self,
+				   const gchar *uri,
+				   GFileInfo *info)
+{
+	BraseroDataVFSPrivate *priv;
+	const gchar *name;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
 	name = g_file_info_get_name (info);
 
 	/* See if it's a broken symlink */
@@ -416,7 +516,7 @@ brasero_data_vfs_directory_load_result (GObject *owner,
 						     uri,
 						     BRASERO_FILTER_BROKEN_SYM);
 			brasero_data_project_exclude_uri (BRASERO_DATA_PROJECT (self), uri);
-			return;
+			return TRUE;
 		}
 	}
 	/* A new hidden file ? */
@@ -428,58 +528,201 @@ brasero_data_vfs_directory_load_result (GObject *owner,
 						     uri,
 						     BRASERO_FILTER_HIDDEN);
 			brasero_data_project_exclude_uri (BRASERO_DATA_PROJECT (self), uri);
-			return;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+static gboolean
+brasero_data_vfs_directory_check_child (BraseroDataVFS *self,
+					BraseroFileNode *parent,
+					const gchar *uri,
+					GFileInfo *info)
+{
+	BraseroDataVFSPrivate *priv;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	if (g_file_info_get_is_symlink (info)) {
+		if (brasero_data_vfs_directory_check_symlink_loop (self, parent, uri, info)) {
+			brasero_data_project_exclude_uri (BRASERO_DATA_PROJECT (self), uri);
+			if (g_hash_table_lookup (priv->loading, uri))
+				g_signal_emit (self,
+					       brasero_data_vfs_signals [RECURSIVE_SIGNAL],
+					       0,
+					       uri);
+			return FALSE;
 		}
+
+		if (!priv->replace_sym) {
+			/* This is to workaround a small inconsistency
+			 * in GVFS burn:// backend. When there is a
+			 * symlink in burn:// and we are asked not to 
+			 * follow symlinks then the file type is not
+			 * G_FILE_TYPE_SYMBOLIC_LINK */
+			g_file_info_set_file_type (info, G_FILE_TYPE_SYMBOLIC_LINK);
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+brasero_data_vfs_directory_add_child (BraseroDataVFS *self,
+				      BraseroFileNode *parent,
+				      const gchar *uri,
+				      GFileInfo *info)
+{
+	if (parent->is_root) {
+		/* This may be true in some rare situations (when the root of a
+		 * volume has been added like burn:/// */
+		brasero_data_project_add_loading_node (BRASERO_DATA_PROJECT (self),
+						       uri,
+						       parent);
+		return TRUE;
 	}
 
-	/* add node for all parents */
+	if (!brasero_data_vfs_directory_check_child (self, parent, uri, info))
+		return FALSE;
+
+	brasero_data_project_add_node_from_info (BRASERO_DATA_PROJECT (self),
+						 uri,
+						 info,
+						 parent);
+	return TRUE;
+}
+
+static void
+brasero_data_vfs_pending_free (BraseroDataVFSPending *pending)
+{
+	g_ptr_array_foreach (pending->uris, (GFunc) g_free, NULL);
+	g_ptr_array_free (pending->uris, TRUE);
+
+	g_ptr_array_foreach (pending->infos, (GFunc) g_object_unref, NULL);
+	g_ptr_array_free (pending->infos, TRUE);
+
+	g_free (pending);
+}
+
+/**
+ * Adds all the children of a directory received so far in one go
+ */
+static void
+brasero_data_vfs_directory_flush (BraseroDataVFS *self,
+				  const gchar *parent_uri)
+{
+	BraseroDataVFSPending *pending;
+	BraseroDataVFSPrivate *priv;
+	GSList *nodes;
+	GPtrArray *uris;
+	GPtrArray *infos;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	pending = g_hash_table_lookup (priv->pending, parent_uri);
+	if (!pending)
+		return;
+
+	g_hash_table_steal (priv->pending, parent_uri);
+
+	uris = g_ptr_array_sized_new (pending->uris->len);
+	infos = g_ptr_array_sized_new (pending->infos->len);
+
+	/* add nodes for all parents */
 	nodes = g_hash_table_lookup (priv->directories, parent_uri);
-	for (iter = nodes; iter; iter = iter->next) {
-		guint reference;
+	for (; nodes; nodes = nodes->next) {
 		BraseroFileNode *parent;
+		guint reference;
+		guint i;
 
-		reference = GPOINTER_TO_INT (iter->data);
+		reference = GPOINTER_TO_INT (nodes->data);
 		parent = brasero_data_project_reference_get (BRASERO_DATA_PROJECT (self), reference);
 		if (!parent)
 			continue;
 
-		if (parent->is_root) {
-			/* This may be true in some rare situations (when the root of a
-			 * volume has been added like burn:/// */
-			brasero_data_project_add_loading_node (BRASERO_DATA_PROJECT (self),
-							       uri,
-							       parent);
-			 continue;
-		}
+		g_ptr_array_set_size (uris, 0);
+		g_ptr_array_set_size (infos, 0);
 
-		if (g_file_info_get_is_symlink (info)) {
-			if (brasero_data_vfs_directory_check_symlink_loop (self, parent, uri, info)) {
-				brasero_data_project_exclude_uri (BRASERO_DATA_PROJECT (self), uri);
-				if (g_hash_table_lookup (priv->loading, uri))
-					g_signal_emit (self,
-						       brasero_data_vfs_signals [RECURSIVE_SIGNAL],
-						       0,
-						       uri);
-				return;
-			}
+		for (i = 0; i < pending->infos->len; i ++) {
+			GFileInfo *info;
+			gchar *uri;
+
+			uri = g_ptr_array_index (pending->uris, i);
+			info = g_ptr_array_index (pending->infos, i);
 
-			if (!priv->replace_sym) {
-				/* This is to workaround a small inconsistency
-				 * in GVFS burn:// backend. When there is a
-				 * symlink in burn:// and we are asked not to 
-				 * follow symlinks then the file type is not
-				 * G_FILE_TYPE_SYMBOLIC_LINK */
-				g_file_info_set_file_type (info, G_FILE_TYPE_SYMBOLIC_LINK);
+			if (parent->is_root) {
+				brasero_data_vfs_directory_add_child (self, parent, uri, info);
+				continue;
 			}
+
+			if (!brasero_data_vfs_directory_check_child (self, parent, uri, info))
+				continue;
+
+			g_ptr_array_add (uris, uri);
+			g_ptr_array_add (infos, info);
 		}
 
-		brasero_data_project_add_node_from_info (BRASERO_DATA_PROJECT (self),
-							 uri,
-							 info,
-							 parent);
+		if (infos->len)
+			brasero_data_project_add_nodes_from_infos (BRASERO_DATA_PROJECT (self),
+								   parent,
+								   uris,
+								   infos);
+	}
+
+	g_ptr_array_free (uris, TRUE);
+	g_ptr_array_free (infos, TRUE);
+
+	brasero_data_vfs_pending_free (pending);
+}
+
+static void
+brasero_data_vfs_directory_load_result (GObject *owner,
+					GError *error,
+					const gchar *uri,
+					GFileInfo *info,
+					gpointer data)
+{
+	BraseroDataVFS *self = BRASERO_DATA_VFS (owner);
+	BraseroDataVFSPending *pending;
+	BraseroDataVFSPrivate *priv;
+	gchar *parent_uri = data;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	/* check the status of the operation.
+	 * NOTE: no need to remove the nodes. */
+	if (!brasero_data_vfs_check_uri_result (self, uri, error, info))
+		return;
+
+	/* Filtering part */
+	if (brasero_data_vfs_directory_filter (self, uri, info))
+		return;
+
+	brasero_data_vfs_record_mtime (self, uri, info);
+
+	/* Children are added to the tree in batches */
+	pending = g_hash_table_lookup (priv->pending, parent_uri);
+	if (!pending) {
+		pending = g_new0 (BraseroDataVFSPending, 1);
+		pending->uris = g_ptr_array_new ();
+		pending->infos = g_ptr_array_new ();
+		g_hash_table_insert (priv->pending, parent_uri, pending);
 	}
+
+	g_ptr_array_add (pending->uris, g_strdup (uri));
+	g_ptr_array_add (pending->infos, g_object_ref (info));
+
+	if (pending->infos->len >= BRASERO_DATA_VFS_INSERT_BATCH)
+		brasero_data_vfs_directory_flush (self, parent_uri);
 }
 
+static gboolean
+brasero_data_vfs_snapshot_replay (BraseroDataVFS *self,
+				  gchar *registered,
+				  gboolean directory);
+
 static gboolean
 brasero_data_vfs_load_directory (BraseroDataVFS *self,
 				 BraseroFileNode *node,
@@ -515,11 +758,13 @@ brasero_data_vfs_load_directory (BraseroDataVFS *self,
 							   NULL);
 
 	/* no need to require mime types here as these rows won't be visible */
-	brasero_io_load_directory (uri,
-				   priv->load_contents,
-				   BRASERO_IO_INFO_PERM|
-				  (priv->replace_sym ? BRASERO_IO_INFO_FOLLOW_SYMLINK:BRASERO_IO_INFO_NONE),
-				   registered);
+	if (!brasero_data_vfs_snapshot_replay (self, registered, TRUE))
+		brasero_io_load_directory (uri,
+					   priv->load_contents,
+					   BRASERO_IO_INFO_PERM|
+					   BRASERO_IO_INFO_MTIME|
+					  (priv->replace_sym ? BRASERO_IO_INFO_FOLLOW_SYMLINK:BRASERO_IO_INFO_NONE),
+					   registered);
 
 	/* Only emit a signal if state changed. Some widgets need to know if 
 	 * either directories loading or uri loading state has changed to signal
@@ -596,6 +841,8 @@ brasero_data_vfs_loading_node_result (GObject *owner,
 		return;
 	}
 
+	brasero_data_vfs_record_mtime (self, registered, info);
+
 	/* It can happen that the user made a mistake out of ignorance or for
 	 * whatever other reason and dropped an image he wanted to burn.
 	 * So if our file is the only one in the project and if that's an image
@@ -717,11 +964,13 @@ brasero_data_vfs_load_node (BraseroDataVFS *self,
 						      brasero_data_vfs_loading_node_end,
 						      NULL);
 
-	brasero_io_get_file_info (uri,
-				  priv->load_uri,
-				  flags|
-				  (priv->replace_sym ? BRASERO_IO_INFO_FOLLOW_SYMLINK:BRASERO_IO_INFO_NONE),
-				  registered);
+	if (!brasero_data_vfs_snapshot_replay (self, registered, FALSE))
+		brasero_io_get_file_info (uri,
+					  priv->load_uri,
+					  flags|
+					  BRASERO_IO_INFO_MTIME|
+					  (priv->replace_sym ? BRASERO_IO_INFO_FOLLOW_SYMLINK:BRASERO_IO_INFO_NONE),
+					  registered);
 
 	/* Only emit a signal if state changed. Some widgets need to know if 
 	 * either directories loading or uri loading state has changed to signal
@@ -784,84 +1033,1226 @@ brasero_data_vfs_loading_node (BraseroDataVFS *self,
 					   uri);
 }
 
+/**
+ * Project snapshots
+ */
+
+static void
+brasero_data_vfs_entry_free (BraseroDataVFS *self,
+			     BraseroDataVFSEntry *entry)
+{
+	if (entry->reference)
+		brasero_data_project_reference_free (BRASERO_DATA_PROJECT (self), entry->reference);
+
+	g_slist_free (entry->children);
+	g_object_unref (entry->info);
+	g_free (entry->uri);
+	g_free (entry);
+}
+
 static gboolean
-brasero_data_vfs_increase_priority_cb (gpointer data, gpointer user_data)
+brasero_data_vfs_snapshot_free_cb (gpointer key,
+				   gpointer data,
+				   gpointer callback_data)
 {
-	if (data == user_data)
-		return TRUE;
+	brasero_data_vfs_entry_free (BRASERO_DATA_VFS (callback_data), data);
+	return TRUE;
+}
 
-	return FALSE;
+static void
+brasero_data_vfs_snapshot_free (BraseroDataVFS *self)
+{
+	BraseroDataVFSPrivate *priv;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	g_slist_free (priv->revalidate);
+	priv->revalidate = NULL;
+
+	if (priv->snapshot) {
+		g_hash_table_foreach_remove (priv->snapshot,
+					     brasero_data_vfs_snapshot_free_cb,
+					     self);
+		g_hash_table_destroy (priv->snapshot);
+		priv->snapshot = NULL;
+	}
 }
 
 static gboolean
-brasero_data_vfs_require_higher_priority (BraseroDataVFS *self,
-					  BraseroFileNode *node,
-					  BraseroIOJobBase *type)
+brasero_data_vfs_entry_check (BraseroDataVFS *self,
+			      BraseroDataVFSEntry *entry,
+			      BraseroFileNode *node,
+			      const gchar *uri,
+			      GFileInfo *info)
 {
-	gchar *registered;
-	gchar *uri;
+	BraseroDataVFSPrivate *priv;
+	gboolean was_directory;
+	gboolean is_directory;
 
-	uri = brasero_data_project_node_to_uri (BRASERO_DATA_PROJECT (self), node);
-	registered = brasero_utils_register_string (uri);
-	g_free (uri);
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
 
-	brasero_io_find_urgent (type,
-				brasero_data_vfs_increase_priority_cb,
-				registered);
+	was_directory = (g_file_info_get_file_type (entry->info) == G_FILE_TYPE_DIRECTORY);
+	is_directory = (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY);
+	if (was_directory != is_directory)
+		return FALSE;
 
-	brasero_utils_unregister_string (registered);
+	/* Directories have no size and their contents are checked apart */
+	if (is_directory)
+		return TRUE;
+
+	if (BRASERO_BYTES_TO_SECTORS (g_file_info_get_size (info), 2048) ==
+	    BRASERO_BYTES_TO_SECTORS (g_file_info_get_size (entry->info), 2048))
+		return TRUE;
+
+	BRASERO_BURN_LOG ("%s changed since the project was saved", uri);
+	priv->changed ++;
+	brasero_data_project_node_reloaded (BRASERO_DATA_PROJECT (self),
+					    node,
+					    uri,
+					    info);
 	return TRUE;
 }
 
-gboolean
-brasero_data_vfs_require_directory_contents (BraseroDataVFS *self,
-					     BraseroFileNode *node)
+static BraseroIOFlags
+brasero_data_vfs_revalidate_flags (BraseroDataVFS *self)
 {
 	BraseroDataVFSPrivate *priv;
 
 	priv = BRASERO_DATA_VFS_PRIVATE (self);
-	return brasero_data_vfs_require_higher_priority (self,
-							 node,
-							 priv->load_contents);
+
+	/* Checking is never as important as what the user is doing */
+	return BRASERO_IO_INFO_PERM|
+	       BRASERO_IO_INFO_MTIME|
+	       BRASERO_IO_INFO_IDLE|
+	       (priv->replace_sym ? BRASERO_IO_INFO_FOLLOW_SYMLINK:BRASERO_IO_INFO_NONE);
 }
 
-gboolean
-brasero_data_vfs_require_node_load (BraseroDataVFS *self,
-				    BraseroFileNode *node)
+static void
+brasero_data_vfs_revalidate_end (GObject *object,
+				 gboolean cancelled,
+				 gpointer data)
 {
+	BraseroDataVFS *self = BRASERO_DATA_VFS (object);
 	BraseroDataVFSPrivate *priv;
 
+	/* NOTE: we only cancel when the snapshot is destroyed */
+	if (cancelled)
+		return;
+
 	priv = BRASERO_DATA_VFS_PRIVATE (self);
-	return brasero_data_vfs_require_higher_priority (self,
-							 node,
-							 priv->load_uri);
+
+	priv->checking --;
+	if (priv->checking)
+		return;
+
+	BRASERO_BURN_LOG ("Project snapshot revalidated (%i changes)", priv->changed);
+	brasero_data_vfs_snapshot_free (self);
+
+	g_signal_emit (self,
+		       brasero_data_vfs_signals [REVALIDATED_SIGNAL],
+		       0,
+		       priv->changed);
 }
 
-gboolean
-brasero_data_vfs_load_mime (BraseroDataVFS *self,
-			    BraseroFileNode *node)
+/**
+ * Returns FALSE if the graft node was removed or replaced
+ */
+static gboolean
+brasero_data_vfs_revalidate_graft (BraseroDataVFS *self,
+				   BraseroDataVFSEntry *entry,
+				   BraseroFileNode *node,
+				   GError *error,
+				   GFileInfo *info)
 {
 	BraseroDataVFSPrivate *priv;
-	guint reference;
-	gboolean result;
-	GSList *nodes;
-	gchar *uri;
+	BraseroFileNode *parent;
 
 	priv = BRASERO_DATA_VFS_PRIVATE (self);
 
-	if (node->is_loading || node->is_reloading) {
-		brasero_data_vfs_require_node_load (self, node);
-		return TRUE;
+	if (!brasero_data_vfs_check_uri_result (self, entry->uri, error, info)) {
+		BRASERO_BURN_LOG ("%s disappeared since the project was saved", entry->uri);
+		priv->changed ++;
+		brasero_data_project_remove_node (BRASERO_DATA_PROJECT (self), node);
+		return FALSE;
 	}
 
-	uri = brasero_data_project_node_to_uri (BRASERO_DATA_PROJECT (self), node);
-	node->is_reloading = TRUE;
-
-	/* make sure the node is not already in the loading table */
-	nodes = g_hash_table_lookup (priv->loading, uri);
-	if (nodes) {
-		gchar *registered;
-		GSList *iter;
+	if (brasero_data_vfs_entry_check (self, entry, node, entry->uri, info))
+		return TRUE;
+
+	/* It is not the same type of file any more so load it again */
+	BRASERO_BURN_LOG ("%s changed type since the project was saved", entry->uri);
+	priv->changed ++;
+	parent = node->parent;
+	brasero_data_project_remove_node (BRASERO_DATA_PROJECT (self), node);
+	brasero_data_project_add_loading_node (BRASERO_DATA_PROJECT (self),
+					       entry->uri,
+					       parent);
+	return FALSE;
+}
+
+static void
+brasero_data_vfs_revalidate_uri_result (GObject *owner,
+					GError *error,
+					const gchar *uri,
+					GFileInfo *info,
+					gpointer data)
+{
+	BraseroDataVFS *self = BRASERO_DATA_VFS (owner);
+	BraseroDataVFSEntry *entry = data;
+	BraseroFileNode *node;
+
+	node = brasero_data_project_reference_get (BRASERO_DATA_PROJECT (self), entry->reference);
+	if (!node)
+		return;
+
+	if (brasero_data_vfs_revalidate_graft (self, entry, node, error, info))
+		brasero_data_vfs_record_mtime (self, entry->uri, info);
+}
+
+static void
+brasero_data_vfs_revalidate_contents (BraseroDataVFS *self,
+				      BraseroDataVFSEntry *entry);
+
+static void
+brasero_data_vfs_revalidate_mtime_result (GObject *owner,
+					  GError *error,
+					  const gchar *uri,
+					  GFileInfo *info,
+					  gpointer data)
+{
+	BraseroDataVFS *self = BRASERO_DATA_VFS (owner);
+	BraseroDataVFSEntry *entry = data;
+	BraseroFileNode *node;
+
+	node = brasero_data_project_reference_get (BRASERO_DATA_PROJECT (self), entry->reference);
+	if (!node)
+		return;
+
+	if (entry->is_graft) {
+		if (!brasero_data_vfs_revalidate_graft (self, entry, node, error, info))
+			return;
+	}
+	else if (!brasero_data_vfs_check_uri_result (self, entry->uri, error, info)
+	     ||  g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY) {
+		/* Removing or replacing a directory modifies its parent as
+		 * well whose contents are then checked */
+		return;
+	}
+
+	/* A directory that was not modified has still the same contents */
+	if (g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) == entry->mtime)
+		return;
+
+	BRASERO_BURN_LOG ("%s was modified since the project was saved", entry->uri);
+	brasero_data_vfs_record_mtime (self, entry->uri, info);
+	brasero_data_vfs_revalidate_contents (self, entry);
+}
+
+static void
+brasero_data_vfs_revalidate_contents_result (GObject *owner,
+					     GError *error,
+					     const gchar *uri,
+					     GFileInfo *info,
+					     gpointer data)
+{
+	BraseroDataVFS *self = BRASERO_DATA_VFS (owner);
+	BraseroDataVFSEntry *parent_entry = data;
+	BraseroDataVFSPrivate *priv;
+	BraseroDataVFSEntry *entry;
+	BraseroFileNode *parent;
+	BraseroFileNode *node;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	parent = brasero_data_project_reference_get (BRASERO_DATA_PROJECT (self), parent_entry->reference);
+	if (!parent)
+		return;
+
+	if (!brasero_data_vfs_check_uri_result (self, uri, error, info))
+		return;
+
+	entry = g_hash_table_lookup (priv->snapshot, uri);
+	if (entry) {
+		entry->is_seen = TRUE;
+
+		/* The user may have removed, renamed or moved it since */
+		node = brasero_file_node_check_name_existence (parent, g_file_info_get_name (info));
+		if (!node || node->is_grafted)
+			return;
+
+		if (brasero_data_vfs_entry_check (self, entry, node, uri, info)) {
+			brasero_data_vfs_record_mtime (self, uri, info);
+			return;
+		}
+
+		BRASERO_BURN_LOG ("%s changed type since the project was saved", uri);
+		brasero_data_project_destroy_node (BRASERO_DATA_PROJECT (self), node);
+	}
+	else if (brasero_data_project_uri_has_graft (BRASERO_DATA_PROJECT (self), uri)
+	     ||  brasero_data_vfs_directory_filter (self, uri, info))
+		return;
+	else
+		BRASERO_BURN_LOG ("%s appeared since the project was saved", uri);
+
+	priv->changed ++;
+	brasero_data_vfs_directory_add_child (self, parent, uri, info);
+}
+
+static void
+brasero_data_vfs_revalidate_contents_end (GObject *object,
+					  gboolean cancelled,
+					  gpointer data)
+{
+	BraseroDataVFS *self = BRASERO_DATA_VFS (object);
+	BraseroDataVFSEntry *parent_entry = data;
+	BraseroDataVFSPrivate *priv;
+	BraseroFileNode *parent;
+	GSList *iter;
+
+	if (cancelled)
+		return;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	/* Whatever was recorded and not listed again has disappeared */
+	parent = brasero_data_project_reference_get (BRASERO_DATA_PROJECT (self), parent_entry->reference);
+	for (iter = parent_entry->children; parent && iter; iter = iter->next) {
+		BraseroDataVFSEntry *entry;
+		BraseroFileNode *node;
+
+		entry = iter->data;
+		if (entry->is_seen)
+			continue;
+
+		node = brasero_file_node_check_name_existence (parent, g_file_info_get_name (entry->info));
+		if (!node || node->is_grafted)
+			continue;
+
+		BRASERO_BURN_LOG ("%s disappeared since the project was saved", entry->uri);
+		priv->changed ++;
+		brasero_data_project_destroy_node (BRASERO_DATA_PROJECT (self), node);
+	}
+
+	brasero_data_vfs_revalidate_end (object, cancelled, data);
+}
+
+static void
+brasero_data_vfs_revalidate_contents (BraseroDataVFS *self,
+				      BraseroDataVFSEntry *entry)
+{
+	BraseroDataVFSPrivate *priv;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	if (!priv->check_contents)
+		priv->check_contents = brasero_io_register (G_OBJECT (self),
+							    brasero_data_vfs_revalidate_contents_result,
+							    brasero_data_vfs_revalidate_contents_end,
+							    NULL);
+
+	brasero_io_load_directory (entry->uri,
+				   priv->check_contents,
+				   brasero_data_vfs_revalidate_flags (self),
+				   entry);
+	priv->checking ++;
+}
+
+static void
+brasero_data_vfs_revalidate (BraseroDataVFS *self)
+{
+	BraseroDataVFSPrivate *priv;
+	gboolean lazy;
+	GSList *iter;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	/* In lazy mode the recorded contents of directories whose modification
+	 * time did not change are trusted; files that were modified in place
+	 * in such directories are not noticed until the project is reloaded. */
+	lazy = g_settings_get_boolean (priv->settings, BRASERO_PROPS_LAZY_REVALIDATION);
+
+	priv->changed = 0;
+	for (iter = priv->revalidate; iter; iter = iter->next) {
+		BraseroDataVFSEntry *entry;
+
+		entry = iter->data;
+		if (!entry->reference)
+			continue;
+
+		if (lazy && entry->is_explored && entry->mtime) {
+			/* That also checks the graft itself */
+			if (!priv->check_mtime)
+				priv->check_mtime = brasero_io_register (G_OBJECT (self),
+									 brasero_data_vfs_revalidate_mtime_result,
+									 brasero_data_vfs_revalidate_end,
+									 NULL);
+
+			brasero_io_get_file_info (entry->uri,
+						  priv->check_mtime,
+						  brasero_data_vfs_revalidate_flags (self),
+						  entry);
+			priv->checking ++;
+			continue;
+		}
+
+		if (entry->is_graft && entry->is_loaded) {
+			if (!priv->check_uri)
+				priv->check_uri = brasero_io_register (G_OBJECT (self),
+								       brasero_data_vfs_revalidate_uri_result,
+								       brasero_data_vfs_revalidate_end,
+								       NULL);
+
+			brasero_io_get_file_info (entry->uri,
+						  priv->check_uri,
+						  brasero_data_vfs_revalidate_flags (self),
+						  entry);
+			priv->checking ++;
+		}
+
+		if (entry->is_explored)
+			brasero_data_vfs_revalidate_contents (self, entry);
+	}
+
+	g_slist_free (priv->revalidate);
+	priv->revalidate = NULL;
+
+	BRASERO_BURN_LOG ("Revalidating %i project snapshot entries (%s)",
+			  priv->checking,
+			  lazy ? "lazy":"full");
+	if (priv->checking)
+		return;
+
+	brasero_data_vfs_snapshot_free (self);
+	g_signal_emit (self,
+		       brasero_data_vfs_signals [REVALIDATED_SIGNAL],
+		       0,
+		       0);
+}
+
+#ifdef BUILD_INOTIFY
+
+static void
+brasero_data_vfs_resync_result (GObject *owner,
+				GError *error,
+				const gchar *uri,
+				GFileInfo *info,
+				gpointer data)
+{
+	BraseroDataVFS *self = BRASERO_DATA_VFS (owner);
+	BraseroDataVFSResync *resync = data;
+	BraseroFileNode *parent;
+	BraseroFileNode *node;
+	gboolean is_directory;
+
+	parent = brasero_data_project_reference_get (BRASERO_DATA_PROJECT (self), resync->reference);
+	if (!parent || resync->is_gone)
+		return;
+
+	if (error && !strcmp (uri, resync->uri)) {
+		/* The directory itself can't be listed any more */
+		BRASERO_BURN_LOG ("%s disappeared while events were lost", uri);
+		resync->is_gone = TRUE;
+		brasero_data_project_remove_node (BRASERO_DATA_PROJECT (self), parent);
+		return;
+	}
+
+	if (!brasero_data_vfs_check_uri_result (self, uri, error, info))
+		return;
+
+	g_hash_table_insert (resync->seen, g_strdup (g_file_info_get_name (info)), GINT_TO_POINTER (1));
+
+	is_directory = (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY);
+	node = brasero_file_node_check_name_existence (parent, g_file_info_get_name (info));
+	if (node) {
+		if (node->is_grafted)
+			return;
+
+		if (node->is_file == !is_directory) {
+			/* Only the size of a file can have changed */
+			if (node->is_file)
+				brasero_data_project_node_reloaded (BRASERO_DATA_PROJECT (self),
+								    node,
+								    uri,
+								    info);
+			return;
+		}
+
+		BRASERO_BURN_LOG ("%s changed type while events were lost", uri);
+		brasero_data_project_destroy_node (BRASERO_DATA_PROJECT (self), node);
+	}
+	else if (brasero_data_project_uri_has_graft (BRASERO_DATA_PROJECT (self), uri)
+	     ||  brasero_data_vfs_directory_filter (self, uri, info))
+		return;
+	else
+		BRASERO_BURN_LOG ("%s appeared while events were lost", uri);
+
+	brasero_data_vfs_directory_add_child (self, parent, uri, info);
+}
+
+static void
+brasero_data_vfs_resync_end (GObject *object,
+			     gboolean cancelled,
+			     gpointer data)
+{
+	BraseroDataVFS *self = BRASERO_DATA_VFS (object);
+	BraseroDataVFSResync *resync = data;
+	BraseroFileNode *parent;
+
+	parent = brasero_data_project_reference_get (BRASERO_DATA_PROJECT (self), resync->reference);
+	if (parent && !cancelled && !resync->is_gone) {
+		BraseroFileNode *iter;
+		BraseroFileNode *next;
+
+		/* Whatever was not listed again has disappeared */
+		for (iter = BRASERO_FILE_NODE_CHILDREN (parent); iter; iter = next) {
+			next = iter->next;
+
+			if (iter->is_grafted
+			||  iter->is_fake
+			||  iter->is_imported
+			||  iter->is_loading
+			||  BRASERO_FILE_NODE_VIRTUAL (iter))
+				continue;
+
+			if (g_hash_table_lookup (resync->seen, BRASERO_FILE_NODE_NAME (iter)))
+				continue;
+
+			BRASERO_BURN_LOG ("%s disappeared while events were lost", BRASERO_FILE_NODE_NAME (iter));
+			brasero_data_project_destroy_node (BRASERO_DATA_PROJECT (self), iter);
+		}
+	}
+
+	brasero_data_project_reference_free (BRASERO_DATA_PROJECT (self), resync->reference);
+	g_hash_table_destroy (resync->seen);
+	g_free (resync->uri);
+	g_free (resync);
+}
+
+static void
+brasero_data_vfs_resync_node (BraseroDataVFS *self,
+			      BraseroFileNode *node)
+{
+	BraseroDataVFSPrivate *priv;
+	BraseroFileNode *iter;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	for (iter = BRASERO_FILE_NODE_CHILDREN (node); iter; iter = iter->next) {
+		BraseroDataVFSResync *resync;
+
+		if (iter->is_file || iter->is_imported)
+			continue;
+
+		/* Directories not monitored yet are still being loaded */
+		if (iter->is_monitored && !iter->is_loading && !iter->is_exploring) {
+			resync = g_new0 (BraseroDataVFSResync, 1);
+			resync->uri = brasero_data_project_node_to_uri (BRASERO_DATA_PROJECT (self), iter);
+			if (resync->uri) {
+				resync->reference = brasero_data_project_reference_new (BRASERO_DATA_PROJECT (self), iter);
+				resync->seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+				if (!priv->resync)
+					priv->resync = brasero_io_register (G_OBJECT (self),
+									    brasero_data_vfs_resync_result,
+									    brasero_data_vfs_resync_end,
+									    NULL);
+
+				brasero_io_load_directory (resync->uri,
+							   priv->resync,
+							   brasero_data_vfs_revalidate_flags (self),
+							   resync);
+			}
+			else
+				g_free (resync);
+		}
+
+		brasero_data_vfs_resync_node (self, iter);
+	}
+}
+
+static void
+brasero_data_vfs_events_lost (BraseroFileMonitor *monitor)
+{
+	BraseroDataVFS *self = BRASERO_DATA_VFS (monitor);
+	BraseroDataVFSPrivate *priv;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	/* The monitored directories may have changed without notice; list
+	 * them again. Whatever is already being listed again is dropped. */
+	if (priv->resync)
+		brasero_io_cancel_by_base (priv->resync);
+
+	BRASERO_BURN_LOG ("File monitoring events were lost; listing monitored directories again");
+	brasero_data_vfs_resync_node (self, brasero_data_project_get_root (BRASERO_DATA_PROJECT (self)));
+}
+
+#endif
+
+static void
+brasero_data_vfs_entry_set_node (BraseroDataVFS *self,
+				 BraseroDataVFSEntry *entry,
+				 GHashTable *table,
+				 const gchar *registered)
+{
+	GSList *nodes;
+
+	if (entry->reference)
+		return;
+
+	/* Keep a reference on the first node to revalidate it later */
+	nodes = g_hash_table_lookup (table, registered);
+	for (; nodes; nodes = nodes->next) {
+		BraseroFileNode *node;
+
+		node = brasero_data_project_reference_get (BRASERO_DATA_PROJECT (self),
+							   GPOINTER_TO_INT (nodes->data));
+		if (node) {
+			entry->reference = brasero_data_project_reference_new (BRASERO_DATA_PROJECT (self), node);
+			return;
+		}
+	}
+}
+
+static gboolean
+brasero_data_vfs_replay_cb (gpointer data)
+{
+	BraseroDataVFS *self = BRASERO_DATA_VFS (data);
+	BraseroDataVFSPrivate *priv;
+	gint num = 0;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	while (num < BRASERO_DATA_VFS_REPLAY_BATCH) {
+		BraseroDataVFSReplay *replay;
+		BraseroDataVFSEntry *entry;
+		GSList *iter;
+
+		replay = g_queue_pop_head (priv->replay);
+		if (!replay)
+			break;
+
+		entry = replay->entry;
+		if (!entry->is_loaded && !entry->is_explored)
+			priv->revalidate = g_slist_prepend (priv->revalidate, entry);
+
+		/* Feed the recorded information to the same callbacks as
+		 * BraseroIO would have */
+		if (replay->directory) {
+			brasero_data_vfs_entry_set_node (self, entry, priv->directories, replay->registered);
+			entry->is_explored = TRUE;
+
+			for (iter = entry->children; iter; iter = iter->next) {
+				BraseroDataVFSEntry *child;
+
+				child = iter->data;
+				brasero_data_vfs_directory_load_result (G_OBJECT (self),
+									NULL,
+									child->uri,
+									child->info,
+									replay->registered);
+				num ++;
+			}
+
+			brasero_data_vfs_directory_load_end (G_OBJECT (self),
+							     FALSE,
+							     replay->registered);
+		}
+		else {
+			brasero_data_vfs_entry_set_node (self, entry, priv->loading, replay->registered);
+			entry->is_loaded = TRUE;
+
+			brasero_data_vfs_loading_node_result (G_OBJECT (self),
+							      NULL,
+							      entry->uri,
+							      entry->info,
+							      replay->registered);
+			brasero_data_vfs_loading_node_end (G_OBJECT (self),
+							   FALSE,
+							   replay->registered);
+		}
+
+		g_free (replay);
+		num ++;
+	}
+
+	if (!g_queue_is_empty (priv->replay))
+		return TRUE;
+
+	/* From now on everything goes through BraseroIO */
+	g_queue_free (priv->replay);
+	priv->replay = NULL;
+	priv->replay_id = 0;
+
+	brasero_data_vfs_revalidate (self);
+	return FALSE;
+}
+
+static gboolean
+brasero_data_vfs_snapshot_replay (BraseroDataVFS *self,
+				  gchar *registered,
+				  gboolean directory)
+{
+	BraseroDataVFSPrivate *priv;
+	BraseroDataVFSReplay *replay;
+	BraseroDataVFSEntry *entry;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	if (!priv->replay)
+		return FALSE;
+
+	entry = g_hash_table_lookup (priv->snapshot, registered);
+	if (!entry)
+		return FALSE;
+
+	/* The contents of some directories are not recorded and the loading
+	 * callback needs a mime type */
+	if (directory) {
+		if (!entry->is_listed)
+			return FALSE;
+	}
+	else if (!g_file_info_get_content_type (entry->info))
+		return FALSE;
+
+	replay = g_new0 (BraseroDataVFSReplay, 1);
+	replay->entry = entry;
+	replay->registered = registered;
+	replay->directory = directory;
+	g_queue_push_tail (priv->replay, replay);
+
+	if (!priv->replay_id)
+		priv->replay_id = g_idle_add (brasero_data_vfs_replay_cb, self);
+
+	return TRUE;
+}
+
+static guint8
+brasero_data_vfs_snapshot_get_flags (BraseroDataVFS *self)
+{
+	BraseroDataVFSPrivate *priv;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	/* Filtering rules change what is in the tree */
+	return (priv->replace_sym ? 1:0)|
+	       (priv->filter_hidden ? 2:0)|
+	       (priv->filter_broken_sym ? 4:0);
+}
+
+static void
+brasero_data_vfs_snapshot_write_uint32 (GString *buffer,
+					guint32 value)
+{
+	value = GUINT32_TO_LE (value);
+	g_string_append_len (buffer, (gchar *) &value, sizeof (value));
+}
+
+static void
+brasero_data_vfs_snapshot_write_uint64 (GString *buffer,
+					guint64 value)
+{
+	value = GUINT64_TO_LE (value);
+	g_string_append_len (buffer, (gchar *) &value, sizeof (value));
+}
+
+static void
+brasero_data_vfs_snapshot_write_string (GString *buffer,
+					const gchar *string)
+{
+	guint32 len;
+
+	len = string ? strlen (string):0;
+	brasero_data_vfs_snapshot_write_uint32 (buffer, len);
+	g_string_append_len (buffer, string, len);
+}
+
+static void
+brasero_data_vfs_snapshot_write_node (BraseroDataVFS *self,
+				      GString *buffer,
+				      GHashTable *written,
+				      BraseroFileNode *node,
+				      const gchar *parent_uri,
+				      guint32 parent,
+				      guint32 *num)
+{
+	BraseroDataVFSPrivate *priv;
+	BraseroFileNode *child;
+	guint64 *mtime = NULL;
+	guint8 flags = 0;
+	guint32 index;
+	gchar *uri;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	/* Symlinks are always loaded again to check for loops */
+	if (node->is_imported || node->is_symlink)
+		return;
+
+	if (node->is_fake) {
+		for (child = BRASERO_FILE_NODE_CHILDREN (node); child; child = child->next)
+			brasero_data_vfs_snapshot_write_node (self,
+							      buffer,
+							      written,
+							      child,
+							      NULL,
+							      G_MAXUINT32,
+							      num);
+		return;
+	}
+
+	if (node->is_grafted) {
+		uri = g_strdup (BRASERO_FILE_NODE_GRAFT (node)->node->uri);
+		parent = G_MAXUINT32;
+	}
+	else if (parent_uri) {
+		gchar *escaped_name;
+
+		/* Same as brasero_data_project_node_to_uri () */
+		escaped_name = g_uri_escape_string (BRASERO_FILE_NODE_NAME (node),
+						    G_URI_RESERVED_CHARS_ALLOWED_IN_PATH,
+						    FALSE);
+		uri = g_strconcat (parent_uri,
+				   g_str_has_suffix (parent_uri, G_DIR_SEPARATOR_S) ? "":G_DIR_SEPARATOR_S,
+				   escaped_name,
+				   NULL);
+		g_free (escaped_name);
+	}
+	else
+		return;
+
+	/* A URI can be in the tree more than once; record it only once */
+	if (g_hash_table_lookup (written, uri)) {
+		g_free (uri);
+		return;
+	}
+	g_hash_table_insert (written, uri, GINT_TO_POINTER (1));
+
+	if (node->is_file)
+		flags |= BRASERO_DATA_VFS_SNAPSHOT_FILE;
+	else {
+		flags |= BRASERO_DATA_VFS_SNAPSHOT_LISTED;
+		mtime = g_hash_table_lookup (priv->mtimes, uri);
+
+		/* Only record directories whose contents can be replayed
+		 * exactly as they would be explored */
+		for (child = BRASERO_FILE_NODE_CHILDREN (node); child; child = child->next) {
+			if (child->is_symlink || child->is_imported || child->is_hidden) {
+				flags &= ~BRASERO_DATA_VFS_SNAPSHOT_LISTED;
+				break;
+			}
+		}
+	}
+
+	index = (*num) ++;
+	brasero_data_vfs_snapshot_write_uint32 (buffer, parent);
+	g_string_append_c (buffer, flags);
+	brasero_data_vfs_snapshot_write_string (buffer, node->is_grafted ? uri:BRASERO_FILE_NODE_NAME (node));
+	brasero_data_vfs_snapshot_write_uint64 (buffer, node->is_file ? (guint64) BRASERO_FILE_NODE_SECTORS (node) * 2048ULL:0);
+	brasero_data_vfs_snapshot_write_string (buffer, node->is_file ? BRASERO_FILE_NODE_MIME (node):NULL);
+	brasero_data_vfs_snapshot_write_uint64 (buffer, mtime ? *mtime:0);
+
+	if (node->is_file)
+		return;
+
+	for (child = BRASERO_FILE_NODE_CHILDREN (node); child; child = child->next)
+		brasero_data_vfs_snapshot_write_node (self,
+						      buffer,
+						      written,
+						      child,
+						      uri,
+						      index,
+						      num);
+}
+
+/**
+ * Records the whole tree as it was loaded so that it can be replayed later
+ * without querying every file again. @tag identifies the state of the project
+ * file the snapshot goes with. Fails if the tree is still loading.
+ */
+gboolean
+brasero_data_vfs_save_snapshot (BraseroDataVFS *self,
+				const gchar *path,
+				const gchar *tag,
+				GError **error)
+{
+	BraseroFileNode *child;
+	GHashTable *written;
+	GString *buffer;
+	gboolean result;
+	guint32 num = 0;
+	gchar *directory;
+	gsize num_pos;
+
+	/* Only a completely loaded tree is worth anything */
+	if (brasero_data_vfs_is_active (self))
+		return FALSE;
+
+	buffer = g_string_new (BRASERO_DATA_VFS_SNAPSHOT_MAGIC);
+	g_string_append_c (buffer, brasero_data_vfs_snapshot_get_flags (self));
+	brasero_data_vfs_snapshot_write_string (buffer, tag);
+
+	/* Number of entries is written once they are all known */
+	num_pos = buffer->len;
+	brasero_data_vfs_snapshot_write_uint32 (buffer, 0);
+
+	written = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	child = BRASERO_FILE_NODE_CHILDREN (brasero_data_project_get_root (BRASERO_DATA_PROJECT (self)));
+	for (; child; child = child->next)
+		brasero_data_vfs_snapshot_write_node (self,
+						      buffer,
+						      written,
+						      child,
+						      NULL,
+						      G_MAXUINT32,
+						      &num);
+	g_hash_table_destroy (written);
+
+	num = GUINT32_TO_LE (num);
+	memcpy (buffer->str + num_pos, &num, sizeof (num));
+
+	directory = g_path_get_dirname (path);
+	g_mkdir_with_parents (directory, 0700);
+	g_free (directory);
+
+	result = g_file_set_contents (path, buffer->str, buffer->len, error);
+	BRASERO_BURN_LOG ("Project snapshot saved (%i entries, %"G_GSIZE_FORMAT" bytes)",
+			  GUINT32_FROM_LE (num),
+			  buffer->len);
+
+	g_string_free (buffer, TRUE);
+	return result;
+}
+
+static gboolean
+brasero_data_vfs_snapshot_read (const gchar **ptr,
+				const gchar *end,
+				gpointer data,
+				gsize size)
+{
+	if ((gsize) (end - *ptr) < size)
+		return FALSE;
+
+	memcpy (data, *ptr, size);
+	*ptr += size;
+	return TRUE;
+}
+
+static gboolean
+brasero_data_vfs_snapshot_read_uint32 (const gchar **ptr,
+				       const gchar *end,
+				       guint32 *value)
+{
+	if (!brasero_data_vfs_snapshot_read (ptr, end, value, sizeof (guint32)))
+		return FALSE;
+
+	*value = GUINT32_FROM_LE (*value);
+	return TRUE;
+}
+
+static gboolean
+brasero_data_vfs_snapshot_read_uint64 (const gchar **ptr,
+				       const gchar *end,
+				       guint64 *value)
+{
+	if (!brasero_data_vfs_snapshot_read (ptr, end, value, sizeof (guint64)))
+		return FALSE;
+
+	*value = GUINT64_FROM_LE (*value);
+	return TRUE;
+}
+
+static gchar *
+brasero_data_vfs_snapshot_read_string (const gchar **ptr,
+				       const gchar *end)
+{
+	guint32 len;
+	gchar *string;
+
+	if (!brasero_data_vfs_snapshot_read_uint32 (ptr, end, &len))
+		return NULL;
+
+	if ((gsize) (end - *ptr) < len)
+		return NULL;
+
+	string = g_strndup (*ptr, len);
+	*ptr += len;
+	return string;
+}
+
+static GFileInfo *
+brasero_data_vfs_snapshot_info_new (const gchar *name,
+				    guint8 flags,
+				    guint64 size,
+				    const gchar *mime,
+				    guint64 mtime)
+{
+	GFileInfo *info;
+
+	info = g_file_info_new ();
+	g_file_info_set_name (info, name);
+	g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_READ, TRUE);
+
+	if (flags & BRASERO_DATA_VFS_SNAPSHOT_FILE) {
+		g_file_info_set_file_type (info, G_FILE_TYPE_REGULAR);
+		g_file_info_set_size (info, size);
+
+		/* Files found while exploring a directory have no mime type */
+		if (mime && mime [0] != '\0')
+			g_file_info_set_content_type (info, mime);
+	}
+	else {
+		g_file_info_set_file_type (info, G_FILE_TYPE_DIRECTORY);
+		g_file_info_set_content_type (info, "inode/directory");
+
+		/* So that it is recorded again when replayed */
+		if (mtime)
+			g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, mtime);
+	}
+
+	return info;
+}
+
+/**
+ * Must be called before the project contents are loaded. If @tag matches, the
+ * recorded tree is used instead of querying every file and then checked again
+ * in the background once the project is loaded.
+ */
+gboolean
+brasero_data_vfs_load_snapshot (BraseroDataVFS *self,
+				const gchar *path,
+				const gchar *tag)
+{
+	BraseroDataVFSPrivate *priv;
+	GHashTable *snapshot;
+	GPtrArray *entries;
+	gchar *stored_tag;
+	const gchar *ptr;
+	const gchar *end;
+	gchar *contents;
+	guint8 flags;
+	guint32 num;
+	guint32 i;
+	gsize len;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	if (priv->snapshot)
+		return FALSE;
+
+	if (!g_file_get_contents (path, &contents, &len, NULL))
+		return FALSE;
+
+	ptr = contents;
+	end = contents + len;
+
+	entries = g_ptr_array_new ();
+	snapshot = g_hash_table_new (g_str_hash, g_str_equal);
+
+	if (len < strlen (BRASERO_DATA_VFS_SNAPSHOT_MAGIC)
+	||  memcmp (ptr, BRASERO_DATA_VFS_SNAPSHOT_MAGIC, strlen (BRASERO_DATA_VFS_SNAPSHOT_MAGIC)))
+		goto error;
+
+	ptr += strlen (BRASERO_DATA_VFS_SNAPSHOT_MAGIC);
+	if (!brasero_data_vfs_snapshot_read (&ptr, end, &flags, sizeof (flags))
+	||   flags != brasero_data_vfs_snapshot_get_flags (self))
+		goto error;
+
+	/* Make sure the project file was not modified in between */
+	stored_tag = brasero_data_vfs_snapshot_read_string (&ptr, end);
+	if (g_strcmp0 (stored_tag, tag)) {
+		g_free (stored_tag);
+		goto error;
+	}
+	g_free (stored_tag);
+
+	if (!brasero_data_vfs_snapshot_read_uint32 (&ptr, end, &num))
+		goto error;
+
+	for (i = 0; i < num; i ++) {
+		BraseroDataVFSEntry *entry;
+		guint32 parent;
+		guint64 mtime;
+		guint64 size;
+		gchar *name;
+		gchar *mime;
+
+		if (!brasero_data_vfs_snapshot_read_uint32 (&ptr, end, &parent)
+		||  !brasero_data_vfs_snapshot_read (&ptr, end, &flags, sizeof (flags)))
+			goto error;
+
+		name = brasero_data_vfs_snapshot_read_string (&ptr, end);
+		if (!name)
+			goto error;
+
+		if (!brasero_data_vfs_snapshot_read_uint64 (&ptr, end, &size)
+		||  !(mime = brasero_data_vfs_snapshot_read_string (&ptr, end))) {
+			g_free (name);
+			goto error;
+		}
+
+		if (!brasero_data_vfs_snapshot_read_uint64 (&ptr, end, &mtime)) {
+			g_free (name);
+			g_free (mime);
+			goto error;
+		}
+
+		if (parent != G_MAXUINT32 && parent >= entries->len) {
+			g_free (name);
+			g_free (mime);
+			goto error;
+		}
+
+		entry = g_new0 (BraseroDataVFSEntry, 1);
+		entry->is_listed = (flags & BRASERO_DATA_VFS_SNAPSHOT_LISTED) != 0;
+		entry->mtime = mtime;
+
+		if (parent == G_MAXUINT32) {
+			GFile *file;
+			gchar *basename;
+
+			entry->is_graft = TRUE;
+			entry->uri = name;
+
+			file = g_file_new_for_uri (entry->uri);
+			basename = g_file_get_basename (file);
+			g_object_unref (file);
+
+			entry->info = brasero_data_vfs_snapshot_info_new (basename, flags, size, mime, mtime);
+			g_free (basename);
+		}
+		else {
+			BraseroDataVFSEntry *parent_entry;
+			gchar *escaped_name;
+
+			parent_entry = g_ptr_array_index (entries, parent);
+			escaped_name = g_uri_escape_string (name,
+							    G_URI_RESERVED_CHARS_ALLOWED_IN_PATH,
+							    FALSE);
+			entry->uri = g_strconcat (parent_entry->uri,
+						  g_str_has_suffix (parent_entry->uri, G_DIR_SEPARATOR_S) ? "":G_DIR_SEPARATOR_S,
+						  escaped_name,
+						  NULL);
+			g_free (escaped_name);
+
+			entry->info = brasero_data_vfs_snapshot_info_new (name, flags, size, mime, mtime);
+			g_free (name);
+
+			parent_entry->children = g_slist_prepend (parent_entry->children, entry);
+		}
+		g_free (mime);
+
+		g_ptr_array_add (entries, entry);
+		g_hash_table_insert (snapshot, entry->uri, entry);
+	}
+
+	for (i = 0; i < entries->len; i ++) {
+		BraseroDataVFSEntry *entry;
+
+		entry = g_ptr_array_index (entries, i);
+		entry->children = g_slist_reverse (entry->children);
+	}
+
+	BRASERO_BURN_LOG ("Project snapshot loaded (%i entries)", entries->len);
+
+	g_ptr_array_free (entries, TRUE);
+	g_free (contents);
+
+	priv->snapshot = snapshot;
+	priv->replay = g_queue_new ();
+	return TRUE;
+
+error:
+
+	BRASERO_BURN_LOG ("Project snapshot invalid or out of date");
+
+	for (i = 0; i < entries->len; i ++)
+		brasero_data_vfs_entry_free (self, g_ptr_array_index (entries, i));
+
+	g_ptr_array_free (entries, TRUE);
+	g_hash_table_destroy (snapshot);
+	g_free (contents);
+	return FALSE;
+}
+
+static gboolean
+brasero_data_vfs_increase_priority_cb (gpointer data, gpointer user_data)
+{
+	if (data == user_data)
+		return TRUE;
+
+	return FALSE;
+}
+
+static gboolean
+brasero_data_vfs_require_higher_priority (BraseroDataVFS *self,
+					  BraseroFileNode *node,
+					  BraseroIOJobBase *type)
+{
+	gchar *registered;
+	gchar *uri;
+
+	uri = brasero_data_project_node_to_uri (BRASERO_DATA_PROJECT (self), node);
+	registered = brasero_utils_register_string (uri);
+	g_free (uri);
+
+	brasero_io_find_urgent (type,
+				brasero_data_vfs_increase_priority_cb,
+				registered);
+
+	brasero_utils_unregister_string (registered);
+	return TRUE;
+}
+
+gboolean
+brasero_data_vfs_require_directory_contents (BraseroDataVFS *self,
+					     BraseroFileNode *node)
+{
+	BraseroDataVFSPrivate *priv;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+	return brasero_data_vfs_require_higher_priority (self,
+							 node,
+							 priv->load_contents);
+}
+
+gboolean
+brasero_data_vfs_require_node_load (BraseroDataVFS *self,
+				    BraseroFileNode *node)
+{
+	BraseroDataVFSPrivate *priv;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+	return brasero_data_vfs_require_higher_priority (self,
+							 node,
+							 priv->load_uri);
+}
+
+gboolean
+brasero_data_vfs_load_mime (BraseroDataVFS *self,
+			    BraseroFileNode *node)
+{
+	BraseroDataVFSPrivate *priv;
+	guint reference;
+	gboolean result;
+	GSList *nodes;
+	gchar *uri;
+
+	priv = BRASERO_DATA_VFS_PRIVATE (self);
+
+	if (node->is_loading || node->is_reloading) {
+		brasero_data_vfs_require_node_load (self, node);
+		return TRUE;
+	}
+
+	uri = brasero_data_project_node_to_uri (BRASERO_DATA_PROJECT (self), node);
+	node->is_reloading = TRUE;
+
+	/* make sure the node is not already in the loading table */
+	nodes = g_hash_table_lookup (priv->loading, uri);
+	if (nodes) {
+		gchar *registered;
+		GSList *iter;
 
 		registered = brasero_utils_register_string (uri);
 		g_free (uri);
@@ -988,6 +2379,48 @@ brasero_data_vfs_clear (BraseroDataVFS *self)
 		priv->load_contents = NULL;
 	}
 
+	/* Stop replaying and checking any snapshot */
+	if (priv->replay_id) {
+		g_source_remove (priv->replay_id);
+		priv->replay_id = 0;
+	}
+
+	if (priv->replay) {
+		g_queue_foreach (priv->replay, (GFunc) g_free, NULL);
+		g_queue_free (priv->replay);
+		priv->replay = NULL;
+	}
+
+	if (priv->check_uri) {
+		brasero_io_cancel_by_base (priv->check_uri);
+		brasero_io_job_base_free (priv->check_uri);
+		priv->check_uri = NULL;
+	}
+
+	if (priv->check_mtime) {
+		brasero_io_cancel_by_base (priv->check_mtime);
+		brasero_io_job_base_free (priv->check_mtime);
+		priv->check_mtime = NULL;
+	}
+
+	if (priv->check_contents) {
+		brasero_io_cancel_by_base (priv->check_contents);
+		brasero_io_job_base_free (priv->check_contents);
+		priv->check_contents = NULL;
+	}
+
+	if (priv->resync) {
+		brasero_io_cancel_by_base (priv->resync);
+		brasero_io_job_base_free (priv->resync);
+		priv->resync = NULL;
+	}
+
+	priv->checking = 0;
+	brasero_data_vfs_snapshot_free (self);
+
+	g_hash_table_remove_all (priv->mtimes);
+	g_hash_table_remove_all (priv->pending);
+
 	/* Empty the hash tables */
 	g_hash_table_foreach_remove (priv->loading,
 				     brasero_data_vfs_empty_loading_cb,
@@ -1063,6 +2496,11 @@ brasero_data_vfs_init (BraseroDataVFS *object)
 	/* create the hash tables */
 	priv->loading = g_hash_table_new (g_str_hash, g_str_equal);
 	priv->directories = g_hash_table_new (g_str_hash, g_str_equal);
+	priv->mtimes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	priv->pending = g_hash_table_new_full (g_str_hash,
+					       g_str_equal,
+					       NULL,
+					       (GDestroyNotify) brasero_data_vfs_pending_free);
 }
 
 static void
@@ -1084,6 +2522,16 @@ brasero_data_vfs_finalize (GObject *object)
 		priv->directories = NULL;
 	}
 
+	if (priv->mtimes) {
+		g_hash_table_destroy (priv->mtimes);
+		priv->mtimes = NULL;
+	}
+
+	if (priv->pending) {
+		g_hash_table_destroy (priv->pending);
+		priv->pending = NULL;
+	}
+
 	if (priv->filtered) {
 		g_object_unref (priv->filtered);
 		priv->filtered = NULL;
@@ -1111,6 +2559,10 @@ brasero_data_vfs_class_init (BraseroDataVFSClass *klass)
 	data_project_class->node_added = brasero_data_vfs_node_added;
 	data_project_class->uri_removed = brasero_data_vfs_uri_removed;
 
+#ifdef BUILD_INOTIFY
+	BRASERO_FILE_MONITOR_CLASS (klass)->events_lost = brasero_data_vfs_events_lost;
+#endif
+
 	/* There is no need to implement the other virtual functions.
 	 * For example, even if we were notified of a node removal it 
 	 * would take a lot of time to remove it from the hashes. */
@@ -1171,4 +2623,15 @@ brasero_data_vfs_class_init (BraseroDataVFSClass *klass)
 			  G_TYPE_NONE,
 			  1,
 			  G_TYPE_STRING);
+
+	brasero_data_vfs_signals [REVALIDATED_SIGNAL] = 
+	    g_signal_new ("snapshot_revalidated",
+			  G_TYPE_FROM_CLASS (klass),
+			  G_SIGNAL_RUN_FIRST,
+			  0,
+			  NULL, NULL,
+			  g_cclosure_marshal_VOID__UINT,
+			  G_TYPE_NONE,
+			  1,
+			  G_TYPE_UINT);
 }
@@ -43,6 +43,7 @@ G_BEGIN_DECLS
 #define BRASERO_PROPS_FILTER_HIDDEN	        "hidden"
 #define BRASERO_PROPS_FILTER_BROKEN	        "broken-sym"
 #define BRASERO_PROPS_FILTER_REPLACE_SYMLINK    "replace-sym"
+#define BRASERO_PROPS_LAZY_REVALIDATION		"lazy-revalidation"
 
 #define BRASERO_TYPE_DATA_VFS             (brasero_data_vfs_get_type ())
 #define BRASERO_DATA_VFS(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), BRASERO_TYPE_DATA_VFS, BraseroDataVFS))
@@ -90,6 +91,17 @@ brasero_data_vfs_require_directory_contents (BraseroDataVFS *vfs,
 BraseroFilteredUri *
 brasero_data_vfs_get_filtered_model (BraseroDataVFS *vfs);
 
+gboolean
+brasero_data_vfs_save_snapshot (BraseroDataVFS *vfs,
+				const gchar *path,
+				const gchar *tag,
+				GError **error);
+
+gboolean
+brasero_data_vfs_load_snapshot (BraseroDataVFS *vfs,
+				const gchar *path,
+				const gchar *tag);
+
 G_END_DECLS
 
 #endif /* _BRASERO_DATA_VFS_H_ */
@@ -0,0 +1,87 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _BRASERO_FILE_MONITOR_BACKEND_H_
+#define _BRASERO_FILE_MONITOR_BACKEND_H_
+
+#include <glib.h>
+
+#include <sys/inotify.h>
+
+#include "brasero-file-monitor.h"
+
+G_BEGIN_DECLS
+
+/* Each backend hands out watch descriptors from its own range so that a
+ * descriptor tells which backend it belongs to. inotify uses the ones the
+ * kernel gives (small positive integers). */
+#define BRASERO_FILE_MONITOR_INOTIFY_WD_BASE	0
+#define BRASERO_FILE_MONITOR_FANOTIFY_WD_BASE	(1 << 28)
+#define BRASERO_FILE_MONITOR_POLL_WD_BASE	(2 << 28)
+
+typedef struct _BraseroFileMonitorBackend BraseroFileMonitorBackend;
+struct _BraseroFileMonitorBackend {
+	const gchar *name;
+	gint wd_base;
+
+	/* Returns the private data of the backend or NULL if it can't be
+	 * used on this system */
+	gpointer	(*open)		(BraseroFileMonitor *monitor);
+	void		(*close)	(gpointer data);
+
+	/* Returns a watch descriptor for a directory (always the same one for
+	 * the same directory) or 0 and sets errno on failure */
+	gint		(*add_watch)	(gpointer data,
+					 const gchar *path);
+	void		(*rm_watch)	(gpointer data,
+					 gint wd);
+};
+
+extern const BraseroFileMonitorBackend brasero_file_monitor_fanotify_backend;
+extern const BraseroFileMonitorBackend brasero_file_monitor_inotify_backend;
+extern const BraseroFileMonitorBackend brasero_file_monitor_poll_backend;
+
+/* All backends report events in the inotify format. Events should be given
+ * between a brasero_file_monitor_changes_started () and
+ * brasero_file_monitor_changes_finished () pair so they are delivered as one
+ * set of changes. */
+void
+brasero_file_monitor_changes_started (BraseroFileMonitor *self);
+
+void
+brasero_file_monitor_changes_finished (BraseroFileMonitor *self);
+
+void
+brasero_file_monitor_event (BraseroFileMonitor *self,
+			    struct inotify_event *event);
+
+G_END_DECLS
+
+#endif /* _BRASERO_FILE_MONITOR_BACKEND_H_ */
@@ -0,0 +1,549 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+/* for name_to_handle_at () */
+#define _GNU_SOURCE
+
+#include <string.h>
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#ifdef HAVE_SYS_FANOTIFY_H
+#include <sys/vfs.h>
+#include <sys/fanotify.h>
+#endif
+
+#include <glib.h>
+
+#include "brasero-file-monitor-backend.h"
+#include "burn-debug.h"
+
+#if defined (HAVE_SYS_FANOTIFY_H) && defined (FAN_REPORT_DFID_NAME)
+
+/* fanotify can watch a whole filesystem with a single mark instead of one
+ * inotify watch per directory. Events identify the directory with a file
+ * handle (and the name of the child); handles of watched directories are
+ * mapped to watch descriptors so that events can be given to the monitor in
+ * the inotify format. Marking a filesystem requires CAP_SYS_ADMIN. */
+
+#define BRASERO_FANOTIFY_BUFFER_SIZE	16384
+
+#define BRASERO_FANOTIFY_MASK		(FAN_CREATE|			\
+					 FAN_DELETE|			\
+					 FAN_MODIFY|			\
+					 FAN_ATTRIB|			\
+					 FAN_DELETE_SELF|		\
+					 FAN_MOVE_SELF|			\
+					 FAN_ONDIR)
+
+typedef struct _BraseroFanotifyFilesystem BraseroFanotifyFilesystem;
+struct _BraseroFanotifyFilesystem {
+	gchar *path;
+	guint refs;
+	guint failed:1;
+};
+
+typedef struct _BraseroFanotifyDirectory BraseroFanotifyDirectory;
+struct _BraseroFanotifyDirectory {
+	gchar *key;
+	gchar *fs_key;
+	gint wd;
+};
+
+typedef struct _BraseroFanotifyBackend BraseroFanotifyBackend;
+struct _BraseroFanotifyBackend {
+	BraseroFileMonitor *monitor;
+
+	GIOChannel *channel;
+	guint id;
+
+	/* FAN_RENAME (or FAN_MOVED_FROM|FAN_MOVED_TO when it's not supported) */
+	guint32 mask;
+
+	GHashTable *filesystems;
+	GHashTable *handles;
+	GHashTable *wds;
+
+	gint last_wd;
+	guint32 cookie;
+};
+
+static void
+brasero_fanotify_filesystem_free (BraseroFanotifyFilesystem *filesystem)
+{
+	g_free (filesystem->path);
+	g_free (filesystem);
+}
+
+static void
+brasero_fanotify_directory_free (BraseroFanotifyDirectory *directory)
+{
+	g_free (directory->key);
+	g_free (directory->fs_key);
+	g_free (directory);
+}
+
+static gchar *
+brasero_fanotify_filesystem_key (const void *fsid)
+{
+	guint32 val [2];
+
+	memcpy (val, fsid, sizeof (val));
+	return g_strdup_printf ("%08x%08x", val [0], val [1]);
+}
+
+static gchar *
+brasero_fanotify_handle_key (const void *fsid,
+			     const struct file_handle *handle)
+{
+	GString *key;
+	guint32 val [2];
+	guint i;
+
+	memcpy (val, fsid, sizeof (val));
+
+	key = g_string_sized_new (24 + handle->handle_bytes * 2);
+	g_string_printf (key, "%08x%08x:%x:", val [0], val [1], handle->handle_type);
+	for (i = 0; i < handle->handle_bytes; i ++)
+		g_string_append_printf (key, "%02x", handle->f_handle [i]);
+
+	return g_string_free (key, FALSE);
+}
+
+static gint
+brasero_fanotify_backend_lookup (BraseroFanotifyBackend *backend,
+				 struct fanotify_event_info_fid *info,
+				 gboolean has_name,
+				 const gchar **name)
+{
+	BraseroFanotifyDirectory *directory;
+	struct file_handle *handle;
+	gchar *key;
+
+	handle = (struct file_handle *) info->handle;
+
+	/* The name follows the handle; "." means the directory itself */
+	*name = NULL;
+	if (has_name) {
+		*name = (const gchar *) handle->f_handle + handle->handle_bytes;
+		if (!strcmp (*name, "."))
+			*name = NULL;
+	}
+
+	key = brasero_fanotify_handle_key (&info->fsid, handle);
+	directory = g_hash_table_lookup (backend->handles, key);
+	g_free (key);
+
+	return directory? directory->wd:0;
+}
+
+static void
+brasero_fanotify_backend_event (BraseroFanotifyBackend *backend,
+				gint wd,
+				guint32 mask,
+				guint32 cookie,
+				const gchar *name)
+{
+	union {
+		struct inotify_event event;
+		gchar buffer [sizeof (struct inotify_event) + NAME_MAX + 1];
+	} data;
+
+	/* Not a directory we're interested in */
+	if (!wd)
+		return;
+
+	memset (&data.event, 0, sizeof (data.event));
+	data.event.wd = wd;
+	data.event.mask = mask;
+	data.event.cookie = cookie;
+	if (name) {
+		data.event.len = strlen (name) + 1;
+		if (data.event.len > NAME_MAX + 1)
+			return;
+
+		memcpy (data.event.name, name, data.event.len);
+	}
+
+	brasero_file_monitor_event (backend->monitor, &data.event);
+}
+
+static guint32
+brasero_fanotify_backend_process (BraseroFanotifyBackend *backend,
+				  struct fanotify_event_metadata *metadata,
+				  guint32 cookie)
+{
+	const gchar *new_name = NULL;
+	const gchar *old_name = NULL;
+	const gchar *name = NULL;
+	guint32 next_cookie = 0;
+	gint new_wd = 0;
+	gint old_wd = 0;
+	guint32 isdir;
+	gint wd = 0;
+	gchar *info;
+	gchar *end;
+
+	if (metadata->fd >= 0)
+		close (metadata->fd);
+
+	if (metadata->mask & FAN_Q_OVERFLOW) {
+		BRASERO_BURN_LOG ("File Monitoring (fanotify events were lost)");
+		brasero_fanotify_backend_event (backend, -1, IN_Q_OVERFLOW, 0, NULL);
+		return 0;
+	}
+
+	/* Find the directory (or directories) the event happened in */
+	info = (gchar *) metadata + metadata->metadata_len;
+	end = (gchar *) metadata + metadata->event_len;
+	while (info + sizeof (struct fanotify_event_info_header) <= end) {
+		struct fanotify_event_info_header *header;
+
+		header = (struct fanotify_event_info_header *) info;
+		if (!header->len)
+			break;
+
+		switch (header->info_type) {
+		case FAN_EVENT_INFO_TYPE_DFID_NAME:
+			wd = brasero_fanotify_backend_lookup (backend, (gpointer) header, TRUE, &name);
+			break;
+		case FAN_EVENT_INFO_TYPE_DFID:
+			wd = brasero_fanotify_backend_lookup (backend, (gpointer) header, FALSE, &name);
+			break;
+#ifdef FAN_RENAME
+		case FAN_EVENT_INFO_TYPE_OLD_DFID_NAME:
+			old_wd = brasero_fanotify_backend_lookup (backend, (gpointer) header, TRUE, &old_name);
+			break;
+		case FAN_EVENT_INFO_TYPE_NEW_DFID_NAME:
+			new_wd = brasero_fanotify_backend_lookup (backend, (gpointer) header, TRUE, &new_name);
+			break;
+#endif
+		default:
+			break;
+		}
+
+		info += header->len;
+	}
+
+	isdir = (metadata->mask & FAN_ONDIR)? IN_ISDIR:0;
+
+	/* One event can hold several changes for the same file; give them
+	 * in an order that makes sense */
+	if (metadata->mask & FAN_CREATE)
+		brasero_fanotify_backend_event (backend, wd, IN_CREATE|isdir, 0, name);
+
+#ifdef FAN_RENAME
+	if (metadata->mask & FAN_RENAME) {
+		/* Both ends of the move are in the same event */
+		backend->cookie = backend->cookie + 1 ? backend->cookie + 1:1;
+		brasero_fanotify_backend_event (backend, old_wd, IN_MOVED_FROM|isdir, backend->cookie, old_name);
+		brasero_fanotify_backend_event (backend, new_wd, IN_MOVED_TO|isdir, backend->cookie, new_name);
+	}
+#endif
+
+	/* Without FAN_RENAME there are no cookies; a MOVED_TO right after a
+	 * MOVED_FROM is taken for the other end of the same move */
+	if (metadata->mask & FAN_MOVED_TO)
+		brasero_fanotify_backend_event (backend, wd, IN_MOVED_TO|isdir, cookie, name);
+
+	if (metadata->mask & FAN_MODIFY)
+		brasero_fanotify_backend_event (backend, wd, IN_MODIFY|isdir, 0, name);
+
+	if (metadata->mask & FAN_ATTRIB)
+		brasero_fanotify_backend_event (backend, wd, IN_ATTRIB|isdir, 0, name);
+
+	if (metadata->mask & FAN_MOVED_FROM) {
+		backend->cookie = backend->cookie + 1 ? backend->cookie + 1:1;
+		next_cookie = backend->cookie;
+		brasero_fanotify_backend_event (backend, wd, IN_MOVED_FROM|isdir, next_cookie, name);
+	}
+
+	if (metadata->mask & FAN_DELETE)
+		brasero_fanotify_backend_event (backend, wd, IN_DELETE|isdir, 0, name);
+
+	if (metadata->mask & FAN_DELETE_SELF)
+		brasero_fanotify_backend_event (backend, wd, IN_DELETE_SELF|isdir, 0, NULL);
+
+	if (metadata->mask & FAN_MOVE_SELF)
+		brasero_fanotify_backend_event (backend, wd, IN_MOVE_SELF|isdir, 0, NULL);
+
+	return next_cookie;
+}
+
+static gboolean
+brasero_fanotify_backend_monitor_cb (GIOChannel *channel,
+				     GIOCondition condition,
+				     BraseroFanotifyBackend *backend)
+{
+	/* NOTE: the buffer is on the stack since callbacks could run a
+	 * main loop and get us called again */
+	guint64 buffer [BRASERO_FANOTIFY_BUFFER_SIZE / sizeof (guint64)];
+	guint32 cookie = 0;
+	int dev_fd;
+
+	dev_fd = g_io_channel_unix_get_fd (channel);
+
+	brasero_file_monitor_changes_started (backend->monitor);
+	while (1) {
+		struct fanotify_event_metadata *metadata;
+		gssize size;
+
+		size = read (dev_fd, buffer, sizeof (buffer));
+		if (size < 0 && errno == EINTR)
+			continue;
+
+		if (size <= 0) {
+			if (size < 0 && errno != EAGAIN)
+				g_warning ("Error reading fanotify: %s", g_strerror (errno));
+			break;
+		}
+
+		metadata = (struct fanotify_event_metadata *) buffer;
+		while (FAN_EVENT_OK (metadata, size)) {
+			if (metadata->vers != FANOTIFY_METADATA_VERSION) {
+				g_warning ("Wrong fanotify metadata version");
+				break;
+			}
+
+			cookie = brasero_fanotify_backend_process (backend, metadata, cookie);
+			metadata = FAN_EVENT_NEXT (metadata, size);
+		}
+	}
+	brasero_file_monitor_changes_finished (backend->monitor);
+
+	return TRUE;
+}
+
+static gpointer
+brasero_fanotify_backend_open (BraseroFileMonitor *monitor)
+{
+	BraseroFanotifyBackend *backend;
+	guint32 mask;
+	int fd;
+
+	fd = fanotify_init (FAN_CLASS_NOTIF|FAN_REPORT_DFID_NAME|FAN_NONBLOCK|FAN_CLOEXEC,
+			    O_RDONLY|O_LARGEFILE);
+	if (fd == -1)
+		return NULL;
+
+	/* Make sure we are allowed to mark a whole filesystem and see whether
+	 * FAN_RENAME is supported (Linux 5.17) */
+#ifdef FAN_RENAME
+	mask = FAN_RENAME;
+	if (fanotify_mark (fd, FAN_MARK_ADD|FAN_MARK_FILESYSTEM, BRASERO_FANOTIFY_MASK|mask, AT_FDCWD, "/"))
+#endif
+	{
+		mask = FAN_MOVED_FROM|FAN_MOVED_TO;
+		if (fanotify_mark (fd, FAN_MARK_ADD|FAN_MARK_FILESYSTEM, BRASERO_FANOTIFY_MASK|mask, AT_FDCWD, "/")) {
+			BRASERO_BURN_LOG ("fanotify can't mark filesystems : %s", g_strerror (errno));
+			close (fd);
+			return NULL;
+		}
+	}
+	fanotify_mark (fd, FAN_MARK_REMOVE|FAN_MARK_FILESYSTEM, BRASERO_FANOTIFY_MASK|mask, AT_FDCWD, "/");
+
+	backend = g_new0 (BraseroFanotifyBackend, 1);
+	backend->monitor = monitor;
+	backend->mask = mask;
+	backend->last_wd = BRASERO_FILE_MONITOR_FANOTIFY_WD_BASE;
+
+	backend->filesystems = g_hash_table_new_full (g_str_hash,
+						      g_str_equal,
+						      g_free,
+						      (GDestroyNotify) brasero_fanotify_filesystem_free);
+	backend->handles = g_hash_table_new (g_str_hash, g_str_equal);
+	backend->wds = g_hash_table_new_full (g_direct_hash,
+					      g_direct_equal,
+					      NULL,
+					      (GDestroyNotify) brasero_fanotify_directory_free);
+
+	backend->channel = g_io_channel_unix_new (fd);
+	g_io_channel_set_encoding (backend->channel, NULL, NULL);
+	g_io_channel_set_close_on_unref (backend->channel, TRUE);
+	backend->id = g_io_add_watch (backend->channel,
+				      G_IO_IN | G_IO_HUP | G_IO_PRI,
+				      (GIOFunc) brasero_fanotify_backend_monitor_cb,
+				      backend);
+	g_io_channel_unref (backend->channel);
+
+	return backend;
+}
+
+static void
+brasero_fanotify_backend_close (gpointer data)
+{
+	BraseroFanotifyBackend *backend = data;
+
+	/* This closes the descriptor and removes all marks */
+	g_source_remove (backend->id);
+
+	g_hash_table_destroy (backend->handles);
+	g_hash_table_destroy (backend->wds);
+	g_hash_table_destroy (backend->filesystems);
+	g_free (backend);
+}
+
+static gint
+brasero_fanotify_backend_add_watch (gpointer data,
+				    const gchar *path)
+{
+	BraseroFanotifyBackend *backend = data;
+	BraseroFanotifyFilesystem *filesystem;
+	BraseroFanotifyDirectory *directory;
+	union {
+		struct file_handle handle;
+		gchar buffer [sizeof (struct file_handle) + MAX_HANDLE_SZ];
+	} handle;
+	struct statfs info;
+	gchar *fs_key;
+	gchar *key;
+	int mount_id;
+
+	if (statfs (path, &info))
+		return 0;
+
+	handle.handle.handle_bytes = MAX_HANDLE_SZ;
+	if (name_to_handle_at (AT_FDCWD, path, &handle.handle, &mount_id, 0))
+		return 0;
+
+	/* always return the same wd for the same directory */
+	key = brasero_fanotify_handle_key (&info.f_fsid, &handle.handle);
+	directory = g_hash_table_lookup (backend->handles, key);
+	if (directory) {
+		g_free (key);
+		return directory->wd;
+	}
+
+	/* One mark for all the directories of a filesystem */
+	fs_key = brasero_fanotify_filesystem_key (&info.f_fsid);
+	filesystem = g_hash_table_lookup (backend->filesystems, fs_key);
+	if (!filesystem) {
+		filesystem = g_new0 (BraseroFanotifyFilesystem, 1);
+		filesystem->path = g_strdup (path);
+		g_hash_table_insert (backend->filesystems, g_strdup (fs_key), filesystem);
+
+		if (fanotify_mark (g_io_channel_unix_get_fd (backend->channel),
+				   FAN_MARK_ADD|FAN_MARK_FILESYSTEM,
+				   BRASERO_FANOTIFY_MASK|backend->mask,
+				   AT_FDCWD,
+				   path)) {
+			/* Some filesystems (without fsid, network ones, ...)
+			 * can't be marked; remember it to fail right away */
+			BRASERO_BURN_LOG ("fanotify can't mark filesystem of %s : %s", path, g_strerror (errno));
+			filesystem->failed = TRUE;
+		}
+		else
+			BRASERO_BURN_LOG ("File Monitoring (fanotify marked filesystem of %s)", path);
+	}
+
+	if (filesystem->failed) {
+		g_free (fs_key);
+		g_free (key);
+		errno = EXDEV;
+		return 0;
+	}
+
+	filesystem->refs ++;
+
+	directory = g_new0 (BraseroFanotifyDirectory, 1);
+	directory->key = key;
+	directory->fs_key = fs_key;
+	directory->wd = ++ backend->last_wd;
+
+	g_hash_table_insert (backend->handles, directory->key, directory);
+	g_hash_table_insert (backend->wds, GINT_TO_POINTER (directory->wd), directory);
+	return directory->wd;
+}
+
+static void
+brasero_fanotify_backend_rm_watch (gpointer data,
+				   gint wd)
+{
+	BraseroFanotifyBackend *backend = data;
+	BraseroFanotifyFilesystem *filesystem;
+	BraseroFanotifyDirectory *directory;
+
+	directory = g_hash_table_lookup (backend->wds, GINT_TO_POINTER (wd));
+	if (!directory)
+		return;
+
+	/* Remove the mark once no directory of the filesystem is watched.
+	 * That can fail if the path used to mark it went away; the events are
+	 * ignored anyway since no handle matches. */
+	filesystem = g_hash_table_lookup (backend->filesystems, directory->fs_key);
+	if (filesystem && !(-- filesystem->refs)) {
+		fanotify_mark (g_io_channel_unix_get_fd (backend->channel),
+			       FAN_MARK_REMOVE|FAN_MARK_FILESYSTEM,
+			       BRASERO_FANOTIFY_MASK|backend->mask,
+			       AT_FDCWD,
+			       filesystem->path);
+		g_hash_table_remove (backend->filesystems, directory->fs_key);
+	}
+
+	g_hash_table_remove (backend->handles, directory->key);
+	g_hash_table_remove (backend->wds, GINT_TO_POINTER (wd));
+}
+
+const BraseroFileMonitorBackend brasero_file_monitor_fanotify_backend = {
+	"fanotify",
+	BRASERO_FILE_MONITOR_FANOTIFY_WD_BASE,
+	brasero_fanotify_backend_open,
+	brasero_fanotify_backend_close,
+	brasero_fanotify_backend_add_watch,
+	brasero_fanotify_backend_rm_watch
+};
+
+#else
+
+/* fanotify is missing or too old to report directory events */
+
+static gpointer
+brasero_fanotify_backend_open (BraseroFileMonitor *monitor)
+{
+	return NULL;
+}
+
+const BraseroFileMonitorBackend brasero_file_monitor_fanotify_backend = {
+	"fanotify",
+	BRASERO_FILE_MONITOR_FANOTIFY_WD_BASE,
+	brasero_fanotify_backend_open,
+	NULL,
+	NULL,
+	NULL
+};
+
+#endif
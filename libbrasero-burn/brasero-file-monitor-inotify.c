@@ -0,0 +1,177 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include <sys/inotify.h>
+
+#include "brasero-file-monitor-backend.h"
+#include "burn-debug.h"
+
+/* Enough for a few hundred events with their names */
+#define BRASERO_INOTIFY_BUFFER_SIZE	16384
+
+typedef struct _BraseroInotifyBackend BraseroInotifyBackend;
+struct _BraseroInotifyBackend {
+	BraseroFileMonitor *monitor;
+
+	GIOChannel *channel;
+	guint id;
+};
+
+static gboolean
+brasero_inotify_backend_monitor_cb (GIOChannel *channel,
+				    GIOCondition condition,
+				    BraseroInotifyBackend *backend)
+{
+	/* NOTE: the buffer is on the stack since callbacks could run a
+	 * main loop and get us called again */
+	guint32 buffer [BRASERO_INOTIFY_BUFFER_SIZE / sizeof (guint32)];
+	int dev_fd;
+
+	dev_fd = g_io_channel_unix_get_fd (channel);
+
+	/* Read as many events as possible at once (the descriptor is non
+	 * blocking) and deliver them as a single set of changes */
+	brasero_file_monitor_changes_started (backend->monitor);
+	while (1) {
+		gssize size;
+		gssize offset;
+
+		size = read (dev_fd, buffer, sizeof (buffer));
+		if (size < 0 && errno == EINTR)
+			continue;
+
+		if (size <= 0) {
+			if (size < 0 && errno != EAGAIN)
+				g_warning ("Error reading inotify: %s", g_strerror (errno));
+			break;
+		}
+
+		for (offset = 0; offset < size; ) {
+			struct inotify_event *event;
+
+			event = (struct inotify_event *) ((gchar *) buffer + offset);
+			offset += sizeof (struct inotify_event) + event->len;
+
+			brasero_file_monitor_event (backend->monitor, event);
+		}
+	}
+	brasero_file_monitor_changes_finished (backend->monitor);
+
+	return TRUE;
+}
+
+static gpointer
+brasero_inotify_backend_open (BraseroFileMonitor *monitor)
+{
+	BraseroInotifyBackend *backend;
+	int fd;
+
+	/* events are read in batches until there are no more so the
+	 * descriptor must not block */
+	fd = inotify_init1 (IN_NONBLOCK|IN_CLOEXEC);
+	if (fd == -1) {
+		g_warning ("Failed to open inotify: %s", g_strerror (errno));
+		return NULL;
+	}
+
+	backend = g_new0 (BraseroInotifyBackend, 1);
+	backend->monitor = monitor;
+
+	backend->channel = g_io_channel_unix_new (fd);
+	g_io_channel_set_encoding (backend->channel, NULL, NULL);
+	g_io_channel_set_close_on_unref (backend->channel, TRUE);
+	backend->id = g_io_add_watch (backend->channel,
+				      G_IO_IN | G_IO_HUP | G_IO_PRI,
+				      (GIOFunc) brasero_inotify_backend_monitor_cb,
+				      backend);
+	g_io_channel_unref (backend->channel);
+
+	return backend;
+}
+
+static void
+brasero_inotify_backend_close (gpointer data)
+{
+	BraseroInotifyBackend *backend = data;
+
+	/* This closes the descriptor as well */
+	g_source_remove (backend->id);
+	g_free (backend);
+}
+
+static gint
+brasero_inotify_backend_add_watch (gpointer data,
+				   const gchar *path)
+{
+	BraseroInotifyBackend *backend = data;
+	uint32_t mask;
+	int wd;
+
+	mask = IN_MODIFY |
+	       IN_ATTRIB |
+	       IN_MOVED_FROM |
+	       IN_MOVED_TO |
+	       IN_CREATE |
+	       IN_DELETE |
+	       IN_DELETE_SELF |
+	       IN_MOVE_SELF;
+
+	/* NOTE: inotify always returns the same wd for the same file.
+	 * ENOSPC means that max_user_watches was reached. */
+	wd = inotify_add_watch (g_io_channel_unix_get_fd (backend->channel), path, mask);
+	return wd > 0? wd:0;
+}
+
+static void
+brasero_inotify_backend_rm_watch (gpointer data,
+				  gint wd)
+{
+	BraseroInotifyBackend *backend = data;
+
+	inotify_rm_watch (g_io_channel_unix_get_fd (backend->channel), wd);
+}
+
+const BraseroFileMonitorBackend brasero_file_monitor_inotify_backend = {
+	"inotify",
+	BRASERO_FILE_MONITOR_INOTIFY_WD_BASE,
+	brasero_inotify_backend_open,
+	brasero_inotify_backend_close,
+	brasero_inotify_backend_add_watch,
+	brasero_inotify_backend_rm_watch
+};
@@ -0,0 +1,454 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <fcntl.h>
+
+#include <glib.h>
+
+#include "brasero-file-monitor-backend.h"
+#include "burn-debug.h"
+
+/* Polling is used for directories that neither fanotify nor inotify can
+ * watch (inotify ran out of watches for example). Directories are checked in
+ * turn, a few at a time so that huge projects don't stall the main loop. */
+
+/* in seconds */
+#define BRASERO_POLL_INTERVAL		2
+
+/* Maximum number of stat () calls per interval */
+#define BRASERO_POLL_BUDGET		4096
+
+typedef struct _BraseroPollDirectory BraseroPollDirectory;
+struct _BraseroPollDirectory {
+	gchar *path;
+	gint wd;
+
+	/* Link in the round robin queue */
+	GList *link;
+
+	/* Snapshot of the directory: sorted names packed one after the other
+	 * (each one NUL terminated) and a stamp per name to detect changes */
+	gint64 mtime;
+	gchar *names;
+	guint32 *stamps;
+	guint num;
+
+	guint gone:1;
+};
+
+typedef struct _BraseroPollBackend BraseroPollBackend;
+struct _BraseroPollBackend {
+	BraseroFileMonitor *monitor;
+
+	GHashTable *paths;
+	GHashTable *wds;
+	GQueue *queue;
+
+	gint last_wd;
+	guint id;
+};
+
+static void
+brasero_poll_directory_free (BraseroPollDirectory *directory)
+{
+	g_free (directory->path);
+	g_free (directory->names);
+	g_free (directory->stamps);
+	g_free (directory);
+}
+
+static gint64
+brasero_poll_directory_mtime (struct stat *info)
+{
+	return (gint64) info->st_mtim.tv_sec * G_USEC_PER_SEC + info->st_mtim.tv_nsec / 1000;
+}
+
+static guint32
+brasero_poll_stamp (int dir_fd,
+		    const gchar *name)
+{
+	struct stat info;
+	guint32 stamp;
+
+	if (fstatat (dir_fd, name, &info, AT_SYMLINK_NOFOLLOW))
+		return 0;
+
+	/* ctime changes with the contents and the attributes */
+	stamp = info.st_ctim.tv_sec;
+	stamp = stamp * 31 + info.st_ctim.tv_nsec;
+	stamp = stamp * 31 + info.st_size;
+	stamp = stamp * 31 + info.st_mode;
+	stamp = stamp * 31 + info.st_ino;
+	return stamp ? stamp:1;
+}
+
+static gint
+brasero_poll_compare_names (gconstpointer a,
+			    gconstpointer b)
+{
+	return strcmp (*(const gchar **) a, *(const gchar **) b);
+}
+
+/**
+ * Reads the names of the entries of a directory. If @names is not NULL they
+ * are used instead as the directory didn't change. The stamps are always
+ * updated. Returns the number of stat () calls.
+ */
+
+static guint
+brasero_poll_directory_read (const gchar *path,
+			     gchar **names,
+			     guint32 **stamps,
+			     guint *num)
+{
+	guint32 *new_stamps;
+	gchar *name;
+	DIR *dir;
+	guint i;
+
+	dir = opendir (path);
+	if (!dir)
+		return 0;
+
+	if (!*names) {
+		struct dirent *entry;
+		GPtrArray *array;
+		gsize size = 0;
+
+		array = g_ptr_array_new ();
+		while ((entry = readdir (dir))) {
+			if (!strcmp (entry->d_name, ".")
+			||  !strcmp (entry->d_name, ".."))
+				continue;
+
+			g_ptr_array_add (array, g_strdup (entry->d_name));
+			size += strlen (entry->d_name) + 1;
+		}
+
+		g_ptr_array_sort (array, brasero_poll_compare_names);
+
+		*num = array->len;
+		*names = g_malloc (size + 1);
+		for (name = *names, i = 0; i < array->len; i ++) {
+			name = g_stpcpy (name, g_ptr_array_index (array, i)) + 1;
+			g_free (g_ptr_array_index (array, i));
+		}
+		g_ptr_array_free (array, TRUE);
+	}
+
+	new_stamps = g_new (guint32, *num + 1);
+	for (name = *names, i = 0; i < *num; i ++) {
+		new_stamps [i] = brasero_poll_stamp (dirfd (dir), name);
+		name += strlen (name) + 1;
+	}
+
+	closedir (dir);
+
+	g_free (*stamps);
+	*stamps = new_stamps;
+
+	return *num + 1;
+}
+
+static void
+brasero_poll_queue_event (GByteArray *events,
+			  gint wd,
+			  guint32 mask,
+			  const gchar *name)
+{
+	struct inotify_event event;
+	gsize name_len = 0;
+
+	memset (&event, 0, sizeof (event));
+	event.wd = wd;
+	event.mask = mask;
+
+	/* Names are padded as inotify does to keep events aligned */
+	if (name) {
+		name_len = strlen (name) + 1;
+		event.len = (name_len + 3) & ~3;
+	}
+
+	g_byte_array_append (events, (guint8 *) &event, sizeof (event));
+	if (name) {
+		guint8 padding [4] = { 0, };
+
+		g_byte_array_append (events, (const guint8 *) name, name_len);
+		g_byte_array_append (events, padding, event.len - name_len);
+	}
+}
+
+static guint
+brasero_poll_directory_check (BraseroPollDirectory *directory,
+			      GByteArray *events)
+{
+	gchar *old_name, *new_name;
+	guint old_num, new_num;
+	guint32 *old_stamps;
+	gchar *old_names;
+	struct stat info;
+	guint cost;
+	guint i, j;
+
+	if (directory->gone)
+		return 0;
+
+	if (stat (directory->path, &info) || !S_ISDIR (info.st_mode)) {
+		brasero_poll_queue_event (events, directory->wd, IN_DELETE_SELF, NULL);
+		directory->gone = TRUE;
+		return 1;
+	}
+
+	old_names = directory->names;
+	old_stamps = directory->stamps;
+	old_num = directory->num;
+
+	/* The names only need to be read again when the directory changed */
+	if (brasero_poll_directory_mtime (&info) != directory->mtime)
+		directory->names = NULL;
+
+	directory->stamps = NULL;
+	cost = brasero_poll_directory_read (directory->path,
+					    &directory->names,
+					    &directory->stamps,
+					    &directory->num);
+	if (!directory->stamps) {
+		/* Unreadable; keep the old snapshot and try later */
+		directory->names = old_names;
+		directory->stamps = old_stamps;
+		directory->num = old_num;
+		return 1;
+	}
+
+	directory->mtime = brasero_poll_directory_mtime (&info);
+
+	/* Both snapshots are sorted so they are merged to find the entries
+	 * that were created, removed or changed. */
+	new_num = directory->num;
+	old_name = old_names;
+	new_name = directory->names;
+	for (i = 0, j = 0; i < old_num || j < new_num; ) {
+		gint result;
+
+		if (i >= old_num)
+			result = 1;
+		else if (j >= new_num)
+			result = -1;
+		else
+			result = strcmp (old_name, new_name);
+
+		if (result < 0) {
+			brasero_poll_queue_event (events, directory->wd, IN_DELETE, old_name);
+			old_name += strlen (old_name) + 1;
+			i ++;
+		}
+		else if (result > 0) {
+			brasero_poll_queue_event (events, directory->wd, IN_CREATE, new_name);
+			new_name += strlen (new_name) + 1;
+			j ++;
+		}
+		else {
+			if (old_stamps [i] != directory->stamps [j])
+				brasero_poll_queue_event (events, directory->wd, IN_MODIFY, new_name);
+
+			old_name += strlen (old_name) + 1;
+			new_name += strlen (new_name) + 1;
+			i ++;
+			j ++;
+		}
+	}
+
+	if (old_names != directory->names)
+		g_free (old_names);
+	g_free (old_stamps);
+
+	return cost + 1;
+}
+
+static gboolean
+brasero_poll_backend_timeout_cb (BraseroPollBackend *backend)
+{
+	GByteArray *events;
+	guint budget;
+	guint length;
+	guint offset;
+	guint i;
+
+	/* Go through as many directories as the budget allows starting where
+	 * we stopped last time */
+	events = g_byte_array_new ();
+	length = g_queue_get_length (backend->queue);
+	budget = BRASERO_POLL_BUDGET;
+	for (i = 0; i < length && budget > 0; i ++) {
+		GList *link;
+		guint cost;
+
+		link = g_queue_pop_head_link (backend->queue);
+		g_queue_push_tail_link (backend->queue, link);
+
+		cost = brasero_poll_directory_check (link->data, events);
+		budget -= MIN (budget, cost);
+	}
+
+	/* Events are only delivered now as the callbacks can remove watches */
+	if (events->len) {
+		brasero_file_monitor_changes_started (backend->monitor);
+		for (offset = 0; offset < events->len; ) {
+			struct inotify_event *event;
+
+			event = (struct inotify_event *) (events->data + offset);
+			offset += sizeof (struct inotify_event) + event->len;
+
+			brasero_file_monitor_event (backend->monitor, event);
+		}
+		brasero_file_monitor_changes_finished (backend->monitor);
+	}
+	g_byte_array_free (events, TRUE);
+
+	if (!g_queue_is_empty (backend->queue))
+		return TRUE;
+
+	backend->id = 0;
+	return FALSE;
+}
+
+static gpointer
+brasero_poll_backend_open (BraseroFileMonitor *monitor)
+{
+	BraseroPollBackend *backend;
+
+	backend = g_new0 (BraseroPollBackend, 1);
+	backend->monitor = monitor;
+	backend->last_wd = BRASERO_FILE_MONITOR_POLL_WD_BASE;
+	backend->paths = g_hash_table_new (g_str_hash, g_str_equal);
+	backend->wds = g_hash_table_new (g_direct_hash, g_direct_equal);
+	backend->queue = g_queue_new ();
+	return backend;
+}
+
+static void
+brasero_poll_backend_close (gpointer data)
+{
+	BraseroPollBackend *backend = data;
+
+	if (backend->id)
+		g_source_remove (backend->id);
+
+	g_queue_foreach (backend->queue, (GFunc) brasero_poll_directory_free, NULL);
+	g_queue_free (backend->queue);
+	g_hash_table_destroy (backend->paths);
+	g_hash_table_destroy (backend->wds);
+	g_free (backend);
+}
+
+static gint
+brasero_poll_backend_add_watch (gpointer data,
+				const gchar *path)
+{
+	BraseroPollBackend *backend = data;
+	BraseroPollDirectory *directory;
+	struct stat info;
+
+	directory = g_hash_table_lookup (backend->paths, path);
+	if (directory)
+		return directory->wd;
+
+	if (stat (path, &info))
+		return 0;
+
+	if (!S_ISDIR (info.st_mode)) {
+		errno = ENOTDIR;
+		return 0;
+	}
+
+	directory = g_new0 (BraseroPollDirectory, 1);
+	directory->mtime = brasero_poll_directory_mtime (&info);
+	brasero_poll_directory_read (path,
+				     &directory->names,
+				     &directory->stamps,
+				     &directory->num);
+	if (!directory->stamps) {
+		brasero_poll_directory_free (directory);
+		return 0;
+	}
+
+	directory->path = g_strdup (path);
+	directory->wd = ++ backend->last_wd;
+
+	g_queue_push_tail (backend->queue, directory);
+	directory->link = backend->queue->tail;
+
+	g_hash_table_insert (backend->paths, directory->path, directory);
+	g_hash_table_insert (backend->wds, GINT_TO_POINTER (directory->wd), directory);
+
+	BRASERO_BURN_LOG ("File Monitoring (polling %s)", path);
+
+	if (!backend->id)
+		backend->id = g_timeout_add_seconds (BRASERO_POLL_INTERVAL,
+						     (GSourceFunc) brasero_poll_backend_timeout_cb,
+						     backend);
+	return directory->wd;
+}
+
+static void
+brasero_poll_backend_rm_watch (gpointer data,
+			       gint wd)
+{
+	BraseroPollBackend *backend = data;
+	BraseroPollDirectory *directory;
+
+	directory = g_hash_table_lookup (backend->wds, GINT_TO_POINTER (wd));
+	if (!directory)
+		return;
+
+	g_hash_table_remove (backend->wds, GINT_TO_POINTER (wd));
+	g_hash_table_remove (backend->paths, directory->path);
+	g_queue_delete_link (backend->queue, directory->link);
+	brasero_poll_directory_free (directory);
+}
+
+const BraseroFileMonitorBackend brasero_file_monitor_poll_backend = {
+	"polling",
+	BRASERO_FILE_MONITOR_POLL_WD_BASE,
+	brasero_poll_backend_open,
+	brasero_poll_backend_close,
+	brasero_poll_backend_add_watch,
+	brasero_poll_backend_rm_watch
+};
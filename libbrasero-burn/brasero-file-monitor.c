@@ -38,18 +38,22 @@
 #include <glib.h>
 #include <glib/gi18n-lib.h>
 
-#include <sys/inotify.h>
-
 #include "brasero-file-monitor.h"
+#include "brasero-file-monitor-backend.h"
 #include "burn-debug.h"
 
 #include "brasero-file-node.h"
 
+#define BRASERO_FILE_MONITOR_BACKEND_NUM	3
+
 typedef struct _BraseroFileMonitorPrivate BraseroFileMonitorPrivate;
 struct _BraseroFileMonitorPrivate
 {
-	int notify_id;
-	GIOChannel *notify;
+	/* The backends that could be opened in order of preference. When one
+	 * can't watch a directory the next one is tried. */
+	const BraseroFileMonitorBackend *backends [BRASERO_FILE_MONITOR_BACKEND_NUM];
+	gpointer backends_data [BRASERO_FILE_MONITOR_BACKEND_NUM];
+	guint backends_num;
 
 	/* In this hash are files/directories we watch individually */
 	GHashTable *files;
@@ -57,23 +61,52 @@ struct _BraseroFileMonitorPrivate
 	/* In this hash are directories whose contents are monitored */
 	GHashTable *directories;
 
-	/* This is used in the case of a MOVE_FROM event */
-	GSList *moved_list;
+	/* This is used in the case of a MOVED_FROM event; the queue keeps
+	 * them in the order they arrived and the hash indexes them by
+	 * cookie. A single timeout expires those that weren't paired. */
+	GQueue *moved_queue;
+	GHashTable *moved;
+	guint moved_id;
+
+	/* MODIFY and ATTRIB events are merged per file and delivered after
+	 * a short delay as they usually come in storms */
+	GQueue *modified_queue;
+	GHashTable *modified;
+	guint modified_id;
 };
 
 #define BRASERO_FILE_MONITOR_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_FILE_MONITOR, BraseroFileMonitorPrivate))
 
 G_DEFINE_TYPE (BraseroFileMonitor, brasero_file_monitor, G_TYPE_OBJECT);
 
+static const BraseroFileMonitorBackend *file_monitor_backends [] = {
+	&brasero_file_monitor_fanotify_backend,
+	&brasero_file_monitor_inotify_backend,
+	&brasero_file_monitor_poll_backend,
+	NULL
+};
+
+/* in seconds */
+#define BRASERO_FILE_MONITOR_MOVE_TIMEOUT	5
+
+/* in milliseconds */
+#define BRASERO_FILE_MONITOR_MODIFY_DELAY	250
+
 struct _BraseroInotifyMovedData {
 	gchar *name;
 	BraseroFileMonitorType type;
 	gpointer callback_data;
 	guint32 cookie;
-	gint id;
+	gint64 time;
 };
 typedef struct _BraseroInotifyMovedData BraseroInotifyMovedData;
 
+struct _BraseroInotifyModifiedData {
+	gpointer callback_data;
+	gchar *name;
+};
+typedef struct _BraseroInotifyModifiedData BraseroInotifyModifiedData;
+
 struct _BraseroInotifyFileData {
 	gpointer callback_data;
 	gchar *name;
@@ -84,7 +117,7 @@ struct _BraseroFileMonitorCancelForeach {
 	gpointer callback_data;
 	BraseroMonitorFindFunc func;
 
-	int dev_fd;
+	BraseroFileMonitor *monitor;
 
 	GSList *results;
 };
@@ -103,6 +136,238 @@ brasero_inotify_file_data_free (BraseroInotifyFileData *data)
 	g_free (data);
 }
 
+static void
+brasero_inotify_moved_data_free (BraseroInotifyMovedData *data)
+{
+	g_free (data->name);
+	g_free (data);
+}
+
+static void
+brasero_inotify_modified_data_free (BraseroInotifyModifiedData *data)
+{
+	g_free (data->name);
+	g_free (data);
+}
+
+static guint
+brasero_inotify_modified_hash (gconstpointer key)
+{
+	const BraseroInotifyModifiedData *data = key;
+
+	return g_direct_hash (data->callback_data) ^ (data->name ? g_str_hash (data->name):0);
+}
+
+static gboolean
+brasero_inotify_modified_equal (gconstpointer a,
+				gconstpointer b)
+{
+	const BraseroInotifyModifiedData *data_a = a;
+	const BraseroInotifyModifiedData *data_b = b;
+
+	return data_a->callback_data == data_b->callback_data
+	   && !g_strcmp0 (data_a->name, data_b->name);
+}
+
+void
+brasero_file_monitor_changes_started (BraseroFileMonitor *self)
+{
+	BraseroFileMonitorClass *klass;
+
+	klass = BRASERO_FILE_MONITOR_GET_CLASS (self);
+	if (klass->changes_started)
+		klass->changes_started (self);
+}
+
+void
+brasero_file_monitor_changes_finished (BraseroFileMonitor *self)
+{
+	BraseroFileMonitorClass *klass;
+
+	klass = BRASERO_FILE_MONITOR_GET_CLASS (self);
+	if (klass->changes_finished)
+		klass->changes_finished (self);
+}
+
+static void
+brasero_file_monitor_rm_watch (BraseroFileMonitor *self,
+			       gint wd)
+{
+	BraseroFileMonitorPrivate *priv;
+	gint found = -1;
+	guint i;
+
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+
+	/* Find the backend the descriptor range belongs to */
+	for (i = 0; i < priv->backends_num; i ++) {
+		if (wd <= priv->backends [i]->wd_base)
+			continue;
+
+		if (found < 0 || priv->backends [i]->wd_base > priv->backends [found]->wd_base)
+			found = i;
+	}
+
+	if (found >= 0)
+		priv->backends [found]->rm_watch (priv->backends_data [found], wd);
+}
+
+static gboolean
+brasero_file_monitor_modified_timeout_cb (BraseroFileMonitor *self)
+{
+	BraseroInotifyModifiedData *data;
+	BraseroFileMonitorPrivate *priv;
+	BraseroFileMonitorClass *klass;
+
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+	klass = BRASERO_FILE_MONITOR_GET_CLASS (self);
+
+	priv->modified_id = 0;
+
+	brasero_file_monitor_changes_started (self);
+	while ((data = g_queue_pop_head (priv->modified_queue))) {
+		g_hash_table_remove (priv->modified, data);
+
+		if (klass->file_modified)
+			klass->file_modified (self, data->callback_data, data->name);
+
+		brasero_inotify_modified_data_free (data);
+	}
+	brasero_file_monitor_changes_finished (self);
+
+	return FALSE;
+}
+
+static void
+brasero_file_monitor_modified_event (BraseroFileMonitor *self,
+				     gpointer callback_data,
+				     const gchar *name)
+{
+	BraseroInotifyModifiedData *data;
+	BraseroFileMonitorPrivate *priv;
+	BraseroInotifyModifiedData key;
+
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+
+	key.callback_data = callback_data;
+	key.name = (gchar *) name;
+	if (g_hash_table_lookup (priv->modified, &key))
+		return;
+
+	data = g_new0 (BraseroInotifyModifiedData, 1);
+	data->callback_data = callback_data;
+	data->name = g_strdup (name);
+
+	g_queue_push_tail (priv->modified_queue, data);
+	g_hash_table_insert (priv->modified, data, priv->modified_queue->tail);
+
+	if (!priv->modified_id)
+		priv->modified_id = g_timeout_add (BRASERO_FILE_MONITOR_MODIFY_DELAY,
+						   (GSourceFunc) brasero_file_monitor_modified_timeout_cb,
+						   self);
+}
+
+/**
+ * Removes a pending modification for a file. It is delivered right away if
+ * @deliver is TRUE (before the file is moved for example) or dropped.
+ */
+static void
+brasero_file_monitor_modified_take (BraseroFileMonitor *self,
+				    gpointer callback_data,
+				    const gchar *name,
+				    gboolean deliver)
+{
+	BraseroInotifyModifiedData *data;
+	BraseroFileMonitorPrivate *priv;
+	BraseroInotifyModifiedData key;
+	GList *link;
+
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+
+	key.callback_data = callback_data;
+	key.name = (gchar *) name;
+	link = g_hash_table_lookup (priv->modified, &key);
+	if (!link)
+		return;
+
+	data = link->data;
+	g_hash_table_remove (priv->modified, data);
+	g_queue_delete_link (priv->modified_queue, link);
+
+	if (deliver) {
+		BraseroFileMonitorClass *klass;
+
+		klass = BRASERO_FILE_MONITOR_GET_CLASS (self);
+		if (klass->file_modified)
+			klass->file_modified (self, data->callback_data, data->name);
+	}
+
+	brasero_inotify_modified_data_free (data);
+}
+
+static void
+brasero_file_monitor_modified_clear (BraseroFileMonitor *self)
+{
+	BraseroFileMonitorPrivate *priv;
+
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+
+	if (priv->modified_id) {
+		g_source_remove (priv->modified_id);
+		priv->modified_id = 0;
+	}
+
+	g_hash_table_remove_all (priv->modified);
+	g_queue_foreach (priv->modified_queue, (GFunc) brasero_inotify_modified_data_free, NULL);
+	g_queue_clear (priv->modified_queue);
+}
+
+static GList *
+brasero_file_monitor_moved_lookup (BraseroFileMonitor *self,
+				   guint32 cookie)
+{
+	BraseroFileMonitorPrivate *priv;
+
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+	return g_hash_table_lookup (priv->moved, GUINT_TO_POINTER (cookie));
+}
+
+static BraseroInotifyMovedData *
+brasero_file_monitor_moved_steal (BraseroFileMonitor *self,
+				  GList *link)
+{
+	BraseroInotifyMovedData *data;
+	BraseroFileMonitorPrivate *priv;
+
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+
+	data = link->data;
+
+	/* Another MOVED_FROM event may have reused the cookie */
+	if (g_hash_table_lookup (priv->moved, GUINT_TO_POINTER (data->cookie)) == link)
+		g_hash_table_remove (priv->moved, GUINT_TO_POINTER (data->cookie));
+
+	g_queue_delete_link (priv->moved_queue, link);
+	return data;
+}
+
+static void
+brasero_file_monitor_moved_clear (BraseroFileMonitor *self)
+{
+	BraseroFileMonitorPrivate *priv;
+
+	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+
+	if (priv->moved_id) {
+		g_source_remove (priv->moved_id);
+		priv->moved_id = 0;
+	}
+
+	g_hash_table_remove_all (priv->moved);
+	g_queue_foreach (priv->moved_queue, (GFunc) brasero_inotify_moved_data_free, NULL);
+	g_queue_clear (priv->moved_queue);
+}
+
 static void
 brasero_file_monitor_moved_to_event (BraseroFileMonitor *self,
 				     gpointer callback_data,
@@ -110,11 +375,9 @@ brasero_file_monitor_moved_to_event (BraseroFileMonitor *self,
 				     guint32 cookie)
 {
 	BraseroInotifyMovedData *data = NULL;
-	BraseroFileMonitorPrivate *priv;
 	BraseroFileMonitorClass *klass;
-	GSList *iter;
+	GList *link;
 
-	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
 	klass = BRASERO_FILE_MONITOR_GET_CLASS (self);
 
 	BRASERO_BURN_LOG ("File Monitoring (move to for %s)", name);
@@ -126,21 +389,18 @@ brasero_file_monitor_moved_to_event (BraseroFileMonitor *self,
 	}
 
 	/* look for a matching cookie */
-	for (iter = priv->moved_list; iter; iter = iter->next) {
-		data = iter->data;
-		if (data->cookie == cookie)
-			break;
-		data = NULL;
-	}
-
-	if (!data) {
-		/* It was moved from outside the project since there 
+	link = brasero_file_monitor_moved_lookup (self, cookie);
+	if (!link) {
+		/* It was moved from outside the project since there
 		 * was no moved_from event from a watched directory */
 		if (klass->file_added)
 			klass->file_added (self, callback_data, name);
 		return;
 	}
 
+	/* remove the event from the queue */
+	data = brasero_file_monitor_moved_steal (self, link);
+
 	/* we need to see if it's simple renaming or a real move of a file in
 	 * another directory. In the case of a move we can't decide where an
 	 * old path (and all its children grafts) should go */
@@ -170,38 +430,51 @@ brasero_file_monitor_moved_to_event (BraseroFileMonitor *self,
 					   name);
 	}
 
-	/* remove the event from the queue */
-	priv->moved_list = g_slist_remove (priv->moved_list, data);
-	g_source_remove (data->id);
-	g_free (data->name);
-	g_free (data);
+	brasero_inotify_moved_data_free (data);
 }
 
 static gboolean
 brasero_file_monitor_move_timeout_cb (BraseroFileMonitor *self)
 {
-	BraseroInotifyMovedData *data;
 	BraseroFileMonitorPrivate *priv;
 	BraseroFileMonitorClass *klass;
+	gint64 now;
 
 	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
 	klass = BRASERO_FILE_MONITOR_GET_CLASS (self);
 
-	/* an IN_MOVED_FROM timed out. It is the first in the queue. */
-	data = priv->moved_list->data;
-	priv->moved_list = g_slist_remove (priv->moved_list, data);
+	now = g_get_monotonic_time ();
+
+	brasero_file_monitor_changes_started (self);
 
-	BRASERO_BURN_LOG ("File Monitoring (move timeout for %s)", data->name);
+	/* IN_MOVED_FROM events that timed out are the first in the queue */
+	while (!g_queue_is_empty (priv->moved_queue)) {
+		BraseroInotifyMovedData *data;
 
-	if (klass->file_removed)
-		klass->file_removed (self,
-				     data->type,
-				     data->callback_data,
-				     data->name);
+		data = g_queue_peek_head (priv->moved_queue);
+		if (now - data->time < BRASERO_FILE_MONITOR_MOVE_TIMEOUT * G_USEC_PER_SEC)
+			break;
 
-	/* clean up */
-	g_free (data->name);
-	g_free (data);
+		data = brasero_file_monitor_moved_steal (self, priv->moved_queue->head);
+
+		BRASERO_BURN_LOG ("File Monitoring (move timeout for %s)", data->name);
+
+		if (klass->file_removed)
+			klass->file_removed (self,
+					     data->type,
+					     data->callback_data,
+					     data->name);
+
+		/* clean up */
+		brasero_inotify_moved_data_free (data);
+	}
+
+	brasero_file_monitor_changes_finished (self);
+
+	if (!g_queue_is_empty (priv->moved_queue))
+		return TRUE;
+
+	priv->moved_id = 0;
 	return FALSE;
 }
 
@@ -219,6 +492,14 @@ brasero_file_monitor_moved_from_event (BraseroFileMonitor *self,
 
 	BRASERO_BURN_LOG ("File Monitoring (moved from event for %s)", name);
 
+	/* Deliver any pending modification while the file can still be found
+	 * with its old name. Modifications for single files are recorded
+	 * without a name (see brasero_file_monitor_inotify_file_event ()). */
+	brasero_file_monitor_modified_take (self,
+					    callback_data,
+					    type == BRASERO_FILE_MONITOR_FILE? NULL:name,
+					    cookie != 0);
+
 	if (!cookie) {
 		BraseroFileMonitorClass *klass;
 
@@ -236,15 +517,20 @@ brasero_file_monitor_moved_from_event (BraseroFileMonitor *self,
 	data->cookie = cookie;
 	data->name = g_strdup (name);
 	data->callback_data = callback_data;
-			
-	/* we remember this move for 5s. If 5s later we haven't received
-	 * a corresponding MOVED_TO then we consider the file was removed. */
-	data->id = g_timeout_add_seconds (5,
-					  (GSourceFunc) brasero_file_monitor_move_timeout_cb,
-					  self);
+	data->time = g_get_monotonic_time ();
 
-	/* NOTE: the order is important, we _must_ append them */
-	priv->moved_list = g_slist_append (priv->moved_list, data);
+	/* we remember this move for 5s. If 5s later we haven't received
+	 * a corresponding MOVED_TO then we consider the file was removed.
+	 * NOTE: the order is important, we _must_ append them */
+	g_queue_push_tail (priv->moved_queue, data);
+	g_hash_table_insert (priv->moved,
+			     GUINT_TO_POINTER (cookie),
+			     priv->moved_queue->tail);
+
+	if (!priv->moved_id)
+		priv->moved_id = g_timeout_add_seconds (1,
+							(GSourceFunc) brasero_file_monitor_move_timeout_cb,
+							self);
 }
 
 static void
@@ -265,13 +551,11 @@ brasero_file_monitor_directory_event (BraseroFileMonitor *self,
 	 * IN_DELETE_SELF or IN_MOVE_SELF are therefore not possible here. */
 	if (event->mask & IN_ATTRIB) {
 		BRASERO_BURN_LOG ("File Monitoring (attributes changed for %s)", name);
-		if (klass->file_modified)
-			klass->file_modified (self, callback_data, name);
+		brasero_file_monitor_modified_event (self, callback_data, name);
 	}
 	else if (event->mask & IN_MODIFY) {
 		BRASERO_BURN_LOG ("File Monitoring (modified for %s)", name);
-		if (klass->file_modified)
-			klass->file_modified (self, callback_data, name);
+		brasero_file_monitor_modified_event (self, callback_data, name);
 	}
 	else if (event->mask & IN_MOVED_FROM) {
 		BRASERO_BURN_LOG ("File Monitoring (moved from for %s)", name);
@@ -283,6 +567,7 @@ brasero_file_monitor_directory_event (BraseroFileMonitor *self,
 	}
 	else if (event->mask & (IN_DELETE|IN_UNMOUNT)) {
 		BRASERO_BURN_LOG ("File Monitoring (delete/unmount for %s)", name);
+		brasero_file_monitor_modified_take (self, callback_data, name, FALSE);
 		if (klass->file_removed)
 			klass->file_removed (self,
 					     type,
@@ -311,7 +596,7 @@ brasero_file_monitor_inotify_file_event (BraseroFileMonitor *self,
 	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
 
 	/* this is a dummy directory used to watch top files so we check
-	 * that the file for which that event happened is indeed in 
+	 * that the file for which that event happened is indeed in
 	 * our selection whether as a single file or as a top directory.
 	 * NOTE: since these dummy directories are the real top directories
 	 * that's the only case where we treat SELF events, otherwise
@@ -326,6 +611,7 @@ brasero_file_monitor_inotify_file_event (BraseroFileMonitor *self,
 			for (iter = list; iter; iter = iter->next) {
 				data = iter->data;
 
+				brasero_file_monitor_modified_take (self, data->callback_data, NULL, FALSE);
 				if (klass->file_removed)
 					klass->file_removed (self,
 							     BRASERO_FILE_MONITOR_FILE,
@@ -337,17 +623,16 @@ brasero_file_monitor_inotify_file_event (BraseroFileMonitor *self,
 
 			g_slist_free (list);
 			g_hash_table_remove (priv->files, GINT_TO_POINTER (event->wd));
+			brasero_file_monitor_rm_watch (self, event->wd);
 		}
 		else if (event->mask & IN_ATTRIB) {
 			/* This is just in case this directory
 			 * would become unreadable */
 			for (iter = list; iter; iter = iter->next) {
 				data = iter->data;
-
-				if (klass->file_modified)
-					klass->file_modified (self,
-							      data->callback_data,
-							      NULL);
+				brasero_file_monitor_modified_event (self,
+								     data->callback_data,
+								     NULL);
 			}
 		}
 
@@ -356,25 +641,22 @@ brasero_file_monitor_inotify_file_event (BraseroFileMonitor *self,
 
 	if (event->mask & IN_MOVED_TO) {
 		BraseroInotifyMovedData *moved_data = NULL;
+		GList *link;
 		GSList *iter;
 
 		/* The problem here is that we don't know yet which structure
 		 * in the list was moved from in the first place. */
 
 		/* look for a matching cookie */
-		for (iter = priv->moved_list; iter; iter = iter->next) {
-			moved_data = iter->data;
-			if (moved_data->cookie == event->cookie)
-				break;
-
-			moved_data = NULL;
-		}
-
-		if (!moved_data) {
+		link = brasero_file_monitor_moved_lookup (self, event->cookie);
+		if (!link) {
 			/* that wasn't one of ours */
 			return;
 		}
 
+		/* remove the event from the queue */
+		moved_data = brasero_file_monitor_moved_steal (self, link);
+
 		if (moved_data->type == BRASERO_FILE_MONITOR_FOLDER) {
 			BraseroFileMonitorClass *klass;
 
@@ -426,11 +708,7 @@ brasero_file_monitor_inotify_file_event (BraseroFileMonitor *self,
 			}
 		}
 
-		/* remove the event from the queue */
-		priv->moved_list = g_slist_remove (priv->moved_list, moved_data);
-		g_source_remove (moved_data->id);
-		g_free (moved_data->name);
-		g_free (moved_data);
+		brasero_inotify_moved_data_free (moved_data);
 		return;
 	}
 
@@ -471,113 +749,77 @@ brasero_file_monitor_inotify_file_event (BraseroFileMonitor *self,
 					      event);
 }
 
-static gboolean
-brasero_file_monitor_inotify_monitor_cb (GIOChannel *channel,
-					 GIOCondition condition,
-					 BraseroFileMonitor *self)
+void
+brasero_file_monitor_event (BraseroFileMonitor *self,
+			    struct inotify_event *event)
 {
 	BraseroFileMonitorPrivate *priv;
-	struct inotify_event event;
 	gpointer callback_data;
-	GError *err = NULL;
-	GIOStatus status;
-	gchar *name;
-	gsize size;
+	const gchar *name;
 
 	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
-	while (condition & G_IO_IN) {
-		callback_data = NULL;
-
-		status = g_io_channel_read_chars (channel,
-						  (char *) &event,
-						  sizeof (struct inotify_event),
-						  &size, &err);
-		if (status == G_IO_STATUS_EOF)
-			return TRUE;
-
-		if (event.len) {
-			name = g_new (char, event.len + 1);
-
-			name [event.len] = '\0';
-
-			status = g_io_channel_read_chars (channel,
-							  name,
-							  event.len,
-							  &size,
-							  &err);
-			if (status != G_IO_STATUS_NORMAL) {
-				g_warning ("Error reading inotify: %s\n",
-					   err ? "Unknown error" : err->message);
-				g_error_free (err);
-				return TRUE;
-			}
-		}
-		else
-			name = NULL;
 
-		/* look for ignored signal usually following deletion */
-		if (event.mask & IN_IGNORED) {
-			GSList *list;
+	if (event->mask & IN_Q_OVERFLOW) {
+		BraseroFileMonitorClass *klass;
 
-			list = g_hash_table_lookup (priv->files, GINT_TO_POINTER (event.wd));
-			if (list) {
-				g_slist_foreach (list, (GFunc) g_free, NULL);
-				g_slist_free (list);
-				g_hash_table_remove (priv->files, GINT_TO_POINTER (event.wd));
-			}
+		BRASERO_BURN_LOG ("File Monitoring (events were lost)");
+
+		klass = BRASERO_FILE_MONITOR_GET_CLASS (self);
+		if (klass->events_lost)
+			klass->events_lost (self);
+		return;
+	}
 
-			g_hash_table_remove (priv->directories, GINT_TO_POINTER (event.wd));
+	/* The name is NUL terminated (and padded) in the buffer */
+	name = event->len ? event->name : NULL;
 
-			if (name) {
-				g_free (name);
-				name = NULL;
-			}
+	/* look for ignored signal usually following deletion */
+	if (event->mask & IN_IGNORED) {
+		GSList *list;
 
-			condition = g_io_channel_get_buffer_condition (channel);
-			continue;
+		list = g_hash_table_lookup (priv->files, GINT_TO_POINTER (event->wd));
+		if (list) {
+			g_slist_foreach (list, (GFunc) g_free, NULL);
+			g_slist_free (list);
+			g_hash_table_remove (priv->files, GINT_TO_POINTER (event->wd));
 		}
 
-		callback_data = g_hash_table_lookup (priv->files, GINT_TO_POINTER (event.wd));
-		if (!callback_data) {
-			/* Retry with children */
-			callback_data = g_hash_table_lookup (priv->directories, GINT_TO_POINTER (event.wd));
-			if (name && callback_data) {
-				/* For directories we don't take heed of the SELF events.
-				 * All events are treated through the parent directory
-				 * events. */
-				brasero_file_monitor_directory_event (self,
-								      BRASERO_FILE_MONITOR_FOLDER,
-								      callback_data,
-								      name,
-								      &event);
-			}
-			else {
-				int dev_fd;
+		g_hash_table_remove (priv->directories, GINT_TO_POINTER (event->wd));
+		return;
+	}
 
-				dev_fd = g_io_channel_unix_get_fd (channel);
-				inotify_rm_watch (dev_fd, event.wd);
-			}
+	callback_data = g_hash_table_lookup (priv->files, GINT_TO_POINTER (event->wd));
+	if (!callback_data) {
+		/* Retry with children */
+		callback_data = g_hash_table_lookup (priv->directories, GINT_TO_POINTER (event->wd));
+		if (name && callback_data) {
+			/* For directories we don't take heed of the SELF events.
+			 * All events are treated through the parent directory
+			 * events. */
+			brasero_file_monitor_directory_event (self,
+							      BRASERO_FILE_MONITOR_FOLDER,
+							      callback_data,
+							      name,
+							      event);
 		}
 		else {
-			GSList *list;
-
-			/* This is an event happening on the top directory there */
-			list = callback_data;
-			brasero_file_monitor_inotify_file_event (self,
-								 list,
-								 name,
-								 &event);
-		}
+			/* Not all backends send IN_IGNORED afterwards */
+			if (callback_data)
+				g_hash_table_remove (priv->directories, GINT_TO_POINTER (event->wd));
 
-		if (name) {
-			g_free (name);
-			name = NULL;
+			brasero_file_monitor_rm_watch (self, event->wd);
 		}
-
-		condition = g_io_channel_get_buffer_condition (channel);
 	}
+	else {
+		GSList *list;
 
-	return TRUE;
+		/* This is an event happening on the top directory there */
+		list = callback_data;
+		brasero_file_monitor_inotify_file_event (self,
+							 list,
+							 name,
+							 event);
+	}
 }
 
 static guint32
@@ -587,9 +829,8 @@ brasero_file_monitor_start_monitoring_real (BraseroFileMonitor *self,
 	BraseroFileMonitorPrivate *priv;
 	gchar *unescaped_uri;
 	gchar *path;
-	gint dev_fd;
-	uint32_t mask;
-	uint32_t wd;
+	gint wd = 0;
+	guint i;
 
 	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
 
@@ -597,28 +838,26 @@ brasero_file_monitor_start_monitoring_real (BraseroFileMonitor *self,
 	path = g_filename_from_uri (unescaped_uri, NULL, NULL);
 	g_free (unescaped_uri);
 
-	dev_fd = g_io_channel_unix_get_fd (priv->notify);
-	mask = IN_MODIFY |
-	       IN_ATTRIB |
-	       IN_MOVED_FROM |
-	       IN_MOVED_TO |
-	       IN_CREATE |
-	       IN_DELETE |
-	       IN_DELETE_SELF |
-	       IN_MOVE_SELF;
-
-	/* NOTE: always return the same wd when we ask for the same file */
-	wd = inotify_add_watch (dev_fd, path, mask);
-	if (wd == -1) {
-		BRASERO_BURN_LOG ("ERROR creating watch for local file %s : %s\n",
+	/* NOTE: backends always return the same wd for the same directory.
+	 * If one can't watch it (inotify ran out of watches, fanotify doesn't
+	 * support that filesystem, ...) try the next one. */
+	for (i = 0; i < priv->backends_num; i ++) {
+		wd = priv->backends [i]->add_watch (priv->backends_data [i], path);
+		if (wd > 0)
+			break;
+
+		BRASERO_BURN_LOG ("ERROR creating %s watch for local file %s : %s\n",
+				  priv->backends [i]->name,
 				  path,
 				  g_strerror (errno));
-		g_free (path);
-		return 0;
+
+		/* No need to try further if the directory doesn't exist */
+		if (errno == ENOENT || errno == ENOTDIR)
+			break;
 	}
 
 	g_free (path);
-	return wd;
+	return wd > 0? wd:0;
 }
 
 /**
@@ -640,7 +879,7 @@ brasero_file_monitor_single_file (BraseroFileMonitor *self,
 	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
 
 	/* we want local URIs */
-	if (!priv->notify || strncmp (uri, "file://", 7))
+	if (!priv->backends_num || strncmp (uri, "file://", 7))
 		return FALSE;
 
 	/* Start with the parent */
@@ -658,7 +897,7 @@ brasero_file_monitor_single_file (BraseroFileMonitor *self,
 	data->name = g_file_get_basename (file);
 	g_object_unref (file);
 
-	/* inotify always return the same wd for the same file */
+	/* backends always return the same wd for the same file */
 	list = g_hash_table_lookup (priv->files, GINT_TO_POINTER (wd));
 	list = g_slist_prepend (list, data);
 	g_hash_table_insert (priv->files,
@@ -682,7 +921,7 @@ brasero_file_monitor_directory_contents (BraseroFileMonitor *self,
 	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
 
 	/* we want local URIs */
-	if (!priv->notify || strncmp (uri, "file://", 7))
+	if (!priv->backends_num || strncmp (uri, "file://", 7))
 		return FALSE;
 
 	/* we only monitor directories. Files are watched through their
@@ -740,7 +979,7 @@ brasero_file_monitor_foreach_cancel_directory_cb (gpointer key,
 		return FALSE;
 
 	/* really close the watch */
-	inotify_rm_watch (data->dev_fd, wd);
+	brasero_file_monitor_rm_watch (data->monitor, wd);
 	return TRUE;
 }
 
@@ -750,7 +989,8 @@ brasero_file_monitor_foreach_cancel (BraseroFileMonitor *self,
 				     gpointer callback_data)
 {
 	GSList *iter;
-	GSList *next;
+	GList *link;
+	GList *next_link;
 	BraseroFileMonitorPrivate *priv;
 	BraseroFileMonitorCancelForeach data;
 
@@ -759,7 +999,7 @@ brasero_file_monitor_foreach_cancel (BraseroFileMonitor *self,
 	data.func = func;
 	data.results = NULL;
 	data.callback_data = callback_data;
-	data.dev_fd = g_io_channel_unix_get_fd (priv->notify);
+	data.monitor = self;
 
 	g_hash_table_foreach (priv->files,
 			      brasero_file_monitor_foreach_cancel_file_cb,
@@ -776,7 +1016,7 @@ brasero_file_monitor_foreach_cancel (BraseroFileMonitor *self,
 		brasero_inotify_file_data_free (result->callback_data);
 
 		if (!list) {
-			inotify_rm_watch (data.dev_fd, GPOINTER_TO_INT (result->key));
+			brasero_file_monitor_rm_watch (self, GPOINTER_TO_INT (result->key));
 			g_hash_table_remove (priv->files, result->key);
 		}
 		else
@@ -790,17 +1030,28 @@ brasero_file_monitor_foreach_cancel (BraseroFileMonitor *self,
 				     brasero_file_monitor_foreach_cancel_directory_cb,
 				     &data);
 
-	/* Finally get rid of moved that data in moved list */
-	for (iter = priv->moved_list; iter; iter = next) {
+	/* Finally get rid of moved that data in moved list ... */
+	for (link = priv->moved_queue->head; link; link = next_link) {
 		BraseroInotifyMovedData *data;
 
-		data = iter->data;
-		next = iter->next;
+		data = link->data;
+		next_link = link->next;
 		if (func (data->callback_data, callback_data)) {
-			priv->moved_list = g_slist_remove (priv->moved_list, data);
-			g_source_remove (data->id);
-			g_free (data->name);
-			g_free (data);
+			data = brasero_file_monitor_moved_steal (self, link);
+			brasero_inotify_moved_data_free (data);
+		}
+	}
+
+	/* ... and of the modifications not delivered yet */
+	for (link = priv->modified_queue->head; link; link = next_link) {
+		BraseroInotifyModifiedData *data;
+
+		data = link->data;
+		next_link = link->next;
+		if (func (data->callback_data, callback_data)) {
+			g_hash_table_remove (priv->modified, data);
+			g_queue_delete_link (priv->modified_queue, link);
+			brasero_inotify_modified_data_free (data);
 		}
 	}
 }
@@ -810,13 +1061,12 @@ brasero_file_monitor_foreach_file_reset_cb (gpointer key,
 					    gpointer hash_data,
 					    gpointer callback_data)
 {
-	int dev_fd = GPOINTER_TO_INT (callback_data);
 	int wd = GPOINTER_TO_INT (key);
 
 	/* really close the watch */
 	g_slist_foreach (hash_data, (GFunc) brasero_inotify_file_data_free, NULL);
 	g_slist_free (hash_data);
-	inotify_rm_watch (dev_fd, wd);
+	brasero_file_monitor_rm_watch (callback_data, wd);
 	return TRUE;
 }
 
@@ -825,11 +1075,10 @@ brasero_file_monitor_foreach_directory_reset_cb (gpointer key,
 						 gpointer data,
 						 gpointer callback_data)
 {
-	int dev_fd = GPOINTER_TO_INT (callback_data);
 	int wd = GPOINTER_TO_INT (key);
 
 	/* really close the watch */
-	inotify_rm_watch (dev_fd, wd);
+	brasero_file_monitor_rm_watch (callback_data, wd);
 	return TRUE;
 }
 
@@ -839,40 +1088,58 @@ brasero_file_monitor_reset (BraseroFileMonitor *self)
 	BraseroFileMonitorPrivate *priv;
 
 	priv = BRASERO_FILE_MONITOR_PRIVATE (self);
+
+	/* Pending events refer to data that is about to be destroyed */
+	brasero_file_monitor_moved_clear (self);
+	brasero_file_monitor_modified_clear (self);
+
 	g_hash_table_foreach_remove (priv->files,
 				     brasero_file_monitor_foreach_file_reset_cb,
-				     GINT_TO_POINTER (g_io_channel_unix_get_fd (priv->notify)));
+				     self);
 
 	g_hash_table_foreach_remove (priv->directories,
 				     brasero_file_monitor_foreach_directory_reset_cb,
-				     GINT_TO_POINTER (g_io_channel_unix_get_fd (priv->notify)));
+				     self);
 }
 
 static void
 brasero_file_monitor_init (BraseroFileMonitor *object)
 {
 	BraseroFileMonitorPrivate *priv;
-	int fd;
+	guint i;
 
 	priv = BRASERO_FILE_MONITOR_PRIVATE (object);
 
 	priv->files = g_hash_table_new (g_direct_hash, g_direct_equal);
 	priv->directories = g_hash_table_new (g_direct_hash, g_direct_equal);
 
-	/* start inotify monitoring backend */
-	fd = inotify_init ();
-	if (fd != -1) {
-		priv->notify = g_io_channel_unix_new (fd);
-		g_io_channel_set_encoding (priv->notify, NULL, NULL);
-		g_io_channel_set_close_on_unref (priv->notify, TRUE);
-		priv->notify_id = g_io_add_watch (priv->notify,
-						  G_IO_IN | G_IO_HUP | G_IO_PRI,
-						  (GIOFunc) brasero_file_monitor_inotify_monitor_cb,
-						  object);
-		g_io_channel_unref (priv->notify);
+	priv->moved_queue = g_queue_new ();
+	priv->moved = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	priv->modified_queue = g_queue_new ();
+	priv->modified = g_hash_table_new (brasero_inotify_modified_hash,
+					   brasero_inotify_modified_equal);
+
+	/* Open all the backends that work on this system. fanotify (when we
+	 * are allowed to use it) watches whole filesystems at once; inotify
+	 * needs a kernel watch per directory and polling is the last resort
+	 * for directories that none of them can watch. */
+	for (i = 0; file_monitor_backends [i]; i ++) {
+		const BraseroFileMonitorBackend *backend;
+		gpointer data;
+
+		backend = file_monitor_backends [i];
+		data = backend->open (BRASERO_FILE_MONITOR (object));
+		if (!data) {
+			BRASERO_BURN_LOG ("File Monitoring (%s backend not available)", backend->name);
+			continue;
+		}
+
+		BRASERO_BURN_LOG ("File Monitoring (%s backend opened)", backend->name);
+		priv->backends [priv->backends_num] = backend;
+		priv->backends_data [priv->backends_num] = data;
+		priv->backends_num ++;
 	}
-	else
-		g_warning ("Failed to open inotify: %s\n", g_strerror (errno));
 }
 
 static void
@@ -884,12 +1151,20 @@ brasero_file_monitor_finalize (GObject *object)
 
 	brasero_file_monitor_reset (BRASERO_FILE_MONITOR (object));
 
-	if (priv->notify_id)
-		g_source_remove (priv->notify_id);
+	while (priv->backends_num > 0) {
+		priv->backends_num --;
+		priv->backends [priv->backends_num]->close (priv->backends_data [priv->backends_num]);
+	}
 
 	g_hash_table_destroy (priv->files);
 	g_hash_table_destroy (priv->directories);
 
+	g_hash_table_destroy (priv->moved);
+	g_queue_free (priv->moved_queue);
+
+	g_hash_table_destroy (priv->modified);
+	g_queue_free (priv->modified_queue);
+
 	G_OBJECT_CLASS (brasero_file_monitor_parent_class)->finalize (object);
 }
 
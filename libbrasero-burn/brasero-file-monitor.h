@@ -82,6 +82,15 @@ struct _BraseroFileMonitorClass
 	void		(*file_modified)	(BraseroFileMonitor *monitor,
 						 gpointer callback_data,
 						 const gchar *name);
+
+	/* All the events read at once are delivered between these two so
+	 * that expensive updates can be done only once */
+	void		(*changes_started)	(BraseroFileMonitor *monitor);
+	void		(*changes_finished)	(BraseroFileMonitor *monitor);
+
+	/* Some events were lost (the kernel queue overflowed) so whatever is
+	 * watched may have changed without notice and should be checked */
+	void		(*events_lost)		(BraseroFileMonitor *monitor);
 };
 
 struct _BraseroFileMonitor
@@ -43,17 +43,77 @@
 #include "brasero-file-node.h"
 #include "brasero-io.h"
 
+/* The name a node is created with is stored right after the node in the same
+ * slice which saves an allocation per node. It is never modified; names set
+ * afterwards (renames) are allocated separately. */
+#define BRASERO_FILE_NODE_INLINE_NAME(MACRO_node)	((gchar *) ((MACRO_node) + 1))
+
+static BraseroFileNode *
+brasero_file_node_alloc (const gchar *name)
+{
+	BraseroFileNode *node;
+	gsize len;
+
+	len = name ? strlen (name) : 0;
+	node = g_slice_alloc0 (sizeof (BraseroFileNode) + len + 1);
+	if (name) {
+		memcpy (BRASERO_FILE_NODE_INLINE_NAME (node), name, len);
+		node->union1.name = BRASERO_FILE_NODE_INLINE_NAME (node);
+	}
+
+	return node;
+}
+
+static gsize
+brasero_file_node_alloc_size (BraseroFileNode *node)
+{
+	return sizeof (BraseroFileNode) + strlen (BRASERO_FILE_NODE_INLINE_NAME (node)) + 1;
+}
+
+static void
+brasero_file_node_free_name (BraseroFileNode *node,
+			     gchar *name)
+{
+	if (name != BRASERO_FILE_NODE_INLINE_NAME (node))
+		g_free (name);
+}
+
+/**
+ * Returns the number of bytes allocated for a node (not its children)
+ */
+gsize
+brasero_file_node_get_memory_size (BraseroFileNode *node)
+{
+	const gchar *name;
+	gsize size;
+
+	size = brasero_file_node_alloc_size (node);
+
+	name = BRASERO_FILE_NODE_NAME (node);
+	if (name && name != BRASERO_FILE_NODE_INLINE_NAME (node))
+		size += strlen (name) + 1;
+
+	if (node->is_grafted)
+		size += sizeof (BraseroGraft);
+	else if (node->has_import)
+		size += sizeof (BraseroImport);
+
+	if (node->is_root)
+		size += sizeof (BraseroFileTreeStats);
+
+	return size;
+}
 
 BraseroFileNode *
 brasero_file_node_root_new (void)
 {
 	BraseroFileNode *root;
 
-	root = g_new0 (BraseroFileNode, 1);
+	root = brasero_file_node_alloc (NULL);
 	root->is_root = TRUE;
 	root->is_imported = TRUE;
 
-	root->union3.stats = g_new0 (BraseroFileTreeStats, 1);
+	root->union3.stats = g_slice_new0 (BraseroFileTreeStats);
 	return root;
 }
 
@@ -654,7 +714,7 @@ brasero_file_node_check_imported_sibling (BraseroFileNode *node)
 			/* no more imported saved import structure */
 			parent->union1.name = import->name;
 			parent->has_import = FALSE;
-			g_free (import);
+			g_slice_free (BraseroImport, import);
 		}
 
 		iter->next = NULL;
@@ -684,7 +744,7 @@ brasero_file_node_graft (BraseroFileNode *file_node,
 	if (!file_node->is_grafted) {
 		BraseroFileNode *parent;
 
-		graft = g_new (BraseroGraft, 1);
+		graft = g_slice_new (BraseroGraft);
 		graft->name = file_node->union1.name;
 		file_node->union1.graft = graft;
 		file_node->is_grafted = TRUE;
@@ -732,7 +792,7 @@ brasero_file_node_ungraft (BraseroFileNode *node)
 	node->union1.name = graft->name;
 
 	/* Removes the graft */
-	g_free (graft);
+	g_slice_free (BraseroGraft, graft);
 
 	/* Propagate the size change up the parents to the next
 	 * grafted parent in the tree (if any). */
@@ -747,7 +807,7 @@ void
 brasero_file_node_rename (BraseroFileNode *node,
 			  const gchar *name)
 {
-	g_free (BRASERO_FILE_NODE_NAME (node));
+	brasero_file_node_free_name (node, BRASERO_FILE_NODE_NAME (node));
 	if (node->is_grafted)
 		node->union1.graft->name = g_strdup (name);
 	else
@@ -803,6 +863,135 @@ brasero_file_node_add (BraseroFileNode *parent,
 	node->is_deep = TRUE;
 }
 
+static BraseroFileNode *
+brasero_file_node_merge (BraseroFileNode *a,
+			 BraseroFileNode *b,
+			 GCompareFunc sort_func)
+{
+	BraseroFileNode head;
+	BraseroFileNode *tail;
+
+	/* Hidden nodes are always last and are only in @a */
+	tail = &head;
+	while (a && b && !a->is_hidden) {
+		/* On equality existing nodes (in @a) come first */
+		if (sort_func (a, b) <= 0) {
+			tail->next = a;
+			a = a->next;
+		}
+		else {
+			tail->next = b;
+			b = b->next;
+		}
+		tail = tail->next;
+	}
+
+	if (b) {
+		BraseroFileNode *last;
+
+		/* Put the hidden nodes of @a after the rest of @b */
+		tail->next = b;
+		for (last = b; last->next; last = last->next);
+		last->next = a;
+	}
+	else
+		tail->next = a;
+
+	return head.next;
+}
+
+static BraseroFileNode *
+brasero_file_node_sort_list (BraseroFileNode *list,
+			     guint len,
+			     GCompareFunc sort_func)
+{
+	BraseroFileNode *second;
+	BraseroFileNode *iter;
+	guint half;
+	guint i;
+
+	if (len < 2) {
+		if (list)
+			list->next = NULL;
+		return list;
+	}
+
+	/* Split the list in two halves */
+	half = len / 2;
+	iter = list;
+	for (i = 1; i < half; i ++)
+		iter = iter->next;
+
+	second = iter->next;
+	iter->next = NULL;
+
+	list = brasero_file_node_sort_list (list, half, sort_func);
+	second = brasero_file_node_sort_list (second, len - half, sort_func);
+	return brasero_file_node_merge (list, second, sort_func);
+}
+
+/**
+ * Same as brasero_file_node_add () for a list of new (not hidden) @children
+ * linked through their next pointer. They are sorted and merged with the
+ * existing children in one pass and the statistics and the size of parents
+ * are updated once for all of them.
+ */
+
+void
+brasero_file_node_add_children (BraseroFileNode *parent,
+				BraseroFileNode *children,
+				GCompareFunc sort_func)
+{
+	BraseroFileTreeStats *stats;
+	BraseroFileNode *iter;
+	guint sectors = 0;
+	guint depth = 0;
+	guint files = 0;
+	guint dirs = 0;
+	guint deep = 0;
+	guint len = 0;
+
+	if (!children)
+		return;
+
+	stats = brasero_file_node_get_tree_stats (parent, &depth);
+
+	for (iter = children; iter; iter = iter->next) {
+		iter->parent = parent;
+		len ++;
+
+		if (iter->is_file) {
+			files ++;
+			sectors += BRASERO_FILE_NODE_SECTORS (iter);
+		}
+		else
+			dirs ++;
+
+		/* See brasero_file_node_add () */
+		if ((iter->is_file && depth >= 6) || (!iter->is_file && depth >= 5)) {
+			iter->is_deep = TRUE;
+			deep ++;
+		}
+	}
+
+	children = brasero_file_node_sort_list (children, len, sort_func);
+	parent->union2.children = brasero_file_node_merge (BRASERO_FILE_NODE_CHILDREN (parent),
+							   children,
+							   sort_func);
+
+	/* book keeping */
+	stats->children += files;
+	stats->num_dir += dirs;
+	stats->num_deep += deep;
+
+	/* propagate the size change */
+	for (; parent && !parent->is_root; parent = parent->parent) {
+		parent->union3.sectors += sectors;
+		if (parent->is_grafted)
+			break;
+	}
+}
+
 void
 brasero_file_node_set_from_info (BraseroFileNode *node,
 				 BraseroFileTreeStats *stats,
@@ -892,8 +1081,7 @@ brasero_file_node_new_loading (const gchar *name)
 {
 	BraseroFileNode *node;
 
-	node = g_new0 (BraseroFileNode, 1);
-	node->union1.name = g_strdup (name);
+	node = brasero_file_node_alloc (name);
 	node->is_loading = TRUE;
 
 	return node;
@@ -908,8 +1096,7 @@ brasero_file_node_new_virtual (const gchar *name)
 	 * parents (and therefore replacable) and hidden (not displayed in the
 	 * GtkTreeModel). They are used as 'placeholders' to trigger
 	 * name-collision signal. */
-	node = g_new0 (BraseroFileNode, 1);
-	node->union1.name = g_strdup (name);
+	node = brasero_file_node_alloc (name);
 	node->is_fake = TRUE;
 	node->is_hidden = TRUE;
 
@@ -921,8 +1108,7 @@ brasero_file_node_new (const gchar *name)
 {
 	BraseroFileNode *node;
 
-	node = g_new0 (BraseroFileNode, 1);
-	node->union1.name = g_strdup (name);
+	node = brasero_file_node_alloc (name);
 
 	return node;
 }
@@ -933,8 +1119,7 @@ brasero_file_node_new_imported_session_file (GFileInfo *info)
 	BraseroFileNode *node;
 
 	/* Create the node information */
-	node = g_new0 (BraseroFileNode, 1);
-	node->union1.name = g_strdup (g_file_info_get_name (info));
+	node = brasero_file_node_alloc (g_file_info_get_name (info));
 	node->is_file = (g_file_info_get_file_type (info) != G_FILE_TYPE_DIRECTORY);
 	node->is_imported = TRUE;
 
@@ -954,8 +1139,7 @@ brasero_file_node_new_empty_folder (const gchar *name)
 	BraseroFileNode *node;
 
 	/* Create the node information */
-	node = g_new0 (BraseroFileNode, 1);
-	node->union1.name = g_strdup (name);
+	node = brasero_file_node_alloc (name);
 	node->is_fake = TRUE;
 
 	return node;
@@ -1138,8 +1322,8 @@ brasero_file_node_destroy_with_children (BraseroFileNode *node,
 		if (uri_node)
 			uri_node->nodes = g_slist_remove (uri_node->nodes, node);
 
-		g_free (graft->name);
-		g_free (graft);
+		brasero_file_node_free_name (node, graft->name);
+		g_slice_free (BraseroGraft, graft);
 	}
 	else if (import) {
 		/* if imported then destroy the saved children */
@@ -1148,20 +1332,20 @@ brasero_file_node_destroy_with_children (BraseroFileNode *node,
 			brasero_file_node_destroy_with_children (child, stats);
 		}
 
-		g_free (import->name);
-		g_free (import);
+		brasero_file_node_free_name (node, import->name);
+		g_slice_free (BraseroImport, import);
 	}
 	else
-		g_free (BRASERO_FILE_NODE_NAME (node));
+		brasero_file_node_free_name (node, BRASERO_FILE_NODE_NAME (node));
 
 	/* destroy the node */
 	if (node->is_file && !node->is_imported && BRASERO_FILE_NODE_MIME (node))
 		brasero_utils_unregister_string (BRASERO_FILE_NODE_MIME (node));
 
 	if (node->is_root)
-		g_free (BRASERO_FILE_NODE_STATS (node));
+		g_slice_free (BraseroFileTreeStats, BRASERO_FILE_NODE_STATS (node));
 
-	g_free (node);
+	g_slice_free1 (brasero_file_node_alloc_size (node), node);
 }
 
 /**
@@ -1216,7 +1400,7 @@ brasero_file_node_save_imported_children (BraseroFileNode *node,
 	/* remove import */
 	node->union1.name = import->name;
 	node->has_import = FALSE;
-	g_free (import);
+	g_slice_free (BraseroImport, import);
 }
 
 void
@@ -1242,7 +1426,7 @@ brasero_file_node_save_imported (BraseroFileNode *node,
 	/* save the node in its parent import structure */
 	import = BRASERO_FILE_NODE_IMPORT (parent);
 	if (!import) {
-		import = g_new0 (BraseroImport, 1);
+		import = g_slice_new0 (BraseroImport);
 		import->name = BRASERO_FILE_NODE_NAME (parent);
 		parent->union1.import = import;
 		parent->has_import = TRUE;
@@ -68,6 +68,9 @@ typedef struct _BraseroImport BraseroImport;
  * - number of children (files+directories)
  * - number of deep directories
  * - number of files over 2 GiB
+ * - number of symlinks
+ * - number of names that are not Joliet compliant (maintained by
+ *   BraseroDataProject as they depend on siblings)
  */
 
 struct _BraseroFileTreeStats {
@@ -76,6 +79,7 @@ struct _BraseroFileTreeStats {
 	guint num_deep;
 	guint num_2GiB;
 	guint num_sym;
+	guint num_joliet;
 };
 typedef struct _BraseroFileTreeStats BraseroFileTreeStats;
 
@@ -199,6 +203,9 @@ struct _BraseroFileNode {
 BraseroFileNode *
 brasero_file_node_root_new (void);
 
+gsize
+brasero_file_node_get_memory_size (BraseroFileNode *node);
+
 BraseroFileNode *
 brasero_file_node_get_root (BraseroFileNode *node,
 			    guint *depth);
@@ -247,6 +254,11 @@ brasero_file_node_add (BraseroFileNode *parent,
 		       BraseroFileNode *child,
 		       GCompareFunc sort_func);
 
+void
+brasero_file_node_add_children (BraseroFileNode *parent,
+				BraseroFileNode *children,
+				GCompareFunc sort_func);
+
 BraseroFileNode *
 brasero_file_node_new (const gchar *name);
 
@@ -72,6 +72,7 @@ struct _BraseroSumDialogPrivate {
 
 	GtkWidget *md5_chooser;
 	GtkWidget *md5_check;
+	GtkWidget *sample_check;
 
 	BraseroXferCtx *xfer_ctx;
 	GCancellable *xfer_cancel;
@@ -88,6 +89,8 @@ brasero_sum_dialog_md5_toggled (GtkToggleButton *button,
 	priv = BRASERO_SUM_DIALOG_PRIVATE (self);
 	gtk_widget_set_sensitive (priv->md5_chooser,
 				  gtk_toggle_button_get_active (button));  
+	gtk_widget_set_sensitive (priv->sample_check,
+				  gtk_toggle_button_get_active (button));
 }
 
 static void
@@ -180,6 +183,29 @@ brasero_sum_dialog_success (BraseroSumDialog *self)
 					   GTK_MESSAGE_INFO);
 }
 
+static gboolean
+brasero_sum_dialog_sample_success (BraseroSumDialog *self,
+				   gdouble confidence)
+{
+	gboolean retval;
+	gchar *string;
+
+	brasero_tool_dialog_set_action (BRASERO_TOOL_DIALOG (self),
+					BRASERO_BURN_ACTION_FINISHED,
+					NULL);
+
+	/* Translators: %.1f%% is a probability like 99.9% */
+	string = g_strdup_printf (_("Only parts of the disc were checked. Damage to one percent of the disc would have been found with a probability of %.1f%%"),
+				  confidence * 100.0);
+	retval = brasero_sum_dialog_message (self,
+					     _("The file integrity check was performed successfully."),
+					     string,
+					     GTK_MESSAGE_INFO);
+	g_free (string);
+
+	return retval;
+}
+
 enum {
 	BRASERO_SUM_DIALOG_PATH,
 	BRASERO_SUM_DIALOG_NB_COL
@@ -494,6 +520,92 @@ brasero_sum_dialog_get_disc_checksum (BraseroSumDialog *self,
 	return result;
 }
 
+static gboolean
+brasero_sum_dialog_check_tree_file (BraseroSumDialog *self,
+				    BraseroMedium *medium,
+				    const gchar *uri)
+{
+	BraseroSumDialogPrivate *priv;
+	BraseroBurnResult result;
+	BraseroTrackDisc *track;
+	GError *error = NULL;
+	GValue *value = NULL;
+	BraseroBurn *burn;
+	gboolean retval;
+	gchar *path;
+
+	priv = BRASERO_SUM_DIALOG_PRIVATE (self);
+
+	path = g_filename_from_uri (uri, NULL, NULL);
+	if (!path)
+		return brasero_sum_dialog_message (self,
+						   _("The file integrity check could not be performed."),
+						   _("The file is not stored locally"),
+						   GTK_MESSAGE_ERROR);
+
+	/* The track checksum is the path of the manifest listing the
+	 * checksums of each block range of the disc */
+	track = brasero_track_disc_new ();
+	brasero_track_disc_set_drive (track, brasero_medium_get_drive (medium));
+	brasero_track_set_checksum (BRASERO_TRACK (track), BRASERO_CHECKSUM_SHA256_TREE_SAMPLED, path);
+	g_free (path);
+
+	if (!gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (priv->sample_check))) {
+		value = g_new0 (GValue, 1);
+		g_value_init (value, G_TYPE_UINT);
+		g_value_set_uint (value, 0);
+		brasero_track_tag_add (BRASERO_TRACK (track),
+				       BRASERO_TRACK_MEDIUM_CHECKSUM_SAMPLES_TAG,
+				       value);
+	}
+
+	brasero_burn_session_add_track (priv->session, BRASERO_TRACK (track), NULL);
+	brasero_burn_session_remove_flag (priv->session, BRASERO_BURN_FLAG_EJECT);
+
+	/* It's good practice to unref the track afterwards as we don't need it
+	 * anymore. BraseroBurnSession refs it. */
+	g_object_unref (track);
+
+	burn = brasero_tool_dialog_get_burn (BRASERO_TOOL_DIALOG (self));
+	result = brasero_burn_check (burn, priv->session, &error);
+
+	if (result == BRASERO_BURN_CANCEL) {
+		if (error)
+			g_error_free (error);
+
+		return FALSE;
+	}
+
+	if (result == BRASERO_BURN_OK) {
+		value = NULL;
+		brasero_track_tag_lookup (BRASERO_TRACK (track),
+					  BRASERO_TRACK_MEDIUM_CHECKSUM_CONFIDENCE_TAG,
+					  &value);
+		if (value && g_value_get_double (value) < 1.0)
+			return brasero_sum_dialog_sample_success (self, g_value_get_double (value));
+
+		return brasero_sum_dialog_success (self);
+	}
+
+	if (!error || error->code != BRASERO_BURN_ERROR_BAD_CHECKSUM) {
+		retval = brasero_sum_dialog_message_error (self, error);
+
+		if (error)
+			g_error_free (error);
+
+		return retval;
+	}
+
+	g_error_free (error);
+
+	value = NULL;
+	brasero_track_tag_lookup (BRASERO_TRACK (track),
+				  BRASERO_TRACK_MEDIUM_WRONG_CHECKSUM_TAG,
+				  &value);
+
+	return brasero_sum_dialog_corruption_warning (self, value ? g_value_get_boxed (value) : NULL);
+}
+
 static gboolean
 brasero_sum_dialog_check_md5_file (BraseroSumDialog *self,
 				   BraseroMedium *medium)
@@ -517,6 +629,13 @@ brasero_sum_dialog_check_md5_file (BraseroSumDialog *self,
 		return retval;
 	}
 
+	/* Manifests of block checksums made when burning an image */
+	if (g_str_has_suffix (uri, ".tree")) {
+		retval = brasero_sum_dialog_check_tree_file (self, medium, uri);
+		g_free (uri);
+		return retval;
+	}
+
 	result = brasero_sum_dialog_get_file_checksum (self, uri, &file_sum, &error);
 	g_free (uri);
 
@@ -712,6 +831,16 @@ brasero_sum_dialog_init (BraseroSumDialog *obj)
 			    TRUE,
 			    0);
 
+	priv->sample_check = gtk_check_button_new_with_mnemonic (_("Only check _samples of the disc"));
+	gtk_widget_set_tooltip_text (priv->sample_check, _("Only read some parts of the disc spread over its surface. This requires a .tree file that stores the checksums of the disc blocks"));
+	gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (priv->sample_check), TRUE);
+	gtk_widget_set_sensitive (priv->sample_check, FALSE);
+	gtk_box_pack_start (GTK_BOX (box),
+			    priv->sample_check,
+			    TRUE,
+			    TRUE,
+			    0);
+
 	gtk_widget_show_all (box);
 	brasero_tool_dialog_pack_options (BRASERO_TOOL_DIALOG (obj),
 					  box,
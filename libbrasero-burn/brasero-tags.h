@@ -48,6 +48,28 @@ G_BEGIN_DECLS
 
 #define BRASERO_TRACK_MEDIUM_WRONG_CHECKSUM_TAG		"track::medium::error::checksum::list"
 
+/**
+ * Sampled checks (BRASERO_CHECKSUM_SHA256_TREE_SAMPLED):
+ * - number of block ranges to check, 0 for all of them (G_TYPE_UINT)
+ * - seed used to pick the ranges (G_TYPE_UINT)
+ * - whether to check the whole medium once damage is found (G_TYPE_BOOLEAN)
+ * - set afterwards; the probability that damage to 1% of the medium would
+ *   have been detected (G_TYPE_DOUBLE)
+ */
+
+#define BRASERO_TRACK_MEDIUM_CHECKSUM_SAMPLES_TAG	"track::medium::checksum::samples"
+#define BRASERO_TRACK_MEDIUM_CHECKSUM_SEED_TAG		"track::medium::checksum::seed"
+#define BRASERO_TRACK_MEDIUM_CHECKSUM_ESCALATE_TAG	"track::medium::checksum::escalate"
+#define BRASERO_TRACK_MEDIUM_CHECKSUM_CONFIDENCE_TAG	"track::medium::checksum::confidence"
+
+/**
+ * Path of the file holding the block checksums of a track whose checksum
+ * type is BRASERO_CHECKSUM_SHA256_TREE; usually next to its image
+ * (G_TYPE_STRING)
+ */
+
+#define BRASERO_TRACK_CHECKSUM_TREE_TAG			"track::checksum::tree"
+
 /**
  * Strings
  */
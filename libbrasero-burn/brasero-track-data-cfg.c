@@ -131,6 +131,7 @@ enum {
 	SOURCE_LOADED, 
 	SOURCE_LOADING,
 	JOLIET_RENAME_SIGNAL,
+	REVALIDATED,
 	LAST_SIGNAL
 };
 
@@ -2145,6 +2146,66 @@ brasero_track_data_cfg_get_restored_list (BraseroTrackDataCfg *track)
 	return brasero_filtered_uri_get_restored_list (filtered);
 }
 
+/**
+ * brasero_track_data_cfg_save_snapshot:
+ * @track: a #BraseroTrackDataCfg
+ * @path: a #gchar
+ * @tag: a #gchar
+ * @error: a #GError
+ *
+ * Saves the tree of files as it was loaded in @path so that the project can be
+ * reopened without querying every file again. @tag should identify the state
+ * of the project file it goes with (its modification time for example).
+ * Nothing is saved while the tree is still loading.
+ *
+ * Return value: a #gboolean. TRUE if the snapshot was saved.
+ **/
+
+gboolean
+brasero_track_data_cfg_save_snapshot (BraseroTrackDataCfg *track,
+				      const gchar *path,
+				      const gchar *tag,
+				      GError **error)
+{
+	BraseroTrackDataCfgPrivate *priv;
+
+	g_return_val_if_fail (BRASERO_TRACK_DATA_CFG (track), FALSE);
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (track);
+
+	return brasero_data_vfs_save_snapshot (BRASERO_DATA_VFS (priv->tree),
+					       path,
+					       tag,
+					       error);
+}
+
+/**
+ * brasero_track_data_cfg_load_snapshot:
+ * @track: a #BraseroTrackDataCfg
+ * @path: a #gchar
+ * @tag: a #gchar
+ *
+ * Uses the snapshot saved in @path with brasero_track_data_cfg_save_snapshot ()
+ * to load the contents set afterwards with brasero_track_data_set_source ()
+ * provided @tag is the same. The files are checked again in the background.
+ *
+ * Return value: a #gboolean. TRUE if the snapshot will be used.
+ **/
+
+gboolean
+brasero_track_data_cfg_load_snapshot (BraseroTrackDataCfg *track,
+				      const gchar *path,
+				      const gchar *tag)
+{
+	BraseroTrackDataCfgPrivate *priv;
+
+	g_return_val_if_fail (BRASERO_TRACK_DATA_CFG (track), FALSE);
+	priv = BRASERO_TRACK_DATA_CFG_PRIVATE (track);
+
+	return brasero_data_vfs_load_snapshot (BRASERO_DATA_VFS (priv->tree),
+					       path,
+					       tag);
+}
+
 /**
  * brasero_track_data_cfg_load_medium:
  * @track: a #BraseroTrackDataCfg
@@ -2587,6 +2648,17 @@ brasero_track_data_cfg_unknown_uri_cb (BraseroDataVFS *vfs,
 		       uri);
 }
 
+static void
+brasero_track_data_cfg_snapshot_revalidated_cb (BraseroDataVFS *vfs,
+						guint changed,
+						BraseroTrackDataCfg *self)
+{
+	g_signal_emit (self,
+		       brasero_track_data_cfg_signals [REVALIDATED],
+		       0,
+		       changed);
+}
+
 static gboolean
 brasero_track_data_cfg_autorun_inf_update (BraseroTrackDataCfg *self)
 {
@@ -3363,6 +3435,10 @@ brasero_track_data_cfg_init (BraseroTrackDataCfg *object)
 			  "image-uri",
 			  G_CALLBACK (brasero_track_data_cfg_image_uri_cb),
 			  object);
+	g_signal_connect (priv->tree,
+			  "snapshot-revalidated",
+			  G_CALLBACK (brasero_track_data_cfg_snapshot_revalidated_cb),
+			  object);
 	g_signal_connect (priv->tree,
 			  "virtual-sibling",
 			  G_CALLBACK (brasero_track_data_cfg_virtual_sibling_cb),
@@ -3503,6 +3579,16 @@ brasero_track_data_cfg_class_init (BraseroTrackDataCfgClass *klass)
 			  G_TYPE_NONE,
 			  1,
 			  G_TYPE_STRING);
+	brasero_track_data_cfg_signals [REVALIDATED] = 
+	    g_signal_new ("snapshot_revalidated",
+			  G_TYPE_FROM_CLASS (klass),
+			  G_SIGNAL_RUN_FIRST,
+			  0,
+			  NULL, NULL,
+			  g_cclosure_marshal_VOID__UINT,
+			  G_TYPE_NONE,
+			  1,
+			  G_TYPE_UINT);
 	brasero_track_data_cfg_signals [G2_FILE] = 
 	    g_signal_new ("2G_file",
 			  G_TYPE_FROM_CLASS (klass),
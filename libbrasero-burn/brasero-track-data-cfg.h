@@ -132,6 +132,21 @@ brasero_track_data_cfg_dont_filter_uri (BraseroTrackDataCfg *track,
 GSList *
 brasero_track_data_cfg_get_restored_list (BraseroTrackDataCfg *track);
 
+/**
+ * Project snapshots
+ */
+
+gboolean
+brasero_track_data_cfg_save_snapshot (BraseroTrackDataCfg *track,
+				      const gchar *path,
+				      const gchar *tag,
+				      GError **error);
+
+gboolean
+brasero_track_data_cfg_load_snapshot (BraseroTrackDataCfg *track,
+				      const gchar *path,
+				      const gchar *tag);
+
 enum  {
 	BRASERO_FILTERED_STOCK_ID_COL,
 	BRASERO_FILTERED_URI_COL,
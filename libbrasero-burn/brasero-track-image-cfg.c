@@ -140,9 +140,27 @@ brasero_track_image_cfg_get_info_thread (GSimpleAsyncResult *result,
 					 GCancellable *cancel)
 {
 	BraseroTrackImageInfo *info;
+	BraseroBurnResult res;
 	GError *error = NULL;
 
 	info = g_simple_async_result_get_op_res_gpointer (result);
+
+	/* Local images are identified and sized in one pass (and cached) */
+	res = brasero_image_format_identify (info->uri,
+					     &info->format,
+					     &info->blocks,
+					     cancel,
+					     &error);
+	if (res != BRASERO_BURN_NOT_SUPPORTED) {
+		if (error && !g_cancellable_is_cancelled (cancel))
+			g_simple_async_result_set_from_error (result, error);
+
+		if (error)
+			g_error_free (error);
+
+		return;
+	}
+
 	if (info->format == BRASERO_IMAGE_FORMAT_NONE) {
 		GFile *file;
 		const gchar *mime;
@@ -193,7 +193,7 @@ brasero_track_set_checksum (BraseroTrack *track,
 	priv = BRASERO_TRACK_PRIVATE (track);
 
 	if (type == priv->checksum_type
-	&& (type == BRASERO_CHECKSUM_MD5 || type == BRASERO_CHECKSUM_SHA1 || type == BRASERO_CHECKSUM_SHA256)
+	&& (type == BRASERO_CHECKSUM_MD5 || type == BRASERO_CHECKSUM_SHA1 || type == BRASERO_CHECKSUM_SHA256 || type == BRASERO_CHECKSUM_SHA256_TREE)
 	&&  checksum && strcmp (checksum, priv->checksum))
 		result = BRASERO_BURN_ERR;
 
@@ -113,6 +113,8 @@ typedef enum {
 	BRASERO_CHECKSUM_SHA1_FILE		= 1 << 4,
 	BRASERO_CHECKSUM_SHA256			= 1 << 5,
 	BRASERO_CHECKSUM_SHA256_FILE		= 1 << 6,
+	BRASERO_CHECKSUM_SHA256_TREE		= 1 << 7,	/* root of a SHA256 tree over 1 MiB block ranges */
+	BRASERO_CHECKSUM_SHA256_TREE_SAMPLED	= 1 << 8,	/* same but only some ranges of the medium are checked */
 } BraseroChecksumType;
 
 BraseroBurnResult
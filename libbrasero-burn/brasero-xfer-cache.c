@@ -0,0 +1,544 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_LINUX_FS_H
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "brasero-lru-cache.h"
+
+#include "burn-debug.h"
+#include "brasero-xfer-cache.h"
+
+#define BRASERO_SCHEMA_CONFIG			"org.gnome.brasero.config"
+#define BRASERO_KEY_STAGING_CACHE_SIZE		"staging-cache-size"
+#define BRASERO_KEY_STAGING_CACHE_HASH		"staging-cache-hash"
+
+/* Bump this whenever the format of the index changes */
+#define BRASERO_XFER_CACHE_VERSION		1
+
+static GKeyFile *cache = NULL;
+G_LOCK_DEFINE_STATIC (cache);
+
+/* Read once from the main thread by brasero_xfer_cache_start () since
+ * the cache is used by transfer threads */
+static goffset max_size = 0;
+static gboolean hash_contents = FALSE;
+
+static gchar *
+brasero_xfer_cache_get_dir (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "brasero",
+				 "staging",
+				 NULL);
+}
+
+static gchar *
+brasero_xfer_cache_get_object_path (const gchar *content)
+{
+	gchar *directory;
+	gchar *path;
+
+	directory = brasero_xfer_cache_get_dir ();
+	path = g_build_filename (directory, content, NULL);
+	g_free (directory);
+
+	return path;
+}
+
+/**
+ * Reads the settings of the cache. Must be called from the main thread
+ * before any transfer starts.
+ */
+
+void
+brasero_xfer_cache_start (void)
+{
+	GSettings *settings;
+	gint size;
+
+	settings = g_settings_new (BRASERO_SCHEMA_CONFIG);
+	size = g_settings_get_int (settings, BRASERO_KEY_STAGING_CACHE_SIZE);
+	hash_contents = g_settings_get_boolean (settings, BRASERO_KEY_STAGING_CACHE_HASH);
+	g_object_unref (settings);
+
+	max_size = (goffset) MAX (size, 0) * 1024 * 1024;
+}
+
+static gchar *
+brasero_xfer_cache_get_index_path (void)
+{
+	gchar *directory;
+	gchar *path;
+
+	directory = brasero_xfer_cache_get_dir ();
+	path = g_build_filename (directory, "index", NULL);
+	g_free (directory);
+
+	return path;
+}
+
+/* Must be called with the lock held */
+static GKeyFile *
+brasero_xfer_cache_get (void)
+{
+	gchar *path;
+
+	if (cache)
+		return cache;
+
+	path = brasero_xfer_cache_get_index_path ();
+	cache = brasero_lru_cache_load (path, BRASERO_XFER_CACHE_VERSION);
+	g_free (path);
+
+	return cache;
+}
+
+/* Must be called with the lock held */
+static void
+brasero_xfer_cache_save (void)
+{
+	GError *error = NULL;
+	gchar *path;
+
+	path = brasero_xfer_cache_get_index_path ();
+	if (!brasero_lru_cache_save (cache, path, BRASERO_XFER_CACHE_VERSION, &error)) {
+		BRASERO_BURN_LOG ("Staging cache index could not be written: %s", error->message);
+		g_error_free (error);
+	}
+	g_free (path);
+}
+
+/**
+ * Makes @dest_path point to the same data as @src_path: a hard link if
+ * both are on the same filesystem, a reflink or a plain copy otherwise.
+ */
+
+static gboolean
+brasero_xfer_cache_link (const gchar *src_path,
+			 const gchar *dest_path)
+{
+	gboolean result = FALSE;
+	GFile *src, *dest;
+
+	g_remove (dest_path);
+
+	if (!link (src_path, dest_path))
+		return TRUE;
+
+#ifdef FICLONE
+	{
+		int src_fd, dest_fd;
+
+		src_fd = g_open (src_path, O_RDONLY, 0);
+		dest_fd = g_open (dest_path, O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR);
+		if (src_fd != -1 && dest_fd != -1)
+			result = (ioctl (dest_fd, FICLONE, src_fd) == 0);
+
+		if (src_fd != -1)
+			close (src_fd);
+		if (dest_fd != -1)
+			close (dest_fd);
+
+		if (result)
+			return TRUE;
+
+		g_remove (dest_path);
+	}
+#endif
+
+	src = g_file_new_for_path (src_path);
+	dest = g_file_new_for_path (dest_path);
+	result = g_file_copy (src,
+			      dest,
+			      G_FILE_COPY_OVERWRITE|G_FILE_COPY_ALL_METADATA,
+			      NULL,
+			      NULL,
+			      NULL,
+			      NULL);
+	g_object_unref (src);
+	g_object_unref (dest);
+
+	return result;
+}
+
+static gchar *
+brasero_xfer_cache_get_key (GFile *src,
+			    GCancellable *cancel)
+{
+	const gchar *etag;
+	GFileInfo *info;
+	gchar *string;
+	gchar *uri;
+	gchar *key;
+
+	info = g_file_query_info (src,
+				  G_FILE_ATTRIBUTE_ETAG_VALUE ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+				  G_FILE_QUERY_INFO_NONE,
+				  cancel,
+				  NULL);
+	if (!info)
+		return NULL;
+
+	if (g_file_info_get_file_type (info) != G_FILE_TYPE_REGULAR) {
+		g_object_unref (info);
+		return NULL;
+	}
+
+	/* Without any way to tell whether it changed, don't cache it */
+	etag = g_file_info_get_etag (info);
+	if (!etag && !g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)) {
+		g_object_unref (info);
+		return NULL;
+	}
+
+	uri = g_file_get_uri (src);
+	string = g_strdup_printf ("%s\n%s\n%" G_GUINT64_FORMAT "\n%" G_GINT64_FORMAT,
+				  uri,
+				  etag ? etag:"",
+				  g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+				  g_file_info_get_size (info));
+	key = g_compute_checksum_for_string (G_CHECKSUM_SHA1, string, -1);
+	g_free (string);
+	g_free (uri);
+
+	g_object_unref (info);
+	return key;
+}
+
+/**
+ * Returns TRUE if @dest was filled from the cache. Otherwise @key is set
+ * to the key under which @dest should be stored once downloaded or to NULL
+ * if it can't be cached.
+ */
+
+gboolean
+brasero_xfer_cache_lookup (GFile *src,
+			   GFile *dest,
+			   GCancellable *cancel,
+			   gchar **key)
+{
+	gboolean result = FALSE;
+	GKeyFile *key_file;
+	gchar *content;
+	gchar *dest_path;
+	gchar *path;
+
+	*key = NULL;
+
+	/* Only remote files are cached */
+	if (g_file_has_uri_scheme (src, "file"))
+		return FALSE;
+
+	dest_path = g_file_get_path (dest);
+	if (!dest_path)
+		return FALSE;
+
+	if (max_size <= 0) {
+		g_free (dest_path);
+		return FALSE;
+	}
+
+	*key = brasero_xfer_cache_get_key (src, cancel);
+	if (!*key) {
+		g_free (dest_path);
+		return FALSE;
+	}
+
+	G_LOCK (cache);
+	key_file = brasero_xfer_cache_get ();
+	content = g_key_file_get_string (key_file, *key, "content", NULL);
+	G_UNLOCK (cache);
+
+	if (!content) {
+		g_free (dest_path);
+		return FALSE;
+	}
+
+	/* Linking may end up in a full copy so it is done without the lock.
+	 * If the object is pruned meanwhile, the link or copy fails and the
+	 * file is downloaded again. */
+	path = brasero_xfer_cache_get_object_path (content);
+	result = (g_file_test (path, G_FILE_TEST_IS_REGULAR)
+	      &&  brasero_xfer_cache_link (path, dest_path));
+
+	G_LOCK (cache);
+	key_file = brasero_xfer_cache_get ();
+	if (result) {
+		gchar *uri;
+
+		uri = g_file_get_uri (src);
+		BRASERO_BURN_LOG ("%s found in staging cache", uri);
+		g_free (uri);
+
+		brasero_lru_cache_touch (key_file, *key);
+		brasero_xfer_cache_save ();
+	}
+	else if (!g_file_test (path, G_FILE_TEST_IS_REGULAR))
+		g_key_file_remove_group (key_file, *key, NULL);
+	G_UNLOCK (cache);
+
+	g_free (dest_path);
+	g_free (content);
+	g_free (path);
+
+	return result;
+}
+
+/* Must be called with the lock held */
+static gboolean
+brasero_xfer_cache_content_used (GKeyFile *key_file,
+				 const gchar *content)
+{
+	gboolean used = FALSE;
+	gchar **groups;
+	guint i;
+
+	groups = g_key_file_get_groups (key_file, NULL);
+	for (i = 0; groups [i] && !used; i ++) {
+		gchar *other;
+
+		other = g_key_file_get_string (key_file, groups [i], "content", NULL);
+		used = (other && !strcmp (other, content));
+		g_free (other);
+	}
+	g_strfreev (groups);
+
+	return used;
+}
+
+/* Must be called with the lock held */
+static void
+brasero_xfer_cache_prune (GKeyFile *key_file)
+{
+	GHashTable *contents;
+	goffset size = 0;
+	gchar **groups;
+	guint i;
+
+	/* Each content only counts once */
+	contents = g_hash_table_new (g_str_hash, g_str_equal);
+	groups = g_key_file_get_groups (key_file, NULL);
+	for (i = 0; groups [i]; i ++) {
+		gchar *content;
+
+		content = g_key_file_get_string (key_file, groups [i], "content", NULL);
+		if (!content)
+			continue;
+
+		if (!g_hash_table_lookup (contents, content)) {
+			size += g_key_file_get_int64 (key_file, groups [i], "size", NULL);
+			g_hash_table_insert (contents, content, GINT_TO_POINTER (1));
+		}
+		else
+			g_free (content);
+	}
+	g_hash_table_foreach (contents, (GHFunc) g_free, NULL);
+	g_hash_table_destroy (contents);
+
+	g_strfreev (groups);
+
+	while (size > max_size) {
+		goffset entry_size;
+		gchar *content;
+		gchar *oldest;
+
+		oldest = brasero_lru_cache_get_oldest (key_file);
+		if (!oldest)
+			break;
+
+		content = g_key_file_get_string (key_file, oldest, "content", NULL);
+		entry_size = g_key_file_get_int64 (key_file, oldest, "size", NULL);
+		g_key_file_remove_group (key_file, oldest, NULL);
+		g_free (oldest);
+
+		if (content && !brasero_xfer_cache_content_used (key_file, content)) {
+			gchar *path;
+
+			size -= entry_size;
+
+			path = brasero_xfer_cache_get_object_path (content);
+			BRASERO_BURN_LOG ("Removing %s from staging cache", content);
+			g_remove (path);
+			g_free (path);
+		}
+
+		g_free (content);
+	}
+}
+
+static gchar *
+brasero_xfer_cache_hash_file (const gchar *path)
+{
+	GChecksum *checksum;
+	guchar buffer [65536];
+	gchar *retval;
+	gssize bytes;
+	int fd;
+
+	fd = g_open (path, O_RDONLY, 0);
+	if (fd == -1)
+		return NULL;
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA256);
+	while ((bytes = read (fd, buffer, sizeof (buffer))) != 0) {
+		if (bytes < 0) {
+			if (errno == EINTR)
+				continue;
+
+			g_checksum_free (checksum);
+			close (fd);
+			return NULL;
+		}
+
+		g_checksum_update (checksum, buffer, bytes);
+	}
+	close (fd);
+
+	retval = g_strdup (g_checksum_get_string (checksum));
+	g_checksum_free (checksum);
+
+	return retval;
+}
+
+/**
+ * Adds the downloaded file @dest to the cache under @key. If the
+ * staging-cache-hash setting is set, the data is stored under its SHA256
+ * so that identical files from different URIs are only kept once.
+ * Otherwise it is stored under @key.
+ */
+
+void
+brasero_xfer_cache_store (const gchar *key,
+			  GFile *src,
+			  GFile *dest)
+{
+	GKeyFile *key_file;
+	gchar *directory;
+	struct stat info;
+	gchar *dest_path;
+	gchar *content;
+	gchar *path;
+	gchar *uri;
+
+	if (!key || max_size <= 0)
+		return;
+
+	dest_path = g_file_get_path (dest);
+	if (!dest_path)
+		return;
+
+	if (g_stat (dest_path, &info) || info.st_size > max_size) {
+		g_free (dest_path);
+		return;
+	}
+
+	directory = brasero_xfer_cache_get_dir ();
+	if (g_mkdir_with_parents (directory, 0700) == -1) {
+		BRASERO_BURN_LOG ("Impossible to create %s (%s)", directory, g_strerror (errno));
+		g_free (directory);
+		g_free (dest_path);
+		return;
+	}
+	g_free (directory);
+
+	if (hash_contents)
+		content = brasero_xfer_cache_hash_file (dest_path);
+	else
+		content = g_strdup (key);
+
+	if (!content) {
+		g_free (dest_path);
+		return;
+	}
+
+	/* The data is linked or copied under a temporary name without the
+	 * lock and then atomically moved in place */
+	path = brasero_xfer_cache_get_object_path (content);
+	if (!g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+		gboolean result;
+		gchar *tmp_path;
+
+		tmp_path = g_strdup_printf ("%s.%i-%p", path, getpid (), (gpointer) g_thread_self ());
+		result = (brasero_xfer_cache_link (dest_path, tmp_path)
+		      &&  g_rename (tmp_path, path) == 0);
+		if (!result)
+			g_remove (tmp_path);
+		g_free (tmp_path);
+
+		if (!result) {
+			g_free (dest_path);
+			g_free (content);
+			g_free (path);
+			return;
+		}
+	}
+
+	G_LOCK (cache);
+
+	key_file = brasero_xfer_cache_get ();
+
+	uri = g_file_get_uri (src);
+	g_key_file_set_string (key_file, key, "uri", uri);
+	g_free (uri);
+
+	g_key_file_set_string (key_file, key, "content", content);
+	g_key_file_set_int64 (key_file, key, "size", info.st_size);
+	brasero_lru_cache_touch (key_file, key);
+
+	brasero_xfer_cache_prune (key_file);
+	brasero_xfer_cache_save ();
+
+	G_UNLOCK (cache);
+
+	g_free (dest_path);
+	g_free (content);
+	g_free (path);
+}
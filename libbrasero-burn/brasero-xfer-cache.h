@@ -0,0 +1,61 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#include <glib.h>
+#include <gio/gio.h>
+
+#ifndef _BRASERO_XFER_CACHE_H
+#define _BRASERO_XFER_CACHE_H
+
+G_BEGIN_DECLS
+
+/**
+ * Persistent cache of the remote files downloaded for previous burns.
+ * Files are looked up by URI plus the remote etag, modification time and
+ * size. They can optionally be stored once per contents.
+ */
+
+void
+brasero_xfer_cache_start (void);
+
+gboolean
+brasero_xfer_cache_lookup (GFile *src,
+			   GFile *dest,
+			   GCancellable *cancel,
+			   gchar **key);
+
+void
+brasero_xfer_cache_store (const gchar *key,
+			  GFile *src,
+			  GFile *dest);
+
+G_END_DECLS
+
+#endif /* _BRASERO_XFER_CACHE_H */
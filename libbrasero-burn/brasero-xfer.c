@@ -28,6 +28,9 @@
  * 	Boston, MA  02110-1301, USA.
  */
 
+/* for copy_file_range () */
+#define _GNU_SOURCE
+
 #include <string.h>
 
 #ifdef HAVE_CONFIG_H
@@ -35,6 +38,15 @@
 #endif
 
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_LINUX_FS_H
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
 
 #include <glib.h>
 #include <glib/gi18n-lib.h>
@@ -42,23 +54,67 @@
 #include <gio/gio.h>
 
 #include "brasero-xfer.h"
+#include "brasero-xfer-cache.h"
 #include "burn-debug.h"
 
+/* Size of the chunks copied with copy_file_range () between two checks
+ * for cancellation */
+#define BRASERO_XFER_RANGE_SIZE		(8 * 1024 * 1024)
+
 /* FIXME! one way to improve this would be to add auto mounting */
 struct _BraseroXferCtx {
 	goffset total_size;
 
 	goffset bytes_copied;
 	goffset current_bytes_copied;
+
+	gint64 start_time;
+
+	/* Used for concurrent transfers */
+	GMutex *mutex;
+	GCond *cond;
+
+	GQueue *queue;
+	GHashTable *mounts;
+	guint max_per_mount;
+
+	GCancellable *cancel;
+	GError *error;
+};
+
+typedef struct _BraseroXferJob BraseroXferJob;
+struct _BraseroXferJob {
+	BraseroXferCtx *ctx;
+
+	GFile *src;
+	GFile *dest;
+	gchar *mount;
+
+	goffset size;
+	goffset current;
 };
 
+static void
+brasero_xfer_reset (BraseroXferCtx *ctx)
+{
+	g_mutex_lock (ctx->mutex);
+	ctx->total_size = 0;
+	ctx->bytes_copied = 0;
+	ctx->current_bytes_copied = 0;
+	ctx->start_time = g_get_monotonic_time ();
+	g_mutex_unlock (ctx->mutex);
+}
+
 static void
 brasero_xfer_progress_cb (goffset current_num_bytes,
 			  goffset total_num_bytes,
 			  gpointer callback_data)
 {
 	BraseroXferCtx *ctx = callback_data;
+
+	g_mutex_lock (ctx->mutex);
 	ctx->current_bytes_copied = current_num_bytes;
+	g_mutex_unlock (ctx->mutex);
 }
 
 static gboolean
@@ -68,9 +124,13 @@ brasero_xfer_file_transfer (BraseroXferCtx *ctx,
 			    GCancellable *cancel,
 			    GError **error)
 {
+	gchar *key = NULL;
 	gboolean result;
 	gchar *name;
 
+	if (brasero_xfer_cache_lookup (src, dest, cancel, &key))
+		return TRUE;
+
 	name = g_file_get_basename (src);
 	BRASERO_BURN_LOG ("Downloading %s", name);
 	g_free (name);
@@ -83,6 +143,10 @@ brasero_xfer_file_transfer (BraseroXferCtx *ctx,
 			      ctx,
 			      error);
 
+	if (result)
+		brasero_xfer_cache_store (key, src, dest);
+
+	g_free (key);
 	return result;
 }
 
@@ -219,7 +283,7 @@ brasero_xfer_start (BraseroXferCtx *ctx,
 	gboolean result;
 	GFileInfo *info;
 
-	bzero (ctx, sizeof (BraseroXferCtx));
+	brasero_xfer_reset (ctx);
 
 	/* First step: get all the total size of what we have to move */
 	info = g_file_query_info (src,
@@ -284,6 +348,530 @@ brasero_xfer_start (BraseroXferCtx *ctx,
 	return result;
 }
 
+/**
+ * Concurrent transfers. Directories are explored and created first, then a
+ * pool of threads copies the files with a limit on the number of transfers
+ * per mount so that one slow server isn't hammered.
+ */
+
+static gchar *
+brasero_xfer_get_mount_key (GFile *file)
+{
+	const gchar *authority;
+	const gchar *end;
+	gchar *uri;
+	gchar *key;
+
+	/* Files from the same scheme and host share a mount */
+	uri = g_file_get_uri (file);
+	authority = strstr (uri, "://");
+	if (!authority) {
+		g_free (uri);
+		return g_strdup ("");
+	}
+
+	end = strchr (authority + 3, '/');
+	if (end)
+		key = g_strndup (uri, end - uri);
+	else
+		key = g_strdup (uri);
+
+	g_free (uri);
+	return key;
+}
+
+static void
+brasero_xfer_job_free (BraseroXferJob *job)
+{
+	g_object_unref (job->src);
+	g_object_unref (job->dest);
+	g_free (job->mount);
+	g_free (job);
+}
+
+static void
+brasero_xfer_queue_file (BraseroXferCtx *ctx,
+			 GFile *src,
+			 GFile *dest,
+			 goffset size)
+{
+	BraseroXferJob *job;
+
+	job = g_new0 (BraseroXferJob, 1);
+	job->ctx = ctx;
+	job->src = g_object_ref (src);
+	job->dest = g_object_ref (dest);
+	job->mount = brasero_xfer_get_mount_key (src);
+	job->size = size;
+
+	g_queue_push_tail (ctx->queue, job);
+
+	g_mutex_lock (ctx->mutex);
+	ctx->total_size += size;
+	g_mutex_unlock (ctx->mutex);
+}
+
+static gboolean
+brasero_xfer_queue_directory (BraseroXferCtx *ctx,
+			      GFile *src,
+			      GFile *dest,
+			      GCancellable *cancel,
+			      GError **error)
+{
+	GFileInfo *info;
+	gboolean result = TRUE;
+	GFileEnumerator *enumerator;
+
+	enumerator = g_file_enumerate_children (src,
+						G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+						G_FILE_ATTRIBUTE_STANDARD_NAME ","
+						G_FILE_ATTRIBUTE_STANDARD_SIZE,
+						G_FILE_QUERY_INFO_NONE,	/* follow symlinks */
+						cancel,
+						error);
+	if (!enumerator)
+		return FALSE;
+
+	while ((info = g_file_enumerator_next_file (enumerator, cancel, error))) {
+		GFile *dest_child;
+		GFile *src_child;
+
+		src_child = g_file_get_child (src, g_file_info_get_name (info));
+		dest_child = g_file_get_child (dest, g_file_info_get_name (info));
+
+		if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+			gchar *path;
+
+			path = g_file_get_path (dest_child);
+			BRASERO_BURN_LOG ("Creating directory %s", path);
+
+			/* create a directory with the same name and explore it */
+			if (g_mkdir (path, S_IRWXU)) {
+                                int errsv = errno;
+				g_set_error (error,
+					     BRASERO_BURN_ERROR,
+					     BRASERO_BURN_ERROR_GENERAL,
+					     _("Directory could not be created (%s)"),
+					     g_strerror (errsv));
+				result = FALSE;
+			}
+			else {
+				result = brasero_xfer_queue_directory (ctx,
+								       src_child,
+								       dest_child,
+								       cancel,
+								       error);
+			}
+
+			g_free (path);
+		}
+		else
+			brasero_xfer_queue_file (ctx,
+						 src_child,
+						 dest_child,
+						 g_file_info_get_size (info));
+
+		g_object_unref (info);
+		g_object_unref (src_child);
+		g_object_unref (dest_child);
+
+		if (!result)
+			break;
+
+		if (g_cancellable_is_cancelled (cancel))
+			break;
+	}
+
+	g_file_enumerator_close (enumerator, cancel, NULL);
+	g_object_unref (enumerator);
+
+	return result;
+}
+
+static gboolean
+brasero_xfer_queue (BraseroXferCtx *ctx,
+		    GFile *src,
+		    GFile *dest,
+		    GCancellable *cancel,
+		    GError **error)
+{
+	GFileInfo *info;
+	gboolean result = TRUE;
+
+	info = g_file_query_info (src,
+				  G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+				  G_FILE_QUERY_INFO_NONE, /* follow symlinks */
+				  cancel,
+				  error);
+	if (!info)
+		return FALSE;
+
+	if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+		gchar *dest_path;
+
+		dest_path = g_file_get_path (dest);
+
+		/* remove the temporary file that was created */
+		g_remove (dest_path);
+		if (g_mkdir_with_parents (dest_path, S_IRWXU)) {
+                        int errsv = errno;
+
+			g_set_error (error,
+				     BRASERO_BURN_ERROR,
+				     BRASERO_BURN_ERROR_GENERAL,
+				     _("Directory could not be created (%s)"),
+				     g_strerror (errsv));
+			result = FALSE;
+		}
+		else
+			result = brasero_xfer_queue_directory (ctx, src, dest, cancel, error);
+
+		g_free (dest_path);
+	}
+	else {
+		g_file_delete (dest, cancel, NULL);
+		brasero_xfer_queue_file (ctx, src, dest, g_file_info_get_size (info));
+	}
+
+	g_object_unref (info);
+	return result;
+}
+
+static void
+brasero_xfer_job_progress (BraseroXferJob *job,
+			   goffset current)
+{
+	BraseroXferCtx *ctx = job->ctx;
+
+	g_mutex_lock (ctx->mutex);
+	ctx->current_bytes_copied += current - job->current;
+	job->current = current;
+	g_mutex_unlock (ctx->mutex);
+}
+
+static void
+brasero_xfer_job_progress_cb (goffset current_num_bytes,
+			      goffset total_num_bytes,
+			      gpointer callback_data)
+{
+	brasero_xfer_job_progress (callback_data, current_num_bytes);
+}
+
+/**
+ * When the source is a local file (or is reachable through a FUSE mount)
+ * and lives on the same filesystem as the destination, let the kernel do
+ * the copy: first try to share the extents (reflink), then copy the
+ * ranges without going through user space.
+ * Returns FALSE without setting an error if that's not possible.
+ */
+
+static gboolean
+brasero_xfer_job_copy_local (BraseroXferJob *job,
+			     GCancellable *cancel,
+			     GError **error)
+{
+#if defined (FICLONE) || defined (HAVE_COPY_FILE_RANGE)
+	struct stat src_info, dest_info;
+	gboolean result = FALSE;
+	gchar *dest_parent;
+	gchar *src_path;
+	gchar *dest_path;
+	int src_fd = -1;
+	int dest_fd = -1;
+#ifdef HAVE_COPY_FILE_RANGE
+	goffset copied = 0;
+#endif
+
+	src_path = g_file_get_path (job->src);
+	if (!src_path)
+		return FALSE;
+
+	dest_path = g_file_get_path (job->dest);
+	dest_parent = g_path_get_dirname (dest_path);
+
+	if (g_stat (src_path, &src_info)
+	||  g_stat (dest_parent, &dest_info)
+	||  src_info.st_dev != dest_info.st_dev)
+		goto end;
+
+	src_fd = g_open (src_path, O_RDONLY, 0);
+	if (src_fd == -1)
+		goto end;
+
+	dest_fd = g_open (dest_path, O_WRONLY|O_CREAT|O_TRUNC, src_info.st_mode & 0777);
+	if (dest_fd == -1)
+		goto end;
+
+#ifdef FICLONE
+	if (!ioctl (dest_fd, FICLONE, src_fd)) {
+		BRASERO_BURN_LOG ("%s cloned", src_path);
+		brasero_xfer_job_progress (job, job->size);
+		result = TRUE;
+		goto end;
+	}
+#endif
+
+#ifdef HAVE_COPY_FILE_RANGE
+	while (!g_cancellable_is_cancelled (cancel)) {
+		ssize_t bytes;
+
+		bytes = copy_file_range (src_fd, NULL, dest_fd, NULL, BRASERO_XFER_RANGE_SIZE, 0);
+		if (bytes < 0 && errno == EINTR)
+			continue;
+
+		if (bytes < 0) {
+			int errsv = errno;
+
+			/* Not supported here; fall back to a normal copy */
+			if (!copied)
+				break;
+
+			g_set_error (error,
+				     BRASERO_BURN_ERROR,
+				     BRASERO_BURN_ERROR_GENERAL,
+				     _("Data could not be written (%s)"),
+				     g_strerror (errsv));
+			result = TRUE;
+			break;
+		}
+
+		if (!bytes) {
+			BRASERO_BURN_LOG ("%s copied in kernel", src_path);
+			result = TRUE;
+			break;
+		}
+
+		copied += bytes;
+		brasero_xfer_job_progress (job, copied);
+	}
+#endif
+
+end:
+
+	if (src_fd != -1)
+		close (src_fd);
+
+	if (dest_fd != -1) {
+		close (dest_fd);
+
+		/* Leave the place clean for g_file_copy () */
+		if (!result)
+			g_remove (dest_path);
+	}
+
+	if (result && !(error && *error))
+		g_file_copy_attributes (job->src,
+					job->dest,
+					G_FILE_COPY_ALL_METADATA,
+					cancel,
+					NULL);
+
+	g_free (dest_parent);
+	g_free (dest_path);
+	g_free (src_path);
+
+	return result;
+#else
+	return FALSE;
+#endif
+}
+
+static BraseroXferJob *
+brasero_xfer_next_job (BraseroXferCtx *ctx)
+{
+	BraseroXferJob *job = NULL;
+
+	g_mutex_lock (ctx->mutex);
+	while (!job
+	&&     !ctx->error
+	&&     !g_queue_is_empty (ctx->queue)
+	&&     !g_cancellable_is_cancelled (ctx->cancel)) {
+		GList *iter;
+
+		/* Take the first job whose mount isn't saturated */
+		for (iter = ctx->queue->head; iter; iter = iter->next) {
+			BraseroXferJob *candidate;
+			guint running;
+
+			candidate = iter->data;
+			running = GPOINTER_TO_UINT (g_hash_table_lookup (ctx->mounts, candidate->mount));
+			if (running < ctx->max_per_mount) {
+				g_hash_table_insert (ctx->mounts,
+						     g_strdup (candidate->mount),
+						     GUINT_TO_POINTER (running + 1));
+				g_queue_delete_link (ctx->queue, iter);
+				job = candidate;
+				break;
+			}
+		}
+
+		if (!job)
+			g_cond_wait (ctx->cond, ctx->mutex);
+	}
+	g_mutex_unlock (ctx->mutex);
+
+	return job;
+}
+
+static gpointer
+brasero_xfer_worker_thread (gpointer data)
+{
+	BraseroXferCtx *ctx = data;
+	BraseroXferJob *job;
+
+	while ((job = brasero_xfer_next_job (ctx))) {
+		GError *error = NULL;
+		gchar *key = NULL;
+		gboolean result;
+		guint running;
+
+		result = brasero_xfer_cache_lookup (job->src, job->dest, ctx->cancel, &key);
+		if (!result)
+			result = brasero_xfer_job_copy_local (job, ctx->cancel, &error);
+
+		if (!result) {
+			gchar *name;
+
+			name = g_file_get_basename (job->src);
+			BRASERO_BURN_LOG ("Downloading %s", name);
+			g_free (name);
+
+			result = g_file_copy (job->src,
+					      job->dest,
+					      G_FILE_COPY_ALL_METADATA,
+					      ctx->cancel,
+					      brasero_xfer_job_progress_cb,
+					      job,
+					      &error);
+			if (result)
+				brasero_xfer_cache_store (key, job->src, job->dest);
+		}
+
+		g_free (key);
+
+		g_mutex_lock (ctx->mutex);
+
+		running = GPOINTER_TO_UINT (g_hash_table_lookup (ctx->mounts, job->mount));
+		g_hash_table_insert (ctx->mounts,
+				     g_strdup (job->mount),
+				     GUINT_TO_POINTER (running - 1));
+
+		ctx->current_bytes_copied -= job->current;
+		ctx->bytes_copied += job->size;
+
+		if (error) {
+			if (!ctx->error)
+				ctx->error = error;
+			else
+				g_error_free (error);
+		}
+
+		/* Wake up the threads waiting for a free slot on this mount */
+		g_cond_broadcast (ctx->cond);
+		g_mutex_unlock (ctx->mutex);
+
+		brasero_xfer_job_free (job);
+	}
+
+	/* The others may be waiting for a slot that will never be freed */
+	g_mutex_lock (ctx->mutex);
+	g_cond_broadcast (ctx->cond);
+	g_mutex_unlock (ctx->mutex);
+
+	return NULL;
+}
+
+/**
+ * Copies every source in @src_list to the destination at the same position
+ * in @dest_list using at most @max_transfers concurrent transfers and
+ * @max_per_mount transfers per mount. This blocks.
+ */
+
+gboolean
+brasero_xfer_start_multiple (BraseroXferCtx *ctx,
+			     GSList *src_list,
+			     GSList *dest_list,
+			     guint max_transfers,
+			     guint max_per_mount,
+			     GCancellable *cancel,
+			     GError **error)
+{
+	GSList *threads = NULL;
+	gboolean result = TRUE;
+	GSList *src, *dest;
+	GSList *iter;
+	guint i;
+
+	brasero_xfer_reset (ctx);
+
+	ctx->queue = g_queue_new ();
+	ctx->mounts = g_hash_table_new_full (g_str_hash,
+					     g_str_equal,
+					     g_free,
+					     NULL);
+	ctx->max_per_mount = MAX (max_per_mount, 1);
+	ctx->cancel = cancel;
+	ctx->error = NULL;
+
+	/* First step: create the directories and get the list of files with
+	 * the total size of what we have to move */
+	for (src = src_list, dest = dest_list;
+	     src && dest && result;
+	     src = src->next, dest = dest->next)
+		result = brasero_xfer_queue (ctx, src->data, dest->data, cancel, error);
+
+	if (!result || g_cancellable_is_cancelled (cancel))
+		goto end;
+
+	BRASERO_BURN_LOG ("Downloading %i files (size = %lli) with %i transfers",
+			  g_queue_get_length (ctx->queue),
+			  ctx->total_size,
+			  MIN (max_transfers, g_queue_get_length (ctx->queue)));
+
+	/* Step 2: start downloading */
+	max_transfers = MIN (MAX (max_transfers, 1), g_queue_get_length (ctx->queue));
+	for (i = 0; i < max_transfers; i ++) {
+		GThread *thread;
+
+		thread = g_thread_create (brasero_xfer_worker_thread,
+					  ctx,
+					  TRUE,
+					  NULL);
+		if (thread)
+			threads = g_slist_prepend (threads, thread);
+	}
+
+	/* Run them in this thread if none could be created */
+	if (!threads)
+		brasero_xfer_worker_thread (ctx);
+
+	for (iter = threads; iter; iter = iter->next)
+		g_thread_join (iter->data);
+
+	g_slist_free (threads);
+
+	if (ctx->error) {
+		g_propagate_error (error, ctx->error);
+		ctx->error = NULL;
+		result = FALSE;
+	}
+	else if (g_cancellable_is_cancelled (cancel))
+		result = FALSE;
+
+end:
+
+	g_queue_foreach (ctx->queue, (GFunc) brasero_xfer_job_free, NULL);
+	g_queue_free (ctx->queue);
+	ctx->queue = NULL;
+
+	g_hash_table_destroy (ctx->mounts);
+	ctx->mounts = NULL;
+
+	ctx->cancel = NULL;
+	return result;
+}
+
 typedef struct _BraseroXferThreadData BraseroXferThreadData;
 struct _BraseroXferThreadData
 {
@@ -304,7 +892,7 @@ struct _BraseroXferThreadData
 static gpointer
 brasero_xfer_thread (gpointer callback_data)
 {
-	BraseroXferThreadData *data = data;
+	BraseroXferThreadData *data = callback_data;
 	GError *error = NULL;
 
 	data->result = brasero_xfer_start (data->ctx,
@@ -343,7 +931,7 @@ brasero_xfer_wait (BraseroXferCtx *ctx,
 	gulong cancel_sig;
 	GThread *thread;
 
-	bzero (ctx, sizeof (BraseroXferCtx));
+	brasero_xfer_reset (ctx);
 
 	cancel_sig = g_signal_connect (cancel,
 				       "cancelled",
@@ -418,6 +1006,8 @@ brasero_xfer_new (void)
 	BraseroXferCtx *ctx;
 
 	ctx = g_new0 (BraseroXferCtx, 1);
+	ctx->mutex = g_mutex_new ();
+	ctx->cond = g_cond_new ();
 
 	return ctx;
 }
@@ -425,6 +1015,8 @@ brasero_xfer_new (void)
 void
 brasero_xfer_free (BraseroXferCtx *ctx)
 {
+	g_mutex_free (ctx->mutex);
+	g_cond_free (ctx->cond);
 	g_free (ctx);
 }
 
@@ -433,11 +1025,36 @@ brasero_xfer_get_progress (BraseroXferCtx *ctx,
 			   goffset *written,
 			   goffset *total)
 {
+	g_mutex_lock (ctx->mutex);
+
 	if (written)
 		*written = ctx->current_bytes_copied + ctx->bytes_copied;
 
 	if (total)
 		*total = ctx->total_size;
 
+	g_mutex_unlock (ctx->mutex);
+
 	return TRUE;
 }
+
+/**
+ * Returns the average number of bytes copied per second since the start
+ */
+
+gint64
+brasero_xfer_get_rate (BraseroXferCtx *ctx)
+{
+	gint64 elapsed;
+	goffset written;
+
+	g_mutex_lock (ctx->mutex);
+	written = ctx->current_bytes_copied + ctx->bytes_copied;
+	elapsed = g_get_monotonic_time () - ctx->start_time;
+	g_mutex_unlock (ctx->mutex);
+
+	if (elapsed <= 0)
+		return 0;
+
+	return written * G_USEC_PER_SEC / elapsed;
+}
@@ -51,6 +51,15 @@ brasero_xfer_start (BraseroXferCtx *ctx,
 		    GCancellable *cancel,
 		    GError **error);
 
+gboolean
+brasero_xfer_start_multiple (BraseroXferCtx *ctx,
+			     GSList *src_list,
+			     GSList *dest_list,
+			     guint max_transfers,
+			     guint max_per_mount,
+			     GCancellable *cancel,
+			     GError **error);
+
 gboolean
 brasero_xfer_wait (BraseroXferCtx *ctx,
 		   const gchar *src,
@@ -63,6 +72,9 @@ brasero_xfer_get_progress (BraseroXferCtx *ctx,
 			   goffset *written,
 			   goffset *total);
 
+gint64
+brasero_xfer_get_rate (BraseroXferCtx *ctx);
+
 G_END_DECLS
 
 #endif /* _BURN_XFER_H */
@@ -46,6 +46,7 @@
 #include "burn-debug.h"
 #include "burn-caps.h"
 #include "burn-plugin-manager.h"
+#include "brasero-xfer-cache.h"
 #include "brasero-plugin-information.h"
 
 #include "brasero-drive.h"
@@ -263,6 +264,9 @@ brasero_burn_library_start (int *argc,
 	if (!plugin_manager)
 		plugin_manager = brasero_plugin_manager_get_default ();
 
+	/* settings of the staging cache used by transfer threads */
+	brasero_xfer_cache_start ();
+
 	brasero_caps_list_dump ();
 	return TRUE;
 }
@@ -0,0 +1,311 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "brasero-lru-cache.h"
+
+#include "burn-debug.h"
+#include "burn-buffer-history.h"
+
+/* Bump this whenever the format of the file changes */
+#define BRASERO_BUFFER_HISTORY_VERSION		2
+
+/* Number of burns remembered per drive and number of drives */
+#define BRASERO_BUFFER_HISTORY_MAX_BURNS	8
+#define BRASERO_BUFFER_HISTORY_MAX_DRIVES	16
+
+/* FIFO sizes are in MiB */
+#define BRASERO_BUFFER_HISTORY_MAX_FIFO		64
+
+/* Above that level the FIFO was probably too large */
+#define BRASERO_BUFFER_HISTORY_HIGH_LEVEL	75
+
+static GKeyFile *history = NULL;
+G_LOCK_DEFINE_STATIC (history);
+
+static gchar *
+brasero_buffer_history_get_path (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "brasero",
+				 "buffer-history",
+				 NULL);
+}
+
+static gchar *
+brasero_buffer_history_get_group (BraseroDrive *drive)
+{
+	const gchar *id;
+
+	if (!drive)
+		return NULL;
+
+	/* The UDI is stable across reboots while the device path may not */
+	id = brasero_drive_get_udi (drive);
+	if (!id)
+		id = brasero_drive_get_device (drive);
+	if (!id)
+		return NULL;
+
+	return g_compute_checksum_for_string (G_CHECKSUM_MD5, id, -1);
+}
+
+/* Must be called with the lock held */
+static GKeyFile *
+brasero_buffer_history_get (void)
+{
+	gchar *path;
+
+	if (history)
+		return history;
+
+	path = brasero_buffer_history_get_path ();
+	history = brasero_lru_cache_load (path, BRASERO_BUFFER_HISTORY_VERSION);
+	g_free (path);
+
+	return history;
+}
+
+/* Must be called with the lock held */
+static void
+brasero_buffer_history_save (void)
+{
+	GError *error = NULL;
+	gchar *path;
+
+	path = brasero_buffer_history_get_path ();
+	if (!brasero_lru_cache_save (history, path, BRASERO_BUFFER_HISTORY_VERSION, &error)) {
+		BRASERO_BURN_LOG ("Buffer history could not be written: %s", error->message);
+		g_error_free (error);
+	}
+	g_free (path);
+}
+
+/* Must be called with the lock held. Returns the list of values for @key
+ * (oldest first) and its length in @length. */
+static gint *
+brasero_buffer_history_get_list (GKeyFile *key_file,
+				 const gchar *group,
+				 const gchar *key,
+				 gsize *length)
+{
+	gint *values;
+
+	values = g_key_file_get_integer_list (key_file, group, key, length, NULL);
+	if (!values)
+		*length = 0;
+
+	return values;
+}
+
+static void
+brasero_buffer_history_append (GKeyFile *key_file,
+			       const gchar *group,
+			       const gchar *key,
+			       gint value)
+{
+	gint values [BRASERO_BUFFER_HISTORY_MAX_BURNS];
+	gint *previous;
+	gsize length;
+	gsize start;
+	gsize i;
+
+	previous = brasero_buffer_history_get_list (key_file, group, key, &length);
+
+	/* Only keep the last burns */
+	start = length >= BRASERO_BUFFER_HISTORY_MAX_BURNS ? length - BRASERO_BUFFER_HISTORY_MAX_BURNS + 1 : 0;
+	for (i = start; i < length; i ++)
+		values [i - start] = previous [i];
+	values [length - start] = value;
+	g_free (previous);
+
+	g_key_file_set_integer_list (key_file, group, key, values, length - start + 1);
+}
+
+/**
+ * Records the low levels reached by the FIFO and the drive buffer while
+ * data was written during a burn. @fifo_low and @buffer_low are -1 when
+ * unknown.
+ */
+
+void
+brasero_buffer_history_add (BraseroDrive *drive,
+			    guint fifo_size,
+			    gint fifo_low,
+			    gint buffer_low)
+{
+	GKeyFile *key_file;
+	gchar *group;
+
+	if (fifo_low < 0 && buffer_low < 0)
+		return;
+
+	group = brasero_buffer_history_get_group (drive);
+	if (!group)
+		return;
+
+	BRASERO_BURN_LOG ("Low buffer levels while writing: FIFO (%i MiB) %i%%, drive %i%%",
+			  fifo_size,
+			  fifo_low,
+			  buffer_low);
+
+	G_LOCK (history);
+
+	key_file = brasero_buffer_history_get ();
+
+	/* All three lists have one entry per burn */
+	brasero_buffer_history_append (key_file, group, "fifo-size", fifo_size);
+	brasero_buffer_history_append (key_file, group, "fifo-low", fifo_low);
+	brasero_buffer_history_append (key_file, group, "buffer-low", buffer_low);
+
+	brasero_lru_cache_touch (key_file, group);
+	brasero_lru_cache_prune (key_file, BRASERO_BUFFER_HISTORY_MAX_DRIVES, NULL, NULL);
+	brasero_buffer_history_save ();
+
+	G_UNLOCK (history);
+
+	g_free (group);
+}
+
+guint
+brasero_buffer_history_get_fifo_size (BraseroDrive *drive,
+				      guint default_size)
+{
+	GKeyFile *key_file;
+	gint *fifo_sizes;
+	gint *fifo_lows;
+	gsize sizes_num;
+	gsize lows_num;
+	gint fifo_size;
+	gint fifo_low;
+	gchar *group;
+
+	group = brasero_buffer_history_get_group (drive);
+	if (!group)
+		return default_size;
+
+	G_LOCK (history);
+
+	key_file = brasero_buffer_history_get ();
+	fifo_sizes = brasero_buffer_history_get_list (key_file, group, "fifo-size", &sizes_num);
+	fifo_lows = brasero_buffer_history_get_list (key_file, group, "fifo-low", &lows_num);
+
+	G_UNLOCK (history);
+
+	g_free (group);
+
+	if (!sizes_num || sizes_num != lows_num) {
+		g_free (fifo_sizes);
+		g_free (fifo_lows);
+		return default_size;
+	}
+
+	/* Start from the last burn */
+	fifo_size = fifo_sizes [sizes_num - 1];
+	fifo_low = fifo_lows [lows_num - 1];
+	g_free (fifo_sizes);
+	g_free (fifo_lows);
+
+	if (fifo_size <= 0 || fifo_low < 0)
+		return default_size;
+
+	/* The FIFO almost ran empty while writing last time: make it bigger.
+	 * If it always stayed nearly full it was too big: go back toward the
+	 * default. */
+	if (fifo_low < BRASERO_BUFFER_HISTORY_LOW_LEVEL)
+		fifo_size = MIN (fifo_size * 2, BRASERO_BUFFER_HISTORY_MAX_FIFO);
+	else if (fifo_low > BRASERO_BUFFER_HISTORY_HIGH_LEVEL)
+		fifo_size /= 2;
+
+	fifo_size = MAX (fifo_size, (gint) default_size);
+
+	BRASERO_BURN_LOG ("FIFO size from history %i MiB (default %i MiB, low level %i%%)",
+			  fifo_size,
+			  default_size,
+			  fifo_low);
+	return fifo_size;
+}
+
+static gboolean
+brasero_buffer_history_is_low (const gint *levels,
+			       gsize length)
+{
+	guint low = 0;
+	gsize i;
+
+	for (i = 0; i < length; i ++) {
+		if (levels [i] >= 0 && levels [i] < BRASERO_BUFFER_HISTORY_LOW_LEVEL)
+			low ++;
+	}
+
+	/* Either the last burn or most of the remembered ones were low */
+	if (length && levels [length - 1] >= 0 && levels [length - 1] < BRASERO_BUFFER_HISTORY_LOW_LEVEL)
+		return TRUE;
+
+	return low * 2 > length;
+}
+
+gboolean
+brasero_buffer_history_get_underrun_risk (BraseroDrive *drive)
+{
+	GKeyFile *key_file;
+	gint *buffer_lows;
+	gint *fifo_lows;
+	gsize buffer_num;
+	gsize fifo_num;
+	gboolean risk;
+	gchar *group;
+
+	group = brasero_buffer_history_get_group (drive);
+	if (!group)
+		return FALSE;
+
+	G_LOCK (history);
+
+	key_file = brasero_buffer_history_get ();
+	fifo_lows = brasero_buffer_history_get_list (key_file, group, "fifo-low", &fifo_num);
+	buffer_lows = brasero_buffer_history_get_list (key_file, group, "buffer-low", &buffer_num);
+
+	G_UNLOCK (history);
+
+	g_free (group);
+
+	risk = brasero_buffer_history_is_low (fifo_lows, fifo_num)
+	    || brasero_buffer_history_is_low (buffer_lows, buffer_num);
+
+	g_free (fifo_lows);
+	g_free (buffer_lows);
+	return risk;
+}
@@ -46,6 +46,111 @@
 #include "burn-debug.h"
 #include "burn-image-format.h"
 
+/* Results of brasero_image_format_identify () are kept as long as the image
+ * and all the files it references keep the same size and mtime */
+#define BRASERO_IMAGE_FORMAT_CACHE_MAX		64
+#define BRASERO_IMAGE_FORMAT_STAMP_ATTRIBUTES	G_FILE_ATTRIBUTE_STANDARD_SIZE "," G_FILE_ATTRIBUTE_TIME_MODIFIED
+#define BRASERO_IMAGE_FORMAT_HEAD_SIZE		4096
+#define BRASERO_IMAGE_FORMAT_MAX_SHEET_SIZE	(1024 * 1024)
+
+typedef struct _BraseroImageFormatStamp BraseroImageFormatStamp;
+struct _BraseroImageFormatStamp {
+	gchar *uri;
+	guint64 mtime;
+	goffset size;
+};
+
+typedef struct _BraseroImageFormatCached BraseroImageFormatCached;
+struct _BraseroImageFormatCached {
+	BraseroImageFormat forced;
+	BraseroImageFormat format;
+	guint64 blocks;
+
+	/* BraseroImageFormatStamp list; the image itself comes first */
+	GSList *stamps;
+};
+
+static GHashTable *image_cache = NULL;
+G_LOCK_DEFINE_STATIC (image_cache);
+
+static void
+brasero_image_format_add_stamp (GSList **stamps,
+				GFile *file,
+				GFileInfo *info)
+{
+	BraseroImageFormatStamp *stamp;
+
+	if (!stamps)
+		return;
+
+	stamp = g_new0 (BraseroImageFormatStamp, 1);
+	stamp->uri = g_file_get_uri (file);
+	stamp->mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	stamp->size = g_file_info_get_size (info);
+	*stamps = g_slist_append (*stamps, stamp);
+}
+
+static void
+brasero_image_format_free_stamps (GSList *stamps)
+{
+	GSList *iter;
+
+	for (iter = stamps; iter; iter = iter->next) {
+		BraseroImageFormatStamp *stamp;
+
+		stamp = iter->data;
+		g_free (stamp->uri);
+		g_free (stamp);
+	}
+	g_slist_free (stamps);
+}
+
+static void
+brasero_image_format_cached_free (gpointer data)
+{
+	BraseroImageFormatCached *cached = data;
+
+	brasero_image_format_free_stamps (cached->stamps);
+	g_free (cached);
+}
+
+static gssize
+brasero_image_format_read_head (const gchar *path,
+				gchar *buffer,
+				gsize size,
+				GError **error)
+{
+	FILE *file;
+	gsize read;
+
+	file = fopen (path, "r");
+	if (!file) {
+		int errsv = errno;
+
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     "%s",
+			     g_strerror (errsv));
+		return -1;
+	}
+
+	read = fread (buffer, 1, size, file);
+	if (ferror (file)) {
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     "%s",
+			     g_strerror (errno));
+
+		fclose (file);
+		return -1;
+	}
+
+	fclose (file);
+	return read;
+}
+
 static const gchar *
 brasero_image_format_read_path (const gchar *ptr,
 				gchar **path)
@@ -264,6 +369,7 @@ static gboolean
 brasero_image_format_get_DATAFILE_info (const gchar *ptr,
 					GFile *parent,
 					gint64 *size_file,
+					GSList **stamps,
 					GError **error)
 {
 	gchar *path = NULL;
@@ -314,13 +420,17 @@ stat_end:
 
 	/* NOTE: follow symlink if any */
 	info = g_file_query_info (file,
-				  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+				  BRASERO_IMAGE_FORMAT_STAMP_ATTRIBUTES,
 				  G_FILE_QUERY_INFO_NONE,
 				  NULL,
 				  error);
-	g_object_unref (file);
-	if (!info)
+	if (!info) {
+		g_object_unref (file);
 		return FALSE;
+	}
+
+	brasero_image_format_add_stamp (stamps, file, info);
+	g_object_unref (file);
 
 	if (size_file)
 		*size_file = BRASERO_BYTES_TO_SECTORS (g_file_info_get_size (info), 2352);
@@ -334,6 +444,7 @@ static gboolean
 brasero_image_format_get_FILE_info (const gchar *ptr,
 				    GFile *parent,
 				    gint64 *size_img,
+				    GSList **stamps,
 				    GError **error)
 {
 	gchar *path = NULL;
@@ -405,13 +516,17 @@ stat_end:
 
 	/* NOTE: follow symlink if any */
 	info = g_file_query_info (file,
-				  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+				  BRASERO_IMAGE_FORMAT_STAMP_ATTRIBUTES,
 				  G_FILE_QUERY_INFO_NONE,
 				  NULL,
 				  error);
-	g_object_unref (file);
-	if (!info)
+	if (!info) {
+		g_object_unref (file);
 		return FALSE;
+	}
+
+	brasero_image_format_add_stamp (stamps, file, info);
+	g_object_unref (file);
 
 	if (size_img)
 		*size_img = BRASERO_BYTES_TO_SECTORS (g_file_info_get_size (info), 2352) - start;
@@ -421,6 +536,66 @@ stat_end:
 	return TRUE;
 }
 
+static void
+brasero_image_format_cdrdao_line_size (const gchar *line,
+				       GFile *parent,
+				       gint64 *cue_size,
+				       GSList **stamps,
+				       GError **error)
+{
+	gchar *ptr;
+
+	if ((ptr = strstr (line, "DATAFILE"))) {
+		gint64 size_file;
+
+		ptr += 8;
+		if (brasero_image_format_get_DATAFILE_info (ptr, parent, &size_file, stamps, error))
+			*cue_size += size_file;
+	}
+	else if ((ptr = strstr (line, "FILE"))) {
+		gint64 size_file;
+
+		ptr += 4;
+		/* first number is the position, the second the size,
+		 * number after '#' is the offset (in bytes). */
+		if (brasero_image_format_get_FILE_info (ptr, parent, &size_file, stamps, error))
+			*cue_size += size_file;
+	}
+	else if ((ptr = strstr (line, "AUDIOFILE"))) {
+		gint64 size_file;
+
+		ptr += 4;
+		/* first number is the position, the second the size,
+		 * number after '#' is the offset (in bytes). */
+		if (brasero_image_format_get_FILE_info (ptr, parent, &size_file, stamps, error))
+			*cue_size += size_file;
+	}
+	else if ((ptr = strstr (line, "SILENCE"))) {
+		gint64 size_silence;
+
+		ptr += 7;
+		if (isspace (*ptr)
+		&&  brasero_image_format_get_MSF_address (ptr, &size_silence))
+			*cue_size += size_silence;
+	}
+	else if ((ptr = strstr (line, "PREGAP"))) {
+		gint64 size_pregap;
+
+		ptr += 6;
+		if (isspace (*ptr)
+		&&  brasero_image_format_get_MSF_address (ptr, &size_pregap))
+			*cue_size += size_pregap;
+	}
+	else if ((ptr = strstr (line, "ZERO"))) {
+		gint64 size_zero;
+
+		ptr += 4;
+		if (isspace (*ptr)
+		&&  brasero_image_format_get_MSF_address (ptr, &size_zero))
+			*cue_size += size_zero;
+	}
+}
+
 gboolean
 brasero_image_format_get_cdrdao_size (gchar *uri,
 				      guint64 *sectors,
@@ -448,58 +623,7 @@ brasero_image_format_get_cdrdao_size (gchar *uri,
 
 	parent = g_file_get_parent (file);
 	while ((line = g_data_input_stream_read_line (stream, NULL, cancel, error))) {
-		gchar *ptr;
-
-		if ((ptr = strstr (line, "DATAFILE"))) {
-			gint64 size_file;
-
-			ptr += 8;
-			if (brasero_image_format_get_DATAFILE_info (ptr, parent, &size_file, error))
-				cue_size += size_file;
-		}
-		else if ((ptr = strstr (line, "FILE"))) {
-			gint64 size_file;
-
-			ptr += 4;
-			/* first number is the position, the second the size,
-			 * number after '#' is the offset (in bytes). */
-			if (brasero_image_format_get_FILE_info (ptr, parent, &size_file, error))
-				cue_size += size_file;
-		}
-		else if ((ptr = strstr (line, "AUDIOFILE"))) {
-			gint64 size_file;
-
-			ptr += 4;
-			/* first number is the position, the second the size,
-			 * number after '#' is the offset (in bytes). */
-			if (brasero_image_format_get_FILE_info (ptr, parent, &size_file, error))
-				cue_size += size_file;
-		}
-		else if ((ptr = strstr (line, "SILENCE"))) {
-			gint64 size_silence;
-
-			ptr += 7;
-			if (isspace (*ptr)
-			&&  brasero_image_format_get_MSF_address (ptr, &size_silence))
-				cue_size += size_silence;
-		}
-		else if ((ptr = strstr (line, "PREGAP"))) {
-			gint64 size_pregap;
-
-			ptr += 6;
-			if (isspace (*ptr)
-			&&  brasero_image_format_get_MSF_address (ptr, &size_pregap))
-				cue_size += size_pregap;
-		}
-		else if ((ptr = strstr (line, "ZERO"))) {
-			gint64 size_zero;
-
-			ptr += 4;
-			if (isspace (*ptr)
-			&&  brasero_image_format_get_MSF_address (ptr, &size_zero))
-				cue_size += size_zero;
-		}
-
+		brasero_image_format_cdrdao_line_size (line, parent, &cue_size, NULL, error);
 		g_free (line);
 	}
 	g_object_unref (parent);
@@ -565,6 +689,92 @@ brasero_image_format_cue_bin_byte_swap (gchar *uri,
  * stat every time we catch a FILE keyword.
  */
 
+static gboolean
+brasero_image_format_cue_line_size (const gchar *line,
+				    GFile *file,
+				    gint64 *cue_size,
+				    GSList **stamps,
+				    GError **error)
+{
+	const gchar *ptr;
+
+	if ((ptr = strstr (line, "FILE"))) {
+		GFileInfo *info;
+		gchar *file_path;
+		GFile *file_img = NULL;
+
+		ptr += 4;
+
+		/* get the path (NOTE: if ptr is NULL file_path as well) */
+		ptr = brasero_image_format_read_path (ptr, &file_path);
+		if (!ptr)
+			return FALSE;
+
+		/* check if the path is relative, if so then add the root path */
+		if (file_path && !g_path_is_absolute (file_path)) {
+			GFile *parent;
+
+			parent = g_file_get_parent (file);
+			file_img = g_file_resolve_relative_path (parent, file_path);
+			g_object_unref (parent);
+		}
+		else if (file_path) {
+			gchar *img_uri;
+			gchar *scheme;
+
+			scheme = g_file_get_uri_scheme (file);
+			img_uri = g_strconcat (scheme, "://", file_path, NULL);
+			g_free (scheme);
+
+			file_img = g_file_new_for_commandline_arg (img_uri);
+			g_free (img_uri);
+		}
+
+		g_free (file_path);
+
+		/* NOTE: follow symlink if any */
+		info = g_file_query_info (file_img,
+					  BRASERO_IMAGE_FORMAT_STAMP_ATTRIBUTES,
+					  G_FILE_QUERY_INFO_NONE,
+					  NULL,
+					  error);
+		if (!info) {
+			g_object_unref (file_img);
+			return FALSE;
+		}
+
+		brasero_image_format_add_stamp (stamps, file_img, info);
+		g_object_unref (file_img);
+
+		*cue_size += g_file_info_get_size (info);
+		g_object_unref (info);
+	}
+	else if ((ptr = strstr (line, "PREGAP"))) {
+		ptr += 6;
+		if (isspace (*ptr)) {
+			gint64 size_pregap;
+
+			ptr ++;
+			ptr = brasero_image_format_get_MSF_address (ptr, &size_pregap);
+			if (ptr)
+				*cue_size += size_pregap * 2352;
+		}
+	}
+	else if ((ptr = strstr (line, "POSTGAP"))) {
+		ptr += 7;
+		if (isspace (*ptr)) {
+			gint64 size_postgap;
+
+			ptr ++;
+			ptr = brasero_image_format_get_MSF_address (ptr, &size_postgap);
+			if (ptr)
+				*cue_size += size_postgap * 2352;
+		}
+	}
+
+	return TRUE;
+}
+
 gboolean
 brasero_image_format_get_cue_size (gchar *uri,
 				   guint64 *blocks,
@@ -590,85 +800,11 @@ brasero_image_format_get_cue_size (gchar *uri,
 	g_object_unref (input);
 
 	while ((line = g_data_input_stream_read_line (stream, NULL, cancel, error))) {
-		const gchar *ptr;
-
-		if ((ptr = strstr (line, "FILE"))) {
-			GFileInfo *info;
-			gchar *file_path;
-			GFile *file_img = NULL;
-
-			ptr += 4;
-
-			/* get the path (NOTE: if ptr is NULL file_path as well) */
-			ptr = brasero_image_format_read_path (ptr, &file_path);
-			if (!ptr) {
-				g_object_unref (stream);
-				g_object_unref (file);
-				g_free (line);
-				return FALSE;
-			}
-
-			/* check if the path is relative, if so then add the root path */
-			if (file_path && !g_path_is_absolute (file_path)) {
-				GFile *parent;
-
-				parent = g_file_get_parent (file);
-				file_img = g_file_resolve_relative_path (parent, file_path);
-				g_object_unref (parent);
-			}
-			else if (file_path) {
-				gchar *img_uri;
-				gchar *scheme;
-
-				scheme = g_file_get_uri_scheme (file);
-				img_uri = g_strconcat (scheme, "://", file_path, NULL);
-				g_free (scheme);
-
-				file_img = g_file_new_for_commandline_arg (img_uri);
-				g_free (img_uri);
-			}
-
-			g_free (file_path);
-
-			/* NOTE: follow symlink if any */
-			info = g_file_query_info (file_img,
-						  G_FILE_ATTRIBUTE_STANDARD_SIZE,
-						  G_FILE_QUERY_INFO_NONE,
-						  NULL,
-						  error);
-			g_object_unref (file_img);
-
-			if (!info) {
-				g_free (line);
-				g_object_unref (file);
-				g_object_unref (stream);
-				return FALSE;
-			}
-
-			cue_size += g_file_info_get_size (info);
-			g_object_unref (info);
-		}
-		else if ((ptr = strstr (line, "PREGAP"))) {
-			ptr += 6;
-			if (isspace (*ptr)) {
-				gint64 size_pregap;
-
-				ptr ++;
-				ptr = brasero_image_format_get_MSF_address (ptr, &size_pregap);
-				if (ptr)
-					cue_size += size_pregap * 2352;
-			}
-		}
-		else if ((ptr = strstr (line, "POSTGAP"))) {
-			ptr += 7;
-			if (isspace (*ptr)) {
-				gint64 size_postgap;
-
-				ptr ++;
-				ptr = brasero_image_format_get_MSF_address (ptr, &size_postgap);
-				if (ptr)
-					cue_size += size_postgap * 2352;
-			}
+		if (!brasero_image_format_cue_line_size (line, file, &cue_size, NULL, error)) {
+			g_free (line);
+			g_object_unref (file);
+			g_object_unref (stream);
+			return FALSE;
 		}
 
 		g_free (line);
@@ -685,6 +821,51 @@ brasero_image_format_get_cue_size (gchar *uri,
 	return TRUE;
 }
 
+static BraseroImageFormat
+brasero_image_format_identify_line (const gchar *line)
+{
+	/* Keywords for cdrdao cuesheets */
+	if (strstr (line, "CD_ROM_XA")
+	||  strstr (line, "CD_ROM")
+	||  strstr (line, "CD_DA")
+	||  strstr (line, "CD_TEXT"))
+		return BRASERO_IMAGE_FORMAT_CDRDAO;
+
+	if (strstr (line, "TRACK")) {
+		/* NOTE: there is also "AUDIO" but it's common to both */
+
+		/* CDRDAO */
+		if (strstr (line, "MODE1")
+		||  strstr (line, "MODE1_RAW")
+		||  strstr (line, "MODE2_FORM1")
+		||  strstr (line, "MODE2_FORM2")
+		||  strstr (line, "MODE_2_RAW")
+		||  strstr (line, "MODE2_FORM_MIX")
+		||  strstr (line, "MODE2"))
+			return BRASERO_IMAGE_FORMAT_CDRDAO;
+
+		/* .CUE file */
+		if (strstr (line, "CDG")
+		||  strstr (line, "MODE1/2048")
+		||  strstr (line, "MODE1/2352")
+		||  strstr (line, "MODE2/2336")
+		||  strstr (line, "MODE2/2352")
+		||  strstr (line, "CDI/2336")
+		||  strstr (line, "CDI/2352"))
+			return BRASERO_IMAGE_FORMAT_CUE;
+	}
+	else if (strstr (line, "FILE")) {
+		if (strstr (line, "MOTOROLA")
+		||  strstr (line, "BINARY")
+		||  strstr (line, "AIFF")
+		||  strstr (line, "WAVE")
+		||  strstr (line, "MP3"))
+			return BRASERO_IMAGE_FORMAT_CUE;
+	}
+
+	return BRASERO_IMAGE_FORMAT_NONE;
+}
+
 BraseroImageFormat
 brasero_image_format_identify_cuesheet (const gchar *uri,
 					GCancellable *cancel,
@@ -708,57 +889,11 @@ brasero_image_format_identify_cuesheet (const gchar *uri,
 
 	format = BRASERO_IMAGE_FORMAT_NONE;
 	while ((line = g_data_input_stream_read_line (stream, NULL, cancel, error))) {
-		/* Keywords for cdrdao cuesheets */
-		if (strstr (line, "CD_ROM_XA")
-		||  strstr (line, "CD_ROM")
-		||  strstr (line, "CD_DA")
-		||  strstr (line, "CD_TEXT")) {
-			format = BRASERO_IMAGE_FORMAT_CDRDAO;
-			g_free (line);
-			break;
-		}
-		else if (strstr (line, "TRACK")) {
-			/* NOTE: there is also "AUDIO" but it's common to both */
-
-			/* CDRDAO */
-			if (strstr (line, "MODE1")
-			||  strstr (line, "MODE1_RAW")
-			||  strstr (line, "MODE2_FORM1")
-			||  strstr (line, "MODE2_FORM2")
-			||  strstr (line, "MODE_2_RAW")
-			||  strstr (line, "MODE2_FORM_MIX")
-			||  strstr (line, "MODE2")) {
-				format = BRASERO_IMAGE_FORMAT_CDRDAO;
-				g_free (line);
-				break;
-			}
-
-			/* .CUE file */
-			else if (strstr (line, "CDG")
-			     ||  strstr (line, "MODE1/2048")
-			     ||  strstr (line, "MODE1/2352")
-			     ||  strstr (line, "MODE2/2336")
-			     ||  strstr (line, "MODE2/2352")
-			     ||  strstr (line, "CDI/2336")
-			     ||  strstr (line, "CDI/2352")) {
-				format = BRASERO_IMAGE_FORMAT_CUE;
-				g_free (line);
-				break;
-			}
-		}
-		else if (strstr (line, "FILE")) {
-			if (strstr (line, "MOTOROLA")
-			||  strstr (line, "BINARY")
-			||  strstr (line, "AIFF")
-			||  strstr (line, "WAVE")
-			||  strstr (line, "MP3")) {
-				format = BRASERO_IMAGE_FORMAT_CUE;
-				g_free (line);
-				break;
-			}
-		}
+		format = brasero_image_format_identify_line (line);
 		g_free (line);
-		line = NULL;
+
+		if (format != BRASERO_IMAGE_FORMAT_NONE)
+			break;
 	}
 
 	g_object_unref (stream);
@@ -841,6 +976,381 @@ brasero_image_format_get_clone_size (gchar *uri,
 	return TRUE;
 }
 
+static gboolean
+brasero_image_format_next_line (const gchar **ptr,
+				const gchar *end,
+				GString *line)
+{
+	const gchar *eol;
+
+	if (*ptr >= end)
+		return FALSE;
+
+	eol = memchr (*ptr, '\n', end - *ptr);
+	if (!eol)
+		eol = end;
+
+	g_string_truncate (line, 0);
+	g_string_append_len (line, *ptr, eol - *ptr);
+
+	*ptr = eol + 1;
+	return TRUE;
+}
+
+static gboolean
+brasero_image_format_cached_is_valid (BraseroImageFormatCached *cached,
+				      GFileInfo *image_info,
+				      GCancellable *cancel)
+{
+	BraseroImageFormatStamp *stamp;
+	GSList *iter;
+
+	/* The image itself was already queried */
+	stamp = cached->stamps->data;
+	if (stamp->size != g_file_info_get_size (image_info)
+	||  stamp->mtime != g_file_info_get_attribute_uint64 (image_info, G_FILE_ATTRIBUTE_TIME_MODIFIED))
+		return FALSE;
+
+	for (iter = cached->stamps->next; iter; iter = iter->next) {
+		GFileInfo *info;
+		gboolean valid;
+		GFile *file;
+
+		stamp = iter->data;
+
+		file = g_file_new_for_uri (stamp->uri);
+		info = g_file_query_info (file,
+					  BRASERO_IMAGE_FORMAT_STAMP_ATTRIBUTES,
+					  G_FILE_QUERY_INFO_NONE,
+					  cancel,
+					  NULL);
+		g_object_unref (file);
+
+		if (!info)
+			return FALSE;
+
+		valid = (stamp->size == g_file_info_get_size (info)
+		     &&  stamp->mtime == g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED));
+		g_object_unref (info);
+
+		if (!valid)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+brasero_image_format_cache_lookup (const gchar *uri,
+				   GFileInfo *image_info,
+				   BraseroImageFormat *format,
+				   guint64 *blocks,
+				   GCancellable *cancel)
+{
+	BraseroImageFormatCached *cached;
+	gboolean found = FALSE;
+
+	G_LOCK (image_cache);
+
+	if (!image_cache) {
+		G_UNLOCK (image_cache);
+		return FALSE;
+	}
+
+	cached = g_hash_table_lookup (image_cache, uri);
+	if (cached && cached->forced == *format) {
+		if (brasero_image_format_cached_is_valid (cached, image_info, cancel)) {
+			*format = cached->format;
+			*blocks = cached->blocks;
+			found = TRUE;
+		}
+		else
+			g_hash_table_remove (image_cache, uri);
+	}
+
+	G_UNLOCK (image_cache);
+
+	return found;
+}
+
+static void
+brasero_image_format_cache_add (const gchar *uri,
+				BraseroImageFormat forced,
+				BraseroImageFormat format,
+				guint64 blocks,
+				GSList *stamps)
+{
+	BraseroImageFormatCached *cached;
+
+	cached = g_new0 (BraseroImageFormatCached, 1);
+	cached->forced = forced;
+	cached->format = format;
+	cached->blocks = blocks;
+	cached->stamps = stamps;
+
+	G_LOCK (image_cache);
+
+	if (!image_cache)
+		image_cache = g_hash_table_new_full (g_str_hash,
+						     g_str_equal,
+						     g_free,
+						     brasero_image_format_cached_free);
+
+	/* Keep it simple; the image chooser never needs many entries */
+	if (g_hash_table_size (image_cache) >= BRASERO_IMAGE_FORMAT_CACHE_MAX)
+		g_hash_table_remove_all (image_cache);
+
+	g_hash_table_replace (image_cache, g_strdup (uri), cached);
+
+	G_UNLOCK (image_cache);
+}
+
+/**
+ * brasero_image_format_identify:
+ * @uri: a #gchar
+ * @format: a #BraseroImageFormat; on entry the format to use or
+ * BRASERO_IMAGE_FORMAT_NONE to identify it, on return the format found
+ * @blocks: a #guint64 to hold the size of the image in sectors
+ * @cancel: a #GCancellable
+ * @error: a #GError
+ *
+ * Identifies and sizes a local image in one go. The image is mapped once;
+ * its content type is guessed from its first blocks and cue or toc files are
+ * parsed in memory. Results are cached until the image or one of the files
+ * it references changes.
+ *
+ * Return value: BRASERO_BURN_OK if it was identified (@format can still be
+ * BRASERO_IMAGE_FORMAT_NONE if the file is not an image),
+ * BRASERO_BURN_NOT_SUPPORTED if the file is not local and BRASERO_BURN_ERR
+ * if an error occurred.
+ **/
+
+BraseroBurnResult
+brasero_image_format_identify (const gchar *uri,
+			       BraseroImageFormat *format,
+			       guint64 *blocks,
+			       GCancellable *cancel,
+			       GError **error)
+{
+	GFile *file;
+	gchar *path;
+	gsize length = 0;
+	GFileInfo *info;
+	GSList *stamps = NULL;
+	gint64 cue_size = 0;
+	BraseroImageFormat forced;
+	GMappedFile *mapped = NULL;
+	const gchar *contents = NULL;
+
+	file = g_file_new_for_commandline_arg (uri);
+	path = g_file_get_path (file);
+	if (!path) {
+		g_object_unref (file);
+		return BRASERO_BURN_NOT_SUPPORTED;
+	}
+
+	/* NOTE: follow symlink if any */
+	info = g_file_query_info (file,
+				  BRASERO_IMAGE_FORMAT_STAMP_ATTRIBUTES,
+				  G_FILE_QUERY_INFO_NONE,
+				  cancel,
+				  error);
+	if (!info) {
+		g_object_unref (file);
+		g_free (path);
+		return BRASERO_BURN_ERR;
+	}
+
+	forced = *format;
+	if (brasero_image_format_cache_lookup (uri, info, format, blocks, cancel)) {
+		BRASERO_BURN_LOG ("Image information found in cache");
+		g_object_unref (info);
+		g_object_unref (file);
+		g_free (path);
+		return BRASERO_BURN_OK;
+	}
+
+	brasero_image_format_add_stamp (&stamps, file, info);
+
+	if (forced == BRASERO_IMAGE_FORMAT_NONE) {
+		gchar buffer [BRASERO_IMAGE_FORMAT_HEAD_SIZE];
+		gssize read;
+		gchar *mime;
+
+		/* Only the first blocks are needed to guess the type. Images
+		 * can be several GiB so they are never mapped. */
+		read = brasero_image_format_read_head (path, buffer, sizeof (buffer), error);
+		if (read < 0)
+			goto error;
+
+		mime = g_content_type_guess (path,
+					     (const guchar *) buffer,
+					     read,
+					     NULL);
+
+		if (mime
+		&& (!strcmp (mime, "application/x-toc")
+		||  !strcmp (mime, "application/x-cdrdao-toc")
+		||  !strcmp (mime, "application/x-cue"))) {
+			if (g_file_info_get_size (info) <= BRASERO_IMAGE_FORMAT_MAX_SHEET_SIZE) {
+				GString *line;
+				const gchar *ptr;
+
+				mapped = g_mapped_file_new (path, FALSE, error);
+				if (!mapped) {
+					g_free (mime);
+					goto error;
+				}
+
+				contents = g_mapped_file_get_contents (mapped);
+				length = g_mapped_file_get_length (mapped);
+
+				ptr = contents;
+				line = g_string_new (NULL);
+				while (*format == BRASERO_IMAGE_FORMAT_NONE
+				&&     brasero_image_format_next_line (&ptr, contents + length, line))
+					*format = brasero_image_format_identify_line (line->str);
+				g_string_free (line, TRUE);
+			}
+
+			BRASERO_BURN_LOG_WITH_FULL_TYPE (BRASERO_TRACK_TYPE_IMAGE,
+							 *format,
+							 BRASERO_BURN_FLAG_NONE,
+							 "Detected");
+
+			if (*format == BRASERO_IMAGE_FORMAT_NONE
+			&&  g_str_has_suffix (uri, ".toc"))
+				*format = BRASERO_IMAGE_FORMAT_CLONE;
+		}
+		else if (mime && !strcmp (mime, "application/octet-stream")) {
+			/* that could be an image, so here is the deal:
+			 * if we can find the type through the extension, fine.
+			 * if not default to BIN */
+			if (g_str_has_suffix (uri, ".bin"))
+				*format = BRASERO_IMAGE_FORMAT_CDRDAO;
+			else if (g_str_has_suffix (uri, ".raw"))
+				*format = BRASERO_IMAGE_FORMAT_CLONE;
+			else
+				*format = BRASERO_IMAGE_FORMAT_BIN;
+		}
+		else if (mime && !strcmp (mime, "application/x-cd-image"))
+			*format = BRASERO_IMAGE_FORMAT_BIN;
+
+		g_free (mime);
+	}
+	else if (forced == BRASERO_IMAGE_FORMAT_CUE
+	     ||  forced == BRASERO_IMAGE_FORMAT_CDRDAO) {
+		/* No need to map a BIN or CLONE image whose format is known */
+		if (g_file_info_get_size (info) > BRASERO_IMAGE_FORMAT_MAX_SHEET_SIZE) {
+			g_set_error (error,
+				     BRASERO_BURN_ERROR,
+				     BRASERO_BURN_ERROR_GENERAL,
+				     _("\"%s\" is not a valid cue sheet"),
+				     path);
+			goto error;
+		}
+
+		mapped = g_mapped_file_new (path, FALSE, error);
+		if (!mapped)
+			goto error;
+
+		contents = g_mapped_file_get_contents (mapped);
+		length = g_mapped_file_get_length (mapped);
+	}
+
+	*blocks = 0;
+	if (*format == BRASERO_IMAGE_FORMAT_BIN)
+		*blocks = BRASERO_BYTES_TO_SECTORS (g_file_info_get_size (info), 2048);
+	else if (*format == BRASERO_IMAGE_FORMAT_CLONE) {
+		GFileInfo *clone_info;
+		gchar *complement;
+		GFile *clone;
+
+		complement = brasero_image_format_get_complement (BRASERO_IMAGE_FORMAT_CLONE, uri);
+		if (!complement)
+			goto error;
+
+		clone = g_file_new_for_commandline_arg (complement);
+		g_free (complement);
+
+		clone_info = g_file_query_info (clone,
+						BRASERO_IMAGE_FORMAT_STAMP_ATTRIBUTES,
+						G_FILE_QUERY_INFO_NONE,
+						cancel,
+						error);
+		if (!clone_info) {
+			g_object_unref (clone);
+			goto error;
+		}
+
+		brasero_image_format_add_stamp (&stamps, clone, clone_info);
+		g_object_unref (clone);
+
+		*blocks = BRASERO_BYTES_TO_SECTORS (g_file_info_get_size (clone_info), 2448);
+		g_object_unref (clone_info);
+	}
+	else if (*format == BRASERO_IMAGE_FORMAT_CDRDAO
+	     ||  *format == BRASERO_IMAGE_FORMAT_CUE) {
+		const gchar *ptr = contents;
+		gboolean failed = FALSE;
+		GFile *parent;
+		GString *line;
+
+		parent = g_file_get_parent (file);
+		line = g_string_new (NULL);
+		while (brasero_image_format_next_line (&ptr, contents + length, line)) {
+			if (g_cancellable_is_cancelled (cancel))
+				break;
+
+			/* NOTE: like get_cdrdao_size () a file that can't be
+			 * found is not fatal for cdrdao cuesheets */
+			if (*format == BRASERO_IMAGE_FORMAT_CDRDAO)
+				brasero_image_format_cdrdao_line_size (line->str, parent, &cue_size, &stamps, error);
+			else if (!brasero_image_format_cue_line_size (line->str, file, &cue_size, &stamps, error)) {
+				failed = TRUE;
+				break;
+			}
+		}
+		g_string_free (line, TRUE);
+		g_object_unref (parent);
+
+		if (failed)
+			goto error;
+
+		if (*format == BRASERO_IMAGE_FORMAT_CDRDAO)
+			*blocks = cue_size;
+		else
+			*blocks = BRASERO_BYTES_TO_SECTORS (cue_size, 2352);
+	}
+
+	if (mapped)
+		g_mapped_file_unref (mapped);
+
+	if (!g_cancellable_is_cancelled (cancel)
+	&&  (!error || !(*error)))
+		brasero_image_format_cache_add (uri, forced, *format, *blocks, stamps);
+	else
+		brasero_image_format_free_stamps (stamps);
+
+	g_object_unref (info);
+	g_object_unref (file);
+	g_free (path);
+
+	return BRASERO_BURN_OK;
+
+error:
+
+	if (mapped)
+		g_mapped_file_unref (mapped);
+
+	brasero_image_format_free_stamps (stamps);
+	g_object_unref (info);
+	g_object_unref (file);
+	g_free (path);
+
+	return BRASERO_BURN_ERR;
+}
+
 gchar *
 brasero_image_format_get_default_path (BraseroImageFormat format,
 				       const gchar *name)
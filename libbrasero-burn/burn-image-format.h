@@ -79,6 +79,13 @@ brasero_image_format_get_clone_size (gchar *uri,
 				     GCancellable *cancel,
 				     GError **error);
 
+BraseroBurnResult
+brasero_image_format_identify (const gchar *uri,
+			       BraseroImageFormat *format,
+			       guint64 *blocks,
+			       GCancellable *cancel,
+			       GError **error);
+
 gboolean
 brasero_image_format_cue_bin_byte_swap (gchar *uri,
 					GCancellable *cancel,
@@ -55,6 +55,7 @@
 #include "brasero-plugin-information.h"
 #include "burn-job.h"
 #include "burn-task-ctx.h"
+#include "burn-buffer-history.h"
 #include "burn-task-item.h"
 #include "libbrasero-marshal.h"
 
@@ -1509,6 +1510,36 @@ brasero_job_get_device (BraseroJob *self, gchar **device)
 	return BRASERO_BURN_OK;
 }
 
+/**
+ * Returns the size (in MiB) of the FIFO a recorder should use given the
+ * levels reached during the previous burns with the same drive.
+ */
+
+BraseroBurnResult
+brasero_job_get_fifo_size (BraseroJob *self,
+			   guint default_size,
+			   guint *fifo_size)
+{
+	BraseroBurnSession *session;
+	BraseroJobPrivate *priv;
+	BraseroDrive *drive;
+
+	BRASERO_JOB_DEBUG (self);
+
+	g_return_val_if_fail (fifo_size != NULL, BRASERO_BURN_ERR);
+
+	priv = BRASERO_JOB_PRIVATE (self);
+	session = brasero_task_ctx_get_session (priv->ctx);
+	drive = brasero_burn_session_get_burner (session);
+
+	*fifo_size = brasero_buffer_history_get_fifo_size (drive, default_size);
+	if (brasero_buffer_history_get_underrun_risk (drive))
+		BRASERO_JOB_LOG (self, "Buffers were almost empty during the last burn with this drive; there is a risk of buffer underrun");
+
+	brasero_task_ctx_set_fifo_size (priv->ctx, *fifo_size);
+	return BRASERO_BURN_OK;
+}
+
 BraseroBurnResult
 brasero_job_get_media (BraseroJob *self, BraseroMedia *media)
 {
@@ -1905,6 +1936,23 @@ brasero_job_set_rate (BraseroJob *self,
 	return brasero_task_ctx_set_rate (priv->ctx, rate);
 }
 
+BraseroBurnResult
+brasero_job_set_buffer_levels (BraseroJob *self,
+			       gint fifo,
+			       gint buffer)
+{
+	BraseroJobPrivate *priv;
+
+	/* Turn this off as otherwise it floods bug reports */
+	// BRASERO_JOB_DEBUG (self);
+
+	priv = BRASERO_JOB_PRIVATE (self);
+	if (priv->next)
+		return BRASERO_BURN_NOT_RUNNING;
+
+	return brasero_task_ctx_set_buffer_levels (priv->ctx, fifo, buffer);
+}
+
 BraseroBurnResult
 brasero_job_set_output_size_for_current_track (BraseroJob *self,
 					       goffset sectors,
@@ -174,6 +174,11 @@ brasero_job_get_next_writable_address (BraseroJob *job, goffset *address);
 BraseroBurnResult
 brasero_job_get_rate (BraseroJob *job, guint64 *rate);
 
+BraseroBurnResult
+brasero_job_get_fifo_size (BraseroJob *job,
+			   guint default_size,
+			   guint *fifo_size);
+
 BraseroBurnResult
 brasero_job_get_speed (BraseroJob *self, guint *speed);
 
@@ -265,6 +270,10 @@ BraseroBurnResult
 brasero_job_set_rate (BraseroJob *job,
 		      gint64 rate);
 BraseroBurnResult
+brasero_job_set_buffer_levels (BraseroJob *job,
+			       gint fifo,
+			       gint buffer);
+BraseroBurnResult
 brasero_job_set_written_track (BraseroJob *job,
 			       goffset written);
 BraseroBurnResult
@@ -51,14 +51,25 @@
 #include "brasero-track.h"
 #include "burn-mkisofs-base.h"
 
+/* Lines are written to the lists through a buffer of that size */
+#define BRASERO_MKISOFS_BUFFER_SIZE		65536
+
+struct _BraseroMkisofsBuffer {
+	gint fd;
+	guint lines;
+	gsize len;
+	gchar *data;
+};
+typedef struct _BraseroMkisofsBuffer BraseroMkisofsBuffer;
+
 struct _BraseroMkisofsBase {
 	const gchar *emptydir;
 	const gchar *videodir;
 
-	gint grafts_fd;
-	gint excluded_fd;
+	BraseroMkisofsBuffer grafts;
+	BraseroMkisofsBuffer excluded;
 
-	GHashTable *grafts;
+	GHashTable *graft_uris;
 
 	guint found_video_ts:1;
 	guint use_joliet:1;
@@ -78,36 +89,118 @@ brasero_mkisofs_base_clean (BraseroMkisofsBase *base)
 	 * graft and excluded list, flags and that's what
 	 * we're going to use when we'll start the image 
 	 * creation */
-	if (base->grafts_fd)
-		close (base->grafts_fd);
-	if (base->excluded_fd)
-		close (base->excluded_fd);
-	if (base->grafts) {
-		g_hash_table_destroy (base->grafts);
-		base->grafts = NULL;
+	if (base->grafts.fd > 0)
+		close (base->grafts.fd);
+	if (base->excluded.fd > 0)
+		close (base->excluded.fd);
+
+	g_free (base->grafts.data);
+	g_free (base->excluded.data);
+
+	if (base->graft_uris) {
+		g_hash_table_destroy (base->graft_uris);
+		base->graft_uris = NULL;
 	}
 }
 
 static BraseroBurnResult
-_write_line (int fd, const gchar *filepath, GError **error)
+_buffer_flush (BraseroMkisofsBuffer *buffer,
+	       GError **error)
 {
-	gint len;
-	gint w_len;
+	gsize written = 0;
+
+	while (written < buffer->len) {
+		gssize w_len;
+
+		w_len = write (buffer->fd, buffer->data + written, buffer->len - written);
+		if (w_len < 0) {
+			if (errno == EINTR)
+				continue;
+
+			g_set_error (error,
+				     BRASERO_BURN_ERROR,
+				     BRASERO_BURN_ERROR_GENERAL,
+				     "%s",
+				     g_strerror (errno));
+			return BRASERO_BURN_ERR;
+		}
 
-	if (lseek (fd, 0, SEEK_CUR)
-	&&  write (fd, "\n", 1) != 1) {
-		g_set_error (error,
-			     BRASERO_BURN_ERROR,
-			     BRASERO_BURN_ERROR_GENERAL,
-			     "%s",
-			     g_strerror (errno));
-		return BRASERO_BURN_ERR;
+		written += w_len;
+	}
+
+	buffer->len = 0;
+	return BRASERO_BURN_OK;
+}
+
+static BraseroBurnResult
+_buffer_append (BraseroMkisofsBuffer *buffer,
+		const gchar *string,
+		gsize len,
+		GError **error)
+{
+	while (len) {
+		gsize chunk;
+
+		if (buffer->len == BRASERO_MKISOFS_BUFFER_SIZE
+		&&  _buffer_flush (buffer, error) != BRASERO_BURN_OK)
+			return BRASERO_BURN_ERR;
+
+		chunk = MIN (len, BRASERO_MKISOFS_BUFFER_SIZE - buffer->len);
+		memcpy (buffer->data + buffer->len, string, chunk);
+		buffer->len += chunk;
+		string += chunk;
+		len -= chunk;
+	}
+
+	return BRASERO_BURN_OK;
+}
+
+/**
+ * Appends @string escaping all characters in @forbidden with a backslash
+ */
+
+static BraseroBurnResult
+_buffer_append_escaped (BraseroMkisofsBuffer *buffer,
+			const gchar *string,
+			const gchar *forbidden,
+			GError **error)
+{
+	const gchar *start;
+
+	for (start = string; *string; string ++) {
+		if (!strchr (forbidden, *string))
+			continue;
+
+		if (_buffer_append (buffer, start, string - start, error) != BRASERO_BURN_OK)
+			return BRASERO_BURN_ERR;
+
+		if (_buffer_append (buffer, "\\", 1, error) != BRASERO_BURN_OK)
+			return BRASERO_BURN_ERR;
+
+		start = string;
 	}
 
-	len = strlen (filepath);
-	w_len = write (fd, filepath, len);
+	return _buffer_append (buffer, start, string - start, error);
+}
+
+static BraseroBurnResult
+_buffer_new_line (BraseroMkisofsBuffer *buffer,
+		  GError **error)
+{
+	/* Lines are separated, not terminated, by newlines */
+	if (buffer->lines ++)
+		return _buffer_append (buffer, "\n", 1, error);
 
-	if (w_len != len) {
+	return BRASERO_BURN_OK;
+}
+
+static BraseroBurnResult
+_buffer_open (BraseroMkisofsBuffer *buffer,
+	      const gchar *path,
+	      GError **error)
+{
+	buffer->fd = open (path, O_WRONLY|O_TRUNC|O_EXCL);
+	if (buffer->fd == -1) {
 		g_set_error (error,
 			     BRASERO_BURN_ERROR,
 			     BRASERO_BURN_ERROR_GENERAL,
@@ -116,6 +209,9 @@ _write_line (int fd, const gchar *filepath, GError **error)
 		return BRASERO_BURN_ERR;
 	}
 
+	buffer->data = g_malloc (BRASERO_MKISOFS_BUFFER_SIZE);
+	buffer->len = 0;
+	buffer->lines = 0;
 	return BRASERO_BURN_OK;
 }
 
@@ -124,11 +220,8 @@ brasero_mkisofs_base_write_excluded (BraseroMkisofsBase *base,
 				     const gchar *uri,
 				     GError **error)
 {
-	gint num;
-	gint forbidden;
-	gchar *character;
 	gchar *localpath;
-	BraseroBurnResult result = BRASERO_BURN_OK;
+	BraseroBurnResult result;
 
 	/* make sure uri is local: otherwise error out */
 	/* FIXME: uri can be path or URI? problem with graft->uri */
@@ -161,123 +254,57 @@ brasero_mkisofs_base_write_excluded (BraseroMkisofsBase *base,
 
 	/* we need to escape some characters like []\? since in this file we
 	 * can use glob like expressions. */
-	character = localpath;
-	forbidden = 0;
-	num = 0;
-
-	while (character [0]) {
-		if (character [0] == '['
-		||  character [0] == ']'
-		||  character [0] == '?'
-		||  character [0] == '\\')
-			forbidden++;
-
-		num++;
-		character++;
-	}
-
-	if (forbidden) {
-		gchar *tmp;
-		gint i;
-
-		tmp = g_new0 (gchar, num + forbidden + 1);
-		character = tmp;
-
-		for (i = 0; i < num; i++) {
-			if (localpath [i] == '['
-			||  localpath [i] == ']'
-			||  localpath [i] == '?'
-			||  localpath [i] == '\\') {
-				character [i] = '\\';
-				character++;
-			}
-			character [i] = localpath [i];
-		}
-
-		BRASERO_BURN_LOG ("Escaped path %s into %s", localpath, tmp);
-		g_free (localpath);
-		localpath = tmp;
-	}
-
-	/* we just ignore if localpath is NULL:
-	 * - it could be a non local whose graft point couldn't be downloaded */
-	if (localpath)
-		result = _write_line (base->excluded_fd, localpath, error);
+	result = _buffer_new_line (&base->excluded, error);
+	if (result == BRASERO_BURN_OK)
+		result = _buffer_append_escaped (&base->excluded,
+						 localpath,
+						 "[]?\\",
+						 error);
 
 	g_free (localpath);
 	return result;
 }
 
-static gchar *
-_escape_path (const gchar *str)
-{
-	gchar *escaped, *d;
-	const gchar *s;
-	gint len;
-
-	s = str;
-	len = 1;
-	while (*s != 0) {
-		if (*s == '\\' || *s == '=') {
-			len++;
-		}
-
-		len++;
-		s++;
-	}
-
-	escaped = g_malloc (len);
-
-	s = str;
-	d = escaped;
-	while (*s != 0) {
-		if (*s == '\\' || *s == '=') {
-			*d++ = '\\';
-		}
-
-		*d++ = *s++;
-	}
-	*d = 0;
-
-	return escaped;
-}
-
-static gchar *
-_build_graft_point (const gchar *uri, const gchar *discpath)
+static BraseroBurnResult
+_write_graft_point (BraseroMkisofsBuffer *buffer,
+		    const gchar *uri,
+		    const gchar *discpath,
+		    GError **error)
 {
-	gchar *escaped_discpath;
-	gchar *graft_point;
+	BraseroBurnResult result;
 	gchar *path;
 
-	if (uri == NULL || discpath == NULL)
-		return NULL;
+	if (uri == NULL || discpath == NULL) {
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     /* Translators: Error message saying no graft point
+			      * is specified. A graft point is the path (on the
+			      * disc) where a file from any source will be added
+			      * ("grafted") */
+			     _("An internal error occurred"));
+		return BRASERO_BURN_ERR;
+	}
 
 	/* make up the graft point */
 	if (*uri != '/')
 		path = g_filename_from_uri (uri, NULL, NULL);
 	else
-		path = g_strdup (uri);
-
-	if (discpath) {
-		gchar *escaped_path;
-
-		/* There is a graft because either it's not at the root of the 
-		 * disc or because its name has changed. */
-		escaped_path = _escape_path (path);
-		g_free (path);
-
-		escaped_discpath = _escape_path (discpath);
-		graft_point = g_strconcat (escaped_discpath,
-					   "=",
-					   escaped_path,
-					   NULL);
-		g_free (escaped_path);
-		g_free (escaped_discpath);
-	}
-	else
-		graft_point = path;
+		path = NULL;
+
+	/* There is a graft because either it's not at the root of the disc
+	 * or because its name has changed: "discpath=path" where both parts
+	 * have '\\' and '=' escaped. */
+	result = _buffer_new_line (buffer, error);
+	if (result == BRASERO_BURN_OK)
+		result = _buffer_append_escaped (buffer, discpath, "\\=", error);
+	if (result == BRASERO_BURN_OK)
+		result = _buffer_append (buffer, "=", 1, error);
+	if (result == BRASERO_BURN_OK)
+		result = _buffer_append_escaped (buffer, path ? path:uri, "\\=", error);
 
-	return graft_point;
+	g_free (path);
+	return result;
 }
 
 static BraseroBurnResult
@@ -286,29 +313,8 @@ brasero_mkisofs_base_write_graft (BraseroMkisofsBase *base,
 				  const gchar *disc_path,
 				  GError **error)
 {
-	gchar *graft_point;
-	BraseroBurnResult result;
-
 	/* build up graft and write it */
-	graft_point = _build_graft_point (uri, disc_path);
-	if (!graft_point) {
-		g_set_error (error,
-			     BRASERO_BURN_ERROR,
-			     BRASERO_BURN_ERROR_GENERAL,
-			     /* Translators: Error message saying no graft point
-			      * is specified. A graft point is the path (on the
-			      * disc) where a file from any source will be added
-			      * ("grafted") */
-			     _("An internal error occurred"));
-		return BRASERO_BURN_ERR;
-	}
-
-	result = _write_line (base->grafts_fd, graft_point, error);
-	g_free (graft_point);
-	if (result != BRASERO_BURN_OK)
-		return result;
-
-	return BRASERO_BURN_OK;
+	return _write_graft_point (&base->grafts, uri, disc_path, error);
 }
 
 static gboolean
@@ -354,7 +360,7 @@ brasero_mkisofs_base_write_grafts (BraseroMkisofsBase *base,
 	callback_data.error = error;
 	callback_data.base = base;
 
-	result = g_hash_table_find (base->grafts,
+	result = g_hash_table_find (base->graft_uris,
 				    (GHRFunc) _foreach_write_grafts,
 				    &callback_data);
 
@@ -393,9 +399,6 @@ brasero_mkisofs_base_empty_directory (BraseroMkisofsBase *base,
 				      const gchar *disc_path,
 				      GError **error)
 {
-	BraseroBurnResult result;
-	gchar *graft_point;
-
 	/* This is a special case when the URI is NULL which can happen mainly
 	 * when we have to deal with burn:// uri. */
 	if (base->videodir) {
@@ -414,11 +417,7 @@ brasero_mkisofs_base_empty_directory (BraseroMkisofsBase *base,
 	}
 
 	/* Special case for uri = NULL; that is treated as if it were a directory */
-	graft_point = _build_graft_point (base->emptydir, disc_path);
-	result = _write_line (base->grafts_fd, graft_point, error);
-	g_free (graft_point);
-
-	return result;
+	return _write_graft_point (&base->grafts, base->emptydir, disc_path, error);
 }
 
 static BraseroBurnResult
@@ -543,12 +542,12 @@ brasero_mkisofs_base_add_graft (BraseroMkisofsBase *base,
 	}
 
 	/* add the graft point */
-	list = g_hash_table_lookup (base->grafts, graft->uri);
+	list = g_hash_table_lookup (base->graft_uris, graft->uri);
 	if (list)
-		g_hash_table_steal (base->grafts, graft->uri);
+		g_hash_table_steal (base->graft_uris, graft->uri);
 
 	list = g_slist_prepend (list, graft);
-	g_hash_table_insert (base->grafts, graft->uri, list);
+	g_hash_table_insert (base->graft_uris, graft->uri, list);
 
 	return BRASERO_BURN_OK;
 }
@@ -575,24 +574,11 @@ brasero_mkisofs_base_write_to_files (GSList *grafts,
 	/* initialize base */
 	bzero (&base, sizeof (base));
 
-	base.grafts_fd = open (grafts_path, O_WRONLY|O_TRUNC|O_EXCL);
-	if (base.grafts_fd == -1) {
-		g_set_error (error,
-			     BRASERO_BURN_ERROR,
-			     BRASERO_BURN_ERROR_GENERAL,
-			     "%s",
-			     g_strerror (errno));
+	if (_buffer_open (&base.grafts, grafts_path, error) != BRASERO_BURN_OK)
 		return BRASERO_BURN_ERR;
-	}
 
-	base.excluded_fd = open (excluded_path, O_WRONLY|O_TRUNC|O_EXCL);
-	if (base.excluded_fd == -1) {
-		close (base.excluded_fd);
-		g_set_error (error,
-			     BRASERO_BURN_ERROR,
-			     BRASERO_BURN_ERROR_GENERAL,
-			     "%s",
-			     g_strerror (errno));
+	if (_buffer_open (&base.excluded, excluded_path, error) != BRASERO_BURN_OK) {
+		brasero_mkisofs_base_clean (&base);
 		return BRASERO_BURN_ERR;
 	}
 
@@ -600,7 +586,7 @@ brasero_mkisofs_base_write_to_files (GSList *grafts,
 	base.emptydir = emptydir;
 	base.videodir = videodir;
 
-	base.grafts = g_hash_table_new_full (g_str_hash,
+	base.graft_uris = g_hash_table_new_full (g_str_hash,
 					     g_str_equal,
 					     NULL,
 					    (GDestroyNotify) g_slist_free);
@@ -642,7 +628,8 @@ brasero_mkisofs_base_write_to_files (GSList *grafts,
 			     BRASERO_BURN_ERROR,
 			     BRASERO_BURN_ERROR_GENERAL,
 			     _("VIDEO_TS directory is missing or invalid"));
-		return BRASERO_BURN_ERR;
+		result = BRASERO_BURN_ERR;
+		goto cleanup;
 	}
 
 	/* write the grafts list */
@@ -665,6 +652,14 @@ brasero_mkisofs_base_write_to_files (GSList *grafts,
 			goto cleanup;
 	}
 
+	result = _buffer_flush (&base.grafts, error);
+	if (result != BRASERO_BURN_OK)
+		goto cleanup;
+
+	result = _buffer_flush (&base.excluded, error);
+	if (result != BRASERO_BURN_OK)
+		goto cleanup;
+
 	brasero_mkisofs_base_clean (&base);
 	return BRASERO_BURN_OK;
 
@@ -0,0 +1,538 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include "burn-basics.h"
+#include "burn-debug.h"
+#include "brasero-track-data.h"
+#include "burn-prefetch.h"
+
+#define BRASERO_SCHEMA_CONFIG		"org.gnome.brasero.config"
+#define BRASERO_KEY_PREFETCH_WINDOW	"prefetch-window"
+
+/* Files are read ahead by chunks of that size at most so that the window
+ * is respected even with big files */
+#define BRASERO_PREFETCH_CHUNK		(4 * 1024 * 1024)
+
+struct _BraseroPrefetchFile {
+	gchar *disc_path;
+	gchar *path;
+
+	/* Length of the parent directory part of disc_path, computed once
+	 * so that sorting doesn't have to split the paths again */
+	gsize dir_len;
+
+	goffset offset;
+	goffset size;
+};
+typedef struct _BraseroPrefetchFile BraseroPrefetchFile;
+
+struct _BraseroPrefetch {
+	/* Pairs of disc path / local path for every graft point */
+	GPtrArray *grafts;
+	GHashTable *excluded;
+
+	/* Files sorted in the order they are written in the image */
+	GPtrArray *files;
+	goffset total;
+
+	goffset window;
+
+	GThread *thread;
+	GMutex *mutex;
+	GCond *cond;
+
+	/* What the imager read so far and what was read ahead */
+	goffset position;
+	goffset advised;
+	guint consumed;
+
+	/* Stats */
+	guint hits;
+	guint misses;
+	goffset advised_bytes;
+
+	guint ready:1;
+	guint cancel:1;
+};
+
+static void
+brasero_prefetch_file_free (BraseroPrefetchFile *file)
+{
+	g_free (file->disc_path);
+	g_free (file->path);
+	g_free (file);
+}
+
+static gchar *
+brasero_prefetch_uri_to_path (const gchar *uri)
+{
+	if (!uri)
+		return NULL;
+
+	/* It can be a path or a URI */
+	if (uri [0] == '/')
+		return g_strdup (uri);
+
+	if (g_str_has_prefix (uri, "file://"))
+		return g_filename_from_uri (uri, NULL, NULL);
+
+	/* Remote files are never read directly by the imagers */
+	return NULL;
+}
+
+/**
+ * Compares two paths on the disc so that the files of a directory come
+ * before the contents of its subdirectories, which is the order in which
+ * the imagers lay out files.
+ */
+
+static gint
+brasero_prefetch_compare_dirs (const gchar *dir_a,
+			       gsize len_a,
+			       const gchar *dir_b,
+			       gsize len_b)
+{
+	gsize i = 0;
+	guchar char_a;
+	guchar char_b;
+
+	while (i < len_a && i < len_b && dir_a [i] == dir_b [i])
+		i ++;
+
+	char_a = i < len_a ? (guchar) dir_a [i]:0;
+	char_b = i < len_b ? (guchar) dir_b [i]:0;
+
+	/* The separator sorts before any other character so that a
+	 * directory comes right before its subdirectories */
+	return (char_a == G_DIR_SEPARATOR ? 1:char_a) -
+	       (char_b == G_DIR_SEPARATOR ? 1:char_b);
+}
+
+static gint
+brasero_prefetch_sort_files (gconstpointer a,
+			     gconstpointer b)
+{
+	const BraseroPrefetchFile *file_a = *(BraseroPrefetchFile **) a;
+	const BraseroPrefetchFile *file_b = *(BraseroPrefetchFile **) b;
+	gint result;
+
+	result = brasero_prefetch_compare_dirs (file_a->disc_path,
+						file_a->dir_len,
+						file_b->disc_path,
+						file_b->dir_len);
+	if (result)
+		return result;
+
+	return strcmp (file_a->disc_path + file_a->dir_len,
+		       file_b->disc_path + file_b->dir_len);
+}
+
+static void
+brasero_prefetch_add_path (BraseroPrefetch *self,
+			   const gchar *disc_path,
+			   const gchar *path)
+{
+	struct stat info;
+
+	if (self->cancel)
+		return;
+
+	if (g_hash_table_lookup (self->excluded, path))
+		return;
+
+	/* Don't follow symlinks to directories to avoid loops */
+	if (g_lstat (path, &info))
+		return;
+
+	if (S_ISLNK (info.st_mode)) {
+		if (g_stat (path, &info) || S_ISDIR (info.st_mode))
+			return;
+	}
+
+	if (S_ISDIR (info.st_mode)) {
+		const gchar *name;
+		GDir *dir;
+
+		dir = g_dir_open (path, 0, NULL);
+		if (!dir)
+			return;
+
+		while ((name = g_dir_read_name (dir))) {
+			gchar *child_disc_path;
+			gchar *child_path;
+
+			child_disc_path = g_build_path (G_DIR_SEPARATOR_S, disc_path, name, NULL);
+			child_path = g_build_filename (path, name, NULL);
+			brasero_prefetch_add_path (self, child_disc_path, child_path);
+			g_free (child_disc_path);
+			g_free (child_path);
+		}
+		g_dir_close (dir);
+	}
+	else if (S_ISREG (info.st_mode) && info.st_size > 0) {
+		BraseroPrefetchFile *file;
+
+		file = g_new0 (BraseroPrefetchFile, 1);
+		file->disc_path = g_strdup (disc_path);
+		file->dir_len = strrchr (file->disc_path, G_DIR_SEPARATOR) - file->disc_path;
+		file->path = g_strdup (path);
+		file->size = info.st_size;
+		g_ptr_array_add (self->files, file);
+	}
+}
+
+static void
+brasero_prefetch_build_file_list (BraseroPrefetch *self)
+{
+	goffset offset = 0;
+	guint i;
+
+	for (i = 0; i + 1 < self->grafts->len; i += 2)
+		brasero_prefetch_add_path (self,
+					   g_ptr_array_index (self->grafts, i),
+					   g_ptr_array_index (self->grafts, i + 1));
+
+	g_ptr_array_sort (self->files, brasero_prefetch_sort_files);
+
+	for (i = 0; i < self->files->len; i ++) {
+		BraseroPrefetchFile *file;
+
+		file = g_ptr_array_index (self->files, i);
+		file->offset = offset;
+		offset += file->size;
+	}
+
+	g_mutex_lock (self->mutex);
+	self->total = offset;
+	self->ready = TRUE;
+	g_mutex_unlock (self->mutex);
+}
+
+static gboolean
+brasero_prefetch_read_ahead (int fd,
+			     goffset offset,
+			     goffset len)
+{
+#ifdef HAVE_POSIX_FADVISE
+	/* This only schedules the reads; it doesn't block */
+	return (posix_fadvise (fd, offset, len, POSIX_FADV_WILLNEED) == 0);
+#else
+	gchar buffer [65536];
+
+	/* Pull the data into the page cache ourselves */
+	if (lseek (fd, offset, SEEK_SET) == (off_t) -1)
+		return FALSE;
+
+	while (len > 0) {
+		ssize_t bytes;
+
+		bytes = read (fd, buffer, MIN (len, sizeof (buffer)));
+		if (bytes < 0 && errno == EINTR)
+			continue;
+
+		if (bytes <= 0)
+			return FALSE;
+
+		len -= bytes;
+	}
+
+	return TRUE;
+#endif
+}
+
+static gpointer
+brasero_prefetch_thread (gpointer data)
+{
+	BraseroPrefetch *self = data;
+	goffset file_offset = 0;
+	guint index = 0;
+	int fd = -1;
+
+	brasero_prefetch_build_file_list (self);
+
+	while (index < self->files->len) {
+		BraseroPrefetchFile *file;
+		goffset position;
+		goffset len;
+
+		file = g_ptr_array_index (self->files, index);
+
+		g_mutex_lock (self->mutex);
+		while (!self->cancel
+		&&  self->advised - self->position >= self->window)
+			g_cond_wait (self->cond, self->mutex);
+
+		position = self->position;
+		g_mutex_unlock (self->mutex);
+
+		if (self->cancel)
+			break;
+
+		/* The imager went past what we were about to read ahead */
+		if (position >= file->offset + file->size) {
+			if (fd != -1) {
+				close (fd);
+				fd = -1;
+			}
+
+			index ++;
+			file_offset = 0;
+			continue;
+		}
+
+		if (position > file->offset + file_offset)
+			file_offset = position - file->offset;
+
+		if (fd == -1) {
+			fd = g_open (file->path, O_RDONLY, 0);
+			if (fd == -1) {
+				BRASERO_BURN_LOG ("Prefetch: %s could not be opened (%s)",
+						  file->path,
+						  g_strerror (errno));
+				index ++;
+				file_offset = 0;
+				continue;
+			}
+		}
+
+		len = MIN (file->size - file_offset, BRASERO_PREFETCH_CHUNK);
+		if (brasero_prefetch_read_ahead (fd, file_offset, len))
+			self->advised_bytes += len;
+
+		file_offset += len;
+
+		g_mutex_lock (self->mutex);
+		self->advised = file->offset + file_offset;
+		g_mutex_unlock (self->mutex);
+
+		if (file_offset >= file->size) {
+			close (fd);
+			fd = -1;
+
+			index ++;
+			file_offset = 0;
+		}
+	}
+
+	if (fd != -1)
+		close (fd);
+
+	return NULL;
+}
+
+/**
+ * Called with the imager progress, in bytes of file data read so far.
+ * Each file that the imager reaches is counted as a hit if it was read
+ * ahead already.
+ */
+
+void
+brasero_prefetch_set_position (BraseroPrefetch *self,
+			       goffset bytes)
+{
+	if (!self)
+		return;
+
+	g_mutex_lock (self->mutex);
+	if (!self->ready || bytes <= self->position) {
+		g_mutex_unlock (self->mutex);
+		return;
+	}
+
+	self->position = bytes;
+	while (self->consumed < self->files->len) {
+		BraseroPrefetchFile *file;
+
+		file = g_ptr_array_index (self->files, self->consumed);
+		if (file->offset >= bytes)
+			break;
+
+		if (file->offset < self->advised)
+			self->hits ++;
+		else
+			self->misses ++;
+
+		self->consumed ++;
+	}
+
+	g_cond_signal (self->cond);
+	g_mutex_unlock (self->mutex);
+}
+
+void
+brasero_prefetch_set_progress (BraseroPrefetch *self,
+			       gdouble fraction)
+{
+	goffset total;
+
+	if (!self)
+		return;
+
+	g_mutex_lock (self->mutex);
+	total = self->total;
+	g_mutex_unlock (self->mutex);
+
+	brasero_prefetch_set_position (self, (goffset) (fraction * total));
+}
+
+/**
+ * Returns NULL if prefetching was disabled or if no file could be read
+ * ahead.
+ */
+
+BraseroPrefetch *
+brasero_prefetch_new (GSList *grafts,
+		      GSList *excluded)
+{
+	BraseroPrefetch *self;
+	GSettings *settings;
+	GError *error = NULL;
+	gint window;
+	GSList *iter;
+
+	settings = g_settings_new (BRASERO_SCHEMA_CONFIG);
+	window = g_settings_get_int (settings, BRASERO_KEY_PREFETCH_WINDOW);
+	g_object_unref (settings);
+
+	if (window <= 0)
+		return NULL;
+
+	self = g_new0 (BraseroPrefetch, 1);
+	self->window = (goffset) window * 1024 * 1024;
+	self->files = g_ptr_array_new_with_free_func ((GDestroyNotify) brasero_prefetch_file_free);
+	self->grafts = g_ptr_array_new_with_free_func (g_free);
+	self->excluded = g_hash_table_new_full (g_str_hash,
+						g_str_equal,
+						g_free,
+						NULL);
+
+	for (iter = grafts; iter; iter = iter->next) {
+		BraseroGraftPt *graft;
+		gchar *disc_path;
+		gchar *path;
+		gsize len;
+
+		graft = iter->data;
+		path = brasero_prefetch_uri_to_path (graft->uri);
+		if (!path)
+			continue;
+
+		/* Remove the trailing slash that mkisofs needs for directories */
+		disc_path = g_strdup (graft->path);
+		len = strlen (disc_path);
+		if (len > 1 && disc_path [len - 1] == G_DIR_SEPARATOR)
+			disc_path [len - 1] = '\0';
+
+		g_ptr_array_add (self->grafts, disc_path);
+		g_ptr_array_add (self->grafts, path);
+	}
+
+	for (iter = excluded; iter; iter = iter->next) {
+		gchar *path;
+
+		path = brasero_prefetch_uri_to_path (iter->data);
+		if (path)
+			g_hash_table_insert (self->excluded, path, GINT_TO_POINTER (1));
+	}
+
+	if (!self->grafts->len) {
+		brasero_prefetch_free (self);
+		return NULL;
+	}
+
+	self->mutex = g_mutex_new ();
+	self->cond = g_cond_new ();
+	self->thread = g_thread_create (brasero_prefetch_thread,
+					self,
+					TRUE,
+					&error);
+	if (!self->thread) {
+		BRASERO_BURN_LOG ("Prefetch thread could not be started (%s)",
+				  error ? error->message:"unknown error");
+		if (error)
+			g_error_free (error);
+
+		brasero_prefetch_free (self);
+		return NULL;
+	}
+
+	BRASERO_BURN_LOG ("Prefetching with a window of %i MiB", window);
+	return self;
+}
+
+void
+brasero_prefetch_free (BraseroPrefetch *self)
+{
+	if (!self)
+		return;
+
+	if (self->thread) {
+		g_mutex_lock (self->mutex);
+		self->cancel = TRUE;
+		g_cond_signal (self->cond);
+		g_mutex_unlock (self->mutex);
+
+		g_thread_join (self->thread);
+		self->thread = NULL;
+
+		BRASERO_BURN_LOG ("Prefetch: %u files, %" G_GINT64_FORMAT " bytes read ahead, %u hits, %u misses (%.1f%% hit rate)",
+				  self->files->len,
+				  self->advised_bytes,
+				  self->hits,
+				  self->misses,
+				  (self->hits + self->misses) ? self->hits * 100.0 / (self->hits + self->misses):0.0);
+	}
+
+	if (self->mutex)
+		g_mutex_free (self->mutex);
+
+	if (self->cond)
+		g_cond_free (self->cond);
+
+	g_ptr_array_free (self->files, TRUE);
+	g_ptr_array_free (self->grafts, TRUE);
+	g_hash_table_destroy (self->excluded);
+	g_free (self);
+}
@@ -33,6 +33,7 @@
 #endif
 
 #include <math.h>
+#include <string.h>
 
 #include <glib.h>
 #include <glib-object.h>
@@ -43,6 +44,13 @@
 #include "brasero-session-helper.h"
 #include "burn-debug.h"
 #include "burn-task-ctx.h"
+#include "burn-buffer-history.h"
+
+/* Percentile of the levels seen while writing that is remembered */
+#define BRASERO_TASK_CTX_LOW_PERCENTILE		5
+
+/* Drive buffers are usually a few MiB; this is a generous upper bound */
+#define BRASERO_TASK_CTX_DRIVE_BUFFER		16
 
 typedef struct _BraseroTaskCtxPrivate BraseroTaskCtxPrivate;
 struct _BraseroTaskCtxPrivate
@@ -83,6 +91,15 @@ struct _BraseroTaskCtxPrivate
 	/* used for rates that certain jobs are able to report */
 	guint64 rate;
 
+	/* FIFO and drive buffer levels (percent) that recorders are able to
+	 * report; -1 when unknown. The FIFO size is in MiB. The levels seen
+	 * while writing are counted for each percent. */
+	gint fifo;
+	gint buffer;
+	guint fifo_levels [101];
+	guint buffer_levels [101];
+	guint fifo_size;
+
 	/* the current action */
 	BraseroBurnAction current_action;
 	gchar *action_string;
@@ -178,6 +195,12 @@ brasero_task_ctx_reset (BraseroTaskCtx *self)
 	priv->session_bytes = -1;
 	priv->written_changed = 0;
 
+	priv->fifo = -1;
+	priv->buffer = -1;
+	memset (priv->fifo_levels, 0, sizeof (priv->fifo_levels));
+	memset (priv->buffer_levels, 0, sizeof (priv->buffer_levels));
+	priv->fifo_size = 0;
+
 	priv->current_elapsed = 0;
 	priv->last_written = 0;
 	priv->last_elapsed = 0;
@@ -355,6 +378,63 @@ brasero_task_ctx_next_track (BraseroTaskCtx *self)
 	return BRASERO_BURN_OK;
 }
 
+/* Returns the level below which BRASERO_TASK_CTX_LOW_PERCENTILE % of the
+ * samples were, or -1 if there is none. Unlike the minimum, it is not
+ * affected by a few isolated samples. */
+static gint
+brasero_task_ctx_get_low_level (const guint *levels)
+{
+	guint64 threshold;
+	guint64 samples;
+	guint64 count;
+	gint i;
+
+	samples = 0;
+	for (i = 0; i <= 100; i ++)
+		samples += levels [i];
+
+	if (!samples)
+		return -1;
+
+	threshold = MAX (samples * BRASERO_TASK_CTX_LOW_PERCENTILE / 100, 1);
+
+	count = 0;
+	for (i = 0; i <= 100; i ++) {
+		count += levels [i];
+		if (count >= threshold)
+			return i;
+	}
+
+	return 100;
+}
+
+static void
+brasero_task_ctx_save_buffer_levels (BraseroTaskCtx *self)
+{
+	BraseroTaskCtxPrivate *priv;
+	gint buffer_low;
+	gint fifo_low;
+
+	priv = BRASERO_TASK_CTX_PRIVATE (self);
+
+	if (priv->action != BRASERO_TASK_ACTION_NORMAL || priv->fake)
+		return;
+
+	fifo_low = brasero_task_ctx_get_low_level (priv->fifo_levels);
+	buffer_low = brasero_task_ctx_get_low_level (priv->buffer_levels);
+	if (fifo_low < 0 && buffer_low < 0)
+		return;
+
+	brasero_buffer_history_add (brasero_burn_session_get_burner (priv->session),
+				    priv->fifo_size,
+				    fifo_low,
+				    buffer_low);
+
+	/* Don't save them twice */
+	memset (priv->fifo_levels, 0, sizeof (priv->fifo_levels));
+	memset (priv->buffer_levels, 0, sizeof (priv->buffer_levels));
+}
+
 BraseroBurnResult
 brasero_task_ctx_finished (BraseroTaskCtx *self)
 {
@@ -368,6 +448,8 @@ brasero_task_ctx_finished (BraseroTaskCtx *self)
 	if (!klass->finished)
 		return BRASERO_BURN_NOT_SUPPORTED;
 
+	brasero_task_ctx_save_buffer_levels (self);
+
 	klass->finished (self,
 			 BRASERO_BURN_OK,
 			 error);
@@ -405,6 +487,9 @@ brasero_task_ctx_error (BraseroTaskCtx *self,
 	if (!klass->finished)
 		return BRASERO_BURN_NOT_SUPPORTED;
 
+	/* Buffer levels matter even more when there was an error */
+	brasero_task_ctx_save_buffer_levels (self);
+
 	klass->finished (self,
 			 retval,
 			 error);
@@ -568,6 +653,70 @@ brasero_task_ctx_set_rate (BraseroTaskCtx *self,
 	return BRASERO_BURN_OK;
 }
 
+static gboolean
+brasero_task_ctx_is_draining (BraseroTaskCtx *self)
+{
+	BraseroTaskCtxPrivate *priv;
+	goffset written;
+	goffset window;
+	goffset total;
+
+	priv = BRASERO_TASK_CTX_PRIVATE (self);
+
+	total = 0;
+	brasero_task_ctx_get_session_output_size (self, NULL, &total);
+
+	written = MAX (priv->session_bytes, 0) + MAX (priv->track_bytes, 0);
+	if (total <= 0 || written <= 0)
+		return FALSE;
+
+	/* When the FIFO size is not known, assume it is not bigger than the
+	 * drive buffer */
+	window = (goffset) (MAX (priv->fifo_size, BRASERO_TASK_CTX_DRIVE_BUFFER) + BRASERO_TASK_CTX_DRIVE_BUFFER) * 1024 * 1024;
+	return (total - written) <= window;
+}
+
+BraseroBurnResult
+brasero_task_ctx_set_buffer_levels (BraseroTaskCtx *self,
+				    gint fifo,
+				    gint buffer)
+{
+	BraseroTaskCtxPrivate *priv;
+
+	g_return_val_if_fail (BRASERO_IS_TASK_CTX (self), BRASERO_BURN_ERR);
+
+	priv = BRASERO_TASK_CTX_PRIVATE (self);
+
+	priv->fifo = fifo;
+	priv->buffer = buffer;
+
+	/* Once all the data was read, the FIFO and then the drive buffer
+	 * drain to 0 which tells nothing about the speed of the input */
+	if (brasero_task_ctx_is_draining (self))
+		return BRASERO_BURN_OK;
+
+	if (fifo >= 0)
+		priv->fifo_levels [MIN (fifo, 100)] ++;
+
+	if (buffer >= 0)
+		priv->buffer_levels [MIN (buffer, 100)] ++;
+
+	return BRASERO_BURN_OK;
+}
+
+BraseroBurnResult
+brasero_task_ctx_set_fifo_size (BraseroTaskCtx *self,
+				guint fifo_size)
+{
+	BraseroTaskCtxPrivate *priv;
+
+	g_return_val_if_fail (BRASERO_IS_TASK_CTX (self), BRASERO_BURN_ERR);
+
+	priv = BRASERO_TASK_CTX_PRIVATE (self);
+	priv->fifo_size = fifo_size;
+	return BRASERO_BURN_OK;
+}
+
 /**
  * This is used by jobs that are imaging to tell what's going to be the output 
  * size for a particular track
@@ -840,6 +989,34 @@ brasero_task_ctx_get_rate (BraseroTaskCtx *self,
 	return BRASERO_BURN_OK;
 }
 
+BraseroBurnResult
+brasero_task_ctx_get_buffer_levels (BraseroTaskCtx *self,
+				    gint *fifo,
+				    gint *buffer,
+				    gint *fifo_low,
+				    gint *buffer_low)
+{
+	BraseroTaskCtxPrivate *priv;
+
+	g_return_val_if_fail (BRASERO_IS_TASK_CTX (self), BRASERO_BURN_ERR);
+
+	priv = BRASERO_TASK_CTX_PRIVATE (self);
+
+	if (fifo)
+		*fifo = priv->fifo;
+	if (buffer)
+		*buffer = priv->buffer;
+	if (fifo_low)
+		*fifo_low = brasero_task_ctx_get_low_level (priv->fifo_levels);
+	if (buffer_low)
+		*buffer_low = brasero_task_ctx_get_low_level (priv->buffer_levels);
+
+	if (priv->fifo < 0 && priv->buffer < 0)
+		return BRASERO_BURN_NOT_SUPPORTED;
+
+	return BRASERO_BURN_OK;
+}
+
 BraseroBurnResult
 brasero_task_ctx_get_remaining_time (BraseroTaskCtx *self,
 				     long *remaining)
@@ -1051,6 +1228,9 @@ brasero_task_ctx_init (BraseroTaskCtx *object)
 
 	priv = BRASERO_TASK_CTX_PRIVATE (object);
 	priv->lock = g_mutex_new ();
+
+	priv->fifo = -1;
+	priv->buffer = -1;
 }
 
 static void
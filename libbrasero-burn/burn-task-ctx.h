@@ -152,6 +152,15 @@ BraseroBurnResult
 brasero_task_ctx_set_rate (BraseroTaskCtx *ctx,
 			   gint64 rate);
 
+BraseroBurnResult
+brasero_task_ctx_set_buffer_levels (BraseroTaskCtx *ctx,
+				    gint fifo,
+				    gint buffer);
+
+BraseroBurnResult
+brasero_task_ctx_set_fifo_size (BraseroTaskCtx *ctx,
+				guint fifo_size);
+
 BraseroBurnResult
 brasero_task_ctx_set_written_session (BraseroTaskCtx *ctx,
 				      gint64 written);
@@ -184,6 +193,12 @@ BraseroBurnResult
 brasero_task_ctx_get_rate (BraseroTaskCtx *ctx,
 			   guint64 *rate);
 BraseroBurnResult
+brasero_task_ctx_get_buffer_levels (BraseroTaskCtx *ctx,
+				    gint *fifo,
+				    gint *buffer,
+				    gint *fifo_low,
+				    gint *buffer_low);
+BraseroBurnResult
 brasero_task_ctx_get_remaining_time (BraseroTaskCtx *ctx,
 				     long *remaining);
 BraseroBurnResult
@@ -0,0 +1,295 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-media
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-media is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-media authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-media. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-media is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-media is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <errno.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "brasero-media-private.h"
+#include "brasero-lru-cache.h"
+
+#define BRASERO_LRU_CACHE_GROUP		"Cache"
+#define BRASERO_LRU_CACHE_LAST_USED	"last-used"
+
+typedef struct _BraseroLruCacheEntry BraseroLruCacheEntry;
+struct _BraseroLruCacheEntry {
+	gchar *group;
+	gint64 last_used;
+};
+
+/**
+ * brasero_lru_cache_load:
+ * @path: a #gchar
+ * @version: a #gint
+ *
+ * Loads the cache stored at @path. If @version is not 0 and doesn't match
+ * the one stored in the file, the contents are discarded.
+ *
+ * Return value: a #GKeyFile, empty if @path could not be loaded.
+ **/
+GKeyFile *
+brasero_lru_cache_load (const gchar *path,
+			gint version)
+{
+	GKeyFile *key_file;
+	gint stored;
+
+	key_file = g_key_file_new ();
+	if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, NULL))
+		return key_file;
+
+	if (!version)
+		return key_file;
+
+	stored = g_key_file_get_integer (key_file, BRASERO_LRU_CACHE_GROUP, "version", NULL);
+	if (stored != version) {
+		BRASERO_MEDIA_LOG ("Outdated cache %s (version %i), discarding it", path, stored);
+		g_key_file_free (key_file);
+		key_file = g_key_file_new ();
+	}
+
+	return key_file;
+}
+
+/**
+ * brasero_lru_cache_save:
+ * @key_file: a #GKeyFile
+ * @path: a #gchar
+ * @version: a #gint
+ * @error: a #GError
+ *
+ * Writes @key_file to @path, creating the parent directories if need be.
+ * @version is stored along if it is not 0.
+ *
+ * Return value: TRUE on success.
+ **/
+gboolean
+brasero_lru_cache_save (GKeyFile *key_file,
+			const gchar *path,
+			gint version,
+			GError **error)
+{
+	gchar *directory;
+	gchar *contents;
+	gboolean result;
+	gsize size;
+
+	if (version)
+		g_key_file_set_integer (key_file, BRASERO_LRU_CACHE_GROUP, "version", version);
+
+	directory = g_path_get_dirname (path);
+	if (g_mkdir_with_parents (directory, 0700) == -1) {
+		int errsv = errno;
+
+		g_set_error (error,
+			     G_FILE_ERROR,
+			     g_file_error_from_errno (errsv),
+			     "Impossible to create %s (%s)",
+			     directory,
+			     g_strerror (errsv));
+		g_free (directory);
+		return FALSE;
+	}
+	g_free (directory);
+
+	contents = g_key_file_to_data (key_file, &size, error);
+	if (!contents)
+		return FALSE;
+
+	result = g_file_set_contents (path, contents, size, error);
+	g_free (contents);
+
+	return result;
+}
+
+/**
+ * brasero_lru_cache_touch:
+ * @key_file: a #GKeyFile
+ * @group: a #gchar
+ *
+ * Marks the entry @group as the most recently used one.
+ **/
+void
+brasero_lru_cache_touch (GKeyFile *key_file,
+			 const gchar *group)
+{
+	g_key_file_set_int64 (key_file, group, BRASERO_LRU_CACHE_LAST_USED, g_get_real_time ());
+}
+
+/**
+ * brasero_lru_cache_lookup:
+ * @key_file: a #GKeyFile
+ * @group: a #gchar
+ *
+ * Checks whether there is an entry @group in the cache and, if so, marks
+ * it as the most recently used one.
+ *
+ * Return value: TRUE if there is such an entry.
+ **/
+gboolean
+brasero_lru_cache_lookup (GKeyFile *key_file,
+			  const gchar *group)
+{
+	if (!g_key_file_has_group (key_file, group))
+		return FALSE;
+
+	brasero_lru_cache_touch (key_file, group);
+	return TRUE;
+}
+
+/* Groups without a "last-used" key (like the version header) are not
+ * entries. */
+static GArray *
+brasero_lru_cache_get_entries (GKeyFile *key_file)
+{
+	GArray *entries;
+	gchar **groups;
+	guint i;
+
+	entries = g_array_new (FALSE, FALSE, sizeof (BraseroLruCacheEntry));
+
+	groups = g_key_file_get_groups (key_file, NULL);
+	for (i = 0; groups [i]; i ++) {
+		BraseroLruCacheEntry entry;
+
+		if (!g_key_file_has_key (key_file, groups [i], BRASERO_LRU_CACHE_LAST_USED, NULL)) {
+			g_free (groups [i]);
+			continue;
+		}
+
+		entry.group = groups [i];
+		entry.last_used = g_key_file_get_int64 (key_file, groups [i], BRASERO_LRU_CACHE_LAST_USED, NULL);
+		g_array_append_val (entries, entry);
+	}
+
+	/* The strings now belong to the array */
+	g_free (groups);
+
+	return entries;
+}
+
+static void
+brasero_lru_cache_entries_free (GArray *entries)
+{
+	guint i;
+
+	for (i = 0; i < entries->len; i ++)
+		g_free (g_array_index (entries, BraseroLruCacheEntry, i).group);
+
+	g_array_free (entries, TRUE);
+}
+
+static gint
+brasero_lru_cache_entry_compare (gconstpointer a,
+				 gconstpointer b)
+{
+	const BraseroLruCacheEntry *entry_a = a;
+	const BraseroLruCacheEntry *entry_b = b;
+
+	if (entry_a->last_used < entry_b->last_used)
+		return -1;
+
+	return (entry_a->last_used > entry_b->last_used);
+}
+
+/**
+ * brasero_lru_cache_get_oldest:
+ * @key_file: a #GKeyFile
+ *
+ * Return value: the name of the least recently used entry or NULL if the
+ * cache is empty. It must be freed.
+ **/
+gchar *
+brasero_lru_cache_get_oldest (GKeyFile *key_file)
+{
+	BraseroLruCacheEntry *oldest = NULL;
+	GArray *entries;
+	gchar *group;
+	guint i;
+
+	entries = brasero_lru_cache_get_entries (key_file);
+	for (i = 0; i < entries->len; i ++) {
+		BraseroLruCacheEntry *entry;
+
+		entry = &g_array_index (entries, BraseroLruCacheEntry, i);
+		if (!oldest || entry->last_used < oldest->last_used)
+			oldest = entry;
+	}
+
+	group = oldest ? g_strdup (oldest->group):NULL;
+	brasero_lru_cache_entries_free (entries);
+
+	return group;
+}
+
+/**
+ * brasero_lru_cache_prune:
+ * @key_file: a #GKeyFile
+ * @max_entries: a #guint
+ * @func: a #BraseroLruCacheRemoveFunc or NULL
+ * @user_data: a #gpointer
+ *
+ * Removes the least recently used entries until there are no more than
+ * @max_entries left. @func is called for each of them before it is
+ * removed so that the data it refers to can be deleted as well.
+ **/
+void
+brasero_lru_cache_prune (GKeyFile *key_file,
+			 guint max_entries,
+			 BraseroLruCacheRemoveFunc func,
+			 gpointer user_data)
+{
+	GArray *entries;
+	guint i;
+
+	entries = brasero_lru_cache_get_entries (key_file);
+	if (entries->len <= max_entries) {
+		brasero_lru_cache_entries_free (entries);
+		return;
+	}
+
+	g_array_sort (entries, brasero_lru_cache_entry_compare);
+	for (i = 0; i < entries->len - max_entries; i ++) {
+		BraseroLruCacheEntry *entry;
+
+		entry = &g_array_index (entries, BraseroLruCacheEntry, i);
+		if (func)
+			func (key_file, entry->group, user_data);
+
+		g_key_file_remove_group (key_file, entry->group, NULL);
+	}
+
+	brasero_lru_cache_entries_free (entries);
+}
@@ -0,0 +1,78 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-media
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-media is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-media authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-media. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-media is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-media is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _BRASERO_LRU_CACHE_H_
+#define _BRASERO_LRU_CACHE_H_
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/**
+ * Small caches kept in the user cache directory as a GKeyFile. Each entry
+ * is a group with a "last-used" key; when there are too many of them the
+ * least recently used ones are dropped. An optional "Cache" group holds
+ * the version of the format so outdated files can be discarded.
+ */
+
+typedef void (*BraseroLruCacheRemoveFunc) (GKeyFile *key_file,
+					   const gchar *group,
+					   gpointer user_data);
+
+GKeyFile *
+brasero_lru_cache_load (const gchar *path,
+			gint version);
+
+gboolean
+brasero_lru_cache_save (GKeyFile *key_file,
+			const gchar *path,
+			gint version,
+			GError **error);
+
+gboolean
+brasero_lru_cache_lookup (GKeyFile *key_file,
+			  const gchar *group);
+
+void
+brasero_lru_cache_touch (GKeyFile *key_file,
+			 const gchar *group);
+
+gchar *
+brasero_lru_cache_get_oldest (GKeyFile *key_file);
+
+void
+brasero_lru_cache_prune (GKeyFile *key_file,
+			 guint max_entries,
+			 BraseroLruCacheRemoveFunc func,
+			 gpointer user_data);
+
+G_END_DECLS
+
+#endif /* _BRASERO_LRU_CACHE_H_ */
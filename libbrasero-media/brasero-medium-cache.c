@@ -0,0 +1,332 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-media
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-media is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-media authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-media. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-media is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-media is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#include "brasero-lru-cache.h"
+
+#include "brasero-media-private.h"
+#include "brasero-medium-cache.h"
+
+/* Bump this whenever the probing code changes what it stores so that
+ * outdated entries are not used anymore. */
+#define BRASERO_MEDIUM_CACHE_VERSION		1
+
+/* Maximum number of discs remembered; when this is exceeded the least
+ * recently used entries are dropped. */
+#define BRASERO_MEDIUM_CACHE_MAX_ENTRIES	128
+
+static GKeyFile *cache = NULL;
+G_LOCK_DEFINE_STATIC (cache);
+
+static gchar *
+brasero_medium_cache_get_path (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "brasero",
+				 "medium-cache",
+				 NULL);
+}
+
+/* Must be called with the lock held */
+static GKeyFile *
+brasero_medium_cache_get (void)
+{
+	gchar *path;
+
+	if (cache)
+		return cache;
+
+	path = brasero_medium_cache_get_path ();
+	cache = brasero_lru_cache_load (path, BRASERO_MEDIUM_CACHE_VERSION);
+	g_free (path);
+
+	return cache;
+}
+
+/* Must be called with the lock held */
+static void
+brasero_medium_cache_save (void)
+{
+	GError *error = NULL;
+	gchar *path;
+
+	path = brasero_medium_cache_get_path ();
+	if (!brasero_lru_cache_save (cache, path, BRASERO_MEDIUM_CACHE_VERSION, &error)) {
+		BRASERO_MEDIA_LOG ("Medium cache could not be written: %s", error->message);
+		g_error_free (error);
+	}
+	g_free (path);
+}
+
+static void
+brasero_medium_cache_removed_cb (GKeyFile *key_file,
+				 const gchar *fingerprint,
+				 gpointer user_data)
+{
+	BRASERO_MEDIA_LOG ("Removing medium %s from cache", fingerprint);
+}
+
+static guint *
+brasero_medium_cache_get_speeds (GKeyFile *key_file,
+				 const gchar *group,
+				 const gchar *key)
+{
+	gint *list;
+	guint *speeds;
+	gsize length = 0;
+	gsize i;
+
+	list = g_key_file_get_integer_list (key_file, group, key, &length, NULL);
+	if (!list)
+		return NULL;
+
+	speeds = g_new0 (guint, length + 1);
+	for (i = 0; i < length; i ++)
+		speeds [i] = list [i];
+
+	g_free (list);
+	return speeds;
+}
+
+static void
+brasero_medium_cache_set_speeds (GKeyFile *key_file,
+				 const gchar *group,
+				 const gchar *key,
+				 guint *speeds)
+{
+	gsize length = 0;
+
+	if (!speeds)
+		return;
+
+	while (speeds [length] != 0) length ++;
+	if (!length)
+		return;
+
+	g_key_file_set_integer_list (key_file,
+				     group,
+				     key,
+				     (gint *) speeds,
+				     length);
+}
+
+static GSList *
+brasero_medium_cache_get_tracks (GKeyFile *key_file,
+				 const gchar *group)
+{
+	gchar **list;
+	GSList *tracks = NULL;
+	gsize i;
+
+	list = g_key_file_get_string_list (key_file, group, "tracks", NULL, NULL);
+	if (!list)
+		return NULL;
+
+	for (i = 0; list [i]; i ++) {
+		BraseroMediumCacheTrack *track;
+		gchar **fields;
+
+		fields = g_strsplit (list [i], ":", 4);
+		if (g_strv_length (fields) != 4) {
+			g_strfreev (fields);
+			continue;
+		}
+
+		track = g_new0 (BraseroMediumCacheTrack, 1);
+		track->session = g_ascii_strtoull (fields [0], NULL, 10);
+		track->type = g_ascii_strtoull (fields [1], NULL, 10);
+		track->start = g_ascii_strtoll (fields [2], NULL, 10);
+		track->blocks_num = g_ascii_strtoll (fields [3], NULL, 10);
+		tracks = g_slist_prepend (tracks, track);
+
+		g_strfreev (fields);
+	}
+	g_strfreev (list);
+
+	return g_slist_reverse (tracks);
+}
+
+static void
+brasero_medium_cache_set_tracks (GKeyFile *key_file,
+				 const gchar *group,
+				 GSList *tracks)
+{
+	gchar **list;
+	GSList *iter;
+	guint i;
+
+	if (!tracks)
+		return;
+
+	list = g_new0 (gchar *, g_slist_length (tracks) + 1);
+	for (i = 0, iter = tracks; iter; iter = iter->next, i ++) {
+		BraseroMediumCacheTrack *track;
+
+		track = iter->data;
+		list [i] = g_strdup_printf ("%u:%u:%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT,
+					    track->session,
+					    track->type,
+					    track->start,
+					    track->blocks_num);
+	}
+
+	g_key_file_set_string_list (key_file,
+				    group,
+				    "tracks",
+				    (const gchar * const *) list,
+				    i);
+	g_strfreev (list);
+}
+
+/**
+ * brasero_medium_cache_lookup:
+ * @fingerprint: a #gchar *
+ *
+ * Returns the information stored for the disc identified by @fingerprint
+ * or NULL if that disc was never probed before. The returned entry is a
+ * copy that must be freed with brasero_medium_cache_entry_free ().
+ *
+ * Return value: a #BraseroMediumCacheEntry * or NULL.
+ **/
+BraseroMediumCacheEntry *
+brasero_medium_cache_lookup (const gchar *fingerprint)
+{
+	BraseroMediumCacheEntry *entry;
+	GKeyFile *key_file;
+
+	g_return_val_if_fail (fingerprint != NULL, NULL);
+
+	G_LOCK (cache);
+
+	/* Only update the time in memory; it will be written to disk the
+	 * next time a new entry is stored. */
+	key_file = brasero_medium_cache_get ();
+	if (!brasero_lru_cache_lookup (key_file, fingerprint)) {
+		G_UNLOCK (cache);
+		return NULL;
+	}
+
+	entry = g_new0 (BraseroMediumCacheEntry, 1);
+	entry->base_info = g_key_file_get_uint64 (key_file, fingerprint, "base-info", NULL);
+	entry->info = g_key_file_get_uint64 (key_file, fingerprint, "info", NULL);
+	entry->type_index = g_key_file_get_integer (key_file, fingerprint, "type", NULL);
+	entry->id = g_key_file_get_string (key_file, fingerprint, "id", NULL);
+	entry->CD_TEXT_title = g_key_file_get_string (key_file, fingerprint, "cd-text-title", NULL);
+	entry->max_rd = g_key_file_get_integer (key_file, fingerprint, "max-rd", NULL);
+	entry->max_wrt = g_key_file_get_integer (key_file, fingerprint, "max-wrt", NULL);
+	entry->rd_speeds = brasero_medium_cache_get_speeds (key_file, fingerprint, "rd-speeds");
+	entry->wr_speeds = brasero_medium_cache_get_speeds (key_file, fingerprint, "wr-speeds");
+	entry->block_num = g_key_file_get_int64 (key_file, fingerprint, "block-num", NULL);
+	entry->block_size = g_key_file_get_int64 (key_file, fingerprint, "block-size", NULL);
+	entry->first_open_track = g_key_file_get_integer (key_file, fingerprint, "first-open-track", NULL);
+	entry->next_wr_add = g_key_file_get_int64 (key_file, fingerprint, "next-wr-add", NULL);
+	entry->caps = g_key_file_get_integer (key_file, fingerprint, "caps", NULL);
+	entry->tracks = brasero_medium_cache_get_tracks (key_file, fingerprint);
+
+	G_UNLOCK (cache);
+
+	return entry;
+}
+
+/**
+ * brasero_medium_cache_store:
+ * @fingerprint: a #gchar *
+ * @entry: a #BraseroMediumCacheEntry *
+ *
+ * Remembers @entry as the result of the probe of the disc identified by
+ * @fingerprint and writes the cache to disk.
+ **/
+void
+brasero_medium_cache_store (const gchar *fingerprint,
+			    BraseroMediumCacheEntry *entry)
+{
+	GKeyFile *key_file;
+
+	g_return_if_fail (fingerprint != NULL);
+	g_return_if_fail (entry != NULL);
+
+	G_LOCK (cache);
+
+	key_file = brasero_medium_cache_get ();
+
+	/* Start from a clean group so that no stale key survives */
+	g_key_file_remove_group (key_file, fingerprint, NULL);
+
+	g_key_file_set_uint64 (key_file, fingerprint, "base-info", entry->base_info);
+	g_key_file_set_uint64 (key_file, fingerprint, "info", entry->info);
+	g_key_file_set_integer (key_file, fingerprint, "type", entry->type_index);
+
+	if (entry->id)
+		g_key_file_set_string (key_file, fingerprint, "id", entry->id);
+	if (entry->CD_TEXT_title)
+		g_key_file_set_string (key_file, fingerprint, "cd-text-title", entry->CD_TEXT_title);
+
+	g_key_file_set_integer (key_file, fingerprint, "max-rd", entry->max_rd);
+	g_key_file_set_integer (key_file, fingerprint, "max-wrt", entry->max_wrt);
+	brasero_medium_cache_set_speeds (key_file, fingerprint, "rd-speeds", entry->rd_speeds);
+	brasero_medium_cache_set_speeds (key_file, fingerprint, "wr-speeds", entry->wr_speeds);
+	g_key_file_set_int64 (key_file, fingerprint, "block-num", entry->block_num);
+	g_key_file_set_int64 (key_file, fingerprint, "block-size", entry->block_size);
+	g_key_file_set_integer (key_file, fingerprint, "first-open-track", entry->first_open_track);
+	g_key_file_set_int64 (key_file, fingerprint, "next-wr-add", entry->next_wr_add);
+	g_key_file_set_integer (key_file, fingerprint, "caps", entry->caps);
+	brasero_medium_cache_set_tracks (key_file, fingerprint, entry->tracks);
+	brasero_lru_cache_touch (key_file, fingerprint);
+
+	brasero_lru_cache_prune (key_file,
+				 BRASERO_MEDIUM_CACHE_MAX_ENTRIES,
+				 brasero_medium_cache_removed_cb,
+				 NULL);
+	brasero_medium_cache_save ();
+
+	G_UNLOCK (cache);
+}
+
+void
+brasero_medium_cache_entry_free (BraseroMediumCacheEntry *entry)
+{
+	if (!entry)
+		return;
+
+	g_free (entry->id);
+	g_free (entry->CD_TEXT_title);
+	g_free (entry->rd_speeds);
+	g_free (entry->wr_speeds);
+
+	g_slist_foreach (entry->tracks, (GFunc) g_free, NULL);
+	g_slist_free (entry->tracks);
+
+	g_free (entry);
+}
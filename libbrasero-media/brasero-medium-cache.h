@@ -0,0 +1,110 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-media
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-media is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-media authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-media. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-media is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-media is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#include <glib.h>
+
+#include "brasero-media.h"
+
+#ifndef _BRASERO_MEDIUM_CACHE_H_
+#define _BRASERO_MEDIUM_CACHE_H_
+
+G_BEGIN_DECLS
+
+/**
+ * Results of a full probe of a medium are remembered (in memory and in
+ * the user cache directory) keyed by a fingerprint of the disc computed
+ * with a few cheap SCSI commands. That way a disc that was already seen
+ * in a drive doesn't need to be probed again.
+ */
+
+typedef enum {
+	BRASERO_MEDIUM_CACHE_CAP_NONE		= 0,
+	BRASERO_MEDIUM_CACHE_CAP_DUMMY_SAO	= 1,
+	BRASERO_MEDIUM_CACHE_CAP_DUMMY_TAO	= 1 << 1,
+	BRASERO_MEDIUM_CACHE_CAP_BURNFREE	= 1 << 2,
+	BRASERO_MEDIUM_CACHE_CAP_SAO		= 1 << 3,
+	BRASERO_MEDIUM_CACHE_CAP_TAO		= 1 << 4,
+	BRASERO_MEDIUM_CACHE_CAP_BLANK_CMD	= 1 << 5,
+	BRASERO_MEDIUM_CACHE_CAP_WRITE_CMD	= 1 << 6
+} BraseroMediumCacheCaps;
+
+typedef struct _BraseroMediumCacheTrack BraseroMediumCacheTrack;
+struct _BraseroMediumCacheTrack {
+	guint session;
+	guint type;
+	goffset start;
+	goffset blocks_num;
+};
+
+typedef struct _BraseroMediumCacheEntry BraseroMediumCacheEntry;
+struct _BraseroMediumCacheEntry {
+	/* Flags as they were before the contents of the disc were read.
+	 * They are used to revalidate the contents of media whose TOC
+	 * doesn't change when they are written (DVD+RW, BD-RE, ...) */
+	BraseroMedia base_info;
+	BraseroMedia info;
+
+	gint type_index;
+
+	gchar *id;
+	gchar *CD_TEXT_title;
+
+	guint max_rd;
+	guint max_wrt;
+
+	/* Both are 0 terminated and may be NULL */
+	guint *rd_speeds;
+	guint *wr_speeds;
+
+	goffset block_num;
+	goffset block_size;
+
+	guint first_open_track;
+	goffset next_wr_add;
+
+	BraseroMediumCacheCaps caps;
+
+	/* List of BraseroMediumCacheTrack in the same order as the medium */
+	GSList *tracks;
+};
+
+BraseroMediumCacheEntry *
+brasero_medium_cache_lookup (const gchar *fingerprint);
+
+void
+brasero_medium_cache_store (const gchar *fingerprint,
+			    BraseroMediumCacheEntry *entry);
+
+void
+brasero_medium_cache_entry_free (BraseroMediumCacheEntry *entry);
+
+G_END_DECLS
+
+#endif /* _BRASERO_MEDIUM_CACHE_H_ */
@@ -37,6 +37,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <unistd.h>
+#include <string.h>
 
 #include <glib.h>
 #include <glib/gi18n-lib.h>
@@ -46,6 +47,7 @@
 #include "brasero-drive-priv.h"
 
 #include "brasero-medium.h"
+#include "brasero-medium-cache.h"
 #include "brasero-drive.h"
 
 #include "scsi-device.h"
@@ -113,6 +115,9 @@ struct _BraseroMediumPrivate
 	BraseroMedia info;
 	BraseroDrive *drive;
 
+	/* Flags as they were before reading the disc contents */
+	BraseroMedia base_info;
+
 	gchar *CD_TEXT_title;
 
 	/* Do we really need both? */
@@ -2879,53 +2884,342 @@ brasero_medium_read_CD_TEXT (BraseroMedium *self,
 	g_free (cd_text);
 }
 
+/**
+ * Probe cache: a fingerprint of the disc is computed from a few cheap
+ * commands and used to look up the results of a previous full probe.
+ */
+
 static void
-brasero_medium_init_real (BraseroMedium *object,
+brasero_medium_fingerprint_add_structure (BraseroDeviceHandle *handle,
+					  BraseroScsiGenericFormatType format,
+					  GChecksum *checksum)
+{
+	BraseroScsiReadDiscStructureHdr *hdr = NULL;
+	BraseroScsiResult result;
+	int size = 0;
+
+	result = brasero_mmc2_read_generic_structure (handle,
+						      format,
+						      &hdr,
+						      &size,
+						      NULL);
+	if (result != BRASERO_SCSI_OK)
+		return;
+
+	g_checksum_update (checksum, (guchar *) hdr, size);
+	g_free (hdr);
+}
+
+static gchar *
+brasero_medium_get_fingerprint (BraseroMedium *self,
+				BraseroDeviceHandle *handle,
+				BraseroScsiErrCode *code)
+{
+	BraseroScsiReadCapacityData capacity;
+	BraseroScsiFormattedTocData *toc = NULL;
+	BraseroScsiDiscInfoStd *info = NULL;
+	BraseroScsiProfile profile;
+	BraseroMediumPrivate *priv;
+	BraseroScsiResult result;
+	GChecksum *checksum;
+	const gchar *device;
+	gchar *fingerprint;
+	guint16 profile_bytes;
+	int size = 0;
+
+	priv = BRASERO_MEDIUM_PRIVATE (self);
+
+	/* MMC1 drives can't tell us the profile; probe those fully */
+	result = brasero_mmc2_get_profile (handle, &profile, code);
+	if (result != BRASERO_SCSI_OK || profile == BRASERO_SCSI_PROF_EMPTY)
+		return NULL;
+
+	result = brasero_mmc1_read_disc_information_std (handle,
+							 &info,
+							 &size,
+							 code);
+	if (result != BRASERO_SCSI_OK)
+		return NULL;
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA1);
+
+	/* The results depend on the drive as well (speeds, caps, ...) */
+	device = brasero_drive_get_udi (priv->drive);
+	if (!device)
+		device = brasero_drive_get_device (priv->drive);
+	if (device)
+		g_checksum_update (checksum, (guchar *) device, strlen (device));
+
+	profile_bytes = profile;
+	g_checksum_update (checksum, (guchar *) &profile_bytes, sizeof (profile_bytes));
+	g_checksum_update (checksum, (guchar *) info, size);
+
+	/* TOC of anything that is not blank */
+	if (info->status != BRASERO_SCSI_DISC_EMPTY) {
+		result = brasero_mmc1_read_toc_formatted (handle,
+							  0,
+							  &toc,
+							  &size,
+							  NULL);
+		if (result == BRASERO_SCSI_OK) {
+			g_checksum_update (checksum, (guchar *) toc, size);
+			g_free (toc);
+		}
+	}
+	g_free (info);
+
+	memset (&capacity, 0, sizeof (capacity));
+	result = brasero_mmc2_read_capacity (handle,
+					     &capacity,
+					     sizeof (capacity),
+					     NULL);
+	if (result == BRASERO_SCSI_OK)
+		g_checksum_update (checksum, (guchar *) &capacity, sizeof (capacity));
+
+	/* Manufacturer information of the disc */
+	switch (profile) {
+	case BRASERO_SCSI_PROF_CDR:
+	case BRASERO_SCSI_PROF_CDRW: {
+		BraseroScsiAtipData *atip = NULL;
+
+		result = brasero_mmc1_read_atip (handle, &atip, &size, NULL);
+		if (result == BRASERO_SCSI_OK) {
+			g_checksum_update (checksum, (guchar *) atip, size);
+			g_free (atip);
+		}
+		break;
+	}
+
+	case BRASERO_SCSI_PROF_DVD_R:
+	case BRASERO_SCSI_PROF_DVD_RW_RESTRICTED:
+	case BRASERO_SCSI_PROF_DVD_RW_SEQUENTIAL:
+	case BRASERO_SCSI_PROF_DVD_R_DL_SEQUENTIAL:
+	case BRASERO_SCSI_PROF_DVD_R_DL_JUMP:
+		/* That's the structure used to set the medium id */
+		brasero_medium_fingerprint_add_structure (handle,
+							  BRASERO_SCSI_FORMAT_LESS_MEDIA_ID_DVD,
+							  checksum);
+		break;
+
+	case BRASERO_SCSI_PROF_DVD_RW_PLUS:
+	case BRASERO_SCSI_PROF_DVD_R_PLUS:
+	case BRASERO_SCSI_PROF_DVD_RW_PLUS_DL:
+	case BRASERO_SCSI_PROF_DVD_R_PLUS_DL:
+		brasero_medium_fingerprint_add_structure (handle,
+							  BRASERO_SCSI_FORMAT_PLUS_ADIP,
+							  checksum);
+		break;
+
+	default:
+		break;
+	}
+
+	fingerprint = g_strdup (g_checksum_get_string (checksum));
+	g_checksum_free (checksum);
+
+	BRASERO_MEDIA_LOG ("Medium fingerprint %s", fingerprint);
+	return fingerprint;
+}
+
+static void
+brasero_medium_save_to_cache (BraseroMedium *self,
+			      const gchar *fingerprint)
+{
+	BraseroMediumCacheEntry *entry;
+	BraseroMediumPrivate *priv;
+	GSList *iter;
+	guint i;
+
+	priv = BRASERO_MEDIUM_PRIVATE (self);
+
+	entry = g_new0 (BraseroMediumCacheEntry, 1);
+	entry->base_info = priv->base_info;
+	entry->info = priv->info;
+
+	entry->type_index = -1;
+	for (i = 0; types [i]; i ++) {
+		if (types [i] == priv->type) {
+			entry->type_index = i;
+			break;
+		}
+	}
+
+	entry->id = g_strdup (priv->id);
+	entry->CD_TEXT_title = g_strdup (priv->CD_TEXT_title);
+	entry->max_rd = priv->max_rd;
+	entry->max_wrt = priv->max_wrt;
+
+	if (priv->rd_speeds) {
+		for (i = 0; priv->rd_speeds [i] != 0; i ++);
+		entry->rd_speeds = g_memdup (priv->rd_speeds, (i + 1) * sizeof (guint));
+	}
+
+	if (priv->wr_speeds) {
+		for (i = 0; priv->wr_speeds [i] != 0; i ++);
+		entry->wr_speeds = g_memdup (priv->wr_speeds, (i + 1) * sizeof (guint));
+	}
+
+	entry->block_num = priv->block_num;
+	entry->block_size = priv->block_size;
+	entry->first_open_track = priv->first_open_track;
+	entry->next_wr_add = priv->next_wr_add;
+
+	entry->caps = (priv->dummy_sao ? BRASERO_MEDIUM_CACHE_CAP_DUMMY_SAO:0)|
+		      (priv->dummy_tao ? BRASERO_MEDIUM_CACHE_CAP_DUMMY_TAO:0)|
+		      (priv->burnfree ? BRASERO_MEDIUM_CACHE_CAP_BURNFREE:0)|
+		      (priv->sao ? BRASERO_MEDIUM_CACHE_CAP_SAO:0)|
+		      (priv->tao ? BRASERO_MEDIUM_CACHE_CAP_TAO:0)|
+		      (priv->blank_command ? BRASERO_MEDIUM_CACHE_CAP_BLANK_CMD:0)|
+		      (priv->write_command ? BRASERO_MEDIUM_CACHE_CAP_WRITE_CMD:0);
+
+	for (iter = priv->tracks; iter; iter = iter->next) {
+		BraseroMediumCacheTrack *cached;
+		BraseroMediumTrack *track;
+
+		track = iter->data;
+		cached = g_new0 (BraseroMediumCacheTrack, 1);
+		cached->session = track->session;
+		cached->type = track->type;
+		cached->start = track->start;
+		cached->blocks_num = track->blocks_num;
+		entry->tracks = g_slist_prepend (entry->tracks, cached);
+	}
+	entry->tracks = g_slist_reverse (entry->tracks);
+
+	brasero_medium_cache_store (fingerprint, entry);
+	brasero_medium_cache_entry_free (entry);
+}
+
+static gboolean
+brasero_medium_load_from_cache (BraseroMedium *self,
+				BraseroDeviceHandle *handle,
+				const gchar *fingerprint,
+				BraseroScsiErrCode *code)
+{
+	BraseroMediumCacheEntry *entry;
+	BraseroMediumPrivate *priv;
+	GSList *iter;
+
+	priv = BRASERO_MEDIUM_PRIVATE (self);
+
+	entry = brasero_medium_cache_lookup (fingerprint);
+	if (!entry)
+		return FALSE;
+
+	if (entry->type_index < 0 || entry->type_index >= (gint) G_N_ELEMENTS (types) - 1) {
+		brasero_medium_cache_entry_free (entry);
+		return FALSE;
+	}
+
+	BRASERO_MEDIA_LOG ("Medium found in cache");
+
+	priv->type = types [entry->type_index];
+	priv->base_info = entry->base_info;
+	priv->info = entry->info;
+
+	priv->max_rd = entry->max_rd;
+	priv->max_wrt = entry->max_wrt;
+
+	/* Steal what can be stolen */
+	priv->rd_speeds = entry->rd_speeds;
+	entry->rd_speeds = NULL;
+	priv->wr_speeds = entry->wr_speeds;
+	entry->wr_speeds = NULL;
+
+	priv->block_num = entry->block_num;
+	priv->block_size = entry->block_size;
+
+	priv->dummy_sao = (entry->caps & BRASERO_MEDIUM_CACHE_CAP_DUMMY_SAO) != 0;
+	priv->dummy_tao = (entry->caps & BRASERO_MEDIUM_CACHE_CAP_DUMMY_TAO) != 0;
+	priv->burnfree = (entry->caps & BRASERO_MEDIUM_CACHE_CAP_BURNFREE) != 0;
+	priv->sao = (entry->caps & BRASERO_MEDIUM_CACHE_CAP_SAO) != 0;
+	priv->tao = (entry->caps & BRASERO_MEDIUM_CACHE_CAP_TAO) != 0;
+	priv->blank_command = (entry->caps & BRASERO_MEDIUM_CACHE_CAP_BLANK_CMD) != 0;
+	priv->write_command = (entry->caps & BRASERO_MEDIUM_CACHE_CAP_WRITE_CMD) != 0;
+
+	/* The TOC of random writable media doesn't change when they are
+	 * written so their contents must always be read again. The rest is
+	 * entirely determined by the fingerprint. */
+	if (BRASERO_MEDIUM_RANDOM_WRITABLE (priv->base_info)) {
+		BRASERO_MEDIA_LOG ("Revalidating contents of random writable medium");
+
+		priv->info = priv->base_info;
+		brasero_medium_cache_entry_free (entry);
+
+		/* No need to test CSS or read CD-TEXT for these media */
+		brasero_medium_get_contents (self, handle, code);
+		return TRUE;
+	}
+
+	priv->id = entry->id;
+	entry->id = NULL;
+	priv->CD_TEXT_title = entry->CD_TEXT_title;
+	entry->CD_TEXT_title = NULL;
+
+	priv->first_open_track = entry->first_open_track;
+	priv->next_wr_add = entry->next_wr_add;
+
+	for (iter = entry->tracks; iter; iter = iter->next) {
+		BraseroMediumCacheTrack *cached;
+		BraseroMediumTrack *track;
+
+		cached = iter->data;
+		track = g_new0 (BraseroMediumTrack, 1);
+		track->session = cached->session;
+		track->type = cached->type;
+		track->start = cached->start;
+		track->blocks_num = cached->blocks_num;
+		priv->tracks = g_slist_prepend (priv->tracks, track);
+	}
+	priv->tracks = g_slist_reverse (priv->tracks);
+
+	brasero_medium_cache_entry_free (entry);
+	return TRUE;
+}
+
+static gboolean
+brasero_medium_init_full (BraseroMedium *object,
 			  BraseroDeviceHandle *handle)
 {
 	guint i;
-	gchar *name;
 	gboolean result;
 	BraseroMediumPrivate *priv;
 	BraseroScsiErrCode code = 0;
-	gchar buffer [256] = { 0, };
 
 	priv = BRASERO_MEDIUM_PRIVATE (object);
 
-	name = brasero_drive_get_display_name (priv->drive);
-	BRASERO_MEDIA_LOG ("Initializing information for medium in %s", name);
-	g_free (name);
-
 	if (priv->probe_cancelled)
-		return;
+		return FALSE;
 
 	result = brasero_medium_get_medium_type (object, handle, &code);
 	if (result != TRUE)
-		return;
+		return FALSE;
 
 	if (priv->probe_cancelled)
-		return;
+		return FALSE;
 
 	result = brasero_medium_get_speed (object, handle, &code);
 	if (result != TRUE)
-		return;
+		return FALSE;
 
 	if (priv->probe_cancelled)
-		return;
+		return FALSE;
 
 	brasero_medium_get_capacity_by_type (object, handle, &code);
 	if (priv->probe_cancelled)
-		return;
+		return FALSE;
 
 	brasero_medium_init_caps (object, handle, &code);
 	if (priv->probe_cancelled)
-		return;
+		return FALSE;
+
+	priv->base_info = priv->info;
 
 	if (!brasero_medium_get_contents (object, handle, &code))
-		return;
+		return FALSE;
 
 	if (priv->probe_cancelled)
-		return;
+		return FALSE;
 
 	/* assume that css feature is only for DVD-ROM which might be wrong but
 	 * some drives wrongly reports that css is enabled for blank DVD+R/W */
@@ -2933,20 +3227,17 @@ brasero_medium_init_real (BraseroMedium *object,
 		brasero_medium_get_css_feature (object, handle, &code);
 
 	if (priv->probe_cancelled)
-		return;
+		return FALSE;
 
 	/* read CD-TEXT title */
 	if (priv->info & BRASERO_MEDIUM_HAS_AUDIO)
 		brasero_medium_read_CD_TEXT (object, handle, &code);
 
 	if (priv->probe_cancelled)
-		return;
-
-	brasero_media_to_string (priv->info, buffer);
-	BRASERO_MEDIA_LOG ("media is %s", buffer);
+		return FALSE;
 
 	if (!priv->wr_speeds)
-		return;
+		return TRUE;
 
 	/* sort write speeds */
 	for (i = 0; priv->wr_speeds [i] != 0; i ++) {
@@ -2962,6 +3253,52 @@ brasero_medium_init_real (BraseroMedium *object,
 			}
 		}
 	}
+
+	return TRUE;
+}
+
+static void
+brasero_medium_init_real (BraseroMedium *object,
+			  BraseroDeviceHandle *handle)
+{
+	gchar *name;
+	gchar *fingerprint;
+	BraseroMediumPrivate *priv;
+	BraseroScsiErrCode code = 0;
+	gchar buffer [256] = { 0, };
+
+	priv = BRASERO_MEDIUM_PRIVATE (object);
+
+	name = brasero_drive_get_display_name (priv->drive);
+	BRASERO_MEDIA_LOG ("Initializing information for medium in %s", name);
+	g_free (name);
+
+	if (priv->probe_cancelled)
+		return;
+
+	fingerprint = brasero_medium_get_fingerprint (object, handle, &code);
+	if (fingerprint
+	&&  brasero_medium_load_from_cache (object, handle, fingerprint, &code)) {
+		g_free (fingerprint);
+
+		brasero_media_to_string (priv->info, buffer);
+		BRASERO_MEDIA_LOG ("media is %s", buffer);
+		return;
+	}
+
+	if (!brasero_medium_init_full (object, handle)) {
+		g_free (fingerprint);
+		return;
+	}
+
+	brasero_media_to_string (priv->info, buffer);
+	BRASERO_MEDIA_LOG ("media is %s", buffer);
+
+	/* Only remember media that were fully and successfully probed */
+	if (fingerprint) {
+		brasero_medium_save_to_cache (object, fingerprint);
+		g_free (fingerprint);
+	}
 }
 
 gboolean
@@ -1138,6 +1138,8 @@ brasero_io_get_file_info_thread_real (BraseroAsyncTaskManager *manager,
 		strcat (attributes, "," G_FILE_ATTRIBUTE_STANDARD_ICON);
 	if (options & BRASERO_IO_INFO_METADATA_THUMBNAIL)
 		strcat (attributes, "," G_FILE_ATTRIBUTE_THUMBNAIL_PATH);
+	if (options & BRASERO_IO_INFO_MTIME)
+		strcat (attributes, "," G_FILE_ATTRIBUTE_TIME_MODIFIED);
 
 	/* if retrieving metadata we need this one to check if a possible result
 	 * in cache should be updated or used */
@@ -1998,6 +2000,9 @@ brasero_io_load_directory_thread (BraseroAsyncTaskManager *manager,
 	if (data->job.options & BRASERO_IO_INFO_ICON)
 		strcat (attributes, "," G_FILE_ATTRIBUTE_STANDARD_ICON);
 
+	if (data->job.options & BRASERO_IO_INFO_MTIME)
+		strcat (attributes, "," G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
 	if (data->children) {
 		file = data->children->data;
 		data->children = g_slist_remove (data->children, file);
@@ -52,7 +52,9 @@ typedef enum {
 	BRASERO_IO_INFO_FOLLOW_SYMLINK		= 1 << 7,
 
 	BRASERO_IO_INFO_URGENT			= 1 << 9,
-	BRASERO_IO_INFO_IDLE			= 1 << 10
+	BRASERO_IO_INFO_IDLE			= 1 << 10,
+
+	BRASERO_IO_INFO_MTIME			= 1 << 11
 } BraseroIOFlags;
 
 
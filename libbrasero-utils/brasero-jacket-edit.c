@@ -32,12 +32,17 @@
 #  include <config.h>
 #endif
 
+#include <string.h>
+
 #include <glib.h>
 #include <glib/gi18n-lib.h>
 #include <glib-object.h>
 
 #include <gtk/gtk.h>
 
+#include <cairo.h>
+#include <cairo-pdf.h>
+
 #include "brasero-misc.h"
 #include "brasero-jacket-edit.h"
 #include "brasero-jacket-buffer.h"
@@ -78,6 +83,10 @@ enum {
 
 G_DEFINE_TYPE (BraseroJacketEdit, brasero_jacket_edit, GTK_TYPE_BOX);
 
+/* Space between front and back covers (in points) and PNG resolution */
+#define BRASERO_JACKET_EDIT_SPACING		20.0
+#define BRASERO_JACKET_EDIT_PNG_RESOLUTION	300.0
+
 static void
 brasero_jacket_edit_print_page (GtkPrintOperation *operation,
 				GtkPrintContext *context,
@@ -743,6 +752,157 @@ brasero_jacket_edit_get_back (BraseroJacketEdit *self)
 	return BRASERO_JACKET_VIEW (priv->back);
 }
 
+static void
+brasero_jacket_edit_render_page (BraseroJacketEdit *self,
+				 cairo_t *ctx,
+				 gdouble resolution)
+{
+	BraseroJacketEditPrivate *priv;
+	PangoLayout *layout;
+	guint y;
+
+	priv = BRASERO_JACKET_EDIT_PRIVATE (self);
+
+	cairo_save (ctx);
+	cairo_set_source_rgb (ctx, 1.0, 1.0, 1.0);
+	cairo_paint (ctx);
+	cairo_restore (ctx);
+
+	/* Same layout as when printing: front cover on top of back cover */
+	layout = pango_cairo_create_layout (ctx);
+	pango_cairo_context_set_resolution (pango_layout_get_context (layout), resolution);
+
+	y = brasero_jacket_view_render_page (BRASERO_JACKET_VIEW (priv->front),
+					     ctx,
+					     layout,
+					     resolution,
+					     resolution,
+					     0.,
+					     0.);
+	brasero_jacket_view_render_page (BRASERO_JACKET_VIEW (priv->back),
+					 ctx,
+					 layout,
+					 resolution,
+					 resolution,
+					 0.,
+					 y + BRASERO_JACKET_EDIT_SPACING * resolution / 72.0);
+	g_object_unref (layout);
+}
+
+static gchar *
+brasero_jacket_edit_get_png_path (const gchar *path,
+				  guint num,
+				  guint total)
+{
+	const gchar *extension;
+	gchar *prefix;
+	gchar *retval;
+
+	if (total <= 1)
+		return g_strdup (path);
+
+	extension = g_strrstr (path, ".");
+	if (!extension || strchr (extension, G_DIR_SEPARATOR))
+		return g_strdup_printf ("%s-%03i", path, num);
+
+	prefix = g_strndup (path, extension - path);
+	retval = g_strdup_printf ("%s-%03i%s", prefix, num, extension);
+	g_free (prefix);
+	return retval;
+}
+
+/**
+ * brasero_jacket_edit_render_to_file:
+ * @jackets: a #GSList of #BraseroJacketEdit
+ * @path: the file to write to
+ * @error: a #GError
+ *
+ * Renders all @jackets without any user interaction. If @path ends with
+ * ".pdf" all jackets are written as consecutive pages of a single vectorial
+ * document; otherwise one PNG file is written per jacket (numbered when
+ * there are more than one).
+ * The jackets must be inside a realized toplevel (a #GtkOffscreenWindow
+ * will do) so that their text is laid out.
+ *
+ * Return value: a #gboolean. TRUE on success.
+ **/
+gboolean
+brasero_jacket_edit_render_to_file (GSList *jackets,
+				    const gchar *path,
+				    GError **error)
+{
+	cairo_surface_t *surface = NULL;
+	cairo_status_t status;
+	gdouble resolution;
+	gboolean is_pdf;
+	gint width, height;
+	GSList *iter;
+	guint total;
+	guint num;
+
+	if (!jackets)
+		return TRUE;
+
+	is_pdf = g_str_has_suffix (path, ".pdf") || g_str_has_suffix (path, ".PDF");
+
+	/* PDF are in points (1/72 inch) */
+	resolution = is_pdf? 72.0:BRASERO_JACKET_EDIT_PNG_RESOLUTION;
+	width = COVER_WIDTH_BACK_INCH * resolution + 2;
+	height = (COVER_HEIGHT_FRONT_INCH + COVER_HEIGHT_BACK_INCH) * resolution +
+		 BRASERO_JACKET_EDIT_SPACING * resolution / 72.0 + 3;
+
+	if (is_pdf)
+		surface = cairo_pdf_surface_create (path, width, height);
+
+	total = g_slist_length (jackets);
+	status = CAIRO_STATUS_SUCCESS;
+	for (iter = jackets, num = 1; iter && status == CAIRO_STATUS_SUCCESS; iter = iter->next, num ++) {
+		cairo_t *ctx;
+
+		if (!is_pdf)
+			surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, height);
+
+		ctx = cairo_create (surface);
+		brasero_jacket_edit_render_page (BRASERO_JACKET_EDIT (iter->data), ctx, resolution);
+
+		if (is_pdf)
+			cairo_show_page (ctx);
+
+		status = cairo_status (ctx);
+		cairo_destroy (ctx);
+
+		if (!is_pdf) {
+			gchar *png_path;
+
+			png_path = brasero_jacket_edit_get_png_path (path, num, total);
+			if (status == CAIRO_STATUS_SUCCESS)
+				status = cairo_surface_write_to_png (surface, png_path);
+			g_free (png_path);
+
+			cairo_surface_destroy (surface);
+		}
+	}
+
+	if (is_pdf) {
+		cairo_surface_finish (surface);
+		if (status == CAIRO_STATUS_SUCCESS)
+			status = cairo_surface_status (surface);
+		cairo_surface_destroy (surface);
+	}
+
+	if (status != CAIRO_STATUS_SUCCESS) {
+		g_set_error (error,
+			     BRASERO_UTILS_ERROR,
+			     BRASERO_UTILS_ERROR_GENERAL,
+			     _("The cover could not be saved to \"%s\" (%s)."),
+			     path,
+			     cairo_status_to_string (status));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static void
 brasero_jacket_edit_finalize (GObject *object)
 {
@@ -765,6 +925,37 @@ brasero_jacket_edit_new (void)
 	return g_object_new (BRASERO_TYPE_JACKET_EDIT, NULL);
 }
 
+/**
+ * brasero_jacket_edit_offscreen_new:
+ * @contents: a #BraseroJacketEdit
+ *
+ * Creates a jacket editor inside a toplevel that is never shown on screen
+ * so that jackets can be rendered in batch with
+ * brasero_jacket_edit_render_to_file ().
+ *
+ * Return value: the #GtkWidget toplevel. Destroy it when done.
+ **/
+GtkWidget *
+brasero_jacket_edit_offscreen_new (BraseroJacketEdit **contents_ret)
+{
+	GtkWidget *window;
+	GtkWidget *contents;
+
+	window = gtk_offscreen_window_new ();
+	gtk_window_set_default_size (GTK_WINDOW (window), 680, 640);
+
+	contents = brasero_jacket_edit_new ();
+	gtk_widget_show (contents);
+	gtk_container_add (GTK_CONTAINER (window), contents);
+
+	if (contents_ret)
+		*contents_ret = BRASERO_JACKET_EDIT (contents);
+
+	/* This realizes and allocates everything */
+	gtk_widget_show (window);
+	return window;
+}
+
 GtkWidget *
 brasero_jacket_edit_dialog_new (GtkWidget *toplevel,
 				BraseroJacketEdit **contents_ret)
@@ -68,6 +68,14 @@ GtkWidget *
 brasero_jacket_edit_dialog_new (GtkWidget *toplevel,
 				BraseroJacketEdit **contents);
 
+GtkWidget *
+brasero_jacket_edit_offscreen_new (BraseroJacketEdit **contents);
+
+gboolean
+brasero_jacket_edit_render_to_file (GSList *jackets,
+				    const gchar *path,
+				    GError **error);
+
 void
 brasero_jacket_edit_freeze (BraseroJacketEdit *self);
 
@@ -60,8 +60,27 @@ struct _BraseroJacketViewPrivate
 	GdkPixbuf *scaled;
 	gchar *image_path;
 	BraseroJacketImageStyle image_style;
+
+	/* Pre-rendered backgrounds, one per resolution */
+	GSList *tiles;
+	cairo_surface_t *textview_tile;
+	gint textview_width;
+	gint textview_height;
+};
+
+/* The background (image or colours) is composited once per resolution and
+ * reused for every draw or allocation until the image, the colours, the side
+ * or the resolution change. */
+typedef struct _BraseroJacketViewTile BraseroJacketViewTile;
+struct _BraseroJacketViewTile
+{
+	gdouble resolution_x;
+	gdouble resolution_y;
+	cairo_surface_t *surface;
 };
 
+#define BRASERO_JACKET_VIEW_MAX_TILES		4
+
 #define BRASERO_JACKET_VIEW_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_JACKET_VIEW, BraseroJacketViewPrivate))
 
 enum
@@ -440,10 +459,108 @@ brasero_jacket_view_render_background (BraseroJacketView *self,
 	}
 }
 
+static void
+brasero_jacket_view_get_size (BraseroJacketView *self,
+			      gdouble resolution_x,
+			      gdouble resolution_y,
+			      gint *width,
+			      gint *height)
+{
+	BraseroJacketViewPrivate *priv;
+
+	priv = BRASERO_JACKET_VIEW_PRIVATE (self);
+
+	if (priv->side == BRASERO_JACKET_BACK) {
+		*width = COVER_WIDTH_BACK_INCH * resolution_x;
+		*height = COVER_HEIGHT_BACK_INCH * resolution_y;
+	}
+	else {
+		*width = COVER_WIDTH_FRONT_INCH * resolution_x;
+		*height = COVER_HEIGHT_FRONT_INCH * resolution_y;
+	}
+}
+
+static void
+brasero_jacket_view_tile_free (BraseroJacketViewTile *tile)
+{
+	cairo_surface_destroy (tile->surface);
+	g_free (tile);
+}
+
+static void
+brasero_jacket_view_invalidate_tiles (BraseroJacketView *self)
+{
+	BraseroJacketViewPrivate *priv;
+
+	priv = BRASERO_JACKET_VIEW_PRIVATE (self);
+
+	g_slist_foreach (priv->tiles, (GFunc) brasero_jacket_view_tile_free, NULL);
+	g_slist_free (priv->tiles);
+	priv->tiles = NULL;
+
+	/* Forces the text view background to be set again */
+	priv->textview_tile = NULL;
+}
+
+static cairo_surface_t *
+brasero_jacket_view_get_tile (BraseroJacketView *self,
+			      GdkPixbuf *scaled,
+			      gdouble resolution_x,
+			      gdouble resolution_y)
+{
+	BraseroJacketViewPrivate *priv;
+	BraseroJacketViewTile *tile;
+	gint width, height;
+	GSList *iter;
+	cairo_t *ctx;
+
+	priv = BRASERO_JACKET_VIEW_PRIVATE (self);
+
+	if (priv->image_style == BRASERO_JACKET_IMAGE_NONE
+	&&  priv->color_style == BRASERO_JACKET_COLOR_NONE)
+		return NULL;
+
+	for (iter = priv->tiles; iter; iter = iter->next) {
+		tile = iter->data;
+		if (tile->resolution_x == resolution_x
+		&&  tile->resolution_y == resolution_y)
+			return tile->surface;
+	}
+
+	brasero_jacket_view_get_size (self, resolution_x, resolution_y, &width, &height);
+	if (width <= 0 || height <= 0)
+		return NULL;
+
+	tile = g_new0 (BraseroJacketViewTile, 1);
+	tile->resolution_x = resolution_x;
+	tile->resolution_y = resolution_y;
+	tile->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+
+	ctx = cairo_create (tile->surface);
+	brasero_jacket_view_render_background (self, ctx, scaled, 0, 0, width, height);
+	cairo_destroy (ctx);
+
+	/* Keep the most recent resolutions only */
+	priv->tiles = g_slist_prepend (priv->tiles, tile);
+	if (g_slist_length (priv->tiles) > BRASERO_JACKET_VIEW_MAX_TILES) {
+		iter = g_slist_last (priv->tiles);
+		if (iter->data != tile) {
+			if (((BraseroJacketViewTile *) iter->data)->surface == priv->textview_tile)
+				priv->textview_tile = NULL;
+
+			brasero_jacket_view_tile_free (iter->data);
+			priv->tiles = g_slist_delete_link (priv->tiles, iter);
+		}
+	}
+
+	return tile->surface;
+}
+
 static void
 brasero_jacket_view_render (BraseroJacketView *self,
 			    cairo_t *ctx,
 			    PangoLayout *layout,
+			    cairo_surface_t *tile,
 			    GdkPixbuf *scaled,
 			    gdouble resolution_x,
 			    gdouble resolution_y,
@@ -456,16 +573,19 @@ brasero_jacket_view_render (BraseroJacketView *self,
 
 	priv = BRASERO_JACKET_VIEW_PRIVATE (self);
 
-	if (priv->side == BRASERO_JACKET_BACK) {
-		width = COVER_WIDTH_BACK_INCH * resolution_x;
-		height = COVER_HEIGHT_BACK_INCH * resolution_y;
-	}
-	else {
-		width = COVER_WIDTH_FRONT_INCH * resolution_x;
-		height = COVER_HEIGHT_FRONT_INCH * resolution_y;
-	}
+	brasero_jacket_view_get_size (self, resolution_x, resolution_y, &width, &height);
 
-	brasero_jacket_view_render_background (self, ctx, scaled, x, y, width, height);
+	/* When there is a pre-rendered background use it; otherwise (that is
+	 * for printing) draw it directly so that it stays vectorial */
+	if (tile) {
+		cairo_save (ctx);
+		cairo_set_source_surface (ctx, tile, x, y);
+		cairo_rectangle (ctx, x, y, width, height);
+		cairo_fill (ctx);
+		cairo_restore (ctx);
+	}
+	else
+		brasero_jacket_view_render_background (self, ctx, scaled, x, y, width, height);
 
 	if (priv->side == BRASERO_JACKET_BACK) {
 		gdouble line_x, line_y;
@@ -526,18 +646,17 @@ brasero_jacket_view_scale_image (BraseroJacketView *self,
 				 gdouble resolution_y)
 {
 	BraseroJacketViewPrivate *priv;
-	guint width, height;
+	gint width, height;
 
 	priv = BRASERO_JACKET_VIEW_PRIVATE (self);
 
-	if (priv->side == BRASERO_JACKET_BACK) {
-		height = resolution_y * COVER_HEIGHT_BACK_INCH;
-		width = resolution_x * COVER_WIDTH_BACK_INCH;
-	}
-	else {
-		height = resolution_y * COVER_HEIGHT_FRONT_INCH;
-		width = resolution_x * COVER_WIDTH_FRONT_INCH;
-	}
+	brasero_jacket_view_get_size (self, resolution_x, resolution_y, &width, &height);
+
+	/* No need to scale it again if we already did it */
+	if (priv->scaled
+	&&  gdk_pixbuf_get_width (priv->scaled) == width
+	&&  gdk_pixbuf_get_height (priv->scaled) == height)
+		return g_object_ref (priv->scaled);
 
 	return gdk_pixbuf_scale_simple (priv->image,
 					width,
@@ -546,27 +665,20 @@ brasero_jacket_view_scale_image (BraseroJacketView *self,
 }
 
 guint
-brasero_jacket_view_print (BraseroJacketView *self,
-			   GtkPrintContext *context,
-			   gdouble x,
-			   gdouble y)
+brasero_jacket_view_render_page (BraseroJacketView *self,
+				 cairo_t *ctx,
+				 PangoLayout *layout,
+				 gdouble resolution_x,
+				 gdouble resolution_y,
+				 gdouble x,
+				 gdouble y)
 {
 	guint height;
-	cairo_t *ctx;
-	PangoLayout *layout;
-	gdouble resolution_x;
-	gdouble resolution_y;
 	GdkPixbuf *scaled = NULL;
 	BraseroJacketViewPrivate *priv;
 
 	priv = BRASERO_JACKET_VIEW_PRIVATE (self);
 
-	ctx = gtk_print_context_get_cairo_context (context);
-
-	/* set clip */
-	resolution_x = gtk_print_context_get_dpi_x (context);
-	resolution_y = gtk_print_context_get_dpi_y (context);
-
 	if (priv->side == BRASERO_JACKET_BACK)
 		height = (resolution_y * COVER_HEIGHT_BACK_INCH) + 1.0;
 	else
@@ -580,10 +692,10 @@ brasero_jacket_view_print (BraseroJacketView *self,
 	else if (priv->scaled)
 		scaled = g_object_ref (priv->scaled);
 
-	layout = gtk_print_context_create_pango_layout (context);
 	brasero_jacket_view_render (self,
 				    ctx,
 				    layout,
+				    NULL,
 				    scaled,
 				    resolution_x,
 				    resolution_y,
@@ -601,14 +713,37 @@ brasero_jacket_view_print (BraseroJacketView *self,
 					 y,
 					 FALSE);
 
-	g_object_unref (layout);
-
 	if (scaled)
 		g_object_unref (scaled);
 
 	return height;
 }
 
+guint
+brasero_jacket_view_print (BraseroJacketView *self,
+			   GtkPrintContext *context,
+			   gdouble x,
+			   gdouble y)
+{
+	guint height;
+	cairo_t *ctx;
+	PangoLayout *layout;
+
+	ctx = gtk_print_context_get_cairo_context (context);
+	layout = gtk_print_context_create_pango_layout (context);
+
+	height = brasero_jacket_view_render_page (self,
+						  ctx,
+						  layout,
+						  gtk_print_context_get_dpi_x (context),
+						  gtk_print_context_get_dpi_y (context),
+						  x,
+						  y);
+
+	g_object_unref (layout);
+	return height;
+}
+
 static void
 brasero_jacket_view_cursor_position_changed_cb (GObject *buffer,
 						GParamSpec *spec,
@@ -783,6 +918,7 @@ brasero_jacket_view_set_side (BraseroJacketView *self,
 	priv = BRASERO_JACKET_VIEW_PRIVATE (self);
 
 	priv->side = side;
+	brasero_jacket_view_invalidate_tiles (self);
 
 	buffer = gtk_text_view_get_buffer (GTK_TEXT_VIEW (priv->edit));
 
@@ -848,10 +984,10 @@ brasero_jacket_view_set_textview_background (BraseroJacketView *self)
 	guint resolution;
 	GdkWindow *window;
 	GtkWidget *toplevel;
+	cairo_surface_t *tile;
 	cairo_surface_t *surface;
 	GtkAllocation allocation;
-	guint x, y, width, height;
-	cairo_surface_t *subsurface;
+	guint x, y;
 	BraseroJacketViewPrivate *priv;
 	cairo_pattern_t *pattern = NULL;
 
@@ -870,43 +1006,46 @@ brasero_jacket_view_set_textview_background (BraseroJacketView *self)
 		return;
 
 	resolution = gdk_screen_get_resolution (gtk_window_get_screen (GTK_WINDOW (toplevel)));
-	if (priv->side == BRASERO_JACKET_BACK) {
-		width = COVER_WIDTH_BACK_INCH * resolution;
-		height = COVER_HEIGHT_BACK_INCH * resolution;
-	}
-	else {
-		width = COVER_WIDTH_FRONT_INCH * resolution;
-		height = COVER_HEIGHT_FRONT_INCH * resolution;
-	}
+	tile = brasero_jacket_view_get_tile (self, priv->scaled, resolution, resolution);
+	if (!tile)
+		return;
 
+	gtk_widget_get_allocation (priv->edit, &allocation);
+
+	/* Nothing changed since the last time */
+	if (tile == priv->textview_tile
+	&&  allocation.width == priv->textview_width
+	&&  allocation.height == priv->textview_height)
+		return;
+
+	x = COVER_TEXT_MARGIN * resolution;
+	y = COVER_TEXT_MARGIN * resolution;
+
+	if (priv->side == BRASERO_JACKET_BACK)
+		x += COVER_WIDTH_SIDE_INCH * resolution;
+
+	/* Only keep the part of the background under the text view */
 	surface = gdk_window_create_similar_surface (window,
 						     CAIRO_CONTENT_COLOR_ALPHA,
-						     width,
-						     height);
+						     allocation.width,
+						     allocation.height);
 	cr = cairo_create (surface);
 
 	cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
 	cairo_paint (cr);
 
-	x = COVER_TEXT_MARGIN * resolution;
-       	y = COVER_TEXT_MARGIN * resolution;
-       	gtk_widget_get_allocation (priv->edit, &allocation);
-
-       	if (priv->side == BRASERO_JACKET_BACK)
-        	x += COVER_WIDTH_SIDE_INCH * resolution;
-
-	brasero_jacket_view_render_background (self, cr, priv->scaled, 0, 0, width, height);
-	subsurface = cairo_surface_create_for_rectangle (surface,
-							 x,
-							 y,
-							 allocation.width,
-							 allocation.height);
-	pattern = cairo_pattern_create_for_surface (subsurface);
+	cairo_set_source_surface (cr, tile, - (gdouble) x, - (gdouble) y);
+	cairo_paint (cr);
+	cairo_destroy (cr);
+
+	pattern = cairo_pattern_create_for_surface (surface);
 	gdk_window_set_background_pattern (window, pattern);
 	cairo_pattern_destroy (pattern);
-	cairo_surface_destroy (subsurface);
 	cairo_surface_destroy (surface);
-	cairo_destroy (cr);
+
+	priv->textview_tile = tile;
+	priv->textview_width = allocation.width;
+	priv->textview_height = allocation.height;
 }
 
 static GdkPixbuf *
@@ -947,6 +1086,8 @@ brasero_jacket_view_update_image (BraseroJacketView *self)
 
 	priv = BRASERO_JACKET_VIEW_PRIVATE (self);
 
+	brasero_jacket_view_invalidate_tiles (self);
+
 	if (priv->scaled) {
 		g_object_unref (priv->scaled);
 		priv->scaled = NULL;
@@ -1073,6 +1214,7 @@ brasero_jacket_view_set_color (BraseroJacketView *self,
 		priv->image = NULL;
 	}
 
+	brasero_jacket_view_invalidate_tiles (self);
 	brasero_jacket_view_set_textview_background (self);
 	gtk_widget_queue_draw (GTK_WIDGET (self));
 }
@@ -1168,6 +1310,7 @@ brasero_jacket_view_draw (GtkWidget *widget,
 	gdouble resolution;
 	GtkWidget *toplevel;
 	PangoLayout *layout;
+	cairo_surface_t *tile;
 	GtkAllocation allocation, sides_allocation;
 	BraseroJacketViewPrivate *priv;
 
@@ -1182,6 +1325,7 @@ brasero_jacket_view_draw (GtkWidget *widget,
 	cairo_paint (ctx);
 
 	resolution = gdk_screen_get_resolution (gtk_window_get_screen (GTK_WINDOW (toplevel)));
+	tile = brasero_jacket_view_get_tile (BRASERO_JACKET_VIEW (widget), priv->scaled, resolution, resolution);
 	layout = gtk_widget_create_pango_layout (widget, NULL);
 	gtk_widget_get_allocation (widget, &allocation);
 	if (priv->side == BRASERO_JACKET_BACK) {
@@ -1191,6 +1335,7 @@ brasero_jacket_view_draw (GtkWidget *widget,
 		brasero_jacket_view_render (BRASERO_JACKET_VIEW (widget),
 					    ctx,
 					    layout,
+					    tile,
 					    priv->scaled,
 					    resolution,
 					    resolution,
@@ -1221,6 +1366,7 @@ brasero_jacket_view_draw (GtkWidget *widget,
 		brasero_jacket_view_render (BRASERO_JACKET_VIEW (widget),
 					    ctx,
 					    layout,
+					    tile,
 					    priv->scaled,
 					    resolution,
 					    resolution,
@@ -1349,14 +1495,15 @@ brasero_jacket_view_size_allocate (GtkWidget *widget,
 	resolution = gdk_screen_get_resolution (gtk_window_get_screen (GTK_WINDOW (toplevel)));
 	priv = BRASERO_JACKET_VIEW_PRIVATE (widget);
 
+	/* Only scale the pixbuf again if the resolution changed */
 	if (priv->image && priv->image_style == BRASERO_JACKET_IMAGE_STRETCH) {
-		if (priv->scaled) {
-			g_object_unref (priv->scaled);
-			priv->scaled = NULL;
-		}
+		gint width, height;
 
-		/* scale pixbuf */
-		brasero_jacket_view_update_image (BRASERO_JACKET_VIEW (widget));
+		brasero_jacket_view_get_size (BRASERO_JACKET_VIEW (widget), resolution, resolution, &width, &height);
+		if (!priv->scaled
+		||  gdk_pixbuf_get_width (priv->scaled) != width
+		||  gdk_pixbuf_get_height (priv->scaled) != height)
+			brasero_jacket_view_update_image (BRASERO_JACKET_VIEW (widget));
 	}
 
 	view_alloc.x = BRASERO_JACKET_VIEW_MARGIN + COVER_TEXT_MARGIN * resolution;
@@ -1497,6 +1644,9 @@ brasero_jacket_view_finalize (GObject *object)
 	BraseroJacketViewPrivate *priv;
 
 	priv = BRASERO_JACKET_VIEW_PRIVATE (object);
+
+	brasero_jacket_view_invalidate_tiles (BRASERO_JACKET_VIEW (object));
+
 	if (priv->image) {
 		g_object_unref (priv->image);
 		priv->image = NULL;
@@ -117,6 +117,15 @@ brasero_jacket_view_print (BraseroJacketView *view,
 			   gdouble x,
 			   gdouble y);
 
+guint
+brasero_jacket_view_render_page (BraseroJacketView *view,
+				 cairo_t *ctx,
+				 PangoLayout *layout,
+				 gdouble resolution_x,
+				 gdouble resolution_y,
+				 gdouble x,
+				 gdouble y);
+
 GtkTextBuffer *
 brasero_jacket_view_get_active_buffer (BraseroJacketView *view);
 
@@ -33,9 +33,11 @@
 #endif
 
 #include <string.h>
+#include <math.h>
 
 #include <glib.h>
 #include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
 #include <glib-object.h>
 
 #include <gdk-pixbuf/gdk-pixbuf.h>
@@ -48,8 +50,23 @@
 
 #include "brasero-misc.h"
 #include "brasero-metadata.h"
+#include "brasero-lru-cache.h"
 
 #define BRASERO_METADATA_SILENCE_INTERVAL		100000000LL
+
+/* -50 dB */
+#define BRASERO_METADATA_SILENCE_THRESHOLD		0.00316227766f
+
+/* Number of frames whose peak is computed at once */
+#define BRASERO_METADATA_SILENCE_CHUNK			256
+
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+#define BRASERO_METADATA_SILENCE_CAPS			"audio/x-raw,format=F32LE,layout=interleaved"
+#else
+#define BRASERO_METADATA_SILENCE_CAPS			"audio/x-raw,format=F32BE,layout=interleaved"
+#endif
+
+#define BRASERO_METADATA_SILENCE_CACHE_MAX		256
 #define BRASERO_METADATA_INITIAL_STATE			GST_STATE_PAUSED
 
 struct BraseroMetadataPrivate {
@@ -57,7 +74,7 @@ struct BraseroMetadataPrivate {
 	GstElement *source;
 	GstElement *decode;
 	GstElement *convert;
-	GstElement *level;
+	GstElement *silence_filter;
 	GstElement *sink;
 
 	GstElement *pipeline_mp3;
@@ -71,7 +88,14 @@ struct BraseroMetadataPrivate {
 	guint watch;
 	guint watch_mp3;
 
-	BraseroMetadataSilence *silence;
+	/* Silence scanning: these are only modified by the streaming thread
+	 * of the sink until EOS is reached */
+	GSList *silences;
+	guint64 silence_frames;
+	guint64 silence_last_loud;
+	guint64 silence_min_frames;
+	gint silence_rate;
+	gint silence_channels;
 
 	BraseroMetadataFlag flags;
 	BraseroMetadataInfo *info;
@@ -90,7 +114,7 @@ struct BraseroMetadataPrivate {
 
 	guint started:1;
 	guint moved_forward:1;
-	guint prev_level_mes:1;
+	guint silence_scanning:1;
 	guint video_linked:1;
 	guint audio_linked:1;
 	guint snapshot_started:1;
@@ -189,6 +213,12 @@ brasero_metadata_info_clear (BraseroMetadataInfo *info)
 	if (info->isrc)
 		g_free (info->isrc);
 
+	if (info->video_caps)
+		g_free (info->video_caps);
+
+	if (info->audio_caps)
+		g_free (info->audio_caps);
+
 	if (info->silences) {
 		g_slist_foreach (info->silences, (GFunc) g_free, NULL);
 		g_slist_free (info->silences);
@@ -220,6 +250,8 @@ brasero_metadata_info_copy (BraseroMetadataInfo *dest,
 	dest->rate = src->rate;
 	dest->channels = src->channels;
 	dest->len = src->len;
+	dest->bytes = src->bytes;
+	dest->audio_bitrate = src->audio_bitrate;
 	dest->is_seekable = src->is_seekable;
 	dest->has_audio = src->has_audio;
 	dest->has_video = src->has_video;
@@ -248,6 +280,12 @@ brasero_metadata_info_copy (BraseroMetadataInfo *dest,
 	if (src->isrc)
 		dest->isrc = g_strdup (src->isrc);
 
+	if (src->video_caps)
+		dest->video_caps = g_strdup (src->video_caps);
+
+	if (src->audio_caps)
+		dest->audio_caps = g_strdup (src->audio_caps);
+
 	if (src->snapshot) {
 		dest->snapshot = src->snapshot;
 		g_object_ref (dest->snapshot);
@@ -336,9 +374,9 @@ brasero_metadata_destroy_pipeline (BraseroMetadata *self)
 	gst_object_unref (GST_OBJECT (priv->pipeline));
 	priv->pipeline = NULL;
 
-	if (priv->level) {
-		gst_object_unref (GST_OBJECT (priv->level));
-		priv->level = NULL;
+	if (priv->silence_filter) {
+		gst_object_unref (GST_OBJECT (priv->silence_filter));
+		priv->silence_filter = NULL;
 	}
 
 	if (priv->sink) {
@@ -958,6 +996,33 @@ foreach_tag (const GstTagList *list,
 	}
 }
 
+static void
+brasero_metadata_stream_tags (BraseroMetadata *self,
+			      const GstTagList *list)
+{
+	BraseroMetadataPrivate *priv;
+	const gchar *tags [] = { GST_TAG_NOMINAL_BITRATE,
+				 GST_TAG_MAXIMUM_BITRATE,
+				 GST_TAG_BITRATE,
+				 NULL };
+	guint i;
+
+	priv = BRASERO_METADATA_PRIVATE (self);
+
+	/* Parsers send the codec and the bit rates of a stream in the same
+	 * list. Keep the highest one for the audio stream since that's what
+	 * formats limit. */
+	if (!gst_tag_list_get_tag_size (list, GST_TAG_AUDIO_CODEC))
+		return;
+
+	for (i = 0; tags [i]; i ++) {
+		guint bitrate = 0;
+
+		if (gst_tag_list_get_uint (list, tags [i], &bitrate))
+			priv->info->audio_bitrate = MAX (priv->info->audio_bitrate, bitrate);
+	}
+}
+
 static gboolean
 brasero_metadata_process_element_messages (BraseroMetadata *self,
 					   GstMessage *msg)
@@ -989,55 +1054,6 @@ brasero_metadata_process_element_messages (BraseroMetadata *self,
 	&&   gst_is_missing_plugin_message (msg)) {
 		priv->missing_plugins = g_slist_prepend (priv->missing_plugins, gst_message_ref (msg));
 	}
-	else if (gst_message_has_name (msg, "level")
-	&&   gst_structure_has_field (s, "peak")) {
-		const GValue *value;
-		const GValue *list;
-		gdouble peak;
-
-		/* FIXME: this might still be changed to GValueArray before 1.0 release */
-		list = gst_structure_get_value (s, "peak");
-		value = gst_value_list_get_value (list, 0);
-		peak = g_value_get_double (value);
-
-		/* detection of silence */
-		if (peak < -50.0) {
-			gint64 pos = -1;
-
-			/* was there a silence last time we check ?
-			 * NOTE: if that's the first signal we receive
-			 * then consider that silence started from 0 */
-			gst_element_query_position (priv->pipeline, GST_FORMAT_TIME, &pos);
-			if (pos == -1) {
-				BRASERO_UTILS_LOG ("impossible to retrieve position");
-				return TRUE;
-			}
-
-			if (!priv->silence) {
-				priv->silence = g_new0 (BraseroMetadataSilence, 1);
-				if (priv->prev_level_mes) {
-					priv->silence->start = pos;
-					priv->silence->end = pos;
-				}
-				else {
-					priv->silence->start = 0;
-					priv->silence->end = pos;
-				}
-			}				
-			else
-				priv->silence->end = pos;
-
-			BRASERO_UTILS_LOG ("silence detected at %lli", pos);
-		}
-		else if (priv->silence) {
-			BRASERO_UTILS_LOG ("silence finished");
-
-			priv->info->silences = g_slist_append (priv->info->silences,
-							       priv->silence);
-			priv->silence = NULL;
-		}
-		priv->prev_level_mes = 1;
-	}
 
 	return TRUE;
 }
@@ -1069,6 +1085,452 @@ brasero_metadata_process_pending_messages (BraseroMetadata *self)
 	g_object_unref (bus);
 }
 
+/**
+ * Silence detection: raw samples are checked as they reach the sink. The
+ * peak of each chunk of frames is computed first so that only chunks with
+ * a loud frame are looked at frame by frame.
+ */
+
+static void
+brasero_metadata_silence_scan_reset (BraseroMetadata *self)
+{
+	BraseroMetadataPrivate *priv;
+
+	priv = BRASERO_METADATA_PRIVATE (self);
+
+	if (priv->silences) {
+		g_slist_foreach (priv->silences, (GFunc) g_free, NULL);
+		g_slist_free (priv->silences);
+		priv->silences = NULL;
+	}
+
+	priv->silence_frames = 0;
+	priv->silence_last_loud = 0;
+	priv->silence_min_frames = 0;
+	priv->silence_rate = 0;
+	priv->silence_channels = 0;
+	priv->silence_scanning = 0;
+}
+
+static void
+brasero_metadata_silence_add (BraseroMetadata *self,
+			      guint64 start,
+			      guint64 end)
+{
+	BraseroMetadataSilence *silence;
+	BraseroMetadataPrivate *priv;
+
+	priv = BRASERO_METADATA_PRIVATE (self);
+
+	silence = g_new0 (BraseroMetadataSilence, 1);
+	silence->start = gst_util_uint64_scale (start, GST_SECOND, priv->silence_rate);
+	silence->end = gst_util_uint64_scale (end, GST_SECOND, priv->silence_rate);
+	priv->silences = g_slist_prepend (priv->silences, silence);
+
+	BRASERO_UTILS_LOG ("Silence detected from %lli to %lli", silence->start, silence->end);
+}
+
+static inline gfloat
+brasero_metadata_silence_peak (const gfloat *samples,
+			       guint num)
+{
+	gfloat peak = 0.0;
+	guint i;
+
+	for (i = 0; i < num; i ++) {
+		gfloat value;
+
+		value = fabsf (samples [i]);
+		peak = value > peak ? value:peak;
+	}
+
+	return peak;
+}
+
+static void
+brasero_metadata_silence_scan (BraseroMetadata *self,
+			       const gfloat *samples,
+			       guint64 frames)
+{
+	BraseroMetadataPrivate *priv;
+	guint64 offset;
+	gint channels;
+
+	priv = BRASERO_METADATA_PRIVATE (self);
+
+	channels = priv->silence_channels;
+	for (offset = 0; offset < frames; offset += BRASERO_METADATA_SILENCE_CHUNK) {
+		const gfloat *chunk;
+		guint64 first;
+		guint64 last;
+		guint num;
+
+		num = MIN (BRASERO_METADATA_SILENCE_CHUNK, frames - offset);
+		chunk = samples + offset * channels;
+
+		if (brasero_metadata_silence_peak (chunk, num * channels) <= BRASERO_METADATA_SILENCE_THRESHOLD)
+			continue;
+
+		/* Find the first and last loud frames of the chunk. Since a
+		 * chunk is shorter than the minimum length of a silence there
+		 * can't be any silence in between. */
+		for (first = 0; first < num; first ++) {
+			if (brasero_metadata_silence_peak (chunk + first * channels, channels) > BRASERO_METADATA_SILENCE_THRESHOLD)
+				break;
+		}
+
+		for (last = num - 1; last > first; last --) {
+			if (brasero_metadata_silence_peak (chunk + last * channels, channels) > BRASERO_METADATA_SILENCE_THRESHOLD)
+				break;
+		}
+
+		first += priv->silence_frames + offset;
+		last += priv->silence_frames + offset;
+
+		if (first - priv->silence_last_loud >= priv->silence_min_frames)
+			brasero_metadata_silence_add (self, priv->silence_last_loud, first);
+
+		priv->silence_last_loud = last + 1;
+	}
+
+	priv->silence_frames += frames;
+}
+
+static void
+brasero_metadata_silence_handoff_cb (GstElement *sink,
+				     GstBuffer *buffer,
+				     GstPad *pad,
+				     BraseroMetadata *self)
+{
+	BraseroMetadataPrivate *priv;
+	GstMapInfo map;
+
+	priv = BRASERO_METADATA_PRIVATE (self);
+
+	if (!priv->silence_rate) {
+		GstStructure *structure;
+		GstCaps *caps;
+
+		caps = gst_pad_get_current_caps (pad);
+		if (!caps)
+			return;
+
+		structure = gst_caps_get_structure (caps, 0);
+		gst_structure_get_int (structure, "rate", &priv->silence_rate);
+		gst_structure_get_int (structure, "channels", &priv->silence_channels);
+		gst_caps_unref (caps);
+
+		if (priv->silence_rate <= 0 || priv->silence_channels <= 0) {
+			priv->silence_rate = 0;
+			return;
+		}
+
+		/* NOTE: a silence must be longer than a chunk (see above) */
+		priv->silence_min_frames = gst_util_uint64_scale (BRASERO_METADATA_SILENCE_INTERVAL,
+								  priv->silence_rate,
+								  GST_SECOND);
+		priv->silence_min_frames = MAX (priv->silence_min_frames, BRASERO_METADATA_SILENCE_CHUNK + 1);
+	}
+
+	if (!gst_buffer_map (buffer, &map, GST_MAP_READ))
+		return;
+
+	brasero_metadata_silence_scan (self,
+				       (const gfloat *) map.data,
+				       map.size / (sizeof (gfloat) * priv->silence_channels));
+
+	gst_buffer_unmap (buffer, &map);
+}
+
+/**
+ * Detected silences are remembered as long as the file isn't modified
+ */
+
+static gchar *
+brasero_metadata_silence_cache_get_path (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "brasero",
+				 "silences",
+				 NULL);
+}
+
+static gchar *
+brasero_metadata_silence_cache_get_key (const gchar *uri)
+{
+	GChecksum *checksum;
+	GFileInfo *info;
+	gchar *string;
+	GFile *file;
+	gchar *key;
+
+	file = g_file_new_for_uri (uri);
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED,
+				  G_FILE_QUERY_INFO_NONE,
+				  NULL,
+				  NULL);
+	g_object_unref (file);
+
+	if (!info)
+		return NULL;
+
+	string = g_strdup_printf ("%s\n%" G_GUINT64_FORMAT "\n%" G_GOFFSET_FORMAT,
+				  uri,
+				  g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+				  g_file_info_get_size (info));
+	g_object_unref (info);
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA1);
+	g_checksum_update (checksum, (guchar *) string, strlen (string));
+	key = g_strdup (g_checksum_get_string (checksum));
+	g_checksum_free (checksum);
+	g_free (string);
+
+	return key;
+}
+
+G_LOCK_DEFINE_STATIC (silence_cache);
+
+static void
+brasero_metadata_silence_cache_store (const gchar *uri,
+				      GSList *silences)
+{
+	GKeyFile *key_file;
+	gchar **values;
+	GSList *iter;
+	gchar *path;
+	gchar *key;
+	gint i;
+
+	key = brasero_metadata_silence_cache_get_key (uri);
+	if (!key)
+		return;
+
+	G_LOCK (silence_cache);
+
+	path = brasero_metadata_silence_cache_get_path ();
+	key_file = brasero_lru_cache_load (path, 0);
+
+	values = g_new0 (gchar *, g_slist_length (silences) + 1);
+	for (i = 0, iter = silences; iter; iter = iter->next, i ++) {
+		BraseroMetadataSilence *silence;
+
+		silence = iter->data;
+		values [i] = g_strdup_printf ("%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT,
+					      silence->start,
+					      silence->end);
+	}
+
+	g_key_file_set_string_list (key_file, key, "silences", (const gchar * const *) values, i);
+	brasero_lru_cache_touch (key_file, key);
+	g_strfreev (values);
+	g_free (key);
+
+	brasero_lru_cache_prune (key_file, BRASERO_METADATA_SILENCE_CACHE_MAX, NULL, NULL);
+	if (!brasero_lru_cache_save (key_file, path, 0, NULL))
+		BRASERO_UTILS_LOG ("Silences could not be cached");
+
+	g_free (path);
+	g_key_file_free (key_file);
+
+	G_UNLOCK (silence_cache);
+}
+
+/**
+ * brasero_metadata_get_cached_silences:
+ * @uri: a #gchar
+ * @silences: a #GSList of #BraseroMetadataSilence
+ *
+ * Returns the silences found during a previous retrieval with the
+ * BRASERO_METADATA_FLAG_SILENCES flag provided the file was not
+ * modified since then. @silences must be freed afterwards.
+ *
+ * Return value: TRUE if the silences were found in the cache.
+ **/
+gboolean
+brasero_metadata_get_cached_silences (const gchar *uri,
+				      GSList **silences)
+{
+	GKeyFile *key_file;
+	gchar **values;
+	GSList *list;
+	gchar *path;
+	gchar *key;
+	gsize num;
+	gsize i;
+
+	key = brasero_metadata_silence_cache_get_key (uri);
+	if (!key)
+		return FALSE;
+
+	G_LOCK (silence_cache);
+
+	path = brasero_metadata_silence_cache_get_path ();
+	key_file = brasero_lru_cache_load (path, 0);
+	g_free (path);
+
+	G_UNLOCK (silence_cache);
+
+	values = g_key_file_get_string_list (key_file, key, "silences", &num, NULL);
+	g_key_file_free (key_file);
+	g_free (key);
+
+	if (!values)
+		return FALSE;
+
+	list = NULL;
+	for (i = 0; i < num; i ++) {
+		BraseroMetadataSilence *silence;
+		gchar *end;
+
+		silence = g_new0 (BraseroMetadataSilence, 1);
+		silence->start = g_ascii_strtoll (values [i], &end, 10);
+		if (end && *end == ':')
+			silence->end = g_ascii_strtoll (end + 1, NULL, 10);
+		else
+			silence->end = silence->start;
+
+		list = g_slist_prepend (list, silence);
+	}
+	g_strfreev (values);
+
+	BRASERO_UTILS_LOG ("Found %" G_GSIZE_FORMAT " cached silences for %s", num, uri);
+
+	*silences = g_slist_reverse (list);
+	return TRUE;
+}
+
+typedef struct _BraseroMetadataCachedSilences BraseroMetadataCachedSilences;
+struct _BraseroMetadataCachedSilences {
+	gchar *uri;
+	GSList *silences;
+	guint found:1;
+};
+
+static void
+brasero_metadata_cached_silences_free (gpointer data)
+{
+	BraseroMetadataCachedSilences *cached = data;
+
+	g_slist_foreach (cached->silences, (GFunc) g_free, NULL);
+	g_slist_free (cached->silences);
+	g_free (cached->uri);
+	g_free (cached);
+}
+
+static void
+brasero_metadata_cached_silences_thread (GSimpleAsyncResult *res,
+					 GObject *object,
+					 GCancellable *cancel)
+{
+	BraseroMetadataCachedSilences *cached;
+
+	cached = g_simple_async_result_get_op_res_gpointer (res);
+	cached->found = brasero_metadata_get_cached_silences (cached->uri, &cached->silences);
+}
+
+/**
+ * brasero_metadata_get_cached_silences_async:
+ * @uri: a #gchar
+ * @cancel: a #GCancellable or NULL
+ * @callback: a #GAsyncReadyCallback
+ * @user_data: a #gpointer
+ *
+ * Same as brasero_metadata_get_cached_silences () except that the file is
+ * queried and the cache read in a thread. @callback should call
+ * brasero_metadata_get_cached_silences_finish () to get the result.
+ **/
+void
+brasero_metadata_get_cached_silences_async (const gchar *uri,
+					    GCancellable *cancel,
+					    GAsyncReadyCallback callback,
+					    gpointer user_data)
+{
+	BraseroMetadataCachedSilences *cached;
+	GSimpleAsyncResult *res;
+
+	res = g_simple_async_result_new (NULL,
+					 callback,
+					 user_data,
+					 brasero_metadata_get_cached_silences_async);
+
+	cached = g_new0 (BraseroMetadataCachedSilences, 1);
+	cached->uri = g_strdup (uri);
+
+	g_simple_async_result_set_op_res_gpointer (res, cached, brasero_metadata_cached_silences_free);
+	g_simple_async_result_run_in_thread (res,
+					     brasero_metadata_cached_silences_thread,
+					     G_PRIORITY_DEFAULT,
+					     cancel);
+	g_object_unref (res);
+}
+
+/**
+ * brasero_metadata_get_cached_silences_finish:
+ * @result: a #GAsyncResult
+ * @silences: a #GSList of #BraseroMetadataSilence
+ * @error: a #GError or NULL
+ *
+ * Finishes brasero_metadata_get_cached_silences_async (). @silences must be
+ * freed afterwards. @error is only set if the lookup was cancelled.
+ *
+ * Return value: TRUE if the silences were found in the cache.
+ **/
+gboolean
+brasero_metadata_get_cached_silences_finish (GAsyncResult *result,
+					     GSList **silences,
+					     GError **error)
+{
+	BraseroMetadataCachedSilences *cached;
+	GSimpleAsyncResult *res;
+
+	res = G_SIMPLE_ASYNC_RESULT (result);
+	if (g_simple_async_result_propagate_error (res, error))
+		return FALSE;
+
+	cached = g_simple_async_result_get_op_res_gpointer (res);
+	if (!cached->found)
+		return FALSE;
+
+	*silences = cached->silences;
+	cached->silences = NULL;
+	return TRUE;
+}
+
+static void
+brasero_metadata_silence_scan_finish (BraseroMetadata *self)
+{
+	BraseroMetadataPrivate *priv;
+
+	priv = BRASERO_METADATA_PRIVATE (self);
+
+	if (!priv->silence_scanning)
+		return;
+
+	priv->silence_scanning = 0;
+
+	/* Silence at the end of the stream */
+	if (priv->silence_rate
+	&&  priv->silence_frames > priv->silence_last_loud
+	&&  priv->silence_frames - priv->silence_last_loud >= priv->silence_min_frames) {
+		BraseroMetadataSilence *silence;
+
+		brasero_metadata_silence_add (self,
+					      priv->silence_last_loud,
+					      priv->silence_frames);
+
+		silence = priv->silences->data;
+		silence->end = MAX (silence->end, (gint64) priv->info->len);
+	}
+
+	priv->info->silences = g_slist_reverse (priv->silences);
+	priv->silences = NULL;
+
+	brasero_metadata_silence_cache_store (priv->info->uri, priv->info->silences);
+}
+
 static gboolean
 brasero_metadata_success (BraseroMetadata *self)
 {
@@ -1081,11 +1543,8 @@ brasero_metadata_success (BraseroMetadata *self)
 	/* check if that's a seekable one */
 	brasero_metadata_is_seekable (self);
 
-	if (priv->silence) {
-		priv->silence->end = priv->info->len;
-		priv->info->silences = g_slist_append (priv->info->silences, priv->silence);
-		priv->silence = NULL;
-	}
+	if (priv->flags & BRASERO_METADATA_FLAG_SILENCES)
+		brasero_metadata_silence_scan_finish (self);
 
 	/* before leaving, check if we need a snapshot */
 	if (priv->info->len > 0
@@ -1104,6 +1563,7 @@ brasero_metadata_get_duration (BraseroMetadata *self,
 {
 	BraseroMetadataPrivate *priv;
 	gint64 duration = -1;
+	gint64 bytes = -1;
 
 	priv = BRASERO_METADATA_PRIVATE (self);
 
@@ -1134,6 +1594,13 @@ brasero_metadata_get_duration (BraseroMetadata *self,
 	BRASERO_UTILS_LOG ("Found duration %lli for %s", duration, priv->info->uri);
 
 	priv->info->len = duration;
+
+	/* Used with the duration to get the average bit rate */
+	if (priv->source
+	&&  gst_element_query_duration (priv->source, GST_FORMAT_BYTES, &bytes)
+	&&  bytes > 0)
+		priv->info->bytes = bytes;
+
 	return brasero_metadata_success (self);
 }
 
@@ -1312,6 +1779,7 @@ brasero_metadata_bus_messages (GstBus *bus,
 	case GST_MESSAGE_TAG:
 		gst_message_parse_tag (msg, &tags);
 		gst_tag_list_foreach (tags, (GstTagForeachFunc) foreach_tag, self);
+		brasero_metadata_stream_tags (self, tags);
 		gst_tag_list_free (tags);
 		break;
 
@@ -1328,6 +1796,13 @@ brasero_metadata_bus_messages (GstBus *bus,
 		if (newstate != GST_STATE_PAUSED && newstate != GST_STATE_PLAYING)
 			break;
 
+		/* Silences are only known once the whole stream was decoded */
+		if (priv->silence_scanning) {
+			if (newstate == GST_STATE_PAUSED)
+				gst_element_set_state (priv->pipeline, GST_STATE_PLAYING);
+			break;
+		}
+
 		if (!priv->snapshot_started)
 			return brasero_metadata_success_main (self);
 
@@ -1352,41 +1827,56 @@ brasero_metadata_create_audio_pipeline (BraseroMetadata *self)
 
 	/* set up the pipeline according to flags */
 	if (priv->flags & BRASERO_METADATA_FLAG_SILENCES) {
-		priv->prev_level_mes = 0;
+		brasero_metadata_silence_scan_reset (self);
 
 		/* Add a reference to these objects as we want to keep them
 		 * around after the bin they've been added to is destroyed
 		 * NOTE: now we destroy the pipeline every time which means
 		 * that it doesn't really matter. */
-		if (!priv->level) {
-			priv->level = gst_element_factory_make ("level", NULL);
-			if (!priv->level) {
+		if (!priv->silence_filter) {
+			GstCaps *caps;
+
+			priv->silence_filter = gst_element_factory_make ("capsfilter", NULL);
+			if (!priv->silence_filter) {
 				priv->error = g_error_new (BRASERO_UTILS_ERROR,
 							   BRASERO_UTILS_ERROR_GENERAL,
 							   _("%s element could not be created"),
-							   "\"Level\"");
+							   "\"Capsfilter\"");
 				gst_object_unref (priv->audio);
 				priv->audio = NULL;
 				return FALSE;
 			}
-			g_object_set (priv->level,
-				      "message", TRUE,
-				      "interval", (guint64) BRASERO_METADATA_SILENCE_INTERVAL,
+
+			/* Samples are scanned as native floats */
+			caps = gst_caps_from_string (BRASERO_METADATA_SILENCE_CAPS);
+			g_object_set (priv->silence_filter,
+				      "caps", caps,
 				      NULL);
+			gst_caps_unref (caps);
 		}
 
+		/* The sink hands us the samples as fast as they are decoded */
+		g_object_set (priv->sink,
+			      "signal-handoffs", TRUE,
+			      "sync", FALSE,
+			      NULL);
+		g_signal_connect (priv->sink,
+				  "handoff",
+				  G_CALLBACK (brasero_metadata_silence_handoff_cb),
+				  self);
+
 		gst_object_ref (priv->convert);
-		gst_object_ref (priv->level);
+		gst_object_ref (priv->silence_filter);
 		gst_object_ref (priv->sink);
 
 		gst_bin_add_many (GST_BIN (priv->audio),
 				  priv->convert,
-				  priv->level,
+				  priv->silence_filter,
 				  priv->sink,
 				  NULL);
 
 		if (!gst_element_link_many (priv->convert,
-		                            priv->level,
+		                            priv->silence_filter,
 		                            priv->sink,
 		                            NULL)) {
 			BRASERO_UTILS_LOG ("Impossible to link elements");
@@ -1395,6 +1885,7 @@ brasero_metadata_create_audio_pipeline (BraseroMetadata *self)
 			return FALSE;
 		}
 
+		priv->silence_scanning = 1;
 		audio_pad = gst_element_get_static_pad (priv->convert, "sink");
 	}
 	else if (priv->flags & BRASERO_METADATA_FLAG_THUMBNAIL) {
@@ -1630,6 +2121,49 @@ brasero_metadata_audio_caps (BraseroMetadata *self,
 	}
 }
 
+static gboolean
+brasero_metadata_autoplug_continue_cb (GstElement *decode,
+				       GstPad *pad,
+				       GstCaps *caps,
+				       BraseroMetadata *self)
+{
+	gboolean systemstream = FALSE;
+	BraseroMetadataPrivate *priv;
+	GstStructure *structure;
+	const gchar *name;
+
+	priv = BRASERO_METADATA_PRIVATE (self);
+
+	if (!priv->info || gst_caps_get_size (caps) != 1)
+		return TRUE;
+
+	/* Remember the caps of the elementary streams as they come out of
+	 * the demuxer and the parsers so that users can tell whether a
+	 * stream needs to be re-encoded. The last ones seen before the
+	 * decoder are the most complete (parsers add fields). */
+	structure = gst_caps_get_structure (caps, 0);
+	name = gst_structure_get_name (structure);
+	if (g_str_has_suffix (name, "/x-raw"))
+		return TRUE;
+
+	gst_structure_get_boolean (structure, "systemstream", &systemstream);
+	if (systemstream)
+		return TRUE;
+
+	if (g_str_has_prefix (name, "video/")) {
+		g_free (priv->info->video_caps);
+		priv->info->video_caps = gst_caps_to_string (caps);
+		BRASERO_UTILS_LOG ("Video stream %s", priv->info->video_caps);
+	}
+	else if (g_str_has_prefix (name, "audio/")) {
+		g_free (priv->info->audio_caps);
+		priv->info->audio_caps = gst_caps_to_string (caps);
+		BRASERO_UTILS_LOG ("Audio stream %s", priv->info->audio_caps);
+	}
+
+	return TRUE;
+}
+
 static void
 brasero_metadata_new_decoded_pad_cb (GstElement *decode,
 				     GstPad *pad,
@@ -1742,6 +2276,9 @@ brasero_metadata_create_pipeline (BraseroMetadata *self)
 	g_signal_connect (G_OBJECT (priv->decode), "pad-added",
 			  G_CALLBACK (brasero_metadata_new_decoded_pad_cb),
 			  self);
+	g_signal_connect (G_OBJECT (priv->decode), "autoplug-continue",
+			  G_CALLBACK (brasero_metadata_autoplug_continue_cb),
+			  self);
 
 	gst_bin_add (GST_BIN (priv->pipeline), priv->decode);
 
@@ -1786,10 +2323,7 @@ brasero_metadata_set_new_uri (BraseroMetadata *self,
 	brasero_metadata_info_free (priv->info);
 	priv->info = NULL;
 
-	if (priv->silence) {
-		g_free (priv->silence);
-		priv->silence = NULL;
-	}
+	brasero_metadata_silence_scan_reset (self);
 
 	priv->info = g_new0 (BraseroMetadataInfo, 1);
 	priv->info->uri = g_strdup (uri);
@@ -2056,10 +2590,7 @@ brasero_metadata_finalize (GObject *object)
 
 	brasero_metadata_destroy_pipeline (BRASERO_METADATA (object));
 
-	if (priv->silence) {
-		g_free (priv->silence);
-		priv->silence = NULL;
-	}
+	brasero_metadata_silence_scan_reset (BRASERO_METADATA (object));
 
 	if (priv->error) {
 		g_error_free (priv->error);
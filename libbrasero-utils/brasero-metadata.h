@@ -72,9 +72,18 @@ typedef struct {
 	gchar *isrc;
 	guint64 len;
 
+	/* caps of the streams before they are decoded */
+	gchar *video_caps;
+	gchar *audio_caps;
+
 	gint channels;
 	gint rate;
 
+	/* size of the source in bytes and highest bit rate reported by the
+	 * parser of the audio stream; 0 when they are unknown */
+	guint64 bytes;
+	guint audio_bitrate;
+
 	GSList *silences;
 
 	GdkPixbuf *snapshot;
@@ -148,6 +157,21 @@ brasero_metadata_get_result (BraseroMetadata *metadata,
 			     BraseroMetadataInfo *info,
 			     GError **error);
 
+gboolean
+brasero_metadata_get_cached_silences (const gchar *uri,
+				      GSList **silences);
+
+void
+brasero_metadata_get_cached_silences_async (const gchar *uri,
+					    GCancellable *cancel,
+					    GAsyncReadyCallback callback,
+					    gpointer user_data);
+
+gboolean
+brasero_metadata_get_cached_silences_finish (GAsyncResult *result,
+					     GSList **silences,
+					     GError **error);
+
 typedef int	(*BraseroMetadataGetXidCb)	(gpointer user_data);
 
 void
@@ -49,6 +49,7 @@
 #include "brasero-plugin-registration.h"
 #include "burn-cdrkit.h"
 #include "brasero-track-data.h"
+#include "burn-prefetch.h"
 
 
 #define BRASERO_TYPE_GENISOIMAGE         (brasero_genisoimage_get_type ())
@@ -61,6 +62,8 @@
 BRASERO_PLUGIN_BOILERPLATE (BraseroGenisoimage, brasero_genisoimage, BRASERO_TYPE_PROCESS, BraseroProcess);
 
 struct _BraseroGenisoimagePrivate {
+	BraseroPrefetch *prefetch;
+
 	guint use_utf8:1;
 };
 typedef struct _BraseroGenisoimagePrivate BraseroGenisoimagePrivate;
@@ -110,6 +113,7 @@ brasero_genisoimage_read_stderr (BraseroProcess *process, const gchar *line)
 	
 		fraction = g_strtod (fraction_str, NULL) / (gdouble) 100.0;
 		brasero_job_set_progress (BRASERO_JOB (genisoimage), fraction);
+		brasero_prefetch_set_progress (BRASERO_GENISOIMAGE_PRIVATE (process)->prefetch, fraction);
 		brasero_job_start_progress (BRASERO_JOB (process), FALSE);
 	}
 	else if (strstr (line, "Input/output error. Read error on old image")) {
@@ -231,6 +235,7 @@ brasero_genisoimage_set_argv_image (BraseroGenisoimage *genisoimage,
 				    GPtrArray *argv,
 				    GError **error)
 {
+	BraseroGenisoimagePrivate *priv;
 	gchar *label = NULL;
 	BraseroTrack *track;
 	BraseroBurnFlag flags;
@@ -425,6 +430,18 @@ brasero_genisoimage_set_argv_image (BraseroGenisoimage *genisoimage,
 		g_ptr_array_add (argv, videodir);
 	}
 
+	/* Read the files ahead in the order they'll be written to the image;
+	 * only when the image is really created, not when sizing it */
+	priv = BRASERO_GENISOIMAGE_PRIVATE (genisoimage);
+	if (priv->prefetch) {
+		brasero_prefetch_free (priv->prefetch);
+		priv->prefetch = NULL;
+	}
+
+	if (action == BRASERO_JOB_ACTION_IMAGE)
+		priv->prefetch = brasero_prefetch_new (brasero_track_data_get_grafts (BRASERO_TRACK_DATA (track)),
+						       brasero_track_data_get_excluded_list (BRASERO_TRACK_DATA (track)));
+
 	brasero_job_set_current_action (BRASERO_JOB (genisoimage),
 					BRASERO_BURN_ACTION_CREATING_IMAGE,
 					NULL,
@@ -469,10 +486,26 @@ brasero_genisoimage_set_argv (BraseroProcess *process,
 	return result;
 }
 
+static BraseroBurnResult
+brasero_genisoimage_stop (BraseroJob *job,
+			  GError **error)
+{
+	BraseroGenisoimagePrivate *priv;
+
+	priv = BRASERO_GENISOIMAGE_PRIVATE (job);
+	if (priv->prefetch) {
+		brasero_prefetch_free (priv->prefetch);
+		priv->prefetch = NULL;
+	}
+
+	return BRASERO_JOB_CLASS (parent_class)->stop (job, error);
+}
+
 static void
 brasero_genisoimage_class_init (BraseroGenisoimageClass *klass)
 {
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	BraseroJobClass *job_class = BRASERO_JOB_CLASS (klass);
 	BraseroProcessClass *process_class = BRASERO_PROCESS_CLASS (klass);
 
 	g_type_class_add_private (klass, sizeof (BraseroGenisoimagePrivate));
@@ -480,6 +513,8 @@ brasero_genisoimage_class_init (BraseroGenisoimageClass *klass)
 	parent_class = g_type_class_peek_parent(klass);
 	object_class->finalize = brasero_genisoimage_finalize;
 
+	job_class->stop = brasero_genisoimage_stop;
+
 	process_class->stdout_func = brasero_genisoimage_read_stdout;
 	process_class->stderr_func = brasero_genisoimage_read_stderr;
 	process_class->set_argv = brasero_genisoimage_set_argv;
@@ -512,6 +547,14 @@ brasero_genisoimage_init (BraseroGenisoimage *obj)
 static void
 brasero_genisoimage_finalize (GObject *object)
 {
+	BraseroGenisoimagePrivate *priv;
+
+	priv = BRASERO_GENISOIMAGE_PRIVATE (object);
+	if (priv->prefetch) {
+		brasero_prefetch_free (priv->prefetch);
+		priv->prefetch = NULL;
+	}
+
 	G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -315,6 +315,7 @@ brasero_wodim_stdout_read (BraseroProcess *process, const gchar *line)
 	    sscanf (line, "Track %2u:    %d of %d MB written (fifo  %d%%) [buf  %d%%] |%*s  %*s|   %d.%dx.",
 	            &track, &mb_written, &mb_total, &fifo, &buf, &speed_1, &speed_2) == 7) {
 		brasero_wodim_set_rate (process, speed_1, speed_2);
+		brasero_job_set_buffer_levels (BRASERO_JOB (wodim), fifo, buf);
 		priv->current_track_written = (goffset) mb_written * (goffset) 1048576LL;
 		brasero_wodim_compute (wodim,
 				       mb_written,
@@ -329,6 +330,7 @@ brasero_wodim_stdout_read (BraseroProcess *process, const gchar *line)
 			 &track, &mb_written, &fifo, &buf, &speed_1, &speed_2) == 6) {
 		/* this line is printed when wodim writes on the fly */
 		brasero_wodim_set_rate (process, speed_1, speed_2);
+		brasero_job_set_buffer_levels (BRASERO_JOB (wodim), fifo, buf);
 		priv->current_track_written = (goffset) mb_written * (goffset) 1048576LL;
 		if (brasero_job_get_fd_in (BRASERO_JOB (wodim), NULL) == BRASERO_BURN_OK) {
 			goffset bytes = 0;
@@ -775,6 +777,18 @@ brasero_wodim_write_infs (BraseroWodim *wodim,
 	return BRASERO_BURN_OK;
 }
 
+static void
+brasero_wodim_add_fifo_size (BraseroWodim *wodim,
+			     GPtrArray *argv,
+			     guint default_size)
+{
+	guint fifo_size = default_size;
+
+	/* Adapt the FIFO to what happened during previous burns */
+	brasero_job_get_fifo_size (BRASERO_JOB (wodim), default_size, &fifo_size);
+	g_ptr_array_add (argv, g_strdup_printf ("fs=%im", fifo_size));
+}
+
 static BraseroBurnResult
 brasero_wodim_set_argv_record (BraseroWodim *wodim,
 				GPtrArray *argv, 
@@ -861,7 +875,7 @@ brasero_wodim_set_argv_record (BraseroWodim *wodim,
 		else if (buffer_size < 4)
 			buffer_size = 4;
 
-		g_ptr_array_add (argv, g_strdup_printf ("fs=%im", buffer_size));
+		brasero_wodim_add_fifo_size (wodim, argv, buffer_size);
 		if (brasero_track_type_get_has_image (type)) {
 			if (brasero_track_type_get_image_format (type) == BRASERO_IMAGE_FORMAT_BIN) {
 				g_ptr_array_add (argv, g_strdup_printf ("tsize=%"G_GINT64_FORMAT"s", sectors));
@@ -900,7 +914,7 @@ brasero_wodim_set_argv_record (BraseroWodim *wodim,
 		BraseroBurnResult result;
 		GSList *tracks;
 
-		g_ptr_array_add (argv, g_strdup ("fs=16m"));
+		brasero_wodim_add_fifo_size (wodim, argv, 16);
 		g_ptr_array_add (argv, g_strdup ("-audio"));
 		g_ptr_array_add (argv, g_strdup ("-pad"));
 	
@@ -946,7 +960,7 @@ brasero_wodim_set_argv_record (BraseroWodim *wodim,
 				BRASERO_JOB_NOT_READY (wodim);
 			}
 
-			g_ptr_array_add (argv, g_strdup ("fs=16m"));
+			brasero_wodim_add_fifo_size (wodim, argv, 16);
 			g_ptr_array_add (argv, g_strdup ("-data"));
 			g_ptr_array_add (argv, g_strdup ("-nopad"));
 			g_ptr_array_add (argv, image_path);
@@ -960,7 +974,7 @@ brasero_wodim_set_argv_record (BraseroWodim *wodim,
 				BRASERO_JOB_NOT_READY (wodim);
 			}
 
-			g_ptr_array_add (argv, g_strdup ("fs=16m"));
+			brasero_wodim_add_fifo_size (wodim, argv, 16);
 			g_ptr_array_add (argv, g_strdup ("-data"));
 			g_ptr_array_add (argv, g_strdup ("-nopad"));
 			g_ptr_array_add (argv, isopath);
@@ -974,7 +988,7 @@ brasero_wodim_set_argv_record (BraseroWodim *wodim,
 				BRASERO_JOB_NOT_READY (wodim);
 			}
 
-			g_ptr_array_add (argv, g_strdup ("fs=16m"));
+			brasero_wodim_add_fifo_size (wodim, argv, 16);
 			g_ptr_array_add (argv, g_strdup ("-clone"));
 			g_ptr_array_add (argv, rawpath);
 		}
@@ -997,7 +1011,7 @@ brasero_wodim_set_argv_record (BraseroWodim *wodim,
 			if (brasero_track_image_need_byte_swap (BRASERO_TRACK_IMAGE (track)))
 				g_ptr_array_add (argv, g_strdup ("-swab"));
 
-			g_ptr_array_add (argv, g_strdup ("fs=16m"));
+			brasero_wodim_add_fifo_size (wodim, argv, 16);
 
 			/* This is to make sure the CD-TEXT stuff gets written */
 			g_ptr_array_add (argv, g_strdup ("-text"));
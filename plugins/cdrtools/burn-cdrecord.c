@@ -305,6 +305,7 @@ brasero_cdrecord_stdout_read (BraseroProcess *process, const gchar *line)
 	            &track, &mb_written, &mb_total, &fifo, &buf, &speed_1, &speed_2) == 7) {
 
 		brasero_cdrecord_set_rate (process, speed_1, speed_2);
+		brasero_job_set_buffer_levels (BRASERO_JOB (cdrecord), fifo, buf);
 		priv->current_track_written = (goffset) mb_written * (goffset) 1048576LL;
 		brasero_cdrecord_compute (cdrecord,
 					  mb_written,
@@ -319,6 +320,7 @@ brasero_cdrecord_stdout_read (BraseroProcess *process, const gchar *line)
 			 &track, &mb_written, &fifo, &buf, &speed_1, &speed_2) == 6) {
 
 				 brasero_cdrecord_set_rate (process, speed_1, speed_2);
+		brasero_job_set_buffer_levels (BRASERO_JOB (cdrecord), fifo, buf);
 		priv->current_track_written = (goffset) mb_written * (goffset) 1048576LL;
 		if (brasero_job_get_fd_in (BRASERO_JOB (cdrecord), NULL) == BRASERO_BURN_OK) {
 			goffset bytes = 0;
@@ -772,6 +774,18 @@ brasero_cdrecord_write_infs (BraseroCDRecord *cdrecord,
 	return BRASERO_BURN_OK;
 }
 
+static void
+brasero_cdrecord_add_fifo_size (BraseroCDRecord *cdrecord,
+				GPtrArray *argv,
+				guint default_size)
+{
+	guint fifo_size = default_size;
+
+	/* Adapt the FIFO to what happened during previous burns */
+	brasero_job_get_fifo_size (BRASERO_JOB (cdrecord), default_size, &fifo_size);
+	g_ptr_array_add (argv, g_strdup_printf ("fs=%im", fifo_size));
+}
+
 static BraseroBurnResult
 brasero_cdrecord_set_argv_record (BraseroCDRecord *cdrecord,
 				  GPtrArray *argv, 
@@ -859,7 +873,7 @@ brasero_cdrecord_set_argv_record (BraseroCDRecord *cdrecord,
 		else if (buffer_size < 4)
 			buffer_size = 4;
 
-		g_ptr_array_add (argv, g_strdup_printf ("fs=%im", buffer_size));
+		brasero_cdrecord_add_fifo_size (cdrecord, argv, buffer_size);
 		if (brasero_track_type_get_has_image (type)) {
 			BraseroImageFormat format;
 
@@ -897,7 +911,7 @@ brasero_cdrecord_set_argv_record (BraseroCDRecord *cdrecord,
 		BraseroBurnResult result;
 		GSList *tracks;
 
-		g_ptr_array_add (argv, g_strdup ("fs=16m"));
+		brasero_cdrecord_add_fifo_size (cdrecord, argv, 16);
 		g_ptr_array_add (argv, g_strdup ("-audio"));
 		g_ptr_array_add (argv, g_strdup ("-pad"));
 	
@@ -943,7 +957,7 @@ brasero_cdrecord_set_argv_record (BraseroCDRecord *cdrecord,
 				BRASERO_JOB_NOT_READY (cdrecord);
 			}
 
-			g_ptr_array_add (argv, g_strdup ("fs=16m"));
+			brasero_cdrecord_add_fifo_size (cdrecord, argv, 16);
 			g_ptr_array_add (argv, g_strdup ("-data"));
 			g_ptr_array_add (argv, g_strdup ("-nopad"));
 			g_ptr_array_add (argv, image_path);
@@ -957,7 +971,7 @@ brasero_cdrecord_set_argv_record (BraseroCDRecord *cdrecord,
 				BRASERO_JOB_NOT_READY (cdrecord);
 			}
 
-			g_ptr_array_add (argv, g_strdup ("fs=16m"));
+			brasero_cdrecord_add_fifo_size (cdrecord, argv, 16);
 			g_ptr_array_add (argv, g_strdup ("-data"));
 			g_ptr_array_add (argv, g_strdup ("-nopad"));
 			g_ptr_array_add (argv, isopath);
@@ -971,7 +985,7 @@ brasero_cdrecord_set_argv_record (BraseroCDRecord *cdrecord,
 				BRASERO_JOB_NOT_READY (cdrecord);
 			}
 
-			g_ptr_array_add (argv, g_strdup ("fs=16m"));
+			brasero_cdrecord_add_fifo_size (cdrecord, argv, 16);
 			g_ptr_array_add (argv, g_strdup ("-clone"));
 			g_ptr_array_add (argv, rawpath);
 		}
@@ -994,7 +1008,7 @@ brasero_cdrecord_set_argv_record (BraseroCDRecord *cdrecord,
 			if (brasero_track_image_need_byte_swap (BRASERO_TRACK_IMAGE (track)))
 				g_ptr_array_add (argv, g_strdup ("-swab"));
 
-			g_ptr_array_add (argv, g_strdup ("fs=16m"));
+			brasero_cdrecord_add_fifo_size (cdrecord, argv, 16);
 
 			/* This is to make sure the CD-TEXT stuff gets written */
 			g_ptr_array_add (argv, g_strdup ("-text"));
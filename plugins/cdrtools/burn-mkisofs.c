@@ -50,6 +50,7 @@
 #include "brasero-plugin-registration.h"
 #include "burn-cdrtools.h"
 #include "brasero-track-data.h"
+#include "burn-prefetch.h"
 
 
 #define BRASERO_TYPE_MKISOFS         (brasero_mkisofs_get_type ())
@@ -62,6 +63,8 @@
 BRASERO_PLUGIN_BOILERPLATE (BraseroMkisofs, brasero_mkisofs, BRASERO_TYPE_PROCESS, BraseroProcess);
 
 struct _BraseroMkisofsPrivate {
+	BraseroPrefetch *prefetch;
+
 	guint use_utf8:1;
 };
 typedef struct _BraseroMkisofsPrivate BraseroMkisofsPrivate;
@@ -110,6 +113,7 @@ brasero_mkisofs_read_stderr (BraseroProcess *process, const gchar *line)
 	
 		fraction = g_strtod (fraction_str, NULL) / (gdouble) 100.0;
 		brasero_job_set_progress (BRASERO_JOB (mkisofs), fraction);
+		brasero_prefetch_set_progress (BRASERO_MKISOFS_PRIVATE (process)->prefetch, fraction);
 		brasero_job_start_progress (BRASERO_JOB (process), FALSE);
 	}
 	else if (strstr (line, "Input/output error. Read error on old image")) {
@@ -231,6 +235,7 @@ brasero_mkisofs_set_argv_image (BraseroMkisofs *mkisofs,
 				GPtrArray *argv,
 				GError **error)
 {
+	BraseroMkisofsPrivate *priv;
 	gchar *label = NULL;
 	BraseroTrack *track;
 	BraseroBurnFlag flags;
@@ -429,6 +434,18 @@ brasero_mkisofs_set_argv_image (BraseroMkisofs *mkisofs,
 		g_ptr_array_add (argv, videodir);
 	}
 
+	/* Read the files ahead in the order they'll be written to the image;
+	 * only when the image is really created, not when sizing it */
+	priv = BRASERO_MKISOFS_PRIVATE (mkisofs);
+	if (priv->prefetch) {
+		brasero_prefetch_free (priv->prefetch);
+		priv->prefetch = NULL;
+	}
+
+	if (action == BRASERO_JOB_ACTION_IMAGE)
+		priv->prefetch = brasero_prefetch_new (brasero_track_data_get_grafts (BRASERO_TRACK_DATA (track)),
+						       brasero_track_data_get_excluded_list (BRASERO_TRACK_DATA (track)));
+
 	brasero_job_set_current_action (BRASERO_JOB (mkisofs),
 					BRASERO_BURN_ACTION_CREATING_IMAGE,
 					NULL,
@@ -473,10 +490,26 @@ brasero_mkisofs_set_argv (BraseroProcess *process,
 	return result;
 }
 
+static BraseroBurnResult
+brasero_mkisofs_stop (BraseroJob *job,
+		      GError **error)
+{
+	BraseroMkisofsPrivate *priv;
+
+	priv = BRASERO_MKISOFS_PRIVATE (job);
+	if (priv->prefetch) {
+		brasero_prefetch_free (priv->prefetch);
+		priv->prefetch = NULL;
+	}
+
+	return BRASERO_JOB_CLASS (parent_class)->stop (job, error);
+}
+
 static void
 brasero_mkisofs_class_init (BraseroMkisofsClass *klass)
 {
 	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	BraseroJobClass *job_class = BRASERO_JOB_CLASS (klass);
 	BraseroProcessClass *process_class = BRASERO_PROCESS_CLASS (klass);
 
 	g_type_class_add_private (klass, sizeof (BraseroMkisofsPrivate));
@@ -484,6 +517,8 @@ brasero_mkisofs_class_init (BraseroMkisofsClass *klass)
 	parent_class = g_type_class_peek_parent(klass);
 	object_class->finalize = brasero_mkisofs_finalize;
 
+	job_class->stop = brasero_mkisofs_stop;
+
 	process_class->stdout_func = brasero_mkisofs_read_stdout;
 	process_class->stderr_func = brasero_mkisofs_read_stderr;
 	process_class->set_argv = brasero_mkisofs_set_argv;
@@ -516,6 +551,14 @@ brasero_mkisofs_init (BraseroMkisofs *obj)
 static void
 brasero_mkisofs_finalize (GObject *object)
 {
+	BraseroMkisofsPrivate *priv;
+
+	priv = BRASERO_MKISOFS_PRIVATE (object);
+	if (priv->prefetch) {
+		brasero_prefetch_free (priv->prefetch);
+		priv->prefetch = NULL;
+	}
+
 	G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
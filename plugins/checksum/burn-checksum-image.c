@@ -39,6 +39,7 @@
 #include <sys/param.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <math.h>
 
 #include <glib.h>
 #include <glib-object.h>
@@ -49,12 +50,15 @@
 
 #include "brasero-plugin-registration.h"
 #include "burn-job.h"
+#include "scsi-device.h"
 #include "burn-volume.h"
+#include "brasero-units.h"
 #include "brasero-drive.h"
 #include "brasero-track-disc.h"
 #include "brasero-track-image.h"
 #include "brasero-tags.h"
 
+#include "burn-checksum-tree.h"
 
 #define BRASERO_TYPE_CHECKSUM_IMAGE		(brasero_checksum_image_get_type ())
 #define BRASERO_CHECKSUM_IMAGE(o)		(G_TYPE_CHECK_INSTANCE_CAST ((o), BRASERO_TYPE_CHECKSUM_IMAGE, BraseroChecksumImage))
@@ -69,6 +73,11 @@ struct _BraseroChecksumImagePrivate {
 	GChecksum *checksum;
 	BraseroChecksumType checksum_type;
 
+	/* Used instead of checksum for BRASERO_CHECKSUM_SHA256_TREE */
+	BraseroChecksumTree *tree;
+	BraseroChecksumTree *expected;
+	GSList *damaged_files;
+
 	/* That's for progress reporting */
 	goffset total;
 	goffset bytes;
@@ -88,6 +97,10 @@ typedef struct _BraseroChecksumImagePrivate BraseroChecksumImagePrivate;
 #define BRASERO_SCHEMA_CONFIG		"org.gnome.brasero.config"
 #define BRASERO_PROPS_CHECKSUM_IMAGE	"checksum-image"
 
+/* Default number of ranges read for a sampled check */
+#define BRASERO_CHECKSUM_IMAGE_SAMPLES		64
+#define BRASERO_CHECKSUM_IMAGE_READ_BLOCKS	64
+
 static BraseroJobClass *parent_class = NULL;
 
 static gint
@@ -202,7 +215,11 @@ brasero_checksum_image_checksum (BraseroChecksumImage *self,
 
 	priv = BRASERO_CHECKSUM_IMAGE_PRIVATE (self);
 
-	priv->checksum = g_checksum_new (checksum_type);
+	if (priv->checksum_type == BRASERO_CHECKSUM_SHA256_TREE)
+		priv->tree = brasero_checksum_tree_new (priv->expected);
+	else
+		priv->checksum = g_checksum_new (checksum_type);
+
 	result = BRASERO_BURN_OK;
 	while (1) {
 		read_bytes = brasero_checksum_image_read (self,
@@ -230,9 +247,14 @@ brasero_checksum_image_checksum (BraseroChecksumImage *self,
 				break;
 		}
 
-		g_checksum_update (priv->checksum,
-				   buffer,
-				   read_bytes);
+		if (priv->tree)
+			brasero_checksum_tree_update (priv->tree,
+						      buffer,
+						      read_bytes);
+		else
+			g_checksum_update (priv->checksum,
+					   buffer,
+					   read_bytes);
 
 		priv->bytes += read_bytes;
 	}
@@ -328,6 +350,441 @@ brasero_checksum_image_checksum_file_input (BraseroChecksumImage *self,
 	return result;
 }
 
+static void
+brasero_checksum_image_add_damaged_files (BraseroChecksumImage *self,
+					  BraseroVolFile *file,
+					  const gchar *parent_path,
+					  guint64 start,
+					  GSList *damaged)
+{
+	BraseroChecksumImagePrivate *priv;
+	GSList *extents;
+	gchar *path;
+
+	priv = BRASERO_CHECKSUM_IMAGE_PRIVATE (self);
+
+	if (file->name)
+		path = g_build_path (G_DIR_SEPARATOR_S, parent_path, BRASERO_VOLUME_FILE_NAME (file), NULL);
+	else
+		path = g_strdup (parent_path);
+
+	if (file->isdir) {
+		GList *iter;
+
+		for (iter = file->specific.dir.children; iter; iter = iter->next)
+			brasero_checksum_image_add_damaged_files (self,
+								  iter->data,
+								  path,
+								  start,
+								  damaged);
+		g_free (path);
+		return;
+	}
+
+	for (extents = file->specific.file.extents; extents; extents = extents->next) {
+		BraseroVolFileExtent *extent;
+		guint64 first, last;
+		GSList *iter;
+
+		/* Files imported from a previous session are not in the track */
+		extent = extents->data;
+		if (extent->block < start)
+			continue;
+
+		first = extent->block - start;
+		last = first + BRASERO_BYTES_TO_SECTORS (extent->size, 2048);
+
+		for (iter = damaged; iter; iter = iter->next) {
+			guint64 leaf_start;
+
+			leaf_start = (guint64) GPOINTER_TO_UINT (iter->data) * BRASERO_CHECKSUM_TREE_SECTORS;
+			if (first < leaf_start + BRASERO_CHECKSUM_TREE_SECTORS && leaf_start < last) {
+				BRASERO_JOB_LOG (self, "Damaged file %s", path);
+				priv->damaged_files = g_slist_prepend (priv->damaged_files, path);
+				return;
+			}
+		}
+	}
+
+	g_free (path);
+}
+
+static void
+brasero_checksum_image_get_damaged_files (BraseroChecksumImage *self,
+					  BraseroVolSrc *vol,
+					  guint64 start,
+					  GSList *damaged)
+{
+	BraseroVolFile *root;
+
+	if (!damaged)
+		return;
+
+	/* Find out which files lie on the damaged parts of the track */
+	root = brasero_volume_get_files (vol, start, NULL, NULL, NULL, NULL);
+	if (!root)
+		return;
+
+	brasero_checksum_image_add_damaged_files (self, root, G_DIR_SEPARATOR_S, start, damaged);
+	brasero_volume_file_free (root);
+}
+
+static void
+brasero_checksum_image_set_damaged_files_tag (BraseroChecksumImage *self,
+					      BraseroTrack *track)
+{
+	BraseroChecksumImagePrivate *priv;
+	GPtrArray *files;
+	GValue *value;
+	GSList *iter;
+
+	priv = BRASERO_CHECKSUM_IMAGE_PRIVATE (self);
+
+	if (!priv->damaged_files)
+		return;
+
+	files = g_ptr_array_new ();
+	for (iter = priv->damaged_files; iter; iter = iter->next)
+		g_ptr_array_add (files, g_strdup (iter->data));
+	g_ptr_array_add (files, NULL);
+
+	value = g_new0 (GValue, 1);
+	g_value_init (value, G_TYPE_STRV);
+	g_value_take_boxed (value, g_ptr_array_free (files, FALSE));
+	brasero_track_tag_add (track,
+			       BRASERO_TRACK_MEDIUM_WRONG_CHECKSUM_TAG,
+			       value);
+}
+
+static void
+brasero_checksum_image_clean_tree (BraseroChecksumImage *self)
+{
+	BraseroChecksumImagePrivate *priv;
+
+	priv = BRASERO_CHECKSUM_IMAGE_PRIVATE (self);
+
+	if (priv->tree) {
+		brasero_checksum_tree_free (priv->tree);
+		priv->tree = NULL;
+	}
+
+	if (priv->expected) {
+		brasero_checksum_tree_free (priv->expected);
+		priv->expected = NULL;
+	}
+
+	if (priv->damaged_files) {
+		g_slist_foreach (priv->damaged_files, (GFunc) g_free, NULL);
+		g_slist_free (priv->damaged_files);
+		priv->damaged_files = NULL;
+	}
+}
+
+/**
+ * Picks @samples ranges out of @total. The track is divided into as many
+ * strata as there are samples and one range is picked randomly in each of
+ * them so that the whole surface of the disc is covered. Strata get narrower
+ * toward the end of the track where the outer zones of the disc, which are the
+ * most likely to be damaged, lie: the density of the checked ranges is twice
+ * as high there as at the beginning.
+ */
+
+static GArray *
+brasero_checksum_image_pick_ranges (guint total,
+				    guint samples,
+				    guint seed)
+{
+	GArray *ranges;
+	gint64 last = -1;
+	GRand *rand;
+	guint i;
+
+	if (!samples || samples >= total) {
+		ranges = g_array_sized_new (FALSE, FALSE, sizeof (guint), total);
+		for (i = 0; i < total; i ++)
+			g_array_append_val (ranges, i);
+
+		return ranges;
+	}
+
+	ranges = g_array_sized_new (FALSE, FALSE, sizeof (guint), samples);
+	rand = g_rand_new_with_seed (seed);
+	for (i = 0; i < samples; i ++) {
+		gdouble begin, end;
+		guint num;
+
+		/* The density grows linearly from 1 to 2 over the track so its
+		 * integral is x + x² / 2 which amounts to 1.5 at the end. */
+		begin = sqrt (1.0 + 3.0 * i / samples) - 1.0;
+		end = sqrt (1.0 + 3.0 * (i + 1) / samples) - 1.0;
+		num = g_rand_double_range (rand, begin, end) * total;
+
+		/* A stratum can be narrower than a range */
+		if ((gint64) num <= last)
+			num = last + 1;
+
+		if (num >= total)
+			break;
+
+		g_array_append_val (ranges, num);
+		last = num;
+	}
+	g_rand_free (rand);
+
+	return ranges;
+}
+
+/**
+ * Probability that at least one of @checked ranges out of @total would be
+ * damaged if 1% of the ranges were (sampling without replacement).
+ */
+
+static gdouble
+brasero_checksum_image_get_confidence (guint total,
+				       guint checked)
+{
+	gdouble missed = 1.0;
+	guint damaged;
+	guint i;
+
+	damaged = MAX (1, (total + 99) / 100);
+	if (checked + damaged > total)
+		return 1.0;
+
+	for (i = 0; i < checked; i ++)
+		missed *= (gdouble) (total - damaged - i) / (gdouble) (total - i);
+
+	return 1.0 - missed;
+}
+
+static BraseroBurnResult
+brasero_checksum_image_check_range (BraseroChecksumImage *self,
+				    BraseroVolSrc *vol,
+				    guint64 start,
+				    guint num,
+				    gboolean *matches,
+				    GError **error)
+{
+	BraseroChecksumImagePrivate *priv;
+	GChecksum *checksum;
+	gchar *buffer;
+	goffset size;
+
+	priv = BRASERO_CHECKSUM_IMAGE_PRIVATE (self);
+
+	/* The last range of the track is usually shorter */
+	size = brasero_checksum_tree_get_size (priv->expected) - (goffset) num * BRASERO_CHECKSUM_TREE_BLOCK_SIZE;
+	size = MIN (size, BRASERO_CHECKSUM_TREE_BLOCK_SIZE);
+
+	if (BRASERO_VOL_SRC_SEEK (vol, start + (guint64) num * BRASERO_CHECKSUM_TREE_SECTORS, SEEK_SET, error) == -1)
+		return BRASERO_BURN_ERR;
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA256);
+	buffer = g_new (gchar, BRASERO_CHECKSUM_IMAGE_READ_BLOCKS * 2048);
+	*matches = TRUE;
+
+	while (size > 0) {
+		guint blocks;
+		gsize len;
+
+		if (priv->cancel) {
+			g_checksum_free (checksum);
+			g_free (buffer);
+			return BRASERO_BURN_CANCEL;
+		}
+
+		blocks = MIN (BRASERO_CHECKSUM_IMAGE_READ_BLOCKS, BRASERO_BYTES_TO_SECTORS (size, 2048));
+		if (!BRASERO_VOL_SRC_READ (vol, buffer, blocks, NULL)) {
+			/* A range that cannot be read is damaged */
+			BRASERO_JOB_LOG (self, "Range %i could not be read", num);
+			*matches = FALSE;
+			break;
+		}
+
+		len = MIN (size, blocks * 2048);
+		g_checksum_update (checksum, (guchar *) buffer, len);
+		priv->bytes += len;
+		size -= len;
+	}
+
+	if (*matches)
+		*matches = brasero_checksum_tree_leaf_matches (priv->expected, num, checksum);
+
+	g_checksum_free (checksum);
+	g_free (buffer);
+
+	return BRASERO_BURN_OK;
+}
+
+static BraseroBurnResult
+brasero_checksum_image_sample (BraseroChecksumImage *self,
+			       GError **error)
+{
+	guint samples = BRASERO_CHECKSUM_IMAGE_SAMPLES;
+	BraseroChecksumImagePrivate *priv;
+	BraseroDeviceHandle *dev_handle;
+	BraseroTrack *track = NULL;
+	gboolean escalate = FALSE;
+	BraseroBurnResult result;
+	GSList *damaged = NULL;
+	gdouble confidence;
+	BraseroDrive *drive;
+	GValue *value;
+	BraseroVolSrc *vol;
+	GArray *ranges;
+	guint checked;
+	guint64 start;
+	guint total;
+	guint seed;
+	guint i;
+
+	priv = BRASERO_CHECKSUM_IMAGE_PRIVATE (self);
+
+	brasero_job_get_current_track (BRASERO_JOB (self), &track);
+	priv->expected = brasero_checksum_tree_load (brasero_track_get_checksum (track),
+						     brasero_track_tag_lookup_string (track, BRASERO_TRACK_CHECKSUM_TREE_TAG));
+	if (!priv->expected) {
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     _("No block checksum manifest could be found for the disc"));
+		return BRASERO_BURN_ERR;
+	}
+
+	value = NULL;
+	brasero_track_tag_lookup (track, BRASERO_TRACK_MEDIUM_CHECKSUM_SAMPLES_TAG, &value);
+	if (value)
+		samples = g_value_get_uint (value);
+
+	value = NULL;
+	brasero_track_tag_lookup (track, BRASERO_TRACK_MEDIUM_CHECKSUM_SEED_TAG, &value);
+	seed = value ? g_value_get_uint (value) : g_random_int ();
+
+	value = NULL;
+	brasero_track_tag_lookup (track, BRASERO_TRACK_MEDIUM_CHECKSUM_ESCALATE_TAG, &value);
+	if (value)
+		escalate = g_value_get_boolean (value);
+
+	/* Get the address of the track: either the one we have just written
+	 * or the last session */
+	drive = brasero_track_disc_get_drive (BRASERO_TRACK_DISC (track));
+
+	value = NULL;
+	brasero_track_tag_lookup (track, BRASERO_TRACK_MEDIUM_ADDRESS_START_TAG, &value);
+	if (value)
+		start = g_value_get_uint64 (value);
+	else {
+		goffset address = 0;
+
+		if (!brasero_medium_get_last_data_track_address (brasero_drive_get_medium (drive), NULL, &address))
+			return BRASERO_BURN_ERR;
+
+		start = address;
+	}
+
+	dev_handle = brasero_device_handle_open (brasero_drive_get_device (drive), FALSE, NULL);
+	if (!dev_handle) {
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_DRIVE_BUSY,
+			     _("The drive is busy"));
+		return BRASERO_BURN_ERR;
+	}
+
+	vol = brasero_volume_source_open_device_handle (dev_handle, error);
+	if (!vol) {
+		brasero_device_handle_close (dev_handle);
+		return BRASERO_BURN_ERR;
+	}
+
+	total = brasero_checksum_tree_get_leaves_num (priv->expected);
+	ranges = brasero_checksum_image_pick_ranges (total, samples, seed);
+	BRASERO_JOB_LOG (self,
+			 "Checking %i ranges out of %i (seed = %u)",
+			 ranges->len,
+			 total,
+			 seed);
+
+	brasero_job_set_current_action (BRASERO_JOB (self),
+				        BRASERO_BURN_ACTION_CHECKSUM,
+					_("Checking disc integrity"),
+					FALSE);
+	brasero_job_start_progress (BRASERO_JOB (self), FALSE);
+
+	priv->total = (goffset) ranges->len * BRASERO_CHECKSUM_TREE_BLOCK_SIZE;
+	priv->bytes = 0;
+
+	result = BRASERO_BURN_OK;
+	for (i = 0; i < ranges->len; i ++) {
+		gboolean matches;
+		guint num;
+
+		num = g_array_index (ranges, guint, i);
+		result = brasero_checksum_image_check_range (self, vol, start, num, &matches, error);
+		if (result != BRASERO_BURN_OK)
+			break;
+
+		if (!matches)
+			damaged = g_slist_prepend (damaged, GUINT_TO_POINTER (num));
+	}
+	checked = ranges->len;
+
+	/* Damage was found so check all the other ranges to know where */
+	if (result == BRASERO_BURN_OK && damaged && escalate && ranges->len < total) {
+		guint next = 0;
+		guint num;
+
+		BRASERO_JOB_LOG (self, "Damaged ranges found, checking the whole track");
+		priv->total = brasero_checksum_tree_get_size (priv->expected);
+
+		for (num = 0; num < total; num ++) {
+			gboolean matches;
+
+			/* ranges are sorted */
+			if (next < ranges->len && g_array_index (ranges, guint, next) == num) {
+				next ++;
+				continue;
+			}
+
+			result = brasero_checksum_image_check_range (self, vol, start, num, &matches, error);
+			if (result != BRASERO_BURN_OK)
+				break;
+
+			if (!matches)
+				damaged = g_slist_prepend (damaged, GUINT_TO_POINTER (num));
+		}
+		checked = total;
+	}
+	g_array_free (ranges, TRUE);
+
+	if (result == BRASERO_BURN_OK) {
+		confidence = brasero_checksum_image_get_confidence (total, checked);
+		BRASERO_JOB_LOG (self, "%i damaged ranges (confidence = %lf)", g_slist_length (damaged), confidence);
+
+		value = g_new0 (GValue, 1);
+		g_value_init (value, G_TYPE_DOUBLE);
+		g_value_set_double (value, confidence);
+		brasero_track_tag_add (track,
+				       BRASERO_TRACK_MEDIUM_CHECKSUM_CONFIDENCE_TAG,
+				       value);
+	}
+
+	if (result == BRASERO_BURN_OK && damaged) {
+		brasero_checksum_image_get_damaged_files (self, vol, start, damaged);
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_BAD_CHECKSUM,
+			     _("Some files may be corrupted on the disc"));
+		result = BRASERO_BURN_ERR;
+	}
+
+	g_slist_free (damaged);
+	brasero_volume_source_close (vol);
+	brasero_device_handle_close (dev_handle);
+
+	return result;
+}
+
 static BraseroBurnResult
 brasero_checksum_image_create_checksum (BraseroChecksumImage *self,
 					GError **error)
@@ -338,6 +795,7 @@ brasero_checksum_image_create_checksum (BraseroChecksumImage *self,
 	BraseroChecksumImagePrivate *priv;
 
 	priv = BRASERO_CHECKSUM_IMAGE_PRIVATE (self);
+	brasero_job_get_current_track (BRASERO_JOB (self), &track);
 
 	/* get the checksum type */
 	switch (priv->checksum_type) {
@@ -350,6 +808,14 @@ brasero_checksum_image_create_checksum (BraseroChecksumImage *self,
 		case BRASERO_CHECKSUM_SHA256:
 			checksum_type = G_CHECKSUM_SHA256;
 			break;
+		case BRASERO_CHECKSUM_SHA256_TREE:
+			checksum_type = G_CHECKSUM_SHA256;
+
+			/* The tree of the image lets us tell which parts of
+			 * the track are damaged */
+			priv->expected = brasero_checksum_tree_load (brasero_track_get_checksum (track),
+								     brasero_track_tag_lookup_string (track, BRASERO_TRACK_CHECKSUM_TREE_TAG));
+			break;
 		default:
 			return BRASERO_BURN_ERR;
 	}
@@ -359,7 +825,6 @@ brasero_checksum_image_create_checksum (BraseroChecksumImage *self,
 					_("Creating image checksum"),
 					FALSE);
 	brasero_job_start_progress (BRASERO_JOB (self), FALSE);
-	brasero_job_get_current_track (BRASERO_JOB (self), &track);
 
 	/* see if another plugin is sending us data to checksum
 	 * or if we do it ourself (and then that must be from an
@@ -400,7 +865,28 @@ brasero_checksum_image_create_checksum (BraseroChecksumImage *self,
 		/* That's the only way to get the sector size */
 		priv->total *= bytes / sectors;
 
-		return brasero_checksum_image_checksum_fd_input (self, checksum_type, error);
+		result = brasero_checksum_image_checksum_fd_input (self, checksum_type, error);
+		if (result == BRASERO_BURN_OK && priv->tree) {
+			BraseroDeviceHandle *dev_handle;
+
+			brasero_checksum_tree_finish (priv->tree);
+			dev_handle = brasero_device_handle_open (brasero_drive_get_device (drive), FALSE, NULL);
+			if (dev_handle) {
+				BraseroVolSrc *vol;
+
+				vol = brasero_volume_source_open_device_handle (dev_handle, NULL);
+				if (vol) {
+					brasero_checksum_image_get_damaged_files (self,
+										  vol,
+										  start,
+										  brasero_checksum_tree_get_damaged (priv->tree));
+					brasero_volume_source_close (vol);
+				}
+				brasero_device_handle_close (dev_handle);
+			}
+		}
+
+		return result;
 	}
 	else {
 		result = brasero_track_get_size (track,
@@ -446,6 +932,8 @@ brasero_checksum_image_image_and_checksum (BraseroChecksumImage *self,
 		checksum_type = G_CHECKSUM_SHA1;
 	else if (priv->checksum_type & BRASERO_CHECKSUM_SHA256)
 		checksum_type = G_CHECKSUM_SHA256;
+	else if (priv->checksum_type & BRASERO_CHECKSUM_SHA256_TREE)
+		checksum_type = G_CHECKSUM_SHA256;
 	else {
 		checksum_type = G_CHECKSUM_MD5;
 		priv->checksum_type = BRASERO_CHECKSUM_MD5;
@@ -486,11 +974,36 @@ struct _BraseroChecksumImageThreadCtx {
 };
 typedef struct _BraseroChecksumImageThreadCtx BraseroChecksumImageThreadCtx;
 
+/* The tree is saved next to the image; there is none when the data is
+ * piped to the recorder */
+static gchar *
+brasero_checksum_image_get_tree_path (BraseroChecksumImage *self,
+				      BraseroTrack *track)
+{
+	gchar *image = NULL;
+	gchar *path;
+
+	if (brasero_job_get_fd_in (BRASERO_JOB (self), NULL) == BRASERO_BURN_OK) {
+		if (brasero_job_get_image_output (BRASERO_JOB (self), &image, NULL) != BRASERO_BURN_OK)
+			return NULL;
+	}
+	else if (BRASERO_IS_TRACK_IMAGE (track))
+		image = brasero_track_image_get_source (BRASERO_TRACK_IMAGE (track), FALSE);
+
+	if (!image)
+		return NULL;
+
+	path = g_strdup_printf ("%s.tree", image);
+	g_free (image);
+	return path;
+}
+
 static gboolean
 brasero_checksum_image_end (gpointer data)
 {
 	BraseroChecksumImage *self;
 	BraseroTrack *track;
+	GError *error = NULL;
 	const gchar *checksum;
 	BraseroBurnResult result;
 	BraseroChecksumImagePrivate *priv;
@@ -503,27 +1016,62 @@ brasero_checksum_image_end (gpointer data)
 	/* NOTE ctx/data is destroyed in its own callback */
 	priv->end_id = 0;
 
-	if (ctx->result != BRASERO_BURN_OK) {
-		GError *error;
+	/* we were asked to check the sum of the track so get the type
+	 * of the checksum first to see what to do */
+	track = NULL;
+	brasero_job_get_current_track (BRASERO_JOB (self), &track);
 
+	if (ctx->result != BRASERO_BURN_OK) {
 		error = ctx->error;
 		ctx->error = NULL;
 
-		g_checksum_free (priv->checksum);
-		priv->checksum = NULL;
+		if (priv->checksum) {
+			g_checksum_free (priv->checksum);
+			priv->checksum = NULL;
+		}
+
+		/* A sampled check reports the damaged files itself */
+		brasero_checksum_image_set_damaged_files_tag (self, track);
+		brasero_checksum_image_clean_tree (self);
 
 		brasero_job_error (BRASERO_JOB (self), error);
 		return FALSE;
 	}
 
-	/* we were asked to check the sum of the track so get the type
-	 * of the checksum first to see what to do */
-	track = NULL;
-	brasero_job_get_current_track (BRASERO_JOB (self), &track);
+	/* A sampled check has nothing to set */
+	if (priv->checksum_type == BRASERO_CHECKSUM_SHA256_TREE_SAMPLED) {
+		brasero_checksum_image_clean_tree (self);
+		brasero_job_finished_track (BRASERO_JOB (self));
+		return FALSE;
+	}
 
 	/* Set the checksum for the track and at the same time compare it to a
-	 * potential previous one. */
-	checksum = g_checksum_get_string (priv->checksum);
+	 * potential previous one. For a tree the checksum is its root. */
+	if (priv->tree) {
+		BraseroJobAction action;
+
+		checksum = brasero_checksum_tree_finish (priv->tree);
+
+		/* Keep the whole tree to check the disc against it later */
+		brasero_job_get_action (BRASERO_JOB (self), &action);
+		if (action == BRASERO_JOB_ACTION_IMAGE) {
+			gchar *path;
+
+			path = brasero_checksum_image_get_tree_path (self, track);
+			if (!brasero_checksum_tree_save (priv->tree, path, &error)) {
+				BRASERO_JOB_LOG (self, "Checksum tree could not be saved (%s)", error->message);
+				g_error_free (error);
+			}
+			else if (path)
+				brasero_track_tag_add_string (track,
+							      BRASERO_TRACK_CHECKSUM_TREE_TAG,
+							      path);
+			g_free (path);
+		}
+	}
+	else
+		checksum = g_checksum_get_string (priv->checksum);
+
 	BRASERO_JOB_LOG (self,
 			 "Setting new checksum (type = %i) %s (%s before)",
 			 priv->checksum_type,
@@ -532,18 +1080,24 @@ brasero_checksum_image_end (gpointer data)
 	result = brasero_track_set_checksum (track,
 					     priv->checksum_type,
 					     checksum);
-	g_checksum_free (priv->checksum);
-	priv->checksum = NULL;
+
+	if (priv->checksum) {
+		g_checksum_free (priv->checksum);
+		priv->checksum = NULL;
+	}
 
 	if (result != BRASERO_BURN_OK)
 		goto error;
 
+	brasero_checksum_image_clean_tree (self);
 	brasero_job_finished_track (BRASERO_JOB (self));
 	return FALSE;
 
 error:
-{
-	GError *error = NULL;
+
+	/* Tell which files are damaged when we know it */
+	brasero_checksum_image_set_damaged_files_tag (self, track);
+	brasero_checksum_image_clean_tree (self);
 
 	error = g_error_new (BRASERO_BURN_ERROR,
 			     BRASERO_BURN_ERROR_BAD_CHECKSUM,
@@ -551,7 +1105,6 @@ error:
 	brasero_job_error (BRASERO_JOB (self), error);
 	return FALSE;
 }
-}
 
 static void
 brasero_checksum_image_destroy (gpointer data)
@@ -587,7 +1140,9 @@ brasero_checksum_image_thread (gpointer data)
 
 	if (action == BRASERO_JOB_ACTION_CHECKSUM) {
 		priv->checksum_type = brasero_track_get_checksum_type (track);
-		if (priv->checksum_type & (BRASERO_CHECKSUM_MD5|BRASERO_CHECKSUM_SHA1|BRASERO_CHECKSUM_SHA256))
+		if (priv->checksum_type & BRASERO_CHECKSUM_SHA256_TREE_SAMPLED)
+			result = brasero_checksum_image_sample (self, &error);
+		else if (priv->checksum_type & (BRASERO_CHECKSUM_MD5|BRASERO_CHECKSUM_SHA1|BRASERO_CHECKSUM_SHA256|BRASERO_CHECKSUM_SHA256_TREE))
 			result = brasero_checksum_image_create_checksum (self, &error);
 		else
 			result = BRASERO_BURN_ERR;
@@ -706,7 +1261,7 @@ brasero_checksum_image_clock_tick (BraseroJob *job)
 
 	priv = BRASERO_CHECKSUM_IMAGE_PRIVATE (job);
 
-	if (!priv->checksum)
+	if (!priv->checksum && !priv->tree && !priv->expected)
 		return BRASERO_BURN_OK;
 
 	if (!priv->total)
@@ -747,6 +1302,8 @@ brasero_checksum_image_stop (BraseroJob *job,
 		priv->checksum = NULL;
 	}
 
+	brasero_checksum_image_clean_tree (BRASERO_CHECKSUM_IMAGE (job));
+
 	return BRASERO_BURN_OK;
 }
 
@@ -787,6 +1344,8 @@ brasero_checksum_image_finalize (GObject *object)
 		priv->checksum = NULL;
 	}
 
+	brasero_checksum_image_clean_tree (BRASERO_CHECKSUM_IMAGE (object));
+
 	if (priv->mutex) {
 		g_mutex_free (priv->mutex);
 		priv->mutex = NULL;
@@ -847,7 +1406,26 @@ brasero_checksum_image_export_caps (BraseroPlugin *plugin)
 	brasero_plugin_check_caps (plugin,
 				   BRASERO_CHECKSUM_MD5|
 				   BRASERO_CHECKSUM_SHA1|
-				   BRASERO_CHECKSUM_SHA256,
+				   BRASERO_CHECKSUM_SHA256|
+				   BRASERO_CHECKSUM_SHA256_TREE,
+				   input);
+	g_slist_free (input);
+
+	/* Sampled checks read the few ranges they need straight from the disc */
+	input = brasero_caps_disc_new (BRASERO_MEDIUM_CD|
+				       BRASERO_MEDIUM_DVD|
+				       BRASERO_MEDIUM_BD|
+				       BRASERO_MEDIUM_DUAL_L|
+				       BRASERO_MEDIUM_PLUS|
+				       BRASERO_MEDIUM_RESTRICTED|
+				       BRASERO_MEDIUM_SEQUENTIAL|
+				       BRASERO_MEDIUM_WRITABLE|
+				       BRASERO_MEDIUM_REWRITABLE|
+				       BRASERO_MEDIUM_CLOSED|
+				       BRASERO_MEDIUM_APPENDABLE|
+				       BRASERO_MEDIUM_HAS_DATA);
+	brasero_plugin_check_caps (plugin,
+				   BRASERO_CHECKSUM_SHA256_TREE_SAMPLED,
 				   input);
 	g_slist_free (input);
 
@@ -861,6 +1439,8 @@ brasero_checksum_image_export_caps (BraseroPlugin *plugin)
 					       _("SHA1"), BRASERO_CHECKSUM_SHA1);
 	brasero_plugin_conf_option_choice_add (checksum_type,
 					       _("SHA256"), BRASERO_CHECKSUM_SHA256);
+	brasero_plugin_conf_option_choice_add (checksum_type,
+					       _("SHA256 block tree"), BRASERO_CHECKSUM_SHA256_TREE);
 
 	brasero_plugin_add_conf_option (plugin, checksum_type);
 
@@ -0,0 +1,553 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "brasero-lru-cache.h"
+
+#include "burn-basics.h"
+#include "burn-debug.h"
+#include "burn-checksum-tree.h"
+
+#define BRASERO_CHECKSUM_TREE_VERSION		1
+#define BRASERO_CHECKSUM_TREE_DIGEST_LEN	32
+
+/* Maximum number of trees kept in the cache directory; a tree for a full
+ * BD is about 1.5 MiB */
+#define BRASERO_CHECKSUM_TREE_MAX_TREES		32
+
+G_LOCK_DEFINE_STATIC (trees);
+
+struct _BraseroChecksumTree {
+	GChecksum *leaf;
+	gsize leaf_bytes;
+
+	/* Binary SHA256 digests of all the leaves one after the other */
+	GByteArray *leaves;
+	goffset size;
+
+	gchar *root;
+
+	/* The tree that this one is checked against as data is added and the
+	 * indexes of the leaves which do not match */
+	BraseroChecksumTree *expected;
+	GSList *damaged;
+};
+
+#define BRASERO_CHECKSUM_TREE_LEAVES_NUM(tree)	((tree)->leaves->len / BRASERO_CHECKSUM_TREE_DIGEST_LEN)
+
+BraseroChecksumTree *
+brasero_checksum_tree_new (BraseroChecksumTree *expected)
+{
+	BraseroChecksumTree *tree;
+
+	tree = g_new0 (BraseroChecksumTree, 1);
+	tree->leaf = g_checksum_new (G_CHECKSUM_SHA256);
+	tree->leaves = g_byte_array_new ();
+	tree->expected = expected;
+	return tree;
+}
+
+void
+brasero_checksum_tree_free (BraseroChecksumTree *tree)
+{
+	if (tree->leaf)
+		g_checksum_free (tree->leaf);
+
+	g_byte_array_free (tree->leaves, TRUE);
+	g_slist_free (tree->damaged);
+	g_free (tree->root);
+	g_free (tree);
+}
+
+static void
+brasero_checksum_tree_add_leaf (BraseroChecksumTree *tree)
+{
+	guint8 digest [BRASERO_CHECKSUM_TREE_DIGEST_LEN];
+	gsize len = sizeof (digest);
+	guint num;
+
+	g_checksum_get_digest (tree->leaf, digest, &len);
+	g_checksum_reset (tree->leaf);
+	tree->leaf_bytes = 0;
+
+	num = BRASERO_CHECKSUM_TREE_LEAVES_NUM (tree);
+	g_byte_array_append (tree->leaves, digest, sizeof (digest));
+
+	/* Check the leaf right away so that we know where the track is damaged
+	 * even if the rest of it cannot be read */
+	if (!tree->expected)
+		return;
+
+	if (num >= BRASERO_CHECKSUM_TREE_LEAVES_NUM (tree->expected)
+	||  memcmp (tree->expected->leaves->data + num * sizeof (digest), digest, sizeof (digest))) {
+		BRASERO_BURN_LOG ("Checksum mismatch for sectors %lli to %lli",
+				  (gint64) num * BRASERO_CHECKSUM_TREE_SECTORS,
+				  (gint64) (num + 1) * BRASERO_CHECKSUM_TREE_SECTORS - 1);
+		tree->damaged = g_slist_prepend (tree->damaged, GUINT_TO_POINTER (num));
+	}
+}
+
+void
+brasero_checksum_tree_update (BraseroChecksumTree *tree,
+			      const guchar *buffer,
+			      gsize size)
+{
+	if (tree->expected) {
+		/* Whatever is read past the end of the original track is only
+		 * padding added by the drive; it must not be hashed. */
+		if (tree->size >= tree->expected->size)
+			return;
+
+		size = MIN (size, tree->expected->size - tree->size);
+	}
+
+	tree->size += size;
+	while (size) {
+		gsize len;
+
+		len = MIN (size, BRASERO_CHECKSUM_TREE_BLOCK_SIZE - tree->leaf_bytes);
+		g_checksum_update (tree->leaf, buffer, len);
+		tree->leaf_bytes += len;
+		buffer += len;
+		size -= len;
+
+		if (tree->leaf_bytes == BRASERO_CHECKSUM_TREE_BLOCK_SIZE)
+			brasero_checksum_tree_add_leaf (tree);
+	}
+}
+
+static gchar *
+brasero_checksum_tree_to_hex (const guint8 *data,
+			      gsize len)
+{
+	static const gchar hex [] = "0123456789abcdef";
+	gchar *string;
+	gsize i;
+
+	string = g_new (gchar, len * 2 + 1);
+	for (i = 0; i < len; i ++) {
+		string [i * 2] = hex [data [i] >> 4];
+		string [i * 2 + 1] = hex [data [i] & 0x0F];
+	}
+	string [len * 2] = '\0';
+	return string;
+}
+
+static gboolean
+brasero_checksum_tree_from_hex (const gchar *string,
+				GByteArray *array)
+{
+	gsize len;
+	gsize i;
+
+	len = strlen (string);
+	if (len % (BRASERO_CHECKSUM_TREE_DIGEST_LEN * 2))
+		return FALSE;
+
+	for (i = 0; i < len; i += 2) {
+		gint high, low;
+		guint8 byte;
+
+		high = g_ascii_xdigit_value (string [i]);
+		low = g_ascii_xdigit_value (string [i + 1]);
+		if (high < 0 || low < 0)
+			return FALSE;
+
+		byte = (high << 4) | low;
+		g_byte_array_append (array, &byte, 1);
+	}
+
+	return TRUE;
+}
+
+/**
+ * Returns the root of the tree as an hexadecimal string. The root is obtained
+ * by hashing the leaves two by two until only one digest remains.
+ */
+
+const gchar *
+brasero_checksum_tree_finish (BraseroChecksumTree *tree)
+{
+	GByteArray *level;
+
+	if (tree->root)
+		return tree->root;
+
+	if (tree->leaf_bytes)
+		brasero_checksum_tree_add_leaf (tree);
+
+	g_checksum_free (tree->leaf);
+	tree->leaf = NULL;
+
+	/* The track was shorter than expected: all missing leaves are damaged */
+	if (tree->expected) {
+		guint num;
+
+		for (num = BRASERO_CHECKSUM_TREE_LEAVES_NUM (tree);
+		     num < BRASERO_CHECKSUM_TREE_LEAVES_NUM (tree->expected);
+		     num ++)
+			tree->damaged = g_slist_prepend (tree->damaged, GUINT_TO_POINTER (num));
+
+		tree->damaged = g_slist_reverse (tree->damaged);
+	}
+
+	level = g_byte_array_sized_new (tree->leaves->len);
+	g_byte_array_append (level, tree->leaves->data, tree->leaves->len);
+
+	while (level->len > BRASERO_CHECKSUM_TREE_DIGEST_LEN) {
+		GByteArray *parent;
+		guint i;
+
+		parent = g_byte_array_sized_new (level->len / 2 + BRASERO_CHECKSUM_TREE_DIGEST_LEN);
+		for (i = 0; i < level->len; i += BRASERO_CHECKSUM_TREE_DIGEST_LEN * 2) {
+			guint8 digest [BRASERO_CHECKSUM_TREE_DIGEST_LEN];
+			gsize len = sizeof (digest);
+			GChecksum *checksum;
+
+			/* An odd node is moved up as it is */
+			if (i + BRASERO_CHECKSUM_TREE_DIGEST_LEN >= level->len) {
+				g_byte_array_append (parent, level->data + i, BRASERO_CHECKSUM_TREE_DIGEST_LEN);
+				break;
+			}
+
+			checksum = g_checksum_new (G_CHECKSUM_SHA256);
+			g_checksum_update (checksum, level->data + i, BRASERO_CHECKSUM_TREE_DIGEST_LEN * 2);
+			g_checksum_get_digest (checksum, digest, &len);
+			g_checksum_free (checksum);
+
+			g_byte_array_append (parent, digest, sizeof (digest));
+		}
+
+		g_byte_array_free (level, TRUE);
+		level = parent;
+	}
+
+	if (level->len)
+		tree->root = brasero_checksum_tree_to_hex (level->data, level->len);
+	else
+		tree->root = g_compute_checksum_for_data (G_CHECKSUM_SHA256, (const guchar *) "", 0);
+
+	g_byte_array_free (level, TRUE);
+	return tree->root;
+}
+
+/**
+ * Returns the indexes of the leaves which did not match the expected tree (to
+ * be used with GPOINTER_TO_UINT ()). The list belongs to the tree.
+ */
+
+GSList *
+brasero_checksum_tree_get_damaged (BraseroChecksumTree *tree)
+{
+	return tree->damaged;
+}
+
+guint
+brasero_checksum_tree_get_leaves_num (BraseroChecksumTree *tree)
+{
+	return BRASERO_CHECKSUM_TREE_LEAVES_NUM (tree);
+}
+
+goffset
+brasero_checksum_tree_get_size (BraseroChecksumTree *tree)
+{
+	return tree->size;
+}
+
+/**
+ * Checks a single leaf against the SHA256 of the range it covers, which allows
+ * to verify a track without reading it entirely.
+ */
+
+gboolean
+brasero_checksum_tree_leaf_matches (BraseroChecksumTree *tree,
+				    guint num,
+				    GChecksum *checksum)
+{
+	guint8 digest [BRASERO_CHECKSUM_TREE_DIGEST_LEN];
+	gsize len = sizeof (digest);
+
+	if (num >= BRASERO_CHECKSUM_TREE_LEAVES_NUM (tree))
+		return FALSE;
+
+	g_checksum_get_digest (checksum, digest, &len);
+	return (memcmp (tree->leaves->data + num * sizeof (digest), digest, sizeof (digest)) == 0);
+}
+
+static gchar *
+brasero_checksum_tree_get_dir (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "brasero",
+				 "checksums",
+				 NULL);
+}
+
+static gchar *
+brasero_checksum_tree_get_path (const gchar *root)
+{
+	gchar *directory;
+	gchar *name;
+	gchar *path;
+
+	name = g_strdup_printf ("%s.tree", root);
+	directory = brasero_checksum_tree_get_dir ();
+	path = g_build_filename (directory, name, NULL);
+	g_free (directory);
+	g_free (name);
+	return path;
+}
+
+/**
+ * An index of the saved trees records when each was last used so that
+ * only the most recent ones are kept.
+ */
+
+static void
+brasero_checksum_tree_removed_cb (GKeyFile *key_file,
+				  const gchar *root,
+				  gpointer user_data)
+{
+	gchar *path;
+
+	path = brasero_checksum_tree_get_path (root);
+	BRASERO_BURN_LOG ("Removing checksum tree %s", path);
+	g_remove (path);
+	g_free (path);
+}
+
+static void
+brasero_checksum_tree_index_touch (const gchar *root)
+{
+	GError *error = NULL;
+	GKeyFile *key_file;
+	gchar *directory;
+	gchar *path;
+
+	G_LOCK (trees);
+
+	directory = brasero_checksum_tree_get_dir ();
+	path = g_build_filename (directory, "index", NULL);
+
+	key_file = brasero_lru_cache_load (path, 0);
+	brasero_lru_cache_touch (key_file, root);
+	brasero_lru_cache_prune (key_file,
+				 BRASERO_CHECKSUM_TREE_MAX_TREES,
+				 brasero_checksum_tree_removed_cb,
+				 NULL);
+
+	if (!brasero_lru_cache_save (key_file, path, 0, &error)) {
+		BRASERO_BURN_LOG ("Checksum tree index could not be written: %s", error->message);
+		g_error_free (error);
+	}
+
+	g_key_file_free (key_file);
+	g_free (directory);
+	g_free (path);
+
+	G_UNLOCK (trees);
+}
+
+static gboolean
+brasero_checksum_tree_write (BraseroChecksumTree *tree,
+			     const gchar *path,
+			     GError **error)
+{
+	GKeyFile *key_file;
+	gchar *contents;
+	gboolean result;
+	gchar *leaves;
+	gsize size;
+
+	leaves = brasero_checksum_tree_to_hex (tree->leaves->data, tree->leaves->len);
+
+	key_file = g_key_file_new ();
+	g_key_file_set_integer (key_file, "Tree", "version", BRASERO_CHECKSUM_TREE_VERSION);
+	g_key_file_set_integer (key_file, "Tree", "block-size", BRASERO_CHECKSUM_TREE_BLOCK_SIZE);
+	g_key_file_set_string (key_file, "Tree", "root", tree->root);
+	g_key_file_set_int64 (key_file, "Tree", "size", tree->size);
+	g_key_file_set_string (key_file, "Tree", "leaves", leaves);
+	g_free (leaves);
+
+	contents = g_key_file_to_data (key_file, &size, NULL);
+	g_key_file_free (key_file);
+
+	result = g_file_set_contents (path, contents, size, error);
+	if (result)
+		BRASERO_BURN_LOG ("Checksum tree saved to %s", path);
+
+	g_free (contents);
+	return result;
+}
+
+/**
+ * Trees are saved to @path, usually next to the image they were computed
+ * for, so that they live as long as the image. A copy is also kept in the
+ * cache directory, named after the root, for the check right after the
+ * burn or when there is no image file (@path is NULL). Only the most
+ * recently used copies are kept there.
+ */
+
+gboolean
+brasero_checksum_tree_save (BraseroChecksumTree *tree,
+			    const gchar *path,
+			    GError **error)
+{
+	GError *cache_error = NULL;
+	gboolean result = TRUE;
+	gchar *cache_path;
+	gchar *dir;
+
+	brasero_checksum_tree_finish (tree);
+
+	if (path && !brasero_checksum_tree_write (tree, path, error))
+		return FALSE;
+
+	cache_path = brasero_checksum_tree_get_path (tree->root);
+	dir = g_path_get_dirname (cache_path);
+	g_mkdir_with_parents (dir, S_IRWXU);
+	g_free (dir);
+
+	if (brasero_checksum_tree_write (tree, cache_path, path ? &cache_error : error))
+		brasero_checksum_tree_index_touch (tree->root);
+	else if (path) {
+		/* The tree itself was saved; the cache is only a convenience */
+		BRASERO_BURN_LOG ("Checksum tree could not be cached: %s", cache_error->message);
+		g_error_free (cache_error);
+	}
+	else
+		result = FALSE;
+
+	g_free (cache_path);
+	return result;
+}
+
+/* If @root is NULL the tree must record its root or be named after it */
+static BraseroChecksumTree *
+brasero_checksum_tree_load_file (const gchar *path,
+				 const gchar *root)
+{
+	BraseroChecksumTree *tree;
+	GKeyFile *key_file;
+	gchar *name = NULL;
+	gchar *leaves;
+
+	key_file = g_key_file_new ();
+	if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, NULL)) {
+		BRASERO_BURN_LOG ("No checksum tree found in %s", path);
+		g_key_file_free (key_file);
+		return NULL;
+	}
+
+	if (g_key_file_get_integer (key_file, "Tree", "version", NULL) != BRASERO_CHECKSUM_TREE_VERSION
+	||  g_key_file_get_integer (key_file, "Tree", "block-size", NULL) != BRASERO_CHECKSUM_TREE_BLOCK_SIZE) {
+		g_key_file_free (key_file);
+		return NULL;
+	}
+
+	if (!root) {
+		name = g_key_file_get_string (key_file, "Tree", "root", NULL);
+		if (!name) {
+			name = g_path_get_basename (path);
+			if (g_str_has_suffix (name, ".tree"))
+				name [strlen (name) - strlen (".tree")] = '\0';
+		}
+		root = name;
+	}
+
+	tree = brasero_checksum_tree_new (NULL);
+	tree->size = g_key_file_get_int64 (key_file, "Tree", "size", NULL);
+
+	leaves = g_key_file_get_string (key_file, "Tree", "leaves", NULL);
+	g_key_file_free (key_file);
+
+	if (!leaves || !brasero_checksum_tree_from_hex (leaves, tree->leaves)) {
+		brasero_checksum_tree_free (tree);
+		g_free (leaves);
+		g_free (name);
+		return NULL;
+	}
+	g_free (leaves);
+
+	/* Make sure the leaves are those of the tree we were asked for */
+	if (strcmp (brasero_checksum_tree_finish (tree), root)) {
+		BRASERO_BURN_LOG ("Corrupted checksum tree in %s", path);
+		brasero_checksum_tree_free (tree);
+		g_free (name);
+		return NULL;
+	}
+
+	g_free (name);
+	return tree;
+}
+
+/**
+ * Looks for the tree whose root is @root first in @path (which can be NULL)
+ * then in the cache. @root can also be the path of a tree file; the file
+ * must then record its root or be named after it.
+ */
+
+BraseroChecksumTree *
+brasero_checksum_tree_load (const gchar *root,
+			    const gchar *path)
+{
+	BraseroChecksumTree *tree;
+	gchar *cache_path;
+
+	if (!root)
+		return NULL;
+
+	if (g_path_is_absolute (root))
+		return brasero_checksum_tree_load_file (root, NULL);
+
+	if (path) {
+		tree = brasero_checksum_tree_load_file (path, root);
+		if (tree)
+			return tree;
+	}
+
+	cache_path = brasero_checksum_tree_get_path (root);
+	tree = brasero_checksum_tree_load_file (cache_path, root);
+	g_free (cache_path);
+
+	if (tree)
+		brasero_checksum_tree_index_touch (root);
+
+	return tree;
+}
@@ -0,0 +1,83 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ * 
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _BURN_CHECKSUM_TREE_H
+#define _BURN_CHECKSUM_TREE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Each leaf of the tree is the SHA256 of 512 sectors (1 MiB) of the track */
+#define BRASERO_CHECKSUM_TREE_SECTORS		512
+#define BRASERO_CHECKSUM_TREE_BLOCK_SIZE	(BRASERO_CHECKSUM_TREE_SECTORS * 2048)
+
+typedef struct _BraseroChecksumTree BraseroChecksumTree;
+
+BraseroChecksumTree *
+brasero_checksum_tree_new (BraseroChecksumTree *expected);
+
+void
+brasero_checksum_tree_free (BraseroChecksumTree *tree);
+
+void
+brasero_checksum_tree_update (BraseroChecksumTree *tree,
+			      const guchar *buffer,
+			      gsize size);
+
+const gchar *
+brasero_checksum_tree_finish (BraseroChecksumTree *tree);
+
+GSList *
+brasero_checksum_tree_get_damaged (BraseroChecksumTree *tree);
+
+guint
+brasero_checksum_tree_get_leaves_num (BraseroChecksumTree *tree);
+
+goffset
+brasero_checksum_tree_get_size (BraseroChecksumTree *tree);
+
+gboolean
+brasero_checksum_tree_leaf_matches (BraseroChecksumTree *tree,
+				    guint num,
+				    GChecksum *checksum);
+
+gboolean
+brasero_checksum_tree_save (BraseroChecksumTree *tree,
+			    const gchar *path,
+			    GError **error);
+
+BraseroChecksumTree *
+brasero_checksum_tree_load (const gchar *root,
+			    const gchar *path);
+
+G_END_DECLS
+
+#endif /* _BURN_CHECKSUM_TREE_H */
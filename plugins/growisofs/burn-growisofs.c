@@ -83,6 +83,7 @@ brasero_growisofs_read_stdout (BraseroProcess *process, const gchar *line)
 {
 	int perc_1, perc_2;
 	int speed_1, speed_2;
+	const gchar *levels;
 	long long b_written, b_total;
 
 	/* Newer growisofs version have a different line pattern that shows
@@ -103,6 +104,15 @@ brasero_growisofs_read_stdout (BraseroProcess *process, const gchar *line)
 		brasero_job_set_written_session (BRASERO_JOB (process), b_written);
 		brasero_job_set_rate (BRASERO_JOB (process), (gdouble) (speed_1 * 10 + speed_2) / 10.0 * (gdouble) DVD_RATE);
 
+		/* Ring buffer (our FIFO) and drive buffer (unit) levels */
+		levels = strstr (line, "RBU");
+		if (levels) {
+			int rbu, ubu;
+
+			if (sscanf (levels, "RBU %d.%*d%% UBU %d.%*d%%", &rbu, &ubu) == 2)
+				brasero_job_set_buffer_levels (BRASERO_JOB (process), rbu, ubu);
+		}
+
 		if (action == BRASERO_JOB_ACTION_ERASE) {
 			brasero_job_set_current_action (BRASERO_JOB (process),
 							BRASERO_BURN_ACTION_BLANKING,
@@ -0,0 +1,1813 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ *
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <glib/gi18n-lib.h>
+
+#include "brasero-error.h"
+#include "burn-debug.h"
+#include "burn-iso-layout.h"
+
+/**
+ * This lays out an ISO9660 (level 2) volume with Rock Ridge extensions and an
+ * optional Joliet tree, then generates all its metadata sectors. Everything
+ * about the volume (including its exact size) is known once the layout is
+ * done so the file contents can be streamed afterwards in extent order.
+ *
+ * Volume layout:
+ * - system area (16 sectors)
+ * - primary volume descriptor, Joliet supplementary descriptor, terminator
+ * - ISO9660 L and M path tables, then the Joliet ones
+ * - ISO9660 directories (breadth first), each followed by the continuation
+ *   area holding the SUSP entries that didn't fit in the directory records
+ * - Joliet directories (breadth first)
+ * - file data (depth first)
+ */
+
+#define BRASERO_ISO_SYSTEM_AREA		16
+#define BRASERO_ISO_MAX_RECORD		255
+#define BRASERO_ISO_FILE_NAME_MAX	30
+#define BRASERO_ISO_DIR_NAME_MAX	31
+#define BRASERO_ISO_EXT_MAX		8
+#define BRASERO_JOLIET_NAME_MAX		64
+
+#define BRASERO_ISO_SECTORS(bytes)	(((bytes) + BRASERO_ISO_BLOCK_SIZE - 1) / BRASERO_ISO_BLOCK_SIZE)
+#define BRASERO_ISO_ROUND(bytes)	(BRASERO_ISO_SECTORS (bytes) * BRASERO_ISO_BLOCK_SIZE)
+
+/* Rock Ridge "RR" flags */
+#define BRASERO_RR_PX			0x01
+#define BRASERO_RR_SL			0x04
+#define BRASERO_RR_NM			0x08
+#define BRASERO_RR_TF			0x80
+
+/* SUSP entries sizes */
+#define BRASERO_SUSP_CE_SIZE		28
+#define BRASERO_SUSP_MAX_DATA		(BRASERO_ISO_MAX_RECORD - 5)
+
+#define BRASERO_RRIP_ID		"RRIP_1991A"
+#define BRASERO_RRIP_DESCRIPTOR	"THE ROCK RIDGE INTERCHANGE PROTOCOL PROVIDES SUPPORT FOR POSIX FILE SYSTEM SEMANTICS"
+#define BRASERO_RRIP_SOURCE	"PLEASE CONTACT DISC PUBLISHER FOR SPECIFICATION SOURCE.  SEE PUBLISHER IDENTIFIER IN PRIMARY VOLUME DESCRIPTOR FOR CONTACT INFORMATION."
+
+typedef enum {
+	BRASERO_ISO_RECORD_SELF,
+	BRASERO_ISO_RECORD_PARENT,
+	BRASERO_ISO_RECORD_CHILD
+} BraseroIsoRecordType;
+
+/* Scratch space for the SUSP entries of one directory record */
+typedef struct _BraseroIsoSUSP BraseroIsoSUSP;
+struct _BraseroIsoSUSP {
+	GByteArray *data;
+	GArray *ends;
+};
+
+static void
+brasero_iso_set_721 (guchar *buffer, guint16 value)
+{
+	buffer [0] = value & 0xFF;
+	buffer [1] = (value >> 8) & 0xFF;
+}
+
+static void
+brasero_iso_set_722 (guchar *buffer, guint16 value)
+{
+	buffer [0] = (value >> 8) & 0xFF;
+	buffer [1] = value & 0xFF;
+}
+
+static void
+brasero_iso_set_723 (guchar *buffer, guint16 value)
+{
+	brasero_iso_set_721 (buffer, value);
+	brasero_iso_set_722 (buffer + 2, value);
+}
+
+static void
+brasero_iso_set_731 (guchar *buffer, guint32 value)
+{
+	buffer [0] = value & 0xFF;
+	buffer [1] = (value >> 8) & 0xFF;
+	buffer [2] = (value >> 16) & 0xFF;
+	buffer [3] = (value >> 24) & 0xFF;
+}
+
+static void
+brasero_iso_set_732 (guchar *buffer, guint32 value)
+{
+	buffer [0] = (value >> 24) & 0xFF;
+	buffer [1] = (value >> 16) & 0xFF;
+	buffer [2] = (value >> 8) & 0xFF;
+	buffer [3] = value & 0xFF;
+}
+
+static void
+brasero_iso_set_733 (guchar *buffer, guint32 value)
+{
+	brasero_iso_set_731 (buffer, value);
+	brasero_iso_set_732 (buffer + 4, value);
+}
+
+static void
+brasero_iso_set_date_7 (guchar *buffer, gint64 value)
+{
+	time_t time_value = value;
+	struct tm tm;
+
+	gmtime_r (&time_value, &tm);
+	buffer [0] = CLAMP (tm.tm_year, 0, 255);
+	buffer [1] = tm.tm_mon + 1;
+	buffer [2] = tm.tm_mday;
+	buffer [3] = tm.tm_hour;
+	buffer [4] = tm.tm_min;
+	buffer [5] = tm.tm_sec;
+	buffer [6] = 0;
+}
+
+static void
+brasero_iso_set_date_17 (guchar *buffer, gint64 value)
+{
+	time_t time_value = value;
+	gchar date [32];
+	struct tm tm;
+
+	if (value <= 0) {
+		memset (buffer, '0', 16);
+		buffer [16] = 0;
+		return;
+	}
+
+	gmtime_r (&time_value, &tm);
+	g_snprintf (date, sizeof (date),
+		    "%04i%02i%02i%02i%02i%02i00",
+		    CLAMP (tm.tm_year + 1900, 0, 9999),
+		    tm.tm_mon + 1,
+		    tm.tm_mday,
+		    tm.tm_hour,
+		    tm.tm_min,
+		    tm.tm_sec);
+	memcpy (buffer, date, 16);
+	buffer [16] = 0;
+}
+
+static void
+brasero_iso_set_string (guchar *buffer,
+			guint size,
+			const gchar *string)
+{
+	const gchar *iter;
+
+	memset (buffer, ' ', size);
+	if (!string)
+		return;
+
+	/* Don't cut a UTF-8 character in its middle */
+	for (iter = string; *iter; iter = g_utf8_next_char (iter)) {
+		if ((guint) (g_utf8_next_char (iter) - string) > size)
+			break;
+	}
+	memcpy (buffer, string, iter - string);
+}
+
+static void
+brasero_iso_set_joliet_string (guchar *buffer,
+			       guint size,
+			       const gchar *string)
+{
+	gunichar2 *utf16;
+	glong items = 0;
+	guint i;
+
+	for (i = 0; i + 1 < size; i += 2) {
+		buffer [i] = 0;
+		buffer [i + 1] = ' ';
+	}
+
+	if (!string)
+		return;
+
+	utf16 = g_utf8_to_utf16 (string, -1, NULL, &items, NULL);
+	if (!utf16)
+		return;
+
+	for (i = 0; i < (guint) items && (i + 1) * 2 <= size; i ++)
+		brasero_iso_set_722 (buffer + i * 2, utf16 [i]);
+
+	g_free (utf16);
+}
+
+/**
+ * Nodes
+ */
+
+static BraseroIsoNode *
+brasero_iso_node_new (BraseroIsoNode *parent,
+		      const gchar *name,
+		      gboolean is_dir)
+{
+	BraseroIsoNode *node;
+
+	node = g_new0 (BraseroIsoNode, 1);
+	node->name = g_strdup (name);
+	node->parent = parent;
+	node->nlink = 1;
+
+	if (is_dir) {
+		node->is_dir = TRUE;
+		node->children = g_ptr_array_new ();
+		node->mode = S_IFDIR|0555;
+	}
+	else
+		node->mode = S_IFREG|0444;
+
+	if (parent)
+		g_ptr_array_add (parent->children, node);
+
+	return node;
+}
+
+static void
+brasero_iso_node_free (BraseroIsoNode *node)
+{
+	if (node->children) {
+		guint i;
+
+		for (i = 0; i < node->children->len; i ++)
+			brasero_iso_node_free (g_ptr_array_index (node->children, i));
+
+		g_ptr_array_free (node->children, TRUE);
+	}
+
+	if (node->joliet_children)
+		g_ptr_array_free (node->joliet_children, TRUE);
+
+	g_free (node->name);
+	g_free (node->iso_name);
+	g_free (node->joliet_name);
+	g_free (node->path);
+	g_free (node->target);
+	g_free (node);
+}
+
+static BraseroIsoNode *
+brasero_iso_node_get_child (BraseroIsoNode *dir,
+			    const gchar *name)
+{
+	guint i;
+
+	for (i = 0; i < dir->children->len; i ++) {
+		BraseroIsoNode *child;
+
+		child = g_ptr_array_index (dir->children, i);
+		if (!strcmp (child->name, name))
+			return child;
+	}
+
+	return NULL;
+}
+
+static void
+brasero_iso_node_remove (BraseroIsoNode *node)
+{
+	g_ptr_array_remove (node->parent->children, node);
+	brasero_iso_node_free (node);
+}
+
+/**
+ * Tree construction
+ */
+
+BraseroIsoTree *
+brasero_iso_tree_new (const gchar *volume_id,
+		      const gchar *publisher_id,
+		      const gchar *preparer_id,
+		      gboolean joliet)
+{
+	BraseroIsoTree *tree;
+
+	tree = g_new0 (BraseroIsoTree, 1);
+	tree->ctime = time (NULL);
+	tree->joliet = (joliet != FALSE);
+	tree->volume_id = g_strdup (volume_id);
+	tree->publisher_id = g_strdup (publisher_id);
+	tree->preparer_id = g_strdup (preparer_id);
+	tree->excluded = g_hash_table_new_full (g_str_hash,
+						g_str_equal,
+						g_free,
+						NULL);
+
+	tree->root = brasero_iso_node_new (NULL, "", TRUE);
+	tree->root->mtime = tree->ctime;
+
+	return tree;
+}
+
+void
+brasero_iso_tree_free (BraseroIsoTree *tree)
+{
+	if (tree->dirs)
+		g_ptr_array_free (tree->dirs, TRUE);
+	if (tree->joliet_dirs)
+		g_ptr_array_free (tree->joliet_dirs, TRUE);
+	if (tree->files)
+		g_ptr_array_free (tree->files, TRUE);
+
+	brasero_iso_node_free (tree->root);
+	g_hash_table_destroy (tree->excluded);
+
+	g_free (tree->volume_id);
+	g_free (tree->publisher_id);
+	g_free (tree->preparer_id);
+	g_free (tree);
+}
+
+void
+brasero_iso_tree_cancel (BraseroIsoTree *tree)
+{
+	g_atomic_int_set (&tree->cancel, 1);
+}
+
+void
+brasero_iso_tree_add_excluded (BraseroIsoTree *tree,
+			       const gchar *path)
+{
+	g_hash_table_insert (tree->excluded, g_strdup (path), GINT_TO_POINTER (1));
+}
+
+/* Same as mkisofs -r: files are owned by root, readable by everyone, and
+ * executable by everyone if they were executable by someone. */
+static guint32
+brasero_iso_rationalize_mode (guint32 mode)
+{
+	if (S_ISDIR (mode))
+		return S_IFDIR|0555;
+
+	if (S_ISLNK (mode))
+		return S_IFLNK|0777;
+
+	if (mode & 0111)
+		return S_IFREG|0555;
+
+	return S_IFREG|0444;
+}
+
+static gboolean
+brasero_iso_tree_add_local (BraseroIsoTree *tree,
+			    BraseroIsoNode *parent,
+			    const gchar *name,
+			    const gchar *path,
+			    GError **error)
+{
+	BraseroIsoNode *node;
+	struct stat info;
+
+	if (g_lstat (path, &info)) {
+		int errsv = errno;
+
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_FILE_NOT_FOUND,
+			     /* Translators: the first %s is the path of a
+			      * file and the second the error message */
+			     _("\"%s\" could not be read (%s)"),
+			     path,
+			     g_strerror (errsv));
+		return FALSE;
+	}
+
+	if (S_ISDIR (info.st_mode)) {
+		const gchar *child;
+		GDir *dir;
+
+		dir = g_dir_open (path, 0, error);
+		if (!dir)
+			return FALSE;
+
+		node = brasero_iso_node_new (parent, name, TRUE);
+		node->mtime = info.st_mtime;
+
+		while ((child = g_dir_read_name (dir))) {
+			gchar *child_path;
+			gboolean result;
+
+			if (g_atomic_int_get (&tree->cancel))
+				break;
+
+			child_path = g_build_filename (path, child, NULL);
+			if (g_hash_table_lookup (tree->excluded, child_path)) {
+				g_free (child_path);
+				continue;
+			}
+
+			result = brasero_iso_tree_add_local (tree,
+							     node,
+							     child,
+							     child_path,
+							     error);
+			g_free (child_path);
+
+			if (!result) {
+				g_dir_close (dir);
+				return FALSE;
+			}
+		}
+
+		g_dir_close (dir);
+		return TRUE;
+	}
+
+	if (S_ISLNK (info.st_mode)) {
+		gchar *target;
+
+		target = g_file_read_link (path, error);
+		if (!target)
+			return FALSE;
+
+		node = brasero_iso_node_new (parent, name, FALSE);
+		node->is_symlink = TRUE;
+		node->target = target;
+	}
+	else if (S_ISREG (info.st_mode)) {
+		/* Files need several extents above 4 GiB which is only
+		 * allowed with ISO9660 level 3 */
+		if ((guint64) info.st_size > G_MAXUINT32) {
+			g_set_error (error,
+				     BRASERO_BURN_ERROR,
+				     BRASERO_BURN_ERROR_GENERAL,
+				     _("\"%s\" is too big to be written without ISO9660 level 3"),
+				     path);
+			return FALSE;
+		}
+
+		node = brasero_iso_node_new (parent, name, FALSE);
+		node->path = g_strdup (path);
+		node->size = info.st_size;
+	}
+	else {
+		/* Devices, sockets and fifos have no contents we can read */
+		BRASERO_BURN_LOG ("Skipping special file %s", path);
+		return TRUE;
+	}
+
+	node->mode = brasero_iso_rationalize_mode (info.st_mode);
+	node->mtime = info.st_mtime;
+	return TRUE;
+}
+
+/**
+ * Grafts have to be added parents first. If path is NULL a directory that
+ * doesn't exist on the file system is created. An existing node with the
+ * same disc path is replaced.
+ */
+
+gboolean
+brasero_iso_tree_add_graft (BraseroIsoTree *tree,
+			    const gchar *disc_path,
+			    const gchar *path,
+			    GError **error)
+{
+	BraseroIsoNode *parent;
+	BraseroIsoNode *node;
+	gchar **components;
+	gchar *name = NULL;
+	gboolean result;
+	guint i;
+
+	components = g_strsplit (disc_path, G_DIR_SEPARATOR_S, -1);
+
+	parent = tree->root;
+	for (i = 0; components [i]; i ++) {
+		BraseroIsoNode *child;
+
+		if (!components [i][0])
+			continue;
+
+		if (name) {
+			child = brasero_iso_node_get_child (parent, name);
+			if (!child) {
+				child = brasero_iso_node_new (parent, name, TRUE);
+				child->mtime = tree->ctime;
+			}
+			else if (!child->is_dir) {
+				g_set_error (error,
+					     BRASERO_BURN_ERROR,
+					     BRASERO_BURN_ERROR_GENERAL,
+					     /* Translators: %s is the path */
+					     _("No parent could be found in the tree for the path \"%s\""),
+					     disc_path);
+				g_strfreev (components);
+				return FALSE;
+			}
+
+			parent = child;
+		}
+
+		name = components [i];
+	}
+
+	/* That's the root directory */
+	if (!name) {
+		g_strfreev (components);
+		return TRUE;
+	}
+
+	node = brasero_iso_node_get_child (parent, name);
+	if (node)
+		brasero_iso_node_remove (node);
+
+	if (path)
+		result = brasero_iso_tree_add_local (tree, parent, name, path, error);
+	else {
+		node = brasero_iso_node_new (parent, name, TRUE);
+		node->mtime = tree->ctime;
+		result = TRUE;
+	}
+
+	g_strfreev (components);
+	return result;
+}
+
+/**
+ * Names
+ */
+
+static void
+brasero_iso_append_d_chars (GString *string,
+			    const gchar *start,
+			    const gchar *end,
+			    guint max)
+{
+	const gchar *iter;
+
+	for (iter = start; iter < end && string->len < max; iter ++) {
+		guchar c = *iter;
+
+		if (c >= 0x80) {
+			/* A whole UTF-8 character becomes a single '_' */
+			while (iter + 1 < end && (((guchar) iter [1]) & 0xC0) == 0x80)
+				iter ++;
+
+			g_string_append_c (string, '_');
+		}
+		else if (c >= 'a' && c <= 'z')
+			g_string_append_c (string, c - 'a' + 'A');
+		else if ((c >= 'A' && c <= 'Z')
+		     ||  (c >= '0' && c <= '9')
+		     ||   c == '_')
+			g_string_append_c (string, c);
+		else
+			g_string_append_c (string, '_');
+	}
+}
+
+static void
+brasero_iso_name_split (const gchar *name,
+			gboolean is_dir,
+			GString *base,
+			GString *ext)
+{
+	const gchar *dot;
+	guint max;
+
+	dot = is_dir ? NULL:strrchr (name, '.');
+	if (!dot) {
+		max = is_dir ? BRASERO_ISO_DIR_NAME_MAX:BRASERO_ISO_FILE_NAME_MAX - 1;
+		brasero_iso_append_d_chars (base, name, name + strlen (name), max);
+		return;
+	}
+
+	brasero_iso_append_d_chars (ext, dot + 1, dot + strlen (dot), BRASERO_ISO_EXT_MAX);
+	max = BRASERO_ISO_FILE_NAME_MAX - 1 - ext->len;
+	brasero_iso_append_d_chars (base, name, dot, max);
+}
+
+static gchar *
+brasero_iso_name_build (BraseroIsoNode *node,
+			GString *base,
+			GString *ext,
+			guint number)
+{
+	gchar suffix [16] = { 0, };
+	guint base_len;
+	guint max;
+
+	if (number)
+		g_snprintf (suffix, sizeof (suffix), "%u", number);
+
+	if (node->is_dir)
+		max = BRASERO_ISO_DIR_NAME_MAX;
+	else
+		max = BRASERO_ISO_FILE_NAME_MAX - 1 - ext->len;
+
+	base_len = MIN (base->len, max - strlen (suffix));
+
+	if (node->is_dir)
+		return g_strdup_printf ("%.*s%s",
+					(gint) base_len,
+					base->str,
+					suffix);
+
+	/* Files always have the '.' separator, even without extension */
+	return g_strdup_printf ("%.*s%s.%s",
+				(gint) base_len,
+				base->str,
+				suffix,
+				ext->str);
+}
+
+static void
+brasero_iso_dir_set_iso_names (BraseroIsoNode *dir)
+{
+	GHashTable *names;
+	GString *base;
+	GString *ext;
+	guint i;
+
+	names = g_hash_table_new (g_str_hash, g_str_equal);
+	base = g_string_new (NULL);
+	ext = g_string_new (NULL);
+
+	for (i = 0; i < dir->children->len; i ++) {
+		BraseroIsoNode *child;
+		guint number = 0;
+
+		child = g_ptr_array_index (dir->children, i);
+
+		g_string_truncate (base, 0);
+		g_string_truncate (ext, 0);
+		brasero_iso_name_split (child->name, child->is_dir, base, ext);
+		if (!base->len && !ext->len)
+			g_string_append_c (base, '_');
+
+		g_free (child->iso_name);
+		child->iso_name = brasero_iso_name_build (child, base, ext, number);
+		while (g_hash_table_lookup (names, child->iso_name)) {
+			g_free (child->iso_name);
+			child->iso_name = brasero_iso_name_build (child, base, ext, ++ number);
+		}
+
+		g_hash_table_insert (names, child->iso_name, child);
+	}
+
+	g_hash_table_destroy (names);
+	g_string_free (base, TRUE);
+	g_string_free (ext, TRUE);
+}
+
+static gunichar2 *
+brasero_iso_joliet_name_build (BraseroIsoNode *node,
+			       guint number,
+			       guint *len)
+{
+	gunichar2 *utf16;
+	gunichar2 *name;
+	gchar suffix [16];
+	glong items = 0;
+	glong ext_len = 0;
+	glong base_len;
+	glong max;
+	gchar *valid;
+	gchar *iter;
+	glong i;
+
+	/* Joliet only takes UCS-2 so make sure the name is valid UTF-8 */
+	valid = g_strdup (node->name);
+	iter = valid;
+	while (!g_utf8_validate (iter, -1, (const gchar **) &iter))
+		*iter = '_';
+
+	utf16 = g_utf8_to_utf16 (valid, -1, NULL, &items, NULL);
+	g_free (valid);
+
+	for (i = 0; i < items; i ++) {
+		if (utf16 [i] < 0x20
+		||  utf16 [i] == '*'
+		||  utf16 [i] == '/'
+		||  utf16 [i] == ':'
+		||  utf16 [i] == ';'
+		||  utf16 [i] == '?'
+		||  utf16 [i] == '\\')
+			utf16 [i] = '_';
+	}
+
+	if (!node->is_dir) {
+		for (i = items - 1; i > 0; i --) {
+			if (utf16 [i] == '.') {
+				ext_len = items - i;
+				break;
+			}
+		}
+
+		/* keep the extension only if it's reasonable */
+		if (ext_len > 8)
+			ext_len = 0;
+	}
+
+	suffix [0] = '\0';
+	if (number)
+		g_snprintf (suffix, sizeof (suffix), "%u", number);
+
+	max = BRASERO_JOLIET_NAME_MAX - ext_len - strlen (suffix);
+	base_len = MIN (items - ext_len, max);
+
+	/* Don't split a surrogate pair */
+	if (base_len > 0
+	&&  base_len < items - ext_len
+	&&  utf16 [base_len - 1] >= 0xD800
+	&&  utf16 [base_len - 1] <= 0xDBFF)
+		base_len --;
+
+	name = g_new (gunichar2, base_len + strlen (suffix) + ext_len);
+	memcpy (name, utf16, base_len * sizeof (gunichar2));
+	for (i = 0; suffix [i]; i ++)
+		name [base_len + i] = suffix [i];
+	memcpy (name + base_len + i,
+		utf16 + items - ext_len,
+		ext_len * sizeof (gunichar2));
+
+	*len = base_len + i + ext_len;
+	g_free (utf16);
+	return name;
+}
+
+static void
+brasero_iso_dir_set_joliet_names (BraseroIsoNode *dir)
+{
+	GHashTable *names;
+	guint i;
+
+	names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (i = 0; i < dir->joliet_children->len; i ++) {
+		BraseroIsoNode *child;
+		guint number = 0;
+		gchar *key;
+
+		child = g_ptr_array_index (dir->joliet_children, i);
+
+		g_free (child->joliet_name);
+		child->joliet_name = brasero_iso_joliet_name_build (child, number, &child->joliet_len);
+		key = g_utf16_to_utf8 (child->joliet_name, child->joliet_len, NULL, NULL, NULL);
+		while (key && g_hash_table_lookup (names, key)) {
+			g_free (key);
+			g_free (child->joliet_name);
+			child->joliet_name = brasero_iso_joliet_name_build (child, ++ number, &child->joliet_len);
+			key = g_utf16_to_utf8 (child->joliet_name, child->joliet_len, NULL, NULL, NULL);
+		}
+
+		if (key)
+			g_hash_table_insert (names, key, child);
+	}
+
+	g_hash_table_destroy (names);
+}
+
+/* ECMA-119 9.3: names and extensions are compared separately, the shorter
+ * being padded with spaces */
+static gint
+brasero_iso_compare_padded (const gchar *a, gsize len_a,
+			    const gchar *b, gsize len_b)
+{
+	gsize i;
+
+	for (i = 0; i < MAX (len_a, len_b); i ++) {
+		guchar c_a = i < len_a ? a [i]:' ';
+		guchar c_b = i < len_b ? b [i]:' ';
+
+		if (c_a != c_b)
+			return c_a - c_b;
+	}
+
+	return 0;
+}
+
+static gint
+brasero_iso_node_compare (gconstpointer a, gconstpointer b)
+{
+	const BraseroIsoNode *node_a = *(BraseroIsoNode **) a;
+	const BraseroIsoNode *node_b = *(BraseroIsoNode **) b;
+	const gchar *dot_a, *dot_b;
+	gsize len_a, len_b;
+	gint result;
+
+	dot_a = strchr (node_a->iso_name, '.');
+	dot_b = strchr (node_b->iso_name, '.');
+	len_a = dot_a ? dot_a - node_a->iso_name:strlen (node_a->iso_name);
+	len_b = dot_b ? dot_b - node_b->iso_name:strlen (node_b->iso_name);
+
+	result = brasero_iso_compare_padded (node_a->iso_name, len_a,
+					     node_b->iso_name, len_b);
+	if (result)
+		return result;
+
+	return brasero_iso_compare_padded (dot_a ? dot_a + 1:"", dot_a ? strlen (dot_a + 1):0,
+					   dot_b ? dot_b + 1:"", dot_b ? strlen (dot_b + 1):0);
+}
+
+static gint
+brasero_iso_node_compare_joliet (gconstpointer a, gconstpointer b)
+{
+	const BraseroIsoNode *node_a = *(BraseroIsoNode **) a;
+	const BraseroIsoNode *node_b = *(BraseroIsoNode **) b;
+	guint i;
+
+	for (i = 0; i < MIN (node_a->joliet_len, node_b->joliet_len); i ++) {
+		if (node_a->joliet_name [i] != node_b->joliet_name [i])
+			return node_a->joliet_name [i] - node_b->joliet_name [i];
+	}
+
+	return (gint) node_a->joliet_len - (gint) node_b->joliet_len;
+}
+
+/**
+ * Rock Ridge
+ */
+
+static void
+brasero_iso_susp_reset (BraseroIsoSUSP *susp)
+{
+	g_byte_array_set_size (susp->data, 0);
+	g_array_set_size (susp->ends, 0);
+}
+
+static guchar *
+brasero_iso_susp_add (BraseroIsoSUSP *susp,
+		      const gchar *signature,
+		      guint len)
+{
+	guchar *entry;
+	guint offset;
+
+	offset = susp->data->len;
+	g_byte_array_set_size (susp->data, offset + len);
+	g_array_append_val (susp->ends, susp->data->len);
+
+	entry = susp->data->data + offset;
+	memset (entry, 0, len);
+	entry [0] = signature [0];
+	entry [1] = signature [1];
+	entry [2] = len;
+	entry [3] = 1;
+	return entry;
+}
+
+static void
+brasero_iso_susp_add_name (BraseroIsoSUSP *susp,
+			   const gchar *name)
+{
+	gsize remaining;
+
+	remaining = strlen (name);
+	do {
+		guchar *entry;
+		gsize size;
+
+		size = MIN (remaining, BRASERO_SUSP_MAX_DATA);
+		entry = brasero_iso_susp_add (susp, "NM", 5 + size);
+
+		/* CONTINUE flag */
+		entry [4] = (remaining > size) ? 0x01:0x00;
+		memcpy (entry + 5, name, size);
+
+		name += size;
+		remaining -= size;
+	} while (remaining);
+}
+
+static void
+brasero_iso_sl_flush (BraseroIsoSUSP *susp,
+		      GByteArray *components,
+		      gboolean more)
+{
+	guchar *entry;
+
+	/* CONTINUE flag if the link goes on in the next SL entry */
+	entry = brasero_iso_susp_add (susp, "SL", 5 + components->len);
+	entry [4] = more ? 0x01:0x00;
+	memcpy (entry + 5, components->data, components->len);
+	g_byte_array_set_size (components, 0);
+}
+
+/* When an SL entry is full, the current component goes on in the next entry
+ * with its CONTINUE flag set so that no '/' is inserted at the boundary */
+static void
+brasero_iso_sl_add_component (BraseroIsoSUSP *susp,
+			      GByteArray *components,
+			      guchar flags,
+			      const gchar *content,
+			      gsize len)
+{
+	guchar header [2];
+
+	do {
+		gsize size;
+
+		/* a component needs its header and a byte of content */
+		if (components->len + 2 + (len ? 1:0) > BRASERO_SUSP_MAX_DATA)
+			brasero_iso_sl_flush (susp, components, TRUE);
+
+		size = MIN (len, BRASERO_SUSP_MAX_DATA - components->len - 2);
+		header [0] = flags | ((len > size) ? 0x01:0x00);
+		header [1] = size;
+		g_byte_array_append (components, header, 2);
+		if (size)
+			g_byte_array_append (components, (const guint8 *) content, size);
+
+		content += size;
+		len -= size;
+	} while (len);
+}
+
+static void
+brasero_iso_susp_add_symlink (BraseroIsoSUSP *susp,
+			      const gchar *target)
+{
+	GByteArray *components;
+	const gchar *iter;
+
+	components = g_byte_array_new ();
+
+	iter = target;
+	if (*iter == '/') {
+		/* ROOT flag */
+		brasero_iso_sl_add_component (susp, components, 0x08, NULL, 0);
+		while (*iter == '/')
+			iter ++;
+	}
+
+	while (*iter) {
+		const gchar *end;
+		gsize len;
+
+		end = strchr (iter, '/');
+		if (!end)
+			end = iter + strlen (iter);
+
+		len = end - iter;
+		if (len == 1 && iter [0] == '.')
+			brasero_iso_sl_add_component (susp, components, 0x02, NULL, 0);
+		else if (len == 2 && iter [0] == '.' && iter [1] == '.')
+			brasero_iso_sl_add_component (susp, components, 0x04, NULL, 0);
+		else
+			brasero_iso_sl_add_component (susp, components, 0x00, iter, len);
+
+		iter = end;
+		while (*iter == '/')
+			iter ++;
+	}
+
+	brasero_iso_sl_flush (susp, components, FALSE);
+	g_byte_array_free (components, TRUE);
+}
+
+static void
+brasero_iso_susp_fill (BraseroIsoTree *tree,
+		       BraseroIsoSUSP *susp,
+		       BraseroIsoNode *node,
+		       BraseroIsoRecordType type)
+{
+	gboolean is_root_self;
+	guchar *entry;
+	guchar flags;
+
+	brasero_iso_susp_reset (susp);
+
+	/* The SP entry must be the very first one of the root "." record */
+	is_root_self = (type == BRASERO_ISO_RECORD_SELF && node == tree->root);
+	if (is_root_self) {
+		entry = brasero_iso_susp_add (susp, "SP", 7);
+		entry [4] = 0xBE;
+		entry [5] = 0xEF;
+		entry [6] = 0;
+	}
+
+	flags = BRASERO_RR_PX|BRASERO_RR_TF;
+	if (type == BRASERO_ISO_RECORD_CHILD) {
+		flags |= BRASERO_RR_NM;
+		if (node->is_symlink)
+			flags |= BRASERO_RR_SL;
+	}
+
+	entry = brasero_iso_susp_add (susp, "RR", 5);
+	entry [4] = flags;
+
+	/* uid and gid are left to 0 */
+	entry = brasero_iso_susp_add (susp, "PX", 36);
+	brasero_iso_set_733 (entry + 4, node->mode);
+	brasero_iso_set_733 (entry + 12, node->nlink);
+
+	/* MODIFY timestamp only */
+	entry = brasero_iso_susp_add (susp, "TF", 12);
+	entry [4] = 0x02;
+	brasero_iso_set_date_7 (entry + 5, node->mtime);
+
+	if (type == BRASERO_ISO_RECORD_CHILD) {
+		brasero_iso_susp_add_name (susp, node->name);
+		if (node->is_symlink)
+			brasero_iso_susp_add_symlink (susp, node->target);
+	}
+
+	if (is_root_self) {
+		guint id_len = strlen (BRASERO_RRIP_ID);
+		guint des_len = strlen (BRASERO_RRIP_DESCRIPTOR);
+		guint src_len = strlen (BRASERO_RRIP_SOURCE);
+
+		entry = brasero_iso_susp_add (susp, "ER", 8 + id_len + des_len + src_len);
+		entry [4] = id_len;
+		entry [5] = des_len;
+		entry [6] = src_len;
+		entry [7] = 1;
+		memcpy (entry + 8, BRASERO_RRIP_ID, id_len);
+		memcpy (entry + 8 + id_len, BRASERO_RRIP_DESCRIPTOR, des_len);
+		memcpy (entry + 8 + id_len + des_len, BRASERO_RRIP_SOURCE, src_len);
+	}
+}
+
+static void
+brasero_iso_susp_set_ce (guchar *buffer,
+			 guint32 block,
+			 guint32 offset,
+			 guint32 len)
+{
+	buffer [0] = 'C';
+	buffer [1] = 'E';
+	buffer [2] = BRASERO_SUSP_CE_SIZE;
+	buffer [3] = 1;
+	brasero_iso_set_733 (buffer + 4, block);
+	brasero_iso_set_733 (buffer + 12, offset);
+	brasero_iso_set_733 (buffer + 20, len);
+}
+
+/**
+ * Copies as many SUSP entries as possible into the directory record (su) and
+ * moves the others to the continuation area of the directory, chaining as
+ * many pieces as needed. A piece never crosses a sector boundary.
+ * ce_area can be NULL when only measuring.
+ * Returns the number of bytes used in the directory record.
+ */
+
+static guint
+brasero_iso_susp_pack (BraseroIsoSUSP *susp,
+		       guint room,
+		       guchar *su,
+		       guint32 ce_extent,
+		       guint32 *ce_offset,
+		       guchar *ce_area)
+{
+	/* when measuring there's nowhere to write the chained CE entries */
+	guchar dummy [BRASERO_SUSP_CE_SIZE];
+	guchar *previous_ce;
+	guint su_len;
+	guint entry;
+
+	if (susp->data->len <= room) {
+		memcpy (su, susp->data->data, susp->data->len);
+		return susp->data->len;
+	}
+
+	/* keep room for a CE entry */
+	su_len = 0;
+	for (entry = 0; entry < susp->ends->len; entry ++) {
+		guint end;
+
+		end = g_array_index (susp->ends, guint, entry);
+		if (end + BRASERO_SUSP_CE_SIZE > room)
+			break;
+
+		su_len = end;
+	}
+
+	memcpy (su, susp->data->data, su_len);
+	previous_ce = su + su_len;
+	su_len += BRASERO_SUSP_CE_SIZE;
+
+	while (entry < susp->ends->len) {
+		guint start;
+		guint piece;
+		guint last;
+
+		start = entry ? g_array_index (susp->ends, guint, entry - 1):0;
+
+		/* see how many entries fit in this piece */
+		last = entry;
+		while (last < susp->ends->len) {
+			guint end;
+
+			end = g_array_index (susp->ends, guint, last);
+			if (last + 1 == susp->ends->len) {
+				if (end - start > BRASERO_ISO_BLOCK_SIZE)
+					break;
+			}
+			else if (end - start + BRASERO_SUSP_CE_SIZE > BRASERO_ISO_BLOCK_SIZE)
+				break;
+
+			last ++;
+		}
+
+		piece = (last ? g_array_index (susp->ends, guint, last - 1):0) - start;
+		if (last < susp->ends->len)
+			piece += BRASERO_SUSP_CE_SIZE;
+
+		if ((*ce_offset % BRASERO_ISO_BLOCK_SIZE) + piece > BRASERO_ISO_BLOCK_SIZE)
+			*ce_offset = BRASERO_ISO_ROUND (*ce_offset);
+
+		brasero_iso_susp_set_ce (previous_ce,
+					 ce_extent + *ce_offset / BRASERO_ISO_BLOCK_SIZE,
+					 *ce_offset % BRASERO_ISO_BLOCK_SIZE,
+					 piece);
+
+		if (ce_area) {
+			memcpy (ce_area + *ce_offset,
+				susp->data->data + start,
+				piece - (last < susp->ends->len ? BRASERO_SUSP_CE_SIZE:0));
+			previous_ce = ce_area + *ce_offset + piece - BRASERO_SUSP_CE_SIZE;
+		}
+		else
+			previous_ce = dummy;
+
+		*ce_offset += piece;
+		entry = last;
+	}
+
+	return su_len;
+}
+
+/**
+ * Directory records
+ */
+
+static guint
+brasero_iso_record_size (guint len_fi,
+			 guint len_su)
+{
+	/* a padding byte follows identifiers of even length */
+	return 33 + len_fi + ((len_fi & 1) ? 0:1) + len_su;
+}
+
+static guint
+brasero_iso_record_write (guchar *buffer,
+			  BraseroIsoNode *node,
+			  guint32 extent,
+			  guint32 size,
+			  const guchar *fi,
+			  guint len_fi,
+			  const guchar *su,
+			  guint len_su)
+{
+	guint len;
+
+	len = brasero_iso_record_size (len_fi, len_su);
+	if (!buffer)
+		return len;
+
+	memset (buffer, 0, len);
+	buffer [0] = len;
+	brasero_iso_set_733 (buffer + 2, extent);
+	brasero_iso_set_733 (buffer + 10, size);
+	brasero_iso_set_date_7 (buffer + 18, node->mtime);
+	buffer [25] = node->is_dir ? 0x02:0x00;
+	brasero_iso_set_723 (buffer + 28, 1);
+	buffer [32] = len_fi;
+	memcpy (buffer + 33, fi, len_fi);
+
+	if (len_su)
+		memcpy (buffer + len - len_su, su, len_su);
+
+	return len;
+}
+
+static guint
+brasero_iso_joliet_identifier (BraseroIsoNode *node,
+			       guchar *buffer)
+{
+	guint i;
+
+	for (i = 0; i < node->joliet_len; i ++)
+		brasero_iso_set_722 (buffer + i * 2, node->joliet_name [i]);
+
+	if (!node->is_dir) {
+		brasero_iso_set_722 (buffer + i * 2, ';');
+		brasero_iso_set_722 (buffer + i * 2 + 2, '1');
+		i += 2;
+	}
+
+	return i * 2;
+}
+
+/**
+ * Generates the records of a directory and its continuation area. Both
+ * buffers can be NULL to get the sizes.
+ */
+
+static void
+brasero_iso_dir_write (BraseroIsoTree *tree,
+		       BraseroIsoNode *dir,
+		       gboolean joliet,
+		       BraseroIsoSUSP *susp,
+		       guchar *buffer,
+		       guchar *ce_area,
+		       guint32 *dir_size,
+		       guint32 *ce_size)
+{
+	guchar fi [BRASERO_ISO_MAX_RECORD];
+	guchar su [BRASERO_ISO_MAX_RECORD];
+	guint32 ce_offset = 0;
+	guint32 offset = 0;
+	GPtrArray *children;
+	gint i;
+
+	children = joliet ? dir->joliet_children:dir->children;
+	for (i = -2; i < (gint) children->len; i ++) {
+		BraseroIsoRecordType type;
+		BraseroIsoNode *node;
+		guint32 extent;
+		guint32 size;
+		guint len_fi;
+		guint len_su;
+		guint len;
+
+		if (i == -2) {
+			type = BRASERO_ISO_RECORD_SELF;
+			node = dir;
+			fi [0] = 0x00;
+			len_fi = 1;
+		}
+		else if (i == -1) {
+			type = BRASERO_ISO_RECORD_PARENT;
+			node = dir->parent ? dir->parent:dir;
+			fi [0] = 0x01;
+			len_fi = 1;
+		}
+		else {
+			type = BRASERO_ISO_RECORD_CHILD;
+			node = g_ptr_array_index (children, i);
+			if (joliet)
+				len_fi = brasero_iso_joliet_identifier (node, fi);
+			else {
+				len_fi = strlen (node->iso_name);
+				memcpy (fi, node->iso_name, len_fi);
+				if (!node->is_dir) {
+					memcpy (fi + len_fi, ";1", 2);
+					len_fi += 2;
+				}
+			}
+		}
+
+		len_su = 0;
+		if (!joliet) {
+			guint room;
+
+			brasero_iso_susp_fill (tree, susp, node, type);
+			room = BRASERO_ISO_MAX_RECORD - brasero_iso_record_size (len_fi, 0);
+			len_su = brasero_iso_susp_pack (susp,
+							room,
+							su,
+							dir->ce_extent,
+							&ce_offset,
+							ce_area);
+		}
+
+		/* records never cross a sector boundary */
+		len = brasero_iso_record_size (len_fi, len_su);
+		if ((offset % BRASERO_ISO_BLOCK_SIZE) + len > BRASERO_ISO_BLOCK_SIZE)
+			offset = BRASERO_ISO_ROUND (offset);
+
+		if (node->is_dir) {
+			extent = joliet ? node->joliet_extent:node->extent;
+			size = joliet ? node->joliet_size:node->dir_size;
+		}
+		else if (node->is_symlink) {
+			extent = 0;
+			size = 0;
+		}
+		else {
+			extent = node->extent;
+			size = node->size;
+		}
+
+		offset += brasero_iso_record_write (buffer ? buffer + offset:NULL,
+						    node,
+						    extent,
+						    size,
+						    fi,
+						    len_fi,
+						    su,
+						    len_su);
+	}
+
+	if (dir_size)
+		*dir_size = BRASERO_ISO_ROUND (offset);
+	if (ce_size)
+		*ce_size = ce_offset;
+}
+
+/**
+ * Path tables
+ */
+
+static guint
+brasero_iso_path_table_id (BraseroIsoNode *dir,
+			   gboolean joliet,
+			   guchar *buffer)
+{
+	if (!dir->parent) {
+		buffer [0] = 0x00;
+		return 1;
+	}
+
+	if (joliet)
+		return brasero_iso_joliet_identifier (dir, buffer);
+
+	memcpy (buffer, dir->iso_name, strlen (dir->iso_name));
+	return strlen (dir->iso_name);
+}
+
+static guint32
+brasero_iso_path_table_write (GPtrArray *dirs,
+			      gboolean joliet,
+			      gboolean big_endian,
+			      guchar *buffer)
+{
+	guchar id [BRASERO_ISO_MAX_RECORD];
+	guint32 offset = 0;
+	guint i;
+
+	for (i = 0; i < dirs->len; i ++) {
+		BraseroIsoNode *dir;
+		guint32 parent;
+		guint32 extent;
+		guint len;
+
+		dir = g_ptr_array_index (dirs, i);
+		len = brasero_iso_path_table_id (dir, joliet, id);
+
+		if (buffer) {
+			if (joliet) {
+				extent = dir->joliet_extent;
+				parent = dir->parent ? dir->parent->joliet_dir_number:1;
+			}
+			else {
+				extent = dir->extent;
+				parent = dir->parent ? dir->parent->dir_number:1;
+			}
+
+			buffer [offset] = len;
+			buffer [offset + 1] = 0;
+			if (big_endian) {
+				brasero_iso_set_732 (buffer + offset + 2, extent);
+				brasero_iso_set_722 (buffer + offset + 6, parent);
+			}
+			else {
+				brasero_iso_set_731 (buffer + offset + 2, extent);
+				brasero_iso_set_721 (buffer + offset + 6, parent);
+			}
+			memcpy (buffer + offset + 8, id, len);
+		}
+
+		offset += 8 + len + (len & 1);
+	}
+
+	return offset;
+}
+
+/**
+ * Layout
+ */
+
+static void
+brasero_iso_tree_collect_files (BraseroIsoTree *tree,
+				BraseroIsoNode *dir)
+{
+	guint i;
+
+	for (i = 0; i < dir->children->len; i ++) {
+		BraseroIsoNode *child;
+
+		child = g_ptr_array_index (dir->children, i);
+		if (child->is_dir)
+			brasero_iso_tree_collect_files (tree, child);
+		else if (!child->is_symlink)
+			g_ptr_array_add (tree->files, child);
+	}
+}
+
+gboolean
+brasero_iso_tree_layout (BraseroIsoTree *tree,
+			 GError **error)
+{
+	BraseroIsoSUSP susp;
+	guint32 cursor;
+	guint i;
+
+	if (tree->laid_out)
+		return TRUE;
+
+	/* ISO9660 names and directory numbers in path table order, which is
+	 * a breadth first walk with children sorted by identifier */
+	tree->dirs = g_ptr_array_new ();
+	g_ptr_array_add (tree->dirs, tree->root);
+	for (i = 0; i < tree->dirs->len; i ++) {
+		BraseroIsoNode *dir;
+		guint j;
+
+		dir = g_ptr_array_index (tree->dirs, i);
+		dir->dir_number = i + 1;
+		dir->nlink = 2;
+
+		brasero_iso_dir_set_iso_names (dir);
+		g_ptr_array_sort (dir->children, brasero_iso_node_compare);
+
+		for (j = 0; j < dir->children->len; j ++) {
+			BraseroIsoNode *child;
+
+			child = g_ptr_array_index (dir->children, j);
+			if (!child->is_dir)
+				continue;
+
+			g_ptr_array_add (tree->dirs, child);
+			dir->nlink ++;
+		}
+	}
+
+	/* Parent numbers in the path tables are on 16 bits. Joliet only leaves
+	 * out symlinks so it never has more directories. */
+	if (tree->dirs->len > G_MAXUINT16) {
+		BRASERO_BURN_LOG ("Too many directories (%i) for the path tables", tree->dirs->len);
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     _("The image cannot have more than %i directories"),
+			     G_MAXUINT16);
+		g_ptr_array_free (tree->dirs, TRUE);
+		tree->dirs = NULL;
+		return FALSE;
+	}
+
+	if (tree->joliet) {
+		/* Joliet can't have symlinks */
+		tree->joliet_dirs = g_ptr_array_new ();
+		g_ptr_array_add (tree->joliet_dirs, tree->root);
+		for (i = 0; i < tree->joliet_dirs->len; i ++) {
+			BraseroIsoNode *dir;
+			guint j;
+
+			dir = g_ptr_array_index (tree->joliet_dirs, i);
+			dir->joliet_dir_number = i + 1;
+			dir->joliet_children = g_ptr_array_sized_new (dir->children->len);
+			for (j = 0; j < dir->children->len; j ++) {
+				BraseroIsoNode *child;
+
+				child = g_ptr_array_index (dir->children, j);
+				if (!child->is_symlink)
+					g_ptr_array_add (dir->joliet_children, child);
+			}
+
+			brasero_iso_dir_set_joliet_names (dir);
+			g_ptr_array_sort (dir->joliet_children, brasero_iso_node_compare_joliet);
+
+			for (j = 0; j < dir->joliet_children->len; j ++) {
+				BraseroIsoNode *child;
+
+				child = g_ptr_array_index (dir->joliet_children, j);
+				if (child->is_dir)
+					g_ptr_array_add (tree->joliet_dirs, child);
+			}
+		}
+	}
+
+	/* Files are written depth first in directory order */
+	tree->files = g_ptr_array_new ();
+	brasero_iso_tree_collect_files (tree, tree->root);
+
+	/* Volume descriptors */
+	cursor = BRASERO_ISO_SYSTEM_AREA + 2;
+	if (tree->joliet)
+		cursor ++;
+
+	/* Path tables */
+	tree->path_table_size = brasero_iso_path_table_write (tree->dirs, FALSE, FALSE, NULL);
+	tree->l_path_table = cursor;
+	cursor += BRASERO_ISO_SECTORS (tree->path_table_size);
+	tree->m_path_table = cursor;
+	cursor += BRASERO_ISO_SECTORS (tree->path_table_size);
+
+	if (tree->joliet) {
+		tree->joliet_path_table_size = brasero_iso_path_table_write (tree->joliet_dirs, TRUE, FALSE, NULL);
+		tree->joliet_l_path_table = cursor;
+		cursor += BRASERO_ISO_SECTORS (tree->joliet_path_table_size);
+		tree->joliet_m_path_table = cursor;
+		cursor += BRASERO_ISO_SECTORS (tree->joliet_path_table_size);
+	}
+
+	/* Directories; the size of a record never depends on the extents */
+	susp.data = g_byte_array_new ();
+	susp.ends = g_array_new (FALSE, FALSE, sizeof (guint));
+
+	for (i = 0; i < tree->dirs->len; i ++) {
+		BraseroIsoNode *dir;
+
+		dir = g_ptr_array_index (tree->dirs, i);
+		brasero_iso_dir_write (tree,
+				       dir,
+				       FALSE,
+				       &susp,
+				       NULL,
+				       NULL,
+				       &dir->dir_size,
+				       &dir->ce_size);
+
+		dir->extent = cursor;
+		cursor += dir->dir_size / BRASERO_ISO_BLOCK_SIZE;
+		dir->ce_extent = cursor;
+		cursor += BRASERO_ISO_SECTORS (dir->ce_size);
+	}
+
+	for (i = 0; tree->joliet && i < tree->joliet_dirs->len; i ++) {
+		BraseroIsoNode *dir;
+
+		dir = g_ptr_array_index (tree->joliet_dirs, i);
+		brasero_iso_dir_write (tree,
+				       dir,
+				       TRUE,
+				       &susp,
+				       NULL,
+				       NULL,
+				       &dir->joliet_size,
+				       NULL);
+
+		dir->joliet_extent = cursor;
+		cursor += dir->joliet_size / BRASERO_ISO_BLOCK_SIZE;
+	}
+
+	g_byte_array_free (susp.data, TRUE);
+	g_array_free (susp.ends, TRUE);
+
+	/* File contents */
+	tree->data_start = cursor;
+	for (i = 0; i < tree->files->len; i ++) {
+		BraseroIsoNode *file;
+
+		file = g_ptr_array_index (tree->files, i);
+		file->extent = cursor;
+		cursor += BRASERO_ISO_SECTORS (file->size);
+	}
+
+	tree->sectors = cursor;
+	tree->laid_out = TRUE;
+	return TRUE;
+}
+
+/**
+ * Metadata
+ */
+
+static void
+brasero_iso_descriptor_write (BraseroIsoTree *tree,
+			      gboolean joliet,
+			      guchar *buffer)
+{
+	BraseroIsoNode *root;
+	guchar fi = 0x00;
+
+	memset (buffer, 0, BRASERO_ISO_BLOCK_SIZE);
+	root = tree->root;
+
+	buffer [0] = joliet ? 2:1;
+	memcpy (buffer + 1, "CD001", 5);
+	buffer [6] = 1;
+
+	brasero_iso_set_733 (buffer + 80, tree->sectors);
+	brasero_iso_set_723 (buffer + 120, 1);
+	brasero_iso_set_723 (buffer + 124, 1);
+	brasero_iso_set_723 (buffer + 128, BRASERO_ISO_BLOCK_SIZE);
+
+	if (joliet) {
+		/* UCS-2 level 3 */
+		memcpy (buffer + 88, "%/E", 3);
+
+		brasero_iso_set_joliet_string (buffer + 8, 32, "LINUX");
+		brasero_iso_set_joliet_string (buffer + 40, 32, tree->volume_id);
+
+		brasero_iso_set_733 (buffer + 132, tree->joliet_path_table_size);
+		brasero_iso_set_731 (buffer + 140, tree->joliet_l_path_table);
+		brasero_iso_set_732 (buffer + 148, tree->joliet_m_path_table);
+		brasero_iso_record_write (buffer + 156,
+					  root,
+					  root->joliet_extent,
+					  root->joliet_size,
+					  &fi,
+					  1,
+					  NULL,
+					  0);
+
+		brasero_iso_set_joliet_string (buffer + 190, 128, NULL);
+		brasero_iso_set_joliet_string (buffer + 318, 128, tree->publisher_id);
+		brasero_iso_set_joliet_string (buffer + 446, 128, tree->preparer_id);
+		brasero_iso_set_joliet_string (buffer + 574, 128, tree->publisher_id);
+		brasero_iso_set_joliet_string (buffer + 702, 37, NULL);
+		brasero_iso_set_joliet_string (buffer + 739, 37, NULL);
+		brasero_iso_set_joliet_string (buffer + 776, 37, NULL);
+	}
+	else {
+		brasero_iso_set_string (buffer + 8, 32, "LINUX");
+		brasero_iso_set_string (buffer + 40, 32, tree->volume_id);
+
+		brasero_iso_set_733 (buffer + 132, tree->path_table_size);
+		brasero_iso_set_731 (buffer + 140, tree->l_path_table);
+		brasero_iso_set_732 (buffer + 148, tree->m_path_table);
+		brasero_iso_record_write (buffer + 156,
+					  root,
+					  root->extent,
+					  root->dir_size,
+					  &fi,
+					  1,
+					  NULL,
+					  0);
+
+		brasero_iso_set_string (buffer + 190, 128, NULL);
+		brasero_iso_set_string (buffer + 318, 128, tree->publisher_id);
+		brasero_iso_set_string (buffer + 446, 128, tree->preparer_id);
+		brasero_iso_set_string (buffer + 574, 128, tree->publisher_id);
+		brasero_iso_set_string (buffer + 702, 37, NULL);
+		brasero_iso_set_string (buffer + 739, 37, NULL);
+		brasero_iso_set_string (buffer + 776, 37, NULL);
+	}
+
+	brasero_iso_set_date_17 (buffer + 813, tree->ctime);
+	brasero_iso_set_date_17 (buffer + 830, tree->ctime);
+	brasero_iso_set_date_17 (buffer + 847, 0);
+	brasero_iso_set_date_17 (buffer + 864, 0);
+	buffer [881] = 1;
+}
+
+static gboolean
+brasero_iso_path_tables_write (BraseroIsoTree *tree,
+			       gboolean joliet,
+			       BraseroIsoWriteFunc func,
+			       gpointer user_data)
+{
+	guchar *buffer;
+	gboolean result;
+	guint32 size;
+
+	size = joliet ? tree->joliet_path_table_size:tree->path_table_size;
+	size = BRASERO_ISO_ROUND (size);
+	buffer = g_malloc0 (size);
+
+	brasero_iso_path_table_write (joliet ? tree->joliet_dirs:tree->dirs,
+				      joliet,
+				      FALSE,
+				      buffer);
+	result = func (buffer, size, user_data);
+
+	if (result) {
+		memset (buffer, 0, size);
+		brasero_iso_path_table_write (joliet ? tree->joliet_dirs:tree->dirs,
+					      joliet,
+					      TRUE,
+					      buffer);
+		result = func (buffer, size, user_data);
+	}
+
+	g_free (buffer);
+	return result;
+}
+
+/**
+ * Passes all the sectors before the file contents to func in order.
+ */
+
+gboolean
+brasero_iso_tree_write_metadata (BraseroIsoTree *tree,
+				 BraseroIsoWriteFunc func,
+				 gpointer user_data)
+{
+	guchar descriptor [BRASERO_ISO_BLOCK_SIZE];
+	BraseroIsoSUSP susp;
+	gboolean result;
+	guchar *buffer;
+	guint i;
+
+	if (!brasero_iso_tree_layout (tree, NULL))
+		return FALSE;
+
+	buffer = g_malloc0 (BRASERO_ISO_SYSTEM_AREA * BRASERO_ISO_BLOCK_SIZE);
+	result = func (buffer, BRASERO_ISO_SYSTEM_AREA * BRASERO_ISO_BLOCK_SIZE, user_data);
+	g_free (buffer);
+	if (!result)
+		return FALSE;
+
+	brasero_iso_descriptor_write (tree, FALSE, descriptor);
+	if (!func (descriptor, BRASERO_ISO_BLOCK_SIZE, user_data))
+		return FALSE;
+
+	if (tree->joliet) {
+		brasero_iso_descriptor_write (tree, TRUE, descriptor);
+		if (!func (descriptor, BRASERO_ISO_BLOCK_SIZE, user_data))
+			return FALSE;
+	}
+
+	memset (descriptor, 0, BRASERO_ISO_BLOCK_SIZE);
+	descriptor [0] = 255;
+	memcpy (descriptor + 1, "CD001", 5);
+	descriptor [6] = 1;
+	if (!func (descriptor, BRASERO_ISO_BLOCK_SIZE, user_data))
+		return FALSE;
+
+	if (!brasero_iso_path_tables_write (tree, FALSE, func, user_data))
+		return FALSE;
+
+	if (tree->joliet
+	&& !brasero_iso_path_tables_write (tree, TRUE, func, user_data))
+		return FALSE;
+
+	susp.data = g_byte_array_new ();
+	susp.ends = g_array_new (FALSE, FALSE, sizeof (guint));
+
+	for (i = 0; result && i < tree->dirs->len; i ++) {
+		BraseroIsoNode *dir;
+		guint32 size;
+
+		if (g_atomic_int_get (&tree->cancel)) {
+			result = FALSE;
+			break;
+		}
+
+		dir = g_ptr_array_index (tree->dirs, i);
+		size = dir->dir_size + BRASERO_ISO_ROUND (dir->ce_size);
+		buffer = g_malloc0 (size);
+		brasero_iso_dir_write (tree,
+				       dir,
+				       FALSE,
+				       &susp,
+				       buffer,
+				       buffer + dir->dir_size,
+				       NULL,
+				       NULL);
+		result = func (buffer, size, user_data);
+		g_free (buffer);
+	}
+
+	for (i = 0; result && tree->joliet && i < tree->joliet_dirs->len; i ++) {
+		BraseroIsoNode *dir;
+
+		if (g_atomic_int_get (&tree->cancel)) {
+			result = FALSE;
+			break;
+		}
+
+		dir = g_ptr_array_index (tree->joliet_dirs, i);
+		buffer = g_malloc0 (dir->joliet_size);
+		brasero_iso_dir_write (tree,
+				       dir,
+				       TRUE,
+				       &susp,
+				       buffer,
+				       NULL,
+				       NULL,
+				       NULL);
+		result = func (buffer, dir->joliet_size, user_data);
+		g_free (buffer);
+	}
+
+	g_byte_array_free (susp.data, TRUE);
+	g_array_free (susp.ends, TRUE);
+
+	return result;
+}
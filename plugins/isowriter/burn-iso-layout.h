@@ -0,0 +1,145 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ *
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <glib.h>
+
+#ifndef _BURN_ISO_LAYOUT_H
+#define _BURN_ISO_LAYOUT_H
+
+G_BEGIN_DECLS
+
+#define BRASERO_ISO_BLOCK_SIZE		2048
+
+typedef struct _BraseroIsoNode BraseroIsoNode;
+struct _BraseroIsoNode {
+	BraseroIsoNode *parent;
+
+	/* children sorted by ISO9660 and Joliet identifiers */
+	GPtrArray *children;
+	GPtrArray *joliet_children;
+
+	gchar *name;
+	gchar *iso_name;
+	gunichar2 *joliet_name;
+	guint joliet_len;
+
+	gchar *path;
+	gchar *target;
+
+	guint64 size;
+	guint32 mode;
+	guint32 nlink;
+	gint64 mtime;
+
+	guint32 extent;
+	guint32 dir_size;
+	guint32 ce_extent;
+	guint32 ce_size;
+	guint32 joliet_extent;
+	guint32 joliet_size;
+	guint32 dir_number;
+	guint32 joliet_dir_number;
+
+	guint is_dir:1;
+	guint is_symlink:1;
+};
+
+typedef struct _BraseroIsoTree BraseroIsoTree;
+struct _BraseroIsoTree {
+	BraseroIsoNode *root;
+	GHashTable *excluded;
+
+	gchar *volume_id;
+	gchar *publisher_id;
+	gchar *preparer_id;
+	gint64 ctime;
+
+	/* Layout; everything is in sectors */
+	GPtrArray *dirs;
+	GPtrArray *joliet_dirs;
+	GPtrArray *files;
+
+	guint32 path_table_size;
+	guint32 l_path_table;
+	guint32 m_path_table;
+	guint32 joliet_path_table_size;
+	guint32 joliet_l_path_table;
+	guint32 joliet_m_path_table;
+	guint32 data_start;
+	guint32 sectors;
+
+	volatile gint cancel;
+
+	guint joliet:1;
+	guint laid_out:1;
+};
+
+typedef gboolean (*BraseroIsoWriteFunc) (const guchar *buffer,
+					 gsize size,
+					 gpointer user_data);
+
+BraseroIsoTree *
+brasero_iso_tree_new (const gchar *volume_id,
+		      const gchar *publisher_id,
+		      const gchar *preparer_id,
+		      gboolean joliet);
+
+void
+brasero_iso_tree_free (BraseroIsoTree *tree);
+
+void
+brasero_iso_tree_cancel (BraseroIsoTree *tree);
+
+void
+brasero_iso_tree_add_excluded (BraseroIsoTree *tree,
+			       const gchar *path);
+
+gboolean
+brasero_iso_tree_add_graft (BraseroIsoTree *tree,
+			    const gchar *disc_path,
+			    const gchar *path,
+			    GError **error);
+
+gboolean
+brasero_iso_tree_layout (BraseroIsoTree *tree,
+			 GError **error);
+
+gboolean
+brasero_iso_tree_write_metadata (BraseroIsoTree *tree,
+				 BraseroIsoWriteFunc func,
+				 gpointer user_data);
+
+G_END_DECLS
+
+#endif /* _BURN_ISO_LAYOUT_H */
@@ -0,0 +1,1002 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * Libbrasero-burn
+ * Copyright (C) Philippe Rouquier 2005-2009 <bonfire-app@wanadoo.fr>
+ *
+ * Libbrasero-burn is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * The Libbrasero-burn authors hereby grant permission for non-GPL compatible
+ * GStreamer plugins to be used and distributed together with GStreamer
+ * and Libbrasero-burn. This permission is above and beyond the permissions granted
+ * by the GPL license by which Libbrasero-burn is covered. If you modify this code
+ * you may extend this exception to your version of the code, but you are not
+ * obligated to do so. If you do not wish to do so, delete this exception
+ * statement from your version.
+ *
+ * Libbrasero-burn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to:
+ * 	The Free Software Foundation, Inc.,
+ * 	51 Franklin Street, Fifth Floor
+ * 	Boston, MA  02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include <glib.h>
+#include <glib-object.h>
+#include <glib/gstdio.h>
+#include <glib/gi18n-lib.h>
+#include <gmodule.h>
+
+#include "burn-job.h"
+#include "brasero-units.h"
+#include "brasero-plugin-registration.h"
+#include "brasero-track-data.h"
+#include "brasero-track-image.h"
+#include "burn-prefetch.h"
+#include "burn-iso-layout.h"
+
+
+#define BRASERO_TYPE_ISOWRITER         (brasero_isowriter_get_type ())
+#define BRASERO_ISOWRITER(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), BRASERO_TYPE_ISOWRITER, BraseroIsoWriter))
+#define BRASERO_ISOWRITER_CLASS(k)     (G_TYPE_CHECK_CLASS_CAST((k), BRASERO_TYPE_ISOWRITER, BraseroIsoWriterClass))
+#define BRASERO_IS_ISOWRITER(o)        (G_TYPE_CHECK_INSTANCE_TYPE ((o), BRASERO_TYPE_ISOWRITER))
+#define BRASERO_IS_ISOWRITER_CLASS(k)  (G_TYPE_CHECK_CLASS_TYPE ((k), BRASERO_TYPE_ISOWRITER))
+#define BRASERO_ISOWRITER_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o), BRASERO_TYPE_ISOWRITER, BraseroIsoWriterClass))
+
+BRASERO_PLUGIN_BOILERPLATE (BraseroIsoWriter, brasero_isowriter, BRASERO_TYPE_JOB, BraseroJob);
+
+/* File contents are read by several threads in chunks that are handed over
+ * to the writing thread in volume order. At most BRASERO_ISOWRITER_WINDOW
+ * chunks are read ahead of what was written. */
+#define BRASERO_ISOWRITER_CHUNK_SIZE	(256 * 1024)
+#define BRASERO_ISOWRITER_WINDOW	32
+#define BRASERO_ISOWRITER_READERS	4
+
+typedef struct _BraseroIsoWriterChunk BraseroIsoWriterChunk;
+struct _BraseroIsoWriterChunk {
+	guchar *data;
+	gsize size;
+
+	guint ready:1;
+};
+
+struct _BraseroIsoWriterPrivate {
+	BraseroIsoTree *tree;
+	BraseroPrefetch *prefetch;
+
+	int out_fd;
+	gint64 written;
+
+	/* Readers; protected by readers_mutex */
+	GMutex *readers_mutex;
+	GCond *readers_cond;
+	GThread *readers [BRASERO_ISOWRITER_READERS];
+	BraseroIsoWriterChunk window [BRASERO_ISOWRITER_WINDOW];
+	guint64 next_read;
+	guint64 next_write;
+	guint file_index;
+	guint64 file_offset;
+	GError *read_error;
+	guint readers_stop:1;
+
+	GError *error;
+	GThread *thread;
+	GMutex *mutex;
+	GCond *cond;
+	guint thread_id;
+
+	guint cancel:1;
+};
+typedef struct _BraseroIsoWriterPrivate BraseroIsoWriterPrivate;
+
+#define BRASERO_ISOWRITER_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_ISOWRITER, BraseroIsoWriterPrivate))
+
+static GObjectClass *parent_class = NULL;
+
+static gboolean
+brasero_isowriter_thread_finished (gpointer data)
+{
+	BraseroIsoWriter *self = data;
+	BraseroIsoWriterPrivate *priv;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	priv->thread_id = 0;
+	if (priv->error) {
+		GError *error;
+
+		error = priv->error;
+		priv->error = NULL;
+		brasero_job_error (BRASERO_JOB (self), error);
+		return FALSE;
+	}
+
+	if (brasero_job_get_fd_out (BRASERO_JOB (self), NULL) != BRASERO_BURN_OK) {
+		BraseroTrackImage *track = NULL;
+		gchar *output = NULL;
+		goffset blocks = 0;
+
+		/* Let's make a track */
+		track = brasero_track_image_new ();
+		brasero_job_get_image_output (BRASERO_JOB (self),
+					      &output,
+					      NULL);
+		brasero_track_image_set_source (track,
+						output,
+						NULL,
+						BRASERO_IMAGE_FORMAT_BIN);
+
+		brasero_job_get_session_output_size (BRASERO_JOB (self), &blocks, NULL);
+		brasero_track_image_set_block_num (track, blocks);
+
+		brasero_job_add_track (BRASERO_JOB (self), BRASERO_TRACK (track));
+		g_object_unref (track);
+		g_free (output);
+	}
+
+	brasero_job_finished_track (BRASERO_JOB (self));
+	return FALSE;
+}
+
+static gboolean
+brasero_isowriter_write (const guchar *buffer,
+			 gsize size,
+			 gpointer data)
+{
+	BraseroIsoWriter *self = BRASERO_ISOWRITER (data);
+	BraseroIsoWriterPrivate *priv;
+	gsize bytes_written = 0;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	while (bytes_written < size) {
+		gssize written;
+
+		if (priv->cancel)
+			return FALSE;
+
+		written = write (priv->out_fd,
+				 buffer + bytes_written,
+				 size - bytes_written);
+
+		if (written < 0) {
+			if (errno != EINTR && errno != EAGAIN) {
+                                int errsv = errno;
+
+				/* unrecoverable error */
+				priv->error = g_error_new (BRASERO_BURN_ERROR,
+							   BRASERO_BURN_ERROR_GENERAL,
+							   _("Data could not be written (%s)"),
+							   g_strerror (errsv));
+				return FALSE;
+			}
+
+			g_thread_yield ();
+			continue;
+		}
+
+		bytes_written += written;
+	}
+
+	priv->written += size;
+	brasero_job_set_written_track (BRASERO_JOB (self), priv->written);
+	brasero_prefetch_set_position (priv->prefetch, priv->written);
+	return TRUE;
+}
+
+/**
+ * Readers
+ */
+
+static gboolean
+brasero_isowriter_read_chunk (BraseroIsoWriter *self,
+			      BraseroIsoNode *file,
+			      int fd,
+			      guint64 offset,
+			      gsize size,
+			      guchar *buffer)
+{
+	BraseroIsoWriterPrivate *priv;
+	gsize bytes_read = 0;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	while (bytes_read < size) {
+		gssize result;
+
+		result = pread (fd,
+				buffer + bytes_read,
+				size - bytes_read,
+				offset + bytes_read);
+		if (result < 0) {
+			int errsv = errno;
+
+			if (errsv == EINTR)
+				continue;
+
+			g_mutex_lock (priv->readers_mutex);
+			if (!priv->read_error)
+				priv->read_error = g_error_new (BRASERO_BURN_ERROR,
+								BRASERO_BURN_ERROR_GENERAL,
+								/* Translators: the first %s is the path of a
+								 * file and the second the error message */
+								_("\"%s\" could not be read (%s)"),
+								file->path,
+								g_strerror (errsv));
+			g_mutex_unlock (priv->readers_mutex);
+			return FALSE;
+		}
+
+		if (!result) {
+			/* The file shrank since we laid out the volume. Its
+			 * size is already written in the directory records so
+			 * the best we can do is padding it. */
+			BRASERO_JOB_LOG (self, "%s is shorter than expected", file->path);
+			memset (buffer + bytes_read, 0, size - bytes_read);
+			break;
+		}
+
+		bytes_read += result;
+	}
+
+	return TRUE;
+}
+
+static gpointer
+brasero_isowriter_reader_thread (gpointer data)
+{
+	BraseroIsoWriter *self = BRASERO_ISOWRITER (data);
+	BraseroIsoWriterPrivate *priv;
+	BraseroIsoNode *opened = NULL;
+	int fd = -1;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	while (1) {
+		BraseroIsoWriterChunk *chunk;
+		BraseroIsoNode *file = NULL;
+		guint64 offset;
+		gboolean result;
+		gsize size;
+
+		g_mutex_lock (priv->readers_mutex);
+		while (!priv->readers_stop
+		&&  !priv->read_error
+		&&   priv->next_read >= priv->next_write + BRASERO_ISOWRITER_WINDOW)
+			g_cond_wait (priv->readers_cond, priv->readers_mutex);
+
+		/* Empty files have nothing to read */
+		while (priv->file_index < priv->tree->files->len) {
+			file = g_ptr_array_index (priv->tree->files, priv->file_index);
+			if (file->size)
+				break;
+
+			priv->file_index ++;
+		}
+
+		if (priv->readers_stop
+		||  priv->read_error
+		||  priv->file_index >= priv->tree->files->len) {
+			g_mutex_unlock (priv->readers_mutex);
+			break;
+		}
+
+		chunk = priv->window + (priv->next_read % BRASERO_ISOWRITER_WINDOW);
+		priv->next_read ++;
+
+		offset = priv->file_offset;
+		size = MIN (BRASERO_ISOWRITER_CHUNK_SIZE, file->size - offset);
+
+		priv->file_offset += size;
+		if (priv->file_offset >= file->size) {
+			priv->file_index ++;
+			priv->file_offset = 0;
+		}
+		g_mutex_unlock (priv->readers_mutex);
+
+		if (opened != file) {
+			if (fd != -1)
+				close (fd);
+
+			opened = file;
+			fd = open (file->path, O_RDONLY);
+			if (fd == -1) {
+				int errsv = errno;
+
+				g_mutex_lock (priv->readers_mutex);
+				if (!priv->read_error)
+					priv->read_error = g_error_new (BRASERO_BURN_ERROR,
+									BRASERO_BURN_ERROR_FILE_NOT_FOUND,
+									_("\"%s\" could not be read (%s)"),
+									file->path,
+									g_strerror (errsv));
+				g_cond_broadcast (priv->readers_cond);
+				g_mutex_unlock (priv->readers_mutex);
+				break;
+			}
+		}
+
+		result = brasero_isowriter_read_chunk (self,
+						       file,
+						       fd,
+						       offset,
+						       size,
+						       chunk->data);
+
+		g_mutex_lock (priv->readers_mutex);
+		if (result) {
+			/* The last chunk of a file is padded to a sector */
+			chunk->size = BRASERO_BYTES_TO_SECTORS (size, BRASERO_ISO_BLOCK_SIZE) * BRASERO_ISO_BLOCK_SIZE;
+			memset (chunk->data + size, 0, chunk->size - size);
+			chunk->ready = TRUE;
+		}
+		g_cond_broadcast (priv->readers_cond);
+		g_mutex_unlock (priv->readers_mutex);
+
+		if (!result)
+			break;
+	}
+
+	if (fd != -1)
+		close (fd);
+
+	return NULL;
+}
+
+static void
+brasero_isowriter_readers_stop (BraseroIsoWriter *self)
+{
+	BraseroIsoWriterPrivate *priv;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	g_mutex_lock (priv->readers_mutex);
+	priv->readers_stop = TRUE;
+	g_cond_broadcast (priv->readers_cond);
+	g_mutex_unlock (priv->readers_mutex);
+}
+
+static void
+brasero_isowriter_write_files (BraseroIsoWriter *self)
+{
+	BraseroIsoWriterPrivate *priv;
+	guchar *buffers;
+	guint64 chunks;
+	guint i;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	if (priv->cancel)
+		return;
+
+	chunks = 0;
+	for (i = 0; i < priv->tree->files->len; i ++) {
+		BraseroIsoNode *file;
+
+		file = g_ptr_array_index (priv->tree->files, i);
+		chunks += (file->size + BRASERO_ISOWRITER_CHUNK_SIZE - 1) / BRASERO_ISOWRITER_CHUNK_SIZE;
+	}
+
+	if (!chunks)
+		return;
+
+	buffers = g_malloc (BRASERO_ISOWRITER_WINDOW * BRASERO_ISOWRITER_CHUNK_SIZE);
+	for (i = 0; i < BRASERO_ISOWRITER_WINDOW; i ++) {
+		priv->window [i].data = buffers + i * BRASERO_ISOWRITER_CHUNK_SIZE;
+		priv->window [i].size = 0;
+		priv->window [i].ready = FALSE;
+	}
+
+	priv->next_read = 0;
+	priv->next_write = 0;
+	priv->file_index = 0;
+	priv->file_offset = 0;
+	priv->readers_stop = FALSE;
+
+	for (i = 0; i < BRASERO_ISOWRITER_READERS && i < chunks; i ++) {
+		GError *error = NULL;
+
+		priv->readers [i] = g_thread_create (brasero_isowriter_reader_thread,
+						     self,
+						     TRUE,
+						     &error);
+		if (error) {
+			priv->error = error;
+			break;
+		}
+	}
+
+	while (!priv->error && priv->next_write < chunks) {
+		BraseroIsoWriterChunk *chunk;
+		gboolean result;
+
+		chunk = priv->window + (priv->next_write % BRASERO_ISOWRITER_WINDOW);
+
+		g_mutex_lock (priv->readers_mutex);
+		while (!chunk->ready && !priv->read_error && !priv->readers_stop)
+			g_cond_wait (priv->readers_cond, priv->readers_mutex);
+
+		if (!chunk->ready) {
+			if (priv->read_error) {
+				priv->error = priv->read_error;
+				priv->read_error = NULL;
+			}
+
+			g_mutex_unlock (priv->readers_mutex);
+			break;
+		}
+		g_mutex_unlock (priv->readers_mutex);
+
+		result = brasero_isowriter_write (chunk->data, chunk->size, self);
+
+		g_mutex_lock (priv->readers_mutex);
+		chunk->ready = FALSE;
+		priv->next_write ++;
+		g_cond_broadcast (priv->readers_cond);
+		g_mutex_unlock (priv->readers_mutex);
+
+		if (!result)
+			break;
+	}
+
+	brasero_isowriter_readers_stop (self);
+	for (i = 0; i < BRASERO_ISOWRITER_READERS; i ++) {
+		if (priv->readers [i]) {
+			g_thread_join (priv->readers [i]);
+			priv->readers [i] = NULL;
+		}
+	}
+
+	if (priv->read_error) {
+		if (!priv->error)
+			priv->error = priv->read_error;
+		else
+			g_error_free (priv->read_error);
+
+		priv->read_error = NULL;
+	}
+
+	g_free (buffers);
+}
+
+/**
+ * Image creation
+ */
+
+static gboolean
+brasero_isowriter_open_output (BraseroIsoWriter *self)
+{
+	BraseroIsoWriterPrivate *priv;
+	gchar *output = NULL;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	if (brasero_job_get_fd_out (BRASERO_JOB (self), NULL) == BRASERO_BURN_OK) {
+		brasero_job_set_nonblocking (BRASERO_JOB (self), NULL);
+		brasero_job_get_fd_out (BRASERO_JOB (self), &priv->out_fd);
+		BRASERO_JOB_LOG (self, "Writing to pipe");
+		return TRUE;
+	}
+
+	brasero_job_get_image_output (BRASERO_JOB (self), &output, NULL);
+	priv->out_fd = g_open (output, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+	if (priv->out_fd == -1) {
+		int errnum = errno;
+
+		if (errnum == EACCES)
+			priv->error = g_error_new_literal (BRASERO_BURN_ERROR,
+							   BRASERO_BURN_ERROR_PERMISSION,
+							   _("You do not have the required permission to write at this location"));
+		else
+			priv->error = g_error_new_literal (BRASERO_BURN_ERROR,
+							   BRASERO_BURN_ERROR_GENERAL,
+							   g_strerror (errnum));
+		g_free (output);
+		return FALSE;
+	}
+
+	BRASERO_JOB_LOG (self, "writing to file %s", output);
+	g_free (output);
+	return TRUE;
+}
+
+static gpointer
+brasero_isowriter_thread_started (gpointer data)
+{
+	BraseroIsoWriterPrivate *priv;
+	BraseroIsoWriter *self;
+
+	self = BRASERO_ISOWRITER (data);
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	BRASERO_JOB_LOG (self, "Entering thread");
+	if (brasero_isowriter_open_output (self)) {
+		brasero_job_set_current_action (BRASERO_JOB (self),
+						BRASERO_BURN_ACTION_CREATING_IMAGE,
+						NULL,
+						FALSE);
+		brasero_job_start_progress (BRASERO_JOB (self), FALSE);
+
+		priv->written = 0;
+		if (brasero_iso_tree_write_metadata (priv->tree,
+						     brasero_isowriter_write,
+						     self))
+			brasero_isowriter_write_files (self);
+
+		/* the pipe belongs to the job */
+		if (brasero_job_get_fd_out (BRASERO_JOB (self), NULL) != BRASERO_BURN_OK)
+			close (priv->out_fd);
+
+		priv->out_fd = -1;
+	}
+
+	BRASERO_JOB_LOG (self, "Getting out thread");
+
+	/* End thread */
+	g_mutex_lock (priv->mutex);
+
+	if (!priv->cancel)
+		priv->thread_id = g_idle_add (brasero_isowriter_thread_finished, self);
+
+	priv->thread = NULL;
+	g_cond_signal (priv->cond);
+	g_mutex_unlock (priv->mutex);
+
+	g_thread_exit (NULL);
+
+	return NULL;
+}
+
+static BraseroBurnResult
+brasero_isowriter_create_image (BraseroIsoWriter *self,
+				GError **error)
+{
+	BraseroIsoWriterPrivate *priv;
+	GError *thread_error = NULL;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	if (priv->thread)
+		return BRASERO_BURN_RUNNING;
+
+	/* Read the files ahead in the order they'll be written to the image */
+	if (!priv->prefetch) {
+		BraseroTrack *track = NULL;
+
+		brasero_job_get_current_track (BRASERO_JOB (self), &track);
+		if (BRASERO_IS_TRACK_DATA (track))
+			priv->prefetch = brasero_prefetch_new (brasero_track_data_get_grafts (BRASERO_TRACK_DATA (track)),
+							       brasero_track_data_get_excluded_list (BRASERO_TRACK_DATA (track)));
+	}
+
+	g_mutex_lock (priv->mutex);
+	priv->thread = g_thread_create (brasero_isowriter_thread_started,
+					self,
+					FALSE,
+					&thread_error);
+	g_mutex_unlock (priv->mutex);
+
+	if (thread_error) {
+		g_propagate_error (error, thread_error);
+		return BRASERO_BURN_ERR;
+	}
+
+	return BRASERO_BURN_OK;
+}
+
+/**
+ * Volume layout
+ */
+
+static gboolean
+brasero_isowriter_create_volume_thread_finished (gpointer data)
+{
+	BraseroIsoWriter *self = data;
+	BraseroIsoWriterPrivate *priv;
+	BraseroJobAction action;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	priv->thread_id = 0;
+	if (priv->error) {
+		GError *error;
+
+		error = priv->error;
+		priv->error = NULL;
+		brasero_job_error (BRASERO_JOB (self), error);
+		return FALSE;
+	}
+
+	brasero_job_get_action (BRASERO_JOB (self), &action);
+	if (action == BRASERO_JOB_ACTION_IMAGE) {
+		GError *error = NULL;
+
+		brasero_isowriter_create_image (self, &error);
+		if (error)
+			brasero_job_error (BRASERO_JOB (self), error);
+
+		return FALSE;
+	}
+
+	brasero_job_finished_track (BRASERO_JOB (self));
+	return FALSE;
+}
+
+static gint
+brasero_isowriter_sort_graft_points (gconstpointer a, gconstpointer b)
+{
+	const BraseroGraftPt *graft_a, *graft_b;
+	gint len_a, len_b;
+
+	graft_a = a;
+	graft_b = b;
+
+	/* parents must be added before their children */
+	len_a = strlen (graft_a->path);
+	len_b = strlen (graft_b->path);
+
+	return len_a - len_b;
+}
+
+static gpointer
+brasero_isowriter_create_volume_thread (gpointer data)
+{
+	BraseroIsoWriter *self = BRASERO_ISOWRITER (data);
+	BraseroIsoWriterPrivate *priv;
+	BraseroTrack *track = NULL;
+	BraseroImageFS image_fs;
+	BraseroIsoTree *tree;
+	GSList *grafts = NULL;
+	gchar *label = NULL;
+	gchar *publisher;
+	GSList *iter;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	BRASERO_JOB_LOG (self, "creating volume");
+
+	brasero_job_get_current_track (BRASERO_JOB (self), &track);
+	image_fs = brasero_track_data_get_fs (BRASERO_TRACK_DATA (track));
+
+	brasero_job_get_data_label (BRASERO_JOB (self), &label);
+	publisher = g_strdup_printf ("Brasero-%i.%i.%i",
+				     BRASERO_MAJOR_VERSION,
+				     BRASERO_MINOR_VERSION,
+				     BRASERO_SUB);
+
+	tree = brasero_iso_tree_new (label,
+				     publisher,
+				     g_get_real_name (),
+				     (image_fs & BRASERO_IMAGE_FS_JOLIET) != 0);
+	g_free (publisher);
+	g_free (label);
+
+	/* Let stop () interrupt the exploration of the directories */
+	g_mutex_lock (priv->mutex);
+	priv->tree = tree;
+	g_mutex_unlock (priv->mutex);
+
+	brasero_job_start_progress (BRASERO_JOB (self), FALSE);
+
+	/* add global exclusions */
+	for (iter = brasero_track_data_get_excluded_list (BRASERO_TRACK_DATA (track)); iter; iter = iter->next) {
+		gchar *local;
+
+		local = g_filename_from_uri (iter->data, NULL, NULL);
+		if (local) {
+			brasero_iso_tree_add_excluded (tree, local);
+			g_free (local);
+		}
+	}
+
+	/* copy the list as we're going to reorder it */
+	grafts = brasero_track_data_get_grafts (BRASERO_TRACK_DATA (track));
+	grafts = g_slist_copy (grafts);
+	grafts = g_slist_sort (grafts, brasero_isowriter_sort_graft_points);
+
+	for (iter = grafts; iter; iter = iter->next) {
+		BraseroGraftPt *graft;
+		gchar *local_path;
+
+		if (priv->cancel)
+			break;
+
+		graft = iter->data;
+
+		BRASERO_JOB_LOG (self,
+				 "Adding graft disc path = %s, URI = %s",
+				 graft->path,
+				 graft->uri);
+
+		/* graft->uri can be a path or a URI */
+		local_path = NULL;
+		if (graft->uri) {
+			if (graft->uri [0] == '/')
+				local_path = g_strdup (graft->uri);
+			else if (g_str_has_prefix (graft->uri, "file://"))
+				local_path = g_filename_from_uri (graft->uri, NULL, NULL);
+
+			if (!local_path) {
+				priv->error = g_error_new (BRASERO_BURN_ERROR,
+							   BRASERO_BURN_ERROR_FILE_NOT_LOCAL,
+							   _("The file is not stored locally"));
+				break;
+			}
+		}
+
+		if (!brasero_iso_tree_add_graft (tree, graft->path, local_path, &priv->error)) {
+			g_free (local_path);
+			break;
+		}
+
+		g_free (local_path);
+	}
+
+	g_slist_free (grafts);
+
+	if (!priv->error && !priv->cancel
+	&&  brasero_iso_tree_layout (tree, &priv->error)) {
+		BRASERO_JOB_LOG (self,
+				 "Volume is %u sectors (%u directories, %u files)",
+				 tree->sectors,
+				 tree->dirs->len,
+				 tree->files->len);
+
+		brasero_job_set_output_size_for_current_track (BRASERO_JOB (self),
+							       tree->sectors,
+							       (gint64) tree->sectors * BRASERO_ISO_BLOCK_SIZE);
+	}
+
+	/* End thread */
+	g_mutex_lock (priv->mutex);
+
+	if (priv->error || priv->cancel) {
+		priv->tree = NULL;
+		brasero_iso_tree_free (tree);
+	}
+
+	if (!priv->cancel)
+		priv->thread_id = g_idle_add (brasero_isowriter_create_volume_thread_finished, self);
+
+	priv->thread = NULL;
+	g_cond_signal (priv->cond);
+	g_mutex_unlock (priv->mutex);
+
+	g_thread_exit (NULL);
+
+	return NULL;
+}
+
+static BraseroBurnResult
+brasero_isowriter_create_volume (BraseroIsoWriter *self, GError **error)
+{
+	BraseroIsoWriterPrivate *priv;
+	GError *thread_error = NULL;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+	if (priv->thread)
+		return BRASERO_BURN_RUNNING;
+
+	g_mutex_lock (priv->mutex);
+	priv->thread = g_thread_create (brasero_isowriter_create_volume_thread,
+					self,
+					FALSE,
+					&thread_error);
+	g_mutex_unlock (priv->mutex);
+
+	if (thread_error) {
+		g_propagate_error (error, thread_error);
+		return BRASERO_BURN_ERR;
+	}
+
+	return BRASERO_BURN_OK;
+}
+
+static void
+brasero_isowriter_clean_output (BraseroIsoWriter *self)
+{
+	BraseroIsoWriterPrivate *priv;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	if (priv->tree) {
+		brasero_iso_tree_free (priv->tree);
+		priv->tree = NULL;
+	}
+
+	if (priv->error) {
+		g_error_free (priv->error);
+		priv->error = NULL;
+	}
+}
+
+static BraseroBurnResult
+brasero_isowriter_start (BraseroJob *job,
+			 GError **error)
+{
+	BraseroIsoWriter *self;
+	BraseroJobAction action;
+	BraseroIsoWriterPrivate *priv;
+
+	self = BRASERO_ISOWRITER (job);
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	brasero_job_get_action (job, &action);
+	if (action == BRASERO_JOB_ACTION_SIZE) {
+		/* The files may have changed since last time */
+		brasero_isowriter_clean_output (self);
+		brasero_job_set_current_action (BRASERO_JOB (self),
+						BRASERO_BURN_ACTION_GETTING_SIZE,
+						NULL,
+						FALSE);
+		return brasero_isowriter_create_volume (self, error);
+	}
+
+	if (priv->error) {
+		g_error_free (priv->error);
+		priv->error = NULL;
+	}
+
+	/* we need the layout before starting anything */
+	if (!priv->tree)
+		return brasero_isowriter_create_volume (self, error);
+
+	return brasero_isowriter_create_image (self, error);
+}
+
+static void
+brasero_isowriter_stop_real (BraseroIsoWriter *self)
+{
+	BraseroIsoWriterPrivate *priv;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (self);
+
+	/* Check whether we properly shut down or if we were cancelled */
+	g_mutex_lock (priv->mutex);
+	if (priv->thread) {
+		/* A thread is running. In this context we are probably cancelling */
+		if (priv->tree)
+			brasero_iso_tree_cancel (priv->tree);
+
+		brasero_isowriter_readers_stop (self);
+
+		priv->cancel = 1;
+		g_cond_wait (priv->cond, priv->mutex);
+		priv->cancel = 0;
+	}
+	g_mutex_unlock (priv->mutex);
+
+	if (priv->thread_id) {
+		g_source_remove (priv->thread_id);
+		priv->thread_id = 0;
+	}
+
+	if (priv->prefetch) {
+		brasero_prefetch_free (priv->prefetch);
+		priv->prefetch = NULL;
+	}
+}
+
+static BraseroBurnResult
+brasero_isowriter_stop (BraseroJob *job,
+			GError **error)
+{
+	BraseroIsoWriter *self;
+
+	self = BRASERO_ISOWRITER (job);
+	brasero_isowriter_stop_real (self);
+	return BRASERO_BURN_OK;
+}
+
+static void
+brasero_isowriter_class_init (BraseroIsoWriterClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	BraseroJobClass *job_class = BRASERO_JOB_CLASS (klass);
+
+	g_type_class_add_private (klass, sizeof (BraseroIsoWriterPrivate));
+
+	parent_class = g_type_class_peek_parent(klass);
+	object_class->finalize = brasero_isowriter_finalize;
+
+	job_class->start = brasero_isowriter_start;
+	job_class->stop = brasero_isowriter_stop;
+}
+
+static void
+brasero_isowriter_init (BraseroIsoWriter *obj)
+{
+	BraseroIsoWriterPrivate *priv;
+
+	priv = BRASERO_ISOWRITER_PRIVATE (obj);
+	priv->out_fd = -1;
+	priv->mutex = g_mutex_new ();
+	priv->cond = g_cond_new ();
+	priv->readers_mutex = g_mutex_new ();
+	priv->readers_cond = g_cond_new ();
+}
+
+static void
+brasero_isowriter_finalize (GObject *object)
+{
+	BraseroIsoWriter *cobj;
+	BraseroIsoWriterPrivate *priv;
+
+	cobj = BRASERO_ISOWRITER (object);
+	priv = BRASERO_ISOWRITER_PRIVATE (object);
+
+	brasero_isowriter_stop_real (cobj);
+	brasero_isowriter_clean_output (cobj);
+
+	if (priv->mutex) {
+		g_mutex_free (priv->mutex);
+		priv->mutex = NULL;
+	}
+
+	if (priv->cond) {
+		g_cond_free (priv->cond);
+		priv->cond = NULL;
+	}
+
+	if (priv->readers_mutex) {
+		g_mutex_free (priv->readers_mutex);
+		priv->readers_mutex = NULL;
+	}
+
+	if (priv->readers_cond) {
+		g_cond_free (priv->readers_cond);
+		priv->readers_cond = NULL;
+	}
+
+	G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+brasero_isowriter_export_caps (BraseroPlugin *plugin)
+{
+	GSList *output;
+	GSList *input;
+
+	brasero_plugin_define (plugin,
+			       "isowriter",
+	                       NULL,
+			       _("Creates disc images from a file selection without any external tool"),
+			       "Brasero developers",
+			       0);
+
+	/* No multisession support (no APPEND/MERGE flags), no ISO9660 level 3
+	 * and no deep directories: libisofs or genisoimage handle these. */
+	output = brasero_caps_image_new (BRASERO_PLUGIN_IO_ACCEPT_FILE|
+					 BRASERO_PLUGIN_IO_ACCEPT_PIPE,
+					 BRASERO_IMAGE_FORMAT_BIN);
+
+	input = brasero_caps_data_new (BRASERO_IMAGE_FS_ISO|
+				       BRASERO_IMAGE_FS_JOLIET);
+	brasero_plugin_link_caps (plugin, output, input);
+	g_slist_free (input);
+
+	input = brasero_caps_data_new (BRASERO_IMAGE_FS_ISO|
+				       BRASERO_IMAGE_FS_SYMLINK);
+	brasero_plugin_link_caps (plugin, output, input);
+	g_slist_free (input);
+
+	g_slist_free (output);
+}
@@ -54,6 +54,7 @@
 #include "burn-libburn-common.h"
 #include "brasero-track-data.h"
 #include "brasero-track-image.h"
+#include "burn-prefetch.h"
 
 
 #define BRASERO_TYPE_LIBISOFS         (brasero_libisofs_get_type ())
@@ -71,6 +72,8 @@ struct _BraseroLibisofsPrivate {
 	/* that's for multisession */
 	BraseroLibburnCtx *ctx;
 
+	BraseroPrefetch *prefetch;
+
 	GError *error;
 	GThread *thread;
 	GMutex *mutex;
@@ -212,6 +215,7 @@ brasero_libisofs_write_image_to_fd_thread (BraseroLibisofs *self)
 
 		written_sectors ++;
 		brasero_job_set_written_track (BRASERO_JOB (self), written_sectors << 11);
+		brasero_prefetch_set_position (priv->prefetch, written_sectors << 11);
 
 		read_bytes = priv->libburn_src->read_xt (priv->libburn_src, buf, sector_size);
 	}
@@ -281,6 +285,7 @@ brasero_libisofs_write_image_to_file_thread (BraseroLibisofs *self)
 
 		written_sectors ++;
 		brasero_job_set_written_track (BRASERO_JOB (self), written_sectors << 11);
+		brasero_prefetch_set_position (priv->prefetch, written_sectors << 11);
 
 		read_bytes = priv->libburn_src->read_xt (priv->libburn_src, buf, sector_size);
 	}
@@ -348,6 +353,16 @@ brasero_libisofs_create_image (BraseroLibisofs *self,
 
 	iso_set_msgs_severities ("NEVER", "ALL", "brasero (libisofs)");
 
+	/* Read the files ahead in the order they'll be written to the image */
+	if (!priv->prefetch) {
+		BraseroTrack *track = NULL;
+
+		brasero_job_get_current_track (BRASERO_JOB (self), &track);
+		if (BRASERO_IS_TRACK_DATA (track))
+			priv->prefetch = brasero_prefetch_new (brasero_track_data_get_grafts (BRASERO_TRACK_DATA (track)),
+							       brasero_track_data_get_excluded_list (BRASERO_TRACK_DATA (track)));
+	}
+
 	g_mutex_lock (priv->mutex);
 	priv->thread = g_thread_create (brasero_libisofs_thread_started,
 					self,
@@ -1000,6 +1015,11 @@ brasero_libisofs_stop_real (BraseroLibisofs *self)
 		g_source_remove (priv->thread_id);
 		priv->thread_id = 0;
 	}
+
+	if (priv->prefetch) {
+		brasero_prefetch_free (priv->prefetch);
+		priv->prefetch = NULL;
+	}
 }
 
 static BraseroBurnResult
@@ -63,6 +63,10 @@
 #define BRASERO_IS_LOCAL_TRACK_CLASS(k)  (G_TYPE_CHECK_CLASS_TYPE ((k), BRASERO_TYPE_LOCAL_TRACK))
 #define BRASERO_LOCAL_TRACK_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o), BRASERO_TYPE_LOCAL_TRACK, BraseroLocalTrackClass))
 
+/* Number of files copied at the same time overall and from the same mount */
+#define BRASERO_LOCAL_TRACK_MAX_TRANSFERS		8
+#define BRASERO_LOCAL_TRACK_MAX_TRANSFERS_PER_MOUNT	4
+
 BRASERO_PLUGIN_BOILERPLATE (BraseroLocalTrack, brasero_local_track, BRASERO_TYPE_JOB, BraseroJob);
 
 struct _BraseroLocalTrackPrivate {
@@ -112,6 +116,7 @@ brasero_local_track_clock_tick (BraseroJob *job)
 				   &written,
 				   &total);
 	brasero_job_set_progress (job, (gdouble) written / (gdouble) total);
+	brasero_job_set_rate (job, brasero_xfer_get_rate (priv->xfer_ctx));
 
 	return BRASERO_BURN_OK;
 }
@@ -276,7 +281,7 @@ brasero_local_track_download_checksum (BraseroLocalTrack *self)
 				     src,
 				     dest,
 				     priv->cancel,
-				     NULL);
+				     NULL) ? BRASERO_BURN_OK:BRASERO_BURN_ERR;
 	g_object_unref (src);
 
 	if (result == BRASERO_BURN_OK) {
@@ -293,7 +298,7 @@ brasero_local_track_download_checksum (BraseroLocalTrack *self)
 				     src,
 				     dest,
 				     priv->cancel,
-				     NULL);
+				     NULL) ? BRASERO_BURN_OK:BRASERO_BURN_ERR;
 	g_object_unref (src);
 
 	if (result == BRASERO_BURN_OK) {
@@ -310,7 +315,7 @@ brasero_local_track_download_checksum (BraseroLocalTrack *self)
 				     src,
 				     dest,
 				     priv->cancel,
-				     NULL);
+				     NULL) ? BRASERO_BURN_OK:BRASERO_BURN_ERR;
 	g_object_unref (src);
 
 	if (result == BRASERO_BURN_OK) {
@@ -333,7 +338,7 @@ brasero_local_track_download_checksum (BraseroLocalTrack *self)
 				     src,
 				     dest,
 				     priv->cancel,
-				     NULL);
+				     NULL) ? BRASERO_BURN_OK:BRASERO_BURN_ERR;
 	g_object_unref (src);
 
 	if (result != BRASERO_BURN_OK) {
@@ -519,7 +524,6 @@ brasero_local_track_thread (gpointer data)
 {
 	BraseroLocalTrack *self = BRASERO_LOCAL_TRACK (data);
 	BraseroLocalTrackPrivate *priv;
-	GSList *src, *dest;
 
 	priv = BRASERO_LOCAL_TRACK_PRIVATE (self);
 	brasero_job_set_current_action (BRASERO_JOB (self),
@@ -527,33 +531,17 @@ brasero_local_track_thread (gpointer data)
 					_("Copying files locally"),
 					TRUE);
 
-	for (src = priv->src_list, dest = priv->dest_list;
-	     src && dest;
-	     src = src->next, dest = dest->next) {
-		gchar *name;
-		GFile *src_file;
-		GFile *dest_file;
-		BraseroBurnResult result;
-
-		src_file = src->data;
-		dest_file = dest->data;
-
-		name = g_file_get_basename (src_file);
-		BRASERO_JOB_LOG (self, "Downloading %s", name);
-		g_free (name);
-
-		result = brasero_xfer_start (priv->xfer_ctx,
-					     src_file,
-					     dest_file,
-					     priv->cancel,
-					     &priv->error);
-
-		if (g_cancellable_is_cancelled (priv->cancel))
-			goto end;
+	if (!brasero_xfer_start_multiple (priv->xfer_ctx,
+					  priv->src_list,
+					  priv->dest_list,
+					  BRASERO_LOCAL_TRACK_MAX_TRANSFERS,
+					  BRASERO_LOCAL_TRACK_MAX_TRANSFERS_PER_MOUNT,
+					  priv->cancel,
+					  &priv->error))
+		goto end;
 
-		if (result != BRASERO_BURN_OK)
-			goto end;
-	}
+	if (g_cancellable_is_cancelled (priv->cancel))
+		goto end;
 
 	/* successfully downloaded files, get a checksum if we can. */
 	if (priv->download_checksum
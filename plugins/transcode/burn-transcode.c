@@ -59,6 +59,9 @@
 #define BRASERO_IS_TRANSCODE_CLASS(k)  (G_TYPE_CHECK_CLASS_TYPE ((k), BRASERO_TYPE_TRANSCODE))
 #define BRASERO_TRANSCODE_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o), BRASERO_TYPE_TRANSCODE, BraseroTranscodeClass))
 
+#define BRASERO_SCHEMA_CONFIG			"org.gnome.brasero.config"
+#define BRASERO_KEY_TRANSCODE_LOOKAHEAD		"transcode-lookahead"
+
 BRASERO_PLUGIN_BOILERPLATE (BraseroTranscode, brasero_transcode, BRASERO_TYPE_JOB, BraseroJob);
 
 static gboolean brasero_transcode_bus_messages (GstBus *bus,
@@ -68,6 +71,38 @@ static void brasero_transcode_new_decoded_pad_cb (GstElement *decode,
 						  GstPad *pad,
 						  BraseroTranscode *transcode);
 
+/* Used to cut the decoded stream to the boundaries of a track */
+typedef struct _BraseroTranscodeBoundaries BraseroTranscodeBoundaries;
+struct _BraseroTranscodeBoundaries {
+	gint64 size;
+	gint64 pos;
+
+	gint64 segment_start;
+	gint64 segment_end;
+};
+
+/* A track decoded ahead of time into a temporary file while the current
+ * track is being piped */
+typedef struct _BraseroTranscodeSpool BraseroTranscodeSpool;
+struct _BraseroTranscodeSpool {
+	BraseroTranscode *transcode;
+	BraseroTrack *track;
+	gchar *path;
+
+	GstElement *pipeline;
+	GstElement *convert;
+	GstElement *link;
+	GstElement *sink;
+
+	guint bus_id;
+	gulong probe;
+
+	BraseroTranscodeBoundaries bounds;
+
+	guint done:1;
+	guint failed:1;
+};
+
 struct BraseroTranscodePrivate {
 	GstElement *pipeline;
 	GstElement *convert;
@@ -82,15 +117,19 @@ struct BraseroTranscodePrivate {
 	gint pad_fd;
 	gint pad_id;
 
-	gint64 size;
-	gint64 pos;
-
+	BraseroTranscodeBoundaries bounds;
 	gulong probe;
-	gint64 segment_start;
-	gint64 segment_end;
+
+	/* Number of tracks to decode ahead when piping */
+	guint lookahead;
+	GSList *spools;
+
+	/* Spool the current track is waiting for */
+	BraseroTranscodeSpool *waiting;
 
 	guint set_active_state:1;
 	guint mp3_size_pipeline:1;
+	guint track_done:1;
 };
 typedef struct BraseroTranscodePrivate BraseroTranscodePrivate;
 
@@ -105,36 +144,33 @@ brasero_transcode_buffer_handler (GstPad *pad,
                                   GstPadProbeInfo *info,
                                   gpointer user_data)
 {
-	BraseroTranscodePrivate *priv;
-	BraseroTranscode *self = user_data;
+	BraseroTranscodeBoundaries *bounds = user_data;
 	GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
 	GstPad *peer;
 	gint64 size;
 
-	priv = BRASERO_TRANSCODE_PRIVATE (self);
-
 	size = gst_buffer_get_size (buffer);
 
-	if (priv->segment_start <= 0 && priv->segment_end <= 0)
+	if (bounds->segment_start <= 0 && bounds->segment_end <= 0)
 		return GST_PAD_PROBE_OK;
 
 	/* what we do here is more or less what gstreamer does when seeking:
 	 * it reads and process from 0 to the seek position (I tried).
 	 * It even forwards the data before the seek position to the sink (which
 	 * is a problem in our case as it would be written) */
-	if (priv->size > priv->segment_end) {
-		priv->size += size;
+	if (bounds->size > bounds->segment_end) {
+		bounds->size += size;
 		return GST_PAD_PROBE_DROP;
 	}
 
-	if (priv->size + size > priv->segment_end) {
+	if (bounds->size + size > bounds->segment_end) {
 		GstBuffer *new_buffer;
 		int data_size;
 
 		/* the entire the buffer is not interesting for us */
 		/* create a new buffer and push it on the pad:
 		 * NOTE: we're going to receive it ... */
-		data_size = priv->segment_end - priv->size;
+		data_size = bounds->segment_end - bounds->size;
 		new_buffer = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_METADATA, 0, data_size);
 
 		/* FIXME: we can now modify the probe buffer in 0.11 */
@@ -142,7 +178,7 @@ brasero_transcode_buffer_handler (GstPad *pad,
 		peer = gst_pad_get_peer (pad);
 		gst_pad_push (peer, new_buffer);
 
-		priv->size += size - data_size;
+		bounds->size += size - data_size;
 
 		/* post an EOS event to stop pipeline */
 		gst_pad_push_event (peer, gst_event_new_eos ());
@@ -151,25 +187,25 @@ brasero_transcode_buffer_handler (GstPad *pad,
 	}
 
 	/* see if the buffer is in the segment */
-	if (priv->size < priv->segment_start) {
+	if (bounds->size < bounds->segment_start) {
 		GstBuffer *new_buffer;
 		gint data_size;
 
 		/* see if all the buffer is interesting for us */
-		if (priv->size + size < priv->segment_start) {
-			priv->size += size;
+		if (bounds->size + size < bounds->segment_start) {
+			bounds->size += size;
 			return GST_PAD_PROBE_DROP;
 		}
 
 		/* create a new buffer and push it on the pad:
 		 * NOTE: we're going to receive it ... */
-		data_size = priv->size + size - priv->segment_start;
+		data_size = bounds->size + size - bounds->segment_start;
 		new_buffer = gst_buffer_copy_region (buffer, GST_BUFFER_COPY_METADATA, size - data_size, data_size);
 		/* FIXME: this looks dodgy (tpm) */
 		GST_BUFFER_TIMESTAMP (new_buffer) = GST_BUFFER_TIMESTAMP (buffer) + data_size;
 
 		/* move forward by the size of bytes we dropped */
-		priv->size += size - data_size;
+		bounds->size += size - data_size;
 
 		/* FIXME: we can now modify the probe buffer in 0.11 */
 		/* this is recursive the following calls ourselves 
@@ -181,8 +217,8 @@ brasero_transcode_buffer_handler (GstPad *pad,
 		return GST_PAD_PROBE_DROP;
 	}
 
-	priv->size += size;
-	priv->pos += size;
+	bounds->size += size;
+	bounds->pos += size;
 
 	return GST_PAD_PROBE_OK;
 }
@@ -203,31 +239,27 @@ brasero_transcode_set_boundaries (BraseroTranscode *transcode)
 	start = brasero_track_stream_get_start (BRASERO_TRACK_STREAM (track));
 	end = brasero_track_stream_get_end (BRASERO_TRACK_STREAM (track));
 
-	priv->segment_start = BRASERO_DURATION_TO_BYTES (start);
-	priv->segment_end = BRASERO_DURATION_TO_BYTES (end);
+	priv->bounds.segment_start = BRASERO_DURATION_TO_BYTES (start);
+	priv->bounds.segment_end = BRASERO_DURATION_TO_BYTES (end);
 
 	BRASERO_JOB_LOG (transcode, "settings track boundaries time = %lli %lli / bytes = %lli %lli",
 			 start, end,
-			 priv->segment_start, priv->segment_end);
+			 priv->bounds.segment_start, priv->bounds.segment_end);
 
 	return BRASERO_BURN_OK;
 }
 
 static void
-brasero_transcode_send_volume_event (BraseroTranscode *transcode)
+brasero_transcode_send_volume_event (BraseroTranscode *transcode,
+				    BraseroTrack *track,
+				    GstElement *convert)
 {
-	BraseroTranscodePrivate *priv;
 	gdouble track_peak = 0.0;
 	gdouble track_gain = 0.0;
 	GstTagList *tag_list;
-	BraseroTrack *track;
 	GstEvent *event;
 	GValue *value;
 
-	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
-
-	brasero_job_get_current_track (BRASERO_JOB (transcode), &track);
-
 	BRASERO_JOB_LOG (transcode, "Sending audio levels tags");
 	if (brasero_track_tag_lookup (track, BRASERO_TRACK_PEAK_VALUE, &value) == BRASERO_BURN_OK)
 		track_peak = g_value_get_double (value);
@@ -242,12 +274,30 @@ brasero_transcode_send_volume_event (BraseroTranscode *transcode)
 
 	/* NOTE: that event is goind downstream */
 	event = gst_event_new_tag (tag_list);
-	if (!gst_element_send_event (priv->convert, event))
+	if (!gst_element_send_event (convert, event))
 		BRASERO_JOB_LOG (transcode, "Couldn't send tags to rgvolume");
 
 	BRASERO_JOB_LOG (transcode, "Set volume level %lf %lf", track_gain, track_peak);
 }
 
+static gboolean
+brasero_transcode_keep_dts (BraseroTranscode *transcode,
+			    BraseroTrack *track)
+{
+	GValue *value = NULL;
+
+	brasero_job_tag_lookup (BRASERO_JOB (transcode),
+				BRASERO_SESSION_STREAM_AUDIO_FORMAT,
+				&value);
+	if (!value)
+		return FALSE;
+
+	if ((g_value_get_int (value) & BRASERO_AUDIO_FORMAT_DTS) == 0)
+		return FALSE;
+
+	return (brasero_track_stream_get_format (BRASERO_TRACK_STREAM (track)) & BRASERO_AUDIO_FORMAT_DTS) != 0;
+}
+
 static GstElement *
 brasero_transcode_create_volume (BraseroTranscode *transcode,
 				 BraseroTrack *track)
@@ -364,12 +414,10 @@ brasero_transcode_create_pipeline (BraseroTranscode *transcode,
 				   GError **error)
 {
 	gchar *uri;
-	gboolean keep_dts;
 	GstElement *decode;
 	GstElement *source;
 	GstBus *bus = NULL;
 	GstCaps *filtercaps;
-	GValue *value = NULL;
 	GstElement *pipeline;
 	GstElement *sink = NULL;
 	BraseroJobAction action;
@@ -486,17 +534,8 @@ brasero_transcode_create_pipeline (BraseroTranscode *transcode,
 		      "sync", FALSE,
 		      NULL);
 
-	brasero_job_tag_lookup (BRASERO_JOB (transcode),
-				BRASERO_SESSION_STREAM_AUDIO_FORMAT,
-				&value);
-	if (value)
-		keep_dts = (g_value_get_int (value) & BRASERO_AUDIO_FORMAT_DTS) != 0;
-	else
-		keep_dts = FALSE;
-
-	if (keep_dts
-	&&  action == BRASERO_JOB_ACTION_IMAGE
-	&& (brasero_track_stream_get_format (BRASERO_TRACK_STREAM (track)) & BRASERO_AUDIO_FORMAT_DTS) != 0) {
+	if (action == BRASERO_JOB_ACTION_IMAGE
+	&&  brasero_transcode_keep_dts (transcode, track)) {
 		GstElement *wavparse;
 		GstPad *sinkpad;
 
@@ -527,12 +566,12 @@ brasero_transcode_create_pipeline (BraseroTranscode *transcode,
 		/* This is an ugly workaround for the lack of accuracy with
 		 * gstreamer. Yet this is unfortunately a necessary evil. */
 		/* FIXME: this does not look like it makes sense... (tpm) */
-		priv->pos = 0;
-		priv->size = 0;
+		priv->bounds.pos = 0;
+		priv->bounds.size = 0;
 		sinkpad = gst_element_get_static_pad (sink, "sink");
 		priv->probe = gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_BUFFER,
 		                                 brasero_transcode_buffer_handler,
-		                                 transcode, NULL);
+		                                 &priv->bounds, NULL);
 		gst_object_unref (sinkpad);
 
 
@@ -661,12 +700,12 @@ brasero_transcode_create_pipeline (BraseroTranscode *transcode,
 		/* This is an ugly workaround for the lack of accuracy with
 		 * gstreamer. Yet this is unfortunately a necessary evil. */
 		/* FIXME: this does not look like it makes sense... (tpm) */
-		priv->pos = 0;
-		priv->size = 0;
+		priv->bounds.pos = 0;
+		priv->bounds.size = 0;
 		sinkpad = gst_element_get_static_pad (sink, "sink");
 		priv->probe = gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_BUFFER,
 		                                 brasero_transcode_buffer_handler,
-		                                 transcode, NULL);
+		                                 &priv->bounds, NULL);
 		gst_object_unref (sinkpad);
 	}
 	else {
@@ -707,6 +746,598 @@ error:
 	return FALSE;
 }
 
+/**
+ * Look-ahead decoding: when piping to a recorder, the next tracks are
+ * decoded into temporary files by their own pipelines while the current
+ * track is being streamed. Those files are then piped as is.
+ */
+
+static void
+brasero_transcode_spool_stop_pipeline (BraseroTranscodeSpool *spool)
+{
+	if (spool->bus_id) {
+		g_source_remove (spool->bus_id);
+		spool->bus_id = 0;
+	}
+
+	if (!spool->pipeline)
+		return;
+
+	if (spool->probe) {
+		GstPad *sinkpad;
+
+		sinkpad = gst_element_get_static_pad (spool->sink, "sink");
+		gst_pad_remove_probe (sinkpad, spool->probe);
+		gst_object_unref (sinkpad);
+		spool->probe = 0;
+	}
+
+	gst_element_set_state (spool->pipeline, GST_STATE_NULL);
+	gst_object_unref (GST_OBJECT (spool->pipeline));
+
+	spool->pipeline = NULL;
+	spool->convert = NULL;
+	spool->link = NULL;
+	spool->sink = NULL;
+}
+
+static void
+brasero_transcode_spool_free (BraseroTranscodeSpool *spool)
+{
+	brasero_transcode_spool_stop_pipeline (spool);
+
+	if (spool->path) {
+		g_remove (spool->path);
+		g_free (spool->path);
+	}
+
+	g_object_unref (spool->track);
+	g_free (spool);
+}
+
+static void
+brasero_transcode_spools_free (BraseroTranscode *transcode)
+{
+	BraseroTranscodePrivate *priv;
+
+	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
+
+	g_slist_foreach (priv->spools, (GFunc) brasero_transcode_spool_free, NULL);
+	g_slist_free (priv->spools);
+	priv->spools = NULL;
+	priv->waiting = NULL;
+}
+
+static BraseroTranscodeSpool *
+brasero_transcode_spool_find (BraseroTranscode *transcode,
+			      BraseroTrack *track)
+{
+	BraseroTranscodePrivate *priv;
+	GSList *iter;
+
+	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
+	for (iter = priv->spools; iter; iter = iter->next) {
+		BraseroTranscodeSpool *spool;
+
+		spool = iter->data;
+		if (spool->track == track)
+			return spool;
+	}
+
+	return NULL;
+}
+
+static gboolean
+brasero_transcode_create_pipeline_spool (BraseroTranscode *transcode,
+					 BraseroTranscodeSpool *spool,
+					 GError **error)
+{
+	BraseroTranscodePrivate *priv;
+	GstElement *pipeline;
+	GstElement *source;
+	GstElement *sink;
+	GstPad *sinkpad;
+	GstBus *bus;
+	int fd;
+
+	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
+
+	BRASERO_JOB_LOG (transcode, "Piping track decoded ahead from %s", spool->path);
+
+	priv->set_active_state = 0;
+
+	/* filesrc ! fdsink */
+	pipeline = gst_pipeline_new (NULL);
+
+	bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+	gst_bus_add_watch (bus,
+			   (GstBusFunc) brasero_transcode_bus_messages,
+			   transcode);
+	gst_object_unref (bus);
+
+	source = gst_element_factory_make ("filesrc", NULL);
+	if (!source) {
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     _("%s element could not be created"),
+			     "\"Filesrc\"");
+		goto error;
+	}
+	gst_bin_add (GST_BIN (pipeline), source);
+	g_object_set (source,
+		      "location", spool->path,
+		      NULL);
+
+	sink = gst_element_factory_make ("fdsink", NULL);
+	if (!sink) {
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     _("%s element could not be created"),
+			     "\"Sink\"");
+		goto error;
+	}
+	gst_bin_add (GST_BIN (pipeline), sink);
+
+	brasero_job_get_fd_out (BRASERO_JOB (transcode), &fd);
+	g_object_set (sink,
+		      "fd", fd,
+		      "sync", FALSE,
+		      NULL);
+
+	if (!gst_element_link (source, sink)) {
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     _("Impossible to link plugin pads"));
+		goto error;
+	}
+
+	/* The file was already cut to the track boundaries so there is
+	 * nothing to drop; the probe only counts the bytes written. */
+	priv->bounds.pos = 0;
+	priv->bounds.size = 0;
+	priv->bounds.segment_start = 0;
+	priv->bounds.segment_end = G_MAXINT64;
+
+	sinkpad = gst_element_get_static_pad (sink, "sink");
+	priv->probe = gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_BUFFER,
+	                                 brasero_transcode_buffer_handler,
+	                                 &priv->bounds, NULL);
+	gst_object_unref (sinkpad);
+
+	priv->link = NULL;
+	priv->sink = sink;
+	priv->decode = NULL;
+	priv->source = source;
+	priv->convert = NULL;
+	priv->pipeline = pipeline;
+
+	gst_element_set_state (pipeline, GST_STATE_PLAYING);
+	return TRUE;
+
+error:
+	if (error && (*error))
+		BRASERO_JOB_LOG (transcode,
+				 "can't create object : %s \n",
+				 (*error)->message);
+
+	gst_object_unref (GST_OBJECT (pipeline));
+	return FALSE;
+}
+
+static void
+brasero_transcode_spool_finished (BraseroTranscodeSpool *spool)
+{
+	BraseroTranscode *transcode;
+	BraseroTranscodePrivate *priv;
+	GError *error = NULL;
+
+	transcode = spool->transcode;
+	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
+
+	BRASERO_JOB_LOG (transcode, "Track decoded ahead (success = %i)", spool->done);
+
+	if (priv->waiting != spool)
+		return;
+
+	priv->waiting = NULL;
+
+	if (spool->done) {
+		if (!brasero_transcode_create_pipeline_spool (transcode, spool, &error))
+			brasero_job_error (BRASERO_JOB (transcode), error);
+
+		return;
+	}
+
+	/* Decode it ourselves then */
+	priv->spools = g_slist_remove (priv->spools, spool);
+	brasero_transcode_spool_free (spool);
+
+	if (!brasero_transcode_create_pipeline (transcode, &error))
+		brasero_job_error (BRASERO_JOB (transcode), error);
+}
+
+static gboolean
+brasero_transcode_spool_bus_messages (GstBus *bus,
+				      GstMessage *msg,
+				      BraseroTranscodeSpool *spool)
+{
+	GError *error = NULL;
+	gchar *debug;
+
+	switch (GST_MESSAGE_TYPE (msg)) {
+	case GST_MESSAGE_ERROR:
+		gst_message_parse_error (msg, &error, &debug);
+		BRASERO_JOB_LOG (spool->transcode,
+				 "Error while decoding ahead: %s (%s)",
+				 error->message,
+				 debug);
+		g_free (debug);
+		g_error_free (error);
+
+		spool->failed = TRUE;
+		break;
+
+	case GST_MESSAGE_EOS:
+		spool->done = TRUE;
+		break;
+
+	default:
+		return TRUE;
+	}
+
+	/* Returning FALSE removes the watch */
+	spool->bus_id = 0;
+	brasero_transcode_spool_stop_pipeline (spool);
+
+	/* NOTE: spool may be freed after that */
+	brasero_transcode_spool_finished (spool);
+	return FALSE;
+}
+
+static void
+brasero_transcode_spool_error_on_pad_linking (BraseroTranscodeSpool *spool)
+{
+	GstMessage *message;
+	GstBus *bus;
+
+	message = gst_message_new_error (GST_OBJECT (spool->pipeline),
+					 g_error_new (BRASERO_BURN_ERROR,
+						      BRASERO_BURN_ERROR_GENERAL,
+						      _("Impossible to link plugin pads")),
+					 "Sent by brasero_transcode_spool_new_decoded_pad_cb");
+
+	bus = gst_pipeline_get_bus (GST_PIPELINE (spool->pipeline));
+	gst_bus_post (bus, message);
+	g_object_unref (bus);
+}
+
+static void
+brasero_transcode_spool_new_decoded_pad_cb (GstElement *decode,
+					    GstPad *pad,
+					    BraseroTranscodeSpool *spool)
+{
+	GstPadLinkReturn res;
+	GstElement *element;
+	GstStructure *structure;
+	GstCaps *caps;
+	GstPad *sink;
+
+	caps = gst_pad_query_caps (pad, NULL);
+	if (!caps)
+		return;
+
+	structure = gst_caps_get_structure (caps, 0);
+	if (!structure)
+		goto end;
+
+	if (g_strrstr (gst_structure_get_name (structure), "audio")) {
+		brasero_transcode_send_volume_event (spool->transcode, spool->track, spool->convert);
+
+		/* see brasero_transcode_new_decoded_pad_cb () */
+		element = gst_element_factory_make ("queue", NULL);
+		gst_bin_add (GST_BIN (spool->pipeline), element);
+		if (!gst_element_link (element, spool->link)) {
+			brasero_transcode_spool_error_on_pad_linking (spool);
+			goto end;
+		}
+	}
+	else if (g_strrstr (gst_structure_get_name (structure), "video")) {
+		element = gst_element_factory_make ("fakesink", NULL);
+		if (!element) {
+			brasero_transcode_spool_error_on_pad_linking (spool);
+			goto end;
+		}
+		gst_bin_add (GST_BIN (spool->pipeline), element);
+	}
+	else
+		goto end;
+
+	sink = gst_element_get_static_pad (element, "sink");
+	if (GST_PAD_IS_LINKED (sink)) {
+		brasero_transcode_spool_error_on_pad_linking (spool);
+		gst_object_unref (sink);
+		goto end;
+	}
+
+	res = gst_pad_link (pad, sink);
+	if (res == GST_PAD_LINK_OK)
+		gst_element_set_state (element, GST_STATE_PLAYING);
+	else
+		brasero_transcode_spool_error_on_pad_linking (spool);
+
+	gst_object_unref (sink);
+
+end:
+	gst_caps_unref (caps);
+}
+
+static BraseroTranscodeSpool *
+brasero_transcode_spool_new (BraseroTranscode *transcode,
+			     BraseroTrack *track,
+			     GError **error)
+{
+	gchar *uri;
+	GstBus *bus;
+	GstPad *sinkpad;
+	GstCaps *filtercaps;
+	GstElement *sink;
+	GstElement *decode;
+	GstElement *source;
+	GstElement *filter;
+	GstElement *volume;
+	GstElement *convert;
+	GstElement *resample;
+	GstElement *pipeline;
+	BraseroTrackType *output_type;
+	BraseroTranscodeSpool *spool;
+	BraseroStreamFormat session_format;
+
+	spool = g_new0 (BraseroTranscodeSpool, 1);
+	spool->transcode = transcode;
+	spool->track = g_object_ref (track);
+
+	if (brasero_job_get_tmp_file (BRASERO_JOB (transcode),
+				      NULL,
+				      &spool->path,
+				      error) != BRASERO_BURN_OK) {
+		brasero_transcode_spool_free (spool);
+		return NULL;
+	}
+
+	output_type = brasero_track_type_new ();
+	brasero_job_get_output_type (BRASERO_JOB (transcode), output_type);
+	session_format = brasero_track_type_get_stream_format (output_type);
+	brasero_track_type_free (output_type);
+
+	/* uri ! decodebin ! queue ! audioresample ! (rgvolume) ! audioconvert ! capsfilter ! filesink */
+	pipeline = gst_pipeline_new (NULL);
+	spool->pipeline = pipeline;
+
+	uri = brasero_track_stream_get_source (BRASERO_TRACK_STREAM (track), TRUE);
+	source = gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
+	g_free (uri);
+
+	decode = gst_element_factory_make ("decodebin", NULL);
+	resample = gst_element_factory_make ("audioresample", NULL);
+	convert = gst_element_factory_make ("audioconvert", NULL);
+	filter = gst_element_factory_make ("capsfilter", NULL);
+	sink = gst_element_factory_make ("filesink", NULL);
+
+	if (!source || !decode || !resample || !convert || !filter || !sink) {
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     _("%s element could not be created"),
+			     "\"Decoder\"");
+
+		if (source) gst_object_unref (source);
+		if (decode) gst_object_unref (decode);
+		if (resample) gst_object_unref (resample);
+		if (convert) gst_object_unref (convert);
+		if (filter) gst_object_unref (filter);
+		if (sink) gst_object_unref (sink);
+
+		brasero_transcode_spool_free (spool);
+		return NULL;
+	}
+
+	gst_bin_add_many (GST_BIN (pipeline),
+			  source,
+			  decode,
+			  resample,
+			  convert,
+			  filter,
+			  sink,
+			  NULL);
+
+	g_object_set (source,
+		      "typefind", FALSE,
+		      NULL);
+	g_object_set (sink,
+		      "location", spool->path,
+		      "sync", FALSE,
+		      NULL);
+
+	filtercaps = gst_caps_new_full (gst_structure_new ("audio/x-raw",
+							   "format", G_TYPE_STRING, (session_format & BRASERO_AUDIO_FORMAT_RAW_LITTLE_ENDIAN) != 0 ? "S16LE" : "S16BE",
+							   "channels", G_TYPE_INT, 2,
+							   "rate", G_TYPE_INT, 44100,
+							   NULL),
+					NULL);
+	g_object_set (GST_OBJECT (filter), "caps", filtercaps, NULL);
+	gst_caps_unref (filtercaps);
+
+	volume = brasero_transcode_create_volume (transcode, track);
+	if (volume) {
+		gst_bin_add (GST_BIN (pipeline), volume);
+		if (!gst_element_link_many (resample, volume, convert, filter, sink, NULL))
+			goto link_error;
+	}
+	else if (!gst_element_link_many (resample, convert, filter, sink, NULL))
+		goto link_error;
+
+	if (!gst_element_link (source, decode))
+		goto link_error;
+
+	spool->convert = convert;
+	spool->link = resample;
+	spool->sink = sink;
+
+	g_signal_connect (G_OBJECT (decode),
+			  "pad-added",
+			  G_CALLBACK (brasero_transcode_spool_new_decoded_pad_cb),
+			  spool);
+
+	spool->bounds.segment_start = BRASERO_DURATION_TO_BYTES (brasero_track_stream_get_start (BRASERO_TRACK_STREAM (track)));
+	spool->bounds.segment_end = BRASERO_DURATION_TO_BYTES (brasero_track_stream_get_end (BRASERO_TRACK_STREAM (track)));
+
+	sinkpad = gst_element_get_static_pad (sink, "sink");
+	spool->probe = gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_BUFFER,
+	                                  brasero_transcode_buffer_handler,
+	                                  &spool->bounds, NULL);
+	gst_object_unref (sinkpad);
+
+	bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+	spool->bus_id = gst_bus_add_watch (bus,
+					   (GstBusFunc) brasero_transcode_spool_bus_messages,
+					   spool);
+	gst_object_unref (bus);
+
+	gst_element_set_state (pipeline, GST_STATE_PLAYING);
+	return spool;
+
+link_error:
+	g_set_error (error,
+		     BRASERO_BURN_ERROR,
+		     BRASERO_BURN_ERROR_GENERAL,
+		     _("Impossible to link plugin pads"));
+	brasero_transcode_spool_free (spool);
+	return NULL;
+}
+
+static void
+brasero_transcode_lookahead_update (BraseroTranscode *transcode)
+{
+	BraseroTranscodePrivate *priv;
+	BraseroTrack *current = NULL;
+	GSList *window = NULL;
+	GSList *tracks;
+	GSList *iter;
+	GSList *next;
+	guint num;
+
+	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
+	if (!priv->lookahead)
+		return;
+
+	brasero_job_get_current_track (BRASERO_JOB (transcode), &current);
+	brasero_job_get_tracks (BRASERO_JOB (transcode), &tracks);
+
+	iter = g_slist_find (tracks, current);
+	if (iter)
+		iter = iter->next;
+
+	for (num = 0; iter && num < priv->lookahead; iter = iter->next, num ++) {
+		BraseroTrack *track;
+
+		track = iter->data;
+		if (!BRASERO_IS_TRACK_STREAM (track))
+			continue;
+
+		/* DTS tracks are not decoded (see brasero_transcode_create_pipeline ()) */
+		if (brasero_transcode_keep_dts (transcode, track))
+			continue;
+
+		window = g_slist_prepend (window, track);
+	}
+	window = g_slist_reverse (window);
+
+	/* Remove the spools for the tracks that were already piped */
+	for (iter = priv->spools; iter; iter = next) {
+		BraseroTranscodeSpool *spool;
+
+		next = iter->next;
+		spool = iter->data;
+		if (spool->track == current || g_slist_find (window, spool->track))
+			continue;
+
+		priv->spools = g_slist_remove (priv->spools, spool);
+		brasero_transcode_spool_free (spool);
+	}
+
+	/* Start decoding the tracks that are not yet */
+	for (iter = window; iter; iter = iter->next) {
+		BraseroTranscodeSpool *spool;
+		BraseroTrack *track;
+		GError *error = NULL;
+
+		track = iter->data;
+		if (brasero_transcode_spool_find (transcode, track))
+			continue;
+
+		spool = brasero_transcode_spool_new (transcode, track, &error);
+		if (!spool) {
+			/* That's not fatal: the track will be decoded in turn */
+			BRASERO_JOB_LOG (transcode,
+					 "Track can't be decoded ahead: %s",
+					 error ? error->message:"unknown error");
+			if (error)
+				g_error_free (error);
+			break;
+		}
+
+		BRASERO_JOB_LOG (transcode, "Decoding track ahead into %s", spool->path);
+		priv->spools = g_slist_append (priv->spools, spool);
+	}
+
+	g_slist_free (window);
+}
+
+static BraseroBurnResult
+brasero_transcode_start_piping (BraseroTranscode *transcode,
+				GError **error)
+{
+	BraseroTranscodePrivate *priv;
+	BraseroTranscodeSpool *spool;
+	BraseroTrack *track = NULL;
+
+	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
+
+	brasero_job_get_current_track (BRASERO_JOB (transcode), &track);
+	spool = brasero_transcode_spool_find (transcode, track);
+
+	/* Keep the following tracks decoding while this one is piped */
+	brasero_transcode_lookahead_update (transcode);
+
+	if (spool && spool->failed) {
+		priv->spools = g_slist_remove (priv->spools, spool);
+		brasero_transcode_spool_free (spool);
+		spool = NULL;
+	}
+
+	if (!spool) {
+		if (!brasero_transcode_create_pipeline (transcode, error))
+			return BRASERO_BURN_ERR;
+
+		return BRASERO_BURN_OK;
+	}
+
+	if (spool->done) {
+		if (!brasero_transcode_create_pipeline_spool (transcode, spool, error))
+			return BRASERO_BURN_ERR;
+
+		return BRASERO_BURN_OK;
+	}
+
+	/* It is still being decoded; it will be piped once finished */
+	BRASERO_JOB_LOG (transcode, "Waiting for the track to be decoded ahead");
+	priv->waiting = spool;
+	return BRASERO_BURN_OK;
+}
+
 static void
 brasero_transcode_set_track_size (BraseroTranscode *transcode,
 				  gint64 duration)
@@ -950,6 +1581,11 @@ brasero_transcode_start (BraseroJob *job,
 		}
 
 		brasero_transcode_set_boundaries (transcode);
+
+		/* When piping, the following tracks are decoded ahead */
+		if (brasero_job_get_fd_out (job, NULL) == BRASERO_BURN_OK)
+			return brasero_transcode_start_piping (transcode, error);
+
 		if (!brasero_transcode_create_pipeline (transcode, error))
 			return BRASERO_BURN_ERR;
 	}
@@ -1002,6 +1638,13 @@ brasero_transcode_stop (BraseroJob *job,
 		priv->pad_id = 0;
 	}
 
+	/* Tracks decoded ahead are kept only when moving to the next track */
+	if (!priv->track_done)
+		brasero_transcode_spools_free (BRASERO_TRANSCODE (job));
+
+	priv->track_done = FALSE;
+	priv->waiting = NULL;
+
 	brasero_transcode_stop_pipeline (BRASERO_TRANSCODE (job));
 	return BRASERO_BURN_OK;
 }
@@ -1059,6 +1702,7 @@ brasero_transcode_pad_real (BraseroTranscode *transcode,
 static void
 brasero_transcode_push_track (BraseroTranscode *transcode)
 {
+	BraseroTranscodePrivate *priv;
 	guint64 length = 0;
 	gchar *output = NULL;
 	BraseroTrack *src = NULL;
@@ -1084,6 +1728,9 @@ brasero_transcode_push_track (BraseroTranscode *transcode)
 	 * anymore. BraseroTaskCtx refs it. */
 	g_object_unref (track);
 
+	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
+	priv->track_done = TRUE;
+
 	brasero_job_finished_track (BRASERO_JOB (transcode));
 }
 
@@ -1130,7 +1777,7 @@ brasero_transcode_pad (BraseroTranscode *transcode, int fd, GError **error)
 	BraseroTranscodePrivate *priv;
 
 	priv = BRASERO_TRANSCODE_PRIVATE (transcode);
-	if (priv->pos < 0)
+	if (priv->bounds.pos < 0)
 		return TRUE;
 
 	/* Padding is important for two reasons:
@@ -1140,19 +1787,19 @@ brasero_transcode_pad (BraseroTranscode *transcode, int fd, GError **error)
 	brasero_job_get_current_track (BRASERO_JOB (transcode), &track);
 	brasero_track_stream_get_length (BRASERO_TRACK_STREAM (track), &length);
 
-	if (priv->pos < BRASERO_DURATION_TO_BYTES (length)) {
+	if (priv->bounds.pos < BRASERO_DURATION_TO_BYTES (length)) {
 		gint64 b_written = 0;
 
 		/* Check bytes boundary for length */
 		b_written = BRASERO_DURATION_TO_BYTES (length);
 		b_written += (b_written % 2352) ? 2352 - (b_written % 2352):0;
-		bytes2write = b_written - priv->pos;
+		bytes2write = b_written - priv->bounds.pos;
 
 		BRASERO_JOB_LOG (transcode,
 				 "wrote %lli bytes (= %lli ns) out of %lli (= %lli ns)"
 				 "\n=> padding %lli bytes",
-				 priv->pos,
-				 BRASERO_BYTES_TO_DURATION (priv->pos),
+				 priv->bounds.pos,
+				 BRASERO_BYTES_TO_DURATION (priv->bounds.pos),
 				 BRASERO_DURATION_TO_BYTES (length),
 				 length,
 				 bytes2write);
@@ -1161,13 +1808,13 @@ brasero_transcode_pad (BraseroTranscode *transcode, int fd, GError **error)
 		gint64 b_written = 0;
 
 		/* wrote more or the exact amount of bytes. Check bytes boundary */
-		b_written = priv->pos;
+		b_written = priv->bounds.pos;
 		bytes2write = (b_written % 2352) ? 2352 - (b_written % 2352):0;
 		BRASERO_JOB_LOG (transcode,
 				 "wrote %lli bytes (= %lli ns)"
 				 "\n=> padding %lli bytes",
 				 b_written,
-				 priv->pos,
+				 priv->bounds.pos,
 				 bytes2write);
 	}
 
@@ -1607,10 +2254,12 @@ brasero_transcode_new_decoded_pad_cb (GstElement *decode,
 		if (g_strrstr (gst_structure_get_name (structure), "audio")) {
 			GstPad *sink;
 			GstElement *queue;
+			BraseroTrack *track;
 			GstPadLinkReturn res;
 
 			/* before linking pads (before any data reach grvolume), send tags */
-			brasero_transcode_send_volume_event (transcode);
+			brasero_job_get_current_track (BRASERO_JOB (transcode), &track);
+			brasero_transcode_send_volume_event (transcode, track, priv->convert);
 
 			/* This is necessary in case there is a video stream
 			 * (see brasero-metadata.c). we need to queue to avoid
@@ -1680,10 +2329,11 @@ brasero_transcode_clock_tick (BraseroJob *job)
 
 	priv = BRASERO_TRANSCODE_PRIVATE (job);
 
+	/* Waiting for the track to be decoded ahead */
 	if (!priv->pipeline)
-		return BRASERO_BURN_ERR;
+		return priv->waiting ? BRASERO_BURN_OK:BRASERO_BURN_ERR;
 
-	brasero_job_set_written_track (job, priv->pos);
+	brasero_job_set_written_track (job, priv->bounds.pos);
 	return BRASERO_BURN_OK;
 }
 
@@ -1705,7 +2355,18 @@ brasero_transcode_class_init (BraseroTranscodeClass *klass)
 
 static void
 brasero_transcode_init (BraseroTranscode *obj)
-{ }
+{
+	GSettings *settings;
+	BraseroTranscodePrivate *priv;
+	gint lookahead;
+
+	priv = BRASERO_TRANSCODE_PRIVATE (obj);
+
+	settings = g_settings_new (BRASERO_SCHEMA_CONFIG);
+	lookahead = g_settings_get_int (settings, BRASERO_KEY_TRANSCODE_LOOKAHEAD);
+	priv->lookahead = CLAMP (lookahead, 0, 8);
+	g_object_unref (settings);
+}
 
 static void
 brasero_transcode_finalize (GObject *object)
@@ -1719,6 +2380,7 @@ brasero_transcode_finalize (GObject *object)
 		priv->pad_id = 0;
 	}
 
+	brasero_transcode_spools_free (BRASERO_TRANSCODE (object));
 	brasero_transcode_stop_pipeline (BRASERO_TRANSCODE (object));
 
 	G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -1727,6 +2389,7 @@ brasero_transcode_finalize (GObject *object)
 static void
 brasero_transcode_export_caps (BraseroPlugin *plugin)
 {
+	BraseroPluginConfOption *lookahead;
 	GSList *input;
 	GSList *output;
 
@@ -1774,4 +2437,10 @@ brasero_transcode_export_caps (BraseroPlugin *plugin)
 	brasero_plugin_link_caps (plugin, output, input);
 	g_slist_free (output);
 	g_slist_free (input);
+
+	lookahead = brasero_plugin_conf_option_new (BRASERO_KEY_TRANSCODE_LOOKAHEAD,
+						    _("Number of songs decoded ahead when burning on the fly:"),
+						    BRASERO_PLUGIN_OPTION_INT);
+	brasero_plugin_conf_option_int_set_range (lookahead, 0, 8);
+	brasero_plugin_add_conf_option (plugin, lookahead);
 }
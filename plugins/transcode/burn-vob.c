@@ -33,13 +33,20 @@
 #endif
 
 #include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include <glib.h>
 #include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
 #include <gmodule.h>
 
+#include <gio/gio.h>
+
 #include <gst/gst.h>
 
+#include "brasero-metadata.h"
+
 #include "brasero-tags.h"
 #include "burn-job.h"
 #include "brasero-plugin-registration.h"
@@ -54,11 +61,37 @@
 
 BRASERO_PLUGIN_BOILERPLATE (BraseroVob, brasero_vob, BRASERO_TYPE_JOB, BraseroJob);
 
+/* One per title; several can run at the same time */
+typedef struct _BraseroVobEncoder BraseroVobEncoder;
+struct _BraseroVobEncoder {
+	BraseroVob *vob;
+	BraseroTrack *track;
+	gchar *output;
+
+	/* used to find out whether streams can be copied */
+	BraseroMetadata *metadata;
+
+	GstElement *pipeline;
+	GstElement *source;
+	guint watch;
+
+	guint copy_video:1;
+	guint copy_audio:1;
+	guint probed:1;
+	guint running:1;
+	guint done:1;
+};
+
 typedef struct _BraseroVobPrivate BraseroVobPrivate;
 struct _BraseroVobPrivate
 {
 	GstElement *pipeline;
 
+	/* list of BraseroVobEncoder in track order */
+	GSList *encoders;
+	guint max_encoders;
+	guint run_id;
+
 	GstElement *audio;
 	GstElement *video;
 
@@ -68,6 +101,9 @@ struct _BraseroVobPrivate
 
 	guint svcd:1;
 	guint is_video_dvd:1;
+
+	/* all the tracks of the session are transcoded at once */
+	guint session:1;
 };
 
 #define BRASERO_VOB_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_VOB, BraseroVobPrivate))
@@ -75,108 +111,132 @@ struct _BraseroVobPrivate
 static GObjectClass *parent_class = NULL;
 
 
+/* Limits of the specifications on the streams that are copied: peak bit
+ * rate of the video stream (as in its sequence header) in bit/s and size of
+ * its VBV buffer in bits. VCDs need a constant rate of 1150 kbit/s which
+ * some encoders round up to the next unit of 400 bit/s. */
+#define BRASERO_VCD_VIDEO_RATE		1150000
+#define BRASERO_VCD_VIDEO_RATE_MAX	1152000
+#define BRASERO_VCD_VBV_MAX		(40 * 1024 * 8)
+#define BRASERO_SVCD_VIDEO_RATE_MAX	2600000
+#define BRASERO_SVCD_VBV_MAX		(112 * 1024 * 8)
+#define BRASERO_DVD_VIDEO_RATE_MAX	9800000
+#define BRASERO_DVD_VBV_MAX		(224 * 1024 * 8)
+
+/* Maximum mux rates (audio, video and container overhead) */
+#define BRASERO_VCD_MUX_RATE_MAX	1394400
+#define BRASERO_SVCD_MUX_RATE_MAX	2778000
+#define BRASERO_DVD_MUX_RATE_MAX	10080000
+
 /* This is for 3 seconds of buffering (default is 1) */
 #define MAX_SIZE_BUFFER		200		/* Use unlimited (0) if it does not work */
 #define MAX_SIZE_BYTES		10485760	/* Use unlimited (0) if it does not work */
 #define MAX_SIZE_TIME		3000000000LL    /* Use unlimited (0) if it does not work */
 
 static void
-brasero_vob_stop_pipeline (BraseroVob *vob)
+brasero_vob_encoder_stop (BraseroVobEncoder *encoder)
 {
-	BraseroVobPrivate *priv;
-
-	priv = BRASERO_VOB_PRIVATE (vob);
-	if (!priv->pipeline)
+	if (!encoder->pipeline)
 		return;
 
-	priv->source = NULL;
+	encoder->source = NULL;
+	encoder->running = FALSE;
 
-	gst_element_set_state (priv->pipeline, GST_STATE_NULL);
-	gst_object_unref (GST_OBJECT (priv->pipeline));
-	priv->pipeline = NULL;
+	if (encoder->watch) {
+		g_source_remove (encoder->watch);
+		encoder->watch = 0;
+	}
+
+	gst_element_set_state (encoder->pipeline, GST_STATE_NULL);
+	gst_object_unref (GST_OBJECT (encoder->pipeline));
+	encoder->pipeline = NULL;
 }
 
-static BraseroBurnResult
-brasero_vob_stop (BraseroJob *job,
-		  GError **error)
+static void
+brasero_vob_encoder_probed_cb (BraseroMetadata *metadata,
+			       const GError *error,
+			       BraseroVobEncoder *encoder);
+
+static void
+brasero_vob_encoder_free_metadata (BraseroVobEncoder *encoder)
 {
-	brasero_vob_stop_pipeline (BRASERO_VOB (job));
-	return BRASERO_BURN_OK;
+	if (!encoder->metadata)
+		return;
+
+	g_signal_handlers_disconnect_by_func (encoder->metadata,
+					      brasero_vob_encoder_probed_cb,
+					      encoder);
+	brasero_metadata_cancel (encoder->metadata);
+	g_object_unref (encoder->metadata);
+	encoder->metadata = NULL;
 }
 
 static void
-brasero_vob_finished (BraseroVob *vob)
+brasero_vob_encoders_free (BraseroVob *vob)
 {
-	BraseroTrackType *type = NULL;
-	BraseroTrackStream *track;
-	gchar *output = NULL;
+	BraseroVobPrivate *priv;
+	GSList *iter;
 
-	type = brasero_track_type_new ();
-	brasero_job_get_output_type (BRASERO_JOB (vob), type);
-	brasero_job_get_audio_output (BRASERO_JOB (vob), &output);
+	priv = BRASERO_VOB_PRIVATE (vob);
 
-	track = brasero_track_stream_new ();
-	brasero_track_stream_set_source (track, output);
-	brasero_track_stream_set_format (track, brasero_track_type_get_stream_format (type));
+	if (priv->run_id) {
+		g_source_remove (priv->run_id);
+		priv->run_id = 0;
+	}
 
-	brasero_job_add_track (BRASERO_JOB (vob), BRASERO_TRACK (track));
-	g_object_unref (track);
+	for (iter = priv->encoders; iter; iter = iter->next) {
+		BraseroVobEncoder *encoder;
 
-	brasero_track_type_free (type);
-	g_free (output);
+		encoder = iter->data;
+		brasero_vob_encoder_free_metadata (encoder);
+		brasero_vob_encoder_stop (encoder);
+		g_object_unref (encoder->track);
+		g_free (encoder->output);
+		g_free (encoder);
+	}
 
-	brasero_job_finished_track (BRASERO_JOB (vob));
+	g_slist_free (priv->encoders);
+	priv->encoders = NULL;
 }
 
-static gboolean
-brasero_vob_bus_messages (GstBus *bus,
-			  GstMessage *msg,
-			  BraseroVob *vob)
+static void
+brasero_vob_stop_pipeline (BraseroVob *vob)
 {
-	GError *error = NULL;
-	gchar *debug;
-
-	switch (GST_MESSAGE_TYPE (msg)) {
-	case GST_MESSAGE_TAG:
-		return TRUE;
-
-	case GST_MESSAGE_ERROR:
-		gst_message_parse_error (msg, &error, &debug);
-		BRASERO_JOB_LOG (vob, debug);
-		g_free (debug);
+	BraseroVobPrivate *priv;
 
-	        brasero_job_error (BRASERO_JOB (vob), error);
-		return FALSE;
+	priv = BRASERO_VOB_PRIVATE (vob);
 
-	case GST_MESSAGE_EOS:
-		BRASERO_JOB_LOG (vob, "Transcoding finished");
+	/* Temporary files are removed by the session */
+	brasero_vob_encoders_free (vob);
 
-		/* add a new track and terminate */
-		brasero_vob_finished (vob);
-		return FALSE;
+	if (!priv->pipeline)
+		return;
 
-	case GST_MESSAGE_STATE_CHANGED:
-		break;
+	priv->source = NULL;
 
-	default:
-		return TRUE;
-	}
+	gst_element_set_state (priv->pipeline, GST_STATE_NULL);
+	gst_object_unref (GST_OBJECT (priv->pipeline));
+	priv->pipeline = NULL;
+}
 
-	return TRUE;
+static BraseroBurnResult
+brasero_vob_stop (BraseroJob *job,
+		  GError **error)
+{
+	brasero_vob_stop_pipeline (BRASERO_VOB (job));
+	return BRASERO_BURN_OK;
 }
 
 static void
 brasero_vob_error_on_pad_linking (BraseroVob *self,
+				  GstElement *pipeline,
                                   const gchar *function_name)
 {
-	BraseroVobPrivate *priv;
 	GstMessage *message;
 	GstBus *bus;
 
-	priv = BRASERO_VOB_PRIVATE (self);
-
 	BRASERO_JOB_LOG (self, "Error on pad linking");
-	message = gst_message_new_error (GST_OBJECT (priv->pipeline),
+	message = gst_message_new_error (GST_OBJECT (pipeline),
 					 g_error_new (BRASERO_BURN_ERROR,
 						      BRASERO_BURN_ERROR_GENERAL,
 						      /* Translators: This message is sent
@@ -189,7 +249,7 @@ brasero_vob_error_on_pad_linking (BraseroVob *self,
 						      _("Impossible to link plugin pads")),
 					 function_name);
 
-	bus = gst_pipeline_get_bus (GST_PIPELINE (priv->pipeline));
+	bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
 	gst_bus_post (bus, message);
 	g_object_unref (bus);
 }
@@ -201,10 +261,16 @@ brasero_vob_new_decoded_pad_cb (GstElement *decode,
 {
 	GstPad *sink;
 	GstCaps *caps;
+	GstElement *audio;
+	GstElement *video;
+	GstElement *pipeline;
 	GstStructure *structure;
-	BraseroVobPrivate *priv;
 
-	priv = BRASERO_VOB_PRIVATE (vob);
+	/* Several pipelines can be running at the same time so the bins are
+	 * those of the pipeline decode belongs to */
+	video = g_object_get_data (G_OBJECT (decode), "video-bin");
+	audio = g_object_get_data (G_OBJECT (decode), "audio-bin");
+	pipeline = GST_ELEMENT (GST_ELEMENT_PARENT (decode));
 
 	/* make sure we only have audio */
 	caps = gst_pad_query_caps (pad, NULL);
@@ -216,27 +282,27 @@ brasero_vob_new_decoded_pad_cb (GstElement *decode,
 		if (g_strrstr (gst_structure_get_name (structure), "video")) {
 			GstPadLinkReturn res;
 
-			sink = gst_element_get_static_pad (priv->video, "sink");
+			sink = gst_element_get_static_pad (video, "sink");
 			res = gst_pad_link (pad, sink);
 			gst_object_unref (sink);
 
 			if (res != GST_PAD_LINK_OK)
-				brasero_vob_error_on_pad_linking (vob, "Sent by brasero_vob_new_decoded_pad_cb");
+				brasero_vob_error_on_pad_linking (vob, pipeline, "Sent by brasero_vob_new_decoded_pad_cb");
 
-			gst_element_set_state (priv->video, GST_STATE_PLAYING);
+			gst_element_set_state (video, GST_STATE_PLAYING);
 		}
 
 		if (g_strrstr (gst_structure_get_name (structure), "audio")) {
 			GstPadLinkReturn res;
 
-			sink = gst_element_get_static_pad (priv->audio, "sink");
+			sink = gst_element_get_static_pad (audio, "sink");
 			res = gst_pad_link (pad, sink);
 			gst_object_unref (sink);
 
 			if (res != GST_PAD_LINK_OK)
-				brasero_vob_error_on_pad_linking (vob, "Sent by brasero_vob_new_decoded_pad_cb");
+				brasero_vob_error_on_pad_linking (vob, pipeline, "Sent by brasero_vob_new_decoded_pad_cb");
 
-			gst_element_set_state (priv->audio, GST_STATE_PLAYING);
+			gst_element_set_state (audio, GST_STATE_PLAYING);
 		}
 	}
 
@@ -690,7 +756,6 @@ brasero_vob_build_audio_bins (BraseroVob *vob,
 			      GstElement *muxer,
 			      GError **error)
 {
-	GValue *value;
 	GstElement *tee;
 	BraseroVobPrivate *priv;
 
@@ -709,18 +774,6 @@ brasero_vob_build_audio_bins (BraseroVob *vob,
 	gst_bin_add (GST_BIN (priv->pipeline), tee);
 
 	if (priv->is_video_dvd) {
-		/* Get output format */
-		value = NULL;
-		brasero_job_tag_lookup (BRASERO_JOB (vob),
-					BRASERO_DVD_STREAM_FORMAT,
-					&value);
-
-		if (value)
-			priv->format = g_value_get_int (value);
-
-		if (priv->format == BRASERO_AUDIO_FORMAT_NONE)
-			priv->format = BRASERO_AUDIO_FORMAT_RAW;
-
 		/* FIXME: for the moment even if we use tee, we can't actually
 		 * encode and use more than one audio stream */
 		if (priv->format & BRASERO_AUDIO_FORMAT_RAW) {
@@ -1054,18 +1107,68 @@ error:
 	return NULL;
 }
 
+static GstElement *
+brasero_vob_build_copy_bin (BraseroVob *vob,
+			    GstElement *muxer,
+			    const gchar *pad_name,
+			    GError **error)
+{
+	GstPad *srcpad;
+	GstPad *sinkpad;
+	GstElement *queue;
+	GstPadLinkReturn res;
+	BraseroVobPrivate *priv;
+
+	priv = BRASERO_VOB_PRIVATE (vob);
+
+	/* The stream is already compliant; mplex only needs to remux it */
+	queue = gst_element_factory_make ("queue", NULL);
+	if (queue == NULL) {
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+			     _("%s element could not be created"),
+			     "\"Queue\"");
+		return NULL;
+	}
+	gst_bin_add (GST_BIN (priv->pipeline), queue);
+	g_object_set (queue,
+		      "max-size-buffers", MAX_SIZE_BUFFER,
+		      "max-size-bytes", MAX_SIZE_BYTES,
+		      "max-size-time", MAX_SIZE_TIME,
+		      NULL);
+
+	srcpad = gst_element_get_static_pad (queue, "src");
+	sinkpad = gst_element_get_request_pad (muxer, pad_name);
+	res = gst_pad_link (srcpad, sinkpad);
+	BRASERO_JOB_LOG (vob, "Linked copy bin to muxer == %d", res)
+	gst_object_unref (sinkpad);
+	gst_object_unref (srcpad);
+
+	if (res != GST_PAD_LINK_OK) {
+		g_set_error (error,
+			     BRASERO_BURN_ERROR,
+			     BRASERO_BURN_ERROR_GENERAL,
+		             _("Impossible to link plugin pads"));
+		return NULL;
+	}
+
+	return queue;
+}
+
 static gboolean
 brasero_vob_build_pipeline (BraseroVob *vob,
+			    BraseroTrack *track,
+			    const gchar *output,
+			    gboolean copy_video,
+			    gboolean copy_audio,
 			    GError **error)
 {
 	gchar *uri;
-	GstBus *bus;
-	gchar *output;
 	GstElement *sink;
 	GstElement *muxer;
 	GstElement *source;
 	GstElement *decode;
-	BraseroTrack *track;
 	GstElement *pipeline;
 	BraseroVobPrivate *priv;
 
@@ -1077,9 +1180,9 @@ brasero_vob_build_pipeline (BraseroVob *vob,
 	priv->pipeline = pipeline;
 
 	/* source */
-	brasero_job_get_current_track (BRASERO_JOB (vob), &track);
 	uri = brasero_track_stream_get_source (BRASERO_TRACK_STREAM (track), TRUE);
 	source = gst_element_make_from_uri (GST_URI_SRC, uri, NULL, NULL);
+	g_free (uri);
 	if (!source) {
 		g_set_error (error,
 			     BRASERO_BURN_ERROR,
@@ -1107,6 +1210,28 @@ brasero_vob_build_pipeline (BraseroVob *vob,
 	}
 	gst_bin_add (GST_BIN (pipeline), decode);
 
+	/* Have decodebin stop at the streams that are copied */
+	if (copy_video || copy_audio) {
+		GString *string;
+		GstCaps *caps;
+
+		string = g_string_new ("video/x-raw; audio/x-raw; text/x-raw");
+		if (copy_video)
+			g_string_append_printf (string,
+						"; video/mpeg, mpegversion=(int)%i, systemstream=(boolean)false",
+						(priv->is_video_dvd || priv->svcd) ? 2 : 1);
+		if (copy_audio)
+			g_string_append (string, "; audio/mpeg, mpegversion=(int)1; audio/x-ac3; audio/ac3");
+
+		caps = gst_caps_from_string (string->str);
+		g_string_free (string, TRUE);
+
+		g_object_set (decode,
+			      "caps", caps,
+			      NULL);
+		gst_caps_unref (caps);
+	}
+
 	if (!gst_element_link (source, decode)) {
 		BRASERO_JOB_LOG (vob, "Error while linking pads");
 		g_set_error (error,
@@ -1142,8 +1267,6 @@ brasero_vob_build_pipeline (BraseroVob *vob,
 			      NULL);
 
 	/* create sink */
-	output = NULL;
-	brasero_job_get_audio_output (BRASERO_JOB (vob), &output);
 	sink = gst_element_factory_make ("filesink", NULL);
 	if (sink == NULL) {
 		g_set_error (error,
@@ -1168,28 +1291,31 @@ brasero_vob_build_pipeline (BraseroVob *vob,
 	}
 
 	/* video encoding */
-	priv->video = brasero_vob_build_video_bin (vob, muxer, error);
+	if (copy_video)
+		priv->video = brasero_vob_build_copy_bin (vob, muxer, "video_%u", error);
+	else
+		priv->video = brasero_vob_build_video_bin (vob, muxer, error);
+
 	if (!priv->video)
 		goto error;
 
 	/* audio encoding */
-	priv->audio = brasero_vob_build_audio_bins (vob, muxer, error);
+	if (copy_audio)
+		priv->audio = brasero_vob_build_copy_bin (vob, muxer, "audio_%u", error);
+	else
+		priv->audio = brasero_vob_build_audio_bins (vob, muxer, error);
+
 	if (!priv->audio)
 		goto error;
 
 	/* to be able to link everything */
+	g_object_set_data (G_OBJECT (decode), "video-bin", priv->video);
+	g_object_set_data (G_OBJECT (decode), "audio-bin", priv->audio);
 	g_signal_connect (G_OBJECT (decode),
 			  "pad-added",
 			  G_CALLBACK (brasero_vob_new_decoded_pad_cb),
 			  vob);
 
-	/* connect to the bus */	
-	bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
-	gst_bus_add_watch (bus,
-			   (GstBusFunc) brasero_vob_bus_messages,
-			   vob);
-	gst_object_unref (bus);
-
 	return TRUE;
 
 error:
@@ -1204,10 +1330,701 @@ error:
 	return FALSE;
 }
 
+static void
+brasero_vob_encoders_finished (BraseroVob *vob)
+{
+	BraseroTrackType *type = NULL;
+	BraseroVobPrivate *priv;
+	GSList *iter;
+
+	priv = BRASERO_VOB_PRIVATE (vob);
+
+	type = brasero_track_type_new ();
+	brasero_job_get_output_type (BRASERO_JOB (vob), type);
+
+	/* Tracks must be added in the order of the session */
+	for (iter = priv->encoders; iter; iter = iter->next) {
+		BraseroVobEncoder *encoder;
+		BraseroTrackStream *track;
+
+		encoder = iter->data;
+
+		track = brasero_track_stream_new ();
+		brasero_track_stream_set_source (track, encoder->output);
+		brasero_track_stream_set_format (track, brasero_track_type_get_stream_format (type));
+
+		brasero_job_add_track (BRASERO_JOB (vob), BRASERO_TRACK (track));
+		g_object_unref (track);
+	}
+
+	brasero_track_type_free (type);
+
+	if (priv->session)
+		brasero_job_finished_session (BRASERO_JOB (vob));
+	else
+		brasero_job_finished_track (BRASERO_JOB (vob));
+}
+
+static gboolean
+brasero_vob_stream_matches (const gchar *stream,
+			    const gchar *target)
+{
+	GstCaps *stream_caps;
+	GstCaps *target_caps;
+	gboolean result;
+
+	if (!stream)
+		return FALSE;
+
+	stream_caps = gst_caps_from_string (stream);
+	if (!stream_caps)
+		return FALSE;
+
+	target_caps = gst_caps_from_string (target);
+	result = gst_caps_can_intersect (stream_caps, target_caps);
+	gst_caps_unref (target_caps);
+	gst_caps_unref (stream_caps);
+
+	return result;
+}
+
+/**
+ * Reads the peak bit rate and the VBV buffer size of an MPEG-1/2 video
+ * stream from the sequence header the parser put in the caps
+ */
+
+static gboolean
+brasero_vob_video_get_sequence (const gchar *video_caps,
+				guint64 *bitrate,
+				guint64 *vbv)
+{
+	GstStructure *structure;
+	const GValue *value;
+	guint64 rate_value;
+	guint64 vbv_value;
+	GstBuffer *buffer;
+	GstMapInfo map;
+	gboolean result;
+	GstCaps *caps;
+	gsize i;
+
+	caps = gst_caps_from_string (video_caps);
+	if (!caps)
+		return FALSE;
+
+	structure = gst_caps_get_structure (caps, 0);
+	value = gst_structure_get_value (structure, "codec_data");
+	if (!value || !GST_VALUE_HOLDS_BUFFER (value)) {
+		gst_caps_unref (caps);
+		return FALSE;
+	}
+
+	buffer = gst_value_get_buffer (value);
+	if (!gst_buffer_map (buffer, &map, GST_MAP_READ)) {
+		gst_caps_unref (caps);
+		return FALSE;
+	}
+
+	/* 0x000001B3 then 12 bits width, 12 bits height, 4 bits aspect,
+	 * 4 bits frame rate, 18 bits bit rate, 1 marker, 10 bits VBV */
+	result = (map.size >= 12
+	      &&  map.data [0] == 0x00
+	      &&  map.data [1] == 0x00
+	      &&  map.data [2] == 0x01
+	      &&  map.data [3] == 0xB3);
+
+	if (result) {
+		rate_value = (map.data [8] << 10) | (map.data [9] << 2) | (map.data [10] >> 6);
+		vbv_value = ((map.data [10] & 0x1F) << 5) | (map.data [11] >> 3);
+
+		/* MPEG-2 adds the high bits in the sequence extension:
+		 * 4 bits id (1), 8 bits profile and level, 1 bit progressive,
+		 * 2 bits chroma, 2 + 2 bits size, 12 bits bit rate, 1 marker,
+		 * 8 bits VBV */
+		for (i = 12; i + 8 < map.size; i ++) {
+			if (map.data [i] != 0x00
+			||  map.data [i + 1] != 0x00
+			||  map.data [i + 2] != 0x01
+			||  map.data [i + 3] != 0xB5
+			|| (map.data [i + 4] >> 4) != 0x01)
+				continue;
+
+			rate_value |= (guint64) (((map.data [i + 6] & 0x1F) << 7) | (map.data [i + 7] >> 1)) << 18;
+			vbv_value |= (guint64) map.data [i + 8] << 10;
+			break;
+		}
+
+		/* 0x3FFFF is the "variable" value of MPEG-1 */
+		if (rate_value == 0x3FFFF)
+			rate_value = 0;
+
+		*bitrate = rate_value * 400;
+		*vbv = vbv_value * 16 * 1024;
+	}
+
+	gst_buffer_unmap (buffer, &map);
+	gst_caps_unref (caps);
+
+	return result;
+}
+
+static gboolean
+brasero_vob_video_rates_are_compliant (BraseroVob *vob,
+				       BraseroMetadataInfo *info)
+{
+	BraseroVobPrivate *priv;
+	guint64 bitrate = 0;
+	guint64 vbv = 0;
+
+	priv = BRASERO_VOB_PRIVATE (vob);
+
+	/* Without a sequence header the stream can't be checked */
+	if (!brasero_vob_video_get_sequence (info->video_caps, &bitrate, &vbv)) {
+		BRASERO_JOB_LOG (vob, "No sequence header for the video stream");
+		return FALSE;
+	}
+
+	BRASERO_JOB_LOG (vob,
+			 "Video stream peak rate %" G_GUINT64_FORMAT ", VBV %" G_GUINT64_FORMAT,
+			 bitrate,
+			 vbv);
+
+	if (!bitrate || !vbv)
+		return FALSE;
+
+	if (priv->is_video_dvd)
+		return (bitrate <= BRASERO_DVD_VIDEO_RATE_MAX && vbv <= BRASERO_DVD_VBV_MAX);
+
+	if (priv->svcd)
+		return (bitrate <= BRASERO_SVCD_VIDEO_RATE_MAX && vbv <= BRASERO_SVCD_VBV_MAX);
+
+	return (bitrate >= BRASERO_VCD_VIDEO_RATE
+	    &&  bitrate <= BRASERO_VCD_VIDEO_RATE_MAX
+	    &&  vbv <= BRASERO_VCD_VBV_MAX);
+}
+
+static gboolean
+brasero_vob_video_is_compliant (BraseroVob *vob,
+				BraseroMetadataInfo *info)
+{
+	GValue *value;
+	GstCaps *caps;
+	gint rate = -1;
+	gint aspect = -1;
+	GString *target;
+	gboolean result;
+	GstStructure *structure;
+	gint width = 0, height = 0;
+	gint par_n = 1, par_d = 1;
+	BraseroVobPrivate *priv;
+
+	priv = BRASERO_VOB_PRIVATE (vob);
+
+	if (!info->video_caps)
+		return FALSE;
+
+	caps = gst_caps_from_string (info->video_caps);
+	if (!caps)
+		return FALSE;
+
+	/* The stream must be fully described; a missing field would
+	 * otherwise match anything */
+	structure = gst_caps_get_structure (caps, 0);
+	if (!gst_structure_get_int (structure, "width", &width)
+	||  !gst_structure_get_int (structure, "height", &height)
+	||  !gst_structure_has_field (structure, "framerate")) {
+		gst_caps_unref (caps);
+		return FALSE;
+	}
+
+	gst_structure_get_fraction (structure, "pixel-aspect-ratio", &par_n, &par_d);
+	gst_caps_unref (caps);
+
+	value = NULL;
+	brasero_job_tag_lookup (BRASERO_JOB (vob),
+				BRASERO_VIDEO_OUTPUT_FRAMERATE,
+				&value);
+	if (value)
+		rate = g_value_get_int (value);
+
+	value = NULL;
+	brasero_job_tag_lookup (BRASERO_JOB (vob),
+				BRASERO_VIDEO_OUTPUT_ASPECT,
+				&value);
+	if (value)
+		aspect = g_value_get_int (value);
+
+	/* VCDs only support 4:3 */
+	if (!priv->is_video_dvd && !priv->svcd)
+		aspect = BRASERO_VIDEO_ASPECT_4_3;
+
+	if (aspect == BRASERO_VIDEO_ASPECT_4_3 || aspect == BRASERO_VIDEO_ASPECT_16_9) {
+		gdouble wanted;
+		gdouble ratio;
+
+		wanted = (aspect == BRASERO_VIDEO_ASPECT_4_3) ? 4.0 / 3.0 : 16.0 / 9.0;
+		ratio = ((gdouble) width * par_n) / ((gdouble) height * par_d);
+		if (ratio < wanted * 0.97 || ratio > wanted * 1.03) {
+			BRASERO_JOB_LOG (vob, "Wrong aspect ratio %lf", ratio);
+			return FALSE;
+		}
+	}
+
+	/* These are the resolutions and frame rates the (S)VCD and
+	 * Video DVD specifications allow */
+	target = g_string_new (NULL);
+	if (rate != BRASERO_VIDEO_FRAMERATE_NTSC) {
+		if (priv->is_video_dvd)
+			g_string_append (target,
+					 "video/mpeg, mpegversion=(int)2, width=(int){ 720, 704, 352 }, height=(int)576, framerate=(fraction)25/1; "
+					 "video/mpeg, mpegversion=(int)2, width=(int)352, height=(int)288, framerate=(fraction)25/1; ");
+		else if (priv->svcd)
+			g_string_append (target,
+					 "video/mpeg, mpegversion=(int)2, width=(int)480, height=(int)576, framerate=(fraction)25/1; ");
+		else
+			g_string_append (target,
+					 "video/mpeg, mpegversion=(int)1, width=(int)352, height=(int)288, framerate=(fraction)25/1; ");
+	}
+
+	if (rate != BRASERO_VIDEO_FRAMERATE_PAL_SECAM) {
+		if (priv->is_video_dvd)
+			g_string_append (target,
+					 "video/mpeg, mpegversion=(int)2, width=(int){ 720, 704, 352 }, height=(int)480, framerate=(fraction)30000/1001; "
+					 "video/mpeg, mpegversion=(int)2, width=(int)352, height=(int)240, framerate=(fraction)30000/1001");
+		else if (priv->svcd)
+			g_string_append (target,
+					 "video/mpeg, mpegversion=(int)2, width=(int)480, height=(int)480, framerate=(fraction)30000/1001");
+		else
+			g_string_append (target,
+					 "video/mpeg, mpegversion=(int)1, width=(int)352, height=(int)240, framerate=(fraction)30000/1001");
+	}
+
+	result = brasero_vob_stream_matches (info->video_caps, target->str);
+	g_string_free (target, TRUE);
+
+	if (!result)
+		return FALSE;
+
+	return brasero_vob_video_rates_are_compliant (vob, info);
+}
+
+static gboolean
+brasero_vob_audio_is_compliant (BraseroVob *vob,
+				BraseroMetadataInfo *info)
+{
+	BraseroVobPrivate *priv;
+
+	priv = BRASERO_VOB_PRIVATE (vob);
+
+	if (!info->audio_caps)
+		return FALSE;
+
+	/* An unknown bit rate or number of channels can't be checked */
+	BRASERO_JOB_LOG (vob,
+			 "Audio stream bit rate %u, %i channels",
+			 info->audio_bitrate,
+			 info->channels);
+
+	if (!info->audio_bitrate || info->channels <= 0)
+		return FALSE;
+
+	/* VCDs need 224 kbit/s stereo MPEG-1 layer II at 44.1 kHz */
+	if (!priv->is_video_dvd && !priv->svcd)
+		return (info->audio_bitrate == 224000
+		    &&  info->channels == 2
+		    &&  brasero_vob_stream_matches (info->audio_caps,
+						    "audio/mpeg, mpegversion=(int)1, layer=(int)2, rate=(int)44100"));
+
+	if (!priv->is_video_dvd)
+		return (info->audio_bitrate <= 384000
+		    &&  info->channels <= 2
+		    &&  brasero_vob_stream_matches (info->audio_caps,
+						    "audio/mpeg, mpegversion=(int)1, layer=(int)2, rate=(int)44100"));
+
+	/* Only one audio stream can be muxed (see build_audio_bins ()) so
+	 * copy the stream if its format is one of those requested */
+	if ((priv->format & BRASERO_AUDIO_FORMAT_AC3)
+	&&   info->audio_bitrate <= 448000
+	&&   info->channels <= 6
+	&&   brasero_vob_stream_matches (info->audio_caps,
+					 "audio/x-ac3, rate=(int)48000; audio/ac3, rate=(int)48000"))
+		return TRUE;
+
+	if ((priv->format & BRASERO_AUDIO_FORMAT_MP2)
+	&&   info->audio_bitrate <= 384000
+	&&   info->channels <= 2
+	&&   brasero_vob_stream_matches (info->audio_caps,
+					 "audio/mpeg, mpegversion=(int)1, layer=(int)2, rate=(int)48000"))
+		return TRUE;
+
+	return FALSE;
+}
+
+static void
+brasero_vob_encoder_check_streams (BraseroVobEncoder *encoder,
+				   BraseroMetadataInfo *info)
+{
+	BraseroVob *vob = encoder->vob;
+	BraseroVobPrivate *priv;
+	guint64 max_rate;
+
+	priv = BRASERO_VOB_PRIVATE (vob);
+
+	encoder->copy_video = brasero_vob_video_is_compliant (vob, info);
+	if (encoder->copy_video) {
+		gdouble rate;
+
+		/* Check the average bit rate of the whole file against the
+		 * maximum mux rate of the format; the stream being already
+		 * muxed this also accounts for audio and container overhead */
+		if (priv->is_video_dvd)
+			max_rate = BRASERO_DVD_MUX_RATE_MAX;
+		else if (priv->svcd)
+			max_rate = BRASERO_SVCD_MUX_RATE_MAX;
+		else
+			max_rate = BRASERO_VCD_MUX_RATE_MAX;
+
+		if (info->len > 0 && info->bytes > 0) {
+			rate = (gdouble) info->bytes * 8.0 * GST_SECOND / info->len;
+			if (rate > max_rate) {
+				BRASERO_JOB_LOG (vob, "Bit rate too high (%lf)", rate);
+				encoder->copy_video = FALSE;
+			}
+		}
+		else {
+			BRASERO_JOB_LOG (vob, "Unknown average bit rate");
+			encoder->copy_video = FALSE;
+		}
+	}
+
+	encoder->copy_audio = info->has_audio && brasero_vob_audio_is_compliant (vob, info);
+
+	BRASERO_JOB_LOG (vob,
+			 "%s: copy video %i, copy audio %i",
+			 info->uri,
+			 encoder->copy_video,
+			 encoder->copy_audio);
+}
+
+static gboolean
+brasero_vob_encoder_bus_messages (GstBus *bus,
+				  GstMessage *msg,
+				  BraseroVobEncoder *encoder);
+
+static gboolean
+brasero_vob_encoder_launch (BraseroVobEncoder *encoder,
+			    GError **error)
+{
+	BraseroVob *vob = encoder->vob;
+	BraseroVobPrivate *priv;
+	GstBus *bus;
+
+	priv = BRASERO_VOB_PRIVATE (vob);
+
+	brasero_vob_encoder_free_metadata (encoder);
+
+	/* build_pipeline () works on the private structure; the
+	 * elements it created are then handed over to the encoder */
+	if (!brasero_vob_build_pipeline (vob,
+					 encoder->track,
+					 encoder->output,
+					 encoder->copy_video,
+					 encoder->copy_audio,
+					 error))
+		return FALSE;
+
+	encoder->pipeline = priv->pipeline;
+	encoder->source = priv->source;
+	priv->pipeline = NULL;
+	priv->source = NULL;
+	priv->audio = NULL;
+	priv->video = NULL;
+
+	bus = gst_pipeline_get_bus (GST_PIPELINE (encoder->pipeline));
+	encoder->watch = gst_bus_add_watch (bus,
+					    (GstBusFunc) brasero_vob_encoder_bus_messages,
+					    encoder);
+	gst_object_unref (bus);
+
+	BRASERO_JOB_LOG (vob, "Starting transcoding to %s", encoder->output);
+	encoder->running = TRUE;
+	gst_element_set_state (encoder->pipeline, GST_STATE_PLAYING);
+	return TRUE;
+}
+
+static gboolean
+brasero_vob_encoders_run_cb (gpointer data);
+
+static void
+brasero_vob_encoder_probed_cb (BraseroMetadata *metadata,
+			       const GError *error,
+			       BraseroVobEncoder *encoder)
+{
+	BraseroMetadataInfo info = { NULL, };
+	BraseroVobPrivate *priv;
+
+	priv = BRASERO_VOB_PRIVATE (encoder->vob);
+
+	/* If the stream can't be identified just encode it */
+	if (!error && brasero_metadata_get_result (metadata, &info, NULL)) {
+		brasero_vob_encoder_check_streams (encoder, &info);
+		brasero_metadata_info_clear (&info);
+	}
+	else
+		BRASERO_JOB_LOG (encoder->vob, "Stream could not be identified");
+
+	/* Don't start the pipeline from within the signal emission */
+	encoder->probed = TRUE;
+	if (!priv->run_id)
+		priv->run_id = g_idle_add (brasero_vob_encoders_run_cb, encoder->vob);
+}
+
+static void
+brasero_vob_encoder_probe (BraseroVobEncoder *encoder)
+{
+	gchar *uri;
+
+	uri = brasero_track_stream_get_source (BRASERO_TRACK_STREAM (encoder->track), TRUE);
+
+	encoder->metadata = brasero_metadata_new ();
+	g_signal_connect (encoder->metadata,
+			  "completed",
+			  G_CALLBACK (brasero_vob_encoder_probed_cb),
+			  encoder);
+	brasero_metadata_get_info_async (encoder->metadata,
+					 uri,
+					 BRASERO_METADATA_FLAG_NONE);
+	g_free (uri);
+}
+
+static guint64
+brasero_vob_encoder_estimate_size (BraseroVobEncoder *encoder)
+{
+	BraseroVobPrivate *priv;
+	guint64 length = 0;
+	guint64 rate;
+
+	priv = BRASERO_VOB_PRIVATE (encoder->vob);
+
+	/* The highest mux rate of the format gives an upper bound */
+	if (priv->is_video_dvd)
+		rate = BRASERO_DVD_MUX_RATE_MAX;
+	else if (priv->svcd)
+		rate = BRASERO_SVCD_MUX_RATE_MAX;
+	else
+		rate = BRASERO_VCD_MUX_RATE_MAX;
+
+	brasero_track_stream_get_length (BRASERO_TRACK_STREAM (encoder->track), &length);
+	return length / GST_MSECOND * rate / 8000;
+}
+
+static gboolean
+brasero_vob_encoder_has_space (BraseroVobEncoder *encoder)
+{
+	BraseroVobPrivate *priv;
+	GFileInfo *info;
+	guint64 needed;
+	guint64 available;
+	GSList *iter;
+	GFile *file;
+	gchar *dir;
+
+	priv = BRASERO_VOB_PRIVATE (encoder->vob);
+
+	/* Room is needed for this title and for what the running encoders
+	 * have still to write */
+	needed = brasero_vob_encoder_estimate_size (encoder);
+	for (iter = priv->encoders; iter; iter = iter->next) {
+		BraseroVobEncoder *running;
+		struct stat buf;
+		guint64 size;
+
+		running = iter->data;
+		if (!running->running)
+			continue;
+
+		size = brasero_vob_encoder_estimate_size (running);
+		if (!g_stat (running->output, &buf))
+			size -= MIN (size, (guint64) buf.st_size);
+
+		needed += size;
+	}
+
+	dir = g_path_get_dirname (encoder->output);
+	file = g_file_new_for_path (dir);
+	g_free (dir);
+
+	info = g_file_query_filesystem_info (file,
+					     G_FILE_ATTRIBUTE_FILESYSTEM_FREE,
+					     NULL,
+					     NULL);
+	g_object_unref (file);
+
+	/* If we can't tell, don't hold the title back */
+	if (!info)
+		return TRUE;
+
+	available = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_FREE);
+	g_object_unref (info);
+
+	BRASERO_JOB_LOG (encoder->vob,
+			 "%" G_GUINT64_FORMAT " bytes needed, %" G_GUINT64_FORMAT " free",
+			 needed,
+			 available);
+
+	return needed <= available;
+}
+
+static gboolean
+brasero_vob_encoders_run (BraseroVob *vob,
+			  GError **error)
+{
+	BraseroVobPrivate *priv;
+	gboolean done = TRUE;
+	guint running = 0;
+	guint active = 0;
+	GSList *iter;
+
+	priv = BRASERO_VOB_PRIVATE (vob);
+
+	for (iter = priv->encoders; iter; iter = iter->next) {
+		BraseroVobEncoder *encoder;
+
+		encoder = iter->data;
+		if (encoder->done)
+			continue;
+
+		done = FALSE;
+		if (encoder->running || encoder->metadata)
+			active ++;
+
+		if (encoder->running)
+			running ++;
+	}
+
+	if (done) {
+		BRASERO_JOB_LOG (vob, "All titles were transcoded");
+		brasero_vob_encoders_finished (vob);
+		return TRUE;
+	}
+
+	/* Every title is first identified to know which of its streams
+	 * can be copied as they are; that takes a slot as well */
+	for (iter = priv->encoders; iter; iter = iter->next) {
+		BraseroVobEncoder *encoder;
+
+		encoder = iter->data;
+		if (encoder->done || encoder->running)
+			continue;
+
+		if (encoder->probed) {
+			/* All titles are written to the temporary directory
+			 * so start another one only if its output fits. If
+			 * none is running, go ahead: the job checked there
+			 * was room for the whole session. The next title to
+			 * finish runs this again. */
+			if (running && !brasero_vob_encoder_has_space (encoder)) {
+				BRASERO_JOB_LOG (vob, "Not enough space to start %s yet", encoder->output);
+				continue;
+			}
+
+			if (!brasero_vob_encoder_launch (encoder, error))
+				return FALSE;
+
+			running ++;
+			continue;
+		}
+
+		if (encoder->metadata || active >= priv->max_encoders)
+			continue;
+
+		brasero_vob_encoder_probe (encoder);
+		active ++;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+brasero_vob_encoders_run_cb (gpointer data)
+{
+	BraseroVob *vob = data;
+	BraseroVobPrivate *priv;
+	GError *error = NULL;
+
+	priv = BRASERO_VOB_PRIVATE (vob);
+	priv->run_id = 0;
+
+	if (!brasero_vob_encoders_run (vob, &error))
+		brasero_job_error (BRASERO_JOB (vob), error);
+
+	return FALSE;
+}
+
+static gboolean
+brasero_vob_encoder_bus_messages (GstBus *bus,
+				  GstMessage *msg,
+				  BraseroVobEncoder *encoder)
+{
+	BraseroVob *vob = encoder->vob;
+	GError *error = NULL;
+	gchar *debug;
+
+	switch (GST_MESSAGE_TYPE (msg)) {
+	case GST_MESSAGE_ERROR:
+		/* returning FALSE removes the watch */
+		encoder->watch = 0;
+
+		gst_message_parse_error (msg, &error, &debug);
+		BRASERO_JOB_LOG (vob, debug);
+		g_free (debug);
+
+		/* brasero_job_error () stops all the other encoders */
+	        brasero_job_error (BRASERO_JOB (vob), error);
+		return FALSE;
+
+	case GST_MESSAGE_EOS:
+		BRASERO_JOB_LOG (vob, "Transcoding to %s finished", encoder->output);
+		encoder->watch = 0;
+
+		brasero_vob_encoder_stop (encoder);
+		encoder->done = TRUE;
+
+		if (!brasero_vob_encoders_run (vob, &error))
+			brasero_job_error (BRASERO_JOB (vob), error);
+
+		return FALSE;
+
+	default:
+		return TRUE;
+	}
+
+	return TRUE;
+}
+
+static void
+brasero_vob_encoders_add (BraseroVob *vob,
+			  BraseroTrack *track,
+			  gchar *output)
+{
+	BraseroVobEncoder *encoder;
+	BraseroVobPrivate *priv;
+
+	priv = BRASERO_VOB_PRIVATE (vob);
+
+	encoder = g_new0 (BraseroVobEncoder, 1);
+	encoder->vob = vob;
+	encoder->track = g_object_ref (track);
+	encoder->output = output;
+	priv->encoders = g_slist_append (priv->encoders, encoder);
+}
+
 static BraseroBurnResult
 brasero_vob_start (BraseroJob *job,
 		   GError **error)
 {
+	GSList *tracks;
+	GValue *value = NULL;
 	BraseroVobPrivate *priv;
 	BraseroJobAction action;
 	BraseroTrackType *output = NULL;
@@ -1223,8 +2040,6 @@ brasero_vob_start (BraseroJob *job,
 	brasero_job_get_output_type (job, output);
 
 	if (brasero_track_type_get_stream_format (output) & BRASERO_VIDEO_FORMAT_VCD) {
-		GValue *value = NULL;
-
 		priv->is_video_dvd = FALSE;
 		brasero_job_tag_lookup (job,
 					BRASERO_VCD_TYPE,
@@ -1232,9 +2047,20 @@ brasero_vob_start (BraseroJob *job,
 		if (value)
 			priv->svcd = (g_value_get_int (value) == BRASERO_SVCD);
 	}
-	else
+	else {
 		priv->is_video_dvd = TRUE;
 
+		/* Get output audio format */
+		brasero_job_tag_lookup (job,
+					BRASERO_DVD_STREAM_FORMAT,
+					&value);
+		if (value)
+			priv->format = g_value_get_int (value);
+
+		if (priv->format == BRASERO_AUDIO_FORMAT_NONE)
+			priv->format = BRASERO_AUDIO_FORMAT_RAW;
+	}
+
 	BRASERO_JOB_LOG (job,
 			 "Got output type (is DVD %i, is SVCD %i)",
 			 priv->is_video_dvd,
@@ -1242,24 +2068,73 @@ brasero_vob_start (BraseroJob *job,
 
 	brasero_track_type_free (output);
 
-	if (!brasero_vob_build_pipeline (BRASERO_VOB (job), error))
-		return BRASERO_BURN_ERR;
+	/* Each title is encoded by its own pipeline; mpeg2enc and the
+	 * audio encoders are mostly single threaded so with several titles
+	 * in the session run a few pipelines at the same time. */
+	tracks = NULL;
+	brasero_job_get_tracks (job, &tracks);
+	if (priv->max_encoders > 1
+	&&  g_slist_length (tracks) > 1) {
+		priv->session = TRUE;
+
+		for (; tracks; tracks = tracks->next) {
+			BraseroBurnResult result;
+			gchar *output_path = NULL;
+
+			result = brasero_job_get_tmp_file (job,
+							   ".mpg",
+							   &output_path,
+							   error);
+			if (result != BRASERO_BURN_OK) {
+				brasero_vob_encoders_free (BRASERO_VOB (job));
+				return result;
+			}
+
+			brasero_vob_encoders_add (BRASERO_VOB (job),
+						  tracks->data,
+						  output_path);
+		}
+
+		BRASERO_JOB_LOG (job,
+				 "Transcoding %i titles, %i at a time",
+				 g_slist_length (priv->encoders),
+				 priv->max_encoders);
+
+		brasero_job_set_current_action (job,
+						BRASERO_BURN_ACTION_ANALYSING,
+						_("Converting video files to MPEG2"),
+						FALSE);
+	}
+	else {
+		BraseroTrack *track;
+		gchar *output_path = NULL;
+
+		priv->session = FALSE;
+
+		brasero_job_get_current_track (job, &track);
+		brasero_job_get_audio_output (job, &output_path);
+		brasero_vob_encoders_add (BRASERO_VOB (job), track, output_path);
+
+		brasero_job_set_current_action (job,
+						BRASERO_BURN_ACTION_ANALYSING,
+						_("Converting video file to MPEG2"),
+						FALSE);
+	}
 
 	/* ready to go */
-	brasero_job_set_current_action (job,
-					BRASERO_BURN_ACTION_ANALYSING,
-					_("Converting video file to MPEG2"),
-					FALSE);
 	brasero_job_start_progress (job, FALSE);
 
-	gst_element_set_state (priv->pipeline, GST_STATE_PLAYING);
+	if (!brasero_vob_encoders_run (BRASERO_VOB (job), error)) {
+		brasero_vob_encoders_free (BRASERO_VOB (job));
+		return BRASERO_BURN_ERR;
+	}
 
 	return BRASERO_BURN_OK;
 }
 
-static gdouble
-brasero_vob_get_progress_from_element (BraseroJob *job,
-				       GstElement *element)
+static gboolean
+brasero_vob_get_element_progress (GstElement *element,
+				  gdouble *progress)
 {
 	gint64 position = 0;
 	gint64 duration = 0;
@@ -1276,10 +2151,7 @@ brasero_vob_get_progress_from_element (BraseroJob *job,
 	}
 
 	if (duration > 0 && position >= 0) {
-		gdouble progress;
-
-		progress = (gdouble) position / (gdouble) duration;
-		brasero_job_set_progress (job, progress);
+		*progress = (gdouble) position / (gdouble) duration;
 		return TRUE;
 	}
 
@@ -1289,27 +2161,47 @@ brasero_vob_get_progress_from_element (BraseroJob *job,
 static BraseroBurnResult
 brasero_vob_clock_tick (BraseroJob *job)
 {
-
 	BraseroVobPrivate *priv;
+	gdouble total = 0.0;
+	GSList *iter;
 
 	priv = BRASERO_VOB_PRIVATE (job);
-
-	if (brasero_vob_get_progress_from_element (job, priv->pipeline))
+	if (!priv->encoders)
 		return BRASERO_BURN_OK;
 
-	BRASERO_JOB_LOG (job, "Pipeline failed to report position");
+	/* Every title counts for the same share of the progress */
+	for (iter = priv->encoders; iter; iter = iter->next) {
+		BraseroVobEncoder *encoder;
+		gdouble progress = 0.0;
 
-	if (brasero_vob_get_progress_from_element (job, priv->source))
-		return BRASERO_BURN_OK;
+		encoder = iter->data;
+		if (encoder->done)
+			progress = 1.0;
+		else if (encoder->running
+		     && !brasero_vob_get_element_progress (encoder->pipeline, &progress)
+		     && !brasero_vob_get_element_progress (encoder->source, &progress))
+			progress = 0.0;
 
-	BRASERO_JOB_LOG (job, "Source failed to report position");
+		total += progress;
+	}
 
+	brasero_job_set_progress (job, total / g_slist_length (priv->encoders));
 	return BRASERO_BURN_OK;
 }
 
 static void
 brasero_vob_init (BraseroVob *object)
-{}
+{
+	BraseroVobPrivate *priv;
+	glong cpus;
+
+	priv = BRASERO_VOB_PRIVATE (object);
+
+	/* Half the cores: every pipeline already runs a few threads
+	 * (decoder, queues, muxer) besides the encoders */
+	cpus = sysconf (_SC_NPROCESSORS_ONLN);
+	priv->max_encoders = MAX (1, cpus / 2);
+}
 
 static void
 brasero_vob_finalize (GObject *object)
@@ -1318,6 +2210,8 @@ brasero_vob_finalize (GObject *object)
 
 	priv = BRASERO_VOB_PRIVATE (object);
 
+	brasero_vob_encoders_free (BRASERO_VOB (object));
+
 	if (priv->pipeline) {
 		gst_object_unref (priv->pipeline);
 		priv->pipeline = NULL;
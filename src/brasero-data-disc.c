@@ -715,6 +715,33 @@ brasero_data_disc_unknown_uri_cb (BraseroTrackDataCfg *vfs,
 	g_free (name);
 }
 
+static void
+brasero_data_disc_snapshot_revalidated_cb (BraseroTrackDataCfg *project,
+					   guint changed,
+					   BraseroDataDisc *self)
+{
+	BraseroDataDiscPrivate *priv;
+	GtkWidget *message;
+	gchar *string;
+
+	if (!changed)
+		return;
+
+	priv = BRASERO_DATA_DISC_PRIVATE (self);
+
+	string = g_strdup_printf (ngettext ("%u file changed since the project was saved.",
+					    "%u files changed since the project was saved.",
+					    changed),
+				  changed);
+	message = brasero_notify_message_add (priv->message,
+					      string,
+					      _("The project was updated accordingly."),
+					      10000,
+					      BRASERO_NOTIFY_CONTEXT_LOADING);
+	gtk_info_bar_set_message_type (GTK_INFO_BAR (message), GTK_MESSAGE_INFO);
+	g_free (string);
+}
+
 static void
 brasero_data_disc_joliet_rename_cb (BraseroTrackDataCfg *project,
 				    BraseroDataDisc *self)
@@ -1459,6 +1486,10 @@ brasero_data_disc_set_track (BraseroDataDisc *disc,
 			  "unknown-uri",
 			  G_CALLBACK (brasero_data_disc_unknown_uri_cb),
 			  disc);
+	g_signal_connect (track,
+			  "snapshot-revalidated",
+			  G_CALLBACK (brasero_data_disc_snapshot_revalidated_cb),
+			  disc);
 
 	g_signal_connect (track,
 			  "session-available",
@@ -1614,6 +1645,9 @@ brasero_data_disc_unset_track (BraseroDataDisc *disc)
 	g_signal_handlers_disconnect_by_func (priv->project,
 					      brasero_data_disc_unknown_uri_cb,
 					      disc);
+	g_signal_handlers_disconnect_by_func (priv->project,
+					      brasero_data_disc_snapshot_revalidated_cb,
+					      disc);
 	g_signal_handlers_disconnect_by_func (priv->project,
 					      brasero_data_disc_session_available_cb,
 					      disc);
@@ -30,12 +30,17 @@
 #  include <config.h>
 #endif
 
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
 #include <glib.h>
 #include <glib/gstdio.h>
 #include <glib/gi18n.h>
 
 #include <libxml/xmlerror.h>
 #include <libxml/xmlwriter.h>
+#include <libxml/xmlreader.h>
 #include <libxml/parser.h>
 #include <libxml/xmlstring.h>
 #include <libxml/uri.h>
@@ -47,6 +52,8 @@
 #include "brasero-project-parse.h"
 #include "brasero-app.h"
 
+#include "brasero-lru-cache.h"
+
 #include "brasero-units.h"
 #include "brasero-track-stream-cfg.h"
 #include "brasero-track-data-cfg.h"
@@ -55,6 +62,9 @@
 
 #define BRASERO_PROJECT_VERSION "0.2"
 
+/* Maximum number of project snapshots kept in the cache */
+#define BRASERO_PROJECT_SNAPSHOT_MAX_ENTRIES	16
+
 static void
 brasero_project_invalid_project_dialog (const char *reason)
 {
@@ -64,6 +74,227 @@ brasero_project_invalid_project_dialog (const char *reason)
 			   GTK_MESSAGE_ERROR);
 }
 
+/**
+ * Projects are read with a xmlTextReader so that only one element at a time
+ * (a graft point, an audio track, ...) is expanded in memory.
+ */
+
+/* Moves @reader to the next child element of the element at @depth. It
+ * returns 1 if there is one, 0 when the end of the parent element has been
+ * reached and -1 on error. */
+static gint
+_reader_next_child (xmlTextReaderPtr reader,
+		    gint depth,
+		    gboolean first)
+{
+	gint result;
+
+	if (first) {
+		if (xmlTextReaderIsEmptyElement (reader))
+			return 0;
+
+		result = xmlTextReaderRead (reader);
+	}
+	else	/* Skip the subtree of the previous child */
+		result = xmlTextReaderNext (reader);
+
+	while (result == 1) {
+		if (xmlTextReaderDepth (reader) <= depth)
+			return 0;
+
+		if (xmlTextReaderNodeType (reader) == XML_READER_TYPE_ELEMENT)
+			return 1;
+
+		result = xmlTextReaderNext (reader);
+	}
+
+	return result;
+}
+
+static xmlChar *
+_reader_get_string (xmlTextReaderPtr reader)
+{
+	xmlNodePtr node;
+
+	node = xmlTextReaderExpand (reader);
+	if (!node)
+		return NULL;
+
+	return xmlNodeListGetString (node->doc, node->xmlChildrenNode, 1);
+}
+
+static gchar *
+brasero_project_get_snapshot_name (const gchar *path)
+{
+	return g_compute_checksum_for_string (G_CHECKSUM_SHA1, path, -1);
+}
+
+static gchar *
+brasero_project_get_snapshot_path (const gchar *path)
+{
+	gchar *checksum;
+	gchar *snapshot;
+
+	checksum = brasero_project_get_snapshot_name (path);
+	snapshot = g_build_filename (g_get_user_cache_dir (),
+				     "brasero",
+				     "snapshots",
+				     checksum,
+				     NULL);
+	g_free (checksum);
+
+	return snapshot;
+}
+
+static gchar *
+brasero_project_get_snapshot_tag (const gchar *path)
+{
+	struct stat buffer;
+
+	/* A snapshot is only valid for the exact project file it was saved
+	 * with; any later modification invalidates it. */
+	if (g_stat (path, &buffer))
+		return NULL;
+
+	return g_strdup_printf ("%"G_GINT64_FORMAT":%"G_GINT64_FORMAT,
+				(gint64) buffer.st_mtime,
+				(gint64) buffer.st_size);
+}
+
+/**
+ * An index records the tag of each snapshot and when it was last used so
+ * that only the most recent ones are kept and the outdated ones removed.
+ */
+
+static gchar *
+brasero_project_snapshot_index_get_path (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "brasero",
+				 "snapshots",
+				 "index",
+				 NULL);
+}
+
+static void
+brasero_project_snapshot_removed_cb (GKeyFile *key_file,
+				     const gchar *name,
+				     gpointer user_data)
+{
+	gchar *snapshot;
+
+	snapshot = g_build_filename (g_get_user_cache_dir (),
+				     "brasero",
+				     "snapshots",
+				     name,
+				     NULL);
+	g_remove (snapshot);
+	g_free (snapshot);
+}
+
+static void
+brasero_project_snapshot_index_save (GKeyFile *key_file)
+{
+	GError *error = NULL;
+	gchar *path;
+
+	path = brasero_project_snapshot_index_get_path ();
+	if (!brasero_lru_cache_save (key_file, path, 0, &error)) {
+		g_warning ("Project snapshot index could not be saved: %s", error->message);
+		g_error_free (error);
+	}
+	g_free (path);
+}
+
+static void
+brasero_project_snapshot_index_add (const gchar *path,
+				    const gchar *tag)
+{
+	GKeyFile *key_file;
+	gchar *index;
+	gchar *name;
+
+	index = brasero_project_snapshot_index_get_path ();
+	key_file = brasero_lru_cache_load (index, 0);
+	g_free (index);
+
+	name = brasero_project_get_snapshot_name (path);
+	g_key_file_set_string (key_file, name, "tag", tag);
+	brasero_lru_cache_touch (key_file, name);
+	g_free (name);
+
+	brasero_lru_cache_prune (key_file,
+				 BRASERO_PROJECT_SNAPSHOT_MAX_ENTRIES,
+				 brasero_project_snapshot_removed_cb,
+				 NULL);
+
+	brasero_project_snapshot_index_save (key_file);
+	g_key_file_free (key_file);
+}
+
+/* Returns TRUE if the snapshot of the project at @path can be used with
+ * @tag. Otherwise it is deleted. */
+static gboolean
+brasero_project_snapshot_index_check (const gchar *path,
+				      const gchar *tag)
+{
+	GKeyFile *key_file;
+	gboolean valid;
+	gchar *index;
+	gchar *saved;
+	gchar *name;
+
+	index = brasero_project_snapshot_index_get_path ();
+	key_file = brasero_lru_cache_load (index, 0);
+	g_free (index);
+
+	name = brasero_project_get_snapshot_name (path);
+	saved = g_key_file_get_string (key_file, name, "tag", NULL);
+	valid = (saved && tag && !strcmp (saved, tag));
+
+	if (valid)
+		brasero_lru_cache_touch (key_file, name);
+	else {
+		/* The project was changed (or removed) since then */
+		brasero_project_snapshot_removed_cb (key_file, name, NULL);
+		g_key_file_remove_group (key_file, name, NULL);
+	}
+
+	if (valid || saved)
+		brasero_project_snapshot_index_save (key_file);
+
+	g_key_file_free (key_file);
+	g_free (saved);
+	g_free (name);
+
+	return valid;
+}
+
+/**
+ * Deletes the snapshot of the project at @uri if it does not match the
+ * project file any more, for example when it was modified by another
+ * program or removed. Called when the project is closed.
+ */
+
+void
+brasero_project_close_snapshot (const gchar *uri)
+{
+	GFile *file;
+	gchar *path;
+	gchar *tag;
+
+	file = g_file_new_for_commandline_arg (uri);
+	path = g_file_get_path (file);
+	g_object_unref (file);
+	if (!path)
+		return;
+
+	tag = brasero_project_get_snapshot_tag (path);
+	brasero_project_snapshot_index_check (path, tag);
+	g_free (tag);
+	g_free (path);
+}
+
 static GSList *
 _read_graft_point (xmlDocPtr project,
 		   xmlNodePtr graft,
@@ -115,62 +346,77 @@ error:
 }
 
 static BraseroTrack *
-_read_data_track (xmlDocPtr project,
-		  xmlNodePtr item)
+_read_data_track (xmlTextReaderPtr reader,
+		  const gchar *snapshot,
+		  const gchar *tag)
 {
 	BraseroTrackDataCfg *track;
         GSList *grafts= NULL;
         GSList *excluded = NULL;
+	gint result;
+	gint depth;
 
 	track = brasero_track_data_cfg_new ();
 
-	while (item) {
-		if (!xmlStrcmp (item->name, (const xmlChar *) "graft")) {
-			if (!(grafts = _read_graft_point (project, item->xmlChildrenNode, grafts)))
+	depth = xmlTextReaderDepth (reader);
+	result = _reader_next_child (reader, depth, TRUE);
+	while (result == 1) {
+		const xmlChar *name;
+
+		name = xmlTextReaderConstName (reader);
+		if (!xmlStrcmp (name, (const xmlChar *) "graft")) {
+			xmlNodePtr graft;
+
+			graft = xmlTextReaderExpand (reader);
+			if (!graft)
+				goto error;
+
+			if (!(grafts = _read_graft_point (graft->doc, graft->xmlChildrenNode, grafts)))
 				goto error;
 		}
-		else if (!xmlStrcmp (item->name, (const xmlChar *) "icon")) {
+		else if (!xmlStrcmp (name, (const xmlChar *) "icon")) {
 			xmlChar *icon_path;
 
-			icon_path = xmlNodeListGetString (project,
-							  item->xmlChildrenNode,
-							  1);
+			icon_path = _reader_get_string (reader);
 			if (!icon_path)
 				goto error;
 
 			brasero_track_data_cfg_set_icon (track, (gchar *) icon_path, NULL);
                         g_free (icon_path);
 		}
-		else if (!xmlStrcmp (item->name, (const xmlChar *) "restored")) {
+		else if (!xmlStrcmp (name, (const xmlChar *) "restored")) {
 			xmlChar *restored;
 
-			restored = xmlNodeListGetString (project,
-							 item->xmlChildrenNode,
-							 1);
+			restored = _reader_get_string (reader);
 			if (!restored)
 				goto error;
 
                         brasero_track_data_cfg_dont_filter_uri (track, (gchar *) restored);
                         g_free (restored);
 		}
-		else if (!xmlStrcmp (item->name, (const xmlChar *) "excluded")) {
+		else if (!xmlStrcmp (name, (const xmlChar *) "excluded")) {
 			xmlChar *excluded_uri;
 
-			excluded_uri = xmlNodeListGetString (project,
-							     item->xmlChildrenNode,
-							     1);
+			excluded_uri = _reader_get_string (reader);
 			if (!excluded_uri)
 				goto error;
 
 			excluded = g_slist_prepend (excluded, xmlURIUnescapeString ((char*) excluded_uri, 0, NULL));
 			g_free (excluded_uri);
 		}
-		else if (item->type == XML_ELEMENT_NODE)
+		else
 			goto error;
 
-		item = item->next;
+		result = _reader_next_child (reader, depth, FALSE);
 	}
 
+	if (result < 0)
+		goto error;
+
+	/* This must be done before the contents are set */
+	if (snapshot && tag)
+		brasero_track_data_cfg_load_snapshot (track, snapshot, tag);
+
         grafts = g_slist_reverse (grafts);
         excluded = g_slist_reverse (excluded);
         brasero_track_data_set_source (BRASERO_TRACK_DATA (track),
@@ -363,48 +609,55 @@ error:
 }
 
 static gboolean
-_get_tracks (xmlDocPtr project,
-	     xmlNodePtr track_node,
-	     BraseroBurnSession *session)
+_get_tracks (xmlTextReaderPtr reader,
+	     BraseroBurnSession *session,
+	     const gchar *snapshot,
+	     const gchar *tag)
 {
 	GSList *tracks = NULL;
 	GSList *iter;
+	gint result;
+	gint depth;
 
-	track_node = track_node->xmlChildrenNode;
-
-	while (track_node) {
+	depth = xmlTextReaderDepth (reader);
+	result = _reader_next_child (reader, depth, TRUE);
+	while (result == 1) {
 		BraseroTrack *newtrack;
+		const xmlChar *name;
 
-		if (!xmlStrcmp (track_node->name, (const xmlChar *) "audio")) {
-			newtrack = _read_audio_track (project, track_node->xmlChildrenNode, FALSE);
-			if (!newtrack)
-				goto error;
+		name = xmlTextReaderConstName (reader);
+		if (!xmlStrcmp (name, (const xmlChar *) "audio")
+		||  !xmlStrcmp (name, (const xmlChar *) "video")) {
+			xmlNodePtr track_node;
 
-			tracks = g_slist_append (tracks, newtrack);
-		}
-		else if (!xmlStrcmp (track_node->name, (const xmlChar *) "data")) {
-			newtrack = _read_data_track (project, track_node->xmlChildrenNode);
+			/* Stream tracks are small enough to be expanded */
+			track_node = xmlTextReaderExpand (reader);
+			if (!track_node)
+				goto error;
 
+			newtrack = _read_audio_track (track_node->doc,
+						      track_node->xmlChildrenNode,
+						      !xmlStrcmp (name, (const xmlChar *) "video"));
 			if (!newtrack)
 				goto error;
 
 			tracks = g_slist_append (tracks, newtrack);
 		}
-		else if (!xmlStrcmp (track_node->name, (const xmlChar *) "video")) {
-			newtrack = _read_audio_track (project, track_node->xmlChildrenNode, TRUE);
+		else if (!xmlStrcmp (name, (const xmlChar *) "data")) {
+			newtrack = _read_data_track (reader, snapshot, tag);
 
 			if (!newtrack)
 				goto error;
 
 			tracks = g_slist_append (tracks, newtrack);
 		}
-		else if (track_node->type == XML_ELEMENT_NODE)
+		else
 			goto error;
 
-		track_node = track_node->next;
+		result = _reader_next_child (reader, depth, FALSE);
 	}
 
-	if (!tracks)
+	if (result < 0 || !tracks)
 		goto error;
 
 	for (iter = tracks; iter; iter = iter->next) {
@@ -434,12 +687,13 @@ brasero_project_open_project_xml (const gchar *uri,
 				  BraseroBurnSession *session,
 				  gboolean warn_user)
 {
-	xmlNodePtr track_node = NULL;
+	xmlTextReaderPtr reader;
+	gboolean has_track = FALSE;
+	gchar *snapshot = NULL;
 	gchar *label = NULL;
 	gchar *cover = NULL;
-	xmlDocPtr project;
-	xmlNodePtr item;
-	gboolean retval;
+	gchar *tag = NULL;
+	gint result;
 	GFile *file;
 	gchar *path;
 
@@ -450,71 +704,98 @@ brasero_project_open_project_xml (const gchar *uri,
 		return FALSE;
 
 	/* start parsing xml doc */
-	project = xmlParseFile (path);
-    	g_free (path);
-
-	if (!project) {
+	reader = xmlReaderForFile (path, NULL, 0);
+	if (!reader) {
+		g_free (path);
 	    	if (warn_user)
 			brasero_project_invalid_project_dialog (_("The project could not be opened"));
 
 		return FALSE;
 	}
 
+	tag = brasero_project_get_snapshot_tag (path);
+	if (brasero_project_snapshot_index_check (path, tag))
+		snapshot = brasero_project_get_snapshot_path (path);
+    	g_free (path);
+
 	/* parses the "header" */
-	item = xmlDocGetRootElement (project);
-	if (!item) {
+	do {
+		result = xmlTextReaderRead (reader);
+	} while (result == 1 && xmlTextReaderNodeType (reader) != XML_READER_TYPE_ELEMENT);
+
+	if (result != 1) {
 	    	if (warn_user)
-			brasero_project_invalid_project_dialog (_("The file is empty"));
+			brasero_project_invalid_project_dialog (result < 0 ?
+								_("The project could not be opened"):
+								_("The file is empty"));
 
-		xmlFreeDoc (project);
+		xmlFreeTextReader (reader);
+		g_free (snapshot);
+		g_free (tag);
 		return FALSE;
 	}
 
-	if (xmlStrcmp (item->name, (const xmlChar *) "braseroproject")
-	||  item->next)
+	if (xmlStrcmp (xmlTextReaderConstName (reader), (const xmlChar *) "braseroproject"))
 		goto error;
 
-	item = item->children;
-	while (item) {
-		if (!xmlStrcmp (item->name, (const xmlChar *) "version")) {
+	result = _reader_next_child (reader, 0, TRUE);
+	while (result == 1) {
+		const xmlChar *name;
+
+		name = xmlTextReaderConstName (reader);
+		if (!xmlStrcmp (name, (const xmlChar *) "version")) {
 			/* simply ignore it */
 		}
-		else if (!xmlStrcmp (item->name, (const xmlChar *) "label")) {
-			label = (gchar *) xmlNodeListGetString (project,
-								item->xmlChildrenNode,
-								1);
+		else if (!xmlStrcmp (name, (const xmlChar *) "label")) {
+			if (label)
+				g_free (label);
+
+			label = (gchar *) _reader_get_string (reader);
 			if (!(label))
 				goto error;
 		}
-		else if (!xmlStrcmp (item->name, (const xmlChar *) "cover")) {
+		else if (!xmlStrcmp (name, (const xmlChar *) "cover")) {
 			xmlChar *escaped;
 
-			escaped = xmlNodeListGetString (project,
-							item->xmlChildrenNode,
-							1);
+			escaped = _reader_get_string (reader);
 			if (!escaped)
 				goto error;
 
+			if (cover)
+				g_free (cover);
+
 			cover = g_uri_unescape_string ((char *) escaped, NULL);
 			g_free (escaped);
 		}
-		else if (!xmlStrcmp (item->name, (const xmlChar *) "track")) {
-			if (track_node)
+		else if (!xmlStrcmp (name, (const xmlChar *) "track")) {
+			if (has_track)
+				goto error;
+
+			/* NOTE: tracks are added to the session as soon as they
+			 * are read; which is not a problem since if it fails
+			 * the session is discarded. */
+			if (!_get_tracks (reader, session, snapshot, tag))
 				goto error;
 
-			track_node = item;
+			has_track = TRUE;
 		}
-		else if (item->type == XML_ELEMENT_NODE)
+		else
 			goto error;
 
-		item = item->next;
+		result = _reader_next_child (reader, 0, FALSE);
 	}
 
-	retval = _get_tracks (project, track_node, session);
-	if (!retval)
+	if (result < 0 || !has_track)
 		goto error;
 
-	xmlFreeDoc (project);
+	/* Make sure the rest of the document is well formed */
+	while ((result = xmlTextReaderRead (reader)) == 1);
+	if (result < 0)
+		goto error;
+
+	xmlFreeTextReader (reader);
+	g_free (snapshot);
+	g_free (tag);
 
         brasero_burn_session_set_label (session, label);
         g_free (label);
@@ -532,7 +813,7 @@ brasero_project_open_project_xml (const gchar *uri,
                 g_free (cover);
         }
 
-        return retval;
+        return TRUE;
 
 error:
 
@@ -541,7 +822,10 @@ error:
 	if (label)
 		g_free (label);
 
-	xmlFreeDoc (project);
+	g_free (snapshot);
+	g_free (tag);
+
+	xmlFreeTextReader (reader);
     	if (warn_user)
 		brasero_project_invalid_project_dialog (_("It does not seem to be a valid Brasero project"));
 
@@ -804,6 +1088,42 @@ _save_data_track_xml (xmlTextWriter *project,
 	return TRUE;
 }
 
+static void
+brasero_project_save_snapshot (BraseroBurnSession *session,
+			       const gchar *path)
+{
+	gchar *snapshot;
+	GSList *tracks;
+	gchar *tag;
+
+	snapshot = brasero_project_get_snapshot_path (path);
+	tag = brasero_project_get_snapshot_tag (path);
+
+	/* Remove any older snapshot: it is of no use any more */
+	brasero_project_snapshot_index_check (path, NULL);
+
+	tracks = brasero_burn_session_get_tracks (session);
+	for (; tracks && tag; tracks = tracks->next) {
+		GError *error = NULL;
+
+		if (!BRASERO_IS_TRACK_DATA_CFG (tracks->data))
+			continue;
+
+		if (brasero_track_data_cfg_save_snapshot (tracks->data, snapshot, tag, &error))
+			brasero_project_snapshot_index_add (path, tag);
+		else if (error) {
+			g_warning ("Project snapshot could not be saved: %s", error->message);
+			g_error_free (error);
+		}
+
+		/* There is only one data track per project */
+		break;
+	}
+
+	g_free (snapshot);
+	g_free (tag);
+}
+
 gboolean 
 brasero_project_save_project_xml (BraseroBurnSession *session,
 				  const gchar *uri)
@@ -932,6 +1252,9 @@ brasero_project_save_project_xml (BraseroBurnSession *session,
 
 	xmlTextWriterEndDocument (project);
 	xmlFreeTextWriter (project);
+
+	brasero_project_save_snapshot (session, path);
+
 	g_free (path);
 	return TRUE;
 
@@ -75,6 +75,9 @@ brasero_project_save_audio_project_playlist (BraseroBurnSession *session,
 					     const gchar *uri,
 					     BraseroProjectSave type);
 
+void
+brasero_project_close_snapshot (const gchar *uri);
+
 G_END_DECLS
 
 #endif
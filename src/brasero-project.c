@@ -1191,8 +1191,10 @@ brasero_project_finalize (GObject *object)
 		cobj->priv->session = NULL;
 	}
 
-	if (cobj->priv->project)
+	if (cobj->priv->project) {
+		brasero_project_close_snapshot (cobj->priv->project);
 		g_free (cobj->priv->project);
+	}
 
 	if (cobj->priv->cover)
 		g_free (cobj->priv->cover);
@@ -1733,6 +1735,7 @@ brasero_project_reset (BraseroProject *project)
 	}
 
 	if (project->priv->project) {
+		brasero_project_close_snapshot (project->priv->project);
 		g_free (project->priv->project);
 		project->priv->project = NULL;
 	}
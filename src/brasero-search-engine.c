@@ -322,18 +322,40 @@ brasero_search_engine_base_init (gpointer g_class)
 
 #ifdef BUILD_SEARCH
 
-#ifdef BUILD_TRACKER
+#ifdef BUILD_SEARCH_INDEX
+#include "brasero-search-index.h"
+#endif
 
+#ifdef BUILD_TRACKER
 #include "brasero-search-tracker.h"
+#endif
 
 BraseroSearchEngine *
 brasero_search_engine_new_default (void)
 {
-	return g_object_new (BRASERO_TYPE_SEARCH_TRACKER, NULL);
-}
+	BraseroSearchEngine *engine = NULL;
+
+#ifdef BUILD_TRACKER
+	/* Prefer Tracker. Without the index keep it even if it is not
+	 * running yet as it becomes available once Tracker is started. */
+	engine = g_object_new (BRASERO_TYPE_SEARCH_TRACKER, NULL);
+#ifdef BUILD_SEARCH_INDEX
+	if (!brasero_search_engine_is_available (engine)) {
+		g_object_unref (engine);
+		engine = NULL;
+	}
+#endif
+#endif
 
+#ifdef BUILD_SEARCH_INDEX
+	/* The index is only used without Tracker */
+	if (!engine)
+		engine = g_object_new (BRASERO_TYPE_SEARCH_INDEX, NULL);
 #endif
 
+	return engine;
+}
+
 #else
 
 BraseroSearchEngine *
@@ -0,0 +1,2170 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * brasero
+ * Copyright (C) Rouquier Philippe 2009 <bonfire-app@wanadoo.fr>
+ * 
+ * brasero is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * brasero is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include <string.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+
+#include <gtk/gtk.h>
+
+#include "brasero-search-index.h"
+#include "brasero-search-engine.h"
+
+/**
+ * The index keeps the name, the (fast) mime type and the directory of all
+ * the files found in the user's media directories. Names are case folded
+ * and each sequence of three bytes (trigram) points to the files whose
+ * name contains it so that a keyword only needs to be checked against the
+ * files listed for its rarest trigram.
+ * The whole index is saved in the cache directory along with the
+ * modification time of every directory; at startup only the directories
+ * that changed are read again. While running, the index is kept up to
+ * date with directory monitors; the directories that are not monitored are
+ * checked regularly for changes of their modification time. Queries, saves
+ * and these checks are run in threads; the data is protected by a mutex.
+ */
+
+#define BRASERO_SEARCH_INDEX_MAGIC		0x49535242	/* "BRSI" */
+#define BRASERO_SEARCH_INDEX_VERSION		1
+
+#define BRASERO_SEARCH_INDEX_SAVE_DELAY		30
+
+/* Each monitor takes an inotify watch and these are shared with the
+ * monitoring of the project files, so only watch the directories closest
+ * to the roots. Changes in the others are found by checking their
+ * modification time every BRASERO_SEARCH_INDEX_RESCAN_DELAY seconds. */
+#define BRASERO_SEARCH_INDEX_MAX_MONITORS	128
+#define BRASERO_SEARCH_INDEX_RESCAN_DELAY	300
+
+#define BRASERO_SEARCH_INDEX_FILE_ATTRIBUTES					\
+	G_FILE_ATTRIBUTE_STANDARD_NAME ","					\
+	G_FILE_ATTRIBUTE_STANDARD_TYPE ","					\
+	G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN ","					\
+	G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE ","				\
+	G_FILE_ATTRIBUTE_TIME_MODIFIED
+
+typedef struct _BraseroSearchIndexHeader BraseroSearchIndexHeader;
+struct _BraseroSearchIndexHeader {
+	guint32 magic;
+	guint32 version;
+	guint32 pool_len;
+	guint32 mimes_num;
+	guint32 dirs_num;
+	guint32 entries_num;
+	guint32 trigrams_num;
+	guint32 postings_num;
+};
+
+typedef struct _BraseroSearchIndexDir BraseroSearchIndexDir;
+struct _BraseroSearchIndexDir {
+	guint64 mtime;
+	guint32 path;
+	guint32 removed;
+};
+
+typedef struct _BraseroSearchIndexEntry BraseroSearchIndexEntry;
+struct _BraseroSearchIndexEntry {
+	guint32 path;
+	guint32 key;
+	guint32 parent;
+	guint16 mime;
+	guint8 scope;
+	guint8 removed;
+};
+
+typedef struct _BraseroSearchIndexData BraseroSearchIndexData;
+struct _BraseroSearchIndexData {
+	/* All strings are stored here NUL terminated */
+	GString *pool;
+
+	/* Interned mime types */
+	GPtrArray *mimes;
+	GHashTable *mime_ids;
+
+	GArray *dirs;
+	GHashTable *dir_paths;
+
+	GArray *entries;
+	GHashTable *trigrams;
+};
+
+typedef struct _BraseroSearchIndexHit BraseroSearchIndexHit;
+struct _BraseroSearchIndexHit {
+	gchar *uri;
+	const gchar *mime;
+	gint score;
+	guint32 id;
+};
+
+typedef struct _BraseroSearchIndexQuery BraseroSearchIndexQuery;
+struct _BraseroSearchIndexQuery {
+	BraseroSearchScope scope;
+	gchar **keywords;
+	gchar **mimes;
+
+	/* Only used by threads */
+	GCancellable *cancel;
+	GPtrArray *hits;
+};
+
+typedef struct _BraseroSearchIndexPrivate BraseroSearchIndexPrivate;
+struct _BraseroSearchIndexPrivate
+{
+	/* NULL as long as it is being loaded. Once loaded it is accessed by
+	 * the query and save threads so it must be locked. */
+	BraseroSearchIndexData *data;
+	GMutex *mutex;
+
+	GThread *thread;
+	BraseroSearchIndexData *loaded;
+	volatile gint cancel;
+	guint ready_id;
+
+	GHashTable *monitors;
+	guint save_id;
+	guint saving:1;
+
+	guint rescan_id;
+	guint rescanning:1;
+
+	/* Set when the index changed while a query was running */
+	guint requery:1;
+
+	GCancellable *query_cancel;
+	GPtrArray *results;
+
+	BraseroSearchIndexQuery query;
+};
+
+#define BRASERO_SEARCH_INDEX_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_SEARCH_INDEX, BraseroSearchIndexPrivate))
+
+static void brasero_search_index_init_engine (BraseroSearchEngineIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (BraseroSearchIndex,
+			 brasero_search_index,
+			 G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (BRASERO_TYPE_SEARCH_ENGINE,
+					        brasero_search_index_init_engine));
+
+/**
+ * Index data
+ */
+
+#define BRASERO_SEARCH_INDEX_STRING(data, offset)	((data)->pool->str + (offset))
+#define BRASERO_SEARCH_INDEX_ENTRY(data, id)		(&g_array_index ((data)->entries, BraseroSearchIndexEntry, (id)))
+#define BRASERO_SEARCH_INDEX_DIR(data, index)		(&g_array_index ((data)->dirs, BraseroSearchIndexDir, (index)))
+
+#define BRASERO_SEARCH_INDEX_TRIGRAM(key)					\
+	(((guint32) (guchar) (key) [0] << 16) |					\
+	 ((guint32) (guchar) (key) [1] << 8)  |					\
+	  (guint32) (guchar) (key) [2])
+
+static void
+brasero_search_index_postings_free (GArray *postings)
+{
+	g_array_free (postings, TRUE);
+}
+
+static BraseroSearchIndexData *
+brasero_search_index_data_new (void)
+{
+	BraseroSearchIndexData *data;
+
+	data = g_new0 (BraseroSearchIndexData, 1);
+
+	/* Offset 0 is the empty string */
+	data->pool = g_string_sized_new (4096);
+	g_string_append_c (data->pool, '\0');
+
+	data->mimes = g_ptr_array_new ();
+	data->mime_ids = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	data->dirs = g_array_new (FALSE, FALSE, sizeof (BraseroSearchIndexDir));
+	data->dir_paths = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	data->entries = g_array_new (FALSE, FALSE, sizeof (BraseroSearchIndexEntry));
+	data->trigrams = g_hash_table_new_full (g_direct_hash,
+						g_direct_equal,
+						NULL,
+						(GDestroyNotify) brasero_search_index_postings_free);
+	return data;
+}
+
+static void
+brasero_search_index_data_free (BraseroSearchIndexData *data)
+{
+	g_string_free (data->pool, TRUE);
+	g_ptr_array_free (data->mimes, TRUE);
+	g_hash_table_destroy (data->mime_ids);
+	g_array_free (data->dirs, TRUE);
+	g_hash_table_destroy (data->dir_paths);
+	g_array_free (data->entries, TRUE);
+	g_hash_table_destroy (data->trigrams);
+	g_free (data);
+}
+
+static guint32
+brasero_search_index_data_add_string (BraseroSearchIndexData *data,
+				      const gchar *string)
+{
+	guint32 offset;
+
+	offset = data->pool->len;
+	g_string_append_len (data->pool, string, strlen (string) + 1);
+	return offset;
+}
+
+static guint16
+brasero_search_index_data_get_mime (BraseroSearchIndexData *data,
+				    const gchar *mime)
+{
+	const gchar *interned;
+	gpointer id;
+
+	interned = g_intern_string (mime ? mime:"application/octet-stream");
+	id = g_hash_table_lookup (data->mime_ids, interned);
+	if (id)
+		return GPOINTER_TO_UINT (id) - 1;
+
+	/* That many different mime types is not realistic */
+	if (data->mimes->len >= G_MAXUINT16)
+		return 0;
+
+	g_ptr_array_add (data->mimes, (gpointer) interned);
+	g_hash_table_insert (data->mime_ids,
+			     (gpointer) interned,
+			     GUINT_TO_POINTER (data->mimes->len));
+	return data->mimes->len - 1;
+}
+
+static BraseroSearchScope
+brasero_search_index_scope_from_mime (const gchar *mime)
+{
+	if (!mime)
+		return BRASERO_SEARCH_SCOPE_ANY;
+
+	if (g_str_has_prefix (mime, "audio/"))
+		return BRASERO_SEARCH_SCOPE_MUSIC;
+
+	if (g_str_has_prefix (mime, "video/"))
+		return BRASERO_SEARCH_SCOPE_VIDEO;
+
+	if (g_str_has_prefix (mime, "image/"))
+		return BRASERO_SEARCH_SCOPE_PICTURES;
+
+	if (g_str_has_prefix (mime, "text/")
+	||  g_str_has_prefix (mime, "application/vnd.")
+	|| !strcmp (mime, "application/pdf")
+	|| !strcmp (mime, "application/msword")
+	|| !strcmp (mime, "application/rtf"))
+		return BRASERO_SEARCH_SCOPE_DOCUMENTS;
+
+	return BRASERO_SEARCH_SCOPE_ANY;
+}
+
+static gchar *
+brasero_search_index_key_from_name (const gchar *name)
+{
+	gchar *display;
+	gchar *key;
+
+	display = g_filename_display_name (name);
+	key = g_utf8_casefold (display, -1);
+	g_free (display);
+	return key;
+}
+
+static void
+brasero_search_index_data_add_trigrams (BraseroSearchIndexData *data,
+					const gchar *key,
+					guint32 id)
+{
+	gsize len;
+	gsize i;
+
+	len = strlen (key);
+	for (i = 0; i + 3 <= len; i ++) {
+		GArray *postings;
+		guint32 trigram;
+
+		trigram = BRASERO_SEARCH_INDEX_TRIGRAM (key + i);
+		postings = g_hash_table_lookup (data->trigrams, GUINT_TO_POINTER (trigram));
+		if (!postings) {
+			postings = g_array_sized_new (FALSE, FALSE, sizeof (guint32), 4);
+			g_hash_table_insert (data->trigrams, GUINT_TO_POINTER (trigram), postings);
+		}
+		else if (g_array_index (postings, guint32, postings->len - 1) == id)
+			continue;
+
+		g_array_append_val (postings, id);
+	}
+}
+
+static guint32
+brasero_search_index_data_add_entry (BraseroSearchIndexData *data,
+				     guint32 parent,
+				     const gchar *path,
+				     const gchar *name,
+				     const gchar *mime)
+{
+	BraseroSearchIndexEntry entry;
+	gchar *key;
+
+	key = brasero_search_index_key_from_name (name);
+
+	entry.path = brasero_search_index_data_add_string (data, path);
+	entry.key = brasero_search_index_data_add_string (data, key);
+	entry.parent = parent;
+	entry.mime = brasero_search_index_data_get_mime (data, mime);
+	entry.scope = brasero_search_index_scope_from_mime (mime);
+	entry.removed = FALSE;
+	g_array_append_val (data->entries, entry);
+
+	brasero_search_index_data_add_trigrams (data, key, data->entries->len - 1);
+	g_free (key);
+
+	return data->entries->len - 1;
+}
+
+static guint32
+brasero_search_index_data_add_dir (BraseroSearchIndexData *data,
+				   const gchar *path,
+				   guint64 mtime)
+{
+	BraseroSearchIndexDir dir;
+
+	dir.path = brasero_search_index_data_add_string (data, path);
+	dir.mtime = mtime;
+	dir.removed = FALSE;
+	g_array_append_val (data->dirs, dir);
+
+	g_hash_table_insert (data->dir_paths,
+			     g_strdup (path),
+			     GUINT_TO_POINTER (data->dirs->len));
+	return data->dirs->len - 1;
+}
+
+static gboolean
+brasero_search_index_data_lookup_dir (BraseroSearchIndexData *data,
+				      const gchar *path,
+				      guint32 *index)
+{
+	gpointer value;
+
+	value = g_hash_table_lookup (data->dir_paths, path);
+	if (!value)
+		return FALSE;
+
+	if (index)
+		*index = GPOINTER_TO_UINT (value) - 1;
+	return TRUE;
+}
+
+/**
+ * Returns the postings of the rarest trigram of @key or NULL if @key is
+ * too short (in which case all entries are candidates). @empty is set to
+ * TRUE if one of the trigrams has no posting at all.
+ */
+
+static GArray *
+brasero_search_index_data_get_candidates (BraseroSearchIndexData *data,
+					  const gchar *key,
+					  gboolean *empty)
+{
+	GArray *smallest = NULL;
+	gsize len;
+	gsize i;
+
+	len = strlen (key);
+	for (i = 0; i + 3 <= len; i ++) {
+		GArray *postings;
+
+		postings = g_hash_table_lookup (data->trigrams,
+						GUINT_TO_POINTER (BRASERO_SEARCH_INDEX_TRIGRAM (key + i)));
+		if (!postings) {
+			*empty = TRUE;
+			return NULL;
+		}
+
+		if (!smallest || postings->len < smallest->len)
+			smallest = postings;
+	}
+
+	return smallest;
+}
+
+static gboolean
+brasero_search_index_data_find_entry (BraseroSearchIndexData *data,
+				      const gchar *path,
+				      guint32 *id)
+{
+	gboolean empty = FALSE;
+	GArray *postings;
+	gchar *name;
+	gchar *key;
+	guint i;
+
+	name = g_path_get_basename (path);
+	key = brasero_search_index_key_from_name (name);
+	g_free (name);
+
+	postings = brasero_search_index_data_get_candidates (data, key, &empty);
+	g_free (key);
+
+	if (empty)
+		return FALSE;
+
+	if (postings) {
+		for (i = 0; i < postings->len; i ++) {
+			BraseroSearchIndexEntry *entry;
+			guint32 candidate;
+
+			candidate = g_array_index (postings, guint32, i);
+			entry = BRASERO_SEARCH_INDEX_ENTRY (data, candidate);
+			if (!entry->removed
+			&&  !strcmp (BRASERO_SEARCH_INDEX_STRING (data, entry->path), path)) {
+				*id = candidate;
+				return TRUE;
+			}
+		}
+		return FALSE;
+	}
+
+	for (i = 0; i < data->entries->len; i ++) {
+		BraseroSearchIndexEntry *entry;
+
+		entry = BRASERO_SEARCH_INDEX_ENTRY (data, i);
+		if (!entry->removed
+		&&  !strcmp (BRASERO_SEARCH_INDEX_STRING (data, entry->path), path)) {
+			*id = i;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/**
+ * Removes all directories flagged in @flags and their files
+ */
+
+static void
+brasero_search_index_data_remove_dirs (BraseroSearchIndexData *data,
+				       const guint8 *flags,
+				       guint flags_num)
+{
+	guint i;
+
+	for (i = 0; i < data->entries->len; i ++) {
+		BraseroSearchIndexEntry *entry;
+
+		entry = BRASERO_SEARCH_INDEX_ENTRY (data, i);
+		if (entry->parent < flags_num && flags [entry->parent])
+			entry->removed = TRUE;
+	}
+
+	for (i = 0; i < flags_num; i ++) {
+		BraseroSearchIndexDir *dir;
+
+		if (!flags [i])
+			continue;
+
+		dir = BRASERO_SEARCH_INDEX_DIR (data, i);
+		if (dir->removed)
+			continue;
+
+		g_hash_table_remove (data->dir_paths, BRASERO_SEARCH_INDEX_STRING (data, dir->path));
+		dir->removed = TRUE;
+	}
+}
+
+static void
+brasero_search_index_data_remove_tree (BraseroSearchIndexData *data,
+				       const gchar *path)
+{
+	guint8 *flags;
+	gchar *prefix;
+	guint i;
+
+	prefix = g_strconcat (path, G_DIR_SEPARATOR_S, NULL);
+	flags = g_new0 (guint8, data->dirs->len);
+	for (i = 0; i < data->dirs->len; i ++) {
+		BraseroSearchIndexDir *dir;
+		const gchar *dir_path;
+
+		dir = BRASERO_SEARCH_INDEX_DIR (data, i);
+		if (dir->removed)
+			continue;
+
+		dir_path = BRASERO_SEARCH_INDEX_STRING (data, dir->path);
+		if (!strcmp (dir_path, path) || g_str_has_prefix (dir_path, prefix))
+			flags [i] = TRUE;
+	}
+	g_free (prefix);
+
+	brasero_search_index_data_remove_dirs (data, flags, data->dirs->len);
+	g_free (flags);
+}
+
+/**
+ * Reads the contents of a directory. New subdirectories are read as well
+ * if @recursive is TRUE or if they are not indexed yet.
+ */
+
+static void
+brasero_search_index_data_crawl (BraseroSearchIndexData *data,
+				 guint32 index,
+				 gboolean recursive,
+				 volatile gint *cancel)
+{
+	GQueue queue = G_QUEUE_INIT;
+
+	g_queue_push_tail (&queue, GUINT_TO_POINTER (index + 1));
+	while (!g_queue_is_empty (&queue)) {
+		GFileEnumerator *enumerator;
+		GFileInfo *info;
+		gchar *dir_path;
+		GFile *file;
+
+		index = GPOINTER_TO_UINT (g_queue_pop_head (&queue)) - 1;
+
+		if (cancel && g_atomic_int_get (cancel))
+			break;
+
+		dir_path = g_strdup (BRASERO_SEARCH_INDEX_STRING (data, BRASERO_SEARCH_INDEX_DIR (data, index)->path));
+		file = g_file_new_for_path (dir_path);
+		enumerator = g_file_enumerate_children (file,
+							BRASERO_SEARCH_INDEX_FILE_ATTRIBUTES,
+							G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+							NULL,
+							NULL);
+		g_object_unref (file);
+
+		if (!enumerator) {
+			g_free (dir_path);
+			continue;
+		}
+
+		while ((info = g_file_enumerator_next_file (enumerator, NULL, NULL))) {
+			const gchar *name;
+			gchar *path;
+
+			name = g_file_info_get_name (info);
+			if (g_file_info_get_is_hidden (info)) {
+				g_object_unref (info);
+				continue;
+			}
+
+			path = g_build_filename (dir_path, name, NULL);
+			if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+				if (recursive || !brasero_search_index_data_lookup_dir (data, path, NULL)) {
+					guint32 child;
+
+					child = brasero_search_index_data_add_dir (data,
+										   path,
+										   g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED));
+					g_queue_push_tail (&queue, GUINT_TO_POINTER (child + 1));
+				}
+			}
+			else if (g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR)
+				brasero_search_index_data_add_entry (data,
+								     index,
+								     path,
+								     name,
+								     g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE));
+
+			g_free (path);
+			g_object_unref (info);
+		}
+
+		g_object_unref (enumerator);
+		g_free (dir_path);
+
+		/* Children of a new directory are new as well */
+		recursive = TRUE;
+	}
+
+	g_queue_clear (&queue);
+}
+
+/**
+ * Reads again the directories flagged with 1 in @flags and removes those
+ * flagged with 2
+ */
+
+static void
+brasero_search_index_data_update_dirs (BraseroSearchIndexData *data,
+				       const guint8 *flags,
+				       guint flags_num,
+				       volatile gint *cancel)
+{
+	guint i;
+
+	/* Remove the files of all changed directories ... */
+	for (i = 0; i < data->entries->len; i ++) {
+		BraseroSearchIndexEntry *entry;
+
+		entry = BRASERO_SEARCH_INDEX_ENTRY (data, i);
+		if (entry->parent < flags_num && flags [entry->parent])
+			entry->removed = TRUE;
+	}
+
+	for (i = 0; i < flags_num; i ++) {
+		BraseroSearchIndexDir *dir;
+
+		if (flags [i] != 2)
+			continue;
+
+		dir = BRASERO_SEARCH_INDEX_DIR (data, i);
+		g_hash_table_remove (data->dir_paths, BRASERO_SEARCH_INDEX_STRING (data, dir->path));
+		dir->removed = TRUE;
+	}
+
+	/* ... and read them again */
+	for (i = 0; i < flags_num && !(cancel && g_atomic_int_get (cancel)); i ++) {
+		if (flags [i] == 1)
+			brasero_search_index_data_crawl (data, i, FALSE, cancel);
+	}
+}
+
+/**
+ * Reads again the directories modified since the index was saved
+ */
+
+static void
+brasero_search_index_data_revalidate (BraseroSearchIndexData *data,
+				      volatile gint *cancel)
+{
+	guint8 *flags;
+	guint dirs_num;
+	guint i;
+
+	dirs_num = data->dirs->len;
+	flags = g_new0 (guint8, dirs_num);
+
+	for (i = 0; i < dirs_num; i ++) {
+		BraseroSearchIndexDir *dir;
+		struct stat buffer;
+
+		if (g_atomic_int_get (cancel))
+			break;
+
+		dir = BRASERO_SEARCH_INDEX_DIR (data, i);
+		if (dir->removed)
+			continue;
+
+		if (g_stat (BRASERO_SEARCH_INDEX_STRING (data, dir->path), &buffer)
+		|| !S_ISDIR (buffer.st_mode)) {
+			flags [i] = 2;
+			continue;
+		}
+
+		if ((guint64) buffer.st_mtime != dir->mtime) {
+			dir->mtime = buffer.st_mtime;
+			flags [i] = 1;
+		}
+	}
+
+	brasero_search_index_data_update_dirs (data, flags, dirs_num, cancel);
+	g_free (flags);
+}
+
+static gchar *
+brasero_search_index_get_path (void)
+{
+	return g_build_filename (g_get_user_cache_dir (),
+				 "brasero",
+				 "search-index",
+				 NULL);
+}
+
+static const gchar **
+brasero_search_index_get_roots (void)
+{
+	static const gchar *roots [5];
+
+	roots [0] = g_get_user_special_dir (G_USER_DIRECTORY_MUSIC);
+	roots [1] = g_get_user_special_dir (G_USER_DIRECTORY_VIDEOS);
+	roots [2] = g_get_user_special_dir (G_USER_DIRECTORY_PICTURES);
+	roots [3] = g_get_user_special_dir (G_USER_DIRECTORY_DOCUMENTS);
+	roots [4] = NULL;
+	return roots;
+}
+
+/**
+ * On-disk format: a header followed by the string pool, the offsets of the
+ * mime types, the directories, the entries, the trigrams (key, number of
+ * postings) and all postings one trigram after the other. Removed
+ * entries and directories are not written.
+ */
+
+static GByteArray *
+brasero_search_index_data_serialize (BraseroSearchIndexData *data)
+{
+	BraseroSearchIndexHeader header;
+	GHashTableIter iter;
+	GByteArray *buffer;
+	gpointer postings;
+	guint32 *entry_ids;
+	guint32 *dir_ids;
+	gpointer trigram;
+	GString *pool;
+	guint32 num;
+	guint i;
+
+	/* Give new ids to the remaining entries and directories */
+	dir_ids = g_new (guint32, data->dirs->len);
+	for (num = 0, i = 0; i < data->dirs->len; i ++)
+		dir_ids [i] = BRASERO_SEARCH_INDEX_DIR (data, i)->removed ? G_MAXUINT32:num ++;
+	header.dirs_num = num;
+
+	entry_ids = g_new (guint32, data->entries->len);
+	for (num = 0, i = 0; i < data->entries->len; i ++)
+		entry_ids [i] = BRASERO_SEARCH_INDEX_ENTRY (data, i)->removed ? G_MAXUINT32:num ++;
+	header.entries_num = num;
+
+	/* New pool without the strings of removed entries */
+	pool = g_string_sized_new (data->pool->len);
+	g_string_append_c (pool, '\0');
+
+	buffer = g_byte_array_new ();
+	g_byte_array_set_size (buffer, sizeof (BraseroSearchIndexHeader));
+
+	header.magic = BRASERO_SEARCH_INDEX_MAGIC;
+	header.version = BRASERO_SEARCH_INDEX_VERSION;
+	header.mimes_num = data->mimes->len;
+
+	/* Strings are written once the pool is complete: first build the
+	 * records in a separate array */
+	{
+		GByteArray *records;
+
+		records = g_byte_array_new ();
+
+		for (i = 0; i < data->mimes->len; i ++) {
+			guint32 offset;
+
+			offset = pool->len;
+			g_string_append_len (pool, g_ptr_array_index (data->mimes, i), strlen (g_ptr_array_index (data->mimes, i)) + 1);
+			g_byte_array_append (records, (guint8 *) &offset, sizeof (offset));
+		}
+
+		for (i = 0; i < data->dirs->len; i ++) {
+			BraseroSearchIndexDir dir;
+
+			if (dir_ids [i] == G_MAXUINT32)
+				continue;
+
+			dir = *BRASERO_SEARCH_INDEX_DIR (data, i);
+			dir.path = pool->len;
+			g_string_append_len (pool,
+					     BRASERO_SEARCH_INDEX_STRING (data, BRASERO_SEARCH_INDEX_DIR (data, i)->path),
+					     strlen (BRASERO_SEARCH_INDEX_STRING (data, BRASERO_SEARCH_INDEX_DIR (data, i)->path)) + 1);
+			g_byte_array_append (records, (guint8 *) &dir, sizeof (dir));
+		}
+
+		for (i = 0; i < data->entries->len; i ++) {
+			BraseroSearchIndexEntry entry;
+			const gchar *string;
+
+			if (entry_ids [i] == G_MAXUINT32)
+				continue;
+
+			entry = *BRASERO_SEARCH_INDEX_ENTRY (data, i);
+
+			string = BRASERO_SEARCH_INDEX_STRING (data, entry.path);
+			entry.path = pool->len;
+			g_string_append_len (pool, string, strlen (string) + 1);
+
+			string = BRASERO_SEARCH_INDEX_STRING (data, entry.key);
+			entry.key = pool->len;
+			g_string_append_len (pool, string, strlen (string) + 1);
+
+			entry.parent = dir_ids [entry.parent];
+			g_byte_array_append (records, (guint8 *) &entry, sizeof (entry));
+		}
+
+		/* Keep records aligned */
+		while (pool->len % 8)
+			g_string_append_c (pool, '\0');
+
+		header.pool_len = pool->len;
+		g_byte_array_append (buffer, (guint8 *) pool->str, pool->len);
+		g_byte_array_append (buffer, records->data, records->len);
+		g_byte_array_free (records, TRUE);
+	}
+
+	/* Trigrams then postings */
+	header.trigrams_num = 0;
+	header.postings_num = 0;
+	{
+		GByteArray *all_postings;
+
+		all_postings = g_byte_array_new ();
+
+		g_hash_table_iter_init (&iter, data->trigrams);
+		while (g_hash_table_iter_next (&iter, &trigram, &postings)) {
+			GArray *array = postings;
+			guint32 record [2];
+
+			record [0] = GPOINTER_TO_UINT (trigram);
+			record [1] = 0;
+			for (i = 0; i < array->len; i ++) {
+				guint32 id;
+
+				id = entry_ids [g_array_index (array, guint32, i)];
+				if (id == G_MAXUINT32)
+					continue;
+
+				g_byte_array_append (all_postings, (guint8 *) &id, sizeof (id));
+				record [1] ++;
+			}
+
+			if (!record [1])
+				continue;
+
+			g_byte_array_append (buffer, (guint8 *) record, sizeof (record));
+			header.trigrams_num ++;
+			header.postings_num += record [1];
+		}
+
+		g_byte_array_append (buffer, all_postings->data, all_postings->len);
+		g_byte_array_free (all_postings, TRUE);
+	}
+
+	memcpy (buffer->data, &header, sizeof (header));
+
+	g_string_free (pool, TRUE);
+	g_free (entry_ids);
+	g_free (dir_ids);
+
+	return buffer;
+}
+
+static gboolean
+brasero_search_index_write (GByteArray *buffer)
+{
+	gchar *directory;
+	gboolean res;
+	gchar *path;
+
+	path = brasero_search_index_get_path ();
+	directory = g_path_get_dirname (path);
+
+	res = (g_mkdir_with_parents (directory, 0700) == 0
+	   &&  g_file_set_contents (path, (gchar *) buffer->data, buffer->len, NULL));
+
+	g_free (directory);
+	g_free (path);
+	return res;
+}
+
+static BraseroSearchIndexData *
+brasero_search_index_data_load (const gchar *path)
+{
+	BraseroSearchIndexHeader header;
+	BraseroSearchIndexData *data;
+	const guint32 *postings;
+	const guint8 *records;
+	GMappedFile *file;
+	const gchar *pool;
+	gsize expected;
+	gsize size;
+	guint i;
+
+	file = g_mapped_file_new (path, FALSE, NULL);
+	if (!file)
+		return NULL;
+
+	size = g_mapped_file_get_length (file);
+	if (size < sizeof (header)) {
+		g_mapped_file_unref (file);
+		return NULL;
+	}
+
+	memcpy (&header, g_mapped_file_get_contents (file), sizeof (header));
+	expected = sizeof (header) +
+		   (gsize) header.pool_len +
+		   (gsize) header.mimes_num * sizeof (guint32) +
+		   (gsize) header.dirs_num * sizeof (BraseroSearchIndexDir) +
+		   (gsize) header.entries_num * sizeof (BraseroSearchIndexEntry) +
+		   (gsize) header.trigrams_num * sizeof (guint32) * 2 +
+		   (gsize) header.postings_num * sizeof (guint32);
+
+	if (header.magic != BRASERO_SEARCH_INDEX_MAGIC
+	||  header.version != BRASERO_SEARCH_INDEX_VERSION
+	||  header.pool_len == 0
+	||  header.mimes_num >= G_MAXUINT16
+	||  size != expected) {
+		g_mapped_file_unref (file);
+		return NULL;
+	}
+
+	pool = g_mapped_file_get_contents (file) + sizeof (header);
+	if (pool [header.pool_len - 1] != '\0') {
+		g_mapped_file_unref (file);
+		return NULL;
+	}
+
+	data = brasero_search_index_data_new ();
+	g_string_truncate (data->pool, 0);
+	g_string_append_len (data->pool, pool, header.pool_len);
+
+	records = (const guint8 *) pool + header.pool_len;
+	for (i = 0; i < header.mimes_num; i ++) {
+		guint32 offset;
+
+		memcpy (&offset, records, sizeof (offset));
+		records += sizeof (offset);
+
+		if (offset >= header.pool_len)
+			goto error;
+
+		brasero_search_index_data_get_mime (data, BRASERO_SEARCH_INDEX_STRING (data, offset));
+	}
+
+	g_array_set_size (data->dirs, header.dirs_num);
+	memcpy (data->dirs->data, records, header.dirs_num * sizeof (BraseroSearchIndexDir));
+	records += header.dirs_num * sizeof (BraseroSearchIndexDir);
+	for (i = 0; i < header.dirs_num; i ++) {
+		BraseroSearchIndexDir *dir;
+
+		dir = BRASERO_SEARCH_INDEX_DIR (data, i);
+		if (dir->path >= header.pool_len)
+			goto error;
+
+		g_hash_table_insert (data->dir_paths,
+				     g_strdup (BRASERO_SEARCH_INDEX_STRING (data, dir->path)),
+				     GUINT_TO_POINTER (i + 1));
+	}
+
+	g_array_set_size (data->entries, header.entries_num);
+	memcpy (data->entries->data, records, header.entries_num * sizeof (BraseroSearchIndexEntry));
+	records += header.entries_num * sizeof (BraseroSearchIndexEntry);
+	for (i = 0; i < header.entries_num; i ++) {
+		BraseroSearchIndexEntry *entry;
+
+		entry = BRASERO_SEARCH_INDEX_ENTRY (data, i);
+		if (entry->path >= header.pool_len
+		||  entry->key >= header.pool_len
+		||  entry->parent >= header.dirs_num
+		||  entry->mime >= header.mimes_num)
+			goto error;
+	}
+
+	postings = (const guint32 *) (records + header.trigrams_num * sizeof (guint32) * 2);
+	for (i = 0; i < header.trigrams_num; i ++) {
+		guint32 record [2];
+		GArray *array;
+		guint j;
+
+		memcpy (record, records, sizeof (record));
+		records += sizeof (record);
+
+		array = g_array_sized_new (FALSE, FALSE, sizeof (guint32), record [1]);
+		g_array_set_size (array, record [1]);
+		memcpy (array->data, postings, record [1] * sizeof (guint32));
+		postings += record [1];
+
+		for (j = 0; j < array->len; j ++) {
+			if (g_array_index (array, guint32, j) >= header.entries_num) {
+				g_array_free (array, TRUE);
+				goto error;
+			}
+		}
+
+		g_hash_table_insert (data->trigrams, GUINT_TO_POINTER (record [0]), array);
+	}
+
+	g_mapped_file_unref (file);
+	return data;
+
+error:
+
+	g_mapped_file_unref (file);
+	brasero_search_index_data_free (data);
+	return NULL;
+}
+
+/**
+ * Loading thread
+ */
+
+static gboolean
+brasero_search_index_ready_cb (gpointer user_data);
+
+static gpointer
+brasero_search_index_load_thread (gpointer user_data)
+{
+	BraseroSearchIndexPrivate *priv;
+	BraseroSearchIndexData *data;
+	const gchar **roots;
+	gchar *path;
+	guint i;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (user_data);
+
+	path = brasero_search_index_get_path ();
+	data = brasero_search_index_data_load (path);
+	if (data)
+		brasero_search_index_data_revalidate (data, &priv->cancel);
+	else
+		data = brasero_search_index_data_new ();
+
+	/* Add the roots not indexed yet */
+	roots = brasero_search_index_get_roots ();
+	for (i = 0; roots [i] && !g_atomic_int_get (&priv->cancel); i ++) {
+		struct stat buffer;
+		guint32 index;
+
+		if (brasero_search_index_data_lookup_dir (data, roots [i], NULL))
+			continue;
+
+		if (g_stat (roots [i], &buffer) || !S_ISDIR (buffer.st_mode))
+			continue;
+
+		index = brasero_search_index_data_add_dir (data, roots [i], buffer.st_mtime);
+		brasero_search_index_data_crawl (data, index, TRUE, &priv->cancel);
+	}
+
+	if (!g_atomic_int_get (&priv->cancel)) {
+		GByteArray *buffer;
+
+		buffer = brasero_search_index_data_serialize (data);
+		brasero_search_index_write (buffer);
+		g_byte_array_free (buffer, TRUE);
+	}
+
+	g_free (path);
+
+	priv->loaded = data;
+	priv->ready_id = g_idle_add (brasero_search_index_ready_cb, user_data);
+
+	return NULL;
+}
+
+/**
+ * Queries
+ */
+
+static gboolean
+brasero_search_index_data_match (BraseroSearchIndexData *data,
+				 BraseroSearchIndexQuery *query,
+				 guint32 id,
+				 gint *score)
+{
+	BraseroSearchIndexEntry *entry;
+	const gchar *key;
+	gsize matched;
+	guint i;
+
+	entry = BRASERO_SEARCH_INDEX_ENTRY (data, id);
+	if (entry->removed)
+		return FALSE;
+
+	if (query->scope && !(entry->scope & query->scope))
+		return FALSE;
+
+	if (query->mimes) {
+		const gchar *mime;
+
+		mime = g_ptr_array_index (data->mimes, entry->mime);
+		for (i = 0; query->mimes [i]; i ++) {
+			if (!strcmp (query->mimes [i], mime))
+				break;
+		}
+
+		if (!query->mimes [i])
+			return FALSE;
+	}
+
+	key = BRASERO_SEARCH_INDEX_STRING (data, entry->key);
+	matched = 0;
+	for (i = 0; query->keywords && query->keywords [i]; i ++) {
+		if (!strstr (key, query->keywords [i]))
+			return FALSE;
+
+		matched += strlen (query->keywords [i]);
+	}
+
+	if (score) {
+		gsize len;
+
+		/* The more of the name the keywords cover the better */
+		len = strlen (key);
+		*score = len ? MIN (100, matched * 100 / len):0;
+	}
+
+	return TRUE;
+}
+
+static BraseroSearchIndexHit *
+brasero_search_index_hit_new (BraseroSearchIndexData *data,
+			      guint32 id,
+			      gint score)
+{
+	BraseroSearchIndexEntry *entry;
+	BraseroSearchIndexHit *hit;
+
+	entry = BRASERO_SEARCH_INDEX_ENTRY (data, id);
+
+	hit = g_new0 (BraseroSearchIndexHit, 1);
+	hit->uri = g_filename_to_uri (BRASERO_SEARCH_INDEX_STRING (data, entry->path), NULL, NULL);
+	hit->mime = g_ptr_array_index (data->mimes, entry->mime);
+	hit->score = score;
+	hit->id = id;
+	return hit;
+}
+
+static void
+brasero_search_index_hit_free (BraseroSearchIndexHit *hit)
+{
+	g_free (hit->uri);
+	g_free (hit);
+}
+
+static void
+brasero_search_index_hits_free (GPtrArray *hits)
+{
+	g_ptr_array_foreach (hits, (GFunc) brasero_search_index_hit_free, NULL);
+	g_ptr_array_free (hits, TRUE);
+}
+
+static BraseroSearchIndexHit *
+brasero_search_index_data_get_hit (BraseroSearchIndexData *data,
+				   BraseroSearchIndexQuery *query,
+				   guint32 id)
+{
+	BraseroSearchIndexHit *hit;
+	gint score = 0;
+
+	if (!brasero_search_index_data_match (data, query, id, &score))
+		return NULL;
+
+	hit = brasero_search_index_hit_new (data, id, score);
+	if (!hit->uri) {
+		brasero_search_index_hit_free (hit);
+		return NULL;
+	}
+
+	return hit;
+}
+
+static GPtrArray *
+brasero_search_index_data_query (BraseroSearchIndexData *data,
+				 BraseroSearchIndexQuery *query,
+				 GCancellable *cancel)
+{
+	GArray *candidates = NULL;
+	GPtrArray *hits;
+	guint num;
+	guint i;
+
+	hits = g_ptr_array_new ();
+
+	/* Only check the files listed for the rarest trigram of all keywords */
+	for (i = 0; query->keywords && query->keywords [i]; i ++) {
+		gboolean empty = FALSE;
+		GArray *postings;
+
+		postings = brasero_search_index_data_get_candidates (data,
+								     query->keywords [i],
+								     &empty);
+		if (empty)
+			return hits;
+
+		if (postings && (!candidates || postings->len < candidates->len))
+			candidates = postings;
+	}
+
+	num = candidates ? candidates->len:data->entries->len;
+	for (i = 0; i < num; i ++) {
+		BraseroSearchIndexHit *hit;
+
+		if (g_cancellable_is_cancelled (cancel))
+			break;
+
+		hit = brasero_search_index_data_get_hit (data,
+							 query,
+							 candidates ? g_array_index (candidates, guint32, i):i);
+		if (hit)
+			g_ptr_array_add (hits, hit);
+	}
+
+	return hits;
+}
+
+static void
+brasero_search_index_add_result (BraseroSearchIndex *self,
+				 guint32 id)
+{
+	BraseroSearchIndexPrivate *priv;
+	BraseroSearchIndexHit *hit;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (self);
+
+	if (!priv->results || priv->query_cancel)
+		return;
+
+	hit = brasero_search_index_data_get_hit (priv->data, &priv->query, id);
+	if (!hit)
+		return;
+
+	g_ptr_array_add (priv->results, hit);
+	brasero_search_engine_hit_added (BRASERO_SEARCH_ENGINE (self), hit);
+}
+
+static void
+brasero_search_index_remove_results (BraseroSearchIndex *self)
+{
+	BraseroSearchIndexPrivate *priv;
+	guint i;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (self);
+
+	if (!priv->results || priv->query_cancel)
+		return;
+
+	for (i = 0; i < priv->results->len; ) {
+		BraseroSearchIndexHit *hit;
+
+		hit = g_ptr_array_index (priv->results, i);
+		if (!BRASERO_SEARCH_INDEX_ENTRY (priv->data, hit->id)->removed) {
+			i ++;
+			continue;
+		}
+
+		brasero_search_engine_hit_removed (BRASERO_SEARCH_ENGINE (self), hit);
+		g_ptr_array_remove_index (priv->results, i);
+		brasero_search_index_hit_free (hit);
+	}
+}
+
+static void
+brasero_search_index_query_free (gpointer data)
+{
+	BraseroSearchIndexQuery *query = data;
+
+	if (query->hits)
+		brasero_search_index_hits_free (query->hits);
+
+	g_object_unref (query->cancel);
+	g_strfreev (query->keywords);
+	g_strfreev (query->mimes);
+	g_free (query);
+}
+
+static void
+brasero_search_index_query_thread (GSimpleAsyncResult *result,
+				   GObject *object,
+				   GCancellable *cancel)
+{
+	BraseroSearchIndexPrivate *priv;
+	BraseroSearchIndexQuery *query;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (object);
+	query = g_simple_async_result_get_op_res_gpointer (result);
+
+	g_mutex_lock (priv->mutex);
+	query->hits = brasero_search_index_data_query (priv->data, query, cancel);
+	g_mutex_unlock (priv->mutex);
+}
+
+static void
+brasero_search_index_query_run (BraseroSearchIndex *self);
+
+static void
+brasero_search_index_query_cb (GObject *object,
+			       GAsyncResult *result,
+			       gpointer user_data)
+{
+	BraseroSearchIndexPrivate *priv;
+	BraseroSearchIndexQuery *query;
+	GPtrArray *previous;
+	GHashTable *ids;
+	guint i;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (object);
+
+	query = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (result));
+	if (priv->query_cancel == query->cancel) {
+		g_object_unref (priv->query_cancel);
+		priv->query_cancel = NULL;
+	}
+
+	if (g_cancellable_is_cancelled (query->cancel))
+		return;
+
+	previous = priv->results;
+	priv->results = query->hits;
+	query->hits = NULL;
+
+	if (!previous) {
+		for (i = 0; i < priv->results->len; i ++)
+			brasero_search_engine_hit_added (BRASERO_SEARCH_ENGINE (object),
+							 g_ptr_array_index (priv->results, i));
+
+		brasero_search_engine_query_finished (BRASERO_SEARCH_ENGINE (object));
+	}
+	else {
+		BraseroSearchIndexHit *hit;
+
+		/* The query was run again after the index changed: only
+		 * report the differences */
+		ids = g_hash_table_new (g_direct_hash, g_direct_equal);
+		for (i = 0; i < priv->results->len; i ++) {
+			hit = g_ptr_array_index (priv->results, i);
+			g_hash_table_insert (ids, GUINT_TO_POINTER (hit->id + 1), hit);
+		}
+
+		for (i = 0; i < previous->len; i ++) {
+			hit = g_ptr_array_index (previous, i);
+			if (!g_hash_table_remove (ids, GUINT_TO_POINTER (hit->id + 1)))
+				brasero_search_engine_hit_removed (BRASERO_SEARCH_ENGINE (object), hit);
+		}
+
+		for (i = 0; i < priv->results->len; i ++) {
+			hit = g_ptr_array_index (priv->results, i);
+			if (g_hash_table_lookup (ids, GUINT_TO_POINTER (hit->id + 1)))
+				brasero_search_engine_hit_added (BRASERO_SEARCH_ENGINE (object), hit);
+		}
+
+		g_hash_table_destroy (ids);
+		brasero_search_index_hits_free (previous);
+	}
+
+	if (priv->requery) {
+		priv->requery = FALSE;
+		brasero_search_index_query_run (BRASERO_SEARCH_INDEX (object));
+	}
+}
+
+static void
+brasero_search_index_query_run (BraseroSearchIndex *self)
+{
+	BraseroSearchIndexPrivate *priv;
+	BraseroSearchIndexQuery *query;
+	GSimpleAsyncResult *res;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (self);
+
+	if (priv->query_cancel) {
+		g_cancellable_cancel (priv->query_cancel);
+		g_object_unref (priv->query_cancel);
+		priv->query_cancel = NULL;
+	}
+
+	res = g_simple_async_result_new (G_OBJECT (self),
+					 brasero_search_index_query_cb,
+					 NULL,
+					 brasero_search_index_query_run);
+
+	priv->query_cancel = g_cancellable_new ();
+
+	/* The thread works on its own copy of the query */
+	query = g_new0 (BraseroSearchIndexQuery, 1);
+	query->scope = priv->query.scope;
+	query->keywords = g_strdupv (priv->query.keywords);
+	query->mimes = g_strdupv (priv->query.mimes);
+	query->cancel = g_object_ref (priv->query_cancel);
+
+	g_simple_async_result_set_op_res_gpointer (res, query, brasero_search_index_query_free);
+	g_simple_async_result_run_in_thread (res,
+					     brasero_search_index_query_thread,
+					     G_PRIORITY_DEFAULT,
+					     priv->query_cancel);
+	g_object_unref (res);
+}
+
+static gboolean
+brasero_search_index_query_start (BraseroSearchEngine *search)
+{
+	BraseroSearchIndexPrivate *priv;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (search);
+
+	if (!priv->data)
+		return FALSE;
+
+	if (priv->results) {
+		brasero_search_index_hits_free (priv->results);
+		priv->results = NULL;
+	}
+
+	priv->requery = FALSE;
+	brasero_search_index_query_run (BRASERO_SEARCH_INDEX (search));
+	return TRUE;
+}
+
+/**
+ * Saving
+ */
+
+static void
+brasero_search_index_save_thread (GSimpleAsyncResult *result,
+				  GObject *object,
+				  GCancellable *cancel)
+{
+	BraseroSearchIndexPrivate *priv;
+	GByteArray *buffer;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (object);
+
+	/* Only the copy in memory needs the lock, not the writing */
+	g_mutex_lock (priv->mutex);
+	buffer = brasero_search_index_data_serialize (priv->data);
+	g_mutex_unlock (priv->mutex);
+
+	brasero_search_index_write (buffer);
+	g_byte_array_free (buffer, TRUE);
+}
+
+static void
+brasero_search_index_save_done_cb (GObject *object,
+				   GAsyncResult *result,
+				   gpointer user_data)
+{
+	BraseroSearchIndexPrivate *priv;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (object);
+	priv->saving = FALSE;
+}
+
+static gboolean
+brasero_search_index_save_cb (gpointer user_data)
+{
+	BraseroSearchIndexPrivate *priv;
+	GSimpleAsyncResult *res;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (user_data);
+
+	/* Let the previous save finish; try again later */
+	if (priv->saving)
+		return TRUE;
+
+	priv->save_id = 0;
+	priv->saving = TRUE;
+
+	res = g_simple_async_result_new (G_OBJECT (user_data),
+					 brasero_search_index_save_done_cb,
+					 NULL,
+					 brasero_search_index_save_cb);
+	g_simple_async_result_run_in_thread (res,
+					     brasero_search_index_save_thread,
+					     G_PRIORITY_LOW,
+					     NULL);
+	g_object_unref (res);
+
+	return FALSE;
+}
+
+static void
+brasero_search_index_schedule_save (BraseroSearchIndex *self)
+{
+	BraseroSearchIndexPrivate *priv;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (self);
+
+	if (!priv->save_id)
+		priv->save_id = g_timeout_add_seconds (BRASERO_SEARCH_INDEX_SAVE_DELAY,
+						       brasero_search_index_save_cb,
+						       self);
+}
+
+/**
+ * Monitoring
+ */
+
+static void
+brasero_search_index_monitor_changed_cb (GFileMonitor *monitor,
+					 GFile *file,
+					 GFile *other_file,
+					 GFileMonitorEvent event,
+					 BraseroSearchIndex *self);
+
+static void
+brasero_search_index_add_monitors (BraseroSearchIndex *self,
+				   guint32 first)
+{
+	BraseroSearchIndexPrivate *priv;
+	guint i;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (self);
+
+	/* Directories are stored breadth first so the ones closest to the
+	 * roots are watched first */
+	for (i = first; i < priv->data->dirs->len; i ++) {
+		BraseroSearchIndexDir *dir;
+		GFileMonitor *monitor;
+		GFile *file;
+
+		if (g_hash_table_size (priv->monitors) >= BRASERO_SEARCH_INDEX_MAX_MONITORS)
+			break;
+
+		dir = BRASERO_SEARCH_INDEX_DIR (priv->data, i);
+		if (dir->removed)
+			continue;
+
+		file = g_file_new_for_path (BRASERO_SEARCH_INDEX_STRING (priv->data, dir->path));
+		monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, NULL);
+		g_object_unref (file);
+
+		if (!monitor)
+			continue;
+
+		g_signal_connect (monitor,
+				  "changed",
+				  G_CALLBACK (brasero_search_index_monitor_changed_cb),
+				  self);
+		g_hash_table_insert (priv->monitors, GUINT_TO_POINTER (i), monitor);
+	}
+}
+
+static void
+brasero_search_index_file_created (BraseroSearchIndex *self,
+				   GFile *file)
+{
+	BraseroSearchIndexPrivate *priv;
+	GFileInfo *info;
+	guint32 parent;
+	gchar *dir_path;
+	gchar *path;
+	guint32 id;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (self);
+
+	path = g_file_get_path (file);
+	if (!path)
+		return;
+
+	dir_path = g_path_get_dirname (path);
+	if (!brasero_search_index_data_lookup_dir (priv->data, dir_path, &parent)
+	||   brasero_search_index_data_lookup_dir (priv->data, path, NULL)
+	||   brasero_search_index_data_find_entry (priv->data, path, &id)) {
+		g_free (dir_path);
+		g_free (path);
+		return;
+	}
+	g_free (dir_path);
+
+	info = g_file_query_info (file,
+				  BRASERO_SEARCH_INDEX_FILE_ATTRIBUTES,
+				  G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+				  NULL,
+				  NULL);
+	if (!info || g_file_info_get_is_hidden (info)) {
+		if (info)
+			g_object_unref (info);
+		g_free (path);
+		return;
+	}
+
+	if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+		guint32 first_entry;
+		guint32 index;
+
+		first_entry = priv->data->entries->len;
+		index = brasero_search_index_data_add_dir (priv->data,
+							   path,
+							   g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED));
+		brasero_search_index_data_crawl (priv->data, index, TRUE, NULL);
+		brasero_search_index_add_monitors (self, index);
+
+		for (id = first_entry; id < priv->data->entries->len; id ++)
+			brasero_search_index_add_result (self, id);
+	}
+	else if (g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR) {
+		id = brasero_search_index_data_add_entry (priv->data,
+							  parent,
+							  path,
+							  g_file_info_get_name (info),
+							  g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE));
+		brasero_search_index_add_result (self, id);
+	}
+
+	g_object_unref (info);
+	g_free (path);
+
+	brasero_search_index_schedule_save (self);
+}
+
+static void
+brasero_search_index_file_deleted (BraseroSearchIndex *self,
+				   GFile *file)
+{
+	BraseroSearchIndexPrivate *priv;
+	gchar *path;
+	guint32 id;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (self);
+
+	path = g_file_get_path (file);
+	if (!path)
+		return;
+
+	if (brasero_search_index_data_lookup_dir (priv->data, path, NULL)) {
+		guint i;
+
+		brasero_search_index_data_remove_tree (priv->data, path);
+
+		/* Stop monitoring removed directories */
+		for (i = 0; i < priv->data->dirs->len; i ++) {
+			if (BRASERO_SEARCH_INDEX_DIR (priv->data, i)->removed)
+				g_hash_table_remove (priv->monitors, GUINT_TO_POINTER (i));
+		}
+	}
+	else if (brasero_search_index_data_find_entry (priv->data, path, &id))
+		BRASERO_SEARCH_INDEX_ENTRY (priv->data, id)->removed = TRUE;
+	else {
+		g_free (path);
+		return;
+	}
+
+	g_free (path);
+
+	brasero_search_index_remove_results (self);
+	brasero_search_index_schedule_save (self);
+}
+
+static void
+brasero_search_index_monitor_changed_cb (GFileMonitor *monitor,
+					 GFile *file,
+					 GFile *other_file,
+					 GFileMonitorEvent event,
+					 BraseroSearchIndex *self)
+{
+	BraseroSearchIndexPrivate *priv;
+
+	if (event != G_FILE_MONITOR_EVENT_CREATED
+	&&  event != G_FILE_MONITOR_EVENT_DELETED)
+		return;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (self);
+
+	/* The results of a running query may not include this change */
+	if (priv->query_cancel)
+		priv->requery = TRUE;
+
+	g_mutex_lock (priv->mutex);
+	if (event == G_FILE_MONITOR_EVENT_CREATED)
+		brasero_search_index_file_created (self, file);
+	else
+		brasero_search_index_file_deleted (self, file);
+	g_mutex_unlock (priv->mutex);
+}
+
+/**
+ * Checking the directories that are not monitored
+ */
+
+typedef struct _BraseroSearchIndexRescan BraseroSearchIndexRescan;
+struct _BraseroSearchIndexRescan {
+	GArray *indexes;
+	GPtrArray *paths;
+	GArray *mtimes;
+
+	/* Set by the thread: 1 if changed, 2 if removed */
+	guint8 *flags;
+};
+
+static void
+brasero_search_index_rescan_free (gpointer data)
+{
+	BraseroSearchIndexRescan *rescan = data;
+
+	g_array_free (rescan->indexes, TRUE);
+	g_ptr_array_foreach (rescan->paths, (GFunc) g_free, NULL);
+	g_ptr_array_free (rescan->paths, TRUE);
+	g_array_free (rescan->mtimes, TRUE);
+	g_free (rescan->flags);
+	g_free (rescan);
+}
+
+/* The thread only works on its own copy of the paths */
+static void
+brasero_search_index_rescan_thread (GSimpleAsyncResult *result,
+				    GObject *object,
+				    GCancellable *cancel)
+{
+	BraseroSearchIndexRescan *rescan;
+	guint i;
+
+	rescan = g_simple_async_result_get_op_res_gpointer (result);
+	for (i = 0; i < rescan->paths->len; i ++) {
+		struct stat buffer;
+
+		if (g_stat (g_ptr_array_index (rescan->paths, i), &buffer)
+		|| !S_ISDIR (buffer.st_mode))
+			rescan->flags [i] = 2;
+		else if ((guint64) buffer.st_mtime != g_array_index (rescan->mtimes, guint64, i)) {
+			g_array_index (rescan->mtimes, guint64, i) = buffer.st_mtime;
+			rescan->flags [i] = 1;
+		}
+	}
+}
+
+static void
+brasero_search_index_rescan_done_cb (GObject *object,
+				     GAsyncResult *result,
+				     gpointer user_data)
+{
+	BraseroSearchIndexRescan *rescan;
+	BraseroSearchIndexPrivate *priv;
+	guint32 first_entry;
+	guint32 first_dir;
+	gboolean changed;
+	guint8 *flags;
+	guint32 id;
+	guint i;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (object);
+	priv->rescanning = FALSE;
+
+	rescan = g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (result));
+
+	g_mutex_lock (priv->mutex);
+
+	/* Directories are never moved in the array and the monitors may have
+	 * seen some of the changes meanwhile */
+	changed = FALSE;
+	flags = g_new0 (guint8, priv->data->dirs->len);
+	for (i = 0; i < rescan->indexes->len; i ++) {
+		BraseroSearchIndexDir *dir;
+		guint32 index;
+
+		if (!rescan->flags [i])
+			continue;
+
+		index = g_array_index (rescan->indexes, guint32, i);
+		dir = BRASERO_SEARCH_INDEX_DIR (priv->data, index);
+		if (dir->removed)
+			continue;
+
+		dir->mtime = g_array_index (rescan->mtimes, guint64, i);
+		flags [index] = rescan->flags [i];
+		changed = TRUE;
+	}
+
+	if (!changed) {
+		g_mutex_unlock (priv->mutex);
+		g_free (flags);
+		return;
+	}
+
+	first_entry = priv->data->entries->len;
+	first_dir = priv->data->dirs->len;
+	brasero_search_index_data_update_dirs (priv->data, flags, first_dir, NULL);
+	g_free (flags);
+
+	/* The results of a running query may not include these changes */
+	if (priv->query_cancel)
+		priv->requery = TRUE;
+
+	brasero_search_index_remove_results (BRASERO_SEARCH_INDEX (object));
+	for (id = first_entry; id < priv->data->entries->len; id ++)
+		brasero_search_index_add_result (BRASERO_SEARCH_INDEX (object), id);
+
+	brasero_search_index_add_monitors (BRASERO_SEARCH_INDEX (object), first_dir);
+
+	g_mutex_unlock (priv->mutex);
+
+	brasero_search_index_schedule_save (BRASERO_SEARCH_INDEX (object));
+}
+
+static gboolean
+brasero_search_index_rescan_cb (gpointer user_data)
+{
+	BraseroSearchIndexRescan *rescan;
+	BraseroSearchIndexPrivate *priv;
+	GSimpleAsyncResult *res;
+	guint32 i;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (user_data);
+
+	if (priv->rescanning)
+		return TRUE;
+
+	/* The data is only modified from the main thread so no need to lock */
+	rescan = g_new0 (BraseroSearchIndexRescan, 1);
+	rescan->indexes = g_array_new (FALSE, FALSE, sizeof (guint32));
+	rescan->paths = g_ptr_array_new ();
+	rescan->mtimes = g_array_new (FALSE, FALSE, sizeof (guint64));
+
+	for (i = 0; i < priv->data->dirs->len; i ++) {
+		BraseroSearchIndexDir *dir;
+
+		dir = BRASERO_SEARCH_INDEX_DIR (priv->data, i);
+		if (dir->removed
+		||  g_hash_table_lookup (priv->monitors, GUINT_TO_POINTER (i)))
+			continue;
+
+		g_array_append_val (rescan->indexes, i);
+		g_ptr_array_add (rescan->paths, g_strdup (BRASERO_SEARCH_INDEX_STRING (priv->data, dir->path)));
+		g_array_append_val (rescan->mtimes, dir->mtime);
+	}
+
+	if (!rescan->indexes->len) {
+		brasero_search_index_rescan_free (rescan);
+		return TRUE;
+	}
+
+	rescan->flags = g_new0 (guint8, rescan->indexes->len);
+	priv->rescanning = TRUE;
+
+	res = g_simple_async_result_new (G_OBJECT (user_data),
+					 brasero_search_index_rescan_done_cb,
+					 NULL,
+					 brasero_search_index_rescan_cb);
+	g_simple_async_result_set_op_res_gpointer (res, rescan, brasero_search_index_rescan_free);
+	g_simple_async_result_run_in_thread (res,
+					     brasero_search_index_rescan_thread,
+					     G_PRIORITY_LOW,
+					     NULL);
+	g_object_unref (res);
+
+	return TRUE;
+}
+
+static gboolean
+brasero_search_index_ready_cb (gpointer user_data)
+{
+	BraseroSearchIndexPrivate *priv;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (user_data);
+
+	priv->ready_id = 0;
+
+	g_thread_join (priv->thread);
+	priv->thread = NULL;
+
+	priv->data = priv->loaded;
+	priv->loaded = NULL;
+
+	brasero_search_index_add_monitors (BRASERO_SEARCH_INDEX (user_data), 0);
+	priv->rescan_id = g_timeout_add_seconds (BRASERO_SEARCH_INDEX_RESCAN_DELAY,
+						 brasero_search_index_rescan_cb,
+						 user_data);
+	return FALSE;
+}
+
+/**
+ * Engine interface
+ */
+
+static gboolean
+brasero_search_index_is_available (BraseroSearchEngine *engine)
+{
+	BraseroSearchIndexPrivate *priv;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (engine);
+
+	/* Only start indexing once the index is needed */
+	if (!priv->data && !priv->thread)
+		priv->thread = g_thread_create (brasero_search_index_load_thread,
+						engine,
+						TRUE,
+						NULL);
+
+	return (priv->data != NULL);
+}
+
+static gint
+brasero_search_index_num_hits (BraseroSearchEngine *engine)
+{
+	BraseroSearchIndexPrivate *priv;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (engine);
+	if (!priv->results)
+		return 0;
+
+	return priv->results->len;
+}
+
+static const gchar *
+brasero_search_index_uri_from_hit (BraseroSearchEngine *engine,
+                                   gpointer hit)
+{
+	BraseroSearchIndexHit *index_hit = hit;
+	return index_hit->uri;
+}
+
+static const gchar *
+brasero_search_index_mime_from_hit (BraseroSearchEngine *engine,
+                                    gpointer hit)
+{
+	BraseroSearchIndexHit *index_hit = hit;
+	return index_hit->mime;
+}
+
+static int
+brasero_search_index_score_from_hit (BraseroSearchEngine *engine,
+                                     gpointer hit)
+{
+	BraseroSearchIndexHit *index_hit = hit;
+	return index_hit->score;
+}
+
+static gboolean
+brasero_search_index_add_hit_to_tree (BraseroSearchEngine *search,
+                                      GtkTreeModel *model,
+                                      gint range_start,
+                                      gint range_end)
+{
+	BraseroSearchIndexPrivate *priv;
+	gint i;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (search);
+
+	if (!priv->results)
+		return FALSE;
+
+	range_end = MIN (range_end, (gint) priv->results->len);
+	for (i = range_start; i < range_end; i ++) {
+		GtkTreeIter row;
+
+		gtk_list_store_insert_with_values (GTK_LIST_STORE (model), &row, -1,
+		                                   BRASERO_SEARCH_TREE_HIT_COL, g_ptr_array_index (priv->results, i),
+		                                   -1);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+brasero_search_index_query_set_scope (BraseroSearchEngine *search,
+                                      BraseroSearchScope scope)
+{
+	BraseroSearchIndexPrivate *priv;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (search);
+	priv->query.scope = scope;
+	return TRUE;
+}
+
+static gboolean
+brasero_search_index_set_query_mime (BraseroSearchEngine *search,
+				     const gchar **mimes)
+{
+	BraseroSearchIndexPrivate *priv;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (search);
+
+	if (priv->query.mimes) {
+		g_strfreev (priv->query.mimes);
+		priv->query.mimes = NULL;
+	}
+
+	priv->query.mimes = g_strdupv ((gchar **) mimes);
+	return TRUE;
+}
+
+static void
+brasero_search_index_clean (BraseroSearchIndex *search)
+{
+	BraseroSearchIndexPrivate *priv;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (search);
+
+	if (priv->query_cancel) {
+		g_cancellable_cancel (priv->query_cancel);
+		g_object_unref (priv->query_cancel);
+		priv->query_cancel = NULL;
+	}
+	priv->requery = FALSE;
+
+	if (priv->results) {
+		brasero_search_index_hits_free (priv->results);
+		priv->results = NULL;
+	}
+
+	if (priv->query.keywords) {
+		g_strfreev (priv->query.keywords);
+		priv->query.keywords = NULL;
+	}
+
+	if (priv->query.mimes) {
+		g_strfreev (priv->query.mimes);
+		priv->query.mimes = NULL;
+	}
+
+	priv->query.scope = BRASERO_SEARCH_SCOPE_ANY;
+}
+
+static gboolean
+brasero_search_index_query_new (BraseroSearchEngine *search,
+				const gchar *keywords)
+{
+	BraseroSearchIndexPrivate *priv;
+	gchar **tokens;
+	gchar *folded;
+	guint num;
+	guint i;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (search);
+
+	brasero_search_index_clean (BRASERO_SEARCH_INDEX (search));
+	if (!keywords)
+		return TRUE;
+
+	/* Keep the non empty case folded keywords */
+	folded = g_utf8_casefold (keywords, -1);
+	tokens = g_strsplit_set (folded, " \t\n", -1);
+	g_free (folded);
+
+	for (num = 0, i = 0; tokens [i]; i ++) {
+		if (tokens [i][0] == '\0') {
+			g_free (tokens [i]);
+			continue;
+		}
+
+		tokens [num ++] = tokens [i];
+	}
+	tokens [num] = NULL;
+
+	if (!num) {
+		g_strfreev (tokens);
+		return TRUE;
+	}
+
+	priv->query.keywords = tokens;
+	return TRUE;
+}
+
+static void
+brasero_search_index_init_engine (BraseroSearchEngineIface *iface)
+{
+	iface->is_available = brasero_search_index_is_available;
+	iface->query_new = brasero_search_index_query_new;
+	iface->query_set_mime = brasero_search_index_set_query_mime;
+	iface->query_set_scope = brasero_search_index_query_set_scope;
+	iface->query_start = brasero_search_index_query_start;
+
+	iface->uri_from_hit = brasero_search_index_uri_from_hit;
+	iface->mime_from_hit = brasero_search_index_mime_from_hit;
+	iface->score_from_hit = brasero_search_index_score_from_hit;
+
+	iface->add_hits = brasero_search_index_add_hit_to_tree;
+	iface->num_hits = brasero_search_index_num_hits;
+}
+
+static void
+brasero_search_index_monitor_free (GFileMonitor *monitor)
+{
+	g_signal_handlers_disconnect_matched (monitor,
+					      G_SIGNAL_MATCH_FUNC,
+					      0,
+					      0,
+					      NULL,
+					      brasero_search_index_monitor_changed_cb,
+					      NULL);
+	g_file_monitor_cancel (monitor);
+	g_object_unref (monitor);
+}
+
+static void
+brasero_search_index_init (BraseroSearchIndex *object)
+{
+	BraseroSearchIndexPrivate *priv;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (object);
+
+	priv->monitors = g_hash_table_new_full (g_direct_hash,
+						g_direct_equal,
+						NULL,
+						(GDestroyNotify) brasero_search_index_monitor_free);
+
+	priv->mutex = g_mutex_new ();
+}
+
+static void
+brasero_search_index_finalize (GObject *object)
+{
+	BraseroSearchIndexPrivate *priv;
+
+	priv = BRASERO_SEARCH_INDEX_PRIVATE (object);
+
+	if (priv->thread) {
+		g_atomic_int_set (&priv->cancel, 1);
+		g_thread_join (priv->thread);
+		priv->thread = NULL;
+	}
+
+	if (priv->ready_id) {
+		g_source_remove (priv->ready_id);
+		priv->ready_id = 0;
+	}
+
+	if (priv->rescan_id) {
+		g_source_remove (priv->rescan_id);
+		priv->rescan_id = 0;
+	}
+
+	if (priv->loaded) {
+		brasero_search_index_data_free (priv->loaded);
+		priv->loaded = NULL;
+	}
+
+	brasero_search_index_clean (BRASERO_SEARCH_INDEX (object));
+
+	if (priv->monitors) {
+		g_hash_table_destroy (priv->monitors);
+		priv->monitors = NULL;
+	}
+
+	/* Threads hold a reference on the object so none is running */
+	if (priv->save_id) {
+		GByteArray *buffer;
+
+		g_source_remove (priv->save_id);
+		priv->save_id = 0;
+
+		buffer = brasero_search_index_data_serialize (priv->data);
+		brasero_search_index_write (buffer);
+		g_byte_array_free (buffer, TRUE);
+	}
+
+	if (priv->data) {
+		brasero_search_index_data_free (priv->data);
+		priv->data = NULL;
+	}
+
+	if (priv->mutex) {
+		g_mutex_free (priv->mutex);
+		priv->mutex = NULL;
+	}
+
+	G_OBJECT_CLASS (brasero_search_index_parent_class)->finalize (object);
+}
+
+static void
+brasero_search_index_class_init (BraseroSearchIndexClass *klass)
+{
+	GObjectClass* object_class = G_OBJECT_CLASS (klass);
+
+	g_type_class_add_private (klass, sizeof (BraseroSearchIndexPrivate));
+
+	object_class->finalize = brasero_search_index_finalize;
+}
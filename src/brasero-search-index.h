@@ -0,0 +1,51 @@
+/* -*- Mode: C; indent-tabs-mode: t; c-basic-offset: 8; tab-width: 8 -*- */
+/*
+ * brasero
+ * Copyright (C) Rouquier Philippe 2009 <bonfire-app@wanadoo.fr>
+ * 
+ * brasero is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * 
+ * brasero is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ * See the GNU General Public License for more details.
+ * 
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BRASERO_SEARCH_INDEX_H_
+#define _BRASERO_SEARCH_INDEX_H_
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define BRASERO_TYPE_SEARCH_INDEX             (brasero_search_index_get_type ())
+#define BRASERO_SEARCH_INDEX(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), BRASERO_TYPE_SEARCH_INDEX, BraseroSearchIndex))
+#define BRASERO_SEARCH_INDEX_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), BRASERO_TYPE_SEARCH_INDEX, BraseroSearchIndexClass))
+#define BRASERO_IS_SEARCH_INDEX(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), BRASERO_TYPE_SEARCH_INDEX))
+#define BRASERO_IS_SEARCH_INDEX_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), BRASERO_TYPE_SEARCH_INDEX))
+#define BRASERO_SEARCH_INDEX_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), BRASERO_TYPE_SEARCH_INDEX, BraseroSearchIndexClass))
+
+typedef struct _BraseroSearchIndexClass BraseroSearchIndexClass;
+typedef struct _BraseroSearchIndex BraseroSearchIndex;
+
+struct _BraseroSearchIndexClass
+{
+	GObjectClass parent_class;
+};
+
+struct _BraseroSearchIndex
+{
+	GObject parent_instance;
+};
+
+GType brasero_search_index_get_type (void) G_GNUC_CONST;
+
+G_END_DECLS
+
+#endif /* _BRASERO_SEARCH_INDEX_H_ */
@@ -77,6 +77,7 @@ struct _BraseroSplitDialogPrivate
 	gint64 end;
 
 	BraseroMetadata *metadata;
+	GCancellable *cancel;
 };
 
 #define BRASERO_SPLIT_DIALOG_PRIVATE(o)  (G_TYPE_INSTANCE_GET_PRIVATE ((o), BRASERO_TYPE_SPLIT_DIALOG, BraseroSplitDialogPrivate))
@@ -612,39 +613,23 @@ brasero_split_dialog_no_silence_message (BraseroSplitDialog *self)
 }
 
 static void
-brasero_split_dialog_metadata_finished_cb (BraseroMetadata *metadata,
-					   GError *error,
-					   BraseroSplitDialog *self)
+brasero_split_dialog_add_silences (BraseroSplitDialog *self,
+				   GSList *silences)
 {
-	BraseroMetadataInfo info = { NULL, };
 	BraseroSplitDialogPrivate *priv;
 	gboolean added_silence;
 	GSList *iter;
 
 	priv = BRASERO_SPLIT_DIALOG_PRIVATE (self);
 
-	gtk_widget_set_sensitive (priv->cut, TRUE);
-
-	g_object_unref (priv->metadata);
-	priv->metadata = NULL;
-
-	if (error) {
-		brasero_utils_message_dialog (GTK_WIDGET (self),
-					      _("An error occurred while detecting silences."),
-					      error->message,
-					      GTK_MESSAGE_ERROR);
-		return;
-	}
-
-	brasero_metadata_get_result (metadata, &info, NULL);
-	if (!info.silences) {
+	if (!silences) {
 		brasero_split_dialog_no_silence_message (self);
 		return;
 	}
 
 	/* remove silences */
 	added_silence = FALSE;
-	for (iter = info.silences; iter; iter = iter->next) {
+	for (iter = silences; iter; iter = iter->next) {
 		BraseroMetadataSilence *silence;
 
 		silence = iter->data;
@@ -679,7 +664,33 @@ brasero_split_dialog_metadata_finished_cb (BraseroMetadata *metadata,
 
 	if (!added_silence)
 		brasero_split_dialog_no_silence_message (self);
+}
 
+static void
+brasero_split_dialog_metadata_finished_cb (BraseroMetadata *metadata,
+					   GError *error,
+					   BraseroSplitDialog *self)
+{
+	BraseroMetadataInfo info = { NULL, };
+	BraseroSplitDialogPrivate *priv;
+
+	priv = BRASERO_SPLIT_DIALOG_PRIVATE (self);
+
+	gtk_widget_set_sensitive (priv->cut, TRUE);
+
+	g_object_unref (priv->metadata);
+	priv->metadata = NULL;
+
+	if (error) {
+		brasero_utils_message_dialog (GTK_WIDGET (self),
+					      _("An error occurred while detecting silences."),
+					      error->message,
+					      GTK_MESSAGE_ERROR);
+		return;
+	}
+
+	brasero_metadata_get_result (metadata, &info, NULL);
+	brasero_split_dialog_add_silences (self, info.silences);
 	brasero_metadata_info_clear (&info);
 }
 
@@ -727,6 +738,57 @@ brasero_split_dialog_clear_confirm_dialog (BraseroSplitDialog *self,
 	return TRUE;
 }
 
+static void
+brasero_split_dialog_detect_silences (BraseroSplitDialog *self)
+{
+	BraseroSplitDialogPrivate *priv;
+
+	priv = BRASERO_SPLIT_DIALOG_PRIVATE (self);
+
+	priv->metadata = brasero_metadata_new ();
+	g_signal_connect (priv->metadata,
+			  "completed",
+			  G_CALLBACK (brasero_split_dialog_metadata_finished_cb),
+			  self);
+	brasero_metadata_get_info_async (priv->metadata,
+					 brasero_song_control_get_uri (BRASERO_SONG_CONTROL (priv->player)),
+					 BRASERO_METADATA_FLAG_SILENCES);
+}
+
+static void
+brasero_split_dialog_cached_silences_cb (GObject *object,
+					 GAsyncResult *result,
+					 gpointer user_data)
+{
+	BraseroSplitDialogPrivate *priv;
+	GSList *silences = NULL;
+	GError *error = NULL;
+	gboolean found;
+
+	found = brasero_metadata_get_cached_silences_finish (result, &silences, &error);
+
+	/* Cancelled means the dialog is gone */
+	if (error) {
+		g_error_free (error);
+		return;
+	}
+
+	priv = BRASERO_SPLIT_DIALOG_PRIVATE (user_data);
+	g_object_unref (priv->cancel);
+	priv->cancel = NULL;
+
+	if (!found) {
+		brasero_split_dialog_detect_silences (BRASERO_SPLIT_DIALOG (user_data));
+		return;
+	}
+
+	gtk_widget_set_sensitive (priv->cut, TRUE);
+
+	brasero_split_dialog_add_silences (BRASERO_SPLIT_DIALOG (user_data), silences);
+	g_slist_foreach (silences, (GFunc) g_free, NULL);
+	g_slist_free (silences);
+}
+
 static void
 brasero_split_dialog_cut_clicked_cb (GtkButton *button,
 				     BraseroSplitDialog *self)
@@ -799,14 +861,12 @@ brasero_split_dialog_cut_clicked_cb (GtkButton *button,
 
 	gtk_list_store_clear (priv->model);
 
-	priv->metadata = brasero_metadata_new ();
-	g_signal_connect (priv->metadata,
-			  "completed",
-			  G_CALLBACK (brasero_split_dialog_metadata_finished_cb),
-			  self);
-	brasero_metadata_get_info_async (priv->metadata,
-					 brasero_song_control_get_uri (BRASERO_SONG_CONTROL (priv->player)),
-					 BRASERO_METADATA_FLAG_SILENCES);
+	/* Silences may be known from a previous detection */
+	priv->cancel = g_cancellable_new ();
+	brasero_metadata_get_cached_silences_async (brasero_song_control_get_uri (BRASERO_SONG_CONTROL (priv->player)),
+						    priv->cancel,
+						    brasero_split_dialog_cached_silences_cb,
+						    self);
 
 	/* stop anything from playing and grey out things */
 	gtk_widget_set_sensitive (priv->cut, FALSE);
@@ -1315,6 +1375,12 @@ brasero_split_dialog_finalize (GObject *object)
 	BraseroSplitDialogPrivate *priv;
 
 	priv = BRASERO_SPLIT_DIALOG_PRIVATE (object);
+	if (priv->cancel) {
+		g_cancellable_cancel (priv->cancel);
+		g_object_unref (priv->cancel);
+		priv->cancel = NULL;
+	}
+
 	if (priv->metadata) {
 		brasero_metadata_cancel (priv->metadata);
 		g_object_unref (priv->metadata);